@@ -0,0 +1,21 @@
+// Zero-copy access to bytes owned by the fs framework.
+#if canImport(fs)
+import Foundation
+import fs
+
+extension FSManagedBuffer {
+    /// Calls `body` with the bytes in place. The caller's reference keeps
+    /// them alive for the duration of the call.
+    public func withUnsafeBytes<Result>(_ body: (UnsafeRawBufferPointer) throws -> Result) rethrows -> Result {
+        try body(UnsafeRawBufferPointer(start: buffer.ptr.map(UnsafeRawPointer.init), count: buffer.len))
+    }
+}
+
+extension Data {
+    /// Shares the memory of `buffer` instead of copying it. The `Data` holds
+    /// its own reference, so `buffer` can be released independently.
+    public init(sharing buffer: FSManagedBuffer) {
+        self = buffer.data
+    }
+}
+#endif
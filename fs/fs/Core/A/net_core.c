@@ -28,3 +28,827 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/netw.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#define FS_NET_KQUEUE 1
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define FS_NET_EPOLL 1
+#endif
+
+// Events taken from the kernel per wait.
+#define FS_NET_LOOP_BATCH 64
+
+// Events carry the fd and the generation of its watch, so ones collected
+// before an unwatch are recognised and dropped.
+#define FS_NET_TOKEN(fd, generation) ((uint64_t)(uint32_t)(fd) | (uint64_t)(generation) << 32)
+#define FS_NET_WAKE_TOKEN UINT64_MAX
+
+typedef struct {
+    fs_net_event_handler_t handler;     // NULL when not watched
+    void* context;
+    unsigned events;
+    uint32_t generation;
+} fs_net_watch_t;
+
+struct fs_net_loop {
+    int fd;                             // kqueue or epoll
+    fs_net_watch_t* watches;            // by fd
+    size_t watch_count;
+#if defined(FS_NET_KQUEUE)
+    struct kevent* changes;             // submitted with the next wait
+    size_t change_count;
+    size_t change_capacity;
+#elif defined(FS_NET_EPOLL)
+    int wake_fd;
+#endif
+};
+
+uint64_t fs_net_now_ms(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+fs_error_t fs_net_loop_create(fs_net_loop_t** out) {
+    fs_net_loop_t* loop;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+#if !defined(FS_NET_KQUEUE) && !defined(FS_NET_EPOLL)
+    return FS_ERROR_NOT_SUPPORTED;
+#else
+    loop = calloc(1, sizeof(*loop));
+    if (!loop) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+#if defined(FS_NET_KQUEUE)
+    struct kevent wake;
+    
+    loop->fd = kqueue();
+    if (loop->fd < 0) {
+        free(loop);
+        return FS_ERROR_IO;
+    }
+    fcntl(loop->fd, F_SETFD, FD_CLOEXEC);
+    EV_SET(&wake, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, (void*)(uintptr_t)FS_NET_WAKE_TOKEN);
+    if (kevent(loop->fd, &wake, 1, NULL, 0, NULL) != 0) {
+        close(loop->fd);
+        free(loop);
+        return FS_ERROR_IO;
+    }
+#else
+    struct epoll_event wake = { .events = EPOLLIN, .data.u64 = FS_NET_WAKE_TOKEN };
+    
+    loop->fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (loop->fd < 0 || loop->wake_fd < 0 || epoll_ctl(loop->fd, EPOLL_CTL_ADD, loop->wake_fd, &wake) != 0) {
+        if (loop->fd >= 0) {
+            close(loop->fd);
+        }
+        if (loop->wake_fd >= 0) {
+            close(loop->wake_fd);
+        }
+        free(loop);
+        return FS_ERROR_IO;
+    }
+#endif
+    *out = loop;
+    return FS_ERROR_NONE;
+#endif
+}
+
+void fs_net_loop_destroy(fs_net_loop_t* loop) {
+    if (!loop) {
+        return;
+    }
+    close(loop->fd);
+#if defined(FS_NET_KQUEUE)
+    free(loop->changes);
+#elif defined(FS_NET_EPOLL)
+    close(loop->wake_fd);
+#endif
+    free(loop->watches);
+    free(loop);
+}
+
+#if defined(FS_NET_KQUEUE)
+
+static fs_error_t fs_net_loop_change(fs_net_loop_t* loop, int fd, int16_t filter, uint16_t flags, uint64_t token) {
+    if (loop->change_count == loop->change_capacity) {
+        size_t capacity = loop->change_capacity ? loop->change_capacity * 2 : 16;
+        struct kevent* changes = realloc(loop->changes, capacity * sizeof(*changes));
+        
+        if (!changes) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        loop->changes = changes;
+        loop->change_capacity = capacity;
+    }
+    EV_SET(&loop->changes[loop->change_count++], fd, filter, flags, 0, 0, (void*)(uintptr_t)token);
+    return FS_ERROR_NONE;
+}
+
+#endif
+
+fs_error_t fs_net_loop_watch(fs_net_loop_t* loop, int fd, unsigned events,
+                             fs_net_event_handler_t handler, void* context) {
+    fs_net_watch_t* watch;
+    bool added;
+    
+    if (!loop || fd < 0 || !handler || (events & ~(unsigned)(FS_NET_READABLE | FS_NET_WRITABLE))) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if ((size_t)fd >= loop->watch_count) {
+        size_t count = loop->watch_count ? loop->watch_count : 64;
+        fs_net_watch_t* watches;
+        
+        while (count <= (size_t)fd) {
+            count *= 2;
+        }
+        watches = realloc(loop->watches, count * sizeof(*watches));
+        if (!watches) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        memset(watches + loop->watch_count, 0, (count - loop->watch_count) * sizeof(*watches));
+        loop->watches = watches;
+        loop->watch_count = count;
+    }
+    watch = &loop->watches[fd];
+    added = !watch->handler;
+    
+#if defined(FS_NET_KQUEUE)
+    uint64_t token = FS_NET_TOKEN(fd, watch->generation);
+    unsigned before = added ? 0 : watch->events;
+    size_t mark = loop->change_count;
+    
+    // kqueue watches each direction separately; only the ones that change are touched.
+    if (((before ^ events) & FS_NET_READABLE) &&
+        fs_net_loop_change(loop, fd, EVFILT_READ, (events & FS_NET_READABLE) ? EV_ADD : EV_DELETE, token) != FS_ERROR_NONE) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (((before ^ events) & FS_NET_WRITABLE) &&
+        fs_net_loop_change(loop, fd, EVFILT_WRITE, (events & FS_NET_WRITABLE) ? EV_ADD : EV_DELETE, token) != FS_ERROR_NONE) {
+        loop->change_count = mark;
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+#else
+    struct epoll_event event = {
+        .events = ((events & FS_NET_READABLE) ? EPOLLIN : 0) | ((events & FS_NET_WRITABLE) ? EPOLLOUT : 0),
+        .data.u64 = FS_NET_TOKEN(fd, watch->generation),
+    };
+    
+    if ((added || events != watch->events) &&
+        epoll_ctl(loop->fd, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event) != 0) {
+        return errno == ENOMEM ? FS_ERROR_OUT_OF_MEMORY : FS_ERROR_IO;
+    }
+#endif
+    watch->handler = handler;
+    watch->context = context;
+    watch->events = events;
+    return FS_ERROR_NONE;
+}
+
+void fs_net_loop_unwatch(fs_net_loop_t* loop, int fd) {
+    fs_net_watch_t* watch;
+    
+    if (!loop || fd < 0 || (size_t)fd >= loop->watch_count || !loop->watches[fd].handler) {
+        return;
+    }
+    watch = &loop->watches[fd];
+#if defined(FS_NET_KQUEUE)
+    // Closing the socket removes its filters; these only matter if it stays open.
+    if (watch->events & FS_NET_READABLE) {
+        fs_net_loop_change(loop, fd, EVFILT_READ, EV_DELETE, 0);
+    }
+    if (watch->events & FS_NET_WRITABLE) {
+        fs_net_loop_change(loop, fd, EVFILT_WRITE, EV_DELETE, 0);
+    }
+#else
+    epoll_ctl(loop->fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+    watch->handler = NULL;
+    watch->context = NULL;
+    watch->events = 0;
+    watch->generation++;
+}
+
+static void fs_net_loop_dispatch(fs_net_loop_t* loop, uint64_t token, unsigned ready) {
+    int fd = (int)(uint32_t)token;
+    fs_net_watch_t* watch;
+    
+    if ((size_t)fd >= loop->watch_count) {
+        return;
+    }
+    watch = &loop->watches[fd];
+    // Dropped if the socket was unwatched, or watched anew, by an earlier handler.
+    if (!watch->handler || watch->generation != (uint32_t)(token >> 32) || !(ready &= watch->events)) {
+        return;
+    }
+    watch->handler(watch->context, fd, ready);
+}
+
+fs_error_t fs_net_loop_run(fs_net_loop_t* loop, int timeout_ms) {
+    int count;
+    
+    if (!loop) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+#if defined(FS_NET_KQUEUE)
+    struct kevent events[FS_NET_LOOP_BATCH];
+    struct timespec timeout, *wait = NULL;
+    
+    if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+        wait = &timeout;
+    }
+    count = kevent(loop->fd, loop->changes, (int)loop->change_count, events, FS_NET_LOOP_BATCH, wait);
+    loop->change_count = 0;
+    if (count < 0) {
+        return errno == EINTR ? FS_ERROR_NONE : FS_ERROR_IO;
+    }
+    for (int i = 0; i < count; i++) {
+        uint64_t token = (uint64_t)(uintptr_t)events[i].udata;
+        
+        // Failed changes come back as events; deleting a filter of a closed socket is expected to.
+        if ((events[i].flags & EV_ERROR) || token == FS_NET_WAKE_TOKEN) {
+            continue;
+        }
+        if (events[i].flags & EV_EOF) {
+            fs_net_loop_dispatch(loop, token, FS_NET_READABLE | FS_NET_WRITABLE);
+        } else {
+            fs_net_loop_dispatch(loop, token, events[i].filter == EVFILT_READ ? FS_NET_READABLE : FS_NET_WRITABLE);
+        }
+    }
+#else
+    struct epoll_event events[FS_NET_LOOP_BATCH];
+    
+    count = epoll_wait(loop->fd, events, FS_NET_LOOP_BATCH, timeout_ms);
+    if (count < 0) {
+        return errno == EINTR ? FS_ERROR_NONE : FS_ERROR_IO;
+    }
+    for (int i = 0; i < count; i++) {
+        uint32_t ready = events[i].events;
+        
+        if (events[i].data.u64 == FS_NET_WAKE_TOKEN) {
+            uint64_t value;
+            
+            if (read(loop->wake_fd, &value, sizeof(value)) < 0) {
+                // Already drained by an earlier wait.
+            }
+            continue;
+        }
+        fs_net_loop_dispatch(loop, events[i].data.u64,
+                             (ready & (EPOLLERR | EPOLLHUP) ? FS_NET_READABLE | FS_NET_WRITABLE : 0) |
+                             (ready & EPOLLIN ? FS_NET_READABLE : 0) | (ready & EPOLLOUT ? FS_NET_WRITABLE : 0));
+    }
+#endif
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_net_loop_wake(fs_net_loop_t* loop) {
+    if (!loop) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+#if defined(FS_NET_KQUEUE)
+    struct kevent wake;
+    
+    EV_SET(&wake, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, (void*)(uintptr_t)FS_NET_WAKE_TOKEN);
+    return kevent(loop->fd, &wake, 1, NULL, 0, NULL) == 0 ? FS_ERROR_NONE : FS_ERROR_IO;
+#else
+    uint64_t one = 1;
+    
+    // A full counter already wakes the loop.
+    return write(loop->wake_fd, &one, sizeof(one)) == sizeof(one) || errno == EAGAIN ? FS_ERROR_NONE : FS_ERROR_IO;
+#endif
+}
+
+typedef enum {
+    FS_NET_CONNECTING,
+    FS_NET_OPEN,
+    FS_NET_CLOSED,
+} fs_net_conn_state_t;
+
+typedef struct fs_net_host {
+    struct fs_net_host* next;
+    char* name;
+    uint16_t port;
+    struct addrinfo* addresses;
+    uint64_t resolved_at;
+    fs_net_conn_t* conns;               // oldest first
+    size_t conn_count;
+} fs_net_host_t;
+
+struct fs_net_pool {
+    fs_net_loop_t* loop;
+    fs_net_conn_handler_t handler;
+    void* context;
+    size_t max_per_host;
+    uint32_t idle_timeout_ms;
+    uint32_t connect_timeout_ms;
+    uint32_t dns_ttl_ms;
+    size_t ring_capacity;
+    fs_net_host_t* hosts;
+};
+
+struct fs_net_conn {
+    fs_net_pool_t* pool;
+    fs_net_host_t* host;
+    fs_net_conn_t* next;
+    int fd;
+    fs_net_conn_state_t state;
+    const struct addrinfo* next_address;    // tried when connecting to the current one fails
+    fs_net_ring_t* ring;
+    uint8_t* queue;                     // bytes the socket has not taken yet
+    size_t queue_head;
+    size_t queue_length;
+    size_t queue_capacity;
+    size_t load;
+    size_t capacity;
+    uint64_t since;                     // when it started connecting, or last became unused
+    void* context;
+    unsigned dispatching;               // nesting of handlers running for it
+};
+
+static void fs_net_conn_event(void* context, int fd, unsigned events);
+
+fs_error_t fs_net_pool_create(fs_net_loop_t* loop, const fs_net_pool_config_t* config,
+                              const fs_net_conn_handler_t* handler, void* context, fs_net_pool_t** out) {
+    fs_net_pool_t* pool;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!loop || !handler || !handler->opened || !handler->received || !handler->closed) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    pool->loop = loop;
+    pool->handler = *handler;
+    pool->context = context;
+    pool->max_per_host = config && config->max_per_host ? config->max_per_host : FS_NET_POOL_MAX_PER_HOST;
+    pool->idle_timeout_ms = config && config->idle_timeout_ms ? config->idle_timeout_ms : FS_NET_POOL_IDLE_TIMEOUT_MS;
+    pool->connect_timeout_ms = config && config->connect_timeout_ms ? config->connect_timeout_ms
+                                                                    : FS_NET_POOL_CONNECT_TIMEOUT_MS;
+    pool->dns_ttl_ms = config && config->dns_ttl_ms ? config->dns_ttl_ms : FS_NET_POOL_DNS_TTL_MS;
+    pool->ring_capacity = config && config->ring_capacity ? config->ring_capacity : FS_NET_POOL_RING_CAPACITY;
+    *out = pool;
+    return FS_ERROR_NONE;
+}
+
+static void fs_net_conn_free(fs_net_conn_t* conn) {
+    fs_net_ring_destroy(conn->ring);
+    free(conn->queue);
+    free(conn);
+}
+
+/* Takes the connection out of its host and closes the socket; freeing waits for running handlers. */
+static void fs_net_conn_shut(fs_net_conn_t* conn) {
+    fs_net_host_t* host = conn->host;
+    
+    for (fs_net_conn_t** link = &host->conns; *link; link = &(*link)->next) {
+        if (*link == conn) {
+            *link = conn->next;
+            host->conn_count--;
+            break;
+        }
+    }
+    if (conn->fd >= 0) {
+        fs_net_loop_unwatch(conn->pool->loop, conn->fd);
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    conn->state = FS_NET_CLOSED;
+}
+
+static void fs_net_conn_fail(fs_net_conn_t* conn, fs_error_t error) {
+    fs_net_conn_shut(conn);
+    conn->dispatching++;
+    conn->pool->handler.closed(conn->pool->context, conn, error);
+    if (!--conn->dispatching) {
+        fs_net_conn_free(conn);
+    }
+}
+
+void fs_net_pool_destroy(fs_net_pool_t* pool) {
+    if (!pool) {
+        return;
+    }
+    while (pool->hosts) {
+        fs_net_host_t* host = pool->hosts;
+        
+        while (host->conns) {
+            fs_net_conn_fail(host->conns, FS_ERROR_CANCELLED);
+        }
+        pool->hosts = host->next;
+        if (host->addresses) {
+            freeaddrinfo(host->addresses);
+        }
+        free(host->name);
+        free(host);
+    }
+    free(pool);
+}
+
+static fs_error_t fs_net_host_resolve(fs_net_pool_t* pool, fs_net_host_t* host, uint64_t now_ms) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_ADDRCONFIG };
+    struct addrinfo* addresses;
+    char service[8];
+    int status;
+    
+    if (host->addresses && now_ms - host->resolved_at < pool->dns_ttl_ms) {
+        return FS_ERROR_NONE;
+    }
+    // Connections still trying addresses point into the current list.
+    for (fs_net_conn_t* conn = host->conns; conn; conn = conn->next) {
+        if (conn->state == FS_NET_CONNECTING && host->addresses) {
+            return FS_ERROR_NONE;
+        }
+    }
+    snprintf(service, sizeof(service), "%u", (unsigned)host->port);
+    status = getaddrinfo(host->name, service, &hints, &addresses);
+    if (status != 0) {
+        // Keep connecting to the old addresses while the resolver is unreachable.
+        if (host->addresses && status != EAI_NONAME) {
+            return FS_ERROR_NONE;
+        }
+        return status == EAI_MEMORY ? FS_ERROR_OUT_OF_MEMORY :
+               status == EAI_NONAME || status == EAI_FAIL ? FS_ERROR_NOT_FOUND : FS_ERROR_IO;
+    }
+    if (host->addresses) {
+        freeaddrinfo(host->addresses);
+    }
+    host->addresses = addresses;
+    host->resolved_at = now_ms;
+    return FS_ERROR_NONE;
+}
+
+/* Starts connecting to the first address from `address` on that takes the attempt. */
+static fs_error_t fs_net_conn_connect(fs_net_conn_t* conn, const struct addrinfo* address) {
+    fs_net_loop_t* loop = conn->pool->loop;
+    
+    for (; address; address = address->ai_next) {
+        int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        
+        if (fd < 0) {
+            continue;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#if defined(SO_NOSIGPIPE)
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if ((connect(fd, address->ai_addr, address->ai_addrlen) == 0 || errno == EINPROGRESS) &&
+            fs_net_loop_watch(loop, fd, FS_NET_WRITABLE, fs_net_conn_event, conn) == FS_ERROR_NONE) {
+            conn->fd = fd;
+            conn->next_address = address->ai_next;
+            return FS_ERROR_NONE;
+        }
+        close(fd);
+    }
+    return FS_ERROR_IO;
+}
+
+fs_error_t fs_net_pool_acquire(fs_net_pool_t* pool, const char* host_name, uint16_t port, uint64_t now_ms,
+                               fs_net_conn_t** out) {
+    fs_net_host_t* host;
+    fs_net_conn_t* conn;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!pool || !host_name || !*host_name) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    for (host = pool->hosts; host; host = host->next) {
+        if (host->port == port && strcmp(host->name, host_name) == 0) {
+            break;
+        }
+    }
+    if (!host) {
+        host = calloc(1, sizeof(*host));
+        if (!host || !(host->name = strdup(host_name))) {
+            free(host);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        host->port = port;
+        host->next = pool->hosts;
+        pool->hosts = host;
+    }
+    for (conn = host->conns; conn; conn = conn->next) {
+        if (conn->load < conn->capacity) {
+            conn->load++;
+            *out = conn;
+            return FS_ERROR_NONE;
+        }
+    }
+    if (host->conn_count >= pool->max_per_host) {
+        return FS_ERROR_NONE;
+    }
+    error = fs_net_host_resolve(pool, host, now_ms);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    conn = calloc(1, sizeof(*conn));
+    if (!conn) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    conn->pool = pool;
+    conn->host = host;
+    conn->fd = -1;
+    conn->state = FS_NET_CONNECTING;
+    conn->capacity = 1;
+    conn->load = 1;
+    conn->since = now_ms;
+    error = fs_net_ring_create(pool->ring_capacity, &conn->ring);
+    if (error == FS_ERROR_NONE) {
+        error = fs_net_conn_connect(conn, host->addresses);
+    }
+    if (error != FS_ERROR_NONE) {
+        fs_net_conn_free(conn);
+        return error;
+    }
+    // Appended, so the oldest connections are filled first and the newest idle out.
+    fs_net_conn_t** link = &host->conns;
+    
+    while (*link) {
+        link = &(*link)->next;
+    }
+    *link = conn;
+    host->conn_count++;
+    *out = conn;
+    return FS_ERROR_NONE;
+}
+
+void fs_net_pool_release(fs_net_pool_t* pool, fs_net_conn_t* conn, uint64_t now_ms) {
+    (void)pool;
+    if (conn->load && !--conn->load && conn->state == FS_NET_OPEN) {
+        conn->since = now_ms;
+    }
+}
+
+void fs_net_pool_expire(fs_net_pool_t* pool, uint64_t now_ms, uint64_t* deadline_ms) {
+    uint64_t deadline = UINT64_MAX;
+    
+    for (fs_net_host_t* host = pool->hosts; host; host = host->next) {
+        fs_net_conn_t* conn = host->conns;
+        
+        while (conn) {
+            fs_net_conn_t* next = conn->next;
+            uint64_t due;
+            
+            if (conn->state == FS_NET_CONNECTING) {
+                due = conn->since + pool->connect_timeout_ms;
+                if (now_ms >= due) {
+                    fs_net_conn_fail(conn, FS_ERROR_TIMEOUT);
+                    due = UINT64_MAX;
+                }
+            } else if (!conn->load) {
+                due = conn->since + pool->idle_timeout_ms;
+                if (now_ms >= due) {
+                    fs_net_conn_fail(conn, FS_ERROR_NONE);
+                    due = UINT64_MAX;
+                }
+            } else {
+                due = UINT64_MAX;
+            }
+            if (due < deadline) {
+                deadline = due;
+            }
+            conn = next;
+        }
+    }
+    *deadline_ms = deadline;
+}
+
+void fs_net_conn_set_capacity(fs_net_conn_t* conn, size_t capacity) {
+    conn->capacity = capacity;
+}
+
+void* fs_net_conn_context(const fs_net_conn_t* conn) {
+    return conn->context;
+}
+
+void fs_net_conn_set_context(fs_net_conn_t* conn, void* context) {
+    conn->context = context;
+}
+
+void fs_net_conn_close(fs_net_conn_t* conn) {
+    if (conn->state == FS_NET_CLOSED) {
+        return;
+    }
+    fs_net_conn_shut(conn);
+    if (!conn->dispatching) {
+        fs_net_conn_free(conn);
+    }
+}
+
+static ssize_t fs_net_conn_send(fs_net_conn_t* conn, const struct iovec* iov, int count) {
+    struct msghdr message = { .msg_iov = (struct iovec*)iov, .msg_iovlen = count };
+    ssize_t sent;
+    
+#if defined(MSG_NOSIGNAL)
+    do {
+        sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+#else
+    do {
+        sent = sendmsg(conn->fd, &message, 0);
+    } while (sent < 0 && errno == EINTR);
+#endif
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    return sent;
+}
+
+/* Sends what is queued; watches for writability while some is left. */
+static fs_error_t fs_net_conn_flush(fs_net_conn_t* conn) {
+    unsigned events = FS_NET_READABLE;
+    
+    if (conn->queue_length) {
+        struct iovec iov = { conn->queue + conn->queue_head, conn->queue_length };
+        ssize_t sent = fs_net_conn_send(conn, &iov, 1);
+        
+        if (sent < 0) {
+            return FS_ERROR_IO;
+        }
+        conn->queue_head += (size_t)sent;
+        conn->queue_length -= (size_t)sent;
+        if (!conn->queue_length) {
+            conn->queue_head = 0;
+        } else {
+            events |= FS_NET_WRITABLE;
+        }
+    }
+    return fs_net_loop_watch(conn->pool->loop, conn->fd, events, fs_net_conn_event, conn);
+}
+
+static fs_error_t fs_net_conn_enqueue(fs_net_conn_t* conn, const struct iovec* iov, int count, size_t skip) {
+    size_t total = 0;
+    
+    for (int i = 0; i < count; i++) {
+        total += iov[i].iov_len;
+    }
+    total -= skip;
+    if (conn->queue_capacity - conn->queue_head - conn->queue_length < total) {
+        size_t capacity = conn->queue_capacity ? conn->queue_capacity : 4096;
+        
+        if (conn->queue_length) {
+            memmove(conn->queue, conn->queue + conn->queue_head, conn->queue_length);
+        }
+        conn->queue_head = 0;
+        while (capacity - conn->queue_length < total) {
+            if (capacity > SIZE_MAX / 2) {
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            capacity *= 2;
+        }
+        if (capacity != conn->queue_capacity) {
+            uint8_t* queue = realloc(conn->queue, capacity);
+            
+            if (!queue) {
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            conn->queue = queue;
+            conn->queue_capacity = capacity;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        size_t length = iov[i].iov_len;
+        
+        if (skip >= length) {
+            skip -= length;
+            continue;
+        }
+        memcpy(conn->queue + conn->queue_head + conn->queue_length, (const uint8_t*)iov[i].iov_base + skip,
+               length - skip);
+        conn->queue_length += length - skip;
+        skip = 0;
+    }
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_net_conn_writev(void* context, const struct iovec* iov, int count) {
+    fs_net_conn_t* conn = context;
+    ssize_t sent = 0;
+    fs_error_t error;
+    
+    if (!conn || !iov || count < 0) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (conn->state == FS_NET_CLOSED) {
+        return FS_ERROR_CANCELLED;
+    }
+    // Anything queued goes first; otherwise the socket gets the slices directly.
+    if (conn->state == FS_NET_OPEN && !conn->queue_length) {
+        sent = fs_net_conn_send(conn, iov, count);
+        if (sent < 0) {
+            return FS_ERROR_IO;
+        }
+    }
+    error = fs_net_conn_enqueue(conn, iov, count, (size_t)sent);
+    if (error != FS_ERROR_NONE || !conn->queue_length || conn->state != FS_NET_OPEN) {
+        return error;
+    }
+    return fs_net_loop_watch(conn->pool->loop, conn->fd, FS_NET_READABLE | FS_NET_WRITABLE, fs_net_conn_event, conn);
+}
+
+static void fs_net_conn_connected(fs_net_conn_t* conn) {
+    int error = 0, one = 1;
+    socklen_t length = sizeof(error);
+    
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error) {
+        const struct addrinfo* next = conn->next_address;
+        
+        fs_net_loop_unwatch(conn->pool->loop, conn->fd);
+        close(conn->fd);
+        conn->fd = -1;
+        if (fs_net_conn_connect(conn, next) != FS_ERROR_NONE) {
+            fs_net_conn_fail(conn, FS_ERROR_IO);
+        }
+        return;
+    }
+    // Requests are written whole; waiting to fill segments would only delay them.
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    conn->state = FS_NET_OPEN;
+    conn->next_address = NULL;
+    if (fs_net_conn_flush(conn) != FS_ERROR_NONE) {
+        fs_net_conn_fail(conn, FS_ERROR_IO);
+        return;
+    }
+    conn->pool->handler.opened(conn->pool->context, conn);
+}
+
+static void fs_net_conn_readable(fs_net_conn_t* conn) {
+    uint8_t* span;
+    size_t space = fs_net_ring_write_span(conn->ring, &span);
+    ssize_t received;
+    
+    if (!space) {
+        // The protocol left a full ring unhandled; reading on could never complete it.
+        fs_net_conn_fail(conn, FS_ERROR_NOT_SUPPORTED);
+        return;
+    }
+    do {
+        received = read(conn->fd, span, space);
+    } while (received < 0 && errno == EINTR);
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            fs_net_conn_fail(conn, FS_ERROR_IO);
+        }
+        return;
+    }
+    if (!received) {
+        fs_net_conn_fail(conn, FS_ERROR_NONE);
+        return;
+    }
+    fs_net_ring_produce(conn->ring, (size_t)received);
+    conn->pool->handler.received(conn->pool->context, conn, conn->ring);
+}
+
+static void fs_net_conn_event(void* context, int fd, unsigned events) {
+    fs_net_conn_t* conn = context;
+    
+    (void)fd;
+    conn->dispatching++;
+    if (conn->state == FS_NET_CONNECTING) {
+        fs_net_conn_connected(conn);
+    } else {
+        if ((events & FS_NET_WRITABLE) && fs_net_conn_flush(conn) != FS_ERROR_NONE) {
+            fs_net_conn_fail(conn, FS_ERROR_IO);
+        }
+        if ((events & FS_NET_READABLE) && conn->state == FS_NET_OPEN) {
+            fs_net_conn_readable(conn);
+        }
+    }
+    if (!--conn->dispatching && conn->state == FS_NET_CLOSED) {
+        fs_net_conn_free(conn);
+    }
+}
@@ -28,3 +28,1701 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/netw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FS_H2_DATA 0x0
+#define FS_H2_HEADERS 0x1
+#define FS_H2_RST_STREAM 0x3
+#define FS_H2_SETTINGS 0x4
+#define FS_H2_PUSH_PROMISE 0x5
+#define FS_H2_PING 0x6
+#define FS_H2_GOAWAY 0x7
+#define FS_H2_WINDOW_UPDATE 0x8
+#define FS_H2_CONTINUATION 0x9
+
+#define FS_H2_END_STREAM 0x01
+#define FS_H2_ACK 0x01
+#define FS_H2_END_HEADERS 0x04
+#define FS_H2_PADDED 0x08
+#define FS_H2_PRIORITY 0x20
+
+#define FS_H2_SETTINGS_HEADER_TABLE_SIZE 0x1
+#define FS_H2_SETTINGS_ENABLE_PUSH 0x2
+#define FS_H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define FS_H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define FS_H2_SETTINGS_MAX_FRAME_SIZE 0x5
+#define FS_H2_SETTINGS_MAX_HEADER_LIST_SIZE 0x6
+
+#define FS_H2_NO_ERROR 0x0
+#define FS_H2_PROTOCOL_ERROR 0x1
+#define FS_H2_FLOW_CONTROL_ERROR 0x3
+#define FS_H2_FRAME_SIZE_ERROR 0x6
+#define FS_H2_REFUSED_STREAM 0x7
+#define FS_H2_CANCEL 0x8
+#define FS_H2_COMPRESSION_ERROR 0x9
+
+#define FS_H2_FRAME_HEADER 9
+#define FS_H2_MAX_FRAME 16384               // the largest frame accepted, the protocol default
+#define FS_H2_MAX_FRAME_LIMIT 16777215
+#define FS_H2_DEFAULT_WINDOW 65535
+#define FS_H2_MAX_WINDOW 0x7FFFFFFF
+#define FS_H2_MAX_STREAM_ID 0x7FFFFFFF
+
+// Receive windows advertised: a response of up to a MiB is never held up by
+// window updates, and a few such streams fit in the connection window.
+#define FS_H2_STREAM_WINDOW ((uint32_t)1 << 20)
+#define FS_H2_CONN_WINDOW ((uint32_t)16 << 20)
+
+// Streams assumed per connection until the server's settings arrive.
+#define FS_H2_DEFAULT_STREAMS 100
+
+// Response headers kept per request, and the largest header block accepted.
+#define FS_H2_MAX_HEADER_LIST ((size_t)64 << 10)
+#define FS_H2_MAX_HEADER_BLOCK ((size_t)256 << 10)
+
+// Every ring must hold a whole frame.
+#define FS_HTTP_RING_MIN ((size_t)32 << 10)
+
+// Tries per request, counting the first.
+#define FS_HTTP_ATTEMPTS 2
+
+#define FS_HPACK_TABLE_SIZE 4096
+#define FS_HPACK_ENTRY_OVERHEAD 32
+#define FS_HPACK_ENTRIES (FS_HPACK_TABLE_SIZE / FS_HPACK_ENTRY_OVERHEAD)
+#define FS_HPACK_STATIC_COUNT 61
+
+// Values of sensitive headers up to this length are never indexed, so
+// their compressed size gives nothing away (RFC 7541, section 7.1.3).
+#define FS_HPACK_SENSITIVE_SHORT 20
+
+static const uint8_t fs_h2_preface[24] = {
+    'P', 'R', 'I', ' ', '*', ' ', 'H', 'T', 'T', 'P', '/', '2', '.', '0', '\r', '\n',
+    '\r', '\n', 'S', 'M', '\r', '\n', '\r', '\n',
+};
+
+typedef struct {
+    const char* name;
+    const char* value;
+    uint8_t name_length;
+    uint8_t value_length;
+} fs_hpack_static_t;
+
+#define FS_HPACK_STATIC(name, value) { name, value, sizeof(name) - 1, sizeof(value) - 1 }
+
+static const fs_hpack_static_t fs_hpack_static[FS_HPACK_STATIC_COUNT] = {
+    FS_HPACK_STATIC(":authority", ""),
+    FS_HPACK_STATIC(":method", "GET"),
+    FS_HPACK_STATIC(":method", "POST"),
+    FS_HPACK_STATIC(":path", "/"),
+    FS_HPACK_STATIC(":path", "/index.html"),
+    FS_HPACK_STATIC(":scheme", "http"),
+    FS_HPACK_STATIC(":scheme", "https"),
+    FS_HPACK_STATIC(":status", "200"),
+    FS_HPACK_STATIC(":status", "204"),
+    FS_HPACK_STATIC(":status", "206"),
+    FS_HPACK_STATIC(":status", "304"),
+    FS_HPACK_STATIC(":status", "400"),
+    FS_HPACK_STATIC(":status", "404"),
+    FS_HPACK_STATIC(":status", "500"),
+    FS_HPACK_STATIC("accept-charset", ""),
+    FS_HPACK_STATIC("accept-encoding", "gzip, deflate"),
+    FS_HPACK_STATIC("accept-language", ""),
+    FS_HPACK_STATIC("accept-ranges", ""),
+    FS_HPACK_STATIC("accept", ""),
+    FS_HPACK_STATIC("access-control-allow-origin", ""),
+    FS_HPACK_STATIC("age", ""),
+    FS_HPACK_STATIC("allow", ""),
+    FS_HPACK_STATIC("authorization", ""),
+    FS_HPACK_STATIC("cache-control", ""),
+    FS_HPACK_STATIC("content-disposition", ""),
+    FS_HPACK_STATIC("content-encoding", ""),
+    FS_HPACK_STATIC("content-language", ""),
+    FS_HPACK_STATIC("content-length", ""),
+    FS_HPACK_STATIC("content-location", ""),
+    FS_HPACK_STATIC("content-range", ""),
+    FS_HPACK_STATIC("content-type", ""),
+    FS_HPACK_STATIC("cookie", ""),
+    FS_HPACK_STATIC("date", ""),
+    FS_HPACK_STATIC("etag", ""),
+    FS_HPACK_STATIC("expect", ""),
+    FS_HPACK_STATIC("expires", ""),
+    FS_HPACK_STATIC("from", ""),
+    FS_HPACK_STATIC("host", ""),
+    FS_HPACK_STATIC("if-match", ""),
+    FS_HPACK_STATIC("if-modified-since", ""),
+    FS_HPACK_STATIC("if-none-match", ""),
+    FS_HPACK_STATIC("if-range", ""),
+    FS_HPACK_STATIC("if-unmodified-since", ""),
+    FS_HPACK_STATIC("last-modified", ""),
+    FS_HPACK_STATIC("link", ""),
+    FS_HPACK_STATIC("location", ""),
+    FS_HPACK_STATIC("max-forwards", ""),
+    FS_HPACK_STATIC("proxy-authenticate", ""),
+    FS_HPACK_STATIC("proxy-authorization", ""),
+    FS_HPACK_STATIC("range", ""),
+    FS_HPACK_STATIC("referer", ""),
+    FS_HPACK_STATIC("refresh", ""),
+    FS_HPACK_STATIC("retry-after", ""),
+    FS_HPACK_STATIC("server", ""),
+    FS_HPACK_STATIC("set-cookie", ""),
+    FS_HPACK_STATIC("strict-transport-security", ""),
+    FS_HPACK_STATIC("transfer-encoding", ""),
+    FS_HPACK_STATIC("user-agent", ""),
+    FS_HPACK_STATIC("vary", ""),
+    FS_HPACK_STATIC("via", ""),
+    FS_HPACK_STATIC("www-authenticate", ""),
+};
+
+/*
+ The Huffman code of RFC 7541 is canonical, so it is decoded by length:
+ with the next 32 bits left-aligned, a code is `length` bits long when they
+ are below the limit for that length, and its symbol is at the offset for
+ the length plus how far the code is past the first code of that length.
+ */
+static const uint32_t fs_hpack_huffman_limit[31] = {
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x50000000, 0xb8000000, 0xf8000000,
+    0xfe000000, 0xfe000000, 0xff400000, 0xffa00000, 0xffc00000, 0xfff00000, 0xfff80000, 0xfffe0000,
+    0xfffe0000, 0xfffe0000, 0xfffe0000, 0xfffe6000, 0xfffee000, 0xffff4800, 0xffffb000, 0xffffea00,
+    0xfffff600, 0xfffff800, 0xfffffbc0, 0xfffffe20, 0xfffffff0, 0xfffffff0, 0xffffffff,
+};
+
+static const uint32_t fs_hpack_huffman_first[31] = {
+    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000014, 0x0000005c,
+    0x000000f8, 0x000001fc, 0x000003f8, 0x000007fa, 0x00000ffa, 0x00001ff8, 0x00003ffc, 0x00007ffc,
+    0x0000fffe, 0x0001fffc, 0x0003fff8, 0x0007fff0, 0x000fffe6, 0x001fffdc, 0x003fffd2, 0x007fffd8,
+    0x00ffffea, 0x01ffffec, 0x03ffffe0, 0x07ffffde, 0x0fffffe2, 0x1ffffffe, 0x3ffffffc,
+};
+
+static const uint16_t fs_hpack_huffman_offset[31] = {
+    0, 0, 0, 0, 0, 0, 10, 36,
+    68, 74, 74, 79, 82, 84, 90, 92,
+    95, 95, 95, 95, 98, 106, 119, 145,
+    174, 186, 190, 205, 224, 253, 253,
+};
+
+static const uint16_t fs_hpack_huffman_symbols[257] = {
+    48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+    52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+    110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+    77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+    119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+    43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+    195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+    179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+    163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+    233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+    158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+    144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+    200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+    212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+    2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+    21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+    256,
+};
+
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+} fs_http_buffer_t;
+
+typedef struct {
+    uint8_t* bytes;                     // the name, then the value
+    size_t name_length;
+    size_t value_length;
+} fs_hpack_entry_t;
+
+/* A dynamic table: a ring of entries, newest at `first`. */
+typedef struct {
+    fs_hpack_entry_t entries[FS_HPACK_ENTRIES];
+    size_t first;
+    size_t count;
+    size_t size;                        // as RFC 7541 counts it
+    size_t max_size;
+} fs_hpack_table_t;
+
+typedef struct fs_h2_conn fs_h2_conn_t;
+
+typedef struct fs_http_call {
+    struct fs_http_call* next;          // in the pending queue, or the streams of a connection
+    fs_h2_conn_t* h2;                   // while it is a stream
+    uint32_t id;
+    
+    // The request, copied into `storage`.
+    void* storage;
+    const char* host;
+    uint16_t port;
+    const char* method;
+    const char* authority;
+    const char* path;
+    const fs_http_header_t* headers;
+    size_t header_count;
+    bool has_length;
+    bool idempotent;
+    const uint8_t* body;
+    size_t body_length;
+    
+    size_t body_sent;
+    int64_t send_window;
+    uint32_t receive_unacked;
+    uint64_t deadline;
+    unsigned attempts;
+    
+    // The response.
+    bool responded;                     // part of a response arrived
+    bool final;                         // its final headers arrived
+    bool headers_too_large;
+    fs_error_t error;                   // why it could not be dispatched
+    int status;
+    fs_http_buffer_t header_bytes;      // name and value pairs, each NUL-terminated
+    size_t response_header_count;
+    fs_http_buffer_t body_bytes;
+    
+    fs_http_completion_t completion;
+    void* context;
+} fs_http_call_t;
+
+struct fs_h2_conn {
+    fs_h2_conn_t* next;
+    fs_http_client_t* client;
+    fs_net_conn_t* conn;
+    char* host;
+    uint16_t port;
+    bool opened;
+    bool settled;                       // the server's settings arrived
+    bool goaway;
+    bool broken;                        // something could not be written
+    fs_http_buffer_t out;               // frames not yet handed to the connection
+    fs_http_call_t* streams;
+    uint32_t next_id;
+    uint32_t max_streams;
+    int64_t send_window;
+    uint32_t peer_initial_window;
+    uint32_t peer_max_frame;
+    uint32_t receive_unacked;
+    fs_hpack_table_t encoder;
+    fs_hpack_table_t decoder;
+    bool encoder_resized;               // a table size update is owed
+    
+    // A header block continued in CONTINUATION frames.
+    bool in_block;
+    uint32_t block_stream;
+    uint8_t block_flags;
+    fs_http_buffer_t block;
+};
+
+struct fs_http_client {
+    fs_net_loop_t* loop;
+    fs_net_pool_t* pool;
+    size_t max_response;
+    uint32_t timeout_ms;
+    uint64_t now;
+    bool destroying;
+    fs_h2_conn_t* conns;
+    fs_http_call_t* pending;            // waiting for room on a connection, oldest first
+    fs_http_call_t** pending_tail;
+    fs_http_buffer_t scratch;           // strings being decoded
+    fs_http_buffer_t encoded;           // the header block being encoded
+};
+
+static bool fs_http_reserve(fs_http_buffer_t* buffer, size_t extra) {
+    if (buffer->capacity - buffer->length < extra) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+        uint8_t* data;
+        
+        while (capacity - buffer->length < extra) {
+            if (capacity > SIZE_MAX / 2) {
+                return false;
+            }
+            capacity *= 2;
+        }
+        data = realloc(buffer->data, capacity);
+        if (!data) {
+            return false;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return true;
+}
+
+static bool fs_http_append(fs_http_buffer_t* buffer, const void* bytes, size_t length) {
+    if (!fs_http_reserve(buffer, length)) {
+        return false;
+    }
+    if (length) {
+        memcpy(buffer->data + buffer->length, bytes, length);
+        buffer->length += length;
+    }
+    return true;
+}
+
+static uint32_t fs_h2_load32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void fs_h2_store32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static void fs_hpack_evict(fs_hpack_table_t* table, size_t max_size) {
+    while (table->count && table->size > max_size) {
+        fs_hpack_entry_t* entry = &table->entries[(table->first + table->count - 1) % FS_HPACK_ENTRIES];
+        
+        table->size -= entry->name_length + entry->value_length + FS_HPACK_ENTRY_OVERHEAD;
+        free(entry->bytes);
+        entry->bytes = NULL;
+        table->count--;
+    }
+}
+
+static void fs_hpack_resize(fs_hpack_table_t* table, size_t max_size) {
+    table->max_size = max_size;
+    fs_hpack_evict(table, max_size);
+}
+
+/* Name and value may point into the table itself; they are copied before anything is evicted. */
+static bool fs_hpack_add(fs_hpack_table_t* table, const uint8_t* name, size_t name_length,
+                         const uint8_t* value, size_t value_length) {
+    size_t size = name_length + value_length + FS_HPACK_ENTRY_OVERHEAD;
+    uint8_t* bytes;
+    
+    if (size > table->max_size) {
+        // An entry larger than the table empties it (RFC 7541, section 4.4).
+        fs_hpack_evict(table, 0);
+        return true;
+    }
+    bytes = malloc(name_length + value_length + 1);
+    if (!bytes) {
+        return false;
+    }
+    memcpy(bytes, name, name_length);
+    memcpy(bytes + name_length, value, value_length);
+    fs_hpack_evict(table, table->max_size - size);
+    table->first = (table->first + FS_HPACK_ENTRIES - 1) % FS_HPACK_ENTRIES;
+    table->entries[table->first] = (fs_hpack_entry_t){ bytes, name_length, value_length };
+    table->count++;
+    table->size += size;
+    return true;
+}
+
+/* Looks up an index of the static table followed by the dynamic one; 0 is not an index. */
+static bool fs_hpack_get(const fs_hpack_table_t* table, size_t index, const uint8_t** name, size_t* name_length,
+                         const uint8_t** value, size_t* value_length) {
+    if (index >= 1 && index <= FS_HPACK_STATIC_COUNT) {
+        const fs_hpack_static_t* entry = &fs_hpack_static[index - 1];
+        
+        *name = (const uint8_t*)entry->name;
+        *name_length = entry->name_length;
+        *value = (const uint8_t*)entry->value;
+        *value_length = entry->value_length;
+        return true;
+    }
+    if (index > FS_HPACK_STATIC_COUNT && index - FS_HPACK_STATIC_COUNT <= table->count) {
+        const fs_hpack_entry_t* entry = &table->entries[(table->first + index - FS_HPACK_STATIC_COUNT - 1) %
+                                                        FS_HPACK_ENTRIES];
+        
+        *name = entry->bytes;
+        *name_length = entry->name_length;
+        *value = entry->bytes + entry->name_length;
+        *value_length = entry->value_length;
+        return true;
+    }
+    return false;
+}
+
+static void fs_hpack_clear(fs_hpack_table_t* table) {
+    fs_hpack_evict(table, 0);
+}
+
+static bool fs_hpack_read_integer(const uint8_t** p, const uint8_t* end, unsigned prefix_bits, size_t* value) {
+    size_t mask = ((size_t)1 << prefix_bits) - 1;
+    size_t result;
+    unsigned shift = 0;
+    uint8_t byte;
+    
+    if (*p >= end) {
+        return false;
+    }
+    result = *(*p)++ & mask;
+    if (result < mask) {
+        *value = result;
+        return true;
+    }
+    // Four continuation bytes are plenty for any length or index in a 4096 byte table.
+    do {
+        if (*p >= end || shift > 21) {
+            return false;
+        }
+        byte = *(*p)++;
+        result += (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *value = result;
+    return true;
+}
+
+static bool fs_hpack_huffman_decode(const uint8_t* p, size_t length, uint8_t* out, size_t* out_length) {
+    const uint8_t* end = p + length;
+    uint64_t bits = 0;                  // left-aligned
+    unsigned count = 0;
+    size_t n = 0;
+    
+    for (;;) {
+        uint32_t peek;
+        unsigned code_length = 5;
+        uint16_t symbol;
+        
+        while (count <= 56 && p < end) {
+            bits |= (uint64_t)*p++ << (56 - count);
+            count += 8;
+        }
+        if (!count) {
+            break;
+        }
+        // Past the end the bits read as ones, the padding, which matches no code.
+        peek = (uint32_t)(bits >> 32) | (count < 32 ? UINT32_MAX >> count : 0);
+        while (code_length < 30 && peek >= fs_hpack_huffman_limit[code_length]) {
+            code_length++;
+        }
+        if (code_length > count) {
+            // At most 7 bits of padding, all ones, may end the string.
+            if (count >= 8 || (bits >> (64 - count)) != ((uint64_t)1 << count) - 1) {
+                return false;
+            }
+            break;
+        }
+        symbol = fs_hpack_huffman_symbols[fs_hpack_huffman_offset[code_length] +
+                                          (peek >> (32 - code_length)) - fs_hpack_huffman_first[code_length]];
+        if (symbol == 256) {
+            return false;
+        }
+        out[n++] = (uint8_t)symbol;
+        bits <<= code_length;
+        count -= code_length;
+    }
+    *out_length = n;
+    return true;
+}
+
+/* Appends a string literal to the scratch buffer, decoded. */
+static bool fs_hpack_read_string(fs_http_buffer_t* scratch, const uint8_t** p, const uint8_t* end) {
+    bool huffman;
+    size_t length, decoded;
+    
+    if (*p >= end) {
+        return false;
+    }
+    huffman = **p & 0x80;
+    if (!fs_hpack_read_integer(p, end, 7, &length) || length > (size_t)(end - *p)) {
+        return false;
+    }
+    if (!huffman) {
+        if (!fs_http_append(scratch, *p, length)) {
+            return false;
+        }
+    } else {
+        // The shortest code is 5 bits, so a string decodes to at most 8/5 of its length.
+        if (!fs_http_reserve(scratch, length * 8 / 5 + 1) ||
+            !fs_hpack_huffman_decode(*p, length, scratch->data + scratch->length, &decoded)) {
+            return false;
+        }
+        scratch->length += decoded;
+    }
+    *p += length;
+    return true;
+}
+
+static void fs_hpack_write_integer(uint8_t** p, uint8_t first, unsigned prefix_bits, size_t value) {
+    size_t mask = ((size_t)1 << prefix_bits) - 1;
+    
+    if (value < mask) {
+        *(*p)++ = first | (uint8_t)value;
+        return;
+    }
+    *(*p)++ = first | (uint8_t)mask;
+    value -= mask;
+    while (value >= 0x80) {
+        *(*p)++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *(*p)++ = (uint8_t)value;
+}
+
+typedef enum {
+    FS_HPACK_INDEXED,                   // added to the dynamic table
+    FS_HPACK_UNINDEXED,
+    FS_HPACK_NEVER_INDEXED,
+} fs_hpack_mode_t;
+
+/* Most bytes fs_hpack_encode() writes beyond the name and value. */
+#define FS_HPACK_FIELD_OVERHEAD 16
+
+/*
+ Encodes a field as an index when the table has it; otherwise as a literal,
+ with the name as an index when the table has that, and the value raw. Raw
+ strings cost more bytes than Huffman-coded ones only the first time a
+ header is sent; after that the table sends its index.
+ */
+static bool fs_hpack_encode(fs_hpack_table_t* table, uint8_t** p, const char* name, size_t name_length,
+                            const char* value, size_t value_length, fs_hpack_mode_t mode) {
+    size_t name_index = 0;
+    
+    for (size_t i = 0; i < FS_HPACK_STATIC_COUNT; i++) {
+        const fs_hpack_static_t* entry = &fs_hpack_static[i];
+        
+        if (entry->name_length == name_length && memcmp(entry->name, name, name_length) == 0) {
+            if (entry->value_length == value_length && memcmp(entry->value, value, value_length) == 0 &&
+                mode != FS_HPACK_NEVER_INDEXED) {
+                fs_hpack_write_integer(p, 0x80, 7, i + 1);
+                return true;
+            }
+            if (!name_index) {
+                name_index = i + 1;
+            }
+        }
+    }
+    for (size_t i = 0; i < table->count; i++) {
+        const fs_hpack_entry_t* entry = &table->entries[(table->first + i) % FS_HPACK_ENTRIES];
+        
+        if (entry->name_length == name_length && memcmp(entry->bytes, name, name_length) == 0) {
+            if (entry->value_length == value_length &&
+                memcmp(entry->bytes + name_length, value, value_length) == 0 && mode != FS_HPACK_NEVER_INDEXED) {
+                fs_hpack_write_integer(p, 0x80, 7, FS_HPACK_STATIC_COUNT + i + 1);
+                return true;
+            }
+            if (!name_index) {
+                name_index = FS_HPACK_STATIC_COUNT + i + 1;
+            }
+        }
+    }
+    // A field that would take half the table would evict what is worth keeping.
+    if (mode == FS_HPACK_INDEXED && (name_length + value_length + FS_HPACK_ENTRY_OVERHEAD) * 2 > table->max_size) {
+        mode = FS_HPACK_UNINDEXED;
+    }
+    if (mode == FS_HPACK_INDEXED) {
+        fs_hpack_write_integer(p, 0x40, 6, name_index);
+    } else {
+        fs_hpack_write_integer(p, mode == FS_HPACK_NEVER_INDEXED ? 0x10 : 0x00, 4, name_index);
+    }
+    if (!name_index) {
+        fs_hpack_write_integer(p, 0x00, 7, name_length);
+        memcpy(*p, name, name_length);
+        *p += name_length;
+    }
+    fs_hpack_write_integer(p, 0x00, 7, value_length);
+    memcpy(*p, value, value_length);
+    *p += value_length;
+    return mode != FS_HPACK_INDEXED ||
+           fs_hpack_add(table, (const uint8_t*)name, name_length, (const uint8_t*)value, value_length);
+}
+
+static void fs_http_call_free(fs_http_call_t* call) {
+    free(call->storage);
+    free(call->header_bytes.data);
+    free(call->body_bytes.data);
+    free(call);
+}
+
+static void fs_http_fail(fs_http_call_t* call, fs_error_t error) {
+    call->completion(call->context, error, NULL);
+    fs_http_call_free(call);
+}
+
+static void fs_http_complete(fs_http_call_t* call) {
+    fs_http_header_t* headers = NULL;
+    fs_http_response_t response = {
+        .status = call->status,
+        .body = call->body_bytes.data,
+        .body_length = call->body_bytes.length,
+    };
+    
+    if (call->response_header_count) {
+        const char* p = (const char*)call->header_bytes.data;
+        
+        headers = malloc(call->response_header_count * sizeof(*headers));
+        if (!headers) {
+            fs_http_fail(call, FS_ERROR_OUT_OF_MEMORY);
+            return;
+        }
+        for (size_t i = 0; i < call->response_header_count; i++) {
+            headers[i].name = p;
+            p += strlen(p) + 1;
+            headers[i].value = p;
+            p += strlen(p) + 1;
+        }
+    }
+    response.headers = headers;
+    response.header_count = call->response_header_count;
+    call->completion(call->context, FS_ERROR_NONE, &response);
+    free(headers);
+    fs_http_call_free(call);
+}
+
+/* Forgets the response so far, before a retry. */
+static void fs_http_call_reset(fs_http_call_t* call) {
+    call->next = NULL;
+    call->h2 = NULL;
+    call->id = 0;
+    call->body_sent = 0;
+    call->receive_unacked = 0;
+    call->responded = false;
+    call->final = false;
+    call->headers_too_large = false;
+    call->status = 0;
+    call->header_bytes.length = 0;
+    call->response_header_count = 0;
+    call->body_bytes.length = 0;
+}
+
+static void fs_http_enqueue(fs_http_client_t* client, fs_http_call_t* call) {
+    call->next = NULL;
+    *client->pending_tail = call;
+    client->pending_tail = &call->next;
+}
+
+static void fs_h2_frame(fs_h2_conn_t* h2, size_t length, uint8_t type, uint8_t flags, uint32_t stream,
+                        const void* payload) {
+    uint8_t* p;
+    
+    if (!fs_http_reserve(&h2->out, FS_H2_FRAME_HEADER + length)) {
+        h2->broken = true;
+        return;
+    }
+    p = h2->out.data + h2->out.length;
+    p[0] = (uint8_t)(length >> 16);
+    p[1] = (uint8_t)(length >> 8);
+    p[2] = (uint8_t)length;
+    p[3] = type;
+    p[4] = flags;
+    fs_h2_store32(p + 5, stream & FS_H2_MAX_STREAM_ID);
+    if (length) {
+        memcpy(p + FS_H2_FRAME_HEADER, payload, length);
+    }
+    h2->out.length += FS_H2_FRAME_HEADER + length;
+}
+
+static void fs_h2_frame32(fs_h2_conn_t* h2, uint8_t type, uint32_t stream, uint32_t value) {
+    uint8_t payload[4];
+    
+    fs_h2_store32(payload, value);
+    fs_h2_frame(h2, sizeof(payload), type, 0, stream, payload);
+}
+
+static fs_http_call_t* fs_h2_stream(fs_h2_conn_t* h2, uint32_t id) {
+    for (fs_http_call_t* call = h2->streams; call; call = call->next) {
+        if (call->id == id) {
+            return call;
+        }
+    }
+    return NULL;
+}
+
+/* Ends a stream, giving its place on the connection back. */
+static void fs_h2_unlink(fs_h2_conn_t* h2, fs_http_call_t* call) {
+    for (fs_http_call_t** link = &h2->streams; *link; link = &(*link)->next) {
+        if (*link == call) {
+            *link = call->next;
+            break;
+        }
+    }
+    call->next = NULL;
+    call->h2 = NULL;
+    fs_net_pool_release(h2->client->pool, h2->conn, h2->client->now);
+}
+
+/* Retries a request that provably did not reach the server, or fails it. */
+static void fs_http_retry(fs_http_client_t* client, fs_http_call_t* call, fs_error_t error) {
+    if (client->destroying || call->attempts >= FS_HTTP_ATTEMPTS) {
+        fs_http_fail(call, error);
+        return;
+    }
+    fs_http_call_reset(call);
+    fs_http_enqueue(client, call);
+}
+
+static void fs_h2_reset(fs_h2_conn_t* h2, fs_http_call_t* call, uint32_t code, fs_error_t error) {
+    fs_h2_frame32(h2, FS_H2_RST_STREAM, call->id, code);
+    fs_h2_unlink(h2, call);
+    fs_http_fail(call, error);
+}
+
+static void fs_h2_update_capacity(fs_h2_conn_t* h2) {
+    bool retired = h2->goaway || h2->next_id > FS_H2_MAX_STREAM_ID;
+    
+    fs_net_conn_set_capacity(h2->conn, retired ? 0 : h2->max_streams);
+}
+
+/* Sends request bodies as far as the flow-control windows allow. */
+static void fs_h2_send_data(fs_h2_conn_t* h2) {
+    for (fs_http_call_t* call = h2->streams; call && h2->send_window > 0; call = call->next) {
+        while (call->body_sent < call->body_length && call->send_window > 0 && h2->send_window > 0) {
+            size_t length = call->body_length - call->body_sent;
+            bool last;
+            
+            if (length > h2->peer_max_frame) {
+                length = h2->peer_max_frame;
+            }
+            if ((int64_t)length > call->send_window) {
+                length = (size_t)call->send_window;
+            }
+            if ((int64_t)length > h2->send_window) {
+                length = (size_t)h2->send_window;
+            }
+            last = call->body_sent + length == call->body_length;
+            fs_h2_frame(h2, length, FS_H2_DATA, last ? FS_H2_END_STREAM : 0, call->id, call->body + call->body_sent);
+            call->body_sent += length;
+            call->send_window -= (int64_t)length;
+            h2->send_window -= (int64_t)length;
+        }
+    }
+}
+
+static bool fs_http_sensitive(const char* name) {
+    return strcmp(name, "authorization") == 0 || strcmp(name, "proxy-authorization") == 0 ||
+           strcmp(name, "cookie") == 0;
+}
+
+/* Makes `call` a stream on `h2` and writes its headers and as much of its body as fits. */
+static void fs_h2_start(fs_h2_conn_t* h2, fs_http_call_t* call) {
+    fs_http_buffer_t* encoded = &h2->client->encoded;
+    size_t bound = 4 * FS_HPACK_FIELD_OVERHEAD + FS_HPACK_FIELD_OVERHEAD + 64 +
+                   strlen(call->method) + strlen(call->authority) + strlen(call->path);
+    char length_value[24];
+    uint8_t* p;
+    size_t offset;
+    bool stored = true;
+    
+    call->h2 = h2;
+    call->id = h2->next_id;
+    call->attempts++;
+    call->send_window = h2->peer_initial_window;
+    h2->next_id += 2;
+    fs_h2_update_capacity(h2);
+    call->next = h2->streams;
+    h2->streams = call;
+    
+    for (size_t i = 0; i < call->header_count; i++) {
+        bound += strlen(call->headers[i].name) + strlen(call->headers[i].value) + FS_HPACK_FIELD_OVERHEAD;
+    }
+    encoded->length = 0;
+    if (!fs_http_reserve(encoded, bound)) {
+        h2->broken = true;
+        return;
+    }
+    p = encoded->data;
+    if (h2->encoder_resized) {
+        fs_hpack_write_integer(&p, 0x20, 5, h2->encoder.max_size);
+        h2->encoder_resized = false;
+    }
+    stored &= fs_hpack_encode(&h2->encoder, &p, ":method", 7, call->method, strlen(call->method), FS_HPACK_INDEXED);
+    stored &= fs_hpack_encode(&h2->encoder, &p, ":scheme", 7, "http", 4, FS_HPACK_INDEXED);
+    stored &= fs_hpack_encode(&h2->encoder, &p, ":authority", 10, call->authority, strlen(call->authority),
+                              FS_HPACK_INDEXED);
+    stored &= fs_hpack_encode(&h2->encoder, &p, ":path", 5, call->path, strlen(call->path), FS_HPACK_UNINDEXED);
+    for (size_t i = 0; i < call->header_count; i++) {
+        const fs_http_header_t* header = &call->headers[i];
+        size_t value_length = strlen(header->value);
+        fs_hpack_mode_t mode = FS_HPACK_INDEXED;
+        
+        if (strcmp(header->name, "content-length") == 0) {
+            mode = FS_HPACK_UNINDEXED;
+        } else if (fs_http_sensitive(header->name) && value_length < FS_HPACK_SENSITIVE_SHORT) {
+            mode = FS_HPACK_NEVER_INDEXED;
+        }
+        stored &= fs_hpack_encode(&h2->encoder, &p, header->name, strlen(header->name), header->value, value_length,
+                                  mode);
+    }
+    if (call->body_length && !call->has_length) {
+        int length = snprintf(length_value, sizeof(length_value), "%zu", call->body_length);
+        
+        stored &= fs_hpack_encode(&h2->encoder, &p, "content-length", 14, length_value, (size_t)length,
+                                  FS_HPACK_UNINDEXED);
+    }
+    if (!stored) {
+        // The encoder's table no longer matches what the server decodes.
+        h2->broken = true;
+        return;
+    }
+    encoded->length = (size_t)(p - encoded->data);
+    
+    // HEADERS, then CONTINUATION frames for whatever did not fit.
+    offset = 0;
+    do {
+        size_t length = encoded->length - offset;
+        uint8_t flags = 0;
+        
+        if (length > h2->peer_max_frame) {
+            length = h2->peer_max_frame;
+        }
+        if (offset + length == encoded->length) {
+            flags |= FS_H2_END_HEADERS;
+        }
+        if (!offset && !call->body_length) {
+            flags |= FS_H2_END_STREAM;
+        }
+        fs_h2_frame(h2, length, offset ? FS_H2_CONTINUATION : FS_H2_HEADERS, flags, call->id, encoded->data + offset);
+        offset += length;
+    } while (offset < encoded->length);
+    fs_h2_send_data(h2);
+}
+
+static fs_h2_conn_t* fs_h2_create(fs_http_client_t* client, fs_net_conn_t* conn, const fs_http_call_t* call) {
+    fs_h2_conn_t* h2 = calloc(1, sizeof(*h2));
+    uint8_t settings[18];
+    
+    if (!h2 || !(h2->host = strdup(call->host))) {
+        free(h2);
+        return NULL;
+    }
+    h2->client = client;
+    h2->conn = conn;
+    h2->port = call->port;
+    h2->next_id = 1;
+    h2->max_streams = FS_H2_DEFAULT_STREAMS;
+    // A server that allows fewer streams would refuse the excess until its settings arrive.
+    for (fs_h2_conn_t* other = client->conns; other; other = other->next) {
+        if (other->settled && other->port == h2->port && strcmp(other->host, h2->host) == 0) {
+            h2->max_streams = other->max_streams;
+            break;
+        }
+    }
+    h2->send_window = FS_H2_DEFAULT_WINDOW;
+    h2->peer_initial_window = FS_H2_DEFAULT_WINDOW;
+    h2->peer_max_frame = FS_H2_MAX_FRAME;
+    h2->encoder.max_size = FS_HPACK_TABLE_SIZE;
+    h2->decoder.max_size = FS_HPACK_TABLE_SIZE;
+    
+    // The preface, no server push, and receive windows that keep responses flowing.
+    settings[0] = 0;
+    settings[1] = FS_H2_SETTINGS_ENABLE_PUSH;
+    fs_h2_store32(settings + 2, 0);
+    settings[6] = 0;
+    settings[7] = FS_H2_SETTINGS_INITIAL_WINDOW_SIZE;
+    fs_h2_store32(settings + 8, FS_H2_STREAM_WINDOW);
+    settings[12] = 0;
+    settings[13] = FS_H2_SETTINGS_MAX_HEADER_LIST_SIZE;
+    fs_h2_store32(settings + 14, (uint32_t)FS_H2_MAX_HEADER_LIST);
+    fs_http_append(&h2->out, fs_h2_preface, sizeof(fs_h2_preface));
+    fs_h2_frame(h2, sizeof(settings), FS_H2_SETTINGS, 0, 0, settings);
+    fs_h2_frame32(h2, FS_H2_WINDOW_UPDATE, 0, FS_H2_CONN_WINDOW - FS_H2_DEFAULT_WINDOW);
+    if (h2->broken || h2->out.length != sizeof(fs_h2_preface) + 2 * FS_H2_FRAME_HEADER + sizeof(settings) + 4) {
+        free(h2->out.data);
+        free(h2->host);
+        free(h2);
+        return NULL;
+    }
+    fs_net_conn_set_context(conn, h2);
+    fs_h2_update_capacity(h2);
+    h2->next = client->conns;
+    client->conns = h2;
+    return h2;
+}
+
+/*
+ Drops a connection and what was on it. Requests the server never saw, or
+ idempotent ones with no response yet, go back to the queue.
+ */
+static void fs_h2_teardown(fs_h2_conn_t* h2, fs_error_t error, bool close) {
+    fs_http_client_t* client = h2->client;
+    fs_http_call_t* streams = h2->streams;
+    bool opened = h2->opened;
+    
+    for (fs_h2_conn_t** link = &client->conns; *link; link = &(*link)->next) {
+        if (*link == h2) {
+            *link = h2->next;
+            break;
+        }
+    }
+    fs_net_conn_set_context(h2->conn, NULL);
+    if (close) {
+        fs_net_conn_close(h2->conn);
+    }
+    fs_hpack_clear(&h2->encoder);
+    fs_hpack_clear(&h2->decoder);
+    free(h2->out.data);
+    free(h2->block.data);
+    free(h2->host);
+    free(h2);
+    
+    while (streams) {
+        fs_http_call_t* call = streams;
+        
+        streams = call->next;
+        if (opened && !call->responded && call->idempotent) {
+            fs_http_retry(client, call, error);
+        } else {
+            fs_http_fail(call, error);
+        }
+    }
+}
+
+/* Hands the frames written so far to the connection. */
+static bool fs_h2_flush(fs_h2_conn_t* h2) {
+    struct iovec iov;
+    
+    if (h2->broken) {
+        fs_h2_teardown(h2, FS_ERROR_OUT_OF_MEMORY, true);
+        return false;
+    }
+    if (!h2->out.length) {
+        return true;
+    }
+    iov.iov_base = h2->out.data;
+    iov.iov_len = h2->out.length;
+    h2->out.length = 0;
+    if (fs_net_conn_writev(h2->conn, &iov, 1) != FS_ERROR_NONE) {
+        fs_h2_teardown(h2, FS_ERROR_IO, true);
+        return false;
+    }
+    return true;
+}
+
+/* A connection error: says why with GOAWAY and drops the connection. */
+static bool fs_h2_fail(fs_h2_conn_t* h2, uint32_t code) {
+    uint8_t payload[8];
+    
+    fs_h2_store32(payload, 0);
+    fs_h2_store32(payload + 4, code);
+    h2->out.length = 0;
+    h2->broken = false;
+    fs_h2_frame(h2, sizeof(payload), FS_H2_GOAWAY, 0, 0, payload);
+    if (fs_h2_flush(h2)) {
+        fs_h2_teardown(h2, FS_ERROR_IO, true);
+    }
+    return false;
+}
+
+/* Adds a decoded field to the response of `call`, if any. */
+static void fs_http_call_field(fs_http_call_t* call, const uint8_t* name, size_t name_length,
+                               const uint8_t* value, size_t value_length) {
+    if (!call) {
+        return;
+    }
+    if (name_length && name[0] == ':') {
+        if (name_length == 7 && memcmp(name, ":status", 7) == 0 && value_length == 3 &&
+            value[0] >= '1' && value[0] <= '9' && value[1] >= '0' && value[1] <= '9' &&
+            value[2] >= '0' && value[2] <= '9') {
+            call->status = (value[0] - '0') * 100 + (value[1] - '0') * 10 + (value[2] - '0');
+        }
+        return;
+    }
+    if (call->header_bytes.length + name_length + value_length + 2 > FS_H2_MAX_HEADER_LIST ||
+        !fs_http_reserve(&call->header_bytes, name_length + value_length + 2)) {
+        call->headers_too_large = true;
+        return;
+    }
+    fs_http_append(&call->header_bytes, name, name_length);
+    fs_http_append(&call->header_bytes, "", 1);
+    fs_http_append(&call->header_bytes, value, value_length);
+    fs_http_append(&call->header_bytes, "", 1);
+    call->response_header_count++;
+}
+
+/* Decodes a header block; every block is decoded, even for forgotten streams, to keep the table in step. */
+static bool fs_hpack_decode(fs_h2_conn_t* h2, fs_http_call_t* call, const uint8_t* p, size_t length) {
+    fs_http_buffer_t* scratch = &h2->client->scratch;
+    const uint8_t* end = p + length;
+    
+    while (p < end) {
+        uint8_t byte = *p;
+        const uint8_t* name;
+        const uint8_t* value;
+        size_t name_length, value_length, index;
+        
+        if (byte & 0x80) {
+            if (!fs_hpack_read_integer(&p, end, 7, &index) ||
+                !fs_hpack_get(&h2->decoder, index, &name, &name_length, &value, &value_length)) {
+                return false;
+            }
+            fs_http_call_field(call, name, name_length, value, value_length);
+            continue;
+        }
+        if ((byte & 0xE0) == 0x20) {
+            if (!fs_hpack_read_integer(&p, end, 5, &index) || index > FS_HPACK_TABLE_SIZE) {
+                return false;
+            }
+            fs_hpack_resize(&h2->decoder, index);
+            continue;
+        }
+        bool indexing = (byte & 0xC0) == 0x40;
+        
+        if (!fs_hpack_read_integer(&p, end, indexing ? 6 : 4, &index)) {
+            return false;
+        }
+        scratch->length = 0;
+        if (index) {
+            if (!fs_hpack_get(&h2->decoder, index, &name, &name_length, &value, &value_length) ||
+                !fs_http_append(scratch, name, name_length)) {
+                return false;
+            }
+        } else if (!fs_hpack_read_string(scratch, &p, end)) {
+            return false;
+        }
+        name_length = scratch->length;
+        if (!fs_hpack_read_string(scratch, &p, end)) {
+            return false;
+        }
+        value_length = scratch->length - name_length;
+        fs_http_call_field(call, scratch->data, name_length, scratch->data + name_length, value_length);
+        if (indexing && !fs_hpack_add(&h2->decoder, scratch->data, name_length, scratch->data + name_length,
+                                      value_length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool fs_h2_header_block(fs_h2_conn_t* h2, uint32_t id, uint8_t flags, const uint8_t* block, size_t length) {
+    fs_http_call_t* call = fs_h2_stream(h2, id);
+    
+    if (!fs_hpack_decode(h2, call, block, length)) {
+        return fs_h2_fail(h2, FS_H2_COMPRESSION_ERROR);
+    }
+    if (!call) {
+        return true;
+    }
+    call->responded = true;
+    if (call->headers_too_large) {
+        fs_h2_reset(h2, call, FS_H2_CANCEL, FS_ERROR_NOT_SUPPORTED);
+        return true;
+    }
+    if (!call->final) {
+        if (call->status >= 100 && call->status < 200 && !(flags & FS_H2_END_STREAM)) {
+            // Informational; the final headers follow.
+            call->status = 0;
+            call->header_bytes.length = 0;
+            call->response_header_count = 0;
+            return true;
+        }
+        if (call->status < 200) {
+            fs_h2_reset(h2, call, FS_H2_PROTOCOL_ERROR, FS_ERROR_IO);
+            return true;
+        }
+        call->final = true;
+    } else if (!(flags & FS_H2_END_STREAM)) {
+        // Trailers must end the stream.
+        fs_h2_reset(h2, call, FS_H2_PROTOCOL_ERROR, FS_ERROR_IO);
+        return true;
+    }
+    if (flags & FS_H2_END_STREAM) {
+        fs_h2_unlink(h2, call);
+        fs_http_complete(call);
+    }
+    return true;
+}
+
+static bool fs_h2_data(fs_h2_conn_t* h2, uint32_t id, uint8_t flags, const uint8_t* payload, size_t length) {
+    fs_http_call_t* call;
+    size_t data_length = length;
+    
+    if (!id) {
+        return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+    }
+    if (flags & FS_H2_PADDED) {
+        if (!length || payload[0] >= length) {
+            return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+        }
+        data_length = length - 1 - payload[0];
+        payload++;
+    }
+    // Padding counts against the windows too.
+    h2->receive_unacked += (uint32_t)length;
+    if (h2->receive_unacked >= FS_H2_CONN_WINDOW / 2) {
+        fs_h2_frame32(h2, FS_H2_WINDOW_UPDATE, 0, h2->receive_unacked);
+        h2->receive_unacked = 0;
+    }
+    call = fs_h2_stream(h2, id);
+    if (!call) {
+        return true;
+    }
+    if (!call->final) {
+        fs_h2_reset(h2, call, FS_H2_PROTOCOL_ERROR, FS_ERROR_IO);
+        return true;
+    }
+    if (call->body_bytes.length + data_length > h2->client->max_response ||
+        !fs_http_append(&call->body_bytes, payload, data_length)) {
+        fs_h2_reset(h2, call, FS_H2_CANCEL, FS_ERROR_NOT_SUPPORTED);
+        return true;
+    }
+    if (flags & FS_H2_END_STREAM) {
+        fs_h2_unlink(h2, call);
+        fs_http_complete(call);
+        return true;
+    }
+    call->receive_unacked += (uint32_t)length;
+    if (call->receive_unacked >= FS_H2_STREAM_WINDOW / 2) {
+        fs_h2_frame32(h2, FS_H2_WINDOW_UPDATE, id, call->receive_unacked);
+        call->receive_unacked = 0;
+    }
+    return true;
+}
+
+static bool fs_h2_settings(fs_h2_conn_t* h2, uint8_t flags, const uint8_t* payload, size_t length) {
+    if (flags & FS_H2_ACK) {
+        return length ? fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR) : true;
+    }
+    if (length % 6) {
+        return fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR);
+    }
+    for (size_t i = 0; i < length; i += 6) {
+        uint16_t setting = (uint16_t)(payload[i] << 8 | payload[i + 1]);
+        uint32_t value = fs_h2_load32(payload + i + 2);
+        
+        switch (setting) {
+            case FS_H2_SETTINGS_HEADER_TABLE_SIZE:
+                if (value > FS_HPACK_TABLE_SIZE) {
+                    value = FS_HPACK_TABLE_SIZE;
+                }
+                if (value != h2->encoder.max_size) {
+                    fs_hpack_resize(&h2->encoder, value);
+                    h2->encoder_resized = true;
+                }
+                break;
+            case FS_H2_SETTINGS_MAX_CONCURRENT_STREAMS:
+                h2->max_streams = value;
+                fs_h2_update_capacity(h2);
+                break;
+            case FS_H2_SETTINGS_INITIAL_WINDOW_SIZE:
+                if (value > FS_H2_MAX_WINDOW) {
+                    return fs_h2_fail(h2, FS_H2_FLOW_CONTROL_ERROR);
+                }
+                // Applies to open streams too.
+                for (fs_http_call_t* call = h2->streams; call; call = call->next) {
+                    call->send_window += (int64_t)value - (int64_t)h2->peer_initial_window;
+                }
+                h2->peer_initial_window = value;
+                break;
+            case FS_H2_SETTINGS_MAX_FRAME_SIZE:
+                if (value < FS_H2_MAX_FRAME || value > FS_H2_MAX_FRAME_LIMIT) {
+                    return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+                }
+                h2->peer_max_frame = value;
+                break;
+            default:
+                break;
+        }
+    }
+    h2->settled = true;
+    fs_h2_frame(h2, 0, FS_H2_SETTINGS, FS_H2_ACK, 0, NULL);
+    fs_h2_send_data(h2);
+    return true;
+}
+
+static bool fs_h2_goaway(fs_h2_conn_t* h2, const uint8_t* payload, size_t length) {
+    fs_http_client_t* client = h2->client;
+    uint32_t last;
+    
+    if (length < 8) {
+        return fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR);
+    }
+    last = fs_h2_load32(payload) & FS_H2_MAX_STREAM_ID;
+    h2->goaway = true;
+    fs_h2_update_capacity(h2);
+    // Streams above the last one the server processed can go elsewhere.
+    for (fs_http_call_t* call = h2->streams, *next; call; call = next) {
+        next = call->next;
+        if (call->id > last) {
+            fs_h2_unlink(h2, call);
+            fs_http_retry(client, call, FS_ERROR_IO);
+        }
+    }
+    return true;
+}
+
+static bool fs_h2_window_update(fs_h2_conn_t* h2, uint32_t id, const uint8_t* payload, size_t length) {
+    uint32_t increment;
+    
+    if (length != 4) {
+        return fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR);
+    }
+    increment = fs_h2_load32(payload) & FS_H2_MAX_WINDOW;
+    if (!id) {
+        if (!increment) {
+            return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+        }
+        h2->send_window += increment;
+        if (h2->send_window > FS_H2_MAX_WINDOW) {
+            return fs_h2_fail(h2, FS_H2_FLOW_CONTROL_ERROR);
+        }
+    } else {
+        fs_http_call_t* call = fs_h2_stream(h2, id);
+        
+        if (!call) {
+            return true;
+        }
+        if (!increment) {
+            fs_h2_reset(h2, call, FS_H2_PROTOCOL_ERROR, FS_ERROR_IO);
+            return true;
+        }
+        call->send_window += increment;
+        if (call->send_window > FS_H2_MAX_WINDOW) {
+            fs_h2_reset(h2, call, FS_H2_FLOW_CONTROL_ERROR, FS_ERROR_IO);
+            return true;
+        }
+    }
+    fs_h2_send_data(h2);
+    return true;
+}
+
+/* Handles one frame; returns false when the connection is gone. */
+static bool fs_h2_receive_frame(fs_h2_conn_t* h2, uint8_t type, uint8_t flags, uint32_t id,
+                                const uint8_t* payload, size_t length) {
+    if (h2->in_block && (type != FS_H2_CONTINUATION || id != h2->block_stream)) {
+        return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+    }
+    switch (type) {
+        case FS_H2_DATA:
+            return fs_h2_data(h2, id, flags, payload, length);
+        case FS_H2_HEADERS: {
+            size_t skip = 0, padding = 0;
+            
+            if (!id) {
+                return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+            }
+            if (flags & FS_H2_PADDED) {
+                if (!length) {
+                    return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+                }
+                padding = payload[0];
+                skip = 1;
+            }
+            if (flags & FS_H2_PRIORITY) {
+                skip += 5;
+            }
+            if (skip + padding > length) {
+                return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+            }
+            payload += skip;
+            length -= skip + padding;
+            if (flags & FS_H2_END_HEADERS) {
+                return fs_h2_header_block(h2, id, flags, payload, length);
+            }
+            h2->in_block = true;
+            h2->block_stream = id;
+            h2->block_flags = flags;
+            h2->block.length = 0;
+            if (!fs_http_append(&h2->block, payload, length)) {
+                return fs_h2_fail(h2, FS_H2_COMPRESSION_ERROR);
+            }
+            return true;
+        }
+        case FS_H2_CONTINUATION:
+            if (!h2->in_block) {
+                return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+            }
+            if (h2->block.length + length > FS_H2_MAX_HEADER_BLOCK || !fs_http_append(&h2->block, payload, length)) {
+                return fs_h2_fail(h2, FS_H2_COMPRESSION_ERROR);
+            }
+            if (flags & FS_H2_END_HEADERS) {
+                h2->in_block = false;
+                return fs_h2_header_block(h2, id, h2->block_flags, h2->block.data, h2->block.length);
+            }
+            return true;
+        case FS_H2_RST_STREAM: {
+            fs_http_call_t* call;
+            
+            if (length != 4) {
+                return fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR);
+            }
+            if (!id) {
+                return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+            }
+            call = fs_h2_stream(h2, id);
+            if (call) {
+                fs_h2_unlink(h2, call);
+                if (fs_h2_load32(payload) == FS_H2_REFUSED_STREAM) {
+                    fs_http_retry(h2->client, call, FS_ERROR_CANCELLED);
+                } else {
+                    fs_http_fail(call, FS_ERROR_CANCELLED);
+                }
+            }
+            return true;
+        }
+        case FS_H2_SETTINGS:
+            return id ? fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR) : fs_h2_settings(h2, flags, payload, length);
+        case FS_H2_PUSH_PROMISE:
+            // Push was turned off in the preface.
+            return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+        case FS_H2_PING:
+            if (length != 8) {
+                return fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR);
+            }
+            if (id) {
+                return fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR);
+            }
+            if (!(flags & FS_H2_ACK)) {
+                fs_h2_frame(h2, length, FS_H2_PING, FS_H2_ACK, 0, payload);
+            }
+            return true;
+        case FS_H2_GOAWAY:
+            return id ? fs_h2_fail(h2, FS_H2_PROTOCOL_ERROR) : fs_h2_goaway(h2, payload, length);
+        case FS_H2_WINDOW_UPDATE:
+            return fs_h2_window_update(h2, id, payload, length);
+        default:
+            // PRIORITY, and frame types this client does not know, are ignored.
+            return true;
+    }
+}
+
+/* Moves queued requests onto connections with room; those that cannot get one fail afterwards. */
+static void fs_http_dispatch(fs_http_client_t* client) {
+    fs_http_call_t** link = &client->pending;
+    fs_http_call_t* failed = NULL;
+    
+    while (*link) {
+        fs_http_call_t* call = *link;
+        fs_net_conn_t* conn;
+        fs_h2_conn_t* h2;
+        fs_error_t error = fs_net_pool_acquire(client->pool, call->host, call->port, client->now, &conn);
+        
+        if (error == FS_ERROR_NONE && !conn) {
+            link = &call->next;
+            continue;
+        }
+        *link = call->next;
+        if (error == FS_ERROR_NONE) {
+            h2 = fs_net_conn_context(conn);
+            if (!h2 && !(h2 = fs_h2_create(client, conn, call))) {
+                fs_net_conn_close(conn);
+                error = FS_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        if (error != FS_ERROR_NONE) {
+            call->error = error;
+            call->next = failed;
+            failed = call;
+            continue;
+        }
+        fs_h2_start(h2, call);
+    }
+    client->pending_tail = link;
+    while (failed) {
+        fs_http_call_t* call = failed;
+        
+        failed = call->next;
+        fs_http_fail(call, call->error);
+    }
+}
+
+static void fs_http_opened(void* context, fs_net_conn_t* conn) {
+    fs_h2_conn_t* h2 = fs_net_conn_context(conn);
+    
+    (void)context;
+    if (h2) {
+        h2->opened = true;
+    }
+}
+
+static void fs_http_received(void* context, fs_net_conn_t* conn, fs_net_ring_t* ring) {
+    fs_http_client_t* client = context;
+    fs_h2_conn_t* h2 = fs_net_conn_context(conn);
+    uint8_t* p;
+    size_t available;
+    
+    if (!h2) {
+        fs_net_conn_close(conn);
+        return;
+    }
+    while ((available = fs_net_ring_read_span(ring, &p)) >= FS_H2_FRAME_HEADER) {
+        size_t length = (size_t)p[0] << 16 | (size_t)p[1] << 8 | p[2];
+        
+        if (length > FS_H2_MAX_FRAME) {
+            fs_h2_fail(h2, FS_H2_FRAME_SIZE_ERROR);
+            fs_http_dispatch(client);
+            return;
+        }
+        if (available < FS_H2_FRAME_HEADER + length) {
+            break;
+        }
+        if (!fs_h2_receive_frame(h2, p[3], p[4], fs_h2_load32(p + 5) & FS_H2_MAX_STREAM_ID,
+                                 p + FS_H2_FRAME_HEADER, length)) {
+            fs_http_dispatch(client);
+            return;
+        }
+        fs_net_ring_consume(ring, FS_H2_FRAME_HEADER + length);
+    }
+    // Settings acks, pings and window updates go out now; finished streams made room for queued requests.
+    if (fs_h2_flush(h2) && h2->goaway && !h2->streams) {
+        fs_h2_teardown(h2, FS_ERROR_IO, true);
+    }
+    fs_http_dispatch(client);
+}
+
+static void fs_http_closed(void* context, fs_net_conn_t* conn, fs_error_t error) {
+    fs_http_client_t* client = context;
+    fs_h2_conn_t* h2 = fs_net_conn_context(conn);
+    
+    if (!h2) {
+        return;
+    }
+    fs_h2_teardown(h2, error == FS_ERROR_NONE ? FS_ERROR_IO : error, false);
+    if (!client->destroying) {
+        fs_http_dispatch(client);
+    }
+}
+
+static const fs_net_conn_handler_t fs_http_conn_handler = {
+    .opened = fs_http_opened,
+    .received = fs_http_received,
+    .closed = fs_http_closed,
+};
+
+fs_error_t fs_http_client_create(fs_net_loop_t* loop, const fs_http_config_t* config, fs_http_client_t** out) {
+    fs_net_pool_config_t pool = { 0 };
+    fs_http_client_t* client;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!loop) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (config) {
+        pool = config->pool;
+    }
+    if (pool.ring_capacity && pool.ring_capacity < FS_HTTP_RING_MIN) {
+        pool.ring_capacity = FS_HTTP_RING_MIN;
+    }
+    client = calloc(1, sizeof(*client));
+    if (!client) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    client->loop = loop;
+    client->max_response = config && config->max_response ? config->max_response : FS_HTTP_MAX_RESPONSE;
+    client->timeout_ms = config && config->timeout_ms ? config->timeout_ms : FS_HTTP_TIMEOUT_MS;
+    client->pending_tail = &client->pending;
+    error = fs_net_pool_create(loop, &pool, &fs_http_conn_handler, client, &client->pool);
+    if (error != FS_ERROR_NONE) {
+        free(client);
+        return error;
+    }
+    *out = client;
+    return FS_ERROR_NONE;
+}
+
+void fs_http_client_destroy(fs_http_client_t* client) {
+    if (!client) {
+        return;
+    }
+    client->destroying = true;
+    while (client->conns) {
+        fs_h2_teardown(client->conns, FS_ERROR_CANCELLED, true);
+    }
+    while (client->pending) {
+        fs_http_call_t* call = client->pending;
+        
+        client->pending = call->next;
+        fs_http_fail(call, FS_ERROR_CANCELLED);
+    }
+    fs_net_pool_destroy(client->pool);
+    free(client->scratch.data);
+    free(client->encoded.data);
+    free(client);
+}
+
+static bool fs_http_hop_by_hop(const char* name, const char* value) {
+    static const char* const names[] = {
+        "connection", "host", "keep-alive", "proxy-connection", "transfer-encoding", "upgrade",
+    };
+    
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return true;
+        }
+    }
+    // Only "te: trailers" is allowed (RFC 9113, section 8.2.2).
+    return strcmp(name, "te") == 0 && strcmp(value, "trailers") != 0;
+}
+
+static bool fs_http_idempotent(const char* method) {
+    static const char* const methods[] = { "GET", "HEAD", "PUT", "DELETE", "OPTIONS", "TRACE" };
+    
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strcmp(method, methods[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Copies a request into one allocation: the header array, then the strings, then the body. */
+static fs_http_call_t* fs_http_call_create(const fs_http_request_t* request) {
+    fs_http_call_t* call = calloc(1, sizeof(*call));
+    size_t strings, host_length = strlen(request->host);
+    bool bracket = strchr(request->host, ':') != NULL;      // an IPv6 literal
+    fs_http_header_t* headers;
+    char* p;
+    
+    if (!call) {
+        return NULL;
+    }
+    // Host, method, path, and the authority with brackets, a colon and up to five digits.
+    strings = host_length + 1 + strlen(request->method) + 1 + strlen(request->path) + 1 + host_length + 9;
+    for (size_t i = 0; i < request->header_count; i++) {
+        strings += strlen(request->headers[i].name) + 1 + strlen(request->headers[i].value) + 1;
+    }
+    call->storage = malloc(request->header_count * sizeof(fs_http_header_t) + strings + request->body_length);
+    if (!call->storage) {
+        free(call);
+        return NULL;
+    }
+    headers = call->storage;
+    p = (char*)(headers + request->header_count);
+    call->host = p;
+    p += sprintf(p, "%s", request->host) + 1;
+    call->port = request->port;
+    call->method = p;
+    p += sprintf(p, "%s", request->method) + 1;
+    call->path = p;
+    p += sprintf(p, "%s", request->path) + 1;
+    call->authority = p;
+    p += sprintf(p, bracket ? "[%s]" : "%s", request->host);
+    p += (request->port != 80 ? sprintf(p, ":%u", (unsigned)request->port) : 0) + 1;
+    call->headers = headers;
+    for (size_t i = 0; i < request->header_count; i++) {
+        char* name = p;
+        
+        for (const char* s = request->headers[i].name; *s; s++) {
+            *p++ = (*s >= 'A' && *s <= 'Z') ? (char)(*s - 'A' + 'a') : *s;
+        }
+        *p++ = '\0';
+        if (fs_http_hop_by_hop(name, request->headers[i].value)) {
+            p = name;
+            continue;
+        }
+        call->has_length |= strcmp(name, "content-length") == 0;
+        headers[call->header_count].name = name;
+        headers[call->header_count].value = p;
+        p += sprintf(p, "%s", request->headers[i].value) + 1;
+        call->header_count++;
+    }
+    if (request->body_length) {
+        memcpy(p, request->body, request->body_length);
+        call->body = (const uint8_t*)p;
+        call->body_length = request->body_length;
+    }
+    call->idempotent = fs_http_idempotent(request->method);
+    return call;
+}
+
+fs_error_t fs_http_client_send(fs_http_client_t* client, const fs_http_request_t* request, uint64_t now_ms,
+                               fs_http_completion_t completion, void* context) {
+    fs_http_call_t* call;
+    fs_net_conn_t* conn;
+    fs_h2_conn_t* h2;
+    fs_error_t error;
+    
+    if (!client || !request || !completion || !request->method || !*request->method || !request->host ||
+        !*request->host || !request->path || request->path[0] != '/' || (request->body_length && !request->body) ||
+        (request->header_count && !request->headers)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < request->header_count; i++) {
+        if (!request->headers[i].name || !*request->headers[i].name || request->headers[i].name[0] == ':' ||
+            !request->headers[i].value) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+    }
+    if (client->destroying) {
+        return FS_ERROR_CANCELLED;
+    }
+    call = fs_http_call_create(request);
+    if (!call) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    call->completion = completion;
+    call->context = context;
+    call->deadline = now_ms + (request->timeout_ms ? request->timeout_ms : client->timeout_ms);
+    client->now = now_ms;
+    
+    // Requests already waiting for the host go first.
+    for (fs_http_call_t* waiting = client->pending; waiting; waiting = waiting->next) {
+        if (waiting->port == call->port && strcmp(waiting->host, call->host) == 0) {
+            fs_http_enqueue(client, call);
+            return FS_ERROR_NONE;
+        }
+    }
+    error = fs_net_pool_acquire(client->pool, call->host, call->port, now_ms, &conn);
+    if (error != FS_ERROR_NONE) {
+        fs_http_call_free(call);
+        return error;
+    }
+    if (!conn) {
+        fs_http_enqueue(client, call);
+        return FS_ERROR_NONE;
+    }
+    h2 = fs_net_conn_context(conn);
+    if (!h2 && !(h2 = fs_h2_create(client, conn, call))) {
+        fs_net_conn_close(conn);
+        fs_http_call_free(call);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    fs_h2_start(h2, call);
+    return FS_ERROR_NONE;
+}
+
+void fs_http_client_poll(fs_http_client_t* client, uint64_t now_ms, uint64_t* deadline_ms) {
+    uint64_t deadline = UINT64_MAX, pool_deadline;
+    fs_http_call_t* expired = NULL;
+    
+    client->now = now_ms;
+    for (fs_h2_conn_t* h2 = client->conns, *next; h2; h2 = next) {
+        next = h2->next;
+        for (fs_http_call_t* call = h2->streams, *following; call; call = following) {
+            following = call->next;
+            if (now_ms >= call->deadline) {
+                fs_h2_frame32(h2, FS_H2_RST_STREAM, call->id, FS_H2_CANCEL);
+                fs_h2_unlink(h2, call);
+                call->next = expired;
+                expired = call;
+            } else if (call->deadline < deadline) {
+                deadline = call->deadline;
+            }
+        }
+        if (fs_h2_flush(h2) && h2->goaway && !h2->streams) {
+            fs_h2_teardown(h2, FS_ERROR_IO, true);
+        }
+    }
+    for (fs_http_call_t** link = &client->pending; *link;) {
+        fs_http_call_t* call = *link;
+        
+        if (now_ms >= call->deadline) {
+            *link = call->next;
+            call->next = expired;
+            expired = call;
+        } else {
+            if (call->deadline < deadline) {
+                deadline = call->deadline;
+            }
+            link = &call->next;
+        }
+    }
+    client->pending_tail = &client->pending;
+    while (*client->pending_tail) {
+        client->pending_tail = &(*client->pending_tail)->next;
+    }
+    while (expired) {
+        fs_http_call_t* call = expired;
+        
+        expired = call->next;
+        fs_http_fail(call, FS_ERROR_TIMEOUT);
+    }
+    fs_http_dispatch(client);
+    fs_net_pool_expire(client->pool, now_ms, &pool_deadline);
+    // Connections opened by the dispatch have their prefaces and requests written now.
+    for (fs_h2_conn_t* h2 = client->conns, *next; h2; h2 = next) {
+        next = h2->next;
+        fs_h2_flush(h2);
+    }
+    *deadline_ms = deadline < pool_deadline ? deadline : pool_deadline;
+}
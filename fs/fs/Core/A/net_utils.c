@@ -28,3 +28,165 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#if !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // memfd_create
+#endif
+
+#include <fs/netw.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+struct fs_net_ring {
+    uint8_t* base;              // `capacity` bytes, mapped again right after
+    size_t capacity;
+    size_t head;                // offset of the first unread byte, below `capacity`
+    size_t length;
+};
+
+#if defined(__APPLE__)
+
+static uint8_t* fs_net_ring_map(size_t capacity) {
+    vm_address_t base = 0, mirror;
+    vm_prot_t current, maximum;
+    
+    if (vm_allocate(mach_task_self(), &base, capacity * 2, VM_FLAGS_ANYWHERE) != KERN_SUCCESS) {
+        return NULL;
+    }
+    // Replace the second half with a second mapping of the first.
+    mirror = base + capacity;
+    if (vm_remap(mach_task_self(), &mirror, capacity, 0, VM_FLAGS_FIXED | VM_FLAGS_OVERWRITE, mach_task_self(),
+                 base, FALSE, &current, &maximum, VM_INHERIT_DEFAULT) != KERN_SUCCESS ||
+        mirror != base + capacity) {
+        vm_deallocate(mach_task_self(), base, capacity * 2);
+        return NULL;
+    }
+    return (uint8_t*)base;
+}
+
+static void fs_net_ring_unmap(uint8_t* base, size_t capacity) {
+    vm_deallocate(mach_task_self(), (vm_address_t)base, capacity * 2);
+}
+
+#elif defined(__linux__)
+
+static uint8_t* fs_net_ring_map(size_t capacity) {
+    int fd = memfd_create("fs_net_ring", MFD_CLOEXEC);
+    uint8_t* base;
+    
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)capacity) != 0) {
+        close(fd);
+        return NULL;
+    }
+    // Reserve both halves, then map the same pages over each.
+    base = mmap(NULL, capacity * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, capacity * 2);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    return base;
+}
+
+static void fs_net_ring_unmap(uint8_t* base, size_t capacity) {
+    munmap(base, capacity * 2);
+}
+
+#else
+
+static uint8_t* fs_net_ring_map(size_t capacity) {
+    (void)capacity;
+    return NULL;
+}
+
+static void fs_net_ring_unmap(uint8_t* base, size_t capacity) {
+    (void)base;
+    (void)capacity;
+}
+
+#endif
+
+fs_error_t fs_net_ring_create(size_t capacity, fs_net_ring_t** out) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    fs_net_ring_t* ring;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!capacity || capacity > SIZE_MAX / 2 - page) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+#if !defined(__APPLE__) && !defined(__linux__)
+    return FS_ERROR_NOT_SUPPORTED;
+#else
+    ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    ring->capacity = (capacity + page - 1) / page * page;
+    ring->base = fs_net_ring_map(ring->capacity);
+    if (!ring->base) {
+        free(ring);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    *out = ring;
+    return FS_ERROR_NONE;
+#endif
+}
+
+void fs_net_ring_destroy(fs_net_ring_t* ring) {
+    if (!ring) {
+        return;
+    }
+    fs_net_ring_unmap(ring->base, ring->capacity);
+    free(ring);
+}
+
+size_t fs_net_ring_capacity(const fs_net_ring_t* ring) {
+    return ring->capacity;
+}
+
+size_t fs_net_ring_write_span(fs_net_ring_t* ring, uint8_t** span) {
+    // Past the end of the first mapping the mirror continues the ring.
+    *span = ring->base + ring->head + ring->length;
+    return ring->capacity - ring->length;
+}
+
+void fs_net_ring_produce(fs_net_ring_t* ring, size_t length) {
+    ring->length += length <= ring->capacity - ring->length ? length : ring->capacity - ring->length;
+}
+
+size_t fs_net_ring_read_span(const fs_net_ring_t* ring, uint8_t** span) {
+    *span = ring->base + ring->head;
+    return ring->length;
+}
+
+void fs_net_ring_consume(fs_net_ring_t* ring, size_t length) {
+    if (length > ring->length) {
+        length = ring->length;
+    }
+    ring->head += length;
+    if (ring->head >= ring->capacity) {
+        ring->head -= ring->capacity;
+    }
+    ring->length -= length;
+    if (!ring->length) {
+        // An empty ring starts over at its first page, which is still in cache.
+        ring->head = 0;
+    }
+}
@@ -28,3 +28,693 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/netw.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#if !defined(__APPLE__)
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FS_WS_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FS_WS_NEON 1
+#endif
+
+#define FS_WS_FIN 0x80
+#define FS_WS_RSV1 0x40         // the message is compressed
+#define FS_WS_RSV23 0x30
+#define FS_WS_OPCODE 0x0F
+#define FS_WS_MASKED 0x80
+
+#define FS_WS_CONTINUATION 0
+#define FS_WS_HEADER_MAX 14
+#define FS_WS_CONTROL_MAX 125
+
+// Compression level for permessage-deflate: level 3 keeps most of the ratio at a fraction of the CPU of 6.
+#define FS_WS_DEFLATE_LEVEL 3
+
+// Every sync flush ends with this empty stored block, which the wire format leaves out.
+static const uint8_t fs_ws_deflate_tail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+} fs_ws_buffer_t;
+
+struct fs_ws {
+    fs_ws_role_t role;
+    bool deflate;
+    bool no_context_takeover;
+    size_t max_message;
+    fs_ws_writev_t writev;
+    void* context;
+    uint16_t close_code;
+    bool close_sent;
+    bool close_received;
+    
+    // The data frame being received when it did not arrive whole.
+    bool in_frame;
+    bool frame_fin;
+    uint64_t frame_remaining;
+    uint8_t mask[4];
+    size_t mask_offset;
+    
+    // The data message being gathered.
+    bool in_message;
+    bool compressed;
+    fs_ws_opcode_t opcode;
+    fs_ws_buffer_t message;
+    
+    z_stream inflater;
+    z_stream deflater;
+    bool inflater_ready;
+    bool deflater_ready;
+    fs_ws_buffer_t scratch;     // masked or compressed payloads being sent
+    uint64_t mask_state;
+};
+
+static bool fs_ws_reserve(fs_ws_buffer_t* buffer, size_t extra) {
+    if (buffer->capacity - buffer->length < extra) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        uint8_t* data;
+        
+        while (capacity - buffer->length < extra) {
+            if (capacity > SIZE_MAX / 2) {
+                return false;
+            }
+            capacity *= 2;
+        }
+        data = realloc(buffer->data, capacity);
+        if (!data) {
+            return false;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    return true;
+}
+
+/* XORs `length` bytes with the mask, which starts at byte `offset` of the key. */
+static void fs_ws_unmask(uint8_t* p, size_t length, const uint8_t mask[4], size_t offset) {
+    uint8_t key[4];
+    uint32_t word;
+    uint64_t wide;
+    size_t i = 0;
+    
+    for (int k = 0; k < 4; k++) {
+        key[k] = mask[(offset + k) & 3];
+    }
+    memcpy(&word, key, sizeof(word));
+    wide = (uint64_t)word << 32 | word;
+    
+#if defined(FS_WS_SSE2)
+    {
+        __m128i vector = _mm_set1_epi32((int)word);
+        
+        for (; i + 64 <= length; i += 64) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(p + i + 16));
+            __m128i c = _mm_loadu_si128((const __m128i*)(p + i + 32));
+            __m128i d = _mm_loadu_si128((const __m128i*)(p + i + 48));
+            _mm_storeu_si128((__m128i*)(p + i), _mm_xor_si128(a, vector));
+            _mm_storeu_si128((__m128i*)(p + i + 16), _mm_xor_si128(b, vector));
+            _mm_storeu_si128((__m128i*)(p + i + 32), _mm_xor_si128(c, vector));
+            _mm_storeu_si128((__m128i*)(p + i + 48), _mm_xor_si128(d, vector));
+        }
+        for (; i + 16 <= length; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(p + i));
+            _mm_storeu_si128((__m128i*)(p + i), _mm_xor_si128(a, vector));
+        }
+    }
+#elif defined(FS_WS_NEON)
+    {
+        uint8x16_t vector = vreinterpretq_u8_u32(vdupq_n_u32(word));
+        
+        for (; i + 64 <= length; i += 64) {
+            uint8x16x4_t block = vld1q_u8_x4(p + i);
+            block.val[0] = veorq_u8(block.val[0], vector);
+            block.val[1] = veorq_u8(block.val[1], vector);
+            block.val[2] = veorq_u8(block.val[2], vector);
+            block.val[3] = veorq_u8(block.val[3], vector);
+            vst1q_u8_x4(p + i, block);
+        }
+        for (; i + 16 <= length; i += 16) {
+            vst1q_u8(p + i, veorq_u8(vld1q_u8(p + i), vector));
+        }
+    }
+#endif
+    for (; i + 8 <= length; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, p + i, sizeof(chunk));
+        chunk ^= wide;
+        memcpy(p + i, &chunk, sizeof(chunk));
+    }
+    for (; i < length; i++) {
+        p[i] ^= key[i & 3];
+    }
+}
+
+/* Copies `length` bytes to `dst` masked, starting at byte `offset` of the key. */
+static void fs_ws_mask_copy(uint8_t* dst, const uint8_t* src, size_t length, const uint8_t mask[4], size_t offset) {
+    memcpy(dst, src, length);
+    fs_ws_unmask(dst, length, mask, offset);
+}
+
+/* Checks UTF-8 as RFC 3629 defines it: no overlong forms, surrogates or code points past U+10FFFF. */
+static bool fs_ws_utf8_valid(const uint8_t* p, size_t length) {
+    size_t i = 0;
+    
+    while (i < length) {
+        uint8_t lead;
+        
+        // ASCII eight bytes at a time.
+        while (i + 8 <= length) {
+            uint64_t chunk;
+            memcpy(&chunk, p + i, sizeof(chunk));
+            if (chunk & 0x8080808080808080ull) {
+                break;
+            }
+            i += 8;
+        }
+        if (i == length) {
+            break;
+        }
+        lead = p[i];
+        if (lead < 0x80) {
+            i++;
+        } else if (lead >= 0xC2 && lead <= 0xDF) {
+            if (i + 1 >= length || (p[i + 1] & 0xC0) != 0x80) {
+                return false;
+            }
+            i += 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            uint8_t low = lead == 0xE0 ? 0xA0 : 0x80, high = lead == 0xED ? 0x9F : 0xBF;
+            
+            if (i + 2 >= length || p[i + 1] < low || p[i + 1] > high || (p[i + 2] & 0xC0) != 0x80) {
+                return false;
+            }
+            i += 3;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            uint8_t low = lead == 0xF0 ? 0x90 : 0x80, high = lead == 0xF4 ? 0x8F : 0xBF;
+            
+            if (i + 3 >= length || p[i + 1] < low || p[i + 1] > high || (p[i + 2] & 0xC0) != 0x80 ||
+                (p[i + 3] & 0xC0) != 0x80) {
+                return false;
+            }
+            i += 4;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fs_ws_random_key(fs_ws_t* ws, uint8_t key[4]) {
+#if defined(__APPLE__)
+    (void)ws;
+    arc4random_buf(key, 4);
+#else
+    // splitmix64, seeded per connection; masks only need to be unpredictable to scripts.
+    uint64_t z = (ws->mask_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    memcpy(key, &z, 4);
+#endif
+}
+
+static fs_error_t fs_ws_fail(fs_ws_t* ws, uint16_t code) {
+    ws->close_code = code;
+    return code == FS_WS_CLOSE_TOO_BIG ? FS_ERROR_NOT_SUPPORTED : FS_ERROR_INVALID_ARGUMENT;
+}
+
+fs_error_t fs_ws_create(const fs_ws_config_t* config, fs_ws_t** out) {
+    fs_ws_t* ws;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!config || !config->writev || (config->role != FS_WS_CLIENT && config->role != FS_WS_SERVER)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    ws = calloc(1, sizeof(*ws));
+    if (!ws) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    ws->role = config->role;
+    ws->deflate = config->deflate;
+    ws->no_context_takeover = config->no_context_takeover;
+    ws->max_message = config->max_message ? config->max_message : FS_WS_MAX_MESSAGE;
+    ws->writev = config->writev;
+    ws->context = config->context;
+    ws->close_code = FS_WS_CLOSE_NORMAL;
+    
+    if (ws->deflate) {
+        // Raw deflate streams with the full 32 KiB window, as RFC 7692 defaults to.
+        if (inflateInit2(&ws->inflater, -MAX_WBITS) != Z_OK) {
+            free(ws);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        ws->inflater_ready = true;
+        if (deflateInit2(&ws->deflater, FS_WS_DEFLATE_LEVEL, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            fs_ws_destroy(ws);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        ws->deflater_ready = true;
+    }
+#if !defined(__APPLE__)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        ws->mask_state = (uint64_t)now.tv_nsec ^ ((uint64_t)now.tv_sec << 32) ^ (uint64_t)(uintptr_t)ws ^
+                         ((uint64_t)getpid() << 16);
+    }
+#endif
+    *out = ws;
+    return FS_ERROR_NONE;
+}
+
+void fs_ws_destroy(fs_ws_t* ws) {
+    if (!ws) {
+        return;
+    }
+    if (ws->inflater_ready) {
+        inflateEnd(&ws->inflater);
+    }
+    if (ws->deflater_ready) {
+        deflateEnd(&ws->deflater);
+    }
+    free(ws->message.data);
+    free(ws->scratch.data);
+    free(ws);
+}
+
+uint16_t fs_ws_close_code(const fs_ws_t* ws) {
+    return ws->close_code;
+}
+
+/* Inflates `length` bytes of the current message into `message`. */
+static fs_error_t fs_ws_inflate(fs_ws_t* ws, const uint8_t* data, size_t length) {
+    z_stream* stream = &ws->inflater;
+    
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = (uInt)length;
+    do {
+        size_t room;
+        int status;
+        
+        if (!fs_ws_reserve(&ws->message, 4096)) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        // One byte past the limit is enough to tell, whatever the ratio.
+        room = ws->message.capacity - ws->message.length;
+        if (room > ws->max_message - ws->message.length + 1) {
+            room = ws->max_message - ws->message.length + 1;
+        }
+        stream->next_out = ws->message.data + ws->message.length;
+        stream->avail_out = (uInt)(room < UINT32_MAX ? room : UINT32_MAX);
+        status = inflate(stream, Z_SYNC_FLUSH);
+        ws->message.length = (size_t)(stream->next_out - ws->message.data);
+        if (ws->message.length > ws->max_message) {
+            return fs_ws_fail(ws, FS_WS_CLOSE_TOO_BIG);
+        }
+        if (status == Z_STREAM_END) {
+            // The peer ended its stream with a final block; a new one may follow.
+            inflateReset(stream);
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            return fs_ws_fail(ws, FS_WS_CLOSE_INVALID_DATA);
+        }
+    } while (stream->avail_in || !stream->avail_out);
+    return FS_ERROR_NONE;
+}
+
+/* Adds payload bytes of a data message that is not delivered in place. */
+static fs_error_t fs_ws_gather(fs_ws_t* ws, const uint8_t* data, size_t length) {
+    // Empty fragments may come with no buffer at all.
+    if (length == 0) {
+        return FS_ERROR_NONE;
+    }
+    if (ws->compressed) {
+        return fs_ws_inflate(ws, data, length);
+    }
+    if (length > ws->max_message - ws->message.length) {
+        return fs_ws_fail(ws, FS_WS_CLOSE_TOO_BIG);
+    }
+    if (!fs_ws_reserve(&ws->message, length)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(ws->message.data + ws->message.length, data, length);
+    ws->message.length += length;
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_ws_deliver(fs_ws_t* ws, fs_ws_opcode_t opcode, const uint8_t* data, size_t length,
+                                fs_ws_message_handler_t handler, void* context) {
+    if (opcode == FS_WS_TEXT && !fs_ws_utf8_valid(data, length)) {
+        return fs_ws_fail(ws, FS_WS_CLOSE_INVALID_DATA);
+    }
+    handler(context, opcode, data, length);
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_ws_finish_message(fs_ws_t* ws, fs_ws_message_handler_t handler, void* context) {
+    fs_error_t error;
+    
+    if (ws->compressed) {
+        error = fs_ws_inflate(ws, fs_ws_deflate_tail, sizeof(fs_ws_deflate_tail));
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    ws->in_message = false;
+    error = fs_ws_deliver(ws, ws->opcode, ws->message.data, ws->message.length, handler, context);
+    ws->message.length = 0;
+    return error;
+}
+
+static fs_error_t fs_ws_control(fs_ws_t* ws, fs_ws_opcode_t opcode, uint8_t* payload, size_t length,
+                                fs_ws_message_handler_t handler, void* context) {
+    if (opcode == FS_WS_PING) {
+        struct iovec slice = { payload, length };
+        return ws->close_sent ? FS_ERROR_NONE : fs_ws_send(ws, FS_WS_PONG, &slice, 1);
+    }
+    if (opcode == FS_WS_CLOSE) {
+        if (length == 1 || (length >= 2 && !fs_ws_utf8_valid(payload + 2, length - 2))) {
+            return fs_ws_fail(ws, length == 1 ? FS_WS_CLOSE_PROTOCOL : FS_WS_CLOSE_INVALID_DATA);
+        }
+        if (length >= 2) {
+            uint16_t code = (uint16_t)(payload[0] << 8 | payload[1]);
+            
+            // 1004-1006 and 1015 are reserved for reporting, not for the wire.
+            if (code < 1000 || (code >= 1004 && code <= 1006) || (code >= 1016 && code < 3000) || code >= 5000) {
+                return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+            }
+        }
+        ws->close_received = true;
+    }
+    handler(context, opcode, payload, length);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_ws_receive(fs_ws_t* ws, fs_net_ring_t* ring, fs_ws_message_handler_t handler, void* context) {
+    bool masked = ws->role == FS_WS_SERVER;
+    
+    if (!handler) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    for (;;) {
+        uint8_t* p;
+        size_t available = fs_net_ring_read_span(ring, &p);
+        fs_error_t error;
+        
+        if (!ws->in_frame) {
+            uint8_t flags, opcode;
+            size_t header = 2;
+            uint64_t length;
+            
+            if (available < 2) {
+                return FS_ERROR_NONE;
+            }
+            if (ws->close_received) {
+                return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+            }
+            flags = p[0];
+            opcode = flags & FS_WS_OPCODE;
+            length = p[1] & 0x7F;
+            if ((p[1] & FS_WS_MASKED) != (masked ? FS_WS_MASKED : 0) || (flags & FS_WS_RSV23)) {
+                return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+            }
+            header += length == 126 ? 2 : length == 127 ? 8 : 0;
+            header += masked ? 4 : 0;
+            if (available < header) {
+                return FS_ERROR_NONE;
+            }
+            if (length == 126) {
+                length = (uint64_t)p[2] << 8 | p[3];
+                if (length < 126) {
+                    return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+                }
+            } else if (length == 127) {
+                length = 0;
+                for (int i = 0; i < 8; i++) {
+                    length = length << 8 | p[2 + i];
+                }
+                if (length >> 63 || length <= 0xFFFF) {
+                    return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+                }
+            }
+            if (masked) {
+                memcpy(ws->mask, p + header - 4, 4);
+            }
+            
+            if (opcode >= FS_WS_CLOSE) {
+                // Control frames are short, unfragmented and never compressed; they may come between fragments.
+                if ((opcode != FS_WS_CLOSE && opcode != FS_WS_PING && opcode != FS_WS_PONG) || !(flags & FS_WS_FIN) ||
+                    (flags & FS_WS_RSV1) || length > FS_WS_CONTROL_MAX) {
+                    return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+                }
+                if (available < header + length) {
+                    return FS_ERROR_NONE;
+                }
+                if (masked) {
+                    fs_ws_unmask(p + header, (size_t)length, ws->mask, 0);
+                }
+                error = fs_ws_control(ws, (fs_ws_opcode_t)opcode, p + header, (size_t)length, handler, context);
+                if (error != FS_ERROR_NONE) {
+                    return error;
+                }
+                fs_net_ring_consume(ring, header + (size_t)length);
+                continue;
+            }
+            
+            if (opcode == FS_WS_CONTINUATION) {
+                if (!ws->in_message || (flags & FS_WS_RSV1)) {
+                    return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+                }
+            } else {
+                if (ws->in_message || (opcode != FS_WS_TEXT && opcode != FS_WS_BINARY) ||
+                    ((flags & FS_WS_RSV1) && !ws->deflate)) {
+                    return fs_ws_fail(ws, FS_WS_CLOSE_PROTOCOL);
+                }
+                ws->in_message = true;
+                ws->opcode = (fs_ws_opcode_t)opcode;
+                ws->compressed = (flags & FS_WS_RSV1) != 0;
+                ws->message.length = 0;
+            }
+            if (length > ws->max_message || (!ws->compressed && length > ws->max_message - ws->message.length)) {
+                return fs_ws_fail(ws, FS_WS_CLOSE_TOO_BIG);
+            }
+            
+            if (opcode != FS_WS_CONTINUATION && (flags & FS_WS_FIN) && !ws->compressed &&
+                available - header >= length) {
+                // The common case: a whole message in one frame, handed on where it lies.
+                if (masked) {
+                    fs_ws_unmask(p + header, (size_t)length, ws->mask, 0);
+                }
+                ws->in_message = false;
+                error = fs_ws_deliver(ws, ws->opcode, p + header, (size_t)length, handler, context);
+                if (error != FS_ERROR_NONE) {
+                    return error;
+                }
+                fs_net_ring_consume(ring, header + (size_t)length);
+                continue;
+            }
+            
+            ws->in_frame = true;
+            ws->frame_fin = (flags & FS_WS_FIN) != 0;
+            ws->frame_remaining = length;
+            ws->mask_offset = 0;
+            fs_net_ring_consume(ring, header);
+            available = fs_net_ring_read_span(ring, &p);
+        }
+        
+        {
+            size_t take = available < ws->frame_remaining ? available : (size_t)ws->frame_remaining;
+            
+            if (!take && ws->frame_remaining) {
+                return FS_ERROR_NONE;
+            }
+            if (masked) {
+                fs_ws_unmask(p, take, ws->mask, ws->mask_offset);
+            }
+            error = fs_ws_gather(ws, p, take);
+            if (error != FS_ERROR_NONE) {
+                return error;
+            }
+            fs_net_ring_consume(ring, take);
+            ws->frame_remaining -= take;
+            ws->mask_offset = (ws->mask_offset + take) & 3;
+            if (ws->frame_remaining) {
+                return FS_ERROR_NONE;
+            }
+            ws->in_frame = false;
+            if (ws->frame_fin) {
+                error = fs_ws_finish_message(ws, handler, context);
+                if (error != FS_ERROR_NONE) {
+                    return error;
+                }
+            }
+        }
+    }
+}
+
+static size_t fs_ws_header(uint8_t* header, uint8_t flags, uint64_t length, const uint8_t* mask) {
+    size_t n = 2;
+    
+    header[0] = flags;
+    if (length < 126) {
+        header[1] = (uint8_t)length;
+    } else if (length <= 0xFFFF) {
+        header[1] = 126;
+        header[2] = (uint8_t)(length >> 8);
+        header[3] = (uint8_t)length;
+        n = 4;
+    } else {
+        header[1] = 127;
+        for (int i = 0; i < 8; i++) {
+            header[2 + i] = (uint8_t)(length >> (56 - 8 * i));
+        }
+        n = 10;
+    }
+    if (mask) {
+        header[1] |= FS_WS_MASKED;
+        memcpy(header + n, mask, 4);
+        n += 4;
+    }
+    return n;
+}
+
+/* Deflates the slices into `scratch` with a sync flush, dropping the empty block it ends with. */
+static fs_error_t fs_ws_compress(fs_ws_t* ws, const struct iovec* slices, int count, size_t total) {
+    z_stream* stream = &ws->deflater;
+    
+    ws->scratch.length = 0;
+    if (!fs_ws_reserve(&ws->scratch, deflateBound(stream, (uLong)total) + 16)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (int i = 0; i <= count; i++) {
+        stream->next_in = i < count ? (Bytef*)slices[i].iov_base : NULL;
+        stream->avail_in = i < count ? (uInt)slices[i].iov_len : 0;
+        do {
+            if (ws->scratch.capacity - ws->scratch.length < 64 && !fs_ws_reserve(&ws->scratch, 4096)) {
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            stream->next_out = ws->scratch.data + ws->scratch.length;
+            stream->avail_out = (uInt)(ws->scratch.capacity - ws->scratch.length);
+            if (deflate(stream, i < count ? Z_NO_FLUSH : Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+                return FS_ERROR_UNKNOWN;
+            }
+            ws->scratch.length = (size_t)(stream->next_out - ws->scratch.data);
+        } while (stream->avail_in || !stream->avail_out);
+    }
+    if (ws->scratch.length >= 4) {
+        ws->scratch.length -= 4;
+    }
+    if (ws->no_context_takeover) {
+        deflateReset(stream);
+    }
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_ws_send(fs_ws_t* ws, fs_ws_opcode_t opcode, const struct iovec* slices, int count) {
+    struct iovec iov[FS_WS_MAX_SLICES + 1];
+    uint8_t header[FS_WS_HEADER_MAX];
+    uint8_t key[4], * mask = NULL;
+    uint8_t flags = FS_WS_FIN | (uint8_t)opcode;
+    bool control = opcode >= FS_WS_CLOSE;
+    bool compress;
+    size_t total = 0;
+    int n = 1;
+    
+    if (count < 0 || count > FS_WS_MAX_SLICES || (count && !slices) ||
+        (opcode != FS_WS_TEXT && opcode != FS_WS_BINARY && opcode != FS_WS_CLOSE && opcode != FS_WS_PING &&
+         opcode != FS_WS_PONG)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (ws->close_sent) {
+        return FS_ERROR_CANCELLED;
+    }
+    for (int i = 0; i < count; i++) {
+        total += slices[i].iov_len;
+    }
+    if (control && total > FS_WS_CONTROL_MAX) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (ws->role == FS_WS_CLIENT) {
+        fs_ws_random_key(ws, key);
+        mask = key;
+    }
+    compress = !control && ws->deflate && total >= FS_WS_DEFLATE_MIN;
+    
+    if (compress) {
+        fs_error_t error = fs_ws_compress(ws, slices, count, total);
+        
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+        // Without context takeover nothing depends on this message, so one that grew goes out as it is.
+        compress = !ws->no_context_takeover || ws->scratch.length < total;
+    }
+    if (compress) {
+        flags |= FS_WS_RSV1;
+        if (mask) {
+            fs_ws_unmask(ws->scratch.data, ws->scratch.length, mask, 0);
+        }
+        iov[1].iov_base = ws->scratch.data;
+        iov[1].iov_len = ws->scratch.length;
+        n = 2;
+        total = ws->scratch.length;
+    } else if (mask) {
+        // Clients may not send the caller's bytes as they are.
+        ws->scratch.length = 0;
+        if (!fs_ws_reserve(&ws->scratch, total ? total : 1)) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        for (int i = 0; i < count; i++) {
+            fs_ws_mask_copy(ws->scratch.data + ws->scratch.length, slices[i].iov_base, slices[i].iov_len, mask,
+                            ws->scratch.length);
+            ws->scratch.length += slices[i].iov_len;
+        }
+        iov[1].iov_base = ws->scratch.data;
+        iov[1].iov_len = total;
+        n = 2;
+    } else {
+        for (int i = 0; i < count; i++) {
+            iov[n++] = slices[i];
+        }
+    }
+    
+    iov[0].iov_base = header;
+    iov[0].iov_len = fs_ws_header(header, flags, total, mask);
+    return ws->writev(ws->context, iov, n);
+}
+
+fs_error_t fs_ws_close(fs_ws_t* ws, uint16_t code, const char* reason) {
+    uint8_t payload[FS_WS_CONTROL_MAX];
+    size_t length = reason ? strlen(reason) : 0;
+    struct iovec slice = { payload, 2 + length };
+    fs_error_t error;
+    
+    if (length > FS_WS_CONTROL_MAX - 2) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    payload[0] = (uint8_t)(code >> 8);
+    payload[1] = (uint8_t)code;
+    if (length) {
+        memcpy(payload + 2, reason, length);
+    }
+    error = fs_ws_send(ws, FS_WS_CLOSE, &slice, 1);
+    if (error == FS_ERROR_NONE) {
+        ws->close_sent = true;
+    }
+    return error;
+}
@@ -28,3 +28,1000 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <fs/fslog.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A node closes after a child with these bits clear, one id in FS_SYNC_FANOUT.
+#define FS_SYNC_BOUNDARY_SHIFT 40
+
+// Each level at least halves the one below, so no tree of 2^64 bytes is this deep.
+#define FS_SYNC_MAX_LEVEL 64
+
+// Level of a pulled root before its encoding arrives.
+#define FS_SYNC_UNKNOWN_LEVEL UINT8_MAX
+
+typedef struct {
+    fs_chunk_id_t id;
+    uint64_t offset;            // of its first byte in the document
+    uint64_t length;
+    size_t first;               // a node's first child entry
+    uint32_t count;
+    uint8_t level;              // 0 for a chunk
+} fs_sync_entry_t;
+
+typedef struct {
+    fs_chunk_id_t id;
+    size_t index;
+    bool used;
+    bool chunk;
+} fs_sync_slot_t;
+
+/* Open-addressed index of nodes and chunks by id; the ids are hashes already. */
+typedef struct {
+    fs_sync_slot_t* slots;
+    size_t capacity;            // a power of two, kept at most half full
+    size_t count;
+} fs_sync_map_t;
+
+struct fs_sync_tree {
+    const uint8_t* data;
+    size_t length;
+    fs_sync_entry_t* entries;   // the chunks in document order, then each level of nodes, the root last
+    size_t count;
+    size_t chunks;
+    fs_sync_map_t index;
+};
+
+enum {
+    FS_SYNC_QUEUED,
+    FS_SYNC_IN_FLIGHT,
+    FS_SYNC_DONE,
+};
+
+/* A node or chunk the sync has come across. */
+typedef struct {
+    fs_chunk_id_t id;
+    uint64_t length;
+    fs_sync_op_t op;            // the request it waits on, or last waited on
+    uint8_t state;
+    uint8_t level;
+    size_t entry;               // pushing: its entry in the local tree
+    size_t first;               // pulling: its children in `children`, once expanded
+    size_t count;
+    uint8_t* bytes;             // pulling: a fetched chunk
+} fs_sync_item_t;
+
+typedef struct {
+    fs_chunk_id_t id;
+    uint64_t length;
+} fs_sync_child_t;
+
+/* FIFO of item indices, a ring of a power of two. */
+typedef struct {
+    size_t* items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+} fs_sync_queue_t;
+
+struct fs_sync {
+    const fs_sync_tree_t* local;
+    bool push;
+    fs_chunk_id_t root;
+    
+    fs_sync_item_t* items;
+    size_t item_count;
+    size_t item_capacity;
+    fs_sync_map_t index;
+    
+    fs_sync_child_t* children;
+    size_t child_count;
+    size_t child_capacity;
+    
+    fs_sync_queue_t probes;     // EXPAND and QUERY, handed out first
+    fs_sync_queue_t transfers;  // FETCH and UPLOAD
+    size_t in_flight;
+};
+
+/* A stretch of the document being assembled by fs_sync_finish(). */
+typedef struct {
+    fs_chunk_id_t id;
+    const uint8_t* bytes;
+    size_t length;
+} fs_sync_part_t;
+
+/* A node being walked by fs_sync_finish(), from the pulled children or the local tree. */
+typedef struct {
+    const fs_sync_child_t* pulled;
+    const fs_sync_entry_t* local;
+    size_t count;
+    size_t next;
+    uint8_t level;
+} fs_sync_frame_t;
+
+static size_t fs_sync_map_home(fs_chunk_id_t id, bool chunk, size_t mask) {
+    return (size_t)(id.lo ^ (chunk ? 0 : 0x9e3779b97f4a7c15ull)) & mask;
+}
+
+static bool fs_sync_map_find(const fs_sync_map_t* map, fs_chunk_id_t id, bool chunk, size_t* index) {
+    size_t mask;
+    
+    if (!map->capacity) {
+        return false;
+    }
+    mask = map->capacity - 1;
+    for (size_t i = fs_sync_map_home(id, chunk, mask);; i = (i + 1) & mask) {
+        const fs_sync_slot_t* slot = &map->slots[i];
+        
+        if (!slot->used) {
+            return false;
+        }
+        if (slot->chunk == chunk && fs_chunk_id_equal(slot->id, id)) {
+            *index = slot->index;
+            return true;
+        }
+    }
+}
+
+/* Adds an id not in the map; room was reserved. */
+static void fs_sync_map_put(fs_sync_map_t* map, fs_chunk_id_t id, bool chunk, size_t index) {
+    size_t mask = map->capacity - 1;
+    size_t i = fs_sync_map_home(id, chunk, mask);
+    
+    while (map->slots[i].used) {
+        i = (i + 1) & mask;
+    }
+    map->slots[i] = (fs_sync_slot_t){ .id = id, .index = index, .used = true, .chunk = chunk };
+    map->count++;
+}
+
+static bool fs_sync_map_reserve(fs_sync_map_t* map, size_t more) {
+    size_t capacity = map->capacity ? map->capacity : 64;
+    fs_sync_map_t grown;
+    
+    if (map->count + more > SIZE_MAX / 4 / sizeof(fs_sync_slot_t)) {
+        return false;
+    }
+    while (capacity < (map->count + more) * 2) {
+        capacity *= 2;
+    }
+    if (capacity == map->capacity) {
+        return true;
+    }
+    grown.slots = calloc(capacity, sizeof(*grown.slots));
+    if (!grown.slots) {
+        return false;
+    }
+    grown.capacity = capacity;
+    grown.count = 0;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->slots[i].used) {
+            fs_sync_map_put(&grown, map->slots[i].id, map->slots[i].chunk, map->slots[i].index);
+        }
+    }
+    free(map->slots);
+    *map = grown;
+    return true;
+}
+
+static size_t fs_sync_put_varint(uint8_t* p, uint64_t value) {
+    size_t n = 0;
+    
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool fs_sync_get_varint(const uint8_t** p, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        
+        if (*p == end) {
+            return false;
+        }
+        byte = *(*p)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void fs_sync_put_u64(uint8_t* p, uint64_t value) {
+    for (unsigned i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static uint64_t fs_sync_get_u64(const uint8_t* p) {
+    uint64_t value = 0;
+    
+    for (unsigned i = 0; i < 8; i++) {
+        value |= (uint64_t)p[i] << (i * 8);
+    }
+    return value;
+}
+
+static size_t fs_sync_encode(const fs_sync_entry_t* children, size_t count, uint8_t level, uint8_t* bytes) {
+    size_t n = 0;
+    
+    bytes[n++] = level;
+    n += fs_sync_put_varint(bytes + n, count);
+    for (size_t i = 0; i < count; i++) {
+        fs_sync_put_u64(bytes + n, children[i].id.lo);
+        fs_sync_put_u64(bytes + n + 8, children[i].id.hi);
+        n += 16;
+        n += fs_sync_put_varint(bytes + n, children[i].length);
+    }
+    return n;
+}
+
+static bool fs_sync_closes(fs_chunk_id_t id) {
+    return ((id.hi >> FS_SYNC_BOUNDARY_SHIFT) & (FS_SYNC_FANOUT - 1)) == 0;
+}
+
+/* Allocates a tree with room for `chunks` chunks and every node above them. */
+static fs_sync_tree_t* fs_sync_tree_alloc(const void* data, size_t length, size_t chunks) {
+    fs_sync_tree_t* tree;
+    
+    // A level of n entries has at most ceil(n / 2) nodes above it, so 2n + 1 in all.
+    if (chunks > (SIZE_MAX / sizeof(fs_sync_entry_t) - 2) / 2) {
+        return NULL;
+    }
+    tree = calloc(1, sizeof(*tree));
+    if (!tree) {
+        return NULL;
+    }
+    tree->entries = malloc((chunks * 2 + 2) * sizeof(*tree->entries));
+    if (!tree->entries) {
+        free(tree);
+        return NULL;
+    }
+    tree->data = data;
+    tree->length = length;
+    tree->chunks = chunks;
+    return tree;
+}
+
+/* Builds the nodes over the chunks in place, up to a single root, and indexes them all. */
+static fs_error_t fs_sync_tree_build(fs_sync_tree_t* tree) {
+    uint8_t bytes[FS_SYNC_NODE_MAX];
+    size_t start = 0, end = tree->chunks;
+    uint8_t level = 0;
+    
+    tree->count = tree->chunks;
+    do {
+        size_t i = start;
+        
+        // An empty document still has a root, with no children.
+        do {
+            fs_sync_entry_t* node = &tree->entries[tree->count++];
+            
+            node->offset = i < end ? tree->entries[i].offset : tree->length;
+            node->length = 0;
+            node->first = i;
+            node->level = level + 1;
+            while (i < end) {
+                size_t count;
+                
+                node->length += tree->entries[i++].length;
+                count = i - node->first;
+                if (count == FS_SYNC_MAX_FANOUT || (count >= 2 && fs_sync_closes(tree->entries[i - 1].id))) {
+                    break;
+                }
+            }
+            node->count = (uint32_t)(i - node->first);
+            node->id = fs_chunk_hash(bytes, fs_sync_encode(tree->entries + node->first, node->count,
+                                                           node->level, bytes));
+        } while (i < end);
+        start = end;
+        end = tree->count;
+        level++;
+    } while (end - start > 1);
+    
+    if (!fs_sync_map_reserve(&tree->index, tree->count)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < tree->count; i++) {
+        size_t found;
+        bool chunk = tree->entries[i].level == 0;
+        
+        // A chunk repeated in the document is served from its first copy.
+        if (!fs_sync_map_find(&tree->index, tree->entries[i].id, chunk, &found)) {
+            fs_sync_map_put(&tree->index, tree->entries[i].id, chunk, i);
+        }
+    }
+    return FS_ERROR_NONE;
+}
+
+static fs_sync_entry_t fs_sync_chunk_entry(const uint8_t* data, size_t offset, size_t length) {
+    return (fs_sync_entry_t){ .id = fs_chunk_hash(data + offset, length), .offset = offset, .length = length };
+}
+
+static fs_error_t fs_sync_tree_split(const void* data, size_t length, fs_sync_tree_t** out) {
+    const uint8_t* bytes = data;
+    fs_sync_tree_t* tree;
+    size_t* ends;
+    size_t count;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    error = fs_chunk_split(data, length, NULL, &ends, &count);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    tree = fs_sync_tree_alloc(data, length, count);
+    if (!tree) {
+        free(ends);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t offset = i ? ends[i - 1] : 0;
+        
+        tree->entries[i] = fs_sync_chunk_entry(bytes, offset, ends[i] - offset);
+    }
+    free(ends);
+    
+    error = fs_sync_tree_build(tree);
+    if (error != FS_ERROR_NONE) {
+        fs_sync_tree_destroy(tree);
+        return error;
+    }
+    *out = tree;
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_sync_tree_resplit(const fs_sync_tree_t* base, const void* data, size_t length, size_t offset,
+                                      size_t removed, size_t inserted, fs_sync_tree_t** out) {
+    const uint8_t* bytes = data;
+    const fs_sync_entry_t* old;
+    fs_sync_entry_t* cut;
+    fs_sync_tree_t* tree;
+    size_t first = 0, resume, count = 0, capacity = 16, position, next;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!base || (!data && length) || offset > base->length || removed > base->length - offset ||
+        inserted > length || length - inserted != base->length - removed) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    old = base->entries;
+    resume = base->chunks;
+    
+    // Cutting starts over at the chunk holding `offset`; the last chunk ends
+    // at the end of the document rather than a boundary, so it also holds the end.
+    if (base->chunks) {
+        size_t low = 0, high = base->chunks - 1;
+        
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            
+            if (old[middle].offset + old[middle].length > offset) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        first = low;
+    }
+    position = first < base->chunks ? (size_t)old[first].offset : 0;
+    next = first;
+    
+    cut = malloc(capacity * sizeof(*cut));
+    if (!cut) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    while (position < length) {
+        size_t size = fs_chunk_next(bytes + position, length - position, NULL);
+        
+        if (count == capacity) {
+            fs_sync_entry_t* grown = realloc(cut, capacity * 2 * sizeof(*cut));
+            
+            if (!grown) {
+                free(cut);
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            cut = grown;
+            capacity *= 2;
+        }
+        cut[count++] = fs_sync_chunk_entry(bytes, position, size);
+        position += size;
+        
+        // Past the edit, a boundary the old document also had starts the
+        // same chunks from here on, which keep their ids.
+        if (position >= offset + inserted && position < length) {
+            size_t was = position - inserted + removed;
+            
+            while (next < base->chunks && old[next].offset + old[next].length < was) {
+                next++;
+            }
+            if (next < base->chunks && old[next].offset + old[next].length == was) {
+                resume = next + 1;
+                break;
+            }
+        }
+    }
+    
+    tree = fs_sync_tree_alloc(data, length, first + count + (base->chunks - resume));
+    if (!tree) {
+        free(cut);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(tree->entries, old, first * sizeof(*old));
+    memcpy(tree->entries + first, cut, count * sizeof(*cut));
+    for (size_t i = resume; i < base->chunks; i++) {
+        fs_sync_entry_t* entry = &tree->entries[first + count + (i - resume)];
+        
+        *entry = old[i];
+        entry->offset = entry->offset - removed + inserted;
+    }
+    free(cut);
+    
+    error = fs_sync_tree_build(tree);
+    if (error != FS_ERROR_NONE) {
+        fs_sync_tree_destroy(tree);
+        return error;
+    }
+    *out = tree;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_tree_create(const void* data, size_t length, fs_sync_tree_t** out) {
+    fs_signpost_id_t signpost = FS_SIGNPOST_BEGIN(FS_SIGNPOST_SYNC);
+    fs_error_t error = fs_sync_tree_split(data, length, out);
+    
+    FS_SIGNPOST_END(FS_SIGNPOST_SYNC, signpost);
+    return error;
+}
+
+fs_error_t fs_sync_tree_update(const fs_sync_tree_t* base, const void* data, size_t length, size_t offset,
+                               size_t removed, size_t inserted, fs_sync_tree_t** out) {
+    fs_signpost_id_t signpost = FS_SIGNPOST_BEGIN(FS_SIGNPOST_SYNC);
+    fs_error_t error = fs_sync_tree_resplit(base, data, length, offset, removed, inserted, out);
+    
+    FS_SIGNPOST_END(FS_SIGNPOST_SYNC, signpost);
+    return error;
+}
+
+void fs_sync_tree_destroy(fs_sync_tree_t* tree) {
+    if (!tree) {
+        return;
+    }
+    free(tree->index.slots);
+    free(tree->entries);
+    free(tree);
+}
+
+fs_chunk_id_t fs_sync_tree_root(const fs_sync_tree_t* tree) {
+    return tree->entries[tree->count - 1].id;
+}
+
+bool fs_sync_tree_contains(const fs_sync_tree_t* tree, fs_chunk_id_t id, bool chunk) {
+    size_t index;
+    
+    return fs_sync_map_find(&tree->index, id, chunk, &index);
+}
+
+fs_error_t fs_sync_tree_node(const fs_sync_tree_t* tree, fs_chunk_id_t id, uint8_t* bytes, size_t* length) {
+    const fs_sync_entry_t* node;
+    size_t index;
+    
+    if (!fs_sync_map_find(&tree->index, id, false, &index)) {
+        *length = 0;
+        return FS_ERROR_NOT_FOUND;
+    }
+    node = &tree->entries[index];
+    *length = fs_sync_encode(tree->entries + node->first, node->count, node->level, bytes);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_tree_chunk(const fs_sync_tree_t* tree, fs_chunk_id_t id, const uint8_t** bytes, size_t* length) {
+    size_t index;
+    
+    if (!fs_sync_map_find(&tree->index, id, true, &index)) {
+        *bytes = NULL;
+        *length = 0;
+        return FS_ERROR_NOT_FOUND;
+    }
+    *bytes = tree->data + tree->entries[index].offset;
+    *length = (size_t)tree->entries[index].length;
+    return FS_ERROR_NONE;
+}
+
+static bool fs_sync_queue_reserve(fs_sync_queue_t* queue, size_t more) {
+    size_t capacity = queue->capacity ? queue->capacity : 64;
+    size_t* items;
+    
+    if (queue->count + more > SIZE_MAX / 2 / sizeof(size_t)) {
+        return false;
+    }
+    while (capacity < queue->count + more) {
+        capacity *= 2;
+    }
+    if (capacity == queue->capacity) {
+        return true;
+    }
+    items = malloc(capacity * sizeof(*items));
+    if (!items) {
+        return false;
+    }
+    for (size_t i = 0; i < queue->count; i++) {
+        items[i] = queue->items[(queue->head + i) & (queue->capacity - 1)];
+    }
+    free(queue->items);
+    queue->items = items;
+    queue->capacity = capacity;
+    queue->head = 0;
+    return true;
+}
+
+/* Makes room for `more` new items, each queued once; existing item pointers may move. */
+static bool fs_sync_reserve(fs_sync_t* sync, size_t more) {
+    if (sync->item_count + more > sync->item_capacity) {
+        size_t capacity = sync->item_capacity ? sync->item_capacity * 2 : 64;
+        fs_sync_item_t* items;
+        
+        while (capacity < sync->item_count + more) {
+            capacity *= 2;
+        }
+        items = realloc(sync->items, capacity * sizeof(*items));
+        if (!items) {
+            return false;
+        }
+        sync->items = items;
+        sync->item_capacity = capacity;
+    }
+    return fs_sync_map_reserve(&sync->index, more) && fs_sync_queue_reserve(&sync->probes, more) &&
+           fs_sync_queue_reserve(&sync->transfers, more);
+}
+
+/* Queues an item for `op`; room was reserved. */
+static void fs_sync_queue(fs_sync_t* sync, size_t index, fs_sync_op_t op) {
+    fs_sync_queue_t* queue = op == FS_SYNC_EXPAND || op == FS_SYNC_QUERY ? &sync->probes : &sync->transfers;
+    
+    sync->items[index].op = op;
+    sync->items[index].state = FS_SYNC_QUEUED;
+    queue->items[(queue->head + queue->count++) & (queue->capacity - 1)] = index;
+}
+
+/* Adds and queues an item not seen before; room was reserved. */
+static void fs_sync_add(fs_sync_t* sync, fs_chunk_id_t id, uint8_t level, uint64_t length, size_t entry,
+                        fs_sync_op_t op) {
+    size_t index = sync->item_count++;
+    
+    sync->items[index] = (fs_sync_item_t){ .id = id, .length = length, .level = level, .entry = entry };
+    fs_sync_map_put(&sync->index, id, level == 0, index);
+    fs_sync_queue(sync, index, op);
+}
+
+/* Finds the item of a request in flight. */
+static bool fs_sync_find(const fs_sync_t* sync, const fs_sync_request_t* request, size_t* index) {
+    const fs_sync_item_t* item;
+    
+    if (!request || !fs_sync_map_find(&sync->index, request->id, request->chunk, index)) {
+        return false;
+    }
+    item = &sync->items[*index];
+    return item->op == request->op && item->state == FS_SYNC_IN_FLIGHT;
+}
+
+static fs_sync_t* fs_sync_alloc(const fs_sync_tree_t* local, bool push, fs_chunk_id_t root) {
+    fs_sync_t* sync = calloc(1, sizeof(*sync));
+    
+    if (!sync) {
+        return NULL;
+    }
+    sync->local = local;
+    sync->push = push;
+    sync->root = root;
+    if (!fs_sync_reserve(sync, 1)) {
+        fs_sync_destroy(sync);
+        return NULL;
+    }
+    return sync;
+}
+
+fs_error_t fs_sync_pull_create(const fs_sync_tree_t* local, fs_chunk_id_t root, fs_sync_t** out) {
+    fs_sync_t* sync;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    sync = fs_sync_alloc(local, false, root);
+    if (!sync) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (!local || !fs_sync_tree_contains(local, root, false)) {
+        fs_sync_add(sync, root, FS_SYNC_UNKNOWN_LEVEL, 0, 0, FS_SYNC_EXPAND);
+    }
+    *out = sync;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_push_create(const fs_sync_tree_t* local, fs_sync_t** out) {
+    const fs_sync_entry_t* root;
+    fs_sync_t* sync;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!local) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    root = &local->entries[local->count - 1];
+    sync = fs_sync_alloc(local, true, root->id);
+    if (!sync) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    fs_sync_add(sync, root->id, root->level, root->length, local->count - 1, FS_SYNC_QUERY);
+    *out = sync;
+    return FS_ERROR_NONE;
+}
+
+void fs_sync_destroy(fs_sync_t* sync) {
+    if (!sync) {
+        return;
+    }
+    for (size_t i = 0; i < sync->item_count; i++) {
+        free(sync->items[i].bytes);
+    }
+    free(sync->items);
+    free(sync->index.slots);
+    free(sync->children);
+    free(sync->probes.items);
+    free(sync->transfers.items);
+    free(sync);
+}
+
+void fs_sync_next(fs_sync_t* sync, fs_sync_request_t* requests, size_t max, size_t* count) {
+    size_t n = 0;
+    
+    while (n < max && (sync->probes.count || sync->transfers.count)) {
+        // Expanding and querying find the rest of the work, so they go first.
+        fs_sync_queue_t* queue = sync->probes.count ? &sync->probes : &sync->transfers;
+        fs_sync_item_t* item = &sync->items[queue->items[queue->head]];
+        
+        queue->head = (queue->head + 1) & (queue->capacity - 1);
+        queue->count--;
+        item->state = FS_SYNC_IN_FLIGHT;
+        sync->in_flight++;
+        requests[n++] = (fs_sync_request_t){
+            .op = item->op,
+            .id = item->id,
+            .chunk = item->level == 0,
+            .length = item->level == FS_SYNC_UNKNOWN_LEVEL ? 0 : item->length,
+        };
+    }
+    *count = n;
+}
+
+/* Parses a node's encoding into `children`, which has room for `FS_SYNC_MAX_FANOUT`. */
+static bool fs_sync_decode(const uint8_t* bytes, size_t length, uint8_t* level, fs_sync_child_t* children,
+                           size_t* count, uint64_t* total) {
+    const uint8_t* p = bytes;
+    const uint8_t* end = bytes + length;
+    uint64_t wide;
+    
+    if (!length) {
+        return false;
+    }
+    *level = *p++;
+    if (*level == 0 || *level >= FS_SYNC_MAX_LEVEL || !fs_sync_get_varint(&p, end, &wide) ||
+        wide > FS_SYNC_MAX_FANOUT) {
+        return false;
+    }
+    *count = (size_t)wide;
+    *total = 0;
+    for (size_t i = 0; i < *count; i++) {
+        if ((size_t)(end - p) < 16) {
+            return false;
+        }
+        children[i].id.lo = fs_sync_get_u64(p);
+        children[i].id.hi = fs_sync_get_u64(p + 8);
+        p += 16;
+        if (!fs_sync_get_varint(&p, end, &children[i].length) || children[i].length > UINT64_MAX - *total) {
+            return false;
+        }
+        *total += children[i].length;
+    }
+    return p == end;
+}
+
+static fs_error_t fs_sync_expand(fs_sync_t* sync, size_t index, const uint8_t* bytes, size_t length) {
+    fs_sync_child_t children[FS_SYNC_MAX_FANOUT];
+    fs_sync_item_t* item = &sync->items[index];
+    size_t count;
+    uint64_t total;
+    uint8_t level;
+    
+    if (!fs_chunk_id_equal(fs_chunk_hash(bytes, length), item->id) ||
+        !fs_sync_decode(bytes, length, &level, children, &count, &total) ||
+        (item->level != FS_SYNC_UNKNOWN_LEVEL && (level != item->level || total != item->length))) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (sync->child_count + count > sync->child_capacity) {
+        size_t capacity = sync->child_capacity ? sync->child_capacity * 2 : 256;
+        fs_sync_child_t* grown = realloc(sync->children, capacity * sizeof(*grown));
+        
+        if (!grown) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        sync->children = grown;
+        sync->child_capacity = capacity;
+    }
+    if (!fs_sync_reserve(sync, count)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    item = &sync->items[index];
+    item->level = level;
+    item->length = total;
+    item->first = sync->child_count;
+    item->count = count;
+    if (count) {
+        memcpy(sync->children + sync->child_count, children, count * sizeof(*children));
+        sync->child_count += count;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        bool chunk = level == 1;
+        size_t found;
+        
+        // Subtrees held locally, or already asked for along another path, are not asked for again.
+        if ((sync->local && fs_sync_tree_contains(sync->local, children[i].id, chunk)) ||
+            fs_sync_map_find(&sync->index, children[i].id, chunk, &found)) {
+            continue;
+        }
+        fs_sync_add(sync, children[i].id, (uint8_t)(level - 1), children[i].length, 0,
+                    chunk ? FS_SYNC_FETCH : FS_SYNC_EXPAND);
+    }
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_deliver(fs_sync_t* sync, const fs_sync_request_t* request, const uint8_t* bytes,
+                           size_t length) {
+    fs_sync_item_t* item;
+    size_t index;
+    fs_error_t error = FS_ERROR_NONE;
+    
+    if (sync->push || !fs_sync_find(sync, request, &index) || (!bytes && length)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    item = &sync->items[index];
+    if (item->op == FS_SYNC_EXPAND) {
+        error = fs_sync_expand(sync, index, bytes, length);
+    } else if (length != item->length || !fs_chunk_id_equal(fs_chunk_hash(bytes, length), item->id)) {
+        error = FS_ERROR_INVALID_ARGUMENT;
+    } else {
+        item->bytes = malloc(length ? length : 1);
+        if (!item->bytes) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        if (length) {
+            memcpy(item->bytes, bytes, length);
+        }
+    }
+    if (error == FS_ERROR_OUT_OF_MEMORY) {
+        return error;
+    }
+    sync->in_flight--;
+    if (error != FS_ERROR_NONE) {
+        // The other side sent something else; ask again.
+        fs_sync_queue(sync, index, sync->items[index].op);
+        return error;
+    }
+    sync->items[index].state = FS_SYNC_DONE;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_answer(fs_sync_t* sync, const fs_sync_request_t* request, bool present) {
+    const fs_sync_entry_t* entry;
+    size_t index;
+    
+    if (!sync->push || !fs_sync_find(sync, request, &index) || request->op != FS_SYNC_QUERY) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (present) {
+        sync->items[index].state = FS_SYNC_DONE;
+        sync->in_flight--;
+        return FS_ERROR_NONE;
+    }
+    entry = &sync->local->entries[sync->items[index].entry];
+    if (!fs_sync_reserve(sync, entry->count)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (uint32_t i = 0; i < entry->count; i++) {
+        size_t child = entry->first + i;
+        const fs_sync_entry_t* c = &sync->local->entries[child];
+        size_t found;
+        
+        if (!fs_sync_map_find(&sync->index, c->id, c->level == 0, &found)) {
+            fs_sync_add(sync, c->id, c->level, c->length, child, FS_SYNC_QUERY);
+        }
+    }
+    sync->in_flight--;
+    fs_sync_queue(sync, index, FS_SYNC_UPLOAD);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_sent(fs_sync_t* sync, const fs_sync_request_t* request) {
+    size_t index;
+    
+    if (!sync->push || !fs_sync_find(sync, request, &index) || request->op != FS_SYNC_UPLOAD) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    sync->items[index].state = FS_SYNC_DONE;
+    sync->in_flight--;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_retry(fs_sync_t* sync, const fs_sync_request_t* request) {
+    size_t index;
+    
+    if (!fs_sync_find(sync, request, &index)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    sync->in_flight--;
+    fs_sync_queue(sync, index, request->op);
+    return FS_ERROR_NONE;
+}
+
+bool fs_sync_done(const fs_sync_t* sync) {
+    return !sync->probes.count && !sync->transfers.count && !sync->in_flight;
+}
+
+/* Opens a node of the pulled version: fetched, or held locally. */
+static bool fs_sync_open(const fs_sync_t* sync, fs_chunk_id_t id, fs_sync_frame_t* frame) {
+    size_t index;
+    
+    if (fs_sync_map_find(&sync->index, id, false, &index) && sync->items[index].state == FS_SYNC_DONE) {
+        const fs_sync_item_t* item = &sync->items[index];
+        
+        *frame = (fs_sync_frame_t){ .pulled = sync->children + item->first, .count = item->count,
+                                    .level = item->level };
+        return true;
+    }
+    if (sync->local && fs_sync_map_find(&sync->local->index, id, false, &index)) {
+        const fs_sync_entry_t* entry = &sync->local->entries[index];
+        
+        *frame = (fs_sync_frame_t){ .local = sync->local->entries + entry->first, .count = entry->count,
+                                    .level = entry->level };
+        return true;
+    }
+    return false;
+}
+
+/* Lists the chunks of the pulled version in order, with where their bytes are. */
+static fs_error_t fs_sync_parts(const fs_sync_t* sync, fs_sync_part_t** out, size_t* count, size_t* total) {
+    fs_sync_frame_t stack[FS_SYNC_MAX_LEVEL];
+    fs_sync_part_t* parts = NULL;
+    size_t depth = 1, capacity = 0;
+    
+    *count = 0;
+    *total = 0;
+    if (!fs_sync_open(sync, sync->root, &stack[0])) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    while (depth) {
+        fs_sync_frame_t* frame = &stack[depth - 1];
+        fs_chunk_id_t id;
+        uint64_t length;
+        size_t index;
+        
+        if (frame->next == frame->count) {
+            depth--;
+            continue;
+        }
+        id = frame->pulled ? frame->pulled[frame->next].id : frame->local[frame->next].id;
+        length = frame->pulled ? frame->pulled[frame->next].length : frame->local[frame->next].length;
+        frame->next++;
+        
+        if (frame->level > 1) {
+            if (depth == FS_SYNC_MAX_LEVEL || !fs_sync_open(sync, id, &stack[depth]) ||
+                stack[depth].level != frame->level - 1) {
+                free(parts);
+                return FS_ERROR_INVALID_ARGUMENT;
+            }
+            depth++;
+            continue;
+        }
+        if (*count == capacity) {
+            fs_sync_part_t* grown;
+            
+            capacity = capacity ? capacity * 2 : 64;
+            grown = realloc(parts, capacity * sizeof(*grown));
+            if (!grown) {
+                free(parts);
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            parts = grown;
+        }
+        if (fs_sync_map_find(&sync->index, id, true, &index) && sync->items[index].state == FS_SYNC_DONE &&
+            sync->items[index].length == length) {
+            parts[*count] = (fs_sync_part_t){ .id = id, .bytes = sync->items[index].bytes, .length = (size_t)length };
+        } else if (sync->local && fs_sync_map_find(&sync->local->index, id, true, &index) &&
+                   sync->local->entries[index].length == length) {
+            parts[*count] = (fs_sync_part_t){ .id = id, .bytes = sync->local->data + sync->local->entries[index].offset,
+                                              .length = (size_t)length };
+        } else {
+            free(parts);
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        if (length > SIZE_MAX - *total) {
+            free(parts);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        *total += (size_t)length;
+        (*count)++;
+    }
+    *out = parts;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_sync_finish(fs_sync_t* sync, uint8_t** data, size_t* length, fs_sync_tree_t** tree) {
+    fs_sync_part_t* parts = NULL;
+    fs_sync_tree_t* built;
+    uint8_t* bytes;
+    size_t count, total, offset = 0;
+    fs_error_t error;
+    
+    if (!data || !length || !tree) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *data = NULL;
+    *length = 0;
+    *tree = NULL;
+    if (sync->push || !fs_sync_done(sync)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    error = fs_sync_parts(sync, &parts, &count, &total);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    bytes = malloc(total ? total : 1);
+    built = bytes ? fs_sync_tree_alloc(bytes, total, count) : NULL;
+    if (!built) {
+        free(bytes);
+        free(parts);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < count; i++) {
+        memcpy(bytes + offset, parts[i].bytes, parts[i].length);
+        built->entries[i] = (fs_sync_entry_t){ .id = parts[i].id, .offset = offset, .length = parts[i].length };
+        offset += parts[i].length;
+    }
+    free(parts);
+    
+    // The chunks were checked as they arrived; rebuilding the nodes checks
+    // that the ones the other side sent group them as this tree does.
+    error = fs_sync_tree_build(built);
+    if (error == FS_ERROR_NONE && !fs_chunk_id_equal(fs_sync_tree_root(built), sync->root)) {
+        error = FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (error != FS_ERROR_NONE) {
+        fs_sync_tree_destroy(built);
+        free(bytes);
+        return error;
+    }
+    *data = bytes;
+    *length = total;
+    *tree = built;
+    return FS_ERROR_NONE;
+}
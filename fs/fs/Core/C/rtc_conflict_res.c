@@ -28,3 +28,1260 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FS_CRDT_LEAF_ITEMS 32
+#define FS_CRDT_FANOUT 16
+#define FS_CRDT_MAX_HEIGHT 16
+#define FS_CRDT_INDEX_CHUNK 64
+
+// Splits and inserts per operation, for the node and index reserves.
+#define FS_CRDT_MAX_INSERTS 2
+
+/* A run: `length` characters of `client` with clocks `clock` onwards. */
+typedef struct {
+    uint32_t client;
+    uint32_t clock;
+    uint32_t length;
+    uint32_t origin_client;     // character left of the first one when it was inserted
+    uint32_t origin_clock;
+    uint32_t deleter;           // id of the delete, `deleted_at` 0 while visible
+    uint32_t deleted_at;
+} fs_crdt_item_t;
+
+typedef struct fs_crdt_branch fs_crdt_branch_t;
+
+typedef struct {
+    fs_crdt_branch_t* parent;
+    uint32_t height;            // 0 for leaves
+    uint32_t count;
+    size_t visible;
+} fs_crdt_node_t;
+
+typedef struct fs_crdt_leaf {
+    fs_crdt_node_t node;
+    struct fs_crdt_leaf* next;
+    fs_crdt_item_t items[FS_CRDT_LEAF_ITEMS];
+} fs_crdt_leaf_t;
+
+struct fs_crdt_branch {
+    fs_crdt_node_t node;
+    fs_crdt_node_t* children[FS_CRDT_FANOUT];
+    size_t child_visible[FS_CRDT_FANOUT];
+};
+
+/* Index entry: the leaf holding the run of a client that starts at `clock`. */
+typedef struct {
+    uint32_t clock;
+    fs_crdt_leaf_t* leaf;
+} fs_crdt_entry_t;
+
+/* A slice of a client's index; splitting one moves FS_CRDT_INDEX_CHUNK / 2 entries, not the whole index. */
+typedef struct {
+    uint32_t count;
+    fs_crdt_entry_t entries[FS_CRDT_INDEX_CHUNK];
+} fs_crdt_chunk_t;
+
+typedef struct {
+    uint32_t client;
+    uint32_t version;
+    fs_crdt_chunk_t** chunks;   // sorted by clock
+    size_t chunk_count;
+    size_t chunk_capacity;
+} fs_crdt_client_t;
+
+struct fs_crdt {
+    uint32_t client;
+    uint32_t clock;
+    fs_crdt_node_t* root;
+    fs_crdt_leaf_t* first;
+    size_t runs;
+    
+    fs_crdt_client_t* clients;  // sorted by client
+    size_t client_count;
+    size_t client_capacity;
+    
+    // Nodes set aside so that splitting never fails half way.
+    fs_crdt_leaf_t* spare_leaves[FS_CRDT_MAX_INSERTS];
+    size_t spare_leaf_count;
+    fs_crdt_branch_t* spare_branches[FS_CRDT_MAX_INSERTS * (FS_CRDT_MAX_HEIGHT + 2)];
+    size_t spare_branch_count;
+    fs_crdt_chunk_t* spare_chunks[FS_CRDT_MAX_INSERTS];
+    size_t spare_chunk_count;
+};
+
+/* A position in the item sequence. */
+typedef struct {
+    fs_crdt_leaf_t* leaf;
+    size_t index;
+} fs_crdt_cursor_t;
+
+static inline size_t fs_crdt_item_visible(const fs_crdt_item_t* item) {
+    return item->deleted_at ? 0 : item->length;
+}
+
+/* Whether a run was inserted after `id` in RGA order: higher clock first, then higher client. */
+static inline bool fs_crdt_precedes(const fs_crdt_item_t* item, fs_crdt_id_t id) {
+    return item->clock > id.clock || (item->clock == id.clock && item->client > id.client);
+}
+
+static void fs_crdt_node_free(fs_crdt_node_t* node) {
+    if (node->height) {
+        fs_crdt_branch_t* branch = (fs_crdt_branch_t*)node;
+        for (uint32_t i = 0; i < node->count; i++) {
+            fs_crdt_node_free(branch->children[i]);
+        }
+    }
+    free(node);
+}
+
+static fs_crdt_leaf_t* fs_crdt_leaf_new(void) {
+    return calloc(1, sizeof(fs_crdt_leaf_t));
+}
+
+static size_t fs_crdt_slot(const fs_crdt_branch_t* parent, const fs_crdt_node_t* child) {
+    size_t slot = 0;
+    
+    while (parent->children[slot] != child) {
+        slot++;
+    }
+    return slot;
+}
+
+static size_t fs_crdt_sum(const fs_crdt_node_t* node) {
+    size_t visible = 0;
+    
+    if (node->height) {
+        const fs_crdt_branch_t* branch = (const fs_crdt_branch_t*)node;
+        for (uint32_t i = 0; i < node->count; i++) {
+            visible += branch->child_visible[i];
+        }
+    } else {
+        const fs_crdt_leaf_t* leaf = (const fs_crdt_leaf_t*)node;
+        for (uint32_t i = 0; i < node->count; i++) {
+            visible += fs_crdt_item_visible(&leaf->items[i]);
+        }
+    }
+    return visible;
+}
+
+/* Recomputes the visible count of `node` and its ancestors. */
+static void fs_crdt_refresh(fs_crdt_node_t* node) {
+    for (;;) {
+        fs_crdt_branch_t* parent = node->parent;
+        
+        node->visible = fs_crdt_sum(node);
+        if (!parent) {
+            return;
+        }
+        parent->child_visible[fs_crdt_slot(parent, node)] = node->visible;
+        node = &parent->node;
+    }
+}
+
+static fs_crdt_client_t* fs_crdt_find_client(const fs_crdt_t* crdt, uint32_t client) {
+    size_t lo = 0, hi = crdt->client_count;
+    
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (crdt->clients[mid].client < client) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < crdt->client_count && crdt->clients[lo].client == client ? &crdt->clients[lo] : NULL;
+}
+
+/* Index of the last chunk starting at or before `clock`, or `chunk_count` if there is none. */
+static size_t fs_crdt_chunk_before(const fs_crdt_client_t* client, uint32_t clock) {
+    size_t lo = 0, hi = client->chunk_count;
+    
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (client->chunks[mid]->entries[0].clock <= clock) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo ? lo - 1 : client->chunk_count;
+}
+
+/* Index of the last entry starting at or before `clock`, or `count` if there is none. */
+static size_t fs_crdt_entry_before(const fs_crdt_chunk_t* chunk, uint32_t clock) {
+    size_t lo = 0, hi = chunk->count;
+    
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (chunk->entries[mid].clock <= clock) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo ? lo - 1 : chunk->count;
+}
+
+/* Finds the run holding character `id`. */
+static bool fs_crdt_lookup(const fs_crdt_t* crdt, fs_crdt_id_t id, fs_crdt_cursor_t* cursor) {
+    const fs_crdt_client_t* client = fs_crdt_find_client(crdt, id.client);
+    const fs_crdt_chunk_t* chunk;
+    const fs_crdt_entry_t* entry;
+    size_t c;
+    
+    if (!client || (c = fs_crdt_chunk_before(client, id.clock)) == client->chunk_count) {
+        return false;
+    }
+    chunk = client->chunks[c];
+    entry = &chunk->entries[fs_crdt_entry_before(chunk, id.clock)];
+    for (uint32_t i = 0; i < entry->leaf->node.count; i++) {
+        const fs_crdt_item_t* item = &entry->leaf->items[i];
+        
+        if (item->client == id.client && item->clock == entry->clock) {
+            if (id.clock - item->clock >= item->length) {
+                return false;
+            }
+            cursor->leaf = entry->leaf;
+            cursor->index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Adds the index entry of a new run; the room for it was reserved. */
+static void fs_crdt_index_add(fs_crdt_t* crdt, const fs_crdt_item_t* item, fs_crdt_leaf_t* leaf) {
+    fs_crdt_client_t* client = fs_crdt_find_client(crdt, item->client);
+    fs_crdt_chunk_t* chunk;
+    size_t c, at;
+    
+    if (!client->chunk_count) {
+        chunk = crdt->spare_chunks[--crdt->spare_chunk_count];
+        chunk->count = 0;
+        client->chunks[client->chunk_count++] = chunk;
+    }
+    c = fs_crdt_chunk_before(client, item->clock);
+    if (c == client->chunk_count) {
+        c = 0;
+    }
+    chunk = client->chunks[c];
+    at = fs_crdt_entry_before(chunk, item->clock);
+    at = at == chunk->count ? 0 : at + 1;
+    
+    if (chunk->count == FS_CRDT_INDEX_CHUNK) {
+        fs_crdt_chunk_t* right = crdt->spare_chunks[--crdt->spare_chunk_count];
+        size_t half = FS_CRDT_INDEX_CHUNK / 2;
+        
+        memcpy(right->entries, chunk->entries + half, half * sizeof(*right->entries));
+        right->count = (uint32_t)half;
+        chunk->count = (uint32_t)half;
+        memmove(client->chunks + c + 2, client->chunks + c + 1, (client->chunk_count - c - 1) * sizeof(*client->chunks));
+        client->chunks[c + 1] = right;
+        client->chunk_count++;
+        if (at > half) {
+            chunk = right;
+            at -= half;
+        }
+    }
+    memmove(chunk->entries + at + 1, chunk->entries + at, (chunk->count - at) * sizeof(*chunk->entries));
+    chunk->entries[at].clock = item->clock;
+    chunk->entries[at].leaf = leaf;
+    chunk->count++;
+}
+
+static void fs_crdt_index_move(fs_crdt_t* crdt, const fs_crdt_item_t* item, fs_crdt_leaf_t* leaf) {
+    fs_crdt_client_t* client = fs_crdt_find_client(crdt, item->client);
+    fs_crdt_chunk_t* chunk = client->chunks[fs_crdt_chunk_before(client, item->clock)];
+    
+    chunk->entries[fs_crdt_entry_before(chunk, item->clock)].leaf = leaf;
+}
+
+/*
+ Makes sure the next operation cannot run out of memory once it has started
+ changing things: spare nodes for FS_CRDT_MAX_INSERTS leaf splits up to a new
+ root, and index room for as many new runs of the two clients involved.
+ */
+static fs_error_t fs_crdt_reserve(fs_crdt_t* crdt, uint32_t a, uint32_t b) {
+    size_t branches = FS_CRDT_MAX_INSERTS * (crdt->root->height + 2);
+    uint32_t ids[2] = { a, b };
+    
+    if (crdt->root->height >= FS_CRDT_MAX_HEIGHT) {
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    while (crdt->spare_leaf_count < FS_CRDT_MAX_INSERTS) {
+        fs_crdt_leaf_t* leaf = fs_crdt_leaf_new();
+        if (!leaf) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        crdt->spare_leaves[crdt->spare_leaf_count++] = leaf;
+    }
+    while (crdt->spare_branch_count < branches) {
+        fs_crdt_branch_t* branch = calloc(1, sizeof(*branch));
+        if (!branch) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        crdt->spare_branches[crdt->spare_branch_count++] = branch;
+    }
+    while (crdt->spare_chunk_count < FS_CRDT_MAX_INSERTS) {
+        fs_crdt_chunk_t* chunk = malloc(sizeof(*chunk));
+        if (!chunk) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        crdt->spare_chunks[crdt->spare_chunk_count++] = chunk;
+    }
+    
+    for (int k = 0; k < 2; k++) {
+        fs_crdt_client_t* client = fs_crdt_find_client(crdt, ids[k]);
+        
+        if (!client) {
+            size_t at = 0;
+            
+            if (crdt->client_count == crdt->client_capacity) {
+                size_t capacity = crdt->client_capacity ? crdt->client_capacity * 2 : 8;
+                fs_crdt_client_t* clients = realloc(crdt->clients, capacity * sizeof(*clients));
+                if (!clients) {
+                    return FS_ERROR_OUT_OF_MEMORY;
+                }
+                crdt->clients = clients;
+                crdt->client_capacity = capacity;
+            }
+            while (at < crdt->client_count && crdt->clients[at].client < ids[k]) {
+                at++;
+            }
+            memmove(crdt->clients + at + 1, crdt->clients + at, (crdt->client_count - at) * sizeof(*crdt->clients));
+            client = &crdt->clients[at];
+            memset(client, 0, sizeof(*client));
+            client->client = ids[k];
+            crdt->client_count++;
+        }
+        if (client->chunk_count + FS_CRDT_MAX_INSERTS > client->chunk_capacity) {
+            size_t capacity = client->chunk_capacity ? client->chunk_capacity * 2 : 4;
+            fs_crdt_chunk_t** chunks = realloc(client->chunks, capacity * sizeof(*chunks));
+            if (!chunks) {
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            client->chunks = chunks;
+            client->chunk_capacity = capacity;
+        }
+    }
+    return FS_ERROR_NONE;
+}
+
+static void fs_crdt_insert_child(fs_crdt_t* crdt, fs_crdt_branch_t* parent, size_t slot, fs_crdt_node_t* child);
+
+/* Hangs `right` next to `left` in the tree, growing a new root if `left` was the root. */
+static void fs_crdt_attach(fs_crdt_t* crdt, fs_crdt_node_t* left, fs_crdt_node_t* right) {
+    fs_crdt_branch_t* parent = left->parent;
+    
+    if (!parent) {
+        fs_crdt_branch_t* root = crdt->spare_branches[--crdt->spare_branch_count];
+        
+        memset(root, 0, sizeof(*root));
+        root->node.height = left->height + 1;
+        root->node.count = 2;
+        root->children[0] = left;
+        root->children[1] = right;
+        left->parent = right->parent = root;
+        crdt->root = &root->node;
+        fs_crdt_refresh(left);
+        fs_crdt_refresh(right);
+        return;
+    }
+    fs_crdt_insert_child(crdt, parent, fs_crdt_slot(parent, left) + 1, right);
+    fs_crdt_refresh(left);
+}
+
+static void fs_crdt_insert_child(fs_crdt_t* crdt, fs_crdt_branch_t* parent, size_t slot, fs_crdt_node_t* child) {
+    if (parent->node.count == FS_CRDT_FANOUT) {
+        fs_crdt_branch_t* right = crdt->spare_branches[--crdt->spare_branch_count];
+        size_t half = FS_CRDT_FANOUT / 2;
+        
+        memset(right, 0, sizeof(*right));
+        right->node.height = parent->node.height;
+        right->node.count = (uint32_t)half;
+        memcpy(right->children, parent->children + half, half * sizeof(*right->children));
+        memcpy(right->child_visible, parent->child_visible + half, half * sizeof(*right->child_visible));
+        for (size_t i = 0; i < half; i++) {
+            right->children[i]->parent = right;
+        }
+        parent->node.count = (uint32_t)half;
+        fs_crdt_attach(crdt, &parent->node, &right->node);
+        fs_crdt_refresh(&right->node);
+        if (slot > half) {
+            parent = right;
+            slot -= half;
+        }
+    }
+    
+    memmove(parent->children + slot + 1, parent->children + slot,
+            (parent->node.count - slot) * sizeof(*parent->children));
+    memmove(parent->child_visible + slot + 1, parent->child_visible + slot,
+            (parent->node.count - slot) * sizeof(*parent->child_visible));
+    parent->children[slot] = child;
+    parent->child_visible[slot] = child->visible;
+    parent->node.count++;
+    child->parent = parent;
+    fs_crdt_refresh(&parent->node);
+}
+
+/* Inserts a run at `cursor`, which is left pointing at it. */
+static void fs_crdt_insert_item(fs_crdt_t* crdt, fs_crdt_cursor_t* cursor, const fs_crdt_item_t* item) {
+    fs_crdt_leaf_t* leaf = cursor->leaf;
+    size_t index = cursor->index;
+    
+    if (leaf->node.count == FS_CRDT_LEAF_ITEMS) {
+        fs_crdt_leaf_t* right = crdt->spare_leaves[--crdt->spare_leaf_count];
+        size_t half = FS_CRDT_LEAF_ITEMS / 2;
+        
+        memset(right, 0, sizeof(*right));
+        right->node.count = (uint32_t)half;
+        memcpy(right->items, leaf->items + half, half * sizeof(*right->items));
+        for (size_t i = 0; i < half; i++) {
+            fs_crdt_index_move(crdt, &right->items[i], right);
+        }
+        right->next = leaf->next;
+        leaf->next = right;
+        leaf->node.count = (uint32_t)half;
+        right->node.visible = fs_crdt_sum(&right->node);
+        fs_crdt_attach(crdt, &leaf->node, &right->node);
+        if (index > half) {
+            leaf = right;
+            index -= half;
+        }
+    }
+    
+    memmove(leaf->items + index + 1, leaf->items + index, (leaf->node.count - index) * sizeof(*leaf->items));
+    leaf->items[index] = *item;
+    leaf->node.count++;
+    fs_crdt_index_add(crdt, item, leaf);
+    fs_crdt_refresh(&leaf->node);
+    crdt->runs++;
+    cursor->leaf = leaf;
+    cursor->index = index;
+}
+
+/* Splits the run at `cursor` before its character `offset`; the cursor moves to the second part. */
+static void fs_crdt_split(fs_crdt_t* crdt, fs_crdt_cursor_t* cursor, uint32_t offset) {
+    fs_crdt_item_t* item = &cursor->leaf->items[cursor->index];
+    fs_crdt_item_t right = *item;
+    
+    right.clock += offset;
+    right.length -= offset;
+    right.origin_client = item->client;
+    right.origin_clock = item->clock + offset - 1;
+    item->length = offset;
+    cursor->index++;
+    fs_crdt_insert_item(crdt, cursor, &right);
+}
+
+/* Finds the run holding visible character `position`, which must exist, and the offset in it. */
+static fs_crdt_cursor_t fs_crdt_locate(const fs_crdt_t* crdt, size_t position, uint32_t* offset) {
+    const fs_crdt_node_t* node = crdt->root;
+    fs_crdt_cursor_t cursor;
+    
+    while (node->height) {
+        const fs_crdt_branch_t* branch = (const fs_crdt_branch_t*)node;
+        size_t i = 0;
+        
+        while (position >= branch->child_visible[i]) {
+            position -= branch->child_visible[i];
+            i++;
+        }
+        node = branch->children[i];
+    }
+    cursor.leaf = (fs_crdt_leaf_t*)node;
+    cursor.index = 0;
+    for (;; cursor.index++) {
+        size_t visible = fs_crdt_item_visible(&cursor.leaf->items[cursor.index]);
+        if (position < visible) {
+            break;
+        }
+        position -= visible;
+    }
+    *offset = (uint32_t)position;
+    return cursor;
+}
+
+/* Visible characters before the run at `cursor`. */
+static size_t fs_crdt_position(const fs_crdt_cursor_t* cursor) {
+    const fs_crdt_node_t* node = &cursor->leaf->node;
+    size_t position = 0;
+    
+    for (size_t i = 0; i < cursor->index; i++) {
+        position += fs_crdt_item_visible(&cursor->leaf->items[i]);
+    }
+    for (const fs_crdt_branch_t* parent = node->parent; parent; node = &parent->node, parent = node->parent) {
+        for (size_t i = 0, slot = fs_crdt_slot(parent, node); i < slot; i++) {
+            position += parent->child_visible[i];
+        }
+    }
+    return position;
+}
+
+/* Steps to the next run; false at the end. */
+static bool fs_crdt_advance(fs_crdt_cursor_t* cursor) {
+    if (++cursor->index < cursor->leaf->node.count) {
+        return true;
+    }
+    while (cursor->leaf->next) {
+        cursor->leaf = cursor->leaf->next;
+        cursor->index = 0;
+        if (cursor->leaf->node.count) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void fs_crdt_observe(fs_crdt_t* crdt, uint32_t client, uint32_t clock) {
+    fs_crdt_client_t* record = fs_crdt_find_client(crdt, client);
+    
+    if (record && record->version < clock) {
+        record->version = clock;
+    }
+    if (crdt->clock < clock) {
+        crdt->clock = clock;
+    }
+}
+
+fs_error_t fs_crdt_create(uint32_t client, fs_crdt_t** out) {
+    fs_crdt_t* crdt;
+    fs_crdt_leaf_t* leaf;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!client) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    crdt = calloc(1, sizeof(*crdt));
+    leaf = fs_crdt_leaf_new();
+    if (!crdt || !leaf) {
+        free(crdt);
+        free(leaf);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    crdt->client = client;
+    crdt->root = &leaf->node;
+    crdt->first = leaf;
+    *out = crdt;
+    return FS_ERROR_NONE;
+}
+
+void fs_crdt_destroy(fs_crdt_t* crdt) {
+    if (!crdt) {
+        return;
+    }
+    fs_crdt_node_free(crdt->root);
+    for (size_t i = 0; i < crdt->client_count; i++) {
+        for (size_t c = 0; c < crdt->clients[i].chunk_count; c++) {
+            free(crdt->clients[i].chunks[c]);
+        }
+        free(crdt->clients[i].chunks);
+    }
+    free(crdt->clients);
+    for (size_t i = 0; i < crdt->spare_leaf_count; i++) {
+        free(crdt->spare_leaves[i]);
+    }
+    for (size_t i = 0; i < crdt->spare_branch_count; i++) {
+        free(crdt->spare_branches[i]);
+    }
+    for (size_t i = 0; i < crdt->spare_chunk_count; i++) {
+        free(crdt->spare_chunks[i]);
+    }
+    free(crdt);
+}
+
+size_t fs_crdt_length(const fs_crdt_t* crdt) {
+    return crdt->root->visible;
+}
+
+size_t fs_crdt_run_count(const fs_crdt_t* crdt) {
+    return crdt->runs;
+}
+
+uint32_t fs_crdt_version(const fs_crdt_t* crdt, uint32_t client) {
+    const fs_crdt_client_t* record = fs_crdt_find_client(crdt, client);
+    return record ? record->version : 0;
+}
+
+fs_error_t fs_crdt_insert(fs_crdt_t* crdt, size_t position, uint32_t length, fs_crdt_op_t* op) {
+    fs_crdt_item_t item = { 0 };
+    fs_crdt_cursor_t cursor = { crdt->first, 0 };
+    uint32_t offset = 0;
+    fs_error_t error;
+    
+    if (!op || position > crdt->root->visible || !length) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (crdt->clock > UINT32_MAX - length) {
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    if (position) {
+        cursor = fs_crdt_locate(crdt, position - 1, &offset);
+    }
+    // Splitting the run on the left adds an index entry for its client.
+    error = fs_crdt_reserve(crdt, position ? cursor.leaf->items[cursor.index].client : crdt->client, crdt->client);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    item.client = crdt->client;
+    item.clock = crdt->clock + 1;
+    item.length = length;
+    
+    // The new clock is above every clock seen, so the run goes right after its origin.
+    if (position) {
+        fs_crdt_item_t* left = &cursor.leaf->items[cursor.index];
+        
+        item.origin_client = left->client;
+        item.origin_clock = left->clock + offset;
+        
+        if (offset + 1 == left->length && left->client == crdt->client && left->clock + left->length == item.clock) {
+            // Typing on: extend the run.
+            left->length += length;
+            fs_crdt_refresh(&cursor.leaf->node);
+            goto done;
+        }
+        if (offset + 1 < left->length) {
+            fs_crdt_split(crdt, &cursor, offset + 1);
+        } else {
+            cursor.index++;
+        }
+    }
+    fs_crdt_insert_item(crdt, &cursor, &item);
+    
+done:
+    crdt->clock += length;
+    fs_crdt_observe(crdt, crdt->client, crdt->clock);
+    op->kind = FS_CRDT_INSERT;
+    op->id.client = item.client;
+    op->id.clock = item.clock;
+    op->origin.client = item.origin_client;
+    op->origin.clock = item.origin_clock;
+    op->length = length;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_crdt_delete(fs_crdt_t* crdt, size_t position, size_t length, fs_crdt_op_handler_t handler,
+                          void* context) {
+    fs_crdt_cursor_t cursor;
+    fs_crdt_op_t op = { 0 };
+    uint32_t offset, client;
+    fs_error_t error;
+    
+    if (!handler || position > crdt->root->visible || length > crdt->root->visible - position) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (!length) {
+        return FS_ERROR_NONE;
+    }
+    if (crdt->clock > UINT32_MAX - length) {
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    // The runs cut at both ends may belong to anyone.
+    cursor = fs_crdt_locate(crdt, position, &offset);
+    client = cursor.leaf->items[cursor.index].client;
+    cursor = fs_crdt_locate(crdt, position + length - 1, &offset);
+    error = fs_crdt_reserve(crdt, client, cursor.leaf->items[cursor.index].client);
+    if (error == FS_ERROR_NONE) {
+        error = fs_crdt_reserve(crdt, crdt->client, crdt->client);
+    }
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    // Cut the runs at both ends so the range is made of whole runs.
+    if (offset + 1 < cursor.leaf->items[cursor.index].length) {
+        fs_crdt_split(crdt, &cursor, offset + 1);
+    }
+    cursor = fs_crdt_locate(crdt, position, &offset);
+    if (offset) {
+        fs_crdt_split(crdt, &cursor, offset);
+    }
+    
+    op.kind = FS_CRDT_DELETE;
+    while (length) {
+        fs_crdt_item_t* item = &cursor.leaf->items[cursor.index];
+        
+        if (!item->deleted_at) {
+            if (!op.length || item->client != op.origin.client || op.origin.clock + op.length != item->clock) {
+                if (op.length) {
+                    handler(context, &op);
+                }
+                op.id.client = crdt->client;
+                op.id.clock = ++crdt->clock;
+                op.origin.client = item->client;
+                op.origin.clock = item->clock;
+                op.length = 0;
+            }
+            op.length += item->length;
+            item->deleter = op.id.client;
+            item->deleted_at = op.id.clock;
+            length -= item->length;
+            fs_crdt_refresh(&cursor.leaf->node);
+        }
+        if (length) {
+            fs_crdt_advance(&cursor);
+        }
+    }
+    handler(context, &op);
+    fs_crdt_observe(crdt, crdt->client, crdt->clock);
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_crdt_apply_insert(fs_crdt_t* crdt, const fs_crdt_op_t* op, fs_crdt_range_handler_t handler,
+                                       void* context) {
+    fs_crdt_item_t item = { 0 };
+    fs_crdt_cursor_t cursor = { crdt->first, 0 };
+    fs_crdt_id_t id = op->id;
+    uint32_t offset = 0;
+    bool at_origin = true;
+    fs_error_t error;
+    
+    if (op->origin.clock && !fs_crdt_lookup(crdt, op->origin, &cursor)) {
+        return FS_ERROR_NOT_FOUND;
+    }
+    error = fs_crdt_reserve(crdt, op->origin.clock ? op->origin.client : op->id.client, op->id.client);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    item.client = id.client;
+    item.clock = id.clock;
+    item.length = op->length;
+    item.origin_client = op->origin.client;
+    item.origin_clock = op->origin.clock;
+    
+    if (op->origin.clock) {
+        fs_crdt_item_t* left = &cursor.leaf->items[cursor.index];
+        
+        offset = op->origin.clock - left->clock;
+        if (offset + 1 < left->length) {
+            fs_crdt_split(crdt, &cursor, offset + 1);
+        } else if (!fs_crdt_advance(&cursor)) {
+            cursor.index = cursor.leaf->node.count;
+        }
+    }
+    
+    // Skip runs inserted after the same origin by later or concurrent operations that win.
+    while (cursor.index < cursor.leaf->node.count && fs_crdt_precedes(&cursor.leaf->items[cursor.index], id)) {
+        at_origin = false;
+        if (!fs_crdt_advance(&cursor)) {
+            cursor.index = cursor.leaf->node.count;
+        }
+    }
+    
+    if (at_origin && op->origin.clock && cursor.index > 0) {
+        fs_crdt_item_t* left = &cursor.leaf->items[cursor.index - 1];
+        
+        if (left->client == id.client && op->origin.client == id.client && left->clock + left->length == id.clock &&
+            left->clock + left->length - 1 == op->origin.clock && !left->deleted_at) {
+            left->length += op->length;
+            cursor.index--;
+            fs_crdt_refresh(&cursor.leaf->node);
+            if (handler) {
+                handler(context, fs_crdt_position(&cursor) + left->length - op->length, op->length);
+            }
+            return FS_ERROR_NONE;
+        }
+    }
+    fs_crdt_insert_item(crdt, &cursor, &item);
+    if (handler) {
+        handler(context, fs_crdt_position(&cursor), op->length);
+    }
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_crdt_apply_delete(fs_crdt_t* crdt, const fs_crdt_op_t* op, fs_crdt_range_handler_t handler,
+                                       void* context) {
+    fs_crdt_id_t target = op->origin;
+    uint32_t end = target.clock + op->length;
+    fs_crdt_cursor_t cursor;
+    fs_error_t error;
+    
+    // Every character must be known before anything changes.
+    for (fs_crdt_id_t at = target; at.clock < end;) {
+        const fs_crdt_item_t* item;
+        
+        if (!fs_crdt_lookup(crdt, at, &cursor)) {
+            return FS_ERROR_NOT_FOUND;
+        }
+        item = &cursor.leaf->items[cursor.index];
+        at.clock = item->clock + item->length;
+    }
+    error = fs_crdt_reserve(crdt, target.client, op->id.client);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    fs_crdt_lookup(crdt, (fs_crdt_id_t){ target.client, end - 1 }, &cursor);
+    if (end < cursor.leaf->items[cursor.index].clock + cursor.leaf->items[cursor.index].length) {
+        fs_crdt_split(crdt, &cursor, end - cursor.leaf->items[cursor.index].clock);
+    }
+    fs_crdt_lookup(crdt, target, &cursor);
+    if (target.clock > cursor.leaf->items[cursor.index].clock) {
+        fs_crdt_split(crdt, &cursor, target.clock - cursor.leaf->items[cursor.index].clock);
+    }
+    
+    for (fs_crdt_id_t at = target; at.clock < end;) {
+        fs_crdt_item_t* item;
+        
+        fs_crdt_lookup(crdt, at, &cursor);
+        item = &cursor.leaf->items[cursor.index];
+        if (!item->deleted_at) {
+            size_t position = fs_crdt_position(&cursor);
+            
+            item->deleter = op->id.client;
+            item->deleted_at = op->id.clock;
+            fs_crdt_refresh(&cursor.leaf->node);
+            if (handler) {
+                handler(context, position, item->length);
+            }
+        }
+        at.clock = item->clock + item->length;
+    }
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_crdt_apply(fs_crdt_t* crdt, const fs_crdt_op_t* op, fs_crdt_range_handler_t handler, void* context) {
+    fs_error_t error;
+    
+    if (!op || !op->id.client || !op->id.clock || !op->length || op->id.clock > UINT32_MAX - op->length ||
+        (op->kind != FS_CRDT_INSERT && op->kind != FS_CRDT_DELETE)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (op->kind == FS_CRDT_DELETE && (!op->origin.clock || op->origin.clock > UINT32_MAX - op->length)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    // Clocks of one client only grow, so anything at or below its version was applied.
+    if (op->id.clock <= fs_crdt_version(crdt, op->id.client)) {
+        return FS_ERROR_NONE;
+    }
+    
+    error = op->kind == FS_CRDT_INSERT ? fs_crdt_apply_insert(crdt, op, handler, context)
+                                       : fs_crdt_apply_delete(crdt, op, handler, context);
+    if (error == FS_ERROR_NONE) {
+        fs_crdt_observe(crdt, op->id.client, op->kind == FS_CRDT_INSERT ? op->id.clock + op->length - 1
+                                                                        : op->id.clock);
+    }
+    return error;
+}
+
+static uint32_t fs_crdt_stable(const fs_crdt_id_t* stable, size_t count, uint32_t client) {
+    for (size_t i = 0; i < count; i++) {
+        if (stable[i].client == client) {
+            return stable[i].clock;
+        }
+    }
+    return 0;
+}
+
+/* Whether `right` continues `left`, directly after it and in the same state. */
+static bool fs_crdt_mergeable(const fs_crdt_item_t* left, const fs_crdt_item_t* right) {
+    return left->client == right->client && left->clock + left->length == right->clock &&
+           right->origin_client == left->client && right->origin_clock == right->clock - 1 &&
+           left->deleter == right->deleter && left->deleted_at == right->deleted_at;
+}
+
+static int fs_crdt_entry_compare(const void* a, const void* b) {
+    uint32_t x = ((const fs_crdt_entry_t*)a)->clock, y = ((const fs_crdt_entry_t*)b)->clock;
+    return (x > y) - (x < y);
+}
+
+/* The replacement tree and index fs_crdt_collect() builds before swapping them in. */
+typedef struct {
+    fs_crdt_node_t** level;     // the root once built
+    size_t nodes;
+    fs_crdt_leaf_t* first;
+    fs_crdt_chunk_t*** chunks;
+    size_t* chunk_counts;
+    size_t clients;
+} fs_crdt_rebuild_t;
+
+/* Releases the scaffolding, and with `contents` the nodes and chunks too. */
+static void fs_crdt_rebuild_free(fs_crdt_rebuild_t* rebuild, bool contents) {
+    if (contents && rebuild->level) {
+        for (size_t i = 0; i < rebuild->nodes; i++) {
+            if (rebuild->level[i]) {
+                fs_crdt_node_free(rebuild->level[i]);
+            }
+        }
+    }
+    free(rebuild->level);
+    if (rebuild->chunks) {
+        for (size_t c = 0; contents && c < rebuild->clients; c++) {
+            if (rebuild->chunks[c]) {
+                for (size_t k = 0; k < rebuild->chunk_counts[c]; k++) {
+                    free(rebuild->chunks[c][k]);
+                }
+                free(rebuild->chunks[c]);
+            }
+        }
+    }
+    free(rebuild->chunks);
+    free(rebuild->chunk_counts);
+}
+
+/* Packs `n` runs into leaves and branches three quarters full, so the next edits do not split at once. */
+static bool fs_crdt_rebuild_tree(fs_crdt_rebuild_t* rebuild, const fs_crdt_item_t* items, size_t n) {
+    const size_t leaf_fill = FS_CRDT_LEAF_ITEMS * 3 / 4;
+    const size_t branch_fill = FS_CRDT_FANOUT * 3 / 4;
+    size_t nodes = n ? (n + leaf_fill - 1) / leaf_fill : 1;
+    fs_crdt_node_t** level = calloc(nodes, sizeof(*level));
+    
+    if (!level) {
+        return false;
+    }
+    rebuild->level = level;
+    rebuild->nodes = nodes;
+    for (size_t i = 0; i < nodes; i++) {
+        if (!(level[i] = (fs_crdt_node_t*)fs_crdt_leaf_new())) {
+            return false;
+        }
+    }
+    for (size_t i = 0, at = 0; i < nodes; i++) {
+        fs_crdt_leaf_t* leaf = (fs_crdt_leaf_t*)level[i];
+        size_t take = n - at < leaf_fill ? n - at : leaf_fill;
+        
+        memcpy(leaf->items, items + at, take * sizeof(*items));
+        leaf->node.count = (uint32_t)take;
+        leaf->node.visible = fs_crdt_sum(&leaf->node);
+        leaf->next = i + 1 < nodes ? (fs_crdt_leaf_t*)level[i + 1] : NULL;
+        at += take;
+    }
+    rebuild->first = (fs_crdt_leaf_t*)level[0];
+    
+    while (nodes > 1) {
+        size_t parents = (nodes + branch_fill - 1) / branch_fill;
+        
+        for (size_t p = 0; p < parents; p++) {
+            fs_crdt_branch_t* branch = calloc(1, sizeof(*branch));
+            size_t take, from = p * branch_fill;
+            
+            if (!branch) {
+                // Built parents own their children; keep them and the nodes not taken yet.
+                memmove(level + p, level + from, (nodes - from) * sizeof(*level));
+                rebuild->nodes = p + nodes - from;
+                return false;
+            }
+            take = nodes - from < branch_fill ? nodes - from : branch_fill;
+            branch->node.height = level[from]->height + 1;
+            branch->node.count = (uint32_t)take;
+            for (size_t k = 0; k < take; k++) {
+                branch->children[k] = level[from + k];
+                branch->child_visible[k] = level[from + k]->visible;
+                level[from + k]->parent = branch;
+            }
+            branch->node.visible = fs_crdt_sum(&branch->node);
+            level[p] = &branch->node;
+        }
+        nodes = parents;
+        rebuild->nodes = nodes;
+    }
+    return true;
+}
+
+/* Builds every client's index over the new leaves, chunks three quarters full. */
+static bool fs_crdt_rebuild_index(fs_crdt_rebuild_t* rebuild, const fs_crdt_t* crdt, size_t n) {
+    const size_t chunk_fill = FS_CRDT_INDEX_CHUNK * 3 / 4;
+    fs_crdt_entry_t* sorted = malloc((n ? n : 1) * sizeof(*sorted));
+    size_t* offsets = calloc(crdt->client_count + 1, sizeof(*offsets));
+    bool ok = false;
+    
+    rebuild->clients = crdt->client_count;
+    rebuild->chunks = calloc(crdt->client_count ? crdt->client_count : 1, sizeof(*rebuild->chunks));
+    rebuild->chunk_counts = calloc(crdt->client_count ? crdt->client_count : 1, sizeof(*rebuild->chunk_counts));
+    if (!sorted || !offsets || !rebuild->chunks || !rebuild->chunk_counts) {
+        goto done;
+    }
+    
+    // Group the entries by client, then sort each group by clock.
+    for (fs_crdt_leaf_t* leaf = rebuild->first; leaf; leaf = leaf->next) {
+        for (uint32_t i = 0; i < leaf->node.count; i++) {
+            offsets[fs_crdt_find_client(crdt, leaf->items[i].client) - crdt->clients + 1]++;
+        }
+    }
+    for (size_t c = 0; c < crdt->client_count; c++) {
+        offsets[c + 1] += offsets[c];
+    }
+    for (fs_crdt_leaf_t* leaf = rebuild->first; leaf; leaf = leaf->next) {
+        for (uint32_t i = 0; i < leaf->node.count; i++) {
+            size_t c = fs_crdt_find_client(crdt, leaf->items[i].client) - crdt->clients;
+            sorted[offsets[c]].clock = leaf->items[i].clock;
+            sorted[offsets[c]++].leaf = leaf;
+        }
+    }
+    
+    for (size_t c = 0, start = 0; c < crdt->client_count; start = offsets[c], c++) {
+        size_t count = offsets[c] - start;
+        size_t chunks = (count + chunk_fill - 1) / chunk_fill;
+        
+        qsort(sorted + start, count, sizeof(*sorted), fs_crdt_entry_compare);
+        rebuild->chunks[c] = malloc((chunks + FS_CRDT_MAX_INSERTS) * 2 * sizeof(**rebuild->chunks));
+        if (!rebuild->chunks[c]) {
+            goto done;
+        }
+        for (size_t k = 0; k < chunks; k++) {
+            fs_crdt_chunk_t* chunk = malloc(sizeof(*chunk));
+            size_t take = count - k * chunk_fill < chunk_fill ? count - k * chunk_fill : chunk_fill;
+            
+            if (!chunk) {
+                goto done;
+            }
+            memcpy(chunk->entries, sorted + start + k * chunk_fill, take * sizeof(*sorted));
+            chunk->count = (uint32_t)take;
+            rebuild->chunks[c][k] = chunk;
+            rebuild->chunk_counts[c]++;
+        }
+    }
+    ok = true;
+    
+done:
+    free(sorted);
+    free(offsets);
+    return ok;
+}
+
+/* Replaces the tree and index with rebuilt ones of `n` runs. */
+static void fs_crdt_install(fs_crdt_t* crdt, fs_crdt_rebuild_t* rebuild, size_t n) {
+    fs_crdt_node_free(crdt->root);
+    crdt->root = rebuild->level[0];
+    crdt->first = rebuild->first;
+    crdt->runs = n;
+    for (size_t c = 0; c < crdt->client_count; c++) {
+        fs_crdt_client_t* client = &crdt->clients[c];
+        
+        for (size_t k = 0; k < client->chunk_count; k++) {
+            free(client->chunks[k]);
+        }
+        free(client->chunks);
+        client->chunks = rebuild->chunks[c];
+        client->chunk_count = rebuild->chunk_counts[c];
+        client->chunk_capacity = (client->chunk_count + FS_CRDT_MAX_INSERTS) * 2;
+    }
+    fs_crdt_rebuild_free(rebuild, false);
+}
+
+/*
+ Collection rebuilds the tree from the surviving runs, merged where they
+ continue each other, and the index from the new leaves. Everything is
+ allocated before the old tree is released.
+ */
+fs_error_t fs_crdt_collect(fs_crdt_t* crdt, const fs_crdt_id_t* stable, size_t count) {
+    fs_crdt_item_t* items = malloc((crdt->runs ? crdt->runs : 1) * sizeof(*items));
+    fs_crdt_rebuild_t rebuild = { 0 };
+    size_t n = 0;
+    
+    if (!items) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (fs_crdt_leaf_t* leaf = crdt->first; leaf; leaf = leaf->next) {
+        for (uint32_t i = 0; i < leaf->node.count; i++) {
+            const fs_crdt_item_t* item = &leaf->items[i];
+            
+            if (item->deleted_at && item->clock + item->length - 1 <= fs_crdt_stable(stable, count, item->client) &&
+                item->deleted_at <= fs_crdt_stable(stable, count, item->deleter)) {
+                continue;
+            }
+            if (n && fs_crdt_mergeable(&items[n - 1], item)) {
+                items[n - 1].length += item->length;
+            } else {
+                items[n++] = *item;
+            }
+        }
+    }
+    if (!fs_crdt_rebuild_tree(&rebuild, items, n) ||
+        !fs_crdt_rebuild_index(&rebuild, crdt, n)) {
+        fs_crdt_rebuild_free(&rebuild, true);
+        free(items);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    free(items);
+    fs_crdt_install(crdt, &rebuild, n);
+    return FS_ERROR_NONE;
+}
+
+static size_t fs_crdt_put_varint(uint8_t* p, uint32_t value) {
+    size_t n = 0;
+    
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool fs_crdt_get_varint(const uint8_t** p, const uint8_t* end, uint32_t* value) {
+    uint32_t result = 0;
+    
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        uint8_t byte;
+        
+        if (*p == end) {
+            return false;
+        }
+        byte = *(*p)++;
+        if (shift == 28 && byte > 0x0F) {
+            return false;
+        }
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ Encoding: varints of the Lamport clock, the client count, per client its id
+ and version, the run count, and per run in document order its client,
+ clock, length, origin client and clock, deleter and deletion clock.
+ */
+fs_error_t fs_crdt_encode(const fs_crdt_t* crdt, uint8_t** bytes, size_t* length) {
+    const size_t run_max = 7 * 5, client_max = 2 * 5;
+    uint8_t* p;
+    size_t n = 0;
+    
+    if (!bytes || !length) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *bytes = NULL;
+    *length = 0;
+    if (crdt->runs > (SIZE_MAX - 15) / 2 / run_max || crdt->client_count > (SIZE_MAX - 15) / 2 / client_max) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    p = malloc(15 + crdt->client_count * client_max + crdt->runs * run_max);
+    if (!p) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    n += fs_crdt_put_varint(p + n, crdt->clock);
+    n += fs_crdt_put_varint(p + n, (uint32_t)crdt->client_count);
+    for (size_t c = 0; c < crdt->client_count; c++) {
+        n += fs_crdt_put_varint(p + n, crdt->clients[c].client);
+        n += fs_crdt_put_varint(p + n, crdt->clients[c].version);
+    }
+    n += fs_crdt_put_varint(p + n, (uint32_t)crdt->runs);
+    for (fs_crdt_leaf_t* leaf = crdt->first; leaf; leaf = leaf->next) {
+        for (uint32_t i = 0; i < leaf->node.count; i++) {
+            const fs_crdt_item_t* item = &leaf->items[i];
+            
+            n += fs_crdt_put_varint(p + n, item->client);
+            n += fs_crdt_put_varint(p + n, item->clock);
+            n += fs_crdt_put_varint(p + n, item->length);
+            n += fs_crdt_put_varint(p + n, item->origin_client);
+            n += fs_crdt_put_varint(p + n, item->origin_clock);
+            n += fs_crdt_put_varint(p + n, item->deleter);
+            n += fs_crdt_put_varint(p + n, item->deleted_at);
+        }
+    }
+    *bytes = p;
+    *length = n;
+    return FS_ERROR_NONE;
+}
+
+/* Reads the clients of an encoding into an empty replica. */
+static fs_error_t fs_crdt_decode_clients(fs_crdt_t* crdt, const uint8_t** p, const uint8_t* end) {
+    uint32_t count;
+    
+    if (!fs_crdt_get_varint(p, end, &crdt->clock) || !fs_crdt_get_varint(p, end, &count) ||
+        count > (size_t)(end - *p) / 2) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    crdt->clients = calloc(count ? count : 1, sizeof(*crdt->clients));
+    if (!crdt->clients) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    crdt->client_capacity = count ? count : 1;
+    for (uint32_t c = 0; c < count; c++) {
+        fs_crdt_client_t* client = &crdt->clients[c];
+        
+        if (!fs_crdt_get_varint(p, end, &client->client) || !fs_crdt_get_varint(p, end, &client->version) ||
+            !client->client || (c && client->client <= crdt->clients[c - 1].client)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        crdt->client_count++;
+    }
+    return FS_ERROR_NONE;
+}
+
+/* Reads the runs of an encoding; each must belong to a listed client, within its version. */
+static fs_error_t fs_crdt_decode_items(const fs_crdt_t* crdt, const uint8_t** p, const uint8_t* end,
+                                       fs_crdt_item_t** out, size_t* count) {
+    fs_crdt_item_t* items;
+    uint32_t n;
+    
+    if (!fs_crdt_get_varint(p, end, &n) || n > (size_t)(end - *p) / 7) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    items = malloc((n ? n : 1) * sizeof(*items));
+    if (!items) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        fs_crdt_item_t* item = &items[i];
+        const fs_crdt_client_t* client;
+        
+        if (!fs_crdt_get_varint(p, end, &item->client) || !fs_crdt_get_varint(p, end, &item->clock) ||
+            !fs_crdt_get_varint(p, end, &item->length) || !fs_crdt_get_varint(p, end, &item->origin_client) ||
+            !fs_crdt_get_varint(p, end, &item->origin_clock) || !fs_crdt_get_varint(p, end, &item->deleter) ||
+            !fs_crdt_get_varint(p, end, &item->deleted_at) || !(client = fs_crdt_find_client(crdt, item->client)) ||
+            !item->clock || !item->length || item->clock - 1 > client->version - item->length ||
+            item->length > client->version) {
+            free(items);
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+    }
+    *out = items;
+    *count = n;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_crdt_decode(uint32_t client, const uint8_t* bytes, size_t length, fs_crdt_t** out) {
+    const uint8_t* p = bytes;
+    const uint8_t* end = bytes + length;
+    fs_crdt_rebuild_t rebuild = { 0 };
+    fs_crdt_item_t* items = NULL;
+    fs_crdt_t* crdt;
+    size_t n = 0;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!bytes && length) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    error = fs_crdt_create(client, &crdt);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    error = fs_crdt_decode_clients(crdt, &p, end);
+    if (error == FS_ERROR_NONE) {
+        error = fs_crdt_decode_items(crdt, &p, end, &items, &n);
+    }
+    if (error == FS_ERROR_NONE && p != end) {
+        error = FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (error == FS_ERROR_NONE &&
+        (!fs_crdt_rebuild_tree(&rebuild, items, n) || !fs_crdt_rebuild_index(&rebuild, crdt, n))) {
+        fs_crdt_rebuild_free(&rebuild, true);
+        error = FS_ERROR_OUT_OF_MEMORY;
+    }
+    free(items);
+    if (error != FS_ERROR_NONE) {
+        fs_crdt_destroy(crdt);
+        return error;
+    }
+    fs_crdt_install(crdt, &rebuild, n);
+    *out = crdt;
+    return FS_ERROR_NONE;
+}
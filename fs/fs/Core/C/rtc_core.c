@@ -28,3 +28,861 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ Invariants: all children of a branch have the same height, and of two
+ neighbouring siblings at most one is less than half full. Edits that change
+ structure build new nodes for the path they touch and swap the root only
+ once everything is allocated, so a failed edit leaves the rope unchanged.
+ Edits that stay inside one leaf, on a path no snapshot shares, update it in
+ place; that is the keystroke case.
+ */
+
+struct fs_rope_node {
+    _Atomic uint32_t refs;
+    uint32_t height;        // 0 for leaves
+    size_t bytes;
+    size_t lines;           // '\n' bytes in the subtree
+};
+
+typedef struct {
+    fs_rope_node_t node;
+    unsigned char data[FS_ROPE_LEAF_MAX];
+} fs_rope_leaf_t;
+
+typedef struct {
+    fs_rope_node_t node;
+    size_t count;
+    size_t child_bytes[FS_ROPE_FANOUT];
+    size_t child_lines[FS_ROPE_FANOUT];
+    fs_rope_node_t* children[FS_ROPE_FANOUT];
+} fs_rope_branch_t;
+
+struct fs_rope {
+    fs_rope_node_t* root;
+};
+
+#define FS_ROPE_LEAF(n) ((fs_rope_leaf_t*)(n))
+#define FS_ROPE_BRANCH(n) ((fs_rope_branch_t*)(n))
+#define FS_ROPE_CONST_LEAF(n) ((const fs_rope_leaf_t*)(n))
+#define FS_ROPE_CONST_BRANCH(n) ((const fs_rope_branch_t*)(n))
+
+static size_t fs_rope_count_lines(const unsigned char* p, size_t len) {
+    const unsigned char* end = p + len;
+    size_t lines = 0;
+    
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p)))) {
+        lines++;
+        p++;
+    }
+    return lines;
+}
+
+static fs_rope_leaf_t* fs_rope_leaf_new(void) {
+    fs_rope_leaf_t* leaf = malloc(sizeof(*leaf));
+    
+    if (leaf) {
+        atomic_init(&leaf->node.refs, 1);
+        leaf->node.height = 0;
+        leaf->node.bytes = 0;
+        leaf->node.lines = 0;
+    }
+    return leaf;
+}
+
+static fs_rope_branch_t* fs_rope_branch_new(uint32_t height) {
+    fs_rope_branch_t* branch = malloc(sizeof(*branch));
+    
+    if (branch) {
+        atomic_init(&branch->node.refs, 1);
+        branch->node.height = height;
+        branch->node.bytes = 0;
+        branch->node.lines = 0;
+        branch->count = 0;
+    }
+    return branch;
+}
+
+static inline fs_rope_node_t* fs_rope_retain(fs_rope_node_t* node) {
+    atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+    return node;
+}
+
+static void fs_rope_release(fs_rope_node_t* node) {
+    if (!node || atomic_fetch_sub_explicit(&node->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+    if (node->height) {
+        fs_rope_branch_t* branch = FS_ROPE_BRANCH(node);
+        for (size_t i = 0; i < branch->count; i++) {
+            fs_rope_release(branch->children[i]);
+        }
+    }
+    free(node);
+}
+
+/* Adds an owned child; the branch must have room. */
+static void fs_rope_branch_append(fs_rope_branch_t* branch, fs_rope_node_t* child) {
+    size_t i = branch->count++;
+    
+    branch->children[i] = child;
+    branch->child_bytes[i] = child->bytes;
+    branch->child_lines[i] = child->lines;
+    branch->node.bytes += child->bytes;
+    branch->node.lines += child->lines;
+}
+
+static inline bool fs_rope_is_small(const fs_rope_node_t* node) {
+    return node->height ? FS_ROPE_CONST_BRANCH(node)->count < FS_ROPE_FANOUT / 2
+                        : node->bytes < FS_ROPE_LEAF_MAX / 2;
+}
+
+#define FS_ROPE_VEC_INLINE (FS_ROPE_FANOUT * 2)
+
+/* Owned references to nodes of one height, in document order. */
+typedef struct {
+    fs_rope_node_t** items;
+    size_t count;
+    size_t capacity;
+    fs_rope_node_t* inline_items[FS_ROPE_VEC_INLINE];
+} fs_rope_vec_t;
+
+static void fs_rope_vec_init(fs_rope_vec_t* vec) {
+    vec->items = vec->inline_items;
+    vec->count = 0;
+    vec->capacity = FS_ROPE_VEC_INLINE;
+}
+
+static bool fs_rope_vec_reserve(fs_rope_vec_t* vec, size_t extra) {
+    size_t needed = vec->count + extra;
+    size_t capacity = vec->capacity;
+    fs_rope_node_t** items;
+    
+    if (needed <= capacity) {
+        return true;
+    }
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    if (vec->items == vec->inline_items) {
+        items = malloc(capacity * sizeof(*items));
+        if (items) {
+            memcpy(items, vec->inline_items, vec->count * sizeof(*items));
+        }
+    } else {
+        items = realloc(vec->items, capacity * sizeof(*items));
+    }
+    if (!items) {
+        return false;
+    }
+    vec->items = items;
+    vec->capacity = capacity;
+    return true;
+}
+
+/* Releases every node and the storage; the list can be reused after init. */
+static void fs_rope_vec_release(fs_rope_vec_t* vec) {
+    for (size_t i = 0; i < vec->count; i++) {
+        fs_rope_release(vec->items[i]);
+    }
+    if (vec->items != vec->inline_items) {
+        free(vec->items);
+    }
+    fs_rope_vec_init(vec);
+}
+
+/* Frees the storage only, after the nodes were handed over. */
+static void fs_rope_vec_forget(fs_rope_vec_t* vec) {
+    if (vec->items != vec->inline_items) {
+        free(vec->items);
+    }
+    fs_rope_vec_init(vec);
+}
+
+typedef struct {
+    const unsigned char* ptr;
+    size_t len;
+} fs_rope_segment_t;
+
+/* Appends evenly filled leaves holding the concatenated segments. */
+static fs_error_t fs_rope_emit_leaves(const fs_rope_segment_t* segments, size_t count, fs_rope_vec_t* out) {
+    size_t total = 0, pieces, segment = 0, position = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        total += segments[i].len;
+    }
+    if (!total) {
+        return FS_ERROR_NONE;
+    }
+    pieces = (total + FS_ROPE_LEAF_MAX - 1) / FS_ROPE_LEAF_MAX;
+    if (!fs_rope_vec_reserve(out, pieces)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    for (size_t k = 0; k < pieces; k++) {
+        size_t size = total / pieces + (k < total % pieces);
+        fs_rope_leaf_t* leaf = fs_rope_leaf_new();
+        
+        if (!leaf) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        while (leaf->node.bytes < size) {
+            size_t take = segments[segment].len - position;
+            
+            if (take > size - leaf->node.bytes) {
+                take = size - leaf->node.bytes;
+            }
+            memcpy(leaf->data + leaf->node.bytes, segments[segment].ptr + position, take);
+            leaf->node.bytes += take;
+            position += take;
+            if (position == segments[segment].len) {
+                segment++;
+                position = 0;
+            }
+        }
+        leaf->node.lines = fs_rope_count_lines(leaf->data, size);
+        out->items[out->count++] = &leaf->node;
+    }
+    return FS_ERROR_NONE;
+}
+
+/*
+ Groups the nodes of `children` into evenly filled branches of height
+ `height` appended to `out`. Consumes `children` on success; on failure
+ nothing was moved and both lists are left to the caller.
+ */
+static fs_error_t fs_rope_build_branches(fs_rope_vec_t* children, uint32_t height, fs_rope_vec_t* out) {
+    size_t count = children->count;
+    size_t pieces = (count + FS_ROPE_FANOUT - 1) / FS_ROPE_FANOUT;
+    size_t first = out->count, next = 0;
+    
+    if (!fs_rope_vec_reserve(out, pieces)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t k = 0; k < pieces; k++) {
+        fs_rope_branch_t* branch = fs_rope_branch_new(height);
+        
+        if (!branch) {
+            while (out->count > first) {
+                free(out->items[--out->count]);
+            }
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        out->items[out->count++] = &branch->node;
+    }
+    
+    for (size_t k = 0; k < pieces; k++) {
+        fs_rope_branch_t* branch = FS_ROPE_BRANCH(out->items[first + k]);
+        size_t size = count / pieces + (k < count % pieces);
+        
+        for (size_t i = 0; i < size; i++) {
+            fs_rope_branch_append(branch, children->items[next++]);
+        }
+    }
+    fs_rope_vec_forget(children);
+    return FS_ERROR_NONE;
+}
+
+/* Reduces `nodes` to a single root, consuming the list; an empty list gives an empty leaf. */
+static fs_error_t fs_rope_collapse(fs_rope_vec_t* nodes, fs_rope_node_t** root) {
+    while (nodes->count > 1) {
+        fs_rope_vec_t parents;
+        fs_error_t error;
+        
+        fs_rope_vec_init(&parents);
+        error = fs_rope_build_branches(nodes, nodes->items[0]->height + 1, &parents);
+        if (error != FS_ERROR_NONE) {
+            fs_rope_vec_release(nodes);
+            return error;
+        }
+        *nodes = parents;
+        if (parents.items == parents.inline_items) {
+            nodes->items = nodes->inline_items;
+        }
+    }
+    
+    if (nodes->count) {
+        *root = nodes->items[0];
+        fs_rope_vec_forget(nodes);
+        return FS_ERROR_NONE;
+    }
+    fs_rope_vec_forget(nodes);
+    *root = (fs_rope_node_t*)fs_rope_leaf_new();
+    return *root ? FS_ERROR_NONE : FS_ERROR_OUT_OF_MEMORY;
+}
+
+/*
+ Merges or evens out neighbours of which one is less than half full. The two
+ nodes are replaced by one or two new nodes holding the same bytes.
+ */
+static fs_error_t fs_rope_rebalance(fs_rope_vec_t* nodes) {
+    size_t write = 0;
+    
+    for (size_t read = 0; read < nodes->count; read++) {
+        fs_rope_node_t* node = nodes->items[read];
+        fs_rope_node_t* left = write ? nodes->items[write - 1] : NULL;
+        fs_rope_vec_t pair;
+        fs_error_t error = FS_ERROR_NONE;
+        
+        if (!left || (!fs_rope_is_small(left) && !fs_rope_is_small(node))) {
+            nodes->items[write++] = node;
+            continue;
+        }
+        
+        fs_rope_vec_init(&pair);
+        if (!node->height) {
+            fs_rope_segment_t segments[2] = {
+                { FS_ROPE_LEAF(left)->data, left->bytes },
+                { FS_ROPE_LEAF(node)->data, node->bytes },
+            };
+            error = fs_rope_emit_leaves(segments, 2, &pair);
+        } else {
+            fs_rope_vec_t children;
+            fs_rope_branch_t* a = FS_ROPE_BRANCH(left);
+            fs_rope_branch_t* b = FS_ROPE_BRANCH(node);
+            
+            fs_rope_vec_init(&children);
+            for (size_t i = 0; i < a->count; i++) {
+                children.items[children.count++] = fs_rope_retain(a->children[i]);
+            }
+            for (size_t i = 0; i < b->count; i++) {
+                children.items[children.count++] = fs_rope_retain(b->children[i]);
+            }
+            error = fs_rope_build_branches(&children, node->height, &pair);
+            if (error != FS_ERROR_NONE) {
+                fs_rope_vec_release(&children);
+            }
+        }
+        
+        if (error != FS_ERROR_NONE) {
+            fs_rope_vec_release(&pair);
+            // Keep the list whole so the caller can release it.
+            memmove(nodes->items + write, nodes->items + read, (nodes->count - read) * sizeof(*nodes->items));
+            nodes->count = write + nodes->count - read;
+            return error;
+        }
+        
+        fs_rope_release(left);
+        fs_rope_release(node);
+        nodes->items[write - 1] = pair.items[0];
+        if (pair.count > 1) {
+            nodes->items[write++] = pair.items[1];
+        }
+        fs_rope_vec_forget(&pair);
+    }
+    nodes->count = write;
+    return FS_ERROR_NONE;
+}
+
+/* Picks the child an offset falls in, preferring the left one at a boundary. */
+static size_t fs_rope_child_for_insert(const fs_rope_branch_t* branch, size_t* offset) {
+    size_t i = 0;
+    
+    while (i + 1 < branch->count && *offset > branch->child_bytes[i]) {
+        *offset -= branch->child_bytes[i];
+        i++;
+    }
+    return i;
+}
+
+/* Picks the child holding the byte at `offset`, which must be in range. */
+static size_t fs_rope_child_for_byte(const fs_rope_branch_t* branch, size_t* offset) {
+    size_t i = 0;
+    
+    while (i + 1 < branch->count && *offset >= branch->child_bytes[i]) {
+        *offset -= branch->child_bytes[i];
+        i++;
+    }
+    return i;
+}
+
+/* Appends the nodes replacing `node` after the insert; `node` itself is not changed. */
+static fs_error_t fs_rope_insert_node(const fs_rope_node_t* node, size_t offset, const unsigned char* bytes,
+                                      size_t len, fs_rope_vec_t* out) {
+    const fs_rope_branch_t* branch;
+    fs_rope_vec_t children;
+    fs_error_t error;
+    size_t i;
+    
+    if (!node->height) {
+        const fs_rope_leaf_t* leaf = FS_ROPE_CONST_LEAF(node);
+        fs_rope_segment_t segments[3] = {
+            { leaf->data, offset },
+            { bytes, len },
+            { leaf->data + offset, node->bytes - offset },
+        };
+        return fs_rope_emit_leaves(segments, 3, out);
+    }
+    
+    branch = FS_ROPE_CONST_BRANCH(node);
+    i = fs_rope_child_for_insert(branch, &offset);
+    fs_rope_vec_init(&children);
+    for (size_t j = 0; j < i; j++) {
+        children.items[children.count++] = fs_rope_retain(branch->children[j]);
+    }
+    error = fs_rope_insert_node(branch->children[i], offset, bytes, len, &children);
+    if (error == FS_ERROR_NONE && !fs_rope_vec_reserve(&children, branch->count - i - 1)) {
+        error = FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (error == FS_ERROR_NONE) {
+        for (size_t j = i + 1; j < branch->count; j++) {
+            children.items[children.count++] = fs_rope_retain(branch->children[j]);
+        }
+        error = fs_rope_build_branches(&children, node->height, out);
+    }
+    if (error != FS_ERROR_NONE) {
+        fs_rope_vec_release(&children);
+    }
+    return error;
+}
+
+/* Builds `node` without [offset, offset + len), or NULL if nothing is left; `node` is not changed. */
+static fs_error_t fs_rope_delete_node(const fs_rope_node_t* node, size_t offset, size_t len,
+                                      fs_rope_node_t** out) {
+    const fs_rope_branch_t* branch;
+    fs_rope_vec_t children;
+    fs_error_t error = FS_ERROR_NONE;
+    size_t start = 0;
+    
+    *out = NULL;
+    if (len == node->bytes) {
+        return FS_ERROR_NONE;
+    }
+    
+    if (!node->height) {
+        const fs_rope_leaf_t* leaf = FS_ROPE_CONST_LEAF(node);
+        fs_rope_segment_t segments[2] = {
+            { leaf->data, offset },
+            { leaf->data + offset + len, node->bytes - offset - len },
+        };
+        fs_rope_vec_init(&children);
+        error = fs_rope_emit_leaves(segments, 2, &children);
+        if (error == FS_ERROR_NONE) {
+            *out = children.items[0];
+            fs_rope_vec_forget(&children);
+        } else {
+            fs_rope_vec_release(&children);
+        }
+        return error;
+    }
+    
+    branch = FS_ROPE_CONST_BRANCH(node);
+    fs_rope_vec_init(&children);
+    for (size_t i = 0; i < branch->count && error == FS_ERROR_NONE; i++) {
+        size_t end = start + branch->child_bytes[i];
+        
+        if (end <= offset || start >= offset + len) {
+            children.items[children.count++] = fs_rope_retain(branch->children[i]);
+        } else if (start < offset || end > offset + len) {
+            size_t from = offset > start ? offset - start : 0;
+            size_t to = (offset + len < end ? offset + len : end) - start;
+            fs_rope_node_t* child;
+            
+            error = fs_rope_delete_node(branch->children[i], from, to - from, &child);
+            if (error == FS_ERROR_NONE) {
+                children.items[children.count++] = child;
+            }
+        }
+        start = end;
+    }
+    if (error == FS_ERROR_NONE) {
+        error = fs_rope_rebalance(&children);
+    }
+    if (error == FS_ERROR_NONE && children.count) {
+        fs_rope_vec_t result;
+        
+        fs_rope_vec_init(&result);
+        error = fs_rope_build_branches(&children, node->height, &result);
+        if (error == FS_ERROR_NONE) {
+            *out = result.items[0];
+            fs_rope_vec_forget(&result);
+            return FS_ERROR_NONE;
+        }
+    }
+    fs_rope_vec_release(&children);
+    return error;
+}
+
+typedef struct {
+    fs_rope_branch_t* branches[FS_ROPE_MAX_DEPTH];
+    size_t slots[FS_ROPE_MAX_DEPTH];
+    size_t depth;
+    fs_rope_leaf_t* leaf;
+    size_t offset;      // within `leaf`
+} fs_rope_path_t;
+
+/* Finds the leaf for an edit if no node on the way is shared. */
+static bool fs_rope_unique_path(fs_rope_t* rope, size_t offset, bool for_insert, fs_rope_path_t* path) {
+    fs_rope_node_t* node = rope->root;
+    
+    path->depth = 0;
+    while (node->height) {
+        fs_rope_branch_t* branch = FS_ROPE_BRANCH(node);
+        size_t i;
+        
+        if (atomic_load_explicit(&node->refs, memory_order_acquire) != 1 || path->depth == FS_ROPE_MAX_DEPTH) {
+            return false;
+        }
+        i = for_insert ? fs_rope_child_for_insert(branch, &offset) : fs_rope_child_for_byte(branch, &offset);
+        path->branches[path->depth] = branch;
+        path->slots[path->depth++] = i;
+        node = branch->children[i];
+    }
+    if (atomic_load_explicit(&node->refs, memory_order_acquire) != 1) {
+        return false;
+    }
+    path->leaf = FS_ROPE_LEAF(node);
+    path->offset = offset;
+    return true;
+}
+
+static void fs_rope_path_adjust(fs_rope_path_t* path, size_t bytes, size_t lines, bool grow) {
+    for (size_t d = 0; d < path->depth; d++) {
+        fs_rope_branch_t* branch = path->branches[d];
+        size_t i = path->slots[d];
+        
+        if (grow) {
+            branch->node.bytes += bytes;
+            branch->node.lines += lines;
+            branch->child_bytes[i] += bytes;
+            branch->child_lines[i] += lines;
+        } else {
+            branch->node.bytes -= bytes;
+            branch->node.lines -= lines;
+            branch->child_bytes[i] -= bytes;
+            branch->child_lines[i] -= lines;
+        }
+    }
+}
+
+static bool fs_rope_insert_in_place(fs_rope_t* rope, size_t offset, const unsigned char* bytes, size_t len) {
+    fs_rope_path_t path;
+    fs_rope_leaf_t* leaf;
+    size_t lines;
+    
+    if (!fs_rope_unique_path(rope, offset, true, &path) || path.leaf->node.bytes + len > FS_ROPE_LEAF_MAX) {
+        return false;
+    }
+    leaf = path.leaf;
+    memmove(leaf->data + path.offset + len, leaf->data + path.offset, leaf->node.bytes - path.offset);
+    memcpy(leaf->data + path.offset, bytes, len);
+    lines = fs_rope_count_lines(bytes, len);
+    leaf->node.bytes += len;
+    leaf->node.lines += lines;
+    fs_rope_path_adjust(&path, len, lines, true);
+    return true;
+}
+
+static bool fs_rope_delete_in_place(fs_rope_t* rope, size_t offset, size_t len) {
+    fs_rope_path_t path;
+    fs_rope_leaf_t* leaf;
+    size_t lines;
+    
+    if (!fs_rope_unique_path(rope, offset, false, &path)) {
+        return false;
+    }
+    leaf = path.leaf;
+    // Stay inside the leaf, and leave it at least half full unless it is the root.
+    if (path.offset + len > leaf->node.bytes ||
+        (path.depth && leaf->node.bytes - len < FS_ROPE_LEAF_MAX / 2)) {
+        return false;
+    }
+    lines = fs_rope_count_lines(leaf->data + path.offset, len);
+    memmove(leaf->data + path.offset, leaf->data + path.offset + len, leaf->node.bytes - path.offset - len);
+    leaf->node.bytes -= len;
+    leaf->node.lines -= lines;
+    fs_rope_path_adjust(&path, len, lines, false);
+    return true;
+}
+
+fs_error_t fs_rope_create(const void* bytes, size_t len, fs_rope_t** out) {
+    fs_rope_segment_t segment = { bytes, len };
+    fs_rope_vec_t leaves;
+    fs_rope_t* rope;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!bytes && len) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    rope = malloc(sizeof(*rope));
+    if (!rope) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    fs_rope_vec_init(&leaves);
+    error = fs_rope_emit_leaves(&segment, 1, &leaves);
+    if (error == FS_ERROR_NONE) {
+        error = fs_rope_collapse(&leaves, &rope->root);
+    } else {
+        fs_rope_vec_release(&leaves);
+    }
+    if (error != FS_ERROR_NONE) {
+        free(rope);
+        return error;
+    }
+    *out = rope;
+    return FS_ERROR_NONE;
+}
+
+void fs_rope_destroy(fs_rope_t* rope) {
+    if (rope) {
+        fs_rope_release(rope->root);
+        free(rope);
+    }
+}
+
+fs_error_t fs_rope_snapshot(const fs_rope_t* rope, fs_rope_t** out) {
+    fs_rope_t* snapshot;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!rope) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    snapshot = malloc(sizeof(*snapshot));
+    if (!snapshot) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    snapshot->root = fs_rope_retain(rope->root);
+    *out = snapshot;
+    return FS_ERROR_NONE;
+}
+
+size_t fs_rope_length(const fs_rope_t* rope) {
+    return rope->root->bytes;
+}
+
+size_t fs_rope_line_count(const fs_rope_t* rope) {
+    return rope->root->lines + 1;
+}
+
+bool fs_rope_shares_contents(const fs_rope_t* a, const fs_rope_t* b) {
+    return a->root == b->root;
+}
+
+fs_error_t fs_rope_insert(fs_rope_t* rope, size_t offset, const void* bytes, size_t len) {
+    fs_rope_vec_t nodes;
+    fs_rope_node_t* root;
+    fs_error_t error;
+    
+    if (!rope || offset > rope->root->bytes || (!bytes && len)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (!len || fs_rope_insert_in_place(rope, offset, bytes, len)) {
+        return FS_ERROR_NONE;
+    }
+    
+    fs_rope_vec_init(&nodes);
+    error = fs_rope_insert_node(rope->root, offset, bytes, len, &nodes);
+    if (error != FS_ERROR_NONE) {
+        fs_rope_vec_release(&nodes);
+        return error;
+    }
+    error = fs_rope_collapse(&nodes, &root);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    fs_rope_release(rope->root);
+    rope->root = root;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_rope_delete(fs_rope_t* rope, size_t offset, size_t len) {
+    fs_rope_node_t* root;
+    fs_error_t error;
+    
+    if (!rope || offset > rope->root->bytes || len > rope->root->bytes - offset) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (!len || fs_rope_delete_in_place(rope, offset, len)) {
+        return FS_ERROR_NONE;
+    }
+    
+    error = fs_rope_delete_node(rope->root, offset, len, &root);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    if (!root) {
+        root = (fs_rope_node_t*)fs_rope_leaf_new();
+        if (!root) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    // A root with one child is not needed.
+    while (root->height && FS_ROPE_BRANCH(root)->count == 1) {
+        fs_rope_node_t* child = fs_rope_retain(FS_ROPE_BRANCH(root)->children[0]);
+        fs_rope_release(root);
+        root = child;
+    }
+    fs_rope_release(rope->root);
+    rope->root = root;
+    return FS_ERROR_NONE;
+}
+
+size_t fs_rope_copy(const fs_rope_t* rope, size_t offset, void* dst, size_t len) {
+    fs_rope_iter_t iter;
+    const unsigned char* bytes;
+    unsigned char* out = dst;
+    size_t n;
+    
+    fs_rope_iter_init(&iter, rope, offset, len);
+    while (fs_rope_iter_next(&iter, &bytes, &n)) {
+        memcpy(out, bytes, n);
+        out += n;
+    }
+    return (size_t)(out - (unsigned char*)dst);
+}
+
+unsigned char fs_rope_byte_at(const fs_rope_t* rope, size_t offset) {
+    const fs_rope_node_t* node = rope->root;
+    
+    while (node->height) {
+        const fs_rope_branch_t* branch = FS_ROPE_CONST_BRANCH(node);
+        node = branch->children[fs_rope_child_for_byte(branch, &offset)];
+    }
+    return FS_ROPE_CONST_LEAF(node)->data[offset];
+}
+
+fs_error_t fs_rope_line_start(const fs_rope_t* rope, size_t line, size_t* offset) {
+    const fs_rope_node_t* node = rope->root;
+    const unsigned char *p, *end;
+    size_t start = 0;
+    
+    if (line > node->lines) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (!line) {
+        *offset = 0;
+        return FS_ERROR_NONE;
+    }
+    
+    // Find the newline that ends line - 1.
+    while (node->height) {
+        const fs_rope_branch_t* branch = FS_ROPE_CONST_BRANCH(node);
+        size_t i = 0;
+        
+        while (line > branch->child_lines[i]) {
+            line -= branch->child_lines[i];
+            start += branch->child_bytes[i];
+            i++;
+        }
+        node = branch->children[i];
+    }
+    p = FS_ROPE_CONST_LEAF(node)->data;
+    end = p + node->bytes;
+    for (const unsigned char* q = p;; q++) {
+        q = memchr(q, '\n', (size_t)(end - q));
+        if (!--line) {
+            *offset = start + (size_t)(q - p) + 1;
+            return FS_ERROR_NONE;
+        }
+    }
+}
+
+size_t fs_rope_line_at(const fs_rope_t* rope, size_t offset) {
+    const fs_rope_node_t* node = rope->root;
+    size_t line = 0;
+    
+    if (offset >= node->bytes) {
+        return node->lines;
+    }
+    while (node->height) {
+        const fs_rope_branch_t* branch = FS_ROPE_CONST_BRANCH(node);
+        size_t i = 0;
+        
+        while (offset >= branch->child_bytes[i]) {
+            offset -= branch->child_bytes[i];
+            line += branch->child_lines[i];
+            i++;
+        }
+        node = branch->children[i];
+    }
+    return line + fs_rope_count_lines(FS_ROPE_CONST_LEAF(node)->data, offset);
+}
+
+void fs_rope_iter_init(fs_rope_iter_t* iter, const fs_rope_t* rope, size_t offset, size_t len) {
+    const fs_rope_node_t* node = rope->root;
+    size_t length = node->bytes;
+    
+    iter->depth = 0;
+    iter->skip = 0;
+    if (offset > length) {
+        offset = length;
+    }
+    iter->remaining = len < length - offset ? len : length - offset;
+    if (!iter->remaining) {
+        return;
+    }
+    
+    while (node->height) {
+        const fs_rope_branch_t* branch = FS_ROPE_CONST_BRANCH(node);
+        size_t i = fs_rope_child_for_byte(branch, &offset);
+        
+        iter->path[iter->depth] = node;
+        iter->index[iter->depth++] = (uint8_t)i;
+        node = branch->children[i];
+    }
+    iter->path[iter->depth] = node;
+    iter->index[iter->depth++] = 0;
+    iter->skip = offset;
+}
+
+bool fs_rope_iter_next(fs_rope_iter_t* iter, const unsigned char** bytes, size_t* len) {
+    const fs_rope_node_t* leaf;
+    size_t n;
+    
+    if (!iter->remaining) {
+        return false;
+    }
+    leaf = iter->path[iter->depth - 1];
+    n = leaf->bytes - iter->skip;
+    if (n > iter->remaining) {
+        n = iter->remaining;
+    }
+    *bytes = FS_ROPE_CONST_LEAF(leaf)->data + iter->skip;
+    *len = n;
+    iter->skip = 0;
+    iter->remaining -= n;
+    if (!iter->remaining) {
+        return true;
+    }
+    
+    // Step to the next leaf: up to the first branch with a later child, then down its left edge.
+    iter->depth--;
+    while (iter->depth) {
+        const fs_rope_branch_t* branch = FS_ROPE_CONST_BRANCH(iter->path[iter->depth - 1]);
+        if ((size_t)iter->index[iter->depth - 1] + 1 < branch->count) {
+            break;
+        }
+        iter->depth--;
+    }
+    if (!iter->depth) {
+        iter->remaining = 0;
+        return true;
+    }
+    {
+        const fs_rope_node_t* node;
+        const fs_rope_branch_t* branch = FS_ROPE_CONST_BRANCH(iter->path[iter->depth - 1]);
+        
+        node = branch->children[++iter->index[iter->depth - 1]];
+        while (node->height) {
+            iter->path[iter->depth] = node;
+            iter->index[iter->depth++] = 0;
+            node = FS_ROPE_CONST_BRANCH(node)->children[0];
+        }
+        iter->path[iter->depth] = node;
+        iter->index[iter->depth++] = 0;
+    }
+    return true;
+}
@@ -28,3 +28,770 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <fs/chunk.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Patience fallbacks nested deeper than this report the region as replaced.
+#define FS_DIFF_MAX_FALLBACK_DEPTH 32
+
+/* A slot of the interning table. */
+typedef struct {
+    fs_chunk_id_t hash;
+    uint32_t number;            // class + 1, 0 for an empty slot
+} fs_diff_slot_t;
+
+/* The first line of a class, to compare later lines with the same hash against. */
+typedef struct {
+    const unsigned char* bytes; // the line where it lies in a leaf, or NULL
+    const fs_rope_t* rope;      // otherwise read back from here
+    size_t offset;
+    size_t length;
+} fs_diff_class_t;
+
+typedef struct {
+    // Lines of both texts as class numbers, and whether each line changed.
+    uint32_t* lines[2];
+    uint8_t* changed[2];
+    
+    // Interning table: open addressing on the line hash.
+    fs_diff_slot_t* slots;
+    size_t slot_mask;
+    fs_diff_class_t* classes;
+    uint32_t class_count;
+    unsigned char* scratch;     // lines that cross a leaf boundary
+    size_t scratch_capacity;
+    
+    // Myers diagonals, forward and backward, in one allocation.
+    int32_t* kvd;
+    int32_t* kvdf;
+    int32_t* kvdb;
+    int32_t max_cost;
+    
+    // Patience fallback: occurrence counts per class, anchor stack and LIS scratch.
+    uint32_t* count_a;
+    uint32_t* count_b;
+    int32_t* position_b;
+    int32_t* anchors_a;
+    int32_t* anchors_b;
+    int32_t anchor_top;
+    int32_t* tails;
+    int32_t* previous;
+} fs_diff_ctx_t;
+
+/* Whether a line has the bytes of the first line of a class. */
+static bool fs_diff_line_equal(const fs_diff_class_t* entry, const unsigned char* bytes, size_t len) {
+    fs_rope_iter_t iter;
+    const unsigned char* run;
+    size_t n;
+    
+    if (entry->length != len) {
+        return false;
+    }
+    if (entry->bytes) {
+        return !memcmp(entry->bytes, bytes, len);
+    }
+    fs_rope_iter_init(&iter, entry->rope, entry->offset, len);
+    while (fs_rope_iter_next(&iter, &run, &n)) {
+        if (memcmp(run, bytes, n)) {
+            return false;
+        }
+        bytes += n;
+    }
+    return true;
+}
+
+/*
+ Returns the class of a line, adding one for a line not seen before. The hash
+ only finds the candidates: a line joins a class when its bytes match, so two
+ lines with the same id still diff as different. `stable` says `bytes` lies in
+ a leaf of `rope` and can be kept; a gathered line is read back from `offset`.
+ */
+static uint32_t fs_diff_intern(fs_diff_ctx_t* ctx, const fs_rope_t* rope, size_t offset,
+                               const unsigned char* bytes, size_t len, bool stable) {
+    fs_chunk_id_t hash = fs_chunk_hash(bytes, len);
+    size_t slot = (size_t)hash.lo & ctx->slot_mask;
+    
+    for (;; slot = (slot + 1) & ctx->slot_mask) {
+        fs_diff_slot_t* entry = &ctx->slots[slot];
+        
+        if (!entry->number) {
+            ctx->classes[ctx->class_count] = (fs_diff_class_t){ stable ? bytes : NULL, rope, offset, len };
+            entry->hash = hash;
+            entry->number = ++ctx->class_count;
+            return entry->number - 1;
+        }
+        if (fs_chunk_id_equal(entry->hash, hash) && fs_diff_line_equal(&ctx->classes[entry->number - 1], bytes, len)) {
+            return entry->number - 1;
+        }
+    }
+}
+
+static size_t fs_diff_line_offset(const fs_rope_t* rope, size_t line) {
+    size_t offset;
+    
+    if (fs_rope_line_start(rope, line, &offset) != FS_ERROR_NONE) {
+        return fs_rope_length(rope);
+    }
+    return offset;
+}
+
+/* Length of the common prefix; runs of a leaf both ropes share are not compared. */
+static size_t fs_diff_common_prefix(const fs_rope_t* a, const fs_rope_t* b) {
+    fs_rope_iter_t ia, ib;
+    const unsigned char *pa = NULL, *pb = NULL;
+    size_t na = 0, nb = 0, common = 0;
+    
+    fs_rope_iter_init(&ia, a, 0, fs_rope_length(a));
+    fs_rope_iter_init(&ib, b, 0, fs_rope_length(b));
+    for (;;) {
+        size_t n;
+        
+        if ((!na && !fs_rope_iter_next(&ia, &pa, &na)) || (!nb && !fs_rope_iter_next(&ib, &pb, &nb))) {
+            return common;
+        }
+        n = na < nb ? na : nb;
+        if (pa != pb && memcmp(pa, pb, n)) {
+            while (*pa == *pb) {
+                pa++;
+                pb++;
+                common++;
+            }
+            return common;
+        }
+        pa += n;
+        pb += n;
+        na -= n;
+        nb -= n;
+        common += n;
+    }
+}
+
+/* Length of the common suffix, at most `limit` bytes. */
+static size_t fs_diff_common_suffix(const fs_rope_t* a, const fs_rope_t* b, size_t limit) {
+    unsigned char ba[4096], bb[4096];
+    size_t la = fs_rope_length(a), lb = fs_rope_length(b), common = 0;
+    
+    while (common < limit) {
+        size_t n = limit - common < sizeof(ba) ? limit - common : sizeof(ba);
+        
+        fs_rope_copy(a, la - common - n, ba, n);
+        fs_rope_copy(b, lb - common - n, bb, n);
+        if (memcmp(ba, bb, n)) {
+            size_t k = n;
+            while (ba[k - 1] == bb[k - 1]) {
+                k--;
+            }
+            return common + n - k;
+        }
+        common += n;
+    }
+    return common;
+}
+
+/*
+ Counts whole lines at the start and end that the two texts share, from a
+ byte comparison: nothing needs hashing there. A suffix line counts only if
+ the '\n' before it is in the shared bytes too. Both results leave at least
+ one line of each text in between.
+ */
+static void fs_diff_common_lines(const fs_rope_t* a, const fs_rope_t* b, size_t* prefix, size_t* suffix) {
+    size_t la = fs_rope_length(a), lb = fs_rope_length(b);
+    size_t bytes = fs_diff_common_prefix(a, b);
+    size_t tail = fs_diff_common_suffix(a, b, (la < lb ? la : lb) - bytes);
+    fs_rope_iter_t iter;
+    const unsigned char* run;
+    size_t n, offset = la - tail;
+    
+    *prefix = fs_rope_line_at(a, bytes);
+    *suffix = 0;
+    fs_rope_iter_init(&iter, a, offset, tail);
+    while (fs_rope_iter_next(&iter, &run, &n)) {
+        const unsigned char* newline = memchr(run, '\n', n);
+        
+        if (newline) {
+            *suffix = fs_rope_line_count(a) - fs_rope_line_at(a, offset + (size_t)(newline - run) + 1);
+            return;
+        }
+        offset += n;
+    }
+}
+
+/*
+ Splits `count` lines from `first` on into classes. Newlines are found with
+ memchr and lines hashed where they lie in a leaf, with the 4-lane chunk
+ hash; only a line that crosses into the next leaf is gathered first.
+ */
+static fs_error_t fs_diff_hash_lines(fs_diff_ctx_t* ctx, int side, const fs_rope_t* rope, size_t first,
+                                     size_t count) {
+    uint32_t* lines = ctx->lines[side];
+    size_t start = fs_diff_line_offset(rope, first);
+    size_t line = 0, pending = 0, at = start;
+    fs_rope_iter_t iter;
+    const unsigned char* run;
+    size_t n;
+    
+    fs_rope_iter_init(&iter, rope, start, fs_diff_line_offset(rope, first + count) - start);
+    while (fs_rope_iter_next(&iter, &run, &n)) {
+        const unsigned char* end = run + n;
+        
+        while (run < end) {
+            const unsigned char* newline = memchr(run, '\n', (size_t)(end - run));
+            const unsigned char* stop = newline ? newline + 1 : end;
+            size_t take = (size_t)(stop - run);
+            
+            if (pending || !newline) {
+                if (pending + take > ctx->scratch_capacity) {
+                    size_t capacity = ctx->scratch_capacity ? ctx->scratch_capacity * 2 : FS_ROPE_LEAF_MAX;
+                    unsigned char* scratch;
+                    
+                    while (capacity < pending + take) {
+                        capacity *= 2;
+                    }
+                    scratch = realloc(ctx->scratch, capacity);
+                    if (!scratch) {
+                        return FS_ERROR_OUT_OF_MEMORY;
+                    }
+                    ctx->scratch = scratch;
+                    ctx->scratch_capacity = capacity;
+                }
+                memcpy(ctx->scratch + pending, run, take);
+                pending += take;
+                if (newline) {
+                    lines[line++] = fs_diff_intern(ctx, rope, at + take - pending, ctx->scratch, pending, false);
+                    pending = 0;
+                }
+            } else {
+                lines[line++] = fs_diff_intern(ctx, rope, at, run, take, true);
+            }
+            at += take;
+            run = stop;
+        }
+    }
+    // The last line of the text has no '\n' and may be empty.
+    if (line < count) {
+        lines[line] = fs_diff_intern(ctx, rope, at - pending, ctx->scratch, pending, false);
+    }
+    return FS_ERROR_NONE;
+}
+
+static void fs_diff_mark(fs_diff_ctx_t* ctx, int32_t off1, int32_t lim1, int32_t off2, int32_t lim2) {
+    memset(ctx->changed[0] + off1, 1, (size_t)(lim1 - off1));
+    memset(ctx->changed[1] + off2, 1, (size_t)(lim2 - off2));
+}
+
+/*
+ Finds a point on an optimal edit path through A[off1, lim1) and
+ B[off2, lim2) by running Myers' search from both ends until the paths meet
+ (the "middle snake"). Gives up once the cost reaches the cap.
+ */
+static bool fs_diff_split(fs_diff_ctx_t* ctx, int32_t off1, int32_t lim1, int32_t off2, int32_t lim2,
+                          int32_t* split1, int32_t* split2) {
+    const uint32_t* a = ctx->lines[0];
+    const uint32_t* b = ctx->lines[1];
+    int32_t* kvdf = ctx->kvdf;
+    int32_t* kvdb = ctx->kvdb;
+    int32_t dmin = off1 - lim2, dmax = lim1 - off2;
+    int32_t fmid = off1 - off2, bmid = lim1 - lim2;
+    int32_t fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+    bool odd = (fmid - bmid) & 1;
+    
+    kvdf[fmid] = off1;
+    kvdb[bmid] = lim1;
+    
+    for (int32_t cost = 1; cost <= ctx->max_cost; cost++) {
+        // Extend the forward paths by one edit.
+        if (fmin > dmin) {
+            kvdf[--fmin - 1] = -1;
+        } else {
+            ++fmin;
+        }
+        if (fmax < dmax) {
+            kvdf[++fmax + 1] = -1;
+        } else {
+            --fmax;
+        }
+        for (int32_t d = fmax; d >= fmin; d -= 2) {
+            int32_t i1 = kvdf[d - 1] >= kvdf[d + 1] ? kvdf[d - 1] + 1 : kvdf[d + 1];
+            int32_t i2 = i1 - d;
+            
+            while (i1 < lim1 && i2 < lim2 && a[i1] == b[i2]) {
+                i1++;
+                i2++;
+            }
+            kvdf[d] = i1;
+            if (odd && bmin <= d && d <= bmax && kvdb[d] <= i1) {
+                *split1 = i1;
+                *split2 = i2;
+                return true;
+            }
+        }
+        
+        // And the backward ones.
+        if (bmin > dmin) {
+            kvdb[--bmin - 1] = INT32_MAX;
+        } else {
+            ++bmin;
+        }
+        if (bmax < dmax) {
+            kvdb[++bmax + 1] = INT32_MAX;
+        } else {
+            --bmax;
+        }
+        for (int32_t d = bmax; d >= bmin; d -= 2) {
+            int32_t i1 = kvdb[d - 1] < kvdb[d + 1] ? kvdb[d - 1] : kvdb[d + 1] - 1;
+            int32_t i2 = i1 - d;
+            
+            while (i1 > off1 && i2 > off2 && a[i1 - 1] == b[i2 - 1]) {
+                i1--;
+                i2--;
+            }
+            kvdb[d] = i1;
+            if (!odd && fmin <= d && d <= fmax && i1 <= kvdf[d]) {
+                *split1 = i1;
+                *split2 = i2;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void fs_diff_patience(fs_diff_ctx_t* ctx, int32_t off1, int32_t lim1, int32_t off2, int32_t lim2,
+                             int depth);
+
+static void fs_diff_compare(fs_diff_ctx_t* ctx, int32_t off1, int32_t lim1, int32_t off2, int32_t lim2,
+                            int depth) {
+    const uint32_t* a = ctx->lines[0];
+    const uint32_t* b = ctx->lines[1];
+    int32_t split1, split2;
+    
+    while (off1 < lim1 && off2 < lim2 && a[off1] == b[off2]) {
+        off1++;
+        off2++;
+    }
+    while (off1 < lim1 && off2 < lim2 && a[lim1 - 1] == b[lim2 - 1]) {
+        lim1--;
+        lim2--;
+    }
+    if (off1 == lim1 || off2 == lim2) {
+        fs_diff_mark(ctx, off1, lim1, off2, lim2);
+    } else if (fs_diff_split(ctx, off1, lim1, off2, lim2, &split1, &split2)) {
+        fs_diff_compare(ctx, off1, split1, off2, split2, depth);
+        fs_diff_compare(ctx, split1, lim1, split2, lim2, depth);
+    } else {
+        fs_diff_patience(ctx, off1, lim1, off2, lim2, depth);
+    }
+}
+
+/*
+ Anchors the region at the longest increasing run of lines that occur once
+ on each side and diffs the gaps between them. The anchors of every active
+ call sit on a stack; the gaps are disjoint from them, so it never holds more
+ entries than the shorter text has lines.
+ */
+static void fs_diff_patience(fs_diff_ctx_t* ctx, int32_t off1, int32_t lim1, int32_t off2, int32_t lim2,
+                             int depth) {
+    const uint32_t* a = ctx->lines[0];
+    const uint32_t* b = ctx->lines[1];
+    int32_t* anchors_a = ctx->anchors_a + ctx->anchor_top;
+    int32_t* anchors_b = ctx->anchors_b + ctx->anchor_top;
+    int32_t pairs = 0, length = 0, prev1, prev2;
+    
+    if (depth >= FS_DIFF_MAX_FALLBACK_DEPTH) {
+        fs_diff_mark(ctx, off1, lim1, off2, lim2);
+        return;
+    }
+    
+    for (int32_t i = off1; i < lim1; i++) {
+        ctx->count_a[a[i]]++;
+    }
+    for (int32_t j = off2; j < lim2; j++) {
+        ctx->count_b[b[j]]++;
+        ctx->position_b[b[j]] = j;
+    }
+    for (int32_t i = off1; i < lim1; i++) {
+        if (ctx->count_a[a[i]] == 1 && ctx->count_b[a[i]] == 1) {
+            anchors_a[pairs] = i;
+            anchors_b[pairs++] = ctx->position_b[a[i]];
+        }
+    }
+    for (int32_t i = off1; i < lim1; i++) {
+        ctx->count_a[a[i]] = 0;
+    }
+    for (int32_t j = off2; j < lim2; j++) {
+        ctx->count_b[b[j]] = 0;
+    }
+    
+    // Longest increasing subsequence of the positions in B, by patience sorting.
+    for (int32_t k = 0; k < pairs; k++) {
+        int32_t lo = 0, hi = length;
+        
+        while (lo < hi) {
+            int32_t mid = lo + (hi - lo) / 2;
+            if (anchors_b[ctx->tails[mid]] < anchors_b[k]) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        ctx->previous[k] = lo ? ctx->tails[lo - 1] : -1;
+        ctx->tails[lo] = k;
+        if (lo == length) {
+            length++;
+        }
+    }
+    if (!length) {
+        fs_diff_mark(ctx, off1, lim1, off2, lim2);
+        return;
+    }
+    // Keep only the chosen pairs, in order. The k-th of them was at index k or later.
+    for (int32_t k = ctx->tails[length - 1], slot = length - 1; slot >= 0; k = ctx->previous[k], slot--) {
+        ctx->tails[slot] = k;
+    }
+    for (int32_t slot = 0; slot < length; slot++) {
+        anchors_a[slot] = anchors_a[ctx->tails[slot]];
+        anchors_b[slot] = anchors_b[ctx->tails[slot]];
+    }
+    
+    ctx->anchor_top += length;
+    prev1 = off1;
+    prev2 = off2;
+    for (int32_t k = 0; k < length; k++) {
+        fs_diff_compare(ctx, prev1, anchors_a[k], prev2, anchors_b[k], depth + 1);
+        prev1 = anchors_a[k] + 1;
+        prev2 = anchors_b[k] + 1;
+    }
+    fs_diff_compare(ctx, prev1, lim1, prev2, lim2, depth + 1);
+    ctx->anchor_top -= length;
+}
+
+static void fs_diff_ctx_free(fs_diff_ctx_t* ctx) {
+    free(ctx->lines[0]);
+    free(ctx->lines[1]);
+    free(ctx->changed[0]);
+    free(ctx->changed[1]);
+    free(ctx->slots);
+    free(ctx->classes);
+    free(ctx->scratch);
+    free(ctx->kvd);
+    free(ctx->count_a);
+    free(ctx->count_b);
+    free(ctx->position_b);
+    free(ctx->anchors_a);
+    free(ctx->anchors_b);
+    free(ctx->tails);
+    free(ctx->previous);
+}
+
+static int32_t fs_diff_auto_cost(size_t diagonals) {
+    size_t cost = 1;
+    
+    // A power of two near the square root is close enough.
+    while (cost * cost < diagonals) {
+        cost <<= 1;
+    }
+    return cost < FS_DIFF_MIN_COST ? FS_DIFF_MIN_COST : (int32_t)cost;
+}
+
+fs_error_t fs_diff_lines(const fs_rope_t* a, const fs_rope_t* b, const fs_diff_config_t* config,
+                         fs_diff_hunk_t** hunks, size_t* count) {
+    fs_diff_ctx_t ctx = { 0 };
+    size_t na, nb, prefix, suffix, slots = 1, shorter, capacity = 0, n = 0;
+    fs_diff_hunk_t* result = NULL;
+    fs_error_t error;
+    
+    if (!hunks || !count) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *hunks = NULL;
+    *count = 0;
+    if (!a || !b) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (fs_rope_shares_contents(a, b)) {
+        return FS_ERROR_NONE;
+    }
+    fs_diff_common_lines(a, b, &prefix, &suffix);
+    na = fs_rope_line_count(a) - prefix - suffix;
+    nb = fs_rope_line_count(b) - prefix - suffix;
+    if (na + nb >= INT32_MAX / 2) {
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    while (slots < 2 * (na + nb)) {
+        slots <<= 1;
+    }
+    shorter = na < nb ? na : nb;
+    
+    ctx.lines[0] = malloc(na * sizeof(uint32_t));
+    ctx.lines[1] = malloc(nb * sizeof(uint32_t));
+    ctx.changed[0] = calloc(na, 1);
+    ctx.changed[1] = calloc(nb, 1);
+    ctx.slots = calloc(slots, sizeof(fs_diff_slot_t));
+    ctx.slot_mask = slots - 1;
+    ctx.classes = malloc((na + nb) * sizeof(fs_diff_class_t));
+    ctx.kvd = malloc(2 * (na + nb + 3) * sizeof(int32_t));
+    ctx.count_a = calloc(na + nb, sizeof(uint32_t));
+    ctx.count_b = calloc(na + nb, sizeof(uint32_t));
+    ctx.position_b = malloc((na + nb) * sizeof(int32_t));
+    ctx.anchors_a = malloc(shorter * sizeof(int32_t));
+    ctx.anchors_b = malloc(shorter * sizeof(int32_t));
+    ctx.tails = malloc(shorter * sizeof(int32_t));
+    ctx.previous = malloc(shorter * sizeof(int32_t));
+    if (!ctx.lines[0] || !ctx.lines[1] || !ctx.changed[0] || !ctx.changed[1] || !ctx.slots || !ctx.classes ||
+        !ctx.kvd || !ctx.count_a || !ctx.count_b || !ctx.position_b ||
+        !ctx.anchors_a || !ctx.anchors_b || !ctx.tails || !ctx.previous) {
+        fs_diff_ctx_free(&ctx);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    // Diagonals run from -nb - 1 to na + 1.
+    ctx.kvdf = ctx.kvd + nb + 1;
+    ctx.kvdb = ctx.kvdf + na + nb + 3;
+    if (config && config->max_cost) {
+        ctx.max_cost = config->max_cost < INT32_MAX ? (int32_t)config->max_cost : INT32_MAX;
+    } else {
+        ctx.max_cost = fs_diff_auto_cost(na + nb + 3);
+    }
+    
+    error = fs_diff_hash_lines(&ctx, 0, a, prefix, na);
+    if (error == FS_ERROR_NONE) {
+        error = fs_diff_hash_lines(&ctx, 1, b, prefix, nb);
+    }
+    if (error != FS_ERROR_NONE) {
+        fs_diff_ctx_free(&ctx);
+        return error;
+    }
+    fs_diff_compare(&ctx, 0, (int32_t)na, 0, (int32_t)nb, 0);
+    
+    // Unchanged lines pair up in order; every run of changes between them is a hunk.
+    for (size_t i = 0, j = 0; i < na || j < nb;) {
+        fs_diff_hunk_t hunk;
+        
+        if (i < na && j < nb && !ctx.changed[0][i] && !ctx.changed[1][j]) {
+            i++;
+            j++;
+            continue;
+        }
+        hunk.a_start = prefix + i;
+        hunk.b_start = prefix + j;
+        while (i < na && ctx.changed[0][i]) {
+            i++;
+        }
+        while (j < nb && ctx.changed[1][j]) {
+            j++;
+        }
+        hunk.a_count = prefix + i - hunk.a_start;
+        hunk.b_count = prefix + j - hunk.b_start;
+        
+        if (n == capacity) {
+            fs_diff_hunk_t* grown;
+            
+            capacity = capacity ? capacity * 2 : 16;
+            grown = realloc(result, capacity * sizeof(*result));
+            if (!grown) {
+                free(result);
+                fs_diff_ctx_free(&ctx);
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            result = grown;
+        }
+        result[n++] = hunk;
+    }
+    
+    fs_diff_ctx_free(&ctx);
+    *hunks = result;
+    *count = n;
+    return FS_ERROR_NONE;
+}
+
+static bool fs_merge_ranges_equal(const fs_rope_t* a, size_t a_offset, const fs_rope_t* b, size_t b_offset,
+                                  size_t len) {
+    fs_rope_iter_t ia, ib;
+    const unsigned char *pa = NULL, *pb = NULL;
+    size_t na = 0, nb = 0;
+    
+    fs_rope_iter_init(&ia, a, a_offset, len);
+    fs_rope_iter_init(&ib, b, b_offset, len);
+    while (len) {
+        size_t n;
+        
+        if (!na && !fs_rope_iter_next(&ia, &pa, &na)) {
+            return false;
+        }
+        if (!nb && !fs_rope_iter_next(&ib, &pb, &nb)) {
+            return false;
+        }
+        n = na < nb ? na : nb;
+        if (memcmp(pa, pb, n)) {
+            return false;
+        }
+        pa += n;
+        pb += n;
+        na -= n;
+        nb -= n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Replaces lines [line, line + count) of `out` with lines [from, from + from_count) of `source`. */
+static fs_error_t fs_merge_replace(fs_rope_t* out, size_t line, size_t count, const fs_rope_t* source,
+                                   size_t from, size_t from_count) {
+    size_t start = fs_diff_line_offset(out, line);
+    size_t end = fs_diff_line_offset(out, line + count);
+    size_t source_start = fs_diff_line_offset(source, from);
+    size_t len = fs_diff_line_offset(source, from + from_count) - source_start;
+    unsigned char* bytes = NULL;
+    fs_error_t error;
+    
+    if (len) {
+        bytes = malloc(len);
+        if (!bytes) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        fs_rope_copy(source, source_start, bytes, len);
+    }
+    error = fs_rope_delete(out, start, end - start);
+    if (error == FS_ERROR_NONE) {
+        error = fs_rope_insert(out, start, bytes, len);
+    }
+    free(bytes);
+    return error;
+}
+
+/* Whether two changes to base lines [s1, e1) and [s2, e2) touch the same text. */
+static bool fs_merge_overlaps(size_t s1, size_t e1, size_t s2, size_t e2) {
+    if (s1 == e1 && s2 == e2) {
+        return s1 == s2;
+    }
+    if (s1 == e1) {
+        return s2 < s1 && s1 < e2;
+    }
+    if (s2 == e2) {
+        return s1 < s2 && s2 < e1;
+    }
+    return s1 < e2 && s2 < e1;
+}
+
+static inline size_t fs_merge_end(const fs_diff_hunk_t* hunk) {
+    return hunk->a_start + hunk->a_count;
+}
+
+/*
+ Replays their hunks onto a snapshot of ours, walking both hunk lists in base
+ order. `delta` maps a base line to the output, `their_delta` to theirs.
+ */
+fs_error_t fs_merge3(const fs_rope_t* base, const fs_rope_t* ours, const fs_rope_t* theirs,
+                     const fs_diff_config_t* config, fs_merge_policy_t policy, fs_rope_t** out,
+                     size_t* conflicts) {
+    fs_diff_hunk_t *mine = NULL, *yours = NULL;
+    size_t mine_count = 0, yours_count = 0, conflict_count = 0, i = 0, j = 0;
+    ptrdiff_t delta = 0, their_delta = 0;
+    fs_rope_t* merged = NULL;
+    fs_error_t error;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!base || !ours || !theirs || policy > FS_MERGE_PREFER_THEIRS) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    error = fs_diff_lines(base, ours, config, &mine, &mine_count);
+    if (error == FS_ERROR_NONE) {
+        error = fs_diff_lines(base, theirs, config, &yours, &yours_count);
+    }
+    if (error == FS_ERROR_NONE) {
+        error = fs_rope_snapshot(ours, &merged);
+    }
+    
+    while (error == FS_ERROR_NONE && (i < mine_count || j < yours_count)) {
+        const fs_diff_hunk_t* o = i < mine_count ? &mine[i] : NULL;
+        const fs_diff_hunk_t* t = j < yours_count ? &yours[j] : NULL;
+        
+        if (o && t && fs_merge_overlaps(o->a_start, fs_merge_end(o), t->a_start, fs_merge_end(t))) {
+            size_t lo = o->a_start < t->a_start ? o->a_start : t->a_start;
+            size_t hi = fs_merge_end(o) > fs_merge_end(t) ? fs_merge_end(o) : fs_merge_end(t);
+            size_t i1 = i + 1, j1 = j + 1, out_start, out_count, their_start, their_count;
+            size_t out_offset, out_len, their_offset, their_len;
+            ptrdiff_t our_change = 0, their_change = 0;
+            
+            // Grow the conflicting region until no hunk on either side reaches into it.
+            for (;;) {
+                if (i1 < mine_count && fs_merge_overlaps(mine[i1].a_start, fs_merge_end(&mine[i1]), lo, hi)) {
+                    hi = fs_merge_end(&mine[i1]) > hi ? fs_merge_end(&mine[i1]) : hi;
+                    i1++;
+                } else if (j1 < yours_count &&
+                           fs_merge_overlaps(yours[j1].a_start, fs_merge_end(&yours[j1]), lo, hi)) {
+                    hi = fs_merge_end(&yours[j1]) > hi ? fs_merge_end(&yours[j1]) : hi;
+                    j1++;
+                } else {
+                    break;
+                }
+            }
+            for (size_t k = i; k < i1; k++) {
+                our_change += (ptrdiff_t)mine[k].b_count - (ptrdiff_t)mine[k].a_count;
+            }
+            for (size_t k = j; k < j1; k++) {
+                their_change += (ptrdiff_t)yours[k].b_count - (ptrdiff_t)yours[k].a_count;
+            }
+            
+            out_start = (size_t)((ptrdiff_t)lo + delta);
+            out_count = (size_t)((ptrdiff_t)(hi - lo) + our_change);
+            their_start = (size_t)((ptrdiff_t)lo + their_delta);
+            their_count = (size_t)((ptrdiff_t)(hi - lo) + their_change);
+            
+            out_offset = fs_diff_line_offset(merged, out_start);
+            out_len = fs_diff_line_offset(merged, out_start + out_count) - out_offset;
+            their_offset = fs_diff_line_offset(theirs, their_start);
+            their_len = fs_diff_line_offset(theirs, their_start + their_count) - their_offset;
+            
+            if (out_len == their_len && fs_merge_ranges_equal(merged, out_offset, theirs, their_offset, out_len)) {
+                delta += our_change;
+            } else {
+                conflict_count++;
+                switch (policy) {
+                    case FS_MERGE_PREFER_OURS:
+                        delta += our_change;
+                        break;
+                    case FS_MERGE_PREFER_THEIRS:
+                        error = fs_merge_replace(merged, out_start, out_count, theirs, their_start, their_count);
+                        delta += their_change;
+                        break;
+                    case FS_MERGE_KEEP_BOTH:
+                        error = fs_merge_replace(merged, out_start + out_count, 0, theirs, their_start, their_count);
+                        delta += our_change + (ptrdiff_t)their_count;
+                        break;
+                }
+            }
+            their_delta += their_change;
+            i = i1;
+            j = j1;
+        } else if (o && (!t || o->a_start < t->a_start || (o->a_start == t->a_start && !o->a_count))) {
+            // Already in the output, which started as ours.
+            delta += (ptrdiff_t)o->b_count - (ptrdiff_t)o->a_count;
+            i++;
+        } else {
+            error = fs_merge_replace(merged, (size_t)((ptrdiff_t)t->a_start + delta), t->a_count, theirs,
+                                     t->b_start, t->b_count);
+            delta += (ptrdiff_t)t->b_count - (ptrdiff_t)t->a_count;
+            their_delta += (ptrdiff_t)t->b_count - (ptrdiff_t)t->a_count;
+            j++;
+        }
+    }
+    
+    free(mine);
+    free(yours);
+    if (error != FS_ERROR_NONE) {
+        fs_rope_destroy(merged);
+        return error;
+    }
+    if (conflicts) {
+        *conflicts = conflict_count;
+    }
+    *out = merged;
+    return FS_ERROR_NONE;
+}
@@ -28,3 +28,467 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <fs/journal.h>
+#include <fs/io.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FS_OPLOG_FORMAT 0x4c4f5346u             /* "FSOL" */
+#define FS_OPLOG_SNAPSHOT_FORMAT 0x4e535346u    /* "FSSN" */
+#define FS_OPLOG_SNAPSHOT_SUFFIX ".snapshot"
+
+// Record types. In the log the header's user value is the number of
+// operations before the first one in it; in a snapshot, the number it includes.
+#define FS_OPLOG_GROUP 1        // log: operations committed together
+#define FS_OPLOG_REPLICA 1      // snapshot: the fs_crdt_encode() of the replica, first
+#define FS_OPLOG_TEXT 2         // snapshot: the next stretch of the text
+
+// Rope leaves per text record of a snapshot.
+#define FS_OPLOG_TEXT_LEAVES 256
+
+// Largest encoding of an operation without its text: the kind and five varints.
+#define FS_OPLOG_OP_MAX 26
+
+struct fs_oplog {
+    char* path;
+    char* snapshot_path;
+    uint32_t commit_ms;
+    size_t commit_bytes;
+    size_t snapshot_bytes;
+    fs_crdt_t* crdt;
+    fs_rope_t* rope;
+    
+    uint64_t end;               // of the valid log
+    uint64_t sequence;          // operations committed, since the first
+    size_t snapshot_size;
+    
+    // The group being collected: encoded operations, each followed by its text.
+    uint8_t* group;
+    size_t group_length;
+    size_t group_capacity;
+    size_t group_count;
+    uint64_t group_since;
+};
+
+/* The rope edits of an operation being replayed. */
+typedef struct {
+    fs_rope_t* rope;
+    const uint8_t* text;
+    fs_error_t error;
+} fs_oplog_replay_t;
+
+static size_t fs_oplog_put_varint(uint8_t* p, uint32_t value) {
+    size_t n = 0;
+    
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool fs_oplog_get_varint(const uint8_t** p, const uint8_t* end, uint32_t* value) {
+    uint32_t result = 0;
+    
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        uint8_t byte;
+        
+        if (*p == end) {
+            return false;
+        }
+        byte = *(*p)++;
+        if (shift == 28 && byte > 0x0F) {
+            return false;
+        }
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t fs_oplog_encode(uint8_t* p, const fs_crdt_op_t* op) {
+    size_t n = 0;
+    
+    p[n++] = (uint8_t)op->kind;
+    n += fs_oplog_put_varint(p + n, op->id.client);
+    n += fs_oplog_put_varint(p + n, op->id.clock);
+    n += fs_oplog_put_varint(p + n, op->origin.client);
+    n += fs_oplog_put_varint(p + n, op->origin.clock);
+    n += fs_oplog_put_varint(p + n, op->length);
+    return n;
+}
+
+static bool fs_oplog_decode(const uint8_t** p, const uint8_t* end, fs_crdt_op_t* op, const uint8_t** text) {
+    uint8_t kind;
+    
+    if (*p == end) {
+        return false;
+    }
+    kind = *(*p)++;
+    if ((kind != FS_CRDT_INSERT && kind != FS_CRDT_DELETE) || !fs_oplog_get_varint(p, end, &op->id.client) ||
+        !fs_oplog_get_varint(p, end, &op->id.clock) || !fs_oplog_get_varint(p, end, &op->origin.client) ||
+        !fs_oplog_get_varint(p, end, &op->origin.clock) || !fs_oplog_get_varint(p, end, &op->length)) {
+        return false;
+    }
+    op->kind = (fs_crdt_op_kind_t)kind;
+    *text = NULL;
+    if (op->kind == FS_CRDT_INSERT) {
+        if (op->length > (size_t)(end - *p)) {
+            return false;
+        }
+        *text = *p;
+        *p += op->length;
+    }
+    return true;
+}
+
+static void fs_oplog_range(void* context, size_t position, size_t length) {
+    fs_oplog_replay_t* replay = context;
+    
+    if (replay->error != FS_ERROR_NONE) {
+        return;
+    }
+    if (replay->text) {
+        replay->error = fs_rope_insert(replay->rope, position, replay->text, length);
+        replay->text += length;
+    } else {
+        replay->error = fs_rope_delete(replay->rope, position, length);
+    }
+}
+
+/* Restores the replica and text from the snapshot, or starts empty without one. */
+static fs_error_t fs_oplog_load_snapshot(fs_oplog_t* log, uint32_t client, uint64_t* covered) {
+    fs_managed_buffer_t map;
+    fs_journal_record_t record;
+    size_t offset;
+    fs_error_t error;
+    
+    *covered = 0;
+    error = fs_io_map(log->snapshot_path, FS_IO_ADVICE_SEQUENTIAL, &map);
+    if (error == FS_ERROR_NOT_FOUND) {
+        error = fs_crdt_create(client, &log->crdt);
+        return error == FS_ERROR_NONE ? fs_rope_create(NULL, 0, &log->rope) : error;
+    }
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    error = fs_journal_begin(map.buffer, FS_OPLOG_SNAPSHOT_FORMAT, covered, &offset);
+    if (error == FS_ERROR_NONE) {
+        error = fs_rope_create(NULL, 0, &log->rope);
+    }
+    if (error == FS_ERROR_NONE) {
+        if (!fs_journal_next(map.buffer, &offset, &record) || record.type != FS_OPLOG_REPLICA) {
+            error = FS_ERROR_NOT_SUPPORTED;
+        } else {
+            error = fs_crdt_decode(client, record.payload, record.len, &log->crdt);
+            if (error == FS_ERROR_INVALID_ARGUMENT) {
+                error = FS_ERROR_NOT_SUPPORTED;
+            }
+        }
+    }
+    while (error == FS_ERROR_NONE && fs_journal_next(map.buffer, &offset, &record)) {
+        if (record.type == FS_OPLOG_TEXT) {
+            error = fs_rope_insert(log->rope, fs_rope_length(log->rope), record.payload, record.len);
+        }
+    }
+    // A snapshot is renamed into place whole, so anything short of its end is damage.
+    if (error == FS_ERROR_NONE &&
+        (offset != map.buffer.len || fs_crdt_length(log->crdt) != fs_rope_length(log->rope))) {
+        error = FS_ERROR_NOT_SUPPORTED;
+    }
+    log->snapshot_size = map.buffer.len;
+    fs_managed_buffer_release(&map);
+    return error;
+}
+
+/* Starts the log over with no operations after the first `sequence`. */
+static fs_error_t fs_oplog_reset(fs_oplog_t* log, uint64_t sequence) {
+    uint8_t header[FS_JOURNAL_HEADER_SIZE];
+    fs_error_t error;
+    
+    fs_journal_write_header(header, FS_OPLOG_FORMAT, sequence);
+    error = fs_journal_rewrite(log->path, header, sizeof(header));
+    if (error == FS_ERROR_NONE) {
+        log->end = FS_JOURNAL_HEADER_SIZE;
+        log->sequence = sequence;
+    }
+    return error;
+}
+
+/* Applies the operations logged after the snapshot's. */
+static fs_error_t fs_oplog_replay(fs_oplog_t* log, uint64_t covered) {
+    fs_managed_buffer_t map;
+    fs_journal_record_t record;
+    uint64_t sequence;
+    size_t offset;
+    fs_error_t error;
+    
+    error = fs_io_map(log->path, FS_IO_ADVICE_SEQUENTIAL, &map);
+    if (error == FS_ERROR_NOT_FOUND) {
+        return fs_oplog_reset(log, covered);
+    }
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    error = fs_journal_begin(map.buffer, FS_OPLOG_FORMAT, &sequence, &offset);
+    if (error == FS_ERROR_NONE && sequence > covered) {
+        error = FS_ERROR_NOT_FOUND;
+    }
+    while (error == FS_ERROR_NONE && fs_journal_next(map.buffer, &offset, &record)) {
+        const uint8_t* p = record.payload;
+        const uint8_t* end = p + record.len;
+        
+        if (record.type != FS_OPLOG_GROUP) {
+            continue;
+        }
+        while (error == FS_ERROR_NONE && p != end) {
+            fs_oplog_replay_t replay = { log->rope, NULL, FS_ERROR_NONE };
+            fs_crdt_op_t op;
+            
+            if (!fs_oplog_decode(&p, end, &op, &replay.text)) {
+                error = FS_ERROR_NOT_SUPPORTED;
+            } else if (sequence++ >= covered) {
+                error = fs_crdt_apply(log->crdt, &op, fs_oplog_range, &replay);
+                if (error == FS_ERROR_NONE) {
+                    error = replay.error;
+                } else if (error != FS_ERROR_OUT_OF_MEMORY) {
+                    error = FS_ERROR_NOT_SUPPORTED;
+                }
+            }
+        }
+    }
+    log->end = offset;
+    log->sequence = sequence;
+    fs_managed_buffer_release(&map);
+    
+    // A log that ends before the snapshot was cut short; nothing in it is needed.
+    if (error == FS_ERROR_NONE && sequence < covered) {
+        error = fs_oplog_reset(log, covered);
+    }
+    return error;
+}
+
+fs_error_t fs_oplog_open(const char* path, uint32_t client, const fs_oplog_config_t* config, fs_oplog_t** out,
+                         fs_crdt_t** crdt, fs_rope_t** rope) {
+    fs_oplog_t* log;
+    uint64_t covered;
+    size_t length;
+    fs_error_t error;
+    
+    if (!out || !crdt || !rope) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    *crdt = NULL;
+    *rope = NULL;
+    if (!path || !client) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    log = calloc(1, sizeof(*log));
+    if (!log) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    log->commit_ms = config && config->commit_ms ? config->commit_ms : FS_OPLOG_COMMIT_MS;
+    log->commit_bytes = config && config->commit_bytes ? config->commit_bytes : FS_OPLOG_COMMIT_BYTES;
+    log->snapshot_bytes = config && config->snapshot_bytes ? config->snapshot_bytes : FS_OPLOG_SNAPSHOT_BYTES;
+    
+    length = strlen(path);
+    log->path = malloc(length + 1);
+    log->snapshot_path = malloc(length + sizeof(FS_OPLOG_SNAPSHOT_SUFFIX));
+    if (!log->path || !log->snapshot_path) {
+        error = FS_ERROR_OUT_OF_MEMORY;
+    } else {
+        memcpy(log->path, path, length + 1);
+        memcpy(log->snapshot_path, path, length);
+        memcpy(log->snapshot_path + length, FS_OPLOG_SNAPSHOT_SUFFIX, sizeof(FS_OPLOG_SNAPSHOT_SUFFIX));
+        error = fs_oplog_load_snapshot(log, client, &covered);
+    }
+    if (error == FS_ERROR_NONE) {
+        error = fs_oplog_replay(log, covered);
+    }
+    if (error != FS_ERROR_NONE) {
+        fs_crdt_destroy(log->crdt);
+        fs_rope_destroy(log->rope);
+        fs_oplog_close(log);
+        return error;
+    }
+    *out = log;
+    *crdt = log->crdt;
+    *rope = log->rope;
+    return FS_ERROR_NONE;
+}
+
+void fs_oplog_close(fs_oplog_t* log) {
+    if (!log) {
+        return;
+    }
+    free(log->group);
+    free(log->path);
+    free(log->snapshot_path);
+    free(log);
+}
+
+fs_error_t fs_oplog_append(fs_oplog_t* log, const fs_crdt_op_t* op, const uint8_t* text, uint64_t now_ms) {
+    size_t need;
+    
+    if (!op || !op->length || (op->kind != FS_CRDT_INSERT && op->kind != FS_CRDT_DELETE) ||
+        (op->kind == FS_CRDT_INSERT && !text)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    need = FS_OPLOG_OP_MAX + (op->kind == FS_CRDT_INSERT ? op->length : 0);
+    if (need > FS_JOURNAL_RECORD_MAX) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (need > FS_JOURNAL_RECORD_MAX - log->group_length) {
+        fs_error_t error = fs_oplog_commit(log);
+        
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    if (log->group_length + need > log->group_capacity) {
+        size_t capacity = log->group_capacity ? log->group_capacity : 4096;
+        uint8_t* group;
+        
+        while (capacity < log->group_length + need) {
+            capacity *= 2;
+        }
+        group = realloc(log->group, capacity);
+        if (!group) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        log->group = group;
+        log->group_capacity = capacity;
+    }
+    if (!log->group_count) {
+        log->group_since = now_ms;
+    }
+    log->group_length += fs_oplog_encode(log->group + log->group_length, op);
+    if (op->kind == FS_CRDT_INSERT) {
+        memcpy(log->group + log->group_length, text, op->length);
+        log->group_length += op->length;
+    }
+    log->group_count++;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_oplog_poll(fs_oplog_t* log, uint64_t now_ms, uint64_t* deadline_ms) {
+    fs_error_t error = FS_ERROR_NONE;
+    
+    if (log->group_count &&
+        (log->group_length >= log->commit_bytes || now_ms >= log->group_since + log->commit_ms)) {
+        error = fs_oplog_commit(log);
+    }
+    if (deadline_ms) {
+        *deadline_ms = log->group_count ? log->group_since + log->commit_ms : UINT64_MAX;
+    }
+    return error;
+}
+
+fs_error_t fs_oplog_commit(fs_oplog_t* log) {
+    fs_buffer_t part = { log->group, log->group_length };
+    size_t size = fs_journal_record_size(log->group_length);
+    uint8_t* record;
+    fs_error_t error;
+    
+    if (!log->group_count) {
+        return FS_ERROR_NONE;
+    }
+    record = malloc(size);
+    if (!record) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    fs_journal_write_record(record, FS_OPLOG_GROUP, &part, 1);
+    error = fs_journal_append(log->path, log->end, record, size);
+    free(record);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    log->end += size;
+    log->sequence += log->group_count;
+    log->group_length = 0;
+    log->group_count = 0;
+    
+    if (log->end - FS_JOURNAL_HEADER_SIZE >= log->snapshot_bytes && log->end >= log->snapshot_size) {
+        return fs_oplog_snapshot(log);
+    }
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_oplog_snapshot(fs_oplog_t* log) {
+    fs_buffer_t parts[FS_OPLOG_TEXT_LEAVES];
+    const unsigned char* run;
+    fs_rope_iter_t iter;
+    uint8_t* replica;
+    uint8_t* bytes;
+    size_t replica_length, text_length = fs_rope_length(log->rope), runs = 0, records, size, n, count = 0;
+    fs_error_t error;
+    
+    error = fs_oplog_commit(log);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    error = fs_crdt_encode(log->crdt, &replica, &replica_length);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    // The text goes in records of whole leaves, copied once into the file image.
+    fs_rope_iter_init(&iter, log->rope, 0, text_length);
+    while (fs_rope_iter_next(&iter, &run, &n)) {
+        runs++;
+    }
+    records = (runs + FS_OPLOG_TEXT_LEAVES - 1) / FS_OPLOG_TEXT_LEAVES;
+    size = FS_JOURNAL_HEADER_SIZE + fs_journal_record_size(replica_length);
+    if (replica_length > FS_JOURNAL_RECORD_MAX || text_length > SIZE_MAX - size ||
+        records > (SIZE_MAX - size - text_length) / FS_JOURNAL_RECORD_HEADER_SIZE) {
+        free(replica);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    size += text_length + records * FS_JOURNAL_RECORD_HEADER_SIZE;
+    bytes = malloc(size);
+    if (!bytes) {
+        free(replica);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    fs_journal_write_header(bytes, FS_OPLOG_SNAPSHOT_FORMAT, log->sequence);
+    n = FS_JOURNAL_HEADER_SIZE;
+    parts[0] = (fs_buffer_t){ replica, replica_length };
+    n += fs_journal_write_record(bytes + n, FS_OPLOG_REPLICA, parts, 1);
+    free(replica);
+    
+    fs_rope_iter_init(&iter, log->rope, 0, text_length);
+    for (;;) {
+        size_t length;
+        bool more = fs_rope_iter_next(&iter, &run, &length);
+        
+        if (more) {
+            parts[count++] = (fs_buffer_t){ (void*)run, length };
+        }
+        if (count == FS_OPLOG_TEXT_LEAVES || (!more && count)) {
+            n += fs_journal_write_record(bytes + n, FS_OPLOG_TEXT, parts, count);
+            count = 0;
+        }
+        if (!more) {
+            break;
+        }
+    }
+    
+    error = fs_journal_rewrite(log->snapshot_path, bytes, size);
+    free(bytes);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    log->snapshot_size = size;
+    return fs_oplog_reset(log, log->sequence);
+}
+
+bool fs_oplog_idle(const fs_oplog_t* log) {
+    return !log->group_count;
+}
@@ -28,3 +28,540 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Flag byte of an encoded operation; the high nibble holds lengths up to 15.
+#define FS_TRANSPORT_DELETE 0x01
+#define FS_TRANSPORT_NEW_CLIENT 0x02        // the client differs from the previous operation's
+#define FS_TRANSPORT_FOREIGN_ORIGIN 0x04    // the origin was made by another client
+#define FS_TRANSPORT_ROOT_ORIGIN 0x08       // an insert at the document start
+#define FS_TRANSPORT_LENGTH_SHIFT 4
+
+// Largest encoding of an operation without its text, and of a message header.
+#define FS_TRANSPORT_OP_MAX 32
+#define FS_TRANSPORT_HEADER_MAX 20
+
+// A lone acknowledgement waits this many windows for a message to ride on, one once two are owed.
+#define FS_TRANSPORT_ACK_DELAY 4
+
+typedef struct {
+    fs_crdt_op_t op;
+    size_t text;                // offset of an insert's bytes in `text`
+} fs_transport_entry_t;
+
+typedef struct {
+    uint64_t sequence;
+    size_t length;
+    uint8_t* bytes;
+} fs_transport_message_t;
+
+/* The previous operation of a message, which the next one is encoded against. */
+typedef struct {
+    uint32_t client;
+    uint32_t clock;
+} fs_transport_state_t;
+
+struct fs_transport {
+    uint32_t window_ms;
+    size_t max_message;
+    uint32_t max_in_flight;
+    fs_transport_send_t send;
+    void* context;
+    
+    // Local operations not sent yet, oldest first.
+    fs_transport_entry_t* queue;
+    size_t queue_count;
+    size_t queue_capacity;
+    uint8_t* text;
+    size_t text_length;
+    size_t text_capacity;
+    uint64_t queued_at;         // when the oldest of them was queued
+    size_t queued_bytes;        // about what they encode to
+    
+    // Sent messages not acknowledged yet, a ring of `max_in_flight`.
+    fs_transport_message_t* flight;
+    size_t flight_head;
+    size_t flight_count;
+    uint64_t next_sequence;
+    
+    uint64_t received;          // last message of the other side, in order
+    bool ack_pending;
+    size_t ack_owed;            // messages received since the last acknowledgement
+    uint64_t ack_due;
+};
+
+static size_t fs_transport_put_varint(uint8_t* p, uint64_t value) {
+    size_t n = 0;
+    
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool fs_transport_get_varint(const uint8_t** p, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        
+        if (*p == end) {
+            return false;
+        }
+        byte = *(*p)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool fs_transport_get_u32(const uint8_t** p, const uint8_t* end, uint32_t* value) {
+    uint64_t wide;
+    
+    if (!fs_transport_get_varint(p, end, &wide) || wide > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t)wide;
+    return true;
+}
+
+static inline uint64_t fs_transport_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t fs_transport_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* Writes `op`, at most FS_TRANSPORT_OP_MAX bytes plus the text. */
+static size_t fs_transport_encode_op(uint8_t* p, const fs_crdt_op_t* op, const uint8_t* text,
+                                     fs_transport_state_t* state) {
+    bool insert = op->kind == FS_CRDT_INSERT;
+    uint8_t flags = insert ? 0 : FS_TRANSPORT_DELETE;
+    size_t n = 1;
+    
+    if (op->id.client != state->client) {
+        flags |= FS_TRANSPORT_NEW_CLIENT;
+    }
+    if (insert && !op->origin.clock) {
+        flags |= FS_TRANSPORT_ROOT_ORIGIN;
+    } else if (op->origin.client != op->id.client) {
+        flags |= FS_TRANSPORT_FOREIGN_ORIGIN;
+    }
+    if (op->length < 16) {
+        flags |= (uint8_t)(op->length << FS_TRANSPORT_LENGTH_SHIFT);
+    }
+    p[0] = flags;
+    
+    if (flags & FS_TRANSPORT_NEW_CLIENT) {
+        n += fs_transport_put_varint(p + n, op->id.client);
+    }
+    n += fs_transport_put_varint(p + n, fs_transport_zigzag((int64_t)op->id.clock - state->clock));
+    if (!(flags & FS_TRANSPORT_ROOT_ORIGIN)) {
+        if (flags & FS_TRANSPORT_FOREIGN_ORIGIN) {
+            n += fs_transport_put_varint(p + n, op->origin.client);
+        }
+        // Typing and backspacing refer to the character just before, one byte.
+        n += fs_transport_put_varint(p + n, fs_transport_zigzag((int64_t)op->origin.clock - op->id.clock));
+    }
+    if (op->length >= 16) {
+        n += fs_transport_put_varint(p + n, op->length);
+    }
+    if (insert) {
+        memcpy(p + n, text, op->length);
+        n += op->length;
+    }
+    
+    state->client = op->id.client;
+    state->clock = op->id.clock + (insert ? op->length : 1);
+    return n;
+}
+
+static bool fs_transport_decode_op(const uint8_t** p, const uint8_t* end, fs_crdt_op_t* op, const uint8_t** text,
+                                   fs_transport_state_t* state) {
+    uint8_t flags;
+    uint64_t delta;
+    int64_t clock;
+    
+    if (*p == end) {
+        return false;
+    }
+    flags = *(*p)++;
+    memset(op, 0, sizeof(*op));
+    op->kind = flags & FS_TRANSPORT_DELETE ? FS_CRDT_DELETE : FS_CRDT_INSERT;
+    op->id.client = state->client;
+    
+    if ((flags & FS_TRANSPORT_NEW_CLIENT) && !fs_transport_get_u32(p, end, &op->id.client)) {
+        return false;
+    }
+    if (!fs_transport_get_varint(p, end, &delta)) {
+        return false;
+    }
+    clock = (int64_t)state->clock + fs_transport_unzigzag(delta);
+    if (clock < 1 || clock > UINT32_MAX || !op->id.client) {
+        return false;
+    }
+    op->id.clock = (uint32_t)clock;
+    
+    if (flags & FS_TRANSPORT_ROOT_ORIGIN) {
+        if (op->kind == FS_CRDT_DELETE) {
+            return false;
+        }
+    } else {
+        op->origin.client = op->id.client;
+        if ((flags & FS_TRANSPORT_FOREIGN_ORIGIN) && !fs_transport_get_u32(p, end, &op->origin.client)) {
+            return false;
+        }
+        if (!fs_transport_get_varint(p, end, &delta)) {
+            return false;
+        }
+        clock = (int64_t)op->id.clock + fs_transport_unzigzag(delta);
+        if (clock < 1 || clock > UINT32_MAX) {
+            return false;
+        }
+        op->origin.clock = (uint32_t)clock;
+    }
+    
+    op->length = flags >> FS_TRANSPORT_LENGTH_SHIFT;
+    if (!op->length && (!fs_transport_get_u32(p, end, &op->length) || op->length < 16)) {
+        return false;
+    }
+    if (op->kind == FS_CRDT_INSERT) {
+        if ((size_t)(end - *p) < op->length) {
+            return false;
+        }
+        *text = *p;
+        *p += op->length;
+    } else {
+        *text = NULL;
+    }
+    
+    state->client = op->id.client;
+    state->clock = op->id.clock + (op->kind == FS_CRDT_INSERT ? op->length : 1);
+    return true;
+}
+
+static void fs_transport_send_ack(fs_transport_t* transport) {
+    uint8_t bytes[FS_TRANSPORT_HEADER_MAX];
+    size_t n = fs_transport_put_varint(bytes, 0);
+    
+    n += fs_transport_put_varint(bytes + n, transport->received);
+    transport->ack_pending = false;
+    transport->ack_owed = 0;
+    transport->send(transport->context, bytes, n);
+}
+
+/*
+ Encodes queued operations into the next message slot until it is full,
+ splitting an insert that does not fit, and sends it.
+ */
+static void fs_transport_send_batch(fs_transport_t* transport) {
+    size_t slot = (transport->flight_head + transport->flight_count) % transport->max_in_flight;
+    fs_transport_message_t* message = &transport->flight[slot];
+    fs_transport_state_t state = { 0, 0 };
+    uint8_t* p = message->bytes;
+    size_t taken = 0, n;
+    
+    message->sequence = transport->next_sequence++;
+    n = fs_transport_put_varint(p, message->sequence);
+    n += fs_transport_put_varint(p + n, transport->received);
+    transport->ack_pending = false;
+    transport->ack_owed = 0;
+    
+    while (taken < transport->queue_count && transport->max_message - n > FS_TRANSPORT_OP_MAX) {
+        fs_transport_entry_t* entry = &transport->queue[taken];
+        size_t room = transport->max_message - n - FS_TRANSPORT_OP_MAX;
+        
+        if (entry->op.kind == FS_CRDT_INSERT && entry->op.length > room) {
+            // Send the head of the insert; the rest continues it from the last character sent.
+            fs_crdt_op_t head = entry->op;
+            
+            head.length = (uint32_t)room;
+            n += fs_transport_encode_op(p + n, &head, transport->text + entry->text, &state);
+            entry->op.id.clock += head.length;
+            entry->op.origin.client = entry->op.id.client;
+            entry->op.origin.clock = entry->op.id.clock - 1;
+            entry->op.length -= head.length;
+            entry->text += head.length;
+            break;
+        }
+        n += fs_transport_encode_op(p + n, &entry->op, transport->text + entry->text, &state);
+        taken++;
+    }
+    message->length = n;
+    transport->flight_count++;
+    
+    // Move what is left to the front of the queue.
+    transport->queue_count -= taken;
+    memmove(transport->queue, transport->queue + taken, transport->queue_count * sizeof(*transport->queue));
+    transport->queued_bytes = 0;
+    if (transport->queue_count) {
+        size_t base = transport->queue[0].text;
+        
+        for (size_t i = 0; i < transport->queue_count; i++) {
+            transport->queue[i].text -= base;
+            transport->queued_bytes += FS_TRANSPORT_OP_MAX / 4;
+            if (transport->queue[i].op.kind == FS_CRDT_INSERT) {
+                transport->queued_bytes += transport->queue[i].op.length;
+            }
+        }
+        transport->text_length -= base;
+        memmove(transport->text, transport->text + base, transport->text_length);
+    } else {
+        transport->text_length = 0;
+    }
+    
+    transport->send(transport->context, message->bytes, message->length);
+}
+
+static void fs_transport_pump(fs_transport_t* transport, uint64_t now_ms, bool force) {
+    while (transport->queue_count && transport->flight_count < transport->max_in_flight &&
+           (force || now_ms - transport->queued_at >= transport->window_ms ||
+            transport->queued_bytes >= transport->max_message)) {
+        fs_transport_send_batch(transport);
+    }
+    if (transport->ack_pending && (force || now_ms >= transport->ack_due)) {
+        fs_transport_send_ack(transport);
+    }
+}
+
+fs_error_t fs_transport_create(const fs_transport_config_t* config, fs_transport_send_t send, void* context,
+                               fs_transport_t** out) {
+    fs_transport_t* transport;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!send || (config && config->max_message && config->max_message < 64)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    transport = calloc(1, sizeof(*transport));
+    if (!transport) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    transport->window_ms = config && config->window_ms ? config->window_ms : FS_TRANSPORT_WINDOW_MS;
+    transport->max_message = config && config->max_message ? config->max_message : FS_TRANSPORT_MAX_MESSAGE;
+    transport->max_in_flight = config && config->max_in_flight ? config->max_in_flight : FS_TRANSPORT_MAX_IN_FLIGHT;
+    transport->send = send;
+    transport->context = context;
+    transport->next_sequence = 1;
+    
+    transport->flight = calloc(transport->max_in_flight, sizeof(*transport->flight));
+    if (!transport->flight) {
+        free(transport);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (uint32_t i = 0; i < transport->max_in_flight; i++) {
+        transport->flight[i].bytes = malloc(transport->max_message);
+        if (!transport->flight[i].bytes) {
+            fs_transport_destroy(transport);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    *out = transport;
+    return FS_ERROR_NONE;
+}
+
+void fs_transport_destroy(fs_transport_t* transport) {
+    if (!transport) {
+        return;
+    }
+    for (uint32_t i = 0; i < transport->max_in_flight; i++) {
+        free(transport->flight[i].bytes);
+    }
+    free(transport->flight);
+    free(transport->queue);
+    free(transport->text);
+    free(transport);
+}
+
+static bool fs_transport_reserve_text(fs_transport_t* transport, size_t length) {
+    if (transport->text_capacity - transport->text_length < length) {
+        size_t capacity = transport->text_capacity ? transport->text_capacity : 256;
+        uint8_t* text;
+        
+        while (capacity - transport->text_length < length) {
+            capacity *= 2;
+        }
+        text = realloc(transport->text, capacity);
+        if (!text) {
+            return false;
+        }
+        transport->text = text;
+        transport->text_capacity = capacity;
+    }
+    return true;
+}
+
+/* Folds `op` into the last queued operation when it continues it. */
+static bool fs_transport_fold(fs_crdt_op_t* last, const fs_crdt_op_t* op) {
+    if (last->kind != op->kind || last->id.client != op->id.client || last->length > UINT32_MAX - op->length) {
+        return false;
+    }
+    if (op->kind == FS_CRDT_INSERT) {
+        // Typing on after the last inserted character.
+        if (op->id.clock != last->id.clock + last->length || op->origin.client != op->id.client ||
+            op->origin.clock != op->id.clock - 1) {
+            return false;
+        }
+        last->length += op->length;
+        return true;
+    }
+    if (op->origin.client != last->origin.client || op->id.clock <= last->id.clock) {
+        return false;
+    }
+    if (op->origin.clock + op->length == last->origin.clock) {
+        // Backspace.
+        last->origin.clock = op->origin.clock;
+    } else if (op->origin.clock != last->origin.clock + last->length) {
+        // Not a forward delete either.
+        return false;
+    }
+    // The later id keeps the client's clocks increasing on the wire.
+    last->id = op->id;
+    last->length += op->length;
+    return true;
+}
+
+fs_error_t fs_transport_queue(fs_transport_t* transport, const fs_crdt_op_t* op, const uint8_t* text,
+                              uint64_t now_ms) {
+    bool insert;
+    
+    if (!op || !op->length || !op->id.client || !op->id.clock ||
+        (op->kind != FS_CRDT_INSERT && op->kind != FS_CRDT_DELETE)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    insert = op->kind == FS_CRDT_INSERT;
+    if ((insert && !text) || (!insert && !op->origin.clock)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (insert && !fs_transport_reserve_text(transport, op->length)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    if (!transport->queue_count || !fs_transport_fold(&transport->queue[transport->queue_count - 1].op, op)) {
+        if (transport->queue_count == transport->queue_capacity) {
+            size_t capacity = transport->queue_capacity ? transport->queue_capacity * 2 : 32;
+            fs_transport_entry_t* queue = realloc(transport->queue, capacity * sizeof(*queue));
+            if (!queue) {
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            transport->queue = queue;
+            transport->queue_capacity = capacity;
+        }
+        if (!transport->queue_count) {
+            transport->queued_at = now_ms;
+        }
+        transport->queue[transport->queue_count].op = *op;
+        transport->queue[transport->queue_count].text = transport->text_length;
+        transport->queue_count++;
+        transport->queued_bytes += FS_TRANSPORT_OP_MAX / 4;
+    }
+    if (insert) {
+        memcpy(transport->text + transport->text_length, text, op->length);
+        transport->text_length += op->length;
+        transport->queued_bytes += op->length;
+    }
+    
+    fs_transport_pump(transport, now_ms, false);
+    return FS_ERROR_NONE;
+}
+
+void fs_transport_poll(fs_transport_t* transport, uint64_t now_ms, uint64_t* deadline_ms) {
+    uint64_t deadline = UINT64_MAX;
+    
+    fs_transport_pump(transport, now_ms, false);
+    
+    // A full pipeline waits for an acknowledgement, not for the clock.
+    if (transport->queue_count && transport->flight_count < transport->max_in_flight) {
+        deadline = transport->queued_at + transport->window_ms;
+    }
+    if (transport->ack_pending && transport->ack_due < deadline) {
+        deadline = transport->ack_due;
+    }
+    if (deadline_ms) {
+        *deadline_ms = deadline;
+    }
+}
+
+void fs_transport_flush(fs_transport_t* transport, uint64_t now_ms) {
+    fs_transport_pump(transport, now_ms, true);
+}
+
+/* Walks the operations of a message body; with no handler it only checks them. */
+static bool fs_transport_decode(const uint8_t* p, const uint8_t* end, fs_transport_op_handler_t handler,
+                                void* context) {
+    fs_transport_state_t state = { 0, 0 };
+    
+    while (p < end) {
+        fs_crdt_op_t op;
+        const uint8_t* text;
+        
+        if (!fs_transport_decode_op(&p, end, &op, &text, &state)) {
+            return false;
+        }
+        if (handler) {
+            handler(context, &op, text);
+        }
+    }
+    return true;
+}
+
+fs_error_t fs_transport_receive(fs_transport_t* transport, const uint8_t* bytes, size_t length,
+                                fs_transport_op_handler_t handler, void* context, uint64_t now_ms) {
+    const uint8_t* p = bytes;
+    const uint8_t* end = bytes + length;
+    uint64_t sequence, ack;
+    
+    if (!bytes || !handler) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (!fs_transport_get_varint(&p, end, &sequence) || !fs_transport_get_varint(&p, end, &ack) ||
+        ack >= transport->next_sequence || (!sequence && p != end) || !fs_transport_decode(p, end, NULL, NULL)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    while (transport->flight_count && transport->flight[transport->flight_head].sequence <= ack) {
+        transport->flight_head = (transport->flight_head + 1) % transport->max_in_flight;
+        transport->flight_count--;
+    }
+    
+    if (sequence) {
+        // Repeats after a resend and gaps are not delivered, only acknowledged.
+        if (sequence == transport->received + 1) {
+            fs_transport_decode(p, end, handler, context);
+            transport->received = sequence;
+        }
+        if (!transport->ack_pending) {
+            transport->ack_pending = true;
+            transport->ack_due = now_ms + (uint64_t)transport->window_ms * FS_TRANSPORT_ACK_DELAY;
+        }
+        if (++transport->ack_owed >= 2 && transport->ack_due > now_ms + transport->window_ms) {
+            transport->ack_due = now_ms + transport->window_ms;
+        }
+    }
+    
+    fs_transport_pump(transport, now_ms, false);
+    return FS_ERROR_NONE;
+}
+
+void fs_transport_resend(fs_transport_t* transport) {
+    for (size_t i = 0; i < transport->flight_count; i++) {
+        const fs_transport_message_t* message =
+            &transport->flight[(transport->flight_head + i) % transport->max_in_flight];
+        transport->send(transport->context, message->bytes, message->length);
+    }
+}
+
+bool fs_transport_idle(const fs_transport_t* transport) {
+    return !transport->queue_count && !transport->flight_count;
+}
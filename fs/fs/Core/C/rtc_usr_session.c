@@ -28,3 +28,681 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/rtc.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Kind byte of a message. A snapshot replaces the receiver's participants;
+// one split over several messages begins with the first and ends with the last.
+#define FS_PRESENCE_SNAPSHOT 0x01
+#define FS_PRESENCE_BEGIN 0x02
+#define FS_PRESENCE_END 0x04
+
+// Mask bit of an entry whose user has left; no fields follow.
+#define FS_PRESENCE_LEFT 0x80
+
+// Largest encoded entry: user, mask, two deltas per pair, two bytes.
+#define FS_PRESENCE_ENTRY_MAX 28
+
+typedef struct {
+    uint32_t user;
+    fs_presence_t current;      // as last received
+    fs_presence_t sent;         // as last broadcast, what every established receiver holds
+    bool announce;              // joined, not broadcast yet
+    bool leaving;               // left, not broadcast yet
+    bool fresh;                 // needs a snapshot before any batch
+} fs_presence_slot_t;
+
+struct fs_presence_hub {
+    uint32_t tick_ms;
+    size_t max_message;
+    fs_presence_fanout_t fanout;
+    void* context;
+    
+    fs_presence_slot_t* slots;  // by user
+    size_t count;
+    size_t capacity;
+    uint32_t* recipients;       // `capacity` entries
+    uint8_t* message;           // `max_message` bytes
+    
+    uint32_t resume;            // user the next batch starts at, after a cut-short one
+    bool pending;
+    uint64_t last_tick;
+    bool ticked;
+};
+
+typedef struct {
+    uint32_t user;
+    fs_presence_t state;
+    bool stale;                 // not in the snapshot being received
+} fs_presence_peer_t;
+
+struct fs_presence_client {
+    uint32_t user;
+    uint32_t tick_ms;
+    fs_presence_send_t send;
+    void* context;
+    fs_presence_t current;
+    fs_presence_t sent;
+    uint64_t last_tick;
+    bool ticked;
+    
+    fs_presence_peer_t* peers;  // by user
+    size_t count;
+    size_t capacity;
+};
+
+static const fs_presence_t fs_presence_zero;
+
+static size_t fs_presence_put_varint(uint8_t* p, uint32_t value) {
+    size_t n = 0;
+    
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static bool fs_presence_get_varint(const uint8_t** p, const uint8_t* end, uint32_t* value) {
+    uint32_t result = 0;
+    
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        uint8_t byte;
+        
+        if (*p == end) {
+            return false;
+        }
+        byte = *(*p)++;
+        if (shift == 28 && byte > 0x0F) {
+            return false;
+        }
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Differences wrap, so every pair of values has a delta and small moves
+// either way stay small.
+static inline uint32_t fs_presence_zigzag(uint32_t to, uint32_t from) {
+    uint32_t delta = to - from;
+    
+    return (delta << 1) ^ (uint32_t)-(int32_t)(delta >> 31);
+}
+
+static inline uint32_t fs_presence_unzigzag(uint32_t from, uint32_t value) {
+    return from + ((value >> 1) ^ (uint32_t)-(int32_t)(value & 1));
+}
+
+static uint32_t fs_presence_diff(const fs_presence_t* a, const fs_presence_t* b) {
+    uint32_t mask = 0;
+    
+    if (a->x != b->x || a->y != b->y) {
+        mask |= FS_PRESENCE_POINTER;
+    }
+    if (a->buttons != b->buttons) {
+        mask |= FS_PRESENCE_BUTTONS;
+    }
+    if (a->cursor != b->cursor || a->anchor != b->anchor) {
+        mask |= FS_PRESENCE_SELECTION;
+    }
+    if (a->status != b->status) {
+        mask |= FS_PRESENCE_STATUS;
+    }
+    return mask;
+}
+
+/* Encodes the `mask` fields of `state` against `base`. */
+static size_t fs_presence_encode(uint8_t* p, uint32_t user, uint32_t mask, const fs_presence_t* state,
+                                 const fs_presence_t* base) {
+    size_t n = fs_presence_put_varint(p, user);
+    
+    p[n++] = (uint8_t)mask;
+    if (mask & FS_PRESENCE_POINTER) {
+        n += fs_presence_put_varint(p + n, fs_presence_zigzag((uint32_t)state->x, (uint32_t)base->x));
+        n += fs_presence_put_varint(p + n, fs_presence_zigzag((uint32_t)state->y, (uint32_t)base->y));
+    }
+    if (mask & FS_PRESENCE_BUTTONS) {
+        p[n++] = state->buttons;
+    }
+    if (mask & FS_PRESENCE_SELECTION) {
+        // The anchor usually sits at the cursor, so it goes relative to it.
+        n += fs_presence_put_varint(p + n, fs_presence_zigzag(state->cursor, base->cursor));
+        n += fs_presence_put_varint(p + n, fs_presence_zigzag(state->anchor, state->cursor));
+    }
+    if (mask & FS_PRESENCE_STATUS) {
+        p[n++] = state->status;
+    }
+    return n;
+}
+
+/* Decodes the fields after an entry's mask into `state`, which holds the base. */
+static bool fs_presence_decode(const uint8_t** p, const uint8_t* end, uint32_t mask, fs_presence_t* state) {
+    uint32_t value;
+    
+    if (mask & FS_PRESENCE_POINTER) {
+        if (!fs_presence_get_varint(p, end, &value)) {
+            return false;
+        }
+        state->x = (int32_t)fs_presence_unzigzag((uint32_t)state->x, value);
+        if (!fs_presence_get_varint(p, end, &value)) {
+            return false;
+        }
+        state->y = (int32_t)fs_presence_unzigzag((uint32_t)state->y, value);
+    }
+    if (mask & FS_PRESENCE_BUTTONS) {
+        if (*p == end) {
+            return false;
+        }
+        state->buttons = *(*p)++;
+    }
+    if (mask & FS_PRESENCE_SELECTION) {
+        if (!fs_presence_get_varint(p, end, &value)) {
+            return false;
+        }
+        state->cursor = fs_presence_unzigzag(state->cursor, value);
+        if (!fs_presence_get_varint(p, end, &value)) {
+            return false;
+        }
+        state->anchor = fs_presence_unzigzag(state->cursor, value);
+    }
+    if (mask & FS_PRESENCE_STATUS) {
+        if (*p == end) {
+            return false;
+        }
+        state->status = *(*p)++;
+    }
+    return true;
+}
+
+static fs_error_t fs_presence_config(const fs_presence_config_t* config, uint32_t* tick_ms, size_t* max_message) {
+    *tick_ms = config && config->tick_ms ? config->tick_ms : FS_PRESENCE_TICK_MS;
+    *max_message = config && config->max_message ? config->max_message : FS_PRESENCE_MAX_MESSAGE;
+    return *max_message < 64 ? FS_ERROR_INVALID_ARGUMENT : FS_ERROR_NONE;
+}
+
+/* Index of `user` among the hub's slots, or where it would go. */
+static size_t fs_presence_hub_find(const fs_presence_hub_t* hub, uint32_t user, bool* found) {
+    size_t low = 0, high = hub->count;
+    
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        
+        if (hub->slots[middle].user < user) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *found = low < hub->count && hub->slots[low].user == user;
+    return low;
+}
+
+static size_t fs_presence_client_find(const fs_presence_client_t* client, uint32_t user, bool* found) {
+    size_t low = 0, high = client->count;
+    
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        
+        if (client->peers[middle].user < user) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *found = low < client->count && client->peers[low].user == user;
+    return low;
+}
+
+fs_error_t fs_presence_hub_create(const fs_presence_config_t* config, fs_presence_fanout_t fanout, void* context,
+                                  fs_presence_hub_t** out) {
+    fs_presence_hub_t* hub;
+    uint32_t tick_ms;
+    size_t max_message;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!fanout || fs_presence_config(config, &tick_ms, &max_message) != FS_ERROR_NONE) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    hub = calloc(1, sizeof(*hub));
+    if (!hub) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    hub->tick_ms = tick_ms;
+    hub->max_message = max_message;
+    hub->fanout = fanout;
+    hub->context = context;
+    hub->message = malloc(max_message);
+    if (!hub->message) {
+        free(hub);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    *out = hub;
+    return FS_ERROR_NONE;
+}
+
+void fs_presence_hub_destroy(fs_presence_hub_t* hub) {
+    if (!hub) {
+        return;
+    }
+    free(hub->slots);
+    free(hub->recipients);
+    free(hub->message);
+    free(hub);
+}
+
+fs_error_t fs_presence_hub_join(fs_presence_hub_t* hub, uint32_t user) {
+    fs_presence_slot_t* slot;
+    bool found;
+    size_t index;
+    
+    if (!user) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    index = fs_presence_hub_find(hub, user, &found);
+    if (found) {
+        // The others keep what they were last sent; the reset reaches them as a change.
+        slot = &hub->slots[index];
+        slot->current = fs_presence_zero;
+        slot->leaving = false;
+        slot->fresh = true;
+        hub->pending = true;
+        return FS_ERROR_NONE;
+    }
+    if (hub->count == hub->capacity) {
+        size_t capacity = hub->capacity ? hub->capacity * 2 : 16;
+        fs_presence_slot_t* slots = realloc(hub->slots, capacity * sizeof(*slots));
+        uint32_t* recipients;
+        
+        if (!slots) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        hub->slots = slots;
+        recipients = realloc(hub->recipients, capacity * sizeof(*recipients));
+        if (!recipients) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        hub->recipients = recipients;
+        hub->capacity = capacity;
+    }
+    memmove(&hub->slots[index + 1], &hub->slots[index], (hub->count - index) * sizeof(*hub->slots));
+    hub->count++;
+    hub->slots[index] = (fs_presence_slot_t){ .user = user, .announce = true, .fresh = true };
+    hub->pending = true;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_presence_hub_leave(fs_presence_hub_t* hub, uint32_t user) {
+    bool found;
+    size_t index = fs_presence_hub_find(hub, user, &found);
+    fs_presence_slot_t* slot = &hub->slots[index];
+    
+    if (!found || slot->leaving) {
+        return FS_ERROR_NOT_FOUND;
+    }
+    if (slot->announce) {
+        // Nobody has heard of it yet.
+        memmove(slot, slot + 1, (hub->count - index - 1) * sizeof(*slot));
+        hub->count--;
+        return FS_ERROR_NONE;
+    }
+    slot->leaving = true;
+    slot->fresh = false;
+    hub->pending = true;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_presence_hub_receive(fs_presence_hub_t* hub, uint32_t user, const uint8_t* bytes, size_t length) {
+    const uint8_t* p = bytes;
+    const uint8_t* end = bytes + length;
+    fs_presence_slot_t* slot;
+    fs_presence_t state;
+    bool found;
+    size_t index;
+    
+    index = fs_presence_hub_find(hub, user, &found);
+    if (!found || hub->slots[index].leaving) {
+        return FS_ERROR_NOT_FOUND;
+    }
+    slot = &hub->slots[index];
+    if (!length || *p++ != 0) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    state = slot->current;
+    while (p < end) {
+        uint32_t from, mask;
+        
+        if (!fs_presence_get_varint(&p, end, &from) || from != user || p == end) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        mask = *p++;
+        if ((mask & ~(uint32_t)FS_PRESENCE_ALL) || !fs_presence_decode(&p, end, mask, &state)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+    }
+    slot->current = state;
+    hub->pending = true;
+    return FS_ERROR_NONE;
+}
+
+/* Sends a snapshot of every participant to the slots that need one. */
+static void fs_presence_hub_snapshot(fs_presence_hub_t* hub) {
+    uint8_t* message = hub->message;
+    size_t recipients = 0, n = 1;
+    uint8_t kind = FS_PRESENCE_SNAPSHOT | FS_PRESENCE_BEGIN;
+    
+    for (size_t i = 0; i < hub->count; i++) {
+        if (hub->slots[i].fresh) {
+            hub->recipients[recipients++] = hub->slots[i].user;
+            hub->slots[i].fresh = false;
+        }
+    }
+    if (!recipients) {
+        return;
+    }
+    for (size_t i = 0; i < hub->count; i++) {
+        const fs_presence_slot_t* slot = &hub->slots[i];
+        
+        // Unannounced slots reach joiners with the next batch, like everyone else.
+        if (slot->leaving || slot->announce) {
+            continue;
+        }
+        if (n + FS_PRESENCE_ENTRY_MAX > hub->max_message) {
+            message[0] = kind;
+            hub->fanout(hub->context, hub->recipients, recipients, message, n);
+            kind = FS_PRESENCE_SNAPSHOT;
+            n = 1;
+        }
+        n += fs_presence_encode(message + n, slot->user, fs_presence_diff(&slot->sent, &fs_presence_zero),
+                                &slot->sent, &fs_presence_zero);
+    }
+    message[0] = kind | FS_PRESENCE_END;
+    hub->fanout(hub->context, hub->recipients, recipients, message, n);
+}
+
+static void fs_presence_hub_tick(fs_presence_hub_t* hub, uint64_t now_ms) {
+    uint8_t* message = hub->message;
+    size_t start, recipients = 0, n = 1, kept = 0;
+    bool found, cut = false;
+    
+    // One batch with everyone's changes, starting where the last one was cut short.
+    message[0] = 0;
+    start = fs_presence_hub_find(hub, hub->resume, &found);
+    for (size_t i = 0; i < hub->count; i++) {
+        fs_presence_slot_t* slot = &hub->slots[(start + i) % hub->count];
+        uint32_t mask = slot->leaving ? FS_PRESENCE_LEFT : fs_presence_diff(&slot->current, &slot->sent);
+        
+        if (!mask && !slot->announce) {
+            continue;
+        }
+        if (n + FS_PRESENCE_ENTRY_MAX > hub->max_message) {
+            hub->resume = slot->user;
+            cut = true;
+            break;
+        }
+        n += fs_presence_encode(message + n, slot->user, mask, &slot->current, &slot->sent);
+        slot->sent = slot->current;
+        slot->announce = false;
+        if (slot->leaving) {
+            slot->user = 0;     // gone once the batch is out
+        }
+    }
+    if (!cut) {
+        hub->resume = 0;
+    }
+    for (size_t i = 0; i < hub->count; i++) {
+        const fs_presence_slot_t* slot = &hub->slots[i];
+        
+        if (slot->user && !slot->leaving && !slot->fresh) {
+            hub->recipients[recipients++] = slot->user;
+        }
+    }
+    if (n > 1 && recipients) {
+        hub->fanout(hub->context, hub->recipients, recipients, message, n);
+    }
+    for (size_t i = 0; i < hub->count; i++) {
+        if (hub->slots[i].user) {
+            hub->slots[i - kept] = hub->slots[i];
+        } else {
+            kept++;
+        }
+    }
+    hub->count -= kept;
+    
+    // Joiners start from the state the batch has just brought everyone else to.
+    fs_presence_hub_snapshot(hub);
+    hub->pending = cut;
+    hub->last_tick = now_ms;
+    hub->ticked = true;
+}
+
+void fs_presence_hub_poll(fs_presence_hub_t* hub, uint64_t now_ms, uint64_t* deadline_ms) {
+    if (hub->pending && (!hub->ticked || now_ms >= hub->last_tick + hub->tick_ms)) {
+        fs_presence_hub_tick(hub, now_ms);
+    }
+    if (deadline_ms) {
+        *deadline_ms = hub->pending ? hub->last_tick + hub->tick_ms : UINT64_MAX;
+    }
+}
+
+size_t fs_presence_hub_count(const fs_presence_hub_t* hub) {
+    size_t count = 0;
+    
+    for (size_t i = 0; i < hub->count; i++) {
+        count += !hub->slots[i].leaving;
+    }
+    return count;
+}
+
+fs_error_t fs_presence_client_create(uint32_t user, const fs_presence_config_t* config, fs_presence_send_t send,
+                                     void* context, fs_presence_client_t** out) {
+    fs_presence_client_t* client;
+    uint32_t tick_ms;
+    size_t max_message;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!user || !send || fs_presence_config(config, &tick_ms, &max_message) != FS_ERROR_NONE) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    client = calloc(1, sizeof(*client));
+    if (!client) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    client->user = user;
+    client->tick_ms = tick_ms;
+    client->send = send;
+    client->context = context;
+    *out = client;
+    return FS_ERROR_NONE;
+}
+
+void fs_presence_client_destroy(fs_presence_client_t* client) {
+    if (!client) {
+        return;
+    }
+    free(client->peers);
+    free(client);
+}
+
+void fs_presence_client_set(fs_presence_client_t* client, const fs_presence_t* state) {
+    client->current = *state;
+}
+
+void fs_presence_client_poll(fs_presence_client_t* client, uint64_t now_ms, uint64_t* deadline_ms) {
+    uint32_t mask = fs_presence_diff(&client->current, &client->sent);
+    
+    if (mask && (!client->ticked || now_ms >= client->last_tick + client->tick_ms)) {
+        uint8_t message[1 + FS_PRESENCE_ENTRY_MAX];
+        size_t n;
+        
+        message[0] = 0;
+        n = 1 + fs_presence_encode(message + 1, client->user, mask, &client->current, &client->sent);
+        client->send(client->context, message, n);
+        client->sent = client->current;
+        client->last_tick = now_ms;
+        client->ticked = true;
+        mask = 0;
+    }
+    if (deadline_ms) {
+        *deadline_ms = mask ? client->last_tick + client->tick_ms : UINT64_MAX;
+    }
+}
+
+/* Checks a message from the hub and counts its entries. */
+static bool fs_presence_client_check(const uint8_t* p, const uint8_t* end, size_t* entries) {
+    uint8_t kind;
+    
+    if (p == end) {
+        return false;
+    }
+    kind = *p++;
+    if ((kind & ~(FS_PRESENCE_SNAPSHOT | FS_PRESENCE_BEGIN | FS_PRESENCE_END)) ||
+        (kind && !(kind & FS_PRESENCE_SNAPSHOT))) {
+        return false;
+    }
+    *entries = 0;
+    while (p < end) {
+        fs_presence_t scratch = fs_presence_zero;
+        uint32_t user, mask;
+        
+        if (!fs_presence_get_varint(&p, end, &user) || !user || p == end) {
+            return false;
+        }
+        mask = *p++;
+        if (mask == FS_PRESENCE_LEFT) {
+            if (kind) {
+                return false;
+            }
+        } else if ((mask & ~(uint32_t)FS_PRESENCE_ALL) || !fs_presence_decode(&p, end, mask, &scratch)) {
+            return false;
+        }
+        (*entries)++;
+    }
+    return true;
+}
+
+fs_error_t fs_presence_client_receive(fs_presence_client_t* client, const uint8_t* bytes, size_t length,
+                                      fs_presence_handler_t handler, void* context) {
+    const uint8_t* p = bytes;
+    const uint8_t* end = bytes + length;
+    size_t entries;
+    uint8_t kind;
+    
+    if (!fs_presence_client_check(p, end, &entries)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (entries > client->capacity - client->count) {
+        size_t capacity = client->capacity ? client->capacity : 16;
+        fs_presence_peer_t* peers;
+        
+        while (capacity - client->count < entries) {
+            capacity *= 2;
+        }
+        peers = realloc(client->peers, capacity * sizeof(*peers));
+        if (!peers) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        client->peers = peers;
+        client->capacity = capacity;
+    }
+    
+    kind = *p++;
+    if (kind & FS_PRESENCE_BEGIN) {
+        for (size_t i = 0; i < client->count; i++) {
+            client->peers[i].stale = true;
+        }
+    }
+    while (p < end) {
+        fs_presence_peer_t* peer;
+        fs_presence_t state;
+        uint32_t user, mask, changed;
+        bool found;
+        size_t index;
+        
+        // fs_presence_client_check accepted every entry, so these cannot fail.
+        if (!fs_presence_get_varint(&p, end, &user)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        mask = *p++;
+        index = fs_presence_client_find(client, user, &found);
+        if (mask == FS_PRESENCE_LEFT) {
+            if (found) {
+                memmove(&client->peers[index], &client->peers[index + 1],
+                        (client->count - index - 1) * sizeof(*client->peers));
+                client->count--;
+                if (handler) {
+                    handler(context, user, NULL, 0);
+                }
+            }
+            continue;
+        }
+        
+        // Snapshot entries are whole states, batch entries changes to what is held.
+        state = found && !kind ? client->peers[index].state : fs_presence_zero;
+        if (!fs_presence_decode(&p, end, mask, &state)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        if (user == client->user) {
+            continue;
+        }
+        if (!found) {
+            memmove(&client->peers[index + 1], &client->peers[index],
+                    (client->count - index) * sizeof(*client->peers));
+            client->count++;
+            changed = FS_PRESENCE_ALL;
+        } else {
+            changed = fs_presence_diff(&state, &client->peers[index].state);
+        }
+        peer = &client->peers[index];
+        peer->user = user;
+        peer->state = state;
+        peer->stale = false;
+        if (changed && handler) {
+            handler(context, user, &peer->state, changed);
+        }
+    }
+    if (kind & FS_PRESENCE_END) {
+        size_t kept = 0;
+        
+        for (size_t i = 0; i < client->count; i++) {
+            if (!client->peers[i].stale) {
+                client->peers[kept++] = client->peers[i];
+            } else if (handler) {
+                handler(context, client->peers[i].user, NULL, 0);
+            }
+        }
+        client->count = kept;
+    }
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_presence_client_get(const fs_presence_client_t* client, uint32_t user, fs_presence_t* state) {
+    bool found;
+    size_t index = fs_presence_client_find(client, user, &found);
+    
+    if (!found) {
+        return FS_ERROR_NOT_FOUND;
+    }
+    *state = client->peers[index].state;
+    return FS_ERROR_NONE;
+}
+
+size_t fs_presence_client_count(const fs_presence_client_t* client) {
+    return client->count;
+}
+
+void fs_presence_client_reset(fs_presence_client_t* client) {
+    client->sent = fs_presence_zero;
+}
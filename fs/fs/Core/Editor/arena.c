@@ -0,0 +1,369 @@
+//
+//  arena.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/arena.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ Blocks of `block_size` bytes form a list that is walked forward as the arena
+ fills and rewound to its head on reset, so a steady-state pass allocates no
+ memory at all. Requests larger than a quarter block get a block of their own
+ on the `large` list, which is the only thing that reset and rewind free.
+ */
+
+struct fs_arena_block {
+    struct fs_arena_block* next;
+    uint8_t* end;
+    _Alignas(FS_ARENA_ALIGN) uint8_t data[];
+};
+
+static struct fs_arena_block* fs_arena_block_new(size_t capacity) {
+    if (capacity > SIZE_MAX - sizeof(struct fs_arena_block)) {
+        return NULL;
+    }
+    
+    struct fs_arena_block* block = malloc(sizeof(struct fs_arena_block) + capacity);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->end = block->data + capacity;
+    return block;
+}
+
+static void fs_arena_free_large(fs_arena_t* arena, struct fs_arena_block* until) {
+    struct fs_arena_block* block = arena->large;
+    
+    while (block != NULL && block != until) {
+        struct fs_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->large = block;
+}
+
+static inline uint8_t* fs_arena_align_ptr(uint8_t* ptr, size_t align) {
+    uintptr_t p = (uintptr_t)ptr;
+    return ptr + (((p + (align - 1)) & ~(uintptr_t)(align - 1)) - p);
+}
+
+fs_error_t fs_arena_init(fs_arena_t* arena, size_t block_size) {
+    if (arena == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    memset(arena, 0, sizeof(*arena));
+    arena->block_size = block_size ? block_size : FS_ARENA_BLOCK_SIZE;
+    if (arena->block_size < 256) {
+        arena->block_size = 256;
+    }
+    return FS_ERROR_NONE;
+}
+
+void fs_arena_destroy(fs_arena_t* arena) {
+    if (arena == NULL) {
+        return;
+    }
+    
+    fs_arena_free_large(arena, NULL);
+    
+    struct fs_arena_block* block = arena->first;
+    while (block != NULL) {
+        struct fs_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    
+    size_t block_size = arena->block_size;
+    memset(arena, 0, sizeof(*arena));
+    arena->block_size = block_size;
+}
+
+void fs_arena_reset(fs_arena_t* arena) {
+    if (arena == NULL) {
+        return;
+    }
+    
+    fs_arena_free_large(arena, NULL);
+    arena->current = arena->first;
+    arena->pos = arena->first ? arena->first->data : NULL;
+    arena->end = arena->first ? arena->first->end : NULL;
+    arena->last = NULL;
+}
+
+static void* fs_arena_alloc_slow(fs_arena_t* arena, size_t size, size_t align) {
+    if (size > SIZE_MAX - align) {
+        return NULL;
+    }
+    
+    if (size + align - 1 > arena->block_size / 4) {
+        struct fs_arena_block* block = fs_arena_block_new(size + align - 1);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->large;
+        arena->large = block;
+        // `last` stays on the bump block so realloc never grows into a large one.
+        return fs_arena_align_ptr(block->data, align);
+    }
+    
+    struct fs_arena_block* block = arena->current ? arena->current->next : arena->first;
+    if (block == NULL) {
+        block = fs_arena_block_new(arena->block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        if (arena->current != NULL) {
+            arena->current->next = block;
+        } else {
+            arena->first = block;
+        }
+    }
+    
+    uint8_t* ptr = fs_arena_align_ptr(block->data, align);
+    arena->current = block;
+    arena->pos = ptr + size;
+    arena->end = block->end;
+    arena->last = ptr;
+    return ptr;
+}
+
+void* fs_arena_alloc(fs_arena_t* arena, size_t size, size_t align) {
+    if (arena == NULL) {
+        return NULL;
+    }
+    if (align == 0) {
+        align = FS_ARENA_ALIGN;
+    }
+    if ((align & (align - 1)) != 0) {
+        return NULL;
+    }
+    
+    if (arena->pos != NULL) {
+        uint8_t* ptr = fs_arena_align_ptr(arena->pos, align);
+        if (ptr <= arena->end && (size_t)(arena->end - ptr) >= size) {
+            arena->pos = ptr + size;
+            arena->last = ptr;
+            return ptr;
+        }
+    }
+    return fs_arena_alloc_slow(arena, size, align);
+}
+
+void* fs_arena_realloc(fs_arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (arena == NULL) {
+        return NULL;
+    }
+    if (ptr == NULL) {
+        return fs_arena_alloc(arena, new_size, 0);
+    }
+    
+    uint8_t* p = ptr;
+    if (p == arena->last && (size_t)(arena->end - p) >= new_size) {
+        arena->pos = p + new_size;
+        return ptr;
+    }
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    
+    void* moved = fs_arena_alloc(arena, new_size, 0);
+    if (moved != NULL) {
+        memcpy(moved, ptr, old_size);
+    }
+    return moved;
+}
+
+fs_arena_mark_t fs_arena_mark(const fs_arena_t* arena) {
+    fs_arena_mark_t mark = { arena->current, arena->large, arena->pos };
+    return mark;
+}
+
+void fs_arena_rewind(fs_arena_t* arena, fs_arena_mark_t mark) {
+    if (arena == NULL) {
+        return;
+    }
+    
+    fs_arena_free_large(arena, mark.large);
+    if (mark.block == NULL) {
+        fs_arena_reset(arena);
+        return;
+    }
+    arena->current = mark.block;
+    arena->pos = mark.pos;
+    arena->end = mark.block->end;
+    arena->last = NULL;
+}
+
+fs_error_t fs_arena_string(fs_arena_t* arena, const char* utf8, size_t len, fs_string_t* out) {
+    if (arena == NULL || out == NULL || (utf8 == NULL && len > 0) || len == SIZE_MAX) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    char* copy = fs_arena_alloc(arena, len + 1, 1);
+    if (copy == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (len > 0) {
+        memcpy(copy, utf8, len);
+    }
+    copy[len] = '\0';
+    
+    out->utf8_ptr = copy;
+    out->len = len;
+    out->owned = false;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_arena_data(fs_arena_t* arena, const void* bytes, size_t len, fs_data_t* out) {
+    if (arena == NULL || out == NULL || (bytes == NULL && len > 0)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    void* copy = NULL;
+    if (len > 0) {
+        copy = fs_arena_alloc(arena, len, 0);
+        if (copy == NULL) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        memcpy(copy, bytes, len);
+    }
+    
+    out->bytes = copy;
+    out->len = len;
+    out->owned = false;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_arena_buffer(fs_arena_t* arena, size_t len, fs_buffer_t* out) {
+    if (arena == NULL || out == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    void* ptr = NULL;
+    if (len > 0) {
+        ptr = fs_arena_alloc(arena, len, 0);
+        if (ptr == NULL) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    out->ptr = ptr;
+    out->len = len;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_arena_array(fs_arena_t* arena, size_t item_size, size_t capacity, fs_array_t* out) {
+    if (arena == NULL || out == NULL || item_size == 0) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (capacity > SIZE_MAX / item_size) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    void* items = NULL;
+    if (capacity > 0) {
+        items = fs_arena_alloc(arena, capacity * item_size, 0);
+        if (items == NULL) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    out->items = items;
+    out->count = 0;
+    out->capacity = capacity;
+    out->item_size = item_size;
+    out->owned = false;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_arena_array_push(fs_arena_t* arena, fs_array_t* array, const void* item) {
+    if (arena == NULL || array == NULL || item == NULL || array->owned || array->item_size == 0) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if (array->count == array->capacity) {
+        size_t capacity = array->capacity ? array->capacity * 2 : 8;
+        if (capacity < array->capacity || capacity > SIZE_MAX / array->item_size) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        
+        void* items = fs_arena_realloc(arena, array->items, array->capacity * array->item_size,
+                                       capacity * array->item_size);
+        if (items == NULL) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        array->items = items;
+        array->capacity = capacity;
+    }
+    
+    memcpy((uint8_t*)array->items + array->count * array->item_size, item, array->item_size);
+    array->count++;
+    return FS_ERROR_NONE;
+}
+
+static pthread_key_t fs_arena_thread_key;
+static pthread_once_t fs_arena_thread_once = PTHREAD_ONCE_INIT;
+static bool fs_arena_thread_ready = false;
+
+static void fs_arena_thread_release(void* value) {
+    fs_arena_destroy(value);
+    free(value);
+}
+
+static void fs_arena_thread_setup(void) {
+    fs_arena_thread_ready = pthread_key_create(&fs_arena_thread_key, fs_arena_thread_release) == 0;
+}
+
+fs_arena_t* fs_arena_thread(void) {
+    pthread_once(&fs_arena_thread_once, fs_arena_thread_setup);
+    if (!fs_arena_thread_ready) {
+        return NULL;
+    }
+    
+    fs_arena_t* arena = pthread_getspecific(fs_arena_thread_key);
+    if (arena != NULL) {
+        return arena;
+    }
+    
+    arena = malloc(sizeof(*arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    fs_arena_init(arena, 0);
+    if (pthread_setspecific(fs_arena_thread_key, arena) != 0) {
+        free(arena);
+        return NULL;
+    }
+    return arena;
+}
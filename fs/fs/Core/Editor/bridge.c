@@ -0,0 +1,140 @@
+//
+//  bridge.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/bridge.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/*
+ Adopted bytes get a small reference-counted box as their owner, so every
+ managed buffer goes through the same fs_memory_management_t callbacks no
+ matter where its memory came from.
+ */
+
+struct fs_bytes_box {
+    _Atomic size_t refs;
+    void* ptr;
+    size_t len;
+    fs_bytes_deallocator dealloc;
+    void* context;
+};
+
+static void fs_bytes_box_retain(void* ptr) {
+    struct fs_bytes_box* box = ptr;
+    atomic_fetch_add_explicit(&box->refs, 1, memory_order_relaxed);
+}
+
+static void fs_bytes_box_release(void* ptr) {
+    struct fs_bytes_box* box = ptr;
+    
+    if (atomic_fetch_sub_explicit(&box->refs, 1, memory_order_acq_rel) == 1) {
+        box->dealloc(box->ptr, box->len, box->context);
+        free(box);
+    }
+}
+
+static void fs_bytes_free(void* ptr, size_t len, void* context) {
+    (void)len;
+    (void)context;
+    free(ptr);
+}
+
+fs_error_t fs_managed_buffer_adopt(void* ptr, size_t len, fs_bytes_deallocator dealloc, void* context,
+                                   fs_managed_buffer_t* out) {
+    if (out == NULL || dealloc == NULL || (ptr == NULL && len > 0)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    struct fs_bytes_box* box = malloc(sizeof(*box));
+    if (box == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    atomic_init(&box->refs, 1);
+    box->ptr = ptr;
+    box->len = len;
+    box->dealloc = dealloc;
+    box->context = context;
+    
+    out->buffer.ptr = ptr;
+    out->buffer.len = len;
+    out->owner = box;
+    out->memory.retain = fs_bytes_box_retain;
+    out->memory.release = fs_bytes_box_release;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_managed_buffer_from_data(fs_data_t* data, fs_managed_buffer_t* out) {
+    if (data == NULL || out == NULL || (!data->owned && data->bytes != NULL)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    fs_error_t error = fs_managed_buffer_adopt(data->bytes, data->bytes ? data->len : 0, fs_bytes_free, NULL, out);
+    if (error == FS_ERROR_NONE) {
+        data->bytes = NULL;
+        data->len = 0;
+        data->owned = false;
+    }
+    return error;
+}
+
+fs_error_t fs_managed_buffer_wrap(void* ptr, size_t len, void* owner, const fs_memory_management_t* memory,
+                                  fs_managed_buffer_t* out) {
+    if (out == NULL || owner == NULL || memory == NULL || memory->retain == NULL || memory->release == NULL ||
+        (ptr == NULL && len > 0)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    memory->retain(owner);
+    out->buffer.ptr = ptr;
+    out->buffer.len = len;
+    out->owner = owner;
+    out->memory = *memory;
+    return FS_ERROR_NONE;
+}
+
+void fs_managed_buffer_retain(const fs_managed_buffer_t* buffer) {
+    if (buffer != NULL && buffer->owner != NULL) {
+        buffer->memory.retain(buffer->owner);
+    }
+}
+
+void fs_managed_buffer_release(fs_managed_buffer_t* buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+    
+    if (buffer->owner != NULL) {
+        buffer->memory.release(buffer->owner);
+    }
+    buffer->buffer.ptr = NULL;
+    buffer->buffer.len = 0;
+    buffer->owner = NULL;
+}
@@ -0,0 +1,67 @@
+//
+//  bridge.m
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <fs/bridge.h>
+#include <Foundation/Foundation.h>
+
+NSData* fs_managed_buffer_nsdata(fs_managed_buffer_t buffer) {
+    if (buffer.buffer.ptr == NULL || buffer.buffer.len == 0 || buffer.owner == NULL) {
+        return [NSData data];
+    }
+    
+    // The deallocator block owns one reference; NSData never frees the bytes itself.
+    fs_managed_buffer_retain(&buffer);
+    return [[NSData alloc] initWithBytesNoCopy:buffer.buffer.ptr
+                                        length:buffer.buffer.len
+                                   deallocator:^(void *bytes, NSUInteger length) {
+        fs_managed_buffer_t reference = buffer;
+        (void)bytes;
+        (void)length;
+        fs_managed_buffer_release(&reference);
+    }];
+}
+
+static void fs_nsdata_retain(void* ptr) {
+    CFRetain(ptr);
+}
+
+static void fs_nsdata_release(void* ptr) {
+    CFRelease(ptr);
+}
+
+fs_error_t fs_managed_buffer_from_nsdata(NSData* data, fs_managed_buffer_t* out) {
+    static const fs_memory_management_t memory = { fs_nsdata_retain, fs_nsdata_release };
+    
+    if (data == nil || out == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    return fs_managed_buffer_wrap((void *)data.bytes, data.length, (__bridge void *)data, &memory, out);
+}
@@ -0,0 +1,540 @@
+//
+//  dictionary.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/dictionary.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FS_DICT_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FS_DICT_NEON 1
+#endif
+
+/*
+ Control bytes: EMPTY and DELETED have the sign bit set, a full slot holds
+ the low 7 bits of its hash (H2). The slot to start probing at comes from
+ the remaining bits (H1); groups of 16 control bytes are probed in
+ triangular steps, which visits every group of a power-of-two table. The
+ first 16 control bytes are mirrored past the end so a group starting near
+ the end can be loaded without wrapping.
+
+ The table keeps at least 1/8 of the slots EMPTY (`growth_left` counts what
+ is left before a rebuild), so every probe ends. Removal leaves DELETED
+ markers, which are dropped the next time the index is rebuilt from the
+ stored hashes.
+ */
+
+#define FS_DICT_GROUP      16
+#define FS_DICT_MIN_SLOTS  16
+#define FS_DICT_EMPTY      ((int8_t)-128)
+#define FS_DICT_DELETED    ((int8_t)-2)
+
+struct fs_dict_index {
+    uint64_t seed;
+    size_t mask;
+    size_t growth_left;
+    uint32_t options;
+    uint64_t* hashes;       // one per entry, `capacity` long
+    uint32_t* slots;        // position in `keys`/`values`, `mask + 1` long
+    int8_t ctrl[];          // `mask + 1 + FS_DICT_GROUP` control bytes
+};
+
+// wyhash-style multiply-mix; the seed is per dictionary.
+static inline uint64_t fs_dict_mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t lo = ll + (hl << 32);
+    uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (lo < ll);
+    uint64_t t = lo;
+    lo += lh << 32;
+    hi += lo < t;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t fs_dict_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t fs_dict_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t fs_dict_hash(const void* key, size_t len, uint64_t seed) {
+    static const uint64_t P0 = 0xa0761d6478bd642fULL, P1 = 0xe7037ed1a0b428dbULL;
+    const uint8_t* p = key;
+    uint64_t a, b;
+    
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (fs_dict_read32(p) << 32) | fs_dict_read32(p + mid);
+            b = (fs_dict_read32(p + len - 4) << 32) | fs_dict_read32(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        while (i > 16) {
+            seed = fs_dict_mum(fs_dict_read64(p) ^ P1, fs_dict_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = fs_dict_read64(p + i - 16);
+        b = fs_dict_read64(p + i - 8);
+    }
+    return fs_dict_mum(fs_dict_mum(a ^ P1, b ^ seed) ^ P0 ^ (uint64_t)len, P1);
+}
+
+// Bit i of the result is set when control byte i of the group matches.
+static inline uint32_t fs_dict_match(const int8_t* group, int8_t h2) {
+#if defined(FS_DICT_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#elif defined(FS_DICT_NEON)
+    static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t eq = vceqq_s8(vld1q_s8(group), vdupq_n_s8(h2));
+    uint8x16_t m = vandq_u8(eq, vld1q_u8(bits));
+    return (uint32_t)vaddv_u8(vget_low_u8(m)) | ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < FS_DICT_GROUP; ++i) {
+        mask |= (uint32_t)(group[i] == h2) << i;
+    }
+    return mask;
+#endif
+}
+
+// EMPTY or DELETED, i.e. the sign bit.
+static inline uint32_t fs_dict_match_free(const int8_t* group) {
+#if defined(FS_DICT_SSE2)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#elif defined(FS_DICT_NEON)
+    static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t neg = vcltzq_s8(vld1q_s8(group));
+    uint8x16_t m = vandq_u8(neg, vld1q_u8(bits));
+    return (uint32_t)vaddv_u8(vget_low_u8(m)) | ((uint32_t)vaddv_u8(vget_high_u8(m)) << 8);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < FS_DICT_GROUP; ++i) {
+        mask |= (uint32_t)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline uint32_t fs_dict_match_empty(const int8_t* group) {
+    return fs_dict_match(group, FS_DICT_EMPTY);
+}
+
+static inline void fs_dict_set_ctrl(struct fs_dict_index* index, size_t slot, int8_t value) {
+    index->ctrl[slot] = value;
+    if (slot < FS_DICT_GROUP) {
+        index->ctrl[index->mask + 1 + slot] = value;
+    }
+}
+
+static inline size_t fs_dict_growth(size_t slots) {
+    return slots - slots / 8;
+}
+
+static inline const fs_string_t* fs_dict_keys(const fs_dictionary_t* dict) {
+    return dict->keys;
+}
+
+static size_t fs_dict_lookup(const fs_dictionary_t* dict, const char* key, size_t len, uint64_t hash, size_t* slot_out) {
+    const struct fs_dict_index* index = dict->index;
+    const fs_string_t* keys = fs_dict_keys(dict);
+    int8_t h2 = (int8_t)(hash & 0x7F);
+    size_t pos = (size_t)(hash >> 7) & index->mask;
+    size_t step = 0;
+    
+    for (;;) {
+        const int8_t* group = index->ctrl + pos;
+        for (uint32_t m = fs_dict_match(group, h2); m != 0; m &= m - 1) {
+            size_t slot = (pos + (size_t)__builtin_ctz(m)) & index->mask;
+            uint32_t e = index->slots[slot];
+            if (keys[e].len == len && (len == 0 || memcmp(keys[e].utf8_ptr, key, len) == 0)) {
+                if (slot_out != NULL) {
+                    *slot_out = slot;
+                }
+                return e;
+            }
+        }
+        if (fs_dict_match_empty(group) != 0) {
+            return SIZE_MAX;
+        }
+        step += FS_DICT_GROUP;
+        pos = (pos + step) & index->mask;
+    }
+}
+
+static size_t fs_dict_find_free(const struct fs_dict_index* index, uint64_t hash) {
+    size_t pos = (size_t)(hash >> 7) & index->mask;
+    size_t step = 0;
+    
+    for (;;) {
+        uint32_t m = fs_dict_match_free(index->ctrl + pos);
+        if (m != 0) {
+            return (pos + (size_t)__builtin_ctz(m)) & index->mask;
+        }
+        step += FS_DICT_GROUP;
+        pos = (pos + step) & index->mask;
+    }
+}
+
+// Finds the slot that points at entry `e`.
+static size_t fs_dict_slot_of(const struct fs_dict_index* index, uint32_t e) {
+    uint64_t hash = index->hashes[e];
+    int8_t h2 = (int8_t)(hash & 0x7F);
+    size_t pos = (size_t)(hash >> 7) & index->mask;
+    size_t step = 0;
+    
+    for (;;) {
+        for (uint32_t m = fs_dict_match(index->ctrl + pos, h2); m != 0; m &= m - 1) {
+            size_t slot = (pos + (size_t)__builtin_ctz(m)) & index->mask;
+            if (index->slots[slot] == e) {
+                return slot;
+            }
+        }
+        step += FS_DICT_GROUP;
+        pos = (pos + step) & index->mask;
+    }
+}
+
+static size_t fs_dict_slots_for(size_t count) {
+    size_t slots = FS_DICT_MIN_SLOTS;
+    while (fs_dict_growth(slots) < count) {
+        if (slots > SIZE_MAX / 4) {
+            return 0;
+        }
+        slots *= 2;
+    }
+    return slots;
+}
+
+static struct fs_dict_index* fs_dict_index_new(size_t slots) {
+    if (slots == 0 || slots > UINT32_MAX ||
+        slots > (SIZE_MAX - sizeof(struct fs_dict_index) - FS_DICT_GROUP) / (1 + sizeof(uint32_t))) {
+        return NULL;
+    }
+    
+    struct fs_dict_index* index = malloc(sizeof(struct fs_dict_index) + slots + FS_DICT_GROUP + slots * sizeof(uint32_t));
+    if (index == NULL) {
+        return NULL;
+    }
+    index->mask = slots - 1;
+    index->growth_left = fs_dict_growth(slots);
+    index->slots = (uint32_t*)(void*)(index->ctrl + slots + FS_DICT_GROUP);
+    memset(index->ctrl, (uint8_t)FS_DICT_EMPTY, slots + FS_DICT_GROUP);
+    return index;
+}
+
+// Replaces the index with one of `slots` slots over the current entries.
+static fs_error_t fs_dict_rebuild(fs_dictionary_t* dict, size_t slots) {
+    struct fs_dict_index* old = dict->index;
+    struct fs_dict_index* index = fs_dict_index_new(slots);
+    if (index == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    index->seed = old->seed;
+    index->options = old->options;
+    index->hashes = old->hashes;
+    index->growth_left -= dict->count;
+    
+    for (size_t e = 0; e < dict->count; ++e) {
+        size_t slot = fs_dict_find_free(index, index->hashes[e]);
+        fs_dict_set_ctrl(index, slot, (int8_t)(index->hashes[e] & 0x7F));
+        index->slots[slot] = (uint32_t)e;
+    }
+    
+    free(old);
+    dict->index = index;
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_dict_grow_entries(fs_dictionary_t* dict, size_t capacity) {
+    struct fs_dict_index* index = dict->index;
+    if (capacity <= dict->capacity) {
+        return FS_ERROR_NONE;
+    }
+    if (capacity >= UINT32_MAX || capacity > SIZE_MAX / sizeof(fs_string_t)) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    // Each array only ever grows, so a partial failure leaves them usable.
+    fs_string_t* keys = realloc(dict->keys, capacity * sizeof(fs_string_t));
+    if (keys == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    dict->keys = keys;
+    void** values = realloc(dict->values, capacity * sizeof(void*));
+    if (values == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    dict->values = values;
+    uint64_t* hashes = realloc(index->hashes, capacity * sizeof(uint64_t));
+    if (hashes == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    index->hashes = hashes;
+    dict->capacity = capacity;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_dict_init(fs_dictionary_t* dict, size_t capacity, uint32_t options) {
+    if (dict == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    memset(dict, 0, sizeof(*dict));
+    
+    struct fs_dict_index* index = fs_dict_index_new(fs_dict_slots_for(capacity));
+    if (index == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    // Per-dictionary seed; addresses differ between runs under ASLR.
+    index->seed = fs_dict_mum((uint64_t)(uintptr_t)dict ^ 0x9e3779b97f4a7c15ULL, (uint64_t)(uintptr_t)index | 1);
+    index->options = options;
+    index->hashes = NULL;
+    dict->index = index;
+    
+    fs_error_t error = fs_dict_grow_entries(dict, capacity);
+    if (error != FS_ERROR_NONE) {
+        fs_dict_free(dict);
+        return error;
+    }
+    dict->owned = true;
+    return FS_ERROR_NONE;
+}
+
+static void fs_dict_free_keys(fs_dictionary_t* dict) {
+    const struct fs_dict_index* index = dict->index;
+    if (index->options & FS_DICT_BORROW_KEYS) {
+        return;
+    }
+    
+    fs_string_t* keys = dict->keys;
+    for (size_t e = 0; e < dict->count; ++e) {
+        free((void*)keys[e].utf8_ptr);
+    }
+}
+
+void fs_dict_free(fs_dictionary_t* dict) {
+    if (dict == NULL) {
+        return;
+    }
+    
+    struct fs_dict_index* index = dict->index;
+    if (index != NULL) {
+        fs_dict_free_keys(dict);
+        free(index->hashes);
+        free(index);
+    }
+    free(dict->keys);
+    free(dict->values);
+    memset(dict, 0, sizeof(*dict));
+}
+
+void fs_dict_clear(fs_dictionary_t* dict) {
+    if (dict == NULL || dict->index == NULL) {
+        return;
+    }
+    
+    struct fs_dict_index* index = dict->index;
+    fs_dict_free_keys(dict);
+    dict->count = 0;
+    memset(index->ctrl, (uint8_t)FS_DICT_EMPTY, index->mask + 1 + FS_DICT_GROUP);
+    index->growth_left = fs_dict_growth(index->mask + 1);
+}
+
+fs_error_t fs_dict_reserve(fs_dictionary_t* dict, size_t count) {
+    if (dict == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (dict->index == NULL) {
+        return dict->keys == NULL ? fs_dict_init(dict, count, 0) : FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    struct fs_dict_index* index = dict->index;
+    if (count > fs_dict_growth(index->mask + 1)) {
+        fs_error_t error = fs_dict_rebuild(dict, fs_dict_slots_for(count));
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    return fs_dict_grow_entries(dict, count);
+}
+
+fs_error_t fs_dict_set(fs_dictionary_t* dict, const char* key, size_t key_len, void* value) {
+    if (dict == NULL || (key == NULL && key_len > 0)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (dict->index == NULL) {
+        fs_error_t error = fs_dict_reserve(dict, 0);
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    
+    struct fs_dict_index* index = dict->index;
+    uint64_t hash = fs_dict_hash(key, key_len, index->seed);
+    size_t e = fs_dict_lookup(dict, key, key_len, hash, NULL);
+    if (e != SIZE_MAX) {
+        ((void**)dict->values)[e] = value;
+        return FS_ERROR_NONE;
+    }
+    
+    if (dict->count == dict->capacity) {
+        size_t capacity = dict->capacity < 8 ? 8 : dict->capacity * 2;
+        fs_error_t error = fs_dict_grow_entries(dict, capacity);
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    if (index->growth_left == 0) {
+        // Mostly DELETED markers: rebuild at the same size, otherwise double.
+        size_t slots = index->mask + 1;
+        if (dict->count + 1 > fs_dict_growth(slots) / 2) {
+            slots *= 2;
+        }
+        fs_error_t error = fs_dict_rebuild(dict, slots);
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+        index = dict->index;
+    }
+    
+    fs_string_t stored = { key, key_len, false };
+    if ((index->options & FS_DICT_BORROW_KEYS) == 0) {
+        char* copy = malloc(key_len + 1);
+        if (copy == NULL) {
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+        if (key_len > 0) {
+            memcpy(copy, key, key_len);
+        }
+        copy[key_len] = '\0';
+        stored.utf8_ptr = copy;
+        stored.owned = true;
+    }
+    
+    size_t slot = fs_dict_find_free(index, hash);
+    if (index->ctrl[slot] == FS_DICT_EMPTY) {
+        index->growth_left--;
+    }
+    fs_dict_set_ctrl(index, slot, (int8_t)(hash & 0x7F));
+    index->slots[slot] = (uint32_t)dict->count;
+    
+    ((fs_string_t*)dict->keys)[dict->count] = stored;
+    ((void**)dict->values)[dict->count] = value;
+    index->hashes[dict->count] = hash;
+    dict->count++;
+    return FS_ERROR_NONE;
+}
+
+size_t fs_dict_position(const fs_dictionary_t* dict, const char* key, size_t key_len) {
+    if (dict == NULL || dict->index == NULL || dict->count == 0 || (key == NULL && key_len > 0)) {
+        return SIZE_MAX;
+    }
+    
+    const struct fs_dict_index* index = dict->index;
+    return fs_dict_lookup(dict, key, key_len, fs_dict_hash(key, key_len, index->seed), NULL);
+}
+
+bool fs_dict_find(const fs_dictionary_t* dict, const char* key, size_t key_len, void** value) {
+    size_t e = fs_dict_position(dict, key, key_len);
+    if (e == SIZE_MAX) {
+        return false;
+    }
+    if (value != NULL) {
+        *value = ((void**)dict->values)[e];
+    }
+    return true;
+}
+
+bool fs_dict_remove(fs_dictionary_t* dict, const char* key, size_t key_len, void** value) {
+    if (dict == NULL || dict->index == NULL || dict->count == 0 || (key == NULL && key_len > 0)) {
+        return false;
+    }
+    
+    struct fs_dict_index* index = dict->index;
+    size_t slot;
+    size_t e = fs_dict_lookup(dict, key, key_len, fs_dict_hash(key, key_len, index->seed), &slot);
+    if (e == SIZE_MAX) {
+        return false;
+    }
+    
+    fs_string_t* keys = dict->keys;
+    void** values = dict->values;
+    if (value != NULL) {
+        *value = values[e];
+    }
+    if (keys[e].owned) {
+        free((void*)keys[e].utf8_ptr);
+    }
+    fs_dict_set_ctrl(index, slot, FS_DICT_DELETED);
+    
+    size_t last = dict->count - 1;
+    if (index->options & FS_DICT_ORDERED) {
+        size_t tail = last - e;
+        memmove(keys + e, keys + e + 1, tail * sizeof(*keys));
+        memmove(values + e, values + e + 1, tail * sizeof(*values));
+        memmove(index->hashes + e, index->hashes + e + 1, tail * sizeof(*index->hashes));
+        if (tail > 0) {
+            for (size_t s = 0; s <= index->mask; ++s) {
+                if (index->ctrl[s] >= 0 && index->slots[s] > e) {
+                    index->slots[s]--;
+                }
+            }
+        }
+    } else if (e != last) {
+        index->slots[fs_dict_slot_of(index, (uint32_t)last)] = (uint32_t)e;
+        keys[e] = keys[last];
+        values[e] = values[last];
+        index->hashes[e] = index->hashes[last];
+    }
+    dict->count--;
+    return true;
+}
@@ -0,0 +1,383 @@
+//
+//  enc_detect.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "enc_internal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ Encoding detection.
+
+ fs_enc_detect() makes one pass over the input: the active kernel turns each
+ 64-byte block into LF/CR/NUL bitmasks (folded into line ending and NUL
+ statistics by fs_enc_account_block) and validates UTF-8 on the way, skipping
+ the validation for blocks that are pure ASCII. The classification below only
+ looks at the accumulated statistics.
+ */
+
+// MARK: - Scalar kernel
+
+static int fs_enc_scalar_is_supported(void) {
+    return 1;
+}
+
+static void fs_enc_scalar_utf8(struct fs_enc_scan* scan, const uint8_t* data, size_t len) {
+    uint8_t need = scan->utf8_need;
+    uint8_t lo = scan->utf8_lo;
+    uint8_t hi = scan->utf8_hi;
+    size_t i;
+    
+    for (i = 0; i < len; ++i) {
+        uint8_t b = data[i];
+        
+        if (need) {
+            if (b < lo || b > hi) {
+                break;
+            }
+            --need;
+            lo = 0x80;
+            hi = 0xBF;
+            continue;
+        }
+        
+        if (b < 0x80) {
+            continue;
+        } else if (b >= 0xC2 && b <= 0xDF) {
+            need = 1; lo = 0x80; hi = 0xBF;
+        } else if (b == 0xE0) {
+            need = 2; lo = 0xA0; hi = 0xBF;
+        } else if (b == 0xED) {
+            need = 2; lo = 0x80; hi = 0x9F;
+        } else if (b >= 0xE1 && b <= 0xEF) {
+            need = 2; lo = 0x80; hi = 0xBF;
+        } else if (b == 0xF0) {
+            need = 3; lo = 0x90; hi = 0xBF;
+        } else if (b >= 0xF1 && b <= 0xF3) {
+            need = 3; lo = 0x80; hi = 0xBF;
+        } else if (b == 0xF4) {
+            need = 3; lo = 0x80; hi = 0x8F;
+        } else {
+            break;
+        }
+    }
+    
+    if (i < len) {
+        scan->utf8_error = true;
+        scan->check_utf8 = false;
+        need = 0;
+    }
+    scan->utf8_need = need;
+    scan->utf8_lo = lo;
+    scan->utf8_hi = hi;
+}
+
+static void fs_enc_scalar_scan_blocks(struct fs_enc_scan* scan, const uint8_t* data, size_t nblocks) {
+    for (; nblocks > 0; --nblocks, data += FS_ENC_BLOCK) {
+        uint64_t lf = 0, cr = 0, nul = 0;
+        uint8_t high = 0;
+        unsigned int i;
+        
+        for (i = 0; i < FS_ENC_BLOCK; ++i) {
+            uint8_t b = data[i];
+            lf |= (uint64_t)(b == '\n') << i;
+            cr |= (uint64_t)(b == '\r') << i;
+            nul |= (uint64_t)(b == 0) << i;
+            high |= b;
+        }
+        
+        if (high & 0x80) {
+            scan->non_ascii = true;
+            for (i = 0; i < FS_ENC_BLOCK; ++i) {
+                scan->c1 += (data[i] & 0xE0) == 0x80;
+            }
+            if (scan->check_utf8) {
+                fs_enc_scalar_utf8(scan, data, FS_ENC_BLOCK);
+            }
+        } else if (scan->utf8_need) {
+            // A truncated sequence followed by ASCII.
+            scan->utf8_error = true;
+            scan->check_utf8 = false;
+            scan->utf8_need = 0;
+        }
+        
+        fs_enc_account_block(scan, lf, cr, nul);
+    }
+}
+
+const struct fs_enc_kernel fs_enc_kernel_scalar = {
+    .name = "scalar",
+    .is_supported = fs_enc_scalar_is_supported,
+    .scan_blocks = fs_enc_scalar_scan_blocks
+};
+
+// MARK: - Kernel selection
+
+// Preference order, fastest first.
+static const struct fs_enc_kernel* const fs_enc_kernel_preference[] = {
+#if FS_ENC_HAVE_X86
+    &fs_enc_kernel_avx2,
+    &fs_enc_kernel_ssse3,
+#endif
+#if FS_ENC_HAVE_NEON
+    &fs_enc_kernel_neon,
+#endif
+    &fs_enc_kernel_scalar
+};
+
+static _Atomic(const struct fs_enc_kernel*) fs_enc_kernel_current = NULL;
+static pthread_once_t fs_enc_kernel_once = PTHREAD_ONCE_INIT;
+
+static void fs_enc_kernel_resolve(void) {
+    const struct fs_enc_kernel* best = &fs_enc_kernel_scalar;
+    size_t i;
+    
+    for (i = 0; i < sizeof(fs_enc_kernel_preference) / sizeof(fs_enc_kernel_preference[0]); ++i) {
+        if (fs_enc_kernel_preference[i]->is_supported()) {
+            best = fs_enc_kernel_preference[i];
+            break;
+        }
+    }
+    atomic_store_explicit(&fs_enc_kernel_current, best, memory_order_release);
+}
+
+const struct fs_enc_kernel* fs_enc_active_kernel(void) {
+    const struct fs_enc_kernel* kernel = atomic_load_explicit(&fs_enc_kernel_current, memory_order_acquire);
+    if (kernel) {
+        return kernel;
+    }
+    
+    pthread_once(&fs_enc_kernel_once, fs_enc_kernel_resolve);
+    return atomic_load_explicit(&fs_enc_kernel_current, memory_order_acquire);
+}
+
+// MARK: - Scanning
+
+fs_enc_t fs_enc_sniff_bom(const uint8_t* data, size_t len, size_t* bom_len) {
+    // UTF-32LE has to be tested before UTF-16LE, whose BOM is its prefix.
+    if (len >= FS_BOM_UTF32_LEN && memcmp(data, FS_BOM_UTF32LE, FS_BOM_UTF32_LEN) == 0) {
+        *bom_len = FS_BOM_UTF32_LEN;
+        return FS_ENC_UTF32LE;
+    }
+    if (len >= FS_BOM_UTF32_LEN && memcmp(data, FS_BOM_UTF32BE, FS_BOM_UTF32_LEN) == 0) {
+        *bom_len = FS_BOM_UTF32_LEN;
+        return FS_ENC_UTF32BE;
+    }
+    if (len >= FS_BOM_UTF8_LEN && memcmp(data, FS_BOM_UTF8, FS_BOM_UTF8_LEN) == 0) {
+        *bom_len = FS_BOM_UTF8_LEN;
+        return FS_ENC_UTF8;
+    }
+    if (len >= FA_BOM_UTF16_LEN && memcmp(data, FS_BOM_UTF16LE, FA_BOM_UTF16_LEN) == 0) {
+        *bom_len = FA_BOM_UTF16_LEN;
+        return FS_ENC_UTF16LE;
+    }
+    if (len >= FA_BOM_UTF16_LEN && memcmp(data, FS_BOM_UTF16BE, FA_BOM_UTF16_LEN) == 0) {
+        *bom_len = FA_BOM_UTF16_LEN;
+        return FS_ENC_UTF16BE;
+    }
+    *bom_len = 0;
+    return FS_ENC_UNKNOWN;
+}
+
+void fs_enc_scan_init(struct fs_enc_scan* scan, fs_enc_t bom) {
+    memset(scan, 0, sizeof(*scan));
+    scan->valid_mask = ~0ULL;
+    // UTF-8 validation is pointless once a BOM announced UTF-16/32.
+    scan->check_utf8 = (bom == FS_ENC_UNKNOWN || bom == FS_ENC_UTF8);
+}
+
+void fs_enc_scan_run(struct fs_enc_scan* scan, const struct fs_enc_kernel* kernel,
+                     const uint8_t* data, size_t len) {
+    size_t nblocks = len / FS_ENC_BLOCK;
+    size_t rest = len % FS_ENC_BLOCK;
+    
+    if (nblocks) {
+        kernel->scan_blocks(scan, data, nblocks);
+    }
+    if (rest) {
+        // Zero padding is ASCII, so it also terminates a truncated UTF-8 sequence.
+        uint8_t block[FS_ENC_BLOCK] = { 0 };
+        memcpy(block, data + nblocks * FS_ENC_BLOCK, rest);
+        scan->valid_mask = (1ULL << rest) - 1;
+        kernel->scan_blocks(scan, block, 1);
+        scan->valid_mask = ~0ULL;
+    }
+}
+
+// MARK: - Classification
+
+// UTF-16/32 without BOM: text in Latin scripts has a NUL in the high-order
+// byte(s) of nearly every code unit, binary data has NULs without such a pattern.
+bool fs_enc_guess_wide(const struct fs_enc_scan* scan, fs_enc_t* encoding) {
+    const uint64_t* lane = scan->nul_lane;
+    // Whole code units; a sample may end inside one.
+    uint64_t units4 = scan->bytes / 4;
+    uint64_t units2 = scan->bytes / 2;
+    uint64_t odd = lane[1] + lane[3];
+    uint64_t even = lane[0] + lane[2];
+    
+    if (units4) {
+        // Code points are at most 0x10FFFF, so the top byte is always NUL.
+        if (lane[3] >= units4 && lane[2] * 10 >= units4 * 9 && lane[0] * 2 < units4) {
+            *encoding = FS_ENC_UTF32LE;
+            return true;
+        }
+        if (lane[0] >= units4 && lane[1] * 10 >= units4 * 9 && lane[3] * 2 < units4) {
+            *encoding = FS_ENC_UTF32BE;
+            return true;
+        }
+    }
+    if (units2) {
+        if (odd * 4 >= units2 && even * 10 < odd) {
+            *encoding = FS_ENC_UTF16LE;
+            return true;
+        }
+        if (even * 4 >= units2 && odd * 10 < even) {
+            *encoding = FS_ENC_UTF16BE;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char* fs_enc_pick_eol(const struct fs_enc_eol_stats* stats, bool* mixed) {
+    uint64_t crlf = stats->crlf;
+    uint64_t lf = stats->lf - crlf;
+    uint64_t cr = stats->cr - crlf;
+    
+    *mixed = ((lf != 0) + (crlf != 0) + (cr != 0)) > 1;
+    
+    if (!lf && !crlf && !cr) {
+        return FS_EOL_DEFAULT;
+    }
+    if (lf >= crlf && lf >= cr) {
+        return FS_EOL_LF;
+    }
+    return crlf >= cr ? FS_EOL_CRLF : FS_EOL_CR;
+}
+
+static int fs_enc_units_for(fs_enc_t encoding) {
+    switch (encoding) {
+        case FS_ENC_UTF16LE: return FS_ENC_UNITS_UTF16LE;
+        case FS_ENC_UTF16BE: return FS_ENC_UNITS_UTF16BE;
+        case FS_ENC_UTF32LE: return FS_ENC_UNITS_UTF32LE;
+        case FS_ENC_UTF32BE: return FS_ENC_UNITS_UTF32BE;
+        default:             return FS_ENC_UNITS_BYTE;
+    }
+}
+
+static uint32_t fs_enc_wide_flag(fs_enc_t encoding) {
+    switch (encoding) {
+        case FS_ENC_UTF16LE: return FS_ENC_F_VALID_UTF16LE;
+        case FS_ENC_UTF16BE: return FS_ENC_F_VALID_UTF16BE;
+        case FS_ENC_UTF32LE: return FS_ENC_F_VALID_UTF32LE;
+        case FS_ENC_UTF32BE: return FS_ENC_F_VALID_UTF32BE;
+        default:             return 0;
+    }
+}
+
+void fs_enc_scan_finish(const struct fs_enc_scan* scan, fs_enc_t bom, fs_enc_info_t* info) {
+    bool utf8_valid = !scan->utf8_error && !scan->utf8_incomplete && scan->utf8_need == 0;
+    fs_enc_t encoding = bom;
+    uint32_t flags = 0;
+    bool mixed;
+    
+    if (bom != FS_ENC_UNKNOWN) {
+        flags |= FS_ENC_F_BOM;
+    }
+    
+    if (bom == FS_ENC_UNKNOWN || bom == FS_ENC_UTF8) {
+        if (utf8_valid) {
+            flags |= FS_ENC_F_VALID_UTF8;
+        }
+        if (!scan->non_ascii) {
+            flags |= FS_ENC_F_VALID_ASCII;
+        }
+    }
+    
+    if (bom == FS_ENC_UNKNOWN) {
+        if (scan->nul) {
+            flags &= ~(uint32_t)(FS_ENC_F_VALID_UTF8 | FS_ENC_F_VALID_ASCII);
+            if (!fs_enc_guess_wide(scan, &encoding)) {
+                encoding = FS_ENC_UNKNOWN;
+                flags |= FS_ENC_F_BINARY;
+            }
+        } else if (!scan->non_ascii) {
+            encoding = FS_ENC_ASCII;
+        } else if (utf8_valid) {
+            encoding = FS_ENC_UTF8;
+        } else {
+            // C1 controls are rare in ISO-8859-1 text but hold the curly
+            // quotes and dashes of Windows-1252.
+            encoding = scan->c1 ? FS_ENC_WIN_1252 : FS_ENC_ISO_8859_1;
+        }
+    } else if (bom == FS_ENC_UTF8 && scan->nul) {
+        flags |= FS_ENC_F_BINARY;
+    }
+    
+    flags |= fs_enc_wide_flag(encoding);
+    
+    info->encoding = encoding;
+    info->eol = fs_enc_pick_eol(&scan->eol[fs_enc_units_for(encoding)], &mixed);
+    if (mixed) {
+        flags |= FS_ENC_F_MIXED_EOL;
+    }
+    info->flags = flags;
+    info->has_bom = bom != FS_ENC_UNKNOWN;
+}
+
+// MARK: - Public API
+
+fs_error_t fs_enc_detect(const void* data, size_t len, fs_enc_info_t* info) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    struct fs_enc_scan scan;
+    size_t bom_len;
+    fs_enc_t bom;
+    
+    if (!info || (!data && len)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    bom = fs_enc_sniff_bom(bytes, len, &bom_len);
+    fs_enc_scan_init(&scan, bom);
+    
+    // The UTF-8 BOM is skipped so it does not count as non-ASCII. UTF-16/32
+    // BOMs stay in the scan: they are one code unit and keep the stream
+    // offsets unit aligned.
+    if (bom == FS_ENC_UTF8) {
+        bytes += bom_len;
+        len -= bom_len;
+    }
+    
+    fs_enc_scan_run(&scan, fs_enc_active_kernel(), bytes, len);
+    fs_enc_scan_finish(&scan, bom, info);
+    return FS_ERROR_NONE;
+}
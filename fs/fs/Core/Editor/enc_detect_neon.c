@@ -0,0 +1,152 @@
+//
+//  enc_detect_neon.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "enc_internal.h"
+
+#if FS_ENC_HAVE_NEON
+
+#include <arm_neon.h>
+
+/*
+ NEON scan kernel for arm64.
+
+ Same algorithm as the x86 kernels with TBL for the nibble lookups. NEON has
+ no movemask, so the 64 compare results of a block are weighted by their bit
+ position and folded into a uint64_t with three rounds of pairwise adds.
+ */
+
+static int fs_enc_neon_is_supported(void) {
+    // Advanced SIMD is mandatory on AArch64.
+    return 1;
+}
+
+static inline uint64_t fs_enc_neon_mask(const uint8x16_t v[4], uint8x16_t needle) {
+    static const uint8_t weights[16] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+    };
+    const uint8x16_t bits = vld1q_u8(weights);
+    uint8x16_t m0 = vandq_u8(vceqq_u8(v[0], needle), bits);
+    uint8x16_t m1 = vandq_u8(vceqq_u8(v[1], needle), bits);
+    uint8x16_t m2 = vandq_u8(vceqq_u8(v[2], needle), bits);
+    uint8x16_t m3 = vandq_u8(vceqq_u8(v[3], needle), bits);
+    uint8x16_t sum = vpaddq_u8(vpaddq_u8(m0, m1), vpaddq_u8(m2, m3));
+    
+    sum = vpaddq_u8(sum, sum);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+
+static inline uint8x16_t fs_enc_neon_utf8_errors(uint8x16_t input, uint8x16_t prev, const uint8x16_t tables[3]) {
+    uint8x16_t prev1 = vextq_u8(prev, input, 15);
+    uint8x16_t prev2 = vextq_u8(prev, input, 14);
+    uint8x16_t prev3 = vextq_u8(prev, input, 13);
+    
+    uint8x16_t byte1_high = vqtbl1q_u8(tables[0], vshrq_n_u8(prev1, 4));
+    uint8x16_t byte1_low = vqtbl1q_u8(tables[1], vandq_u8(prev1, vdupq_n_u8(0x0F)));
+    uint8x16_t byte2_high = vqtbl1q_u8(tables[2], vshrq_n_u8(input, 4));
+    uint8x16_t special = vandq_u8(vandq_u8(byte1_high, byte1_low), byte2_high);
+    
+    // 0x80 where the byte must be the second or third continuation.
+    uint8x16_t third = vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80));
+    uint8x16_t fourth = vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80));
+    uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+    
+    return veorq_u8(must23, special);
+}
+
+static void fs_enc_neon_scan_blocks(struct fs_enc_scan* scan, const uint8_t* data, size_t nblocks) {
+    const uint8x16_t tables[3] = {
+        vld1q_u8(fs_utf8_byte1_high),
+        vld1q_u8(fs_utf8_byte1_low),
+        vld1q_u8(fs_utf8_byte2_high)
+    };
+    const uint8x16_t max = vld1q_u8(fs_utf8_incomplete_max + 16);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const bool check = scan->check_utf8;
+    uint8x16_t prev = vld1q_u8(scan->utf8_prev);
+    uint8x16_t incomplete = vdupq_n_u8(scan->utf8_incomplete ? 0xFF : 0);
+    uint8x16_t err = zero;
+    
+    for (; nblocks > 0; --nblocks, data += FS_ENC_BLOCK) {
+        uint8x16_t v[4];
+        v[0] = vld1q_u8(data);
+        v[1] = vld1q_u8(data + 16);
+        v[2] = vld1q_u8(data + 32);
+        v[3] = vld1q_u8(data + 48);
+        
+        uint64_t lf = fs_enc_neon_mask(v, vdupq_n_u8('\n'));
+        uint64_t cr = fs_enc_neon_mask(v, vdupq_n_u8('\r'));
+        uint64_t nul = fs_enc_neon_mask(v, zero);
+        uint8x16_t any = vorrq_u8(vorrq_u8(v[0], v[1]), vorrq_u8(v[2], v[3]));
+        
+        if (vmaxvq_u8(any) >= 0x80) {
+            const uint8x16_t top3 = vdupq_n_u8(0xE0);
+            uint8x16_t c1[4];
+            c1[0] = vandq_u8(v[0], top3);
+            c1[1] = vandq_u8(v[1], top3);
+            c1[2] = vandq_u8(v[2], top3);
+            c1[3] = vandq_u8(v[3], top3);
+            scan->non_ascii = true;
+            scan->c1 += (uint64_t)__builtin_popcountll(fs_enc_neon_mask(c1, vdupq_n_u8(0x80)));
+            
+            if (check) {
+                err = vorrq_u8(err, fs_enc_neon_utf8_errors(v[0], prev, tables));
+                err = vorrq_u8(err, fs_enc_neon_utf8_errors(v[1], v[0], tables));
+                err = vorrq_u8(err, fs_enc_neon_utf8_errors(v[2], v[1], tables));
+                err = vorrq_u8(err, fs_enc_neon_utf8_errors(v[3], v[2], tables));
+                incomplete = vqsubq_u8(v[3], max);
+            }
+        } else {
+            err = vorrq_u8(err, incomplete);
+            incomplete = zero;
+        }
+        prev = v[3];
+        
+        fs_enc_account_block(scan, lf, cr, nul);
+    }
+    
+    vst1q_u8(scan->utf8_prev, prev);
+    if (check) {
+        scan->utf8_incomplete = vmaxvq_u8(incomplete) != 0;
+        if (vmaxvq_u8(err) != 0) {
+            scan->utf8_error = true;
+            scan->check_utf8 = false;
+        }
+    }
+}
+
+const struct fs_enc_kernel fs_enc_kernel_neon = {
+    .name = "neon",
+    .is_supported = fs_enc_neon_is_supported,
+    .scan_blocks = fs_enc_neon_scan_blocks
+};
+
+#endif /* FS_ENC_HAVE_NEON */
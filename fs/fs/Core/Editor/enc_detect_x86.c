@@ -0,0 +1,253 @@
+//
+//  enc_detect_x86.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "enc_internal.h"
+
+#if FS_ENC_HAVE_X86
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+
+/*
+ SSSE3 and AVX2 scan kernels for x86_64.
+
+ Both process a 64-byte block as four (SSSE3) or two (AVX2) vectors: LF, CR
+ and NUL are found with byte compares and collected with movemask, and UTF-8
+ is validated with the PSHUFB nibble lookups of Keiser and Lemire whenever a
+ block has a byte >= 0x80.
+
+ Functions are compiled with a target attribute so the library does not have
+ to be built with -mavx2; they are only ever called after the corresponding
+ is_supported() returned non-zero.
+ */
+
+#define FS_ENC_SSSE3_TARGET __attribute__((target("ssse3")))
+#define FS_ENC_AVX2_TARGET __attribute__((target("avx2")))
+
+// MARK: - SSSE3
+
+static int fs_enc_ssse3_is_supported(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+
+FS_ENC_SSSE3_TARGET
+static inline uint64_t fs_enc_ssse3_mask(const __m128i v[4], __m128i needle) {
+    uint64_t m0 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], needle));
+    uint64_t m1 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], needle));
+    uint64_t m2 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], needle));
+    uint64_t m3 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], needle));
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+
+FS_ENC_SSSE3_TARGET
+static inline __m128i fs_enc_ssse3_utf8_errors(__m128i input, __m128i prev, const __m128i tables[3]) {
+    const __m128i low4 = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+    
+    __m128i byte1_high = _mm_shuffle_epi8(tables[0], _mm_and_si128(_mm_srli_epi16(prev1, 4), low4));
+    __m128i byte1_low = _mm_shuffle_epi8(tables[1], _mm_and_si128(prev1, low4));
+    __m128i byte2_high = _mm_shuffle_epi8(tables[2], _mm_and_si128(_mm_srli_epi16(input, 4), low4));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte1_high, byte1_low), byte2_high);
+    
+    // 0x80 where the byte must be the second or third continuation.
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+    
+    return _mm_xor_si128(must23, special);
+}
+
+FS_ENC_SSSE3_TARGET
+static void fs_enc_ssse3_scan_blocks(struct fs_enc_scan* scan, const uint8_t* data, size_t nblocks) {
+    const __m128i tables[3] = {
+        _mm_loadu_si128((const __m128i*)fs_utf8_byte1_high),
+        _mm_loadu_si128((const __m128i*)fs_utf8_byte1_low),
+        _mm_loadu_si128((const __m128i*)fs_utf8_byte2_high)
+    };
+    const __m128i max = _mm_loadu_si128((const __m128i*)(fs_utf8_incomplete_max + 16));
+    const __m128i zero = _mm_setzero_si128();
+    const bool check = scan->check_utf8;
+    __m128i prev = _mm_loadu_si128((const __m128i*)scan->utf8_prev);
+    __m128i incomplete = _mm_set1_epi8((char)(scan->utf8_incomplete ? 0xFF : 0));
+    __m128i err = zero;
+    
+    for (; nblocks > 0; --nblocks, data += FS_ENC_BLOCK) {
+        __m128i v[4];
+        v[0] = _mm_loadu_si128((const __m128i*)data);
+        v[1] = _mm_loadu_si128((const __m128i*)(data + 16));
+        v[2] = _mm_loadu_si128((const __m128i*)(data + 32));
+        v[3] = _mm_loadu_si128((const __m128i*)(data + 48));
+        
+        uint64_t lf = fs_enc_ssse3_mask(v, _mm_set1_epi8('\n'));
+        uint64_t cr = fs_enc_ssse3_mask(v, _mm_set1_epi8('\r'));
+        uint64_t nul = fs_enc_ssse3_mask(v, zero);
+        __m128i any = _mm_or_si128(_mm_or_si128(v[0], v[1]), _mm_or_si128(v[2], v[3]));
+        
+        if (_mm_movemask_epi8(any)) {
+            const __m128i top3 = _mm_set1_epi8((char)0xE0);
+            __m128i c1[4];
+            c1[0] = _mm_and_si128(v[0], top3);
+            c1[1] = _mm_and_si128(v[1], top3);
+            c1[2] = _mm_and_si128(v[2], top3);
+            c1[3] = _mm_and_si128(v[3], top3);
+            scan->non_ascii = true;
+            scan->c1 += (uint64_t)__builtin_popcountll(fs_enc_ssse3_mask(c1, _mm_set1_epi8((char)0x80)));
+            
+            if (check) {
+                err = _mm_or_si128(err, fs_enc_ssse3_utf8_errors(v[0], prev, tables));
+                err = _mm_or_si128(err, fs_enc_ssse3_utf8_errors(v[1], v[0], tables));
+                err = _mm_or_si128(err, fs_enc_ssse3_utf8_errors(v[2], v[1], tables));
+                err = _mm_or_si128(err, fs_enc_ssse3_utf8_errors(v[3], v[2], tables));
+                incomplete = _mm_subs_epu8(v[3], max);
+            }
+        } else {
+            err = _mm_or_si128(err, incomplete);
+            incomplete = zero;
+        }
+        prev = v[3];
+        
+        fs_enc_account_block(scan, lf, cr, nul);
+    }
+    
+    _mm_storeu_si128((__m128i*)scan->utf8_prev, prev);
+    if (check) {
+        scan->utf8_incomplete = _mm_movemask_epi8(_mm_cmpeq_epi8(incomplete, zero)) != 0xFFFF;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(err, zero)) != 0xFFFF) {
+            scan->utf8_error = true;
+            scan->check_utf8 = false;
+        }
+    }
+}
+
+const struct fs_enc_kernel fs_enc_kernel_ssse3 = {
+    .name = "ssse3",
+    .is_supported = fs_enc_ssse3_is_supported,
+    .scan_blocks = fs_enc_ssse3_scan_blocks
+};
+
+// MARK: - AVX2
+
+static int fs_enc_avx2_is_supported(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+FS_ENC_AVX2_TARGET
+static inline uint64_t fs_enc_avx2_mask(__m256i lo, __m256i hi, __m256i needle) {
+    uint64_t m0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+    uint64_t m1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+    return m0 | (m1 << 32);
+}
+
+FS_ENC_AVX2_TARGET
+static inline __m256i fs_enc_avx2_utf8_errors(__m256i input, __m256i prev, const __m256i tables[3]) {
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    // Upper half of prev and lower half of input, so the per-lane ALIGNR
+    // sees the bytes that precede each lane.
+    __m256i carry = _mm256_permute2x128_si256(prev, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, carry, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, carry, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, carry, 13);
+    
+    __m256i byte1_high = _mm256_shuffle_epi8(tables[0], _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low4));
+    __m256i byte1_low = _mm256_shuffle_epi8(tables[1], _mm256_and_si256(prev1, low4));
+    __m256i byte2_high = _mm256_shuffle_epi8(tables[2], _mm256_and_si256(_mm256_srli_epi16(input, 4), low4));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte1_high, byte1_low), byte2_high);
+    
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    
+    return _mm256_xor_si256(must23, special);
+}
+
+FS_ENC_AVX2_TARGET
+static void fs_enc_avx2_scan_blocks(struct fs_enc_scan* scan, const uint8_t* data, size_t nblocks) {
+    const __m256i tables[3] = {
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)fs_utf8_byte1_high)),
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)fs_utf8_byte1_low)),
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)fs_utf8_byte2_high))
+    };
+    const __m256i max = _mm256_loadu_si256((const __m256i*)fs_utf8_incomplete_max);
+    const __m256i zero = _mm256_setzero_si256();
+    const bool check = scan->check_utf8;
+    __m256i prev = _mm256_inserti128_si256(zero, _mm_loadu_si128((const __m128i*)scan->utf8_prev), 1);
+    __m256i incomplete = _mm256_set1_epi8((char)(scan->utf8_incomplete ? 0xFF : 0));
+    __m256i err = zero;
+    
+    for (; nblocks > 0; --nblocks, data += FS_ENC_BLOCK) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)data);
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(data + 32));
+        
+        uint64_t lf = fs_enc_avx2_mask(lo, hi, _mm256_set1_epi8('\n'));
+        uint64_t cr = fs_enc_avx2_mask(lo, hi, _mm256_set1_epi8('\r'));
+        uint64_t nul = fs_enc_avx2_mask(lo, hi, zero);
+        
+        if (_mm256_movemask_epi8(_mm256_or_si256(lo, hi))) {
+            const __m256i top3 = _mm256_set1_epi8((char)0xE0);
+            uint64_t c1 = fs_enc_avx2_mask(_mm256_and_si256(lo, top3), _mm256_and_si256(hi, top3),
+                                           _mm256_set1_epi8((char)0x80));
+            scan->non_ascii = true;
+            scan->c1 += (uint64_t)__builtin_popcountll(c1);
+            
+            if (check) {
+                err = _mm256_or_si256(err, fs_enc_avx2_utf8_errors(lo, prev, tables));
+                err = _mm256_or_si256(err, fs_enc_avx2_utf8_errors(hi, lo, tables));
+                incomplete = _mm256_subs_epu8(hi, max);
+            }
+        } else {
+            err = _mm256_or_si256(err, incomplete);
+            incomplete = zero;
+        }
+        prev = hi;
+        
+        fs_enc_account_block(scan, lf, cr, nul);
+    }
+    
+    _mm_storeu_si128((__m128i*)scan->utf8_prev, _mm256_extracti128_si256(prev, 1));
+    if (check) {
+        scan->utf8_incomplete = !_mm256_testz_si256(incomplete, incomplete);
+        if (!_mm256_testz_si256(err, err)) {
+            scan->utf8_error = true;
+            scan->check_utf8 = false;
+        }
+    }
+}
+
+const struct fs_enc_kernel fs_enc_kernel_avx2 = {
+    .name = "avx2",
+    .is_supported = fs_enc_avx2_is_supported,
+    .scan_blocks = fs_enc_avx2_scan_blocks
+};
+
+#endif /* FS_ENC_HAVE_X86 */
@@ -0,0 +1,265 @@
+//
+//  enc_detector.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "enc_internal.h"
+
+/*
+ Incremental encoding detection.
+
+ The detector feeds the same kernels as fs_enc_detect(). Input is staged
+ until a full 64-byte block is available, so blocks keep starting at stream
+ offsets that are multiples of 64 and the kernel state (UTF-8 lookbehind, CR
+ carries) flows across chunk boundaries unchanged. The first four bytes are
+ held back until the BOM can be sniffed.
+ */
+
+// NUL bytes without a UTF-16/32 pattern in this many bytes settle on binary.
+#define FS_ENC_WIDE_PROBE 1024
+
+struct fs_enc_detector_state {
+    struct fs_enc_scan scan;
+    const struct fs_enc_kernel* kernel;
+    uint64_t remaining;         // bytes still accepted by the sample limit
+    uint32_t options;
+    fs_enc_t bom;
+    bool bom_known;
+    bool truncated;             // the sample limit cut the input
+    bool done;
+    uint8_t tail_len;
+    uint8_t tail[3];            // last bytes fed, to find a sequence cut by the limit
+    size_t stage_len;
+    uint8_t stage[FS_ENC_BLOCK];
+};
+
+_Static_assert(sizeof(struct fs_enc_detector_state) <= sizeof(fs_enc_detector_t),
+               "fs_enc_detector_t storage is too small");
+_Static_assert(_Alignof(struct fs_enc_detector_state) <= _Alignof(fs_enc_detector_t),
+               "fs_enc_detector_t storage is under-aligned");
+
+static inline struct fs_enc_detector_state* fs_enc_detector_state(fs_enc_detector_t* detector) {
+    return (struct fs_enc_detector_state*)(void*)detector->_storage;
+}
+
+static void fs_enc_detector_start(struct fs_enc_detector_state* d) {
+    size_t bom_len;
+    
+    d->bom = fs_enc_sniff_bom(d->stage, d->stage_len, &bom_len);
+    d->bom_known = true;
+    fs_enc_scan_init(&d->scan, d->bom);
+    
+    // Same as fs_enc_detect(): only the UTF-8 BOM is left out of the scan.
+    if (d->bom == FS_ENC_UTF8) {
+        memmove(d->stage, d->stage + bom_len, d->stage_len - bom_len);
+        d->stage_len -= bom_len;
+    }
+}
+
+static void fs_enc_detector_consume(struct fs_enc_detector_state* d, const uint8_t* bytes, size_t len) {
+    while (len) {
+        size_t take;
+        
+        if (!d->bom_known) {
+            take = FS_BOM_UTF32_LEN - d->stage_len;
+            take = take < len ? take : len;
+            memcpy(d->stage + d->stage_len, bytes, take);
+            d->stage_len += take;
+            bytes += take;
+            len -= take;
+            if (d->stage_len == FS_BOM_UTF32_LEN) {
+                fs_enc_detector_start(d);
+            }
+            continue;
+        }
+        
+        if (d->stage_len || len < FS_ENC_BLOCK) {
+            take = FS_ENC_BLOCK - d->stage_len;
+            take = take < len ? take : len;
+            memcpy(d->stage + d->stage_len, bytes, take);
+            d->stage_len += take;
+            bytes += take;
+            len -= take;
+            if (d->stage_len == FS_ENC_BLOCK) {
+                d->kernel->scan_blocks(&d->scan, d->stage, 1);
+                d->stage_len = 0;
+            }
+            continue;
+        }
+        
+        take = len / FS_ENC_BLOCK;
+        d->kernel->scan_blocks(&d->scan, bytes, take);
+        bytes += take * FS_ENC_BLOCK;
+        len -= take * FS_ENC_BLOCK;
+    }
+}
+
+static void fs_enc_detector_remember(struct fs_enc_detector_state* d, const uint8_t* bytes, size_t len) {
+    uint8_t joined[6];
+    size_t n = d->tail_len;
+    size_t take = len < 3 ? len : 3;
+    
+    memcpy(joined, d->tail, n);
+    memcpy(joined + n, bytes + len - take, take);
+    n += take;
+    
+    d->tail_len = (uint8_t)(n < 3 ? n : 3);
+    memcpy(d->tail, joined + n - d->tail_len, d->tail_len);
+}
+
+// Length of the UTF-8 sequence that is still open at the end of tail[0..n).
+static size_t fs_enc_utf8_open_len(const uint8_t* tail, size_t n) {
+    size_t j;
+    
+    for (j = 1; j <= n && j <= 3; ++j) {
+        uint8_t b = tail[n - j];
+        size_t want;
+        
+        if ((b & 0xC0) == 0x80) {
+            continue;
+        }
+        if (b < 0xC2 || b > 0xF4) {
+            return 0;
+        }
+        want = b >= 0xF0 ? 4 : b >= 0xE0 ? 3 : 2;
+        return want > j ? j : 0;
+    }
+    return 0;
+}
+
+// Drops the bytes of a UTF-8 sequence cut by the sample limit from the last
+// chunk and the stage. Bytes already scanned leave the kernel with an open
+// sequence, which fs_enc_detector_finish() ignores for truncated input.
+static size_t fs_enc_detector_trim(struct fs_enc_detector_state* d, const uint8_t* bytes, size_t len) {
+    size_t open, drop;
+    
+    if (d->bom_known && !d->scan.check_utf8) {
+        return len;
+    }
+    
+    fs_enc_detector_remember(d, bytes, len);
+    open = fs_enc_utf8_open_len(d->tail, d->tail_len);
+    drop = open < len ? open : len;
+    open -= drop;
+    d->stage_len -= open < d->stage_len ? open : d->stage_len;
+    return len - drop;
+}
+
+static void fs_enc_detector_check(struct fs_enc_detector_state* d) {
+    fs_enc_t wide;
+    
+    if (!d->bom_known || !d->scan.nul) {
+        return;
+    }
+    if (d->bom == FS_ENC_UTF8) {
+        d->done = true;
+    } else if (d->bom == FS_ENC_UNKNOWN && d->scan.bytes >= FS_ENC_WIDE_PROBE &&
+               !fs_enc_guess_wide(&d->scan, &wide)) {
+        d->done = true;
+    }
+}
+
+fs_error_t fs_enc_detector_init(fs_enc_detector_t* detector, uint32_t options, uint64_t sample_limit) {
+    struct fs_enc_detector_state* d;
+    
+    if (!detector) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    d = fs_enc_detector_state(detector);
+    memset(d, 0, sizeof(*d));
+    d->kernel = fs_enc_active_kernel();
+    d->remaining = sample_limit ? sample_limit : UINT64_MAX;
+    d->options = options;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_enc_detector_feed(fs_enc_detector_t* detector, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    struct fs_enc_detector_state* d;
+    bool cut = false;
+    
+    if (!detector || (!data && len)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    d = fs_enc_detector_state(detector);
+    if (d->done || !len) {
+        return FS_ERROR_NONE;
+    }
+    
+    if ((uint64_t)len >= d->remaining) {
+        len = (size_t)d->remaining;
+        cut = true;
+    }
+    d->remaining -= len;
+    
+    if (cut) {
+        len = fs_enc_detector_trim(d, bytes, len);
+    } else {
+        fs_enc_detector_remember(d, bytes, len);
+    }
+    fs_enc_detector_consume(d, bytes, len);
+    
+    if (cut) {
+        d->truncated = true;
+        d->done = true;
+    } else if (d->options & FS_ENC_DETECT_EARLY_EXIT) {
+        fs_enc_detector_check(d);
+    }
+    return FS_ERROR_NONE;
+}
+
+bool fs_enc_detector_done(const fs_enc_detector_t* detector) {
+    return detector && ((const struct fs_enc_detector_state*)(const void*)detector->_storage)->done;
+}
+
+fs_error_t fs_enc_detector_finish(fs_enc_detector_t* detector, fs_enc_info_t* info) {
+    struct fs_enc_detector_state* d;
+    
+    if (!detector || !info) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    d = fs_enc_detector_state(detector);
+    if (!d->bom_known) {
+        fs_enc_detector_start(d);
+    }
+    if (d->stage_len) {
+        fs_enc_scan_run(&d->scan, d->kernel, d->stage, d->stage_len);
+        d->stage_len = 0;
+    }
+    if (d->truncated) {
+        d->scan.utf8_incomplete = false;
+        d->scan.utf8_need = 0;
+    }
+    
+    fs_enc_scan_finish(&d->scan, d->bom, info);
+    return FS_ERROR_NONE;
+}
@@ -0,0 +1,248 @@
+//
+//  enc_internal.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//  Private interface shared by the encoding translation units. Not a public header.
+
+#ifndef FS_ENC_INTERNAL_H
+#define FS_ENC_INTERNAL_H
+
+#include <fs/encoding.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FS_ENC_HAVE_X86 1
+#else
+#define FS_ENC_HAVE_X86 0
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define FS_ENC_HAVE_NEON 1
+#else
+#define FS_ENC_HAVE_NEON 0
+#endif
+
+// Kernels consume the input in blocks of 64 bytes so every per-byte class
+// (LF, CR, NUL) fits in one uint64_t bitmask.
+#define FS_ENC_BLOCK 64
+
+// Line ending statistics are kept per code unit layout, because the encoding
+// of a buffer without BOM is only known once it has been scanned.
+enum {
+    FS_ENC_UNITS_BYTE = 0,
+    FS_ENC_UNITS_UTF16LE,
+    FS_ENC_UNITS_UTF16BE,
+    FS_ENC_UNITS_UTF32LE,
+    FS_ENC_UNITS_UTF32BE,
+    FS_ENC_UNITS_COUNT
+};
+
+struct fs_enc_eol_stats {
+    uint64_t lf;
+    uint64_t cr;
+    uint64_t crlf;
+    uint64_t cr_carry;          // CR of the last unit of the previous block, shifted to bit 0..3
+};
+
+struct fs_enc_scan {
+    uint64_t bytes;             // bytes scanned
+    uint64_t valid_mask;        // lanes of the current block holding input
+    uint64_t nul;
+    uint64_t nul_lane[4];       // NUL bytes by stream offset mod 4
+    uint64_t c1;                // bytes 0x80-0x9F
+    struct fs_enc_eol_stats eol[FS_ENC_UNITS_COUNT];
+    
+    bool non_ascii;
+    bool check_utf8;
+    bool utf8_error;
+    
+    // SIMD kernels: last 16 input bytes and whether they end mid-sequence.
+    bool utf8_incomplete;
+    uint8_t utf8_prev[16];
+    
+    // Scalar kernel: continuation bytes still expected and the range of the next one.
+    uint8_t utf8_need;
+    uint8_t utf8_lo;
+    uint8_t utf8_hi;
+};
+
+struct fs_enc_kernel {
+    const char* name;
+    int (*is_supported)(void);
+    void (*scan_blocks)(struct fs_enc_scan* scan, const uint8_t* data, size_t nblocks);
+};
+
+extern const struct fs_enc_kernel fs_enc_kernel_scalar;
+#if FS_ENC_HAVE_X86
+extern const struct fs_enc_kernel fs_enc_kernel_avx2;
+extern const struct fs_enc_kernel fs_enc_kernel_ssse3;
+#endif
+#if FS_ENC_HAVE_NEON
+extern const struct fs_enc_kernel fs_enc_kernel_neon;
+#endif
+
+const struct fs_enc_kernel* fs_enc_active_kernel(void);
+
+fs_enc_t fs_enc_sniff_bom(const uint8_t* data, size_t len, size_t* bom_len);
+void fs_enc_scan_init(struct fs_enc_scan* scan, fs_enc_t bom);
+void fs_enc_scan_run(struct fs_enc_scan* scan, const struct fs_enc_kernel* kernel,
+                     const uint8_t* data, size_t len);
+bool fs_enc_guess_wide(const struct fs_enc_scan* scan, fs_enc_t* encoding);
+void fs_enc_scan_finish(const struct fs_enc_scan* scan, fs_enc_t bom, fs_enc_info_t* info);
+
+/*
+ Lookup tables of the UTF-8 validation by Keiser and Lemire ("Validating UTF-8
+ In Less Than One Instruction Per Byte", 2021). Each table maps a nibble to
+ the set of errors it can take part in; a byte pair is invalid when all three
+ lookups share a bit. The two-continuation bit (0x80) is then cross-checked
+ against the lead bytes two and three positions back.
+ */
+#define FS_UTF8_TOO_SHORT   (1 << 0)
+#define FS_UTF8_TOO_LONG    (1 << 1)
+#define FS_UTF8_OVERLONG_3  (1 << 2)
+#define FS_UTF8_TOO_LARGE   (1 << 3)
+#define FS_UTF8_SURROGATE   (1 << 4)
+#define FS_UTF8_OVERLONG_2  (1 << 5)
+#define FS_UTF8_TOO_LARGE_1000 (1 << 6)
+#define FS_UTF8_OVERLONG_4  (1 << 6)
+#define FS_UTF8_TWO_CONTS   (1 << 7)
+#define FS_UTF8_CARRY       (FS_UTF8_TOO_SHORT | FS_UTF8_TOO_LONG | FS_UTF8_TWO_CONTS)
+
+static const uint8_t fs_utf8_byte1_high[16] = {
+    // 0_______ ASCII
+    FS_UTF8_TOO_LONG, FS_UTF8_TOO_LONG, FS_UTF8_TOO_LONG, FS_UTF8_TOO_LONG,
+    FS_UTF8_TOO_LONG, FS_UTF8_TOO_LONG, FS_UTF8_TOO_LONG, FS_UTF8_TOO_LONG,
+    // 10______ continuation
+    FS_UTF8_TWO_CONTS, FS_UTF8_TWO_CONTS, FS_UTF8_TWO_CONTS, FS_UTF8_TWO_CONTS,
+    // 1100____, 1101____ two byte lead
+    FS_UTF8_TOO_SHORT | FS_UTF8_OVERLONG_2,
+    FS_UTF8_TOO_SHORT,
+    // 1110____ three byte lead
+    FS_UTF8_TOO_SHORT | FS_UTF8_OVERLONG_3 | FS_UTF8_SURROGATE,
+    // 1111____ four byte lead
+    FS_UTF8_TOO_SHORT | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000 | FS_UTF8_OVERLONG_4
+};
+
+static const uint8_t fs_utf8_byte1_low[16] = {
+    FS_UTF8_CARRY | FS_UTF8_OVERLONG_3 | FS_UTF8_OVERLONG_2 | FS_UTF8_OVERLONG_4,
+    FS_UTF8_CARRY | FS_UTF8_OVERLONG_2,
+    FS_UTF8_CARRY,
+    FS_UTF8_CARRY,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000 | FS_UTF8_SURROGATE,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000,
+    FS_UTF8_CARRY | FS_UTF8_TOO_LARGE | FS_UTF8_TOO_LARGE_1000
+};
+
+static const uint8_t fs_utf8_byte2_high[16] = {
+    // ________ 0_______
+    FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT,
+    FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT,
+    // ________ 1000____
+    FS_UTF8_TOO_LONG | FS_UTF8_OVERLONG_2 | FS_UTF8_TWO_CONTS | FS_UTF8_OVERLONG_3 |
+        FS_UTF8_TOO_LARGE_1000 | FS_UTF8_OVERLONG_4,
+    // ________ 1001____
+    FS_UTF8_TOO_LONG | FS_UTF8_OVERLONG_2 | FS_UTF8_TWO_CONTS | FS_UTF8_OVERLONG_3 | FS_UTF8_TOO_LARGE,
+    // ________ 101_____
+    FS_UTF8_TOO_LONG | FS_UTF8_OVERLONG_2 | FS_UTF8_TWO_CONTS | FS_UTF8_SURROGATE | FS_UTF8_TOO_LARGE,
+    FS_UTF8_TOO_LONG | FS_UTF8_OVERLONG_2 | FS_UTF8_TWO_CONTS | FS_UTF8_SURROGATE | FS_UTF8_TOO_LARGE,
+    // ________ 11______
+    FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT, FS_UTF8_TOO_SHORT
+};
+
+// A vector whose last bytes exceed these values ends inside a sequence.
+static const uint8_t fs_utf8_incomplete_max[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+};
+
+static inline void fs_enc_count_units(struct fs_enc_eol_stats* stats, uint64_t cr, uint64_t lf,
+                                      unsigned int unit) {
+    stats->lf += (uint64_t)__builtin_popcountll(lf);
+    stats->cr += (uint64_t)__builtin_popcountll(cr);
+    stats->crlf += (uint64_t)__builtin_popcountll((cr & (lf >> unit)) | (stats->cr_carry & lf));
+    stats->cr_carry = cr >> (64 - unit);
+}
+
+/*
+ Folds the LF, CR and NUL bitmasks of one block into the statistics. Bit i
+ stands for byte i of the block; blocks start at stream offsets that are
+ multiples of 64, so bit positions double as offsets mod 4.
+
+ A UTF-16/32 line ending is a CR or LF byte in the low-order position of a
+ unit whose other bytes are NUL, so the wide layouts are only counted in
+ blocks that contain NUL bytes at all.
+ */
+static inline void fs_enc_account_block(struct fs_enc_scan* scan, uint64_t lf, uint64_t cr, uint64_t nul) {
+    const uint64_t even = 0x5555555555555555ULL;
+    const uint64_t lane0 = 0x1111111111111111ULL;
+    
+    lf &= scan->valid_mask;
+    cr &= scan->valid_mask;
+    nul &= scan->valid_mask;
+    scan->bytes += (uint64_t)__builtin_popcountll(scan->valid_mask);
+    
+    fs_enc_count_units(&scan->eol[FS_ENC_UNITS_BYTE], cr, lf, 1);
+    
+    if (!nul) {
+        scan->eol[FS_ENC_UNITS_UTF16LE].cr_carry = 0;
+        scan->eol[FS_ENC_UNITS_UTF16BE].cr_carry = 0;
+        scan->eol[FS_ENC_UNITS_UTF32LE].cr_carry = 0;
+        scan->eol[FS_ENC_UNITS_UTF32BE].cr_carry = 0;
+        return;
+    }
+    
+    scan->nul += (uint64_t)__builtin_popcountll(nul);
+    scan->nul_lane[0] += (uint64_t)__builtin_popcountll(nul & lane0);
+    scan->nul_lane[1] += (uint64_t)__builtin_popcountll(nul & (lane0 << 1));
+    scan->nul_lane[2] += (uint64_t)__builtin_popcountll(nul & (lane0 << 2));
+    scan->nul_lane[3] += (uint64_t)__builtin_popcountll(nul & (lane0 << 3));
+    
+    uint64_t le16 = even & (nul >> 1);
+    uint64_t be16 = (even << 1) & (nul << 1);
+    uint64_t le32 = lane0 & (nul >> 1) & (nul >> 2) & (nul >> 3);
+    uint64_t be32 = (lane0 << 3) & (nul << 1) & (nul << 2) & (nul << 3);
+    
+    fs_enc_count_units(&scan->eol[FS_ENC_UNITS_UTF16LE], cr & le16, lf & le16, 2);
+    fs_enc_count_units(&scan->eol[FS_ENC_UNITS_UTF16BE], cr & be16, lf & be16, 2);
+    fs_enc_count_units(&scan->eol[FS_ENC_UNITS_UTF32LE], cr & le32, lf & le32, 4);
+    fs_enc_count_units(&scan->eol[FS_ENC_UNITS_UTF32BE], cr & be32, lf & be32, 4);
+}
+
+#endif /* FS_ENC_INTERNAL_H */
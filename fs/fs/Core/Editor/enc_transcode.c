@@ -0,0 +1,587 @@
+//
+//  enc_transcode.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "enc_internal.h"
+
+#if defined(__SSE2__)
+#define FS_CONV_SSE2 1
+#include <emmintrin.h>
+#elif FS_ENC_HAVE_NEON
+#define FS_CONV_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+ Transcoding to UTF-8.
+
+ Every source encoding runs the same loop: a vector fast path converts 16
+ ASCII characters at a time (SSE2 and NEON are baseline on their
+ architectures, so there is no runtime dispatch), anything else goes through
+ a scalar decoder one code point at a time. Both write through a
+ fs_conv_out, which only counts once the destination is absent or full; that
+ is how the length-only mode and the "destination too small" result share
+ the conversion code.
+
+ Ill-formed input (invalid UTF-8, unpaired surrogates, code points above
+ U+10FFFF, truncated code units, bytes >= 0x80 in ASCII) becomes U+FFFD.
+ */
+
+#define FS_CONV_REPLACEMENT 0xFFFD
+
+// Windows-1252 0x80-0x9F; the five unassigned bytes map to the C1 control
+// with the same value, as browsers do.
+static const uint16_t fs_conv_win1252[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178
+};
+
+// MacRoman 0x80-0xFF as in Apple's current mapping (0xDB is the euro sign).
+static const uint16_t fs_conv_mac_roman[128] = {
+    0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1,
+    0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+    0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3,
+    0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+    0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF,
+    0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+    0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211,
+    0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+    0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB,
+    0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+    0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA,
+    0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+    0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1,
+    0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+    0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC,
+    0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7
+};
+
+struct fs_conv_out {
+    uint8_t* pos;           // NULL when only measuring or once the destination is full
+    uint8_t* end;
+    size_t total;           // bytes produced or needed so far
+    bool normalize;
+    bool pending_cr;        // last code point was a CR, swallow a following LF
+    bool overflow;
+};
+
+// MARK: - Output
+
+static inline void fs_conv_emit(struct fs_conv_out* out, const uint8_t* bytes, size_t n) {
+    out->total += n;
+    if (!out->pos) {
+        return;
+    }
+    if ((size_t)(out->end - out->pos) < n) {
+        out->pos = NULL;
+        out->overflow = true;
+        return;
+    }
+    while (n--) {
+        *out->pos++ = *bytes++;
+    }
+}
+
+static inline void fs_conv_put(struct fs_conv_out* out, uint32_t cp) {
+    uint8_t buf[4];
+    size_t n;
+    
+    if (out->normalize) {
+        if (cp == '\r' || (cp == '\n' && !out->pending_cr)) {
+            out->pending_cr = cp == '\r';
+            fs_conv_emit(out, (const uint8_t*)FS_EOL_DEFAULT, sizeof(FS_EOL_DEFAULT) - 1);
+            return;
+        }
+        if (cp == '\n') {
+            out->pending_cr = false;
+            return;
+        }
+        out->pending_cr = false;
+    }
+    
+    if (cp < 0x80) {
+        buf[0] = (uint8_t)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        buf[0] = (uint8_t)(0xC0 | (cp >> 6));
+        buf[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = (uint8_t)(0xE0 | (cp >> 12));
+        buf[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        buf[0] = (uint8_t)(0xF0 | (cp >> 18));
+        buf[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (uint8_t)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    fs_conv_emit(out, buf, n);
+}
+
+// How many 16-byte groups the fast path may produce: bounded by the room left
+// in the destination (the scalar path then records an overflow exactly), and
+// none while a CR waits for its LF.
+static inline size_t fs_conv_bulk_groups(const struct fs_conv_out* out, size_t groups) {
+    if (out->normalize && out->pending_cr) {
+        return 0;
+    }
+    if (out->pos && (size_t)(out->end - out->pos) / 16 < groups) {
+        groups = (size_t)(out->end - out->pos) / 16;
+    }
+    return groups;
+}
+
+static inline void fs_conv_bulk_done(struct fs_conv_out* out, size_t groups) {
+    out->total += groups * 16;
+    if (out->pos) {
+        out->pos += groups * 16;
+    }
+}
+
+// MARK: - Fast paths
+
+/*
+ Each group function turns the next 16 characters into 16 output bytes (or
+ only checks them when dst is NULL) if they are all ASCII, and if normalizing
+ also free of line endings that would change. Units are read little-endian; a
+ big-endian ASCII code unit then has its value in the top byte, hence the
+ mask and shift per layout.
+ */
+#if FS_CONV_SSE2
+
+static inline bool fs_conv_eol_clean(__m128i v, bool normalize) {
+    if (!normalize) {
+        return true;
+    }
+    __m128i hit = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+    if (FS_EOL_DEFAULT[0] == '\r') {
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    }
+    return _mm_movemask_epi8(hit) == 0;
+}
+
+static inline bool fs_conv_group_u8(const uint8_t* src, uint8_t* dst, bool normalize) {
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+    
+    if (_mm_movemask_epi8(v) || !fs_conv_eol_clean(v, normalize)) {
+        return false;
+    }
+    if (dst) {
+        _mm_storeu_si128((__m128i*)dst, v);
+    }
+    return true;
+}
+
+static inline bool fs_conv_group_u16(const uint8_t* src, uint8_t* dst, bool be, bool normalize) {
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16((short)(be ? 0x80FF : 0xFF80)));
+    
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xFFFF) {
+        return false;
+    }
+    if (be) {
+        a = _mm_srli_epi16(a, 8);
+        b = _mm_srli_epi16(b, 8);
+    }
+    __m128i v = _mm_packus_epi16(a, b);
+    if (!fs_conv_eol_clean(v, normalize)) {
+        return false;
+    }
+    if (dst) {
+        _mm_storeu_si128((__m128i*)dst, v);
+    }
+    return true;
+}
+
+static inline bool fs_conv_group_u32(const uint8_t* src, uint8_t* dst, bool be, bool normalize) {
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+    __m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+    __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+    __m128i high = _mm_and_si128(any, _mm_set1_epi32(be ? (int)0x80FFFFFF : (int)0xFFFFFF80));
+    
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_setzero_si128())) != 0xFFFF) {
+        return false;
+    }
+    if (be) {
+        a = _mm_srli_epi32(a, 24);
+        b = _mm_srli_epi32(b, 24);
+        c = _mm_srli_epi32(c, 24);
+        d = _mm_srli_epi32(d, 24);
+    }
+    __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    if (!fs_conv_eol_clean(v, normalize)) {
+        return false;
+    }
+    if (dst) {
+        _mm_storeu_si128((__m128i*)dst, v);
+    }
+    return true;
+}
+
+#elif FS_CONV_NEON
+
+static inline bool fs_conv_eol_clean(uint8x16_t v, bool normalize) {
+    if (!normalize) {
+        return true;
+    }
+    uint8x16_t hit = vceqq_u8(v, vdupq_n_u8('\r'));
+    if (FS_EOL_DEFAULT[0] == '\r') {
+        hit = vorrq_u8(hit, vceqq_u8(v, vdupq_n_u8('\n')));
+    }
+    return vmaxvq_u8(hit) == 0;
+}
+
+static inline bool fs_conv_group_u8(const uint8_t* src, uint8_t* dst, bool normalize) {
+    uint8x16_t v = vld1q_u8(src);
+    
+    if (vmaxvq_u8(v) >= 0x80 || !fs_conv_eol_clean(v, normalize)) {
+        return false;
+    }
+    if (dst) {
+        vst1q_u8(dst, v);
+    }
+    return true;
+}
+
+static inline bool fs_conv_group_u16(const uint8_t* src, uint8_t* dst, bool be, bool normalize) {
+    uint16x8_t a = vreinterpretq_u16_u8(vld1q_u8(src));
+    uint16x8_t b = vreinterpretq_u16_u8(vld1q_u8(src + 16));
+    uint16x8_t high = vandq_u16(vorrq_u16(a, b), vdupq_n_u16(be ? 0x80FF : 0xFF80));
+    
+    if (vmaxvq_u16(high) != 0) {
+        return false;
+    }
+    if (be) {
+        a = vshrq_n_u16(a, 8);
+        b = vshrq_n_u16(b, 8);
+    }
+    uint8x16_t v = vcombine_u8(vmovn_u16(a), vmovn_u16(b));
+    if (!fs_conv_eol_clean(v, normalize)) {
+        return false;
+    }
+    if (dst) {
+        vst1q_u8(dst, v);
+    }
+    return true;
+}
+
+static inline bool fs_conv_group_u32(const uint8_t* src, uint8_t* dst, bool be, bool normalize) {
+    uint32x4_t a = vreinterpretq_u32_u8(vld1q_u8(src));
+    uint32x4_t b = vreinterpretq_u32_u8(vld1q_u8(src + 16));
+    uint32x4_t c = vreinterpretq_u32_u8(vld1q_u8(src + 32));
+    uint32x4_t d = vreinterpretq_u32_u8(vld1q_u8(src + 48));
+    uint32x4_t any = vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d));
+    
+    if (vmaxvq_u32(vandq_u32(any, vdupq_n_u32(be ? 0x80FFFFFF : 0xFFFFFF80))) != 0) {
+        return false;
+    }
+    if (be) {
+        a = vshrq_n_u32(a, 24);
+        b = vshrq_n_u32(b, 24);
+        c = vshrq_n_u32(c, 24);
+        d = vshrq_n_u32(d, 24);
+    }
+    uint16x8_t lo = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+    uint16x8_t hi = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+    uint8x16_t v = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+    if (!fs_conv_eol_clean(v, normalize)) {
+        return false;
+    }
+    if (dst) {
+        vst1q_u8(dst, v);
+    }
+    return true;
+}
+
+#else
+
+static inline bool fs_conv_group_u8(const uint8_t* src, uint8_t* dst, bool normalize) {
+    (void)src; (void)dst; (void)normalize;
+    return false;
+}
+
+static inline bool fs_conv_group_u16(const uint8_t* src, uint8_t* dst, bool be, bool normalize) {
+    (void)src; (void)dst; (void)be; (void)normalize;
+    return false;
+}
+
+static inline bool fs_conv_group_u32(const uint8_t* src, uint8_t* dst, bool be, bool normalize) {
+    (void)src; (void)dst; (void)be; (void)normalize;
+    return false;
+}
+
+#endif
+
+static inline size_t fs_conv_run_u8(const uint8_t* src, uint8_t* dst, size_t groups, bool normalize) {
+    size_t g;
+    for (g = 0; g < groups; ++g) {
+        if (!fs_conv_group_u8(src + g * 16, dst ? dst + g * 16 : NULL, normalize)) {
+            break;
+        }
+    }
+    return g;
+}
+
+static inline size_t fs_conv_run_u16(const uint8_t* src, uint8_t* dst, size_t groups, bool be, bool normalize) {
+    size_t g;
+    for (g = 0; g < groups; ++g) {
+        if (!fs_conv_group_u16(src + g * 32, dst ? dst + g * 16 : NULL, be, normalize)) {
+            break;
+        }
+    }
+    return g;
+}
+
+static inline size_t fs_conv_run_u32(const uint8_t* src, uint8_t* dst, size_t groups, bool be, bool normalize) {
+    size_t g;
+    for (g = 0; g < groups; ++g) {
+        if (!fs_conv_group_u32(src + g * 64, dst ? dst + g * 16 : NULL, be, normalize)) {
+            break;
+        }
+    }
+    return g;
+}
+
+// MARK: - Decoders
+
+// Decodes the UTF-8 sequence at src[i], replacing each maximal ill-formed
+// subpart with one U+FFFD, and returns the index after it.
+static size_t fs_conv_utf8_one(struct fs_conv_out* out, const uint8_t* src, size_t i, size_t len) {
+    uint8_t b = src[i];
+    uint8_t lo = 0x80, hi = 0xBF;
+    uint32_t cp;
+    size_t need, k;
+    
+    if (b < 0x80) {
+        fs_conv_put(out, b);
+        return i + 1;
+    } else if (b >= 0xC2 && b <= 0xDF) {
+        need = 1; cp = b & 0x1F;
+    } else if (b >= 0xE0 && b <= 0xEF) {
+        need = 2; cp = b & 0x0F;
+        if (b == 0xE0) lo = 0xA0;
+        if (b == 0xED) hi = 0x9F;
+    } else if (b >= 0xF0 && b <= 0xF4) {
+        need = 3; cp = b & 0x07;
+        if (b == 0xF0) lo = 0x90;
+        if (b == 0xF4) hi = 0x8F;
+    } else {
+        fs_conv_put(out, FS_CONV_REPLACEMENT);
+        return i + 1;
+    }
+    
+    for (k = 1; k <= need; ++k) {
+        if (i + k >= len || src[i + k] < lo || src[i + k] > hi) {
+            fs_conv_put(out, FS_CONV_REPLACEMENT);
+            return i + k;
+        }
+        cp = (cp << 6) | (src[i + k] & 0x3F);
+        lo = 0x80;
+        hi = 0xBF;
+    }
+    fs_conv_put(out, cp);
+    return i + need + 1;
+}
+
+static inline uint32_t fs_conv_byte_cp(fs_enc_t encoding, uint8_t b) {
+    if (b < 0x80) {
+        return b;
+    }
+    switch (encoding) {
+        case FS_ENC_WIN_1252:  return b < 0xA0 ? fs_conv_win1252[b - 0x80] : b;
+        case FS_ENC_MAC_ROMAN: return fs_conv_mac_roman[b - 0x80];
+        case FS_ENC_ASCII:     return FS_CONV_REPLACEMENT;
+        default:               return b;
+    }
+}
+
+static void fs_conv_from_bytes(struct fs_conv_out* out, fs_enc_t encoding, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    
+    while (i < len) {
+        size_t groups = fs_conv_bulk_groups(out, (len - i) / 16);
+        size_t stop;
+        
+        if (groups) {
+            size_t done = fs_conv_run_u8(src + i, out->pos, groups, out->normalize);
+            fs_conv_bulk_done(out, done);
+            i += done * 16;
+        }
+        
+        // The scalar path takes the chunk the fast path stopped at.
+        stop = len - i >= 16 ? i + 16 : len;
+        if (encoding == FS_ENC_UTF8) {
+            while (i < stop) {
+                i = fs_conv_utf8_one(out, src, i, len);
+            }
+        } else {
+            for (; i < stop; ++i) {
+                fs_conv_put(out, fs_conv_byte_cp(encoding, src[i]));
+            }
+        }
+    }
+}
+
+static inline uint32_t fs_conv_rd16(const uint8_t* p, bool be) {
+    return be ? ((uint32_t)p[0] << 8 | p[1]) : ((uint32_t)p[1] << 8 | p[0]);
+}
+
+static void fs_conv_from_utf16(struct fs_conv_out* out, const uint8_t* src, size_t len, bool be) {
+    size_t i = 0;
+    
+    while (len - i >= 2) {
+        size_t groups = fs_conv_bulk_groups(out, (len - i) / 32);
+        size_t stop;
+        
+        if (groups) {
+            size_t done = fs_conv_run_u16(src + i, out->pos, groups, be, out->normalize);
+            fs_conv_bulk_done(out, done);
+            i += done * 32;
+        }
+        
+        // The scalar path takes the chunk the fast path stopped at.
+        stop = len - i >= 32 ? i + 32 : len - (len - i) % 2;
+        while (i < stop) {
+            uint32_t unit = fs_conv_rd16(src + i, be);
+            i += 2;
+            
+            if (unit >= 0xD800 && unit <= 0xDBFF) {
+                if (len - i < 2) {
+                    // A truncated unit after a high surrogate is the same error.
+                    i = len;
+                } else {
+                    uint32_t low = fs_conv_rd16(src + i, be);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                        i += 2;
+                    }
+                }
+            }
+            fs_conv_put(out, (unit >= 0xD800 && unit <= 0xDFFF) ? FS_CONV_REPLACEMENT : unit);
+        }
+    }
+    if (i < len) {
+        fs_conv_put(out, FS_CONV_REPLACEMENT);
+    }
+}
+
+static void fs_conv_from_utf32(struct fs_conv_out* out, const uint8_t* src, size_t len, bool be) {
+    size_t i = 0;
+    
+    while (len - i >= 4) {
+        size_t groups = fs_conv_bulk_groups(out, (len - i) / 64);
+        size_t stop;
+        
+        if (groups) {
+            size_t done = fs_conv_run_u32(src + i, out->pos, groups, be, out->normalize);
+            fs_conv_bulk_done(out, done);
+            i += done * 64;
+        }
+        
+        // The scalar path takes the chunk the fast path stopped at.
+        stop = len - i >= 64 ? i + 64 : len - (len - i) % 4;
+        for (; i < stop; i += 4) {
+            const uint8_t* p = src + i;
+            uint32_t cp = be ? ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3])
+                             : ((uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0]);
+            fs_conv_put(out, (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) ? FS_CONV_REPLACEMENT : cp);
+        }
+    }
+    if (i < len) {
+        fs_conv_put(out, FS_CONV_REPLACEMENT);
+    }
+}
+
+// MARK: - Public API
+
+static size_t fs_conv_bom_len(fs_enc_t encoding, const uint8_t* src, size_t len) {
+    size_t bom_len;
+    fs_enc_t bom = fs_enc_sniff_bom(src, len, &bom_len);
+    
+    // A UTF-16LE source may legitimately start with U+FEFF U+0000.
+    if (bom == FS_ENC_UTF32LE && encoding == FS_ENC_UTF16LE) {
+        return FA_BOM_UTF16_LEN;
+    }
+    return bom == encoding ? bom_len : 0;
+}
+
+fs_error_t fs_enc_to_utf8(fs_enc_t encoding, const void* src, size_t len, uint32_t options,
+                          const fs_buffer_t* dst, size_t* written) {
+    const uint8_t* bytes = (const uint8_t*)src;
+    struct fs_conv_out out;
+    size_t skip;
+    
+    if (!written || (!src && len)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *written = 0;
+    
+    memset(&out, 0, sizeof(out));
+    out.normalize = (options & FS_ENC_CONV_NORMALIZE_EOL) != 0;
+    if (dst && dst->ptr) {
+        out.pos = (uint8_t*)dst->ptr;
+        out.end = out.pos + dst->len;
+    }
+    
+    skip = len ? fs_conv_bom_len(encoding, bytes, len) : 0;
+    bytes += skip;
+    len -= skip;
+    
+    switch (encoding) {
+        case FS_ENC_UTF8:
+        case FS_ENC_ASCII:
+        case FS_ENC_ISO_8859_1:
+        case FS_ENC_WIN_1252:
+        case FS_ENC_MAC_ROMAN:
+            fs_conv_from_bytes(&out, encoding, bytes, len);
+            break;
+        case FS_ENC_UTF16LE:
+        case FS_ENC_UTF16BE:
+            fs_conv_from_utf16(&out, bytes, len, encoding == FS_ENC_UTF16BE);
+            break;
+        case FS_ENC_UTF32LE:
+        case FS_ENC_UTF32BE:
+            fs_conv_from_utf32(&out, bytes, len, encoding == FS_ENC_UTF32BE);
+            break;
+        default:
+            return FS_ERROR_NOT_SUPPORTED;
+    }
+    
+    *written = out.total;
+    return out.overflow ? FS_ERROR_OUT_OF_MEMORY : FS_ERROR_NONE;
+}
@@ -0,0 +1,394 @@
+//
+//  fslog.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/fslog.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__APPLE__)
+#include <os/log.h>
+#include <os/signpost.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+ Every logging thread owns one ring. The thread is its only producer and the
+ drain its only consumer, so logging a message is a vsnprintf into the next
+ slot and a release store of `tail`. Rings are never freed: a thread that
+ exits gives its ring back and the next new thread adopts it, which keeps the
+ ring list push-only (one CAS) and lets the drain walk it without locking
+ the producers out. Only the drain side takes `fs_log_drain_lock`, so that
+ the drain thread, fs_log_flush() and fs_log_set_sink() consume one at a time.
+ */
+
+#define FS_LOG_SUBSYSTEM "com.scribblefoundation.fs"
+
+_Static_assert((FS_LOG_RING_SLOTS & (FS_LOG_RING_SLOTS - 1)) == 0, "FS_LOG_RING_SLOTS must be a power of two");
+
+typedef struct {
+    uint64_t time_ns;
+    uint64_t thread;
+    const char* category;
+    uint16_t length;
+    uint8_t level;
+    char text[FS_LOG_MESSAGE_MAX + 1];
+} fs_log_slot_t;
+
+struct fs_log_ring {
+    struct fs_log_ring* next;           // fixed once the ring is published
+    _Atomic bool owned;
+    _Atomic uint64_t thread;            // of the current owner
+    _Alignas(64) _Atomic uint32_t tail; // producer side
+    _Atomic uint32_t dropped;
+    _Alignas(64) _Atomic uint32_t head; // consumer side
+    fs_log_slot_t slots[FS_LOG_RING_SLOTS];
+};
+
+static _Atomic(struct fs_log_ring*) fs_log_rings = NULL;
+static _Atomic int fs_log_threshold = FS_LOG_LEVEL;
+static _Atomic uint64_t fs_log_dropped_total = 0;
+
+static pthread_mutex_t fs_log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fs_log_wake = PTHREAD_COND_INITIALIZER;
+
+static pthread_key_t fs_log_thread_key;
+static pthread_once_t fs_log_once = PTHREAD_ONCE_INIT;
+static bool fs_log_ready = false;
+
+#if defined(__APPLE__)
+static os_log_t fs_log_os;
+#endif
+
+static uint64_t fs_log_now_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t fs_log_thread_id(void) {
+#if defined(__APPLE__)
+    uint64_t id = 0;
+    pthread_threadid_np(NULL, &id);
+    return id;
+#elif defined(__linux__)
+    return (uint64_t)syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
+
+static void fs_log_default_sink(void* context, const fs_log_record_t* record) {
+    (void)context;
+#if defined(__APPLE__)
+    // os_log stamps the drain time, at most FS_LOG_DRAIN_MS late.
+    os_log_type_t type = record->level >= FS_LOG_ERROR_LEVEL ? OS_LOG_TYPE_ERROR :
+                         record->level == FS_LOG_INFO_LEVEL ? OS_LOG_TYPE_DEFAULT : OS_LOG_TYPE_DEBUG;
+    os_log_with_type(fs_log_os, type, "[%{public}s] %{public}s", record->category, record->message);
+#else
+    time_t seconds = (time_t)(record->time_ns / 1000000000u);
+    unsigned milliseconds = (unsigned)(record->time_ns / 1000000u % 1000u);
+    char stamp[32];
+    struct tm tm;
+    
+    if (!localtime_r(&seconds, &tm) || !strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm)) {
+        stamp[0] = '\0';
+    }
+    fprintf(stderr, "%s.%03u fs[%llu] [%s] %s\n", stamp, milliseconds, (unsigned long long)record->thread,
+            record->category, record->message);
+#endif
+}
+
+static fs_log_sink_t fs_log_sink = fs_log_default_sink;
+static void* fs_log_sink_context = NULL;
+
+// Called with fs_log_drain_lock held.
+static void fs_log_drain(void) {
+    struct fs_log_ring* ring;
+    
+    for (ring = atomic_load_explicit(&fs_log_rings, memory_order_acquire); ring; ring = ring->next) {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        uint32_t dropped;
+        
+        while (head != tail) {
+            const fs_log_slot_t* slot = &ring->slots[head & (FS_LOG_RING_SLOTS - 1)];
+            fs_log_record_t record = {
+                slot->time_ns, slot->thread, (fs_log_level_t)slot->level, slot->category, slot->text, slot->length
+            };
+            
+            fs_log_sink(fs_log_sink_context, &record);
+            // Hand the slot back right away; the producer may be waiting for room.
+            atomic_store_explicit(&ring->head, ++head, memory_order_release);
+        }
+        dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (dropped) {
+            char text[64];
+            int length = snprintf(text, sizeof(text), "%u messages dropped", dropped);
+            fs_log_record_t record = {
+                fs_log_now_ns(), atomic_load_explicit(&ring->thread, memory_order_relaxed), FS_LOG_ERROR_LEVEL,
+                "fslog", text, (size_t)length
+            };
+            
+            fs_log_sink(fs_log_sink_context, &record);
+        }
+    }
+}
+
+static void* fs_log_drain_main(void* arg) {
+    (void)arg;
+#if defined(__APPLE__)
+    pthread_setname_np("com.scribblefoundation.fs.log");
+#endif
+    pthread_mutex_lock(&fs_log_drain_lock);
+    for (;;) {
+        struct timespec deadline;
+        
+        fs_log_drain();
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)FS_LOG_DRAIN_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+        }
+        pthread_cond_timedwait(&fs_log_wake, &fs_log_drain_lock, &deadline);
+    }
+    return NULL;
+}
+
+static void fs_log_thread_release(void* value) {
+    struct fs_log_ring* ring = value;
+    
+    // Pending messages stay for the drain; the next owner appends after them.
+    atomic_store_explicit(&ring->owned, false, memory_order_release);
+}
+
+static void fs_log_setup(void) {
+    pthread_attr_t attr;
+    pthread_t thread;
+    
+#if defined(__APPLE__)
+    fs_log_os = os_log_create(FS_LOG_SUBSYSTEM, "Log");
+#endif
+    if (pthread_key_create(&fs_log_thread_key, fs_log_thread_release) != 0 || pthread_attr_init(&attr) != 0) {
+        return;
+    }
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    fs_log_ready = pthread_create(&thread, &attr, fs_log_drain_main, NULL) == 0;
+    pthread_attr_destroy(&attr);
+    if (fs_log_ready) {
+        atexit(fs_log_flush);
+    }
+}
+
+static struct fs_log_ring* fs_log_ring_current(void) {
+    struct fs_log_ring* ring;
+    struct fs_log_ring* head;
+    
+    pthread_once(&fs_log_once, fs_log_setup);
+    if (!fs_log_ready) {
+        return NULL;
+    }
+    ring = pthread_getspecific(fs_log_thread_key);
+    if (ring) {
+        return ring;
+    }
+    
+    // Adopt the ring of a thread that has exited before making a new one.
+    for (ring = atomic_load_explicit(&fs_log_rings, memory_order_acquire); ring; ring = ring->next) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong_explicit(&ring->owned, &expected, true, memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            break;
+        }
+    }
+    if (!ring) {
+        void* memory = NULL;
+        if (posix_memalign(&memory, 64, sizeof(*ring)) != 0) {
+            return NULL;
+        }
+        ring = memset(memory, 0, sizeof(*ring));
+        atomic_init(&ring->owned, true);
+        atomic_init(&ring->thread, 0);
+        atomic_init(&ring->tail, 0);
+        atomic_init(&ring->dropped, 0);
+        atomic_init(&ring->head, 0);
+        head = atomic_load_explicit(&fs_log_rings, memory_order_relaxed);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&fs_log_rings, &head, ring, memory_order_release,
+                                                        memory_order_relaxed));
+    }
+    atomic_store_explicit(&ring->thread, fs_log_thread_id(), memory_order_relaxed);
+    if (pthread_setspecific(fs_log_thread_key, ring) != 0) {
+        fs_log_thread_release(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+bool fs_log_enabled(fs_log_level_t level) {
+    return level >= FS_LOG_LEVEL && level < FS_LOG_OFF_LEVEL &&
+           (int)level >= atomic_load_explicit(&fs_log_threshold, memory_order_relaxed);
+}
+
+void fs_log_set_level(fs_log_level_t level) {
+    atomic_store_explicit(&fs_log_threshold, (int)level, memory_order_relaxed);
+}
+
+void fs_logv(fs_log_level_t level, const char* category, const char* format, va_list args) {
+    struct fs_log_ring* ring;
+    fs_log_slot_t* slot;
+    uint32_t head, tail;
+    int length;
+    
+    if (!fs_log_enabled(level)) {
+        return;
+    }
+    ring = fs_log_ring_current();
+    if (!ring) {
+        atomic_fetch_add_explicit(&fs_log_dropped_total, 1, memory_order_relaxed);
+        return;
+    }
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head >= FS_LOG_RING_SLOTS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&fs_log_dropped_total, 1, memory_order_relaxed);
+        return;
+    }
+    
+    slot = &ring->slots[tail & (FS_LOG_RING_SLOTS - 1)];
+    length = vsnprintf(slot->text, sizeof(slot->text), format, args);
+    if (length < 0) {
+        slot->text[0] = '\0';
+        length = 0;
+    }
+    slot->time_ns = fs_log_now_ns();
+    slot->thread = atomic_load_explicit(&ring->thread, memory_order_relaxed);
+    slot->category = category;
+    slot->length = (uint16_t)(length < FS_LOG_MESSAGE_MAX ? length : FS_LOG_MESSAGE_MAX);
+    slot->level = (uint8_t)level;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    
+    // Errors go out promptly, and a filling ring is drained before it drops.
+    if (level >= FS_LOG_ERROR_LEVEL || tail + 1 - head == FS_LOG_RING_SLOTS * 3 / 4) {
+        pthread_cond_signal(&fs_log_wake);
+    }
+}
+
+void fs_log(fs_log_level_t level, const char* category, const char* format, ...) {
+    va_list args;
+    
+    va_start(args, format);
+    fs_logv(level, category, format, args);
+    va_end(args);
+}
+
+void fs_log_message(fs_log_level_t level, const char* category, const char* message) {
+    fs_log(level, category, "%s", message);
+}
+
+void fs_log_set_sink(fs_log_sink_t sink, void* context) {
+    pthread_mutex_lock(&fs_log_drain_lock);
+    fs_log_sink = sink ? sink : fs_log_default_sink;
+    fs_log_sink_context = sink ? context : NULL;
+    pthread_mutex_unlock(&fs_log_drain_lock);
+}
+
+void fs_log_flush(void) {
+    pthread_mutex_lock(&fs_log_drain_lock);
+    fs_log_drain();
+    pthread_mutex_unlock(&fs_log_drain_lock);
+}
+
+uint64_t fs_log_dropped(void) {
+    return atomic_load_explicit(&fs_log_dropped_total, memory_order_relaxed);
+}
+
+#if defined(__APPLE__)
+
+static os_log_t fs_signpost_log;
+static pthread_once_t fs_signpost_once = PTHREAD_ONCE_INIT;
+
+static void fs_signpost_setup(void) {
+    fs_signpost_log = os_log_create(FS_LOG_SUBSYSTEM, "Stages");
+}
+
+// os_signpost names must be string literals, hence the switches.
+fs_signpost_id_t fs_signpost_begin(fs_signpost_stage_t stage) {
+    os_signpost_id_t id;
+    
+    pthread_once(&fs_signpost_once, fs_signpost_setup);
+    if (!os_signpost_enabled(fs_signpost_log)) {
+        return 0;
+    }
+    id = os_signpost_id_generate(fs_signpost_log);
+    switch (stage) {
+        case FS_SIGNPOST_PARSE:   os_signpost_interval_begin(fs_signpost_log, id, "Parse"); break;
+        case FS_SIGNPOST_ENCRYPT: os_signpost_interval_begin(fs_signpost_log, id, "Encrypt"); break;
+        case FS_SIGNPOST_SYNC:    os_signpost_interval_begin(fs_signpost_log, id, "Sync"); break;
+        case FS_SIGNPOST_BACKUP:  os_signpost_interval_begin(fs_signpost_log, id, "Backup"); break;
+    }
+    return id;
+}
+
+void fs_signpost_end(fs_signpost_stage_t stage, fs_signpost_id_t id) {
+    if (!id) {
+        return;
+    }
+    switch (stage) {
+        case FS_SIGNPOST_PARSE:   os_signpost_interval_end(fs_signpost_log, id, "Parse"); break;
+        case FS_SIGNPOST_ENCRYPT: os_signpost_interval_end(fs_signpost_log, id, "Encrypt"); break;
+        case FS_SIGNPOST_SYNC:    os_signpost_interval_end(fs_signpost_log, id, "Sync"); break;
+        case FS_SIGNPOST_BACKUP:  os_signpost_interval_end(fs_signpost_log, id, "Backup"); break;
+    }
+}
+
+#else
+
+fs_signpost_id_t fs_signpost_begin(fs_signpost_stage_t stage) {
+    (void)stage;
+    return 0;
+}
+
+void fs_signpost_end(fs_signpost_stage_t stage, fs_signpost_id_t id) {
+    (void)stage;
+    (void)id;
+}
+
+#endif
@@ -0,0 +1,462 @@
+//
+//  undo_log.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/undo.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ The entries form one sequence of states: before(0), after(0), before(1),
+ after(1), ... State k is either stored in full or as a delta against state
+ k - 1. State 0 is always full, so any state can be rebuilt by walking back
+ to the nearest full one and applying the deltas forward.
+ */
+
+struct fs_undo_state {
+    unsigned char* bytes;   // the whole state, or the replaced middle of a delta
+    size_t len;
+    size_t prefix;          // delta: bytes kept from the start of the previous state
+    size_t suffix;          // delta: bytes kept from its end
+    bool full;
+};
+
+struct fs_undo_entry {
+    unsigned char* command;
+    size_t command_len;
+    struct fs_undo_state states[2];     // before, after
+};
+
+struct fs_undo_log {
+    struct fs_undo_entry* ring;
+    size_t slots;
+    size_t head;
+    size_t count;
+    size_t limit;
+    size_t interval;
+
+    unsigned char* tip;     // newest state, materialized
+    size_t tip_len;
+    size_t since_full;      // deltas between the last full state and `tip`
+    size_t footprint;
+};
+
+static inline struct fs_undo_entry* fs_undo_entry_at(const fs_undo_log_t* log, size_t index) {
+    return &log->ring[(log->head + index) % log->slots];
+}
+
+static inline struct fs_undo_state* fs_undo_state_at(const fs_undo_log_t* log, size_t k) {
+    return &fs_undo_entry_at(log, k / 2)->states[k % 2];
+}
+
+static unsigned char* fs_undo_dup(const void* bytes, size_t len) {
+    // malloc(0) may return NULL, which would read as a failure.
+    unsigned char* copy = malloc(len ? len : 1);
+    if (copy && len) {
+        memcpy(copy, bytes, len);
+    }
+    return copy;
+}
+
+static void fs_undo_state_free(fs_undo_log_t* log, struct fs_undo_state* state) {
+    log->footprint -= state->len;
+    free(state->bytes);
+    memset(state, 0, sizeof(*state));
+}
+
+static void fs_undo_entry_free(fs_undo_log_t* log, struct fs_undo_entry* entry) {
+    log->footprint -= entry->command_len;
+    free(entry->command);
+    fs_undo_state_free(log, &entry->states[0]);
+    fs_undo_state_free(log, &entry->states[1]);
+}
+
+/*
+ Encodes `next` against `prev`. Falls back to a full copy when asked to, or
+ when the delta would not be smaller than the state itself.
+ */
+static bool fs_undo_encode(struct fs_undo_state* out, const unsigned char* prev, size_t prev_len,
+                           const unsigned char* next, size_t next_len, bool full) {
+    memset(out, 0, sizeof(*out));
+
+    if (!full) {
+        fs_undo_delta_t delta = fs_undo_delta_encode((fs_data_t){ (void*)prev, prev_len, false },
+                                                     (fs_data_t){ (void*)next, next_len, false });
+        size_t middle = next_len - delta.prefix - delta.suffix;
+        if (middle + 2 * sizeof(size_t) < next_len || next_len == 0) {
+            out->prefix = delta.prefix;
+            out->suffix = delta.suffix;
+            out->len = middle;
+            out->bytes = fs_undo_dup(middle ? next + delta.prefix : NULL, middle);
+            return out->bytes != NULL;
+        }
+    }
+
+    out->full = true;
+    out->len = next_len;
+    out->bytes = fs_undo_dup(next, next_len);
+    return out->bytes != NULL;
+}
+
+/*
+ Rebuilds state k into a malloc'd buffer. The walk back is bounded by the
+ checkpoint interval; each step writes into the other of two buffers.
+ */
+static unsigned char* fs_undo_materialize(const fs_undo_log_t* log, size_t k, size_t* out_len) {
+    if (k == 2 * log->count - 1) {
+        *out_len = log->tip_len;
+        return fs_undo_dup(log->tip, log->tip_len);
+    }
+
+    size_t base = k;
+    while (!fs_undo_state_at(log, base)->full) {
+        base--;
+    }
+
+    const struct fs_undo_state* state = fs_undo_state_at(log, base);
+    size_t len = state->len;
+    unsigned char* current = fs_undo_dup(state->bytes, len);
+    if (!current) {
+        return NULL;
+    }
+
+    for (size_t i = base + 1; i <= k; i++) {
+        state = fs_undo_state_at(log, i);
+        size_t next_len = state->prefix + state->len + state->suffix;
+        unsigned char* next = malloc(next_len ? next_len : 1);
+        if (!next) {
+            free(current);
+            return NULL;
+        }
+        memcpy(next, current, state->prefix);
+        memcpy(next + state->prefix, state->bytes, state->len);
+        memcpy(next + state->prefix + state->len, current + len - state->suffix, state->suffix);
+        free(current);
+        current = next;
+        len = next_len;
+    }
+
+    *out_len = len;
+    return current;
+}
+
+static void fs_undo_output(fs_data_t* out, unsigned char* bytes, size_t len) {
+    if (out) {
+        out->bytes = bytes;
+        out->len = len;
+        out->owned = true;
+    }
+}
+
+/* Drops the oldest entry after making the next state a checkpoint. */
+static fs_error_t fs_undo_evict(fs_undo_log_t* log) {
+    if (log->count > 1) {
+        struct fs_undo_state* next = fs_undo_state_at(log, 2);
+        if (!next->full) {
+            size_t len;
+            unsigned char* bytes = fs_undo_materialize(log, 2, &len);
+            if (!bytes) {
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            fs_undo_state_free(log, next);
+            next->bytes = bytes;
+            next->len = len;
+            next->full = true;
+            log->footprint += len;
+        }
+    }
+
+    fs_undo_entry_free(log, fs_undo_entry_at(log, 0));
+    log->head = (log->head + 1) % log->slots;
+    log->count--;
+
+    if (log->count == 0) {
+        log->footprint -= log->tip_len;
+        free(log->tip);
+        log->tip = NULL;
+        log->tip_len = 0;
+        log->since_full = 0;
+    }
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_undo_grow(fs_undo_log_t* log) {
+    size_t slots = log->slots ? log->slots * 2 : 8;
+    if (log->limit && slots > log->limit) {
+        slots = log->limit;
+    }
+
+    struct fs_undo_entry* ring = malloc(slots * sizeof(*ring));
+    if (!ring) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < log->count; i++) {
+        ring[i] = *fs_undo_entry_at(log, i);
+    }
+
+    free(log->ring);
+    log->ring = ring;
+    log->slots = slots;
+    log->head = 0;
+    return FS_ERROR_NONE;
+}
+
+fs_undo_delta_t fs_undo_delta_encode(fs_data_t prev, fs_data_t next) {
+    const unsigned char* p = prev.bytes;
+    const unsigned char* n = next.bytes;
+    size_t max = prev.len < next.len ? prev.len : next.len;
+    fs_undo_delta_t delta = { 0, 0 };
+
+    while (delta.prefix < max && p[delta.prefix] == n[delta.prefix]) {
+        delta.prefix++;
+    }
+    while (delta.suffix < max - delta.prefix && p[prev.len - 1 - delta.suffix] == n[next.len - 1 - delta.suffix]) {
+        delta.suffix++;
+    }
+    return delta;
+}
+
+fs_error_t fs_undo_delta_apply(fs_data_t prev, fs_undo_delta_t delta, fs_data_t middle, fs_data_t* out) {
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = (fs_data_t){ NULL, 0, false };
+    if (delta.prefix > prev.len || delta.suffix > prev.len - delta.prefix || (middle.len && !middle.bytes)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+
+    size_t len = delta.prefix + middle.len + delta.suffix;
+    unsigned char* bytes = malloc(len ? len : 1);
+    if (!bytes) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (delta.prefix) {
+        memcpy(bytes, prev.bytes, delta.prefix);
+    }
+    if (middle.len) {
+        memcpy(bytes + delta.prefix, middle.bytes, middle.len);
+    }
+    if (delta.suffix) {
+        memcpy(bytes + delta.prefix + middle.len, (const unsigned char*)prev.bytes + prev.len - delta.suffix,
+               delta.suffix);
+    }
+    fs_undo_output(out, bytes, len);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_undo_log_create(size_t limit, size_t checkpoint_interval, fs_undo_log_t** out) {
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+
+    fs_undo_log_t* log = calloc(1, sizeof(*log));
+    if (!log) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    log->limit = limit;
+    log->interval = checkpoint_interval ? checkpoint_interval : FS_UNDO_CHECKPOINT_INTERVAL;
+
+    *out = log;
+    return FS_ERROR_NONE;
+}
+
+void fs_undo_log_destroy(fs_undo_log_t* log) {
+    if (!log) {
+        return;
+    }
+    fs_undo_log_clear(log);
+    free(log->ring);
+    free(log);
+}
+
+void fs_undo_log_clear(fs_undo_log_t* log) {
+    for (size_t i = 0; i < log->count; i++) {
+        fs_undo_entry_free(log, fs_undo_entry_at(log, i));
+    }
+    free(log->tip);
+    log->tip = NULL;
+    log->tip_len = 0;
+    log->since_full = 0;
+    log->head = 0;
+    log->count = 0;
+    log->footprint = 0;
+}
+
+size_t fs_undo_log_count(const fs_undo_log_t* log) {
+    return log->count;
+}
+
+size_t fs_undo_log_footprint(const fs_undo_log_t* log) {
+    return log->footprint;
+}
+
+fs_error_t fs_undo_log_set_limit(fs_undo_log_t* log, size_t limit) {
+    while (limit && log->count > limit) {
+        fs_error_t error = fs_undo_evict(log);
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    log->limit = limit;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_undo_log_push(fs_undo_log_t* log, fs_data_t command, fs_data_t before, fs_data_t after) {
+    if ((command.len && !command.bytes) || (before.len && !before.bytes) || (after.len && !after.bytes)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+
+    bool evict = log->limit && log->count >= log->limit;
+    // After eviction the history may be empty, and its first state must be full.
+    bool first = log->count == 0 || (evict && log->count == 1);
+
+    struct fs_undo_entry entry = { 0 };
+    bool before_full = first || log->since_full + 1 >= log->interval;
+    bool ok = fs_undo_encode(&entry.states[0], log->tip, log->tip_len, before.bytes, before.len, before_full);
+    size_t since_full = entry.states[0].full ? 0 : log->since_full + 1;
+
+    ok = ok && fs_undo_encode(&entry.states[1], before.bytes, before.len, after.bytes, after.len,
+                              since_full + 1 >= log->interval);
+    since_full = entry.states[1].full ? 0 : since_full + 1;
+
+    entry.command_len = command.len;
+    entry.command = ok ? fs_undo_dup(command.bytes, command.len) : NULL;
+    unsigned char* tip = entry.command ? fs_undo_dup(after.bytes, after.len) : NULL;
+
+    fs_error_t error = tip ? FS_ERROR_NONE : FS_ERROR_OUT_OF_MEMORY;
+    if (error == FS_ERROR_NONE) {
+        if (evict) {
+            error = fs_undo_evict(log);
+        } else if (log->count == log->slots) {
+            error = fs_undo_grow(log);
+        }
+    }
+
+    if (error != FS_ERROR_NONE) {
+        free(entry.command);
+        free(entry.states[0].bytes);
+        free(entry.states[1].bytes);
+        free(tip);
+        return error;
+    }
+
+    *fs_undo_entry_at(log, log->count) = entry;
+    log->count++;
+    log->footprint += entry.command_len + entry.states[0].len + entry.states[1].len;
+
+    log->footprint += after.len;
+    log->footprint -= log->tip_len;
+    free(log->tip);
+    log->tip = tip;
+    log->tip_len = after.len;
+    log->since_full = since_full;
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_undo_log_get(const fs_undo_log_t* log, size_t index, fs_data_t* command,
+                           fs_data_t* before, fs_data_t* after) {
+    if (index >= log->count) {
+        return FS_ERROR_NOT_FOUND;
+    }
+
+    const struct fs_undo_entry* entry = fs_undo_entry_at(log, index);
+    unsigned char* parts[3] = { NULL, NULL, NULL };
+    size_t lens[3] = { entry->command_len, 0, 0 };
+
+    parts[0] = command ? fs_undo_dup(entry->command, entry->command_len) : NULL;
+    parts[1] = before ? fs_undo_materialize(log, 2 * index, &lens[1]) : NULL;
+    parts[2] = after ? fs_undo_materialize(log, 2 * index + 1, &lens[2]) : NULL;
+
+    if ((command && !parts[0]) || (before && !parts[1]) || (after && !parts[2])) {
+        free(parts[0]);
+        free(parts[1]);
+        free(parts[2]);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+
+    fs_undo_output(command, parts[0], lens[0]);
+    fs_undo_output(before, parts[1], lens[1]);
+    fs_undo_output(after, parts[2], lens[2]);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_undo_log_pop(fs_undo_log_t* log, fs_data_t* command, fs_data_t* before, fs_data_t* after) {
+    if (log->count == 0) {
+        return FS_ERROR_NOT_FOUND;
+    }
+
+    size_t last = log->count - 1;
+    fs_data_t parts[3] = { { 0 } };
+    fs_error_t error = fs_undo_log_get(log, last, command ? &parts[0] : NULL,
+                                       before ? &parts[1] : NULL, after ? &parts[2] : NULL);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+
+    // The state before the popped entry becomes the newest one.
+    unsigned char* tip = NULL;
+    size_t tip_len = 0;
+    if (last > 0) {
+        tip = fs_undo_materialize(log, 2 * last - 1, &tip_len);
+        if (!tip) {
+            free(parts[0].bytes);
+            free(parts[1].bytes);
+            free(parts[2].bytes);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    fs_undo_entry_free(log, fs_undo_entry_at(log, last));
+    log->count--;
+
+    log->footprint -= log->tip_len;
+    free(log->tip);
+    log->tip = tip;
+    log->tip_len = tip_len;
+    log->footprint += tip_len;
+
+    log->since_full = 0;
+    for (size_t k = 2 * log->count; k > 0 && !fs_undo_state_at(log, k - 1)->full; k--) {
+        log->since_full++;
+    }
+
+    if (command) {
+        *command = parts[0];
+    }
+    if (before) {
+        *before = parts[1];
+    }
+    if (after) {
+        *after = parts[2];
+    }
+    return FS_ERROR_NONE;
+}
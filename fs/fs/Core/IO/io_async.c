@@ -0,0 +1,621 @@
+//
+//  io_async.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "io_internal.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fs/access.h>
+
+/*
+ The core keeps a FIFO of requests that wait for a queue slot. Whenever a
+ request is queued or finishes, up to `batch_size` waiting requests move to
+ the backend in one call, which for io_uring is one io_uring_enter().
+ Requests cancelled while waiting, and empty reads and writes, never reach
+ the backend.
+ */
+
+static const struct fs_io_backend* const fs_io_backends[] = {
+#if FS_IO_HAVE_DISPATCH
+    &fs_io_backend_dispatch,
+#endif
+#if FS_IO_HAVE_URING
+    &fs_io_backend_uring,
+#endif
+    &fs_io_backend_threads,
+};
+
+// Runs the callback, then frees the queue slot.
+static void fs_io_engine_finish(fs_io_engine_t* engine, fs_io_request_t* request, fs_error_t error) {
+    fs_swift_result_callback callback = request->callback;
+    void* context = request->context;
+    
+    __atomic_store_n(&request->_flags, 0, __ATOMIC_RELEASE);
+    request->_next = NULL;
+    // The request may be freed or resubmitted by the callback.
+    if (callback != NULL) {
+        fs_result_t result = { request, error };
+        callback(context, result);
+    }
+    
+    pthread_mutex_lock(&engine->lock);
+    engine->inflight--;
+    if (engine->inflight == 0 && engine->pending_head == NULL) {
+        pthread_cond_broadcast(&engine->idle);
+    }
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void fs_io_engine_pump(fs_io_engine_t* engine) {
+    fs_io_request_t* batch[FS_IO_BATCH_SIZE * 4];
+    size_t limit = engine->batch_size;
+    
+    for (;;) {
+        fs_io_request_t* cancelled = NULL;
+        fs_io_request_t* empty = NULL;
+        size_t count = 0;
+        
+        pthread_mutex_lock(&engine->lock);
+        while (count < limit && engine->pending_head != NULL && engine->inflight < engine->queue_depth) {
+            fs_io_request_t* request = engine->pending_head;
+            engine->pending_head = request->_next;
+            if (engine->pending_head == NULL) {
+                engine->pending_tail = NULL;
+            }
+            engine->inflight++;
+            
+            if (fs_io_request_cancelled(request)) {
+                request->_next = cancelled;
+                cancelled = request;
+                continue;
+            }
+            if (request->op != FS_IO_FSYNC && request->buffer.len == 0) {
+                request->_next = empty;
+                empty = request;
+                continue;
+            }
+            request->_next = NULL;
+            __atomic_store_n(&request->_flags, FS_IO_REQ_INFLIGHT, __ATOMIC_RELEASE);
+            batch[count++] = request;
+        }
+        pthread_mutex_unlock(&engine->lock);
+        
+        if (count == 0 && cancelled == NULL && empty == NULL) {
+            return;
+        }
+        if (count > 0) {
+            engine->backend->submit(engine, batch, count);
+        }
+        while (cancelled != NULL) {
+            fs_io_request_t* next = cancelled->_next;
+            fs_io_engine_finish(engine, cancelled, FS_ERROR_CANCELLED);
+            cancelled = next;
+        }
+        while (empty != NULL) {
+            fs_io_request_t* next = empty->_next;
+            fs_io_engine_finish(engine, empty, FS_ERROR_NONE);
+            empty = next;
+        }
+    }
+}
+
+void fs_io_engine_complete(fs_io_engine_t* engine, fs_io_request_t* request, long long result) {
+    fs_error_t error = FS_ERROR_NONE;
+    
+    if (result < 0) {
+        error = fs_io_error_from_errno((int)-result);
+    } else if (request->op != FS_IO_FSYNC) {
+        request->transferred += (size_t)result;
+        
+        bool more = request->transferred < request->buffer.len;
+        if (more && result == 0) {
+            // End of file; a write that makes no progress will not make any later.
+            more = false;
+            error = request->op == FS_IO_WRITE ? FS_ERROR_IO : FS_ERROR_NONE;
+        }
+        if (more) {
+            if (!fs_io_request_cancelled(request)) {
+                engine->backend->submit(engine, &request, 1);
+                return;
+            }
+            error = FS_ERROR_CANCELLED;
+        }
+    }
+    
+    fs_io_engine_finish(engine, request, error);
+    fs_io_engine_pump(engine);
+}
+
+fs_error_t fs_io_engine_create(const fs_io_engine_config_t* config, fs_io_engine_t** out) {
+    if (out == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    
+    fs_io_engine_t* engine = calloc(1, sizeof(*engine));
+    if (engine == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    engine->queue_depth = config && config->queue_depth ? config->queue_depth : FS_IO_QUEUE_DEPTH;
+    engine->batch_size = config && config->batch_size ? config->batch_size : FS_IO_BATCH_SIZE;
+    if (engine->batch_size > FS_IO_BATCH_SIZE * 4) {
+        engine->batch_size = FS_IO_BATCH_SIZE * 4;
+    }
+    if (engine->batch_size > engine->queue_depth) {
+        engine->batch_size = engine->queue_depth;
+    }
+    
+    if (pthread_mutex_init(&engine->lock, NULL) != 0) {
+        free(engine);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (pthread_cond_init(&engine->idle, NULL) != 0) {
+        pthread_mutex_destroy(&engine->lock);
+        free(engine);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    fs_error_t error = FS_ERROR_NOT_SUPPORTED;
+    for (size_t i = 0; i < sizeof(fs_io_backends) / sizeof(fs_io_backends[0]); ++i) {
+        engine->backend = fs_io_backends[i];
+        error = engine->backend->start(engine);
+        if (error == FS_ERROR_NONE) {
+            break;
+        }
+    }
+    if (error != FS_ERROR_NONE) {
+        pthread_cond_destroy(&engine->idle);
+        pthread_mutex_destroy(&engine->lock);
+        free(engine);
+        return error;
+    }
+    
+    *out = engine;
+    return FS_ERROR_NONE;
+}
+
+void fs_io_engine_destroy(fs_io_engine_t* engine) {
+    if (engine == NULL) {
+        return;
+    }
+    
+    pthread_mutex_lock(&engine->lock);
+    for (fs_io_request_t* request = engine->pending_head; request != NULL; request = request->_next) {
+        __atomic_or_fetch(&request->_flags, FS_IO_REQ_CANCELLED, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    
+    fs_io_engine_pump(engine);
+    fs_io_engine_drain(engine);
+    
+    engine->backend->stop(engine);
+    pthread_cond_destroy(&engine->idle);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+static fs_io_engine_t* fs_io_shared_engine = NULL;
+static pthread_once_t fs_io_shared_once = PTHREAD_ONCE_INIT;
+
+static void fs_io_shared_setup(void) {
+    fs_io_engine_create(NULL, &fs_io_shared_engine);
+}
+
+fs_io_engine_t* fs_io_engine_shared(void) {
+    pthread_once(&fs_io_shared_once, fs_io_shared_setup);
+    return fs_io_shared_engine;
+}
+
+const char* fs_io_engine_backend(const fs_io_engine_t* engine) {
+    return engine->backend->name;
+}
+
+fs_error_t fs_io_submit(fs_io_engine_t* engine, fs_io_request_t* const* requests, size_t count) {
+    if (engine == NULL || (requests == NULL && count > 0)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const fs_io_request_t* request = requests[i];
+        if (request == NULL || request->op > FS_IO_FSYNC || request->fd < 0 ||
+            (request->op != FS_IO_FSYNC && request->buffer.ptr == NULL && request->buffer.len > 0) ||
+            __atomic_load_n(&request->_flags, __ATOMIC_ACQUIRE) != 0) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+    }
+    if (count == 0) {
+        return FS_ERROR_NONE;
+    }
+    
+    pthread_mutex_lock(&engine->lock);
+    for (size_t i = 0; i < count; ++i) {
+        fs_io_request_t* request = requests[i];
+        request->transferred = 0;
+        request->_next = NULL;
+        request->_backend = NULL;
+        __atomic_store_n(&request->_flags, FS_IO_REQ_PENDING, __ATOMIC_RELEASE);
+        
+        if (engine->pending_tail != NULL) {
+            engine->pending_tail->_next = request;
+        } else {
+            engine->pending_head = request;
+        }
+        engine->pending_tail = request;
+    }
+    pthread_mutex_unlock(&engine->lock);
+    
+    fs_io_engine_pump(engine);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_io_cancel(fs_io_engine_t* engine, fs_io_request_t* request) {
+    if (engine == NULL || request == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    pthread_mutex_lock(&engine->lock);
+    uint32_t flags = __atomic_load_n(&request->_flags, __ATOMIC_ACQUIRE);
+    if ((flags & (FS_IO_REQ_PENDING | FS_IO_REQ_INFLIGHT)) == 0) {
+        pthread_mutex_unlock(&engine->lock);
+        return FS_ERROR_NOT_FOUND;
+    }
+    __atomic_or_fetch(&request->_flags, FS_IO_REQ_CANCELLED, __ATOMIC_RELEASE);
+    
+    if (flags & FS_IO_REQ_PENDING) {
+        fs_io_request_t** link = &engine->pending_head;
+        fs_io_request_t* prev = NULL;
+        while (*link != NULL && *link != request) {
+            prev = *link;
+            link = &(*link)->_next;
+        }
+        if (*link == request) {
+            *link = request->_next;
+            if (engine->pending_tail == request) {
+                engine->pending_tail = prev;
+            }
+            engine->inflight++;
+            pthread_mutex_unlock(&engine->lock);
+            fs_io_engine_finish(engine, request, FS_ERROR_CANCELLED);
+            // The slot it briefly held, or a request its callback queued, may be waiting.
+            fs_io_engine_pump(engine);
+            return FS_ERROR_NONE;
+        }
+    }
+    pthread_mutex_unlock(&engine->lock);
+    
+    engine->backend->cancel(engine, request);
+    return FS_ERROR_NONE;
+}
+
+void fs_io_engine_drain(fs_io_engine_t* engine) {
+    if (engine == NULL) {
+        return;
+    }
+    
+    pthread_mutex_lock(&engine->lock);
+    while (engine->inflight > 0 || engine->pending_head != NULL) {
+        pthread_cond_wait(&engine->idle, &engine->lock);
+    }
+    pthread_mutex_unlock(&engine->lock);
+}
+
+// Atomic save: write a temporary file, flush it, rename it over the target.
+
+#ifdef __APPLE__
+#define FS_IO_MTIME(st) ((st).st_mtimespec)
+#else
+#define FS_IO_MTIME(st) ((st).st_mtim)
+#endif
+
+struct fs_io_save {
+    fs_io_request_t request;
+    fs_io_engine_t* engine;
+    fs_managed_buffer_t contents;
+    fs_swift_error_callback callback;
+    fs_io_stamp_callback stamp_callback;
+    void* context;
+    char* path;
+    char* temp_path;
+};
+
+static void fs_io_save_done(struct fs_io_save* save, fs_error_t error) {
+    fs_io_stamp_t stamp = { 0, 0, 0 };
+    struct stat st;
+    
+    // The rename keeps size and mtime, so the temporary file's are the saved file's.
+    if (error == FS_ERROR_NONE && save->stamp_callback != NULL) {
+        if (fstat(save->request.fd, &st) == 0) {
+            stamp.size = (uint64_t)st.st_size;
+            stamp.mtime_sec = (int64_t)FS_IO_MTIME(st).tv_sec;
+            stamp.mtime_nsec = (int64_t)FS_IO_MTIME(st).tv_nsec;
+        } else {
+            error = fs_io_error_from_errno(errno);
+        }
+    }
+    close(save->request.fd);
+    if (error == FS_ERROR_NONE && rename(save->temp_path, save->path) != 0) {
+        error = fs_io_error_from_errno(errno);
+    }
+    if (error != FS_ERROR_NONE) {
+        unlink(save->temp_path);
+        stamp = (fs_io_stamp_t){ 0, 0, 0 };
+    }
+    
+    if (save->callback != NULL) {
+        save->callback(save->context, error);
+    } else if (save->stamp_callback != NULL) {
+        save->stamp_callback(save->context, error, stamp);
+    }
+    fs_managed_buffer_release(&save->contents);
+    free(save->path);
+    free(save->temp_path);
+    free(save);
+}
+
+static void fs_io_save_step(void* context, fs_result_t result) {
+    struct fs_io_save* save = context;
+    
+    if (result.error == FS_ERROR_NONE && save->request.op == FS_IO_WRITE) {
+        save->request.op = FS_IO_FSYNC;
+        fs_io_request_t* request = &save->request;
+        result.error = fs_io_submit(save->engine, &request, 1);
+        if (result.error == FS_ERROR_NONE) {
+            return;
+        }
+    }
+    fs_io_save_done(save, result.error);
+}
+
+static fs_error_t fs_io_save_start(fs_io_engine_t* engine, const char* path, const fs_managed_buffer_t* contents,
+                                   fs_swift_error_callback callback, fs_io_stamp_callback stamp_callback,
+                                   void* context) {
+    if (engine == NULL || path == NULL || contents == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    struct fs_io_save* save = calloc(1, sizeof(*save));
+    size_t path_len = strlen(path);
+    if (save == NULL || (save->path = malloc(path_len + 1)) == NULL ||
+        (save->temp_path = malloc(path_len + sizeof(".XXXXXX"))) == NULL) {
+        if (save != NULL) {
+            free(save->path);
+        }
+        free(save);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(save->path, path, path_len + 1);
+    memcpy(save->temp_path, path, path_len);
+    memcpy(save->temp_path + path_len, ".XXXXXX", sizeof(".XXXXXX"));
+    
+    int fd = mkstemp(save->temp_path);
+    if (fd < 0) {
+        fs_error_t error = fs_io_error_from_errno(errno);
+        free(save->path);
+        free(save->temp_path);
+        free(save);
+        return error;
+    }
+    fchmod(fd, FS_PERM_644);
+    
+    save->engine = engine;
+    save->contents = *contents;
+    fs_managed_buffer_retain(contents);
+    save->callback = callback;
+    save->stamp_callback = stamp_callback;
+    save->context = context;
+    save->request.op = FS_IO_WRITE;
+    save->request.fd = fd;
+    save->request.buffer = contents->buffer;
+    save->request.callback = fs_io_save_step;
+    save->request.context = save;
+    
+    fs_io_request_t* request = &save->request;
+    fs_error_t error = fs_io_submit(engine, &request, 1);
+    if (error != FS_ERROR_NONE) {
+        close(fd);
+        unlink(save->temp_path);
+        fs_managed_buffer_release(&save->contents);
+        free(save->path);
+        free(save->temp_path);
+        free(save);
+    }
+    return error;
+}
+
+fs_error_t fs_io_save_async(fs_io_engine_t* engine, const char* path, const fs_managed_buffer_t* contents,
+                            fs_swift_error_callback callback, void* context) {
+    return fs_io_save_start(engine, path, contents, callback, NULL, context);
+}
+
+fs_error_t fs_io_save_stamped_async(fs_io_engine_t* engine, const char* path, const fs_managed_buffer_t* contents,
+                                    fs_io_stamp_callback callback, void* context) {
+    return fs_io_save_start(engine, path, contents, NULL, callback, context);
+}
+
+/*
+ Thread pool backend, the portable fallback: a few threads doing blocking
+ pread/pwrite. Each worker performs one operation per request and lets the
+ core resubmit the rest.
+ */
+
+#define FS_IO_THREADS_MAX 4
+
+struct fs_io_threads {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    fs_io_request_t* head;
+    fs_io_request_t* tail;
+    bool stopping;
+    size_t count;
+    pthread_t workers[FS_IO_THREADS_MAX];
+};
+
+static long long fs_io_threads_perform(fs_io_request_t* request) {
+    ssize_t n;
+    
+    do {
+        switch (request->op) {
+            case FS_IO_READ: {
+                size_t len = request->buffer.len - request->transferred;
+                n = pread(request->fd, (uint8_t*)request->buffer.ptr + request->transferred,
+                          len < FS_IO_CHUNK_MAX ? len : FS_IO_CHUNK_MAX, (off_t)(request->offset + request->transferred));
+                break;
+            }
+            case FS_IO_WRITE: {
+                size_t len = request->buffer.len - request->transferred;
+                n = pwrite(request->fd, (const uint8_t*)request->buffer.ptr + request->transferred,
+                           len < FS_IO_CHUNK_MAX ? len : FS_IO_CHUNK_MAX, (off_t)(request->offset + request->transferred));
+                break;
+            }
+            case FS_IO_FSYNC:
+            default:
+#if defined(F_FULLFSYNC)
+                n = fcntl(request->fd, F_FULLFSYNC);
+                if (n < 0 && errno != EINTR) {
+                    n = fsync(request->fd);
+                }
+#else
+                n = fsync(request->fd);
+#endif
+                break;
+        }
+    } while (n < 0 && errno == EINTR);
+    
+    return n < 0 ? -(long long)errno : (long long)n;
+}
+
+static void* fs_io_threads_main(void* arg) {
+    fs_io_engine_t* engine = arg;
+    struct fs_io_threads* pool = engine->backend_state;
+    
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->head == NULL && !pool->stopping) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        fs_io_request_t* request = pool->head;
+        if (request == NULL) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        pool->head = request->_next;
+        if (pool->head == NULL) {
+            pool->tail = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        
+        request->_next = NULL;
+        long long result = fs_io_request_cancelled(request) ? -(long long)ECANCELED : fs_io_threads_perform(request);
+        fs_io_engine_complete(engine, request, result);
+    }
+}
+
+static fs_error_t fs_io_threads_start(fs_io_engine_t* engine) {
+    struct fs_io_threads* pool = calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    engine->backend_state = pool;
+    
+    size_t wanted = engine->queue_depth < FS_IO_THREADS_MAX ? engine->queue_depth : FS_IO_THREADS_MAX;
+    while (pool->count < wanted) {
+        if (pthread_create(&pool->workers[pool->count], NULL, fs_io_threads_main, engine) != 0) {
+            break;
+        }
+        pool->count++;
+    }
+    if (pool->count == 0) {
+        pthread_cond_destroy(&pool->wake);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        engine->backend_state = NULL;
+        return FS_ERROR_UNKNOWN;
+    }
+    return FS_ERROR_NONE;
+}
+
+static void fs_io_threads_submit(fs_io_engine_t* engine, fs_io_request_t* const* requests, size_t count) {
+    struct fs_io_threads* pool = engine->backend_state;
+    
+    pthread_mutex_lock(&pool->lock);
+    for (size_t i = 0; i < count; ++i) {
+        requests[i]->_next = NULL;
+        if (pool->tail != NULL) {
+            pool->tail->_next = requests[i];
+        } else {
+            pool->head = requests[i];
+        }
+        pool->tail = requests[i];
+    }
+    if (count > 1) {
+        pthread_cond_broadcast(&pool->wake);
+    } else {
+        pthread_cond_signal(&pool->wake);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void fs_io_threads_cancel(fs_io_engine_t* engine, fs_io_request_t* request) {
+    // Workers check the flag before starting; a running pread/pwrite finishes.
+    (void)engine;
+    (void)request;
+}
+
+static void fs_io_threads_stop(fs_io_engine_t* engine) {
+    struct fs_io_threads* pool = engine->backend_state;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (size_t i = 0; i < pool->count; ++i) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    engine->backend_state = NULL;
+}
+
+const struct fs_io_backend fs_io_backend_threads = {
+    .name = "threads",
+    .start = fs_io_threads_start,
+    .submit = fs_io_threads_submit,
+    .cancel = fs_io_threads_cancel,
+    .stop = fs_io_threads_stop,
+};
@@ -0,0 +1,184 @@
+//
+//  io_async_dispatch.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "io_internal.h"
+
+#if FS_IO_HAVE_DISPATCH
+
+#include <dispatch/dispatch.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ dispatch_io backend. Every read or write gets a random-access channel on the
+ request's descriptor; the channel is kept in `_backend` (guarded by the
+ engine lock) so fs_io_cancel() can close it with DISPATCH_IO_STOP. Handlers
+ run on one serial queue per engine, which is also where fsync happens.
+ */
+
+static dispatch_io_t fs_io_dispatch_take_channel(fs_io_engine_t* engine, fs_io_request_t* request) {
+    pthread_mutex_lock(&engine->lock);
+    dispatch_io_t channel = request->_backend;
+    request->_backend = NULL;
+    pthread_mutex_unlock(&engine->lock);
+    return channel;
+}
+
+static void fs_io_dispatch_finish(fs_io_engine_t* engine, fs_io_request_t* request, long long result) {
+    dispatch_io_t channel = fs_io_dispatch_take_channel(engine, request);
+    if (channel != NULL) {
+        dispatch_io_close(channel, 0);
+        dispatch_release(channel);
+    }
+    fs_io_engine_complete(engine, request, result);
+}
+
+static void fs_io_dispatch_fsync(fs_io_request_t* request, fs_io_engine_t* engine) {
+    int result;
+    
+    do {
+        result = fcntl(request->fd, F_FULLFSYNC);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        // Not every file system supports F_FULLFSYNC.
+        result = fsync(request->fd);
+    }
+    fs_io_engine_complete(engine, request, result < 0 ? -(long long)errno : 0);
+}
+
+static void fs_io_dispatch_start_one(fs_io_engine_t* engine, dispatch_queue_t queue, fs_io_request_t* request) {
+    if (request->op == FS_IO_FSYNC) {
+        dispatch_async(queue, ^{
+            fs_io_dispatch_fsync(request, engine);
+        });
+        return;
+    }
+    
+    dispatch_io_t channel = dispatch_io_create(DISPATCH_IO_RANDOM, request->fd, queue, ^(int error) {
+        (void)error;
+    });
+    if (channel == NULL) {
+        dispatch_async(queue, ^{
+            fs_io_engine_complete(engine, request, -(long long)EBADF);
+        });
+        return;
+    }
+    
+    pthread_mutex_lock(&engine->lock);
+    request->_backend = channel;
+    pthread_mutex_unlock(&engine->lock);
+    
+    size_t len = request->buffer.len - request->transferred;
+    off_t offset = (off_t)(request->offset + request->transferred);
+    uint8_t* bytes = (uint8_t*)request->buffer.ptr + request->transferred;
+    
+    if (request->op == FS_IO_READ) {
+        __block size_t received = 0;
+        dispatch_io_read(channel, offset, len, queue, ^(bool done, dispatch_data_t data, int error) {
+            if (data != NULL) {
+                dispatch_data_apply(data, ^bool (dispatch_data_t region, size_t region_offset,
+                                                 const void* buffer, size_t size) {
+                    (void)region;
+                    (void)region_offset;
+                    size_t room = len - received;
+                    size_t n = size < room ? size : room;
+                    memcpy(bytes + received, buffer, n);
+                    received += n;
+                    return true;
+                });
+            }
+            if (done) {
+                fs_io_dispatch_finish(engine, request, error != 0 && received == 0 ? -(long long)error
+                                                                                     : (long long)received);
+            }
+        });
+    } else {
+        // The caller keeps the buffer alive until completion, so no copy is made.
+        dispatch_data_t data = dispatch_data_create(bytes, len, queue, ^{ });
+        dispatch_io_write(channel, offset, data, queue, ^(bool done, dispatch_data_t remaining, int error) {
+            if (done) {
+                size_t left = remaining != NULL ? dispatch_data_get_size(remaining) : 0;
+                fs_io_dispatch_finish(engine, request, error != 0 && left == len ? -(long long)error
+                                                                                 : (long long)(len - left));
+            }
+        });
+        dispatch_release(data);
+    }
+}
+
+static fs_error_t fs_io_dispatch_start(fs_io_engine_t* engine) {
+    dispatch_queue_t queue = dispatch_queue_create("com.scribblefoundation.fs.io", DISPATCH_QUEUE_SERIAL);
+    if (queue == NULL) {
+        return FS_ERROR_UNKNOWN;
+    }
+    engine->backend_state = (void*)queue;
+    return FS_ERROR_NONE;
+}
+
+static void fs_io_dispatch_submit(fs_io_engine_t* engine, fs_io_request_t* const* requests, size_t count) {
+    dispatch_queue_t queue = engine->backend_state;
+    
+    for (size_t i = 0; i < count; ++i) {
+        fs_io_dispatch_start_one(engine, queue, requests[i]);
+    }
+}
+
+static void fs_io_dispatch_cancel(fs_io_engine_t* engine, fs_io_request_t* request) {
+    pthread_mutex_lock(&engine->lock);
+    dispatch_io_t channel = request->_backend;
+    if (channel != NULL) {
+        dispatch_retain(channel);
+    }
+    pthread_mutex_unlock(&engine->lock);
+    
+    if (channel != NULL) {
+        // Pending handlers run with `done` set and ECANCELED.
+        dispatch_io_close(channel, DISPATCH_IO_STOP);
+        dispatch_release(channel);
+    }
+}
+
+static void fs_io_dispatch_stop(fs_io_engine_t* engine) {
+    dispatch_release((dispatch_queue_t)engine->backend_state);
+    engine->backend_state = NULL;
+}
+
+const struct fs_io_backend fs_io_backend_dispatch = {
+    .name = "dispatch_io",
+    .start = fs_io_dispatch_start,
+    .submit = fs_io_dispatch_submit,
+    .cancel = fs_io_dispatch_cancel,
+    .stop = fs_io_dispatch_stop,
+};
+
+#endif
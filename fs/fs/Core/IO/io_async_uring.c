@@ -0,0 +1,341 @@
+//
+//  io_async_uring.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "io_internal.h"
+
+#if FS_IO_HAVE_URING
+
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ io_uring through the raw system calls, so there is no liburing dependency.
+ Submissions from any thread fill SQEs under `sq_lock` and enter the whole
+ batch with a single io_uring_enter(). One reaper thread blocks for CQEs
+ and completes requests. Stopping pushes a NOP tagged FS_IO_URING_STOP.
+ */
+
+#define FS_IO_URING_STOP ((uint64_t)UINTPTR_MAX)
+#define FS_IO_URING_IGNORE ((uint64_t)0)
+
+struct fs_io_uring {
+    int fd;
+    
+    void* sq_ring;
+    size_t sq_ring_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    
+    void* cq_ring;
+    size_t cq_ring_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    
+    pthread_mutex_t sq_lock;
+    pthread_t reaper;
+};
+
+static int fs_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int fs_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+// Caller holds `sq_lock`; returns NULL when the submission queue is full.
+static struct io_uring_sqe* fs_io_uring_next_sqe(struct fs_io_uring* ring, unsigned* tail) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (*tail - head >= ring->sq_entries) {
+        return NULL;
+    }
+    
+    unsigned index = *tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    (*tail)++;
+    return sqe;
+}
+
+static void fs_io_uring_prep(struct io_uring_sqe* sqe, fs_io_request_t* request) {
+    size_t len = request->buffer.len - request->transferred;
+    
+    switch (request->op) {
+        case FS_IO_READ:
+            sqe->opcode = IORING_OP_READ;
+            break;
+        case FS_IO_WRITE:
+            sqe->opcode = IORING_OP_WRITE;
+            break;
+        case FS_IO_FSYNC:
+        default:
+            sqe->opcode = IORING_OP_FSYNC;
+            len = 0;
+            break;
+    }
+    sqe->fd = request->fd;
+    if (request->op != FS_IO_FSYNC) {
+        sqe->off = request->offset + request->transferred;
+        sqe->addr = (uint64_t)(uintptr_t)((uint8_t*)request->buffer.ptr + request->transferred);
+        sqe->len = (uint32_t)(len < FS_IO_CHUNK_MAX ? len : FS_IO_CHUNK_MAX);
+    }
+    sqe->user_data = (uint64_t)(uintptr_t)request;
+}
+
+// Caller holds `sq_lock`. Publishes SQEs up to `tail`, returns the number the kernel took.
+static unsigned fs_io_uring_flush(struct fs_io_uring* ring, unsigned tail, int* err) {
+    unsigned old_tail = *ring->sq_tail;
+    unsigned count = tail - old_tail;
+    unsigned done = 0;
+    
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    *err = 0;
+    while (done < count) {
+        int ret = fs_io_uring_enter(ring->fd, count - done, 0, 0);
+        if (ret > 0) {
+            done += (unsigned)ret;
+            continue;
+        }
+        if (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+            continue;
+        }
+        *err = ret < 0 ? errno : EIO;
+        // Without SQPOLL the kernel only reads the ring inside io_uring_enter(),
+        // so the entries it did not take can be withdrawn.
+        __atomic_store_n(ring->sq_tail, old_tail + done, __ATOMIC_RELEASE);
+        break;
+    }
+    return done;
+}
+
+static void* fs_io_uring_main(void* arg) {
+    fs_io_engine_t* engine = arg;
+    struct fs_io_uring* ring = engine->backend_state;
+    
+    for (;;) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        
+        if (head == tail) {
+            if (fs_io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                return NULL;
+            }
+            continue;
+        }
+        
+        bool stop = false;
+        for (; head != tail; ++head) {
+            struct io_uring_cqe cqe = ring->cqes[head & ring->cq_mask];
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            
+            if (cqe.user_data == FS_IO_URING_STOP) {
+                stop = true;
+            } else if (cqe.user_data != FS_IO_URING_IGNORE) {
+                fs_io_engine_complete(engine, (fs_io_request_t*)(uintptr_t)cqe.user_data, cqe.res);
+            }
+        }
+        if (stop) {
+            return NULL;
+        }
+    }
+}
+
+static void fs_io_uring_unmap(struct fs_io_uring* ring) {
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    close(ring->fd);
+}
+
+static fs_error_t fs_io_uring_start(fs_io_engine_t* engine) {
+    struct fs_io_uring* ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    // Room for every request in flight plus the cancellations aimed at them.
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = fs_io_uring_setup(engine->queue_depth * 2, &params);
+    if (ring->fd < 0) {
+        free(ring);
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    // IORING_OP_READ/WRITE need 5.6, the first kernel reporting IORING_FEAT_NODROP.
+    if ((params.features & IORING_FEAT_NODROP) == 0) {
+        close(ring->fd);
+        free(ring);
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        fs_io_uring_unmap(ring);
+        free(ring);
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        fs_io_uring_unmap(ring);
+        free(ring);
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    
+    uint8_t* sq = ring->sq_ring;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_entries = *(unsigned*)(sq + params.sq_off.ring_entries);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    
+    uint8_t* cq = ring->cq_ring;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    
+    pthread_mutex_init(&ring->sq_lock, NULL);
+    engine->backend_state = ring;
+    if (pthread_create(&ring->reaper, NULL, fs_io_uring_main, engine) != 0) {
+        pthread_mutex_destroy(&ring->sq_lock);
+        fs_io_uring_unmap(ring);
+        free(ring);
+        engine->backend_state = NULL;
+        return FS_ERROR_UNKNOWN;
+    }
+    return FS_ERROR_NONE;
+}
+
+static void fs_io_uring_submit(fs_io_engine_t* engine, fs_io_request_t* const* requests, size_t count) {
+    struct fs_io_uring* ring = engine->backend_state;
+    size_t failed_from = count;
+    int err = 0;
+    
+    pthread_mutex_lock(&ring->sq_lock);
+    size_t i = 0;
+    while (i < count) {
+        unsigned tail = *ring->sq_tail;
+        size_t first = i;
+        struct io_uring_sqe* sqe;
+        while (i < count && (sqe = fs_io_uring_next_sqe(ring, &tail)) != NULL) {
+            fs_io_uring_prep(sqe, requests[i++]);
+        }
+        unsigned done = fs_io_uring_flush(ring, tail, &err);
+        if (err != 0) {
+            failed_from = first + done;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ring->sq_lock);
+    
+    for (size_t j = failed_from; j < count; ++j) {
+        fs_io_engine_complete(engine, requests[j], -(long long)err);
+    }
+}
+
+static void fs_io_uring_push(struct fs_io_uring* ring, uint8_t opcode, uint64_t addr, uint64_t user_data) {
+    int err;
+    
+    pthread_mutex_lock(&ring->sq_lock);
+    unsigned tail = *ring->sq_tail;
+    struct io_uring_sqe* sqe = fs_io_uring_next_sqe(ring, &tail);
+    if (sqe != NULL) {
+        sqe->opcode = opcode;
+        sqe->fd = -1;
+        sqe->addr = addr;
+        sqe->user_data = user_data;
+        fs_io_uring_flush(ring, tail, &err);
+    }
+    pthread_mutex_unlock(&ring->sq_lock);
+}
+
+static void fs_io_uring_cancel(fs_io_engine_t* engine, fs_io_request_t* request) {
+    // Only the tag is passed; the kernel matches it against in-flight user_data.
+    fs_io_uring_push(engine->backend_state, IORING_OP_ASYNC_CANCEL, (uint64_t)(uintptr_t)request,
+                     FS_IO_URING_IGNORE);
+}
+
+static void fs_io_uring_stop(fs_io_engine_t* engine) {
+    struct fs_io_uring* ring = engine->backend_state;
+    
+    fs_io_uring_push(ring, IORING_OP_NOP, 0, FS_IO_URING_STOP);
+    pthread_join(ring->reaper, NULL);
+    pthread_mutex_destroy(&ring->sq_lock);
+    fs_io_uring_unmap(ring);
+    free(ring);
+    engine->backend_state = NULL;
+}
+
+const struct fs_io_backend fs_io_backend_uring = {
+    .name = "io_uring",
+    .start = fs_io_uring_start,
+    .submit = fs_io_uring_submit,
+    .cancel = fs_io_uring_cancel,
+    .stop = fs_io_uring_stop,
+};
+
+#endif
@@ -0,0 +1,344 @@
+//
+//  io_chunk.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/chunk.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ Gear table: splitmix64 output for the seed 0x5343424b5f474541. Part of the
+ storage format, see chunk.h.
+ */
+static const uint64_t fs_chunk_gear[256] = {
+    0x6e4856289f990816ull, 0x3a75dfc09f15aee1ull, 0x53c1baeeab9ea429ull, 0x741742241eb35d1full,
+    0x6636705bf19f223full, 0xe11f1451c918ffe6ull, 0x14c7d6cff548ea18ull, 0x2affa95e113d5c90ull,
+    0xd5db5177f371145full, 0x6eed3c01cb41a401ull, 0xdce90d684d7e59cbull, 0xa8120b2f7693c90full,
+    0xc48fb04c925ce9a2ull, 0x846fe58eeb0472f1ull, 0xeae3cc81f142344dull, 0x3c7cdcf0bf7418d6ull,
+    0xec2fcc7b72112adfull, 0xfaebd545eaa04954ull, 0x37ef878c06e48c49ull, 0xbca3d47e45b0586eull,
+    0x3182b3816fbbcb0dull, 0xab5ea23bbb80e1aeull, 0xf9090e27d4333125ull, 0x86d13de9756eb3bfull,
+    0xa089feb48507e8b0ull, 0xbdc02c6cb175b6a1ull, 0x1a82cb85b7a2ab24ull, 0x5dd3b1f92a831d83ull,
+    0x36d0e2c2e1e09693ull, 0x8494511e9dde7e6full, 0xbf97fb4028bc2050ull, 0xfed41519d84bb728ull,
+    0xfc71768d295f7905ull, 0x950c3289bdf00467ull, 0xea9052990a7a865cull, 0x8f529756d6b2bf29ull,
+    0xc578fdd608956b03ull, 0xd1432c4ba9146e76ull, 0x9ed079af42c97c28ull, 0x3128f3fd97595414ull,
+    0x72803a5acc1170c0ull, 0xb212dd7700b28a64ull, 0xac30d6fa77ede9c3ull, 0x4506f80a106fa8c1ull,
+    0x60d4f685bdca8ff4ull, 0x6e4674cb1a934afeull, 0x906c84e7ded05b4aull, 0xf53e86ad9ef28b3full,
+    0x36a8ea68d45bf9f8ull, 0xc3a6c552e451e2dfull, 0x5a938faba211ebe0ull, 0x2c3910712980daf8ull,
+    0x9845e4afb8242546ull, 0xcaa71a4705e749d1ull, 0xc186a8b37f8677d5ull, 0xb0e55744b50995cbull,
+    0x17513ef6fa3d890bull, 0xe4cfcd861fc77d4aull, 0x6e446fde674bb607ull, 0x78b674a058cc138aull,
+    0xe91cc1f80a51d5eeull, 0xef5c55cb005de8f0ull, 0xc946019834fd806eull, 0x870e9c92af7d515cull,
+    0xff6345df7b5c8b94ull, 0xa3509d075c9c3cb7ull, 0xc48dbee39dccc289ull, 0x02d79bcd2e996d4dull,
+    0x021ba6834406f61dull, 0x05b228a6412b6a5full, 0x1387a2941f763280ull, 0xca5ff54f9902d1c2ull,
+    0x072587ce9361d7f7ull, 0x433eccf58bfe1d96ull, 0xce96886c63ff7d10ull, 0x16550a362a3343c6ull,
+    0x558e07f4a5e6ad47ull, 0xf9b6b12edf40d604ull, 0xee173bd41db711cfull, 0x59e45f5ca6c94b07ull,
+    0xf85ed15a4b721562ull, 0x9dccb9939093f0baull, 0x369cda8e658976fcull, 0xac505c2730f0c933ull,
+    0x843a0f2c469f4556ull, 0x2479e85a5dff0e03ull, 0xca624ad9e9395f96ull, 0x880d6bc9b2bbec79ull,
+    0x392cc13fe5658945ull, 0xb7166bdf0008ebf2ull, 0x75f7126c71c80f21ull, 0x0b47ac68cf6d2fdfull,
+    0xfcc2b8e5a4d7ceceull, 0x0df1e2075c975438ull, 0x07c9dcbf4d68202aull, 0x36463ff50b7aa6e6ull,
+    0xbba002c5169e1034ull, 0x75440e20428a11ffull, 0x73a67fe30a06ab4full, 0x07f4d22e4e299978ull,
+    0x268563c2b9678d61ull, 0x05c51d13480efd7bull, 0x961963374e36ed18ull, 0x9495aed55390c4afull,
+    0x2cb4546591359730ull, 0x8256a108ec1cc721ull, 0x307e9216106b2af6ull, 0x30c576475fe20612ull,
+    0xc888fc7e66bd4021ull, 0xec521af59fd7e771ull, 0x0a1999f08bbbeb04ull, 0x31be3ebd7b847521ull,
+    0xb0bcb0f731aa24fbull, 0xed79e834fba38971ull, 0x3667f2f9410fd3a9ull, 0x08183bad61e94806ull,
+    0xe22124a1092b66ebull, 0xd00ef5be76075eb4ull, 0xc91e5ed5d17726faull, 0xb988c34a639335caull,
+    0x6a4c97082d3c3c5dull, 0x6a71cc0bbef2f524ull, 0x10ddd22f6a4e985bull, 0x20feb58ddb60c004ull,
+    0xd6a3e6783946538full, 0x56e13502f0d0741dull, 0x84e024b78888808eull, 0x390be2e361e5db56ull,
+    0x4f37abd0929fee0aull, 0x5fa734f9d6622ea2ull, 0x9b0eada8cf057b5aull, 0xb99631d2e9afa7c5ull,
+    0xf7682b0781022e30ull, 0x28ac138b16baa058ull, 0xeba2830a4adfc20cull, 0xb93b655dfc004c31ull,
+    0xe97cca6bbec4b143ull, 0x512ba9e00fee4267ull, 0x07e66b6b2edd131aull, 0x670570549f65c881ull,
+    0x501b367ab4201552ull, 0xf128a7450340b4f5ull, 0x94871182ee5d7cdbull, 0x51a492f425187d30ull,
+    0x545cabebd25800b8ull, 0xaf52fd3f950345afull, 0xf08fc534f7e5add6ull, 0xa5b9efa5e07b37b3ull,
+    0x054b66edeefc9247ull, 0x289259981ff43b11ull, 0x8798692c5e94c954ull, 0x704d8f61a84e0f25ull,
+    0x62e1996916c20692ull, 0x451b4f8f26de20bdull, 0xed516cd5cb9a1a4aull, 0xc987f69edf8c822full,
+    0x78a118f183093834ull, 0x9982615fc7f80073ull, 0x4a58e4633cfeab08ull, 0x7fd3f7e3402eb834ull,
+    0xe2a1e59e7ec1c469ull, 0x144bf0f005735f80ull, 0xaedc42b875633bedull, 0x4ca251d9628e7a52ull,
+    0x80f88054707348deull, 0x0c78241922ca7b0full, 0xbcc6c8f0b4c5542eull, 0xc5953330f1626003ull,
+    0x3e8e390775496edcull, 0x55f9847c9e97ffc7ull, 0x3d2d809639c2d402ull, 0xa291c2331f678609ull,
+    0x412dcb4370904b8bull, 0x7955b90fbde9af89ull, 0x878036b49f90f61dull, 0xdafa3ce176bd6dc4ull,
+    0x1d6cee836f2e987aull, 0x7ffbc438a6a7d1d3ull, 0x703b9a3f7a60f919ull, 0xe362351416dfe602ull,
+    0x9eea3504ac35f6a7ull, 0xbc21026b50bccf55ull, 0xdb7044133bd07121ull, 0x5472004f9905724bull,
+    0xc3c594a1e6fef0ebull, 0xa800e5dba0e38fabull, 0x689daacf8434c3d6ull, 0xacc0da8500ae2ebfull,
+    0xe1f05511fa988f07ull, 0x1e865332ab3df187ull, 0x1d925b5a63023858ull, 0x63180aa2aedbab76ull,
+    0x4778d8941c06e8b8ull, 0xc7bc90016fb3b929ull, 0x44365c539b6eaadcull, 0xb286837868f06bd4ull,
+    0xff121771f27812ceull, 0xefd85a958e962b60ull, 0x11b77bd8ec003661ull, 0x339b726b5f75c880ull,
+    0x732d05e3741213fdull, 0xda2d1cf8c68aa2a9ull, 0x5f23f5fc5a999e2full, 0x43ad66228f9b41c3ull,
+    0x22b23f3bc6e0cf95ull, 0xe6e1d733b163946bull, 0x7d7e25b4ce7bfdb9ull, 0x81a2000b15f647e7ull,
+    0xfbeb061037e800eaull, 0x8533ffb6485dc246ull, 0xa1b25fe853d0cdadull, 0x3202dcceac25d2a0ull,
+    0x21c588978027bf6aull, 0x11c9f16c541d8d28ull, 0xa080cf8f0a251043ull, 0x9b71d6c99d406e1dull,
+    0xe05f74107c9bf167ull, 0xebb5fbc860a79fb0ull, 0x92b3e1a14ad57646ull, 0xb1c3b757b11ec98bull,
+    0x7a03f3acf3c60877ull, 0x515de679e2ec6994ull, 0x06d9c95277b83564ull, 0x697504e0971d9d59ull,
+    0x476a4466dabccc76ull, 0xc1c4cdd33ecc569cull, 0xe239072321bb5e74ull, 0xc6a23a5ae13bb452ull,
+    0x23177b622e2fd274ull, 0x8f2df2d7897aee7bull, 0xbe2e28b7cbc77025ull, 0xd503eb39941a3a21ull,
+    0x5ca14cd4cda503b9ull, 0x0932ce407d86b9ceull, 0x086a2f3a7b28ec34ull, 0x92d6d67989750390ull,
+    0x1b1c96ea89656b99ull, 0x06191c9b086978a0ull, 0xbebcd445b415badeull, 0xc7309be752cbdd36ull,
+    0x0d4653ab3351c6d4ull, 0xf349d9454edfb9b1ull, 0x04c3e0e49ad0912bull, 0xb2893c318a5c3019ull,
+    0x8c7131e01f4ceccfull, 0x1bdbbdb27b0e6d91ull, 0x8bc29c6856b4e6feull, 0xae5857ab275a8617ull,
+    0x6eb18b4a8978bc3eull, 0x9ab5a5e48bff2914ull, 0xa4b99c2934a891a0ull, 0xfd3ed56b47bd6e28ull,
+    0x5713b71f265b47ffull, 0xa911e4e8a06d5bbcull, 0x994e8d7ba0a7cfc1ull, 0xa54bfea32b2cd8c9ull,
+};
+
+typedef struct {
+    size_t min_size;
+    size_t normal_size;
+    size_t max_size;
+    uint64_t mask_s;
+    uint64_t mask_l;
+} fs_chunker_t;
+
+/* Top `bits` bits: they depend on the last 64 bytes, the low bits on fewer. */
+static inline uint64_t fs_chunk_mask(unsigned bits) {
+    return bits ? ~0ull << (64 - bits) : 0;
+}
+
+/* Out-of-range sizes are clamped rather than rejected. */
+static void fs_chunker_init(fs_chunker_t* chunker, const fs_chunker_config_t* config) {
+    size_t min_size = config && config->min_size ? config->min_size : FS_CHUNK_MIN_SIZE;
+    size_t avg_size = config && config->avg_size ? config->avg_size : FS_CHUNK_AVG_SIZE;
+    size_t max_size = config && config->max_size ? config->max_size : FS_CHUNK_MAX_SIZE;
+    unsigned bits = 0;
+    
+    if (avg_size < 256) avg_size = 256;
+    if (avg_size > ((size_t)1 << 28)) avg_size = (size_t)1 << 28;
+    while (((size_t)2 << bits) <= avg_size) {
+        bits++;
+    }
+    avg_size = (size_t)1 << bits;
+    if (min_size > avg_size) min_size = avg_size;
+    if (max_size < avg_size) max_size = avg_size;
+    
+    chunker->min_size = min_size;
+    chunker->normal_size = avg_size;
+    chunker->max_size = max_size;
+    // Normalization level 2: two bits harder before the average, two easier after.
+    chunker->mask_s = fs_chunk_mask(bits + 2);
+    chunker->mask_l = fs_chunk_mask(bits - 2);
+}
+
+static size_t fs_chunker_next(const fs_chunker_t* chunker, const uint8_t* p, size_t len) {
+    size_t n = len < chunker->max_size ? len : chunker->max_size;
+    size_t normal = n < chunker->normal_size ? n : chunker->normal_size;
+    size_t i = chunker->min_size;
+    uint64_t h = 0;
+    
+    if (len <= chunker->min_size) {
+        return len;
+    }
+    for (; i < normal; i++) {
+        h = (h << 1) + fs_chunk_gear[p[i]];
+        if (!(h & chunker->mask_s)) {
+            return i + 1;
+        }
+    }
+    for (; i < n; i++) {
+        h = (h << 1) + fs_chunk_gear[p[i]];
+        if (!(h & chunker->mask_l)) {
+            return i + 1;
+        }
+    }
+    return n;
+}
+
+size_t fs_chunk_next(const void* data, size_t len, const fs_chunker_config_t* config) {
+    fs_chunker_t chunker;
+    
+    if (!data) {
+        return 0;
+    }
+    fs_chunker_init(&chunker, config);
+    return fs_chunker_next(&chunker, data, len);
+}
+
+fs_error_t fs_chunk_split(const void* data, size_t len, const fs_chunker_config_t* config,
+                          size_t** ends, size_t* count) {
+    const uint8_t* p = data;
+    fs_chunker_t chunker;
+    size_t capacity, used = 0, offset = 0;
+    size_t* out;
+    
+    if (!ends || !count || (!data && len)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *ends = NULL;
+    *count = 0;
+    fs_chunker_init(&chunker, config);
+    
+    // Sized for the average with some slack; grows if the data is unusual.
+    capacity = len / chunker.normal_size + len / (chunker.normal_size * 4) + 1;
+    out = malloc(capacity * sizeof(*out));
+    if (!out) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    while (offset < len) {
+        if (used == capacity) {
+            size_t* grown = realloc(out, capacity * 2 * sizeof(*out));
+            if (!grown) {
+                free(out);
+                return FS_ERROR_OUT_OF_MEMORY;
+            }
+            out = grown;
+            capacity *= 2;
+        }
+        offset += fs_chunker_next(&chunker, p + offset, len - offset);
+        out[used++] = offset;
+    }
+    *ends = out;
+    *count = used;
+    return FS_ERROR_NONE;
+}
+
+/*
+ Chunk hash: four 64-bit lanes over 32-byte stripes, accumulated the way
+ XXH3 does (a 32x32->64 multiply of the keyed input plus the swapped raw
+ input), scrambled every 1 KiB and folded into two independent 64-bit
+ halves. As in XXH3, each stripe of a block is keyed at its own offset into
+ the secret, so moving a stripe within a block changes its keyed products;
+ the scramble between blocks is not linear, so moving one across blocks
+ does too. It runs at memory speed and is not meant to resist crafted
+ collisions.
+ */
+#define FS_CHUNK_STRIPE 32
+#define FS_CHUNK_BLOCK_STRIPES 32
+
+/* Stripe s of a block is keyed with words s..s+3; the partial final stripe with the last four. */
+static const uint64_t fs_chunk_secret[FS_CHUNK_BLOCK_STRIPES + 4] = {
+    0xb9c1fc3f1260eb1full, 0xa2325fa785b34842ull, 0xf40d9be2f431bd7dull, 0x02594c4c6e207429ull,
+    0xc2ba03ba6fa0cc23ull, 0xe6293a1d11b272faull, 0x51da96658a438e1bull, 0x45549c14fb282de3ull,
+    0xbfc118d72154b97cull, 0xd82606138a0da6ddull, 0x731445dd20cc4beaull, 0x720aee81c778399dull,
+    0x09d87b33a4ca2a20ull, 0x59cd18ba77699a85ull, 0x454df9711f263e1aull, 0xe582ec4eb5fe7808ull,
+    0x53e091ff558a45abull, 0xbb8fd125ba97dddbull, 0x283c38f0e312a27cull, 0x82b268fcc0b04d5bull,
+    0xb4306732a6d2ad84ull, 0x5002d31b49d13f00ull, 0xf2863f8f187c53fbull, 0xd2ac79a69b581c4cull,
+    0xb288d2f388707653ull, 0x6d8b2a9bd177a474ull, 0xae026c3304ab1711ull, 0x3574dc10fd576669ull,
+    0x0a76a24dccb9fd9full, 0x9fac6fee363ec390ull, 0x8f6de380e5c92a1eull, 0x08e1943b0c0c593cull,
+    0x8daea86caad597acull, 0x6249d057390d9c02ull, 0xd7cd267bd414297full, 0xc49c6afcc389702cull,
+};
+
+/* Scramble and final-mix keys */
+static const uint64_t fs_chunk_key[8] = {
+    0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+    0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+};
+
+static inline uint64_t fs_chunk_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t fs_chunk_mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t lo = ll + (hl << 32);
+    uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (lo < ll);
+    uint64_t t = lo;
+    lo += lh << 32;
+    hi += lo < t;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t fs_chunk_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= 0x165667919e3779f9ull;
+    return h ^ (h >> 32);
+}
+
+static inline void fs_chunk_stripe(uint64_t* acc, const uint8_t* p, const uint64_t* secret) {
+    for (unsigned i = 0; i < 4; i++) {
+        uint64_t w = fs_chunk_read64(p + i * 8);
+        uint64_t k = w ^ secret[i];
+        acc[i ^ 1] += w;
+        acc[i] += (k & 0xffffffffu) * (k >> 32);
+    }
+}
+
+static inline void fs_chunk_scramble(uint64_t* acc) {
+    for (unsigned i = 0; i < 4; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= fs_chunk_key[i + 4];
+        acc[i] = a * 0x9e3779b1u;
+    }
+}
+
+fs_chunk_id_t fs_chunk_hash(const void* data, size_t len) {
+    const uint8_t* p = data;
+    uint64_t acc[4] = {
+        0xc2b2ae3d27d4eb4full, 0x9e3779b185ebca87ull, 0x165667b19e3779f9ull, 0x85ebca77c2b2ae63ull,
+    };
+    size_t stripes = len / FS_CHUNK_STRIPE;
+    size_t blocks = stripes / FS_CHUNK_BLOCK_STRIPES;
+    fs_chunk_id_t id;
+    
+    for (size_t b = 0; b < blocks; b++) {
+        const uint8_t* block = p + b * FS_CHUNK_BLOCK_STRIPES * FS_CHUNK_STRIPE;
+        
+        for (unsigned s = 0; s < FS_CHUNK_BLOCK_STRIPES; s++) {
+            fs_chunk_stripe(acc, block + s * FS_CHUNK_STRIPE, fs_chunk_secret + s);
+        }
+        fs_chunk_scramble(acc);
+    }
+    for (size_t s = blocks * FS_CHUNK_BLOCK_STRIPES; s < stripes; s++) {
+        fs_chunk_stripe(acc, p + s * FS_CHUNK_STRIPE, fs_chunk_secret + (s - blocks * FS_CHUNK_BLOCK_STRIPES));
+    }
+    if (len % FS_CHUNK_STRIPE) {
+        uint8_t last[FS_CHUNK_STRIPE];
+        
+        if (len >= FS_CHUNK_STRIPE) {
+            // Re-read the final 32 bytes; the length below separates the overlap.
+            memcpy(last, p + len - FS_CHUNK_STRIPE, FS_CHUNK_STRIPE);
+        } else {
+            memset(last, 0, sizeof(last));
+            if (len) memcpy(last, p, len);
+        }
+        fs_chunk_stripe(acc, last, fs_chunk_secret + FS_CHUNK_BLOCK_STRIPES);
+    }
+    
+    id.lo = fs_chunk_avalanche(len * 0x9e3779b185ebca87ull
+                               + fs_chunk_mum(acc[0] ^ fs_chunk_key[0], acc[1] ^ fs_chunk_key[1])
+                               + fs_chunk_mum(acc[2] ^ fs_chunk_key[2], acc[3] ^ fs_chunk_key[3]));
+    id.hi = fs_chunk_avalanche(~len * 0xc2b2ae3d27d4eb4full
+                               + fs_chunk_mum(acc[0] ^ fs_chunk_key[4], acc[3] ^ fs_chunk_key[5])
+                               + fs_chunk_mum(acc[1] ^ fs_chunk_key[6], acc[2] ^ fs_chunk_key[7]));
+    return id;
+}
+
+void fs_chunk_id_hex(fs_chunk_id_t id, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    
+    for (unsigned i = 0; i < 16; i++) {
+        out[i] = digits[(id.hi >> (60 - i * 4)) & 0xf];
+        out[16 + i] = digits[(id.lo >> (60 - i * 4)) & 0xf];
+    }
+    out[FS_CHUNK_ID_HEX_LEN] = '\0';
+}
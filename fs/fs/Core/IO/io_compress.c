@@ -0,0 +1,304 @@
+//
+//  io_compress.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/compress.h>
+#include <string.h>
+
+/*
+ LZ4 block format: a sequence is a token (literal length in the high nibble,
+ match length - 4 in the low nibble; 15 means more length bytes follow,
+ each adding up to 255), the literals, a 16-bit little-endian offset and the
+ extra match length bytes. The last sequence has literals only.
+
+ The format requires the last 5 bytes to be literals and the last match to
+ start at least 12 bytes before the end of the block.
+ */
+#define FS_LZ_MIN_MATCH 4
+#define FS_LZ_LAST_LITERALS 5
+#define FS_LZ_MF_LIMIT 12
+#define FS_LZ_MAX_DISTANCE 65535
+#define FS_LZ_HASH_LOG 12
+// Each 64 failed probes increase the step by one byte, so incompressible
+// input is skipped quickly.
+#define FS_LZ_SKIP_TRIGGER 6
+
+static inline uint32_t fs_lz_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t fs_lz_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t fs_lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - FS_LZ_HASH_LOG);
+}
+
+/* Length of the common prefix of `p` and `m`, without reading past `limit`. */
+static inline size_t fs_lz_match_length(const uint8_t* p, const uint8_t* m, const uint8_t* limit) {
+    const uint8_t* start = p;
+    
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    while (p + 8 <= limit) {
+        uint64_t diff = fs_lz_read64(p) ^ fs_lz_read64(m);
+        if (diff) {
+            return (size_t)(p - start) + ((unsigned)__builtin_ctzll(diff) >> 3);
+        }
+        p += 8;
+        m += 8;
+    }
+#endif
+    while (p < limit && *p == *m) {
+        p++;
+        m++;
+    }
+    return (size_t)(p - start);
+}
+
+static inline uint8_t* fs_lz_put_length(uint8_t* op, size_t len) {
+    for (; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* Worst-case bytes needed for one sequence. */
+static inline size_t fs_lz_sequence_size(size_t literals, size_t match) {
+    return 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1;
+}
+
+fs_error_t fs_compress(const void* src, size_t len, void* dst, size_t capacity, size_t* out_len) {
+    const uint8_t* base = src;
+    const uint8_t* ip = base;
+    const uint8_t* anchor = base;
+    const uint8_t* iend = base + len;
+    uint8_t* op = dst;
+    uint8_t* oend = op + capacity;
+    uint32_t table[1u << FS_LZ_HASH_LOG];
+    size_t literals;
+    
+    if (!dst || !out_len || (!src && len) || len > 0x7fffffffu) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    if (len > FS_LZ_MF_LIMIT) {
+        const uint8_t* mflimit = iend - FS_LZ_MF_LIMIT;
+        const uint8_t* matchlimit = iend - FS_LZ_LAST_LITERALS;
+        
+        memset(table, 0, sizeof(table));
+        ip++;
+        for (;;) {
+            const uint8_t* match;
+            unsigned attempts = 1u << FS_LZ_SKIP_TRIGGER;
+            
+            for (;;) {
+                uint32_t sequence, h;
+                
+                if (ip > mflimit) {
+                    goto last_literals;
+                }
+                sequence = fs_lz_read32(ip);
+                h = fs_lz_hash(sequence);
+                match = base + table[h];
+                table[h] = (uint32_t)(ip - base);
+                if (ip - match <= FS_LZ_MAX_DISTANCE && match < ip && fs_lz_read32(match) == sequence) {
+                    break;
+                }
+                ip += attempts++ >> FS_LZ_SKIP_TRIGGER;
+            }
+            
+            while (ip > anchor && match > base && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+            
+            size_t extra = fs_lz_match_length(ip + FS_LZ_MIN_MATCH, match + FS_LZ_MIN_MATCH, matchlimit);
+            literals = (size_t)(ip - anchor);
+            if (fs_lz_sequence_size(literals, extra) > (size_t)(oend - op)) {
+                return FS_ERROR_INVALID_ARGUMENT;
+            }
+            
+            uint8_t* token = op++;
+            *token = (uint8_t)((literals < 15 ? literals : 15) << 4);
+            if (literals >= 15) {
+                op = fs_lz_put_length(op, literals - 15);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+            
+            size_t offset = (size_t)(ip - match);
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            *token |= (uint8_t)(extra < 15 ? extra : 15);
+            if (extra >= 15) {
+                op = fs_lz_put_length(op, extra - 15);
+            }
+            
+            ip += FS_LZ_MIN_MATCH + extra;
+            anchor = ip;
+            if (ip > mflimit) {
+                break;
+            }
+            // Index a position inside the match so repeats of it are found.
+            table[fs_lz_hash(fs_lz_read32(ip - 2))] = (uint32_t)(ip - 2 - base);
+        }
+    }
+    
+last_literals:
+    literals = (size_t)(iend - anchor);
+    if (1 + literals / 255 + 1 + literals > (size_t)(oend - op)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *op++ = (uint8_t)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) {
+        op = fs_lz_put_length(op, literals - 15);
+    }
+    if (literals) {
+        memcpy(op, anchor, literals);
+    }
+    op += literals;
+    
+    *out_len = (size_t)(op - (uint8_t*)dst);
+    return FS_ERROR_NONE;
+}
+
+/* Reads the extra length bytes after a nibble of 15; false on truncation. */
+static inline int fs_lz_get_length(const uint8_t** ip, const uint8_t* iend, size_t* len) {
+    unsigned byte;
+    
+    do {
+        if (*ip >= iend) {
+            return 0;
+        }
+        byte = *(*ip)++;
+        *len += byte;
+    } while (byte == 255);
+    return 1;
+}
+
+fs_error_t fs_decompress(const void* src, size_t len, void* dst, size_t capacity, size_t* out_len) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = ip + len;
+    uint8_t* base = dst;
+    uint8_t* op = base;
+    uint8_t* oend = base + capacity;
+    
+    if (!src || !len || !dst || !out_len) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    for (;;) {
+        unsigned token;
+        size_t literals, offset, match;
+        const uint8_t* copy;
+        
+        if (ip >= iend) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        token = *ip++;
+        
+        literals = token >> 4;
+        if (literals == 15 && !fs_lz_get_length(&ip, iend, &literals)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        // Short runs are copied as one fixed 16-byte block when both buffers
+        // have room; the extra bytes are overwritten by what follows.
+        if (literals <= 16 && iend - ip >= 16 && oend - op >= 16) {
+            memcpy(op, ip, 16);
+        } else {
+            memcpy(op, ip, literals);
+        }
+        op += literals;
+        ip += literals;
+        if (ip == iend) {
+            break;
+        }
+        
+        if (iend - ip < 2) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (!offset || offset > (size_t)(op - base)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        
+        match = token & 15;
+        if (match == 15 && !fs_lz_get_length(&ip, iend, &match)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        match += FS_LZ_MIN_MATCH;
+        if (match > (size_t)(oend - op)) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        
+        // Overlapping copies repeat the last `offset` bytes; eight at a time
+        // is only safe once the source is at least eight bytes behind. Away
+        // from the end of `dst` the last word may run past the match.
+        copy = op - offset;
+        if (offset >= 8) {
+            uint8_t* end = op + match;
+            if ((size_t)(oend - end) >= 8) {
+                do {
+                    memcpy(op, copy, 8);
+                    op += 8;
+                    copy += 8;
+                } while (op < end);
+                op = end;
+            } else {
+                while (op + 8 <= end) {
+                    memcpy(op, copy, 8);
+                    op += 8;
+                    copy += 8;
+                }
+                while (op < end) {
+                    *op++ = *copy++;
+                }
+            }
+        } else {
+            for (size_t i = 0; i < match; i++) {
+                op[i] = copy[i];
+            }
+            op += match;
+        }
+    }
+    
+    *out_len = (size_t)(op - base);
+    return FS_ERROR_NONE;
+}
@@ -0,0 +1,151 @@
+//
+//  io_internal.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//  Private interface shared by the io translation units. Not a public header.
+
+#ifndef FS_IO_INTERNAL_H
+#define FS_IO_INTERNAL_H
+
+#include <fs/io.h>
+#include <errno.h>
+#include <pthread.h>
+
+#if defined(__APPLE__)
+#define FS_IO_HAVE_DISPATCH 1
+#else
+#define FS_IO_HAVE_DISPATCH 0
+#endif
+
+#ifndef FS_IO_HAVE_URING
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FS_IO_HAVE_URING 1
+#endif
+#endif
+#endif
+#ifndef FS_IO_HAVE_URING
+#define FS_IO_HAVE_URING 0
+#endif
+
+// Upper bound for a single read/write; longer requests are resubmitted.
+#define FS_IO_CHUNK_MAX (1u << 30)
+
+// Request `_flags` bits
+#define FS_IO_REQ_PENDING   (1u << 0)
+#define FS_IO_REQ_INFLIGHT  (1u << 1)
+#define FS_IO_REQ_CANCELLED (1u << 2)
+
+/**
+ * @brief Operations implemented by every async I/O backend.
+ *
+ * The engine core owns queueing, the queue-depth limit and cancellation of
+ * requests that have not started; backends only move bytes.
+ *
+ * @field name The value reported by fs_io_engine_backend().
+ * @field start Sets up `engine->backend_state`; a failure falls through to the next backend.
+ * @field submit Starts `count` requests (at most `engine->batch_size`), each at
+ *               `offset + transferred` for the remaining length. Called without
+ *               the engine lock, possibly from several threads.
+ * @field cancel Best-effort abort of an in-flight request.
+ * @field stop Tears down after all requests completed.
+ */
+struct fs_io_backend {
+    const char* name;
+    fs_error_t (*start)(fs_io_engine_t* engine);
+    void (*submit)(fs_io_engine_t* engine, fs_io_request_t* const* requests, size_t count);
+    void (*cancel)(fs_io_engine_t* engine, fs_io_request_t* request);
+    void (*stop)(fs_io_engine_t* engine);
+};
+
+struct fs_io_engine {
+    const struct fs_io_backend* backend;
+    void* backend_state;
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    fs_io_request_t* pending_head;
+    fs_io_request_t* pending_tail;
+    uint32_t queue_depth;
+    uint32_t batch_size;
+    uint32_t inflight;
+};
+
+/**
+ * @brief Reports the outcome of one backend operation.
+ *
+ * `result` is the number of bytes moved, or a negative errno. Partial
+ * transfers are resubmitted until the request is done, hits end of file or is
+ * cancelled, then the request's callback runs on the calling thread.
+ */
+void fs_io_engine_complete(fs_io_engine_t* engine, fs_io_request_t* request, long long result);
+
+static inline bool fs_io_request_cancelled(const fs_io_request_t* request) {
+    if (__atomic_load_n(&request->_flags, __ATOMIC_ACQUIRE) & FS_IO_REQ_CANCELLED) {
+        return true;
+    }
+    return request->operation != NULL && __atomic_load_n(&request->operation->is_cancelled, __ATOMIC_ACQUIRE);
+}
+
+static inline fs_error_t fs_io_error_from_errno(int err) {
+    switch (err) {
+        case 0:
+            return FS_ERROR_NONE;
+        case ENOENT:
+        case ENOTDIR:
+            return FS_ERROR_NOT_FOUND;
+        case EACCES:
+        case EPERM:
+            return FS_ERROR_PERMISSION;
+        case ENOMEM:
+            return FS_ERROR_OUT_OF_MEMORY;
+        case EISDIR:
+        case EBADF:
+        case EINVAL:
+            return FS_ERROR_INVALID_ARGUMENT;
+        case ECANCELED:
+            return FS_ERROR_CANCELLED;
+        case EEXIST:
+            return FS_ERROR_ALREADY_EXISTS;
+        default:
+            return FS_ERROR_IO;
+    }
+}
+
+extern const struct fs_io_backend fs_io_backend_threads;
+
+#if FS_IO_HAVE_DISPATCH
+extern const struct fs_io_backend fs_io_backend_dispatch;
+#endif
+
+#if FS_IO_HAVE_URING
+extern const struct fs_io_backend fs_io_backend_uring;
+#endif
+
+#endif
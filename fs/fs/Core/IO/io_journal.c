@@ -0,0 +1,284 @@
+//
+//  io_journal.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/journal.h>
+#include <fs/access.h>
+#include "io_internal.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/*
+ File header:    magic, format, user (u32, u32, u64)
+ Record header:  payload length, type, checksum (u32 each)
+
+ All integers are little-endian. The checksum covers the length, the type and
+ the payload, so a torn length field is caught as well as torn payload bytes.
+ */
+#define FS_JOURNAL_MAGIC 0x524a5346u /* "FSJR" */
+
+static inline void fs_journal_put32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24);
+}
+
+static inline uint32_t fs_journal_get32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t fs_journal_mix(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 29);
+}
+
+/* Word-at-a-time hash, continued across the pieces of a payload. */
+typedef struct {
+    uint64_t h;
+    unsigned char tail[8];
+    size_t tail_len;
+} fs_journal_sum_t;
+
+static void fs_journal_sum_update(fs_journal_sum_t* sum, const unsigned char* p, size_t len) {
+    while (len && sum->tail_len) {
+        sum->tail[sum->tail_len++] = *p++;
+        len--;
+        if (sum->tail_len == 8) {
+            uint64_t v;
+            memcpy(&v, sum->tail, 8);
+            sum->h = fs_journal_mix(sum->h, v);
+            sum->tail_len = 0;
+        }
+    }
+    if (sum->tail_len) {
+        return;
+    }
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        sum->h = fs_journal_mix(sum->h, v);
+    }
+    memcpy(sum->tail, p, len);
+    sum->tail_len = len;
+}
+
+static uint32_t fs_journal_sum_final(fs_journal_sum_t* sum) {
+    uint64_t v = 0;
+    memcpy(&v, sum->tail, sum->tail_len);
+    uint64_t h = fs_journal_mix(sum->h, v ^ ((uint64_t)sum->tail_len << 56));
+    h = fs_journal_mix(h, 0);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static void fs_journal_sum_begin(fs_journal_sum_t* sum, uint32_t len, uint32_t type) {
+    memset(sum, 0, sizeof(*sum));
+    sum->h = fs_journal_mix(0x243f6a8885a308d3ull, ((uint64_t)type << 32) | len);
+}
+
+void fs_journal_write_header(void* dst, uint32_t format, uint64_t user) {
+    unsigned char* p = dst;
+    fs_journal_put32(p, FS_JOURNAL_MAGIC);
+    fs_journal_put32(p + 4, format);
+    fs_journal_put32(p + 8, (uint32_t)user);
+    fs_journal_put32(p + 12, (uint32_t)(user >> 32));
+}
+
+size_t fs_journal_write_record(void* dst, uint32_t type, const fs_buffer_t* parts, size_t count) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (parts[i].len > FS_JOURNAL_RECORD_MAX - len) {
+            return 0;
+        }
+        len += parts[i].len;
+    }
+
+    unsigned char* p = dst;
+    fs_journal_sum_t sum;
+    fs_journal_sum_begin(&sum, (uint32_t)len, type);
+
+    unsigned char* payload = p + FS_JOURNAL_RECORD_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        if (parts[i].len) {
+            memcpy(payload, parts[i].ptr, parts[i].len);
+            fs_journal_sum_update(&sum, payload, parts[i].len);
+            payload += parts[i].len;
+        }
+    }
+
+    fs_journal_put32(p, (uint32_t)len);
+    fs_journal_put32(p + 4, type);
+    fs_journal_put32(p + 8, fs_journal_sum_final(&sum));
+    return fs_journal_record_size(len);
+}
+
+fs_error_t fs_journal_begin(fs_buffer_t journal, uint32_t format, uint64_t* user, size_t* offset) {
+    const unsigned char* p = journal.ptr;
+    if (!p || journal.len < FS_JOURNAL_HEADER_SIZE ||
+        fs_journal_get32(p) != FS_JOURNAL_MAGIC || fs_journal_get32(p + 4) != format) {
+        return FS_ERROR_NOT_SUPPORTED;
+    }
+    if (user) {
+        *user = (uint64_t)fs_journal_get32(p + 8) | ((uint64_t)fs_journal_get32(p + 12) << 32);
+    }
+    *offset = FS_JOURNAL_HEADER_SIZE;
+    return FS_ERROR_NONE;
+}
+
+bool fs_journal_next(fs_buffer_t journal, size_t* offset, fs_journal_record_t* record) {
+    const unsigned char* base = journal.ptr;
+    size_t at = *offset;
+    if (!base || at > journal.len || journal.len - at < FS_JOURNAL_RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    const unsigned char* p = base + at;
+    uint32_t len = fs_journal_get32(p);
+    uint32_t type = fs_journal_get32(p + 4);
+    if (len > journal.len - at - FS_JOURNAL_RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    fs_journal_sum_t sum;
+    fs_journal_sum_begin(&sum, len, type);
+    fs_journal_sum_update(&sum, p + FS_JOURNAL_RECORD_HEADER_SIZE, len);
+    if (fs_journal_sum_final(&sum) != fs_journal_get32(p + 8)) {
+        return false;
+    }
+
+    record->type = type;
+    record->payload = p + FS_JOURNAL_RECORD_HEADER_SIZE;
+    record->len = len;
+    record->offset = at;
+    *offset = at + fs_journal_record_size(len);
+    return true;
+}
+
+static fs_error_t fs_journal_write_all(int fd, const unsigned char* bytes, size_t len, off_t offset) {
+    while (len) {
+        size_t chunk = len < FS_IO_CHUNK_MAX ? len : FS_IO_CHUNK_MAX;
+        ssize_t n = pwrite(fd, bytes, chunk, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fs_io_error_from_errno(errno);
+        }
+        bytes += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t fs_journal_flush(int fd) {
+#if defined(F_FULLFSYNC)
+    if (fcntl(fd, F_FULLFSYNC) == 0) {
+        return FS_ERROR_NONE;
+    }
+#endif
+    return fsync(fd) == 0 ? FS_ERROR_NONE : fs_io_error_from_errno(errno);
+}
+
+fs_error_t fs_journal_append(const char* path, uint64_t end, const void* bytes, size_t len) {
+    if (!path || (len && !bytes) || end < FS_JOURNAL_HEADER_SIZE) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return fs_io_error_from_errno(errno);
+    }
+
+    struct stat st;
+    fs_error_t error = FS_ERROR_NONE;
+    if (fstat(fd, &st) != 0) {
+        error = fs_io_error_from_errno(errno);
+    } else if ((uint64_t)st.st_size < end) {
+        error = FS_ERROR_INVALID_ARGUMENT;
+    } else if ((uint64_t)st.st_size > end && ftruncate(fd, (off_t)end) != 0) {
+        error = fs_io_error_from_errno(errno);
+    }
+
+    if (error == FS_ERROR_NONE) {
+        error = fs_journal_write_all(fd, bytes, len, (off_t)end);
+    }
+    if (error == FS_ERROR_NONE) {
+        error = fs_journal_flush(fd);
+    }
+
+    close(fd);
+    return error;
+}
+
+fs_error_t fs_journal_rewrite(const char* path, const void* bytes, size_t len) {
+    if (!path || (len && !bytes)) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+
+    size_t path_len = strlen(path);
+    char* temp_path = malloc(path_len + sizeof(".XXXXXX"));
+    if (!temp_path) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(temp_path, path, path_len);
+    memcpy(temp_path + path_len, ".XXXXXX", sizeof(".XXXXXX"));
+
+    int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        fs_error_t error = fs_io_error_from_errno(errno);
+        free(temp_path);
+        return error;
+    }
+    fchmod(fd, FS_PERM_644);
+
+    fs_error_t error = fs_journal_write_all(fd, bytes, len, 0);
+    if (error == FS_ERROR_NONE) {
+        error = fs_journal_flush(fd);
+    }
+    if (close(fd) != 0 && error == FS_ERROR_NONE) {
+        error = fs_io_error_from_errno(errno);
+    }
+    if (error == FS_ERROR_NONE && rename(temp_path, path) != 0) {
+        error = fs_io_error_from_errno(errno);
+    }
+    if (error != FS_ERROR_NONE) {
+        unlink(temp_path);
+    }
+
+    free(temp_path);
+    return error;
+}
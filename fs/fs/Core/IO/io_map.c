@@ -0,0 +1,170 @@
+//
+//  io_map.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "io_internal.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+static int fs_io_madvise_flag(fs_io_advice_t advice) {
+    switch (advice) {
+        case FS_IO_ADVICE_SEQUENTIAL:
+            return MADV_SEQUENTIAL;
+        case FS_IO_ADVICE_RANDOM:
+            return MADV_RANDOM;
+        case FS_IO_ADVICE_WILLNEED:
+            return MADV_WILLNEED;
+        case FS_IO_ADVICE_NORMAL:
+        default:
+            return MADV_NORMAL;
+    }
+}
+
+static void fs_io_nothing(void* ptr, size_t len, void* context) {
+    (void)ptr;
+    (void)len;
+    (void)context;
+}
+
+static void fs_io_free(void* ptr, size_t len, void* context) {
+    (void)len;
+    (void)context;
+    free(ptr);
+}
+
+static void fs_io_unmap(void* ptr, size_t len, void* context) {
+    (void)context;
+    munmap(ptr, len);
+}
+
+static fs_error_t fs_io_read_all(int fd, size_t size, fs_managed_buffer_t* out) {
+    uint8_t* bytes = malloc(size);
+    if (bytes == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, bytes + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            free(bytes);
+            return fs_io_error_from_errno(errno);
+        }
+        if (n == 0) {
+            break;  // truncated since fstat
+        }
+        done += (size_t)n;
+    }
+    
+    fs_error_t error = fs_managed_buffer_adopt(bytes, done, fs_io_free, NULL, out);
+    if (error != FS_ERROR_NONE) {
+        free(bytes);
+    }
+    return error;
+}
+
+static fs_error_t fs_io_map_fd(int fd, size_t size, fs_io_advice_t advice, fs_managed_buffer_t* out) {
+    void* bytes = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (bytes == MAP_FAILED) {
+        return fs_io_error_from_errno(errno);
+    }
+    if (advice != FS_IO_ADVICE_NORMAL) {
+        madvise(bytes, size, fs_io_madvise_flag(advice));
+    }
+    
+    fs_error_t error = fs_managed_buffer_adopt(bytes, size, fs_io_unmap, NULL, out);
+    if (error != FS_ERROR_NONE) {
+        munmap(bytes, size);
+    }
+    return error;
+}
+
+fs_error_t fs_io_map(const char* path, fs_io_advice_t advice, fs_managed_buffer_t* out) {
+    if (path == NULL || out == NULL) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    int fd;
+    do {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        return fs_io_error_from_errno(errno);
+    }
+    
+    struct stat st;
+    fs_error_t error;
+    if (fstat(fd, &st) != 0) {
+        error = fs_io_error_from_errno(errno);
+    } else if (!S_ISREG(st.st_mode)) {
+        error = FS_ERROR_INVALID_ARGUMENT;
+    } else if ((uintmax_t)st.st_size > SIZE_MAX) {
+        error = FS_ERROR_OUT_OF_MEMORY;
+    } else if (st.st_size == 0) {
+        error = fs_managed_buffer_adopt(NULL, 0, fs_io_nothing, NULL, out);
+    } else if ((size_t)st.st_size < FS_IO_MAP_THRESHOLD) {
+        error = fs_io_read_all(fd, (size_t)st.st_size, out);
+    } else {
+        error = fs_io_map_fd(fd, (size_t)st.st_size, advice, out);
+    }
+    
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    return error;
+}
+
+fs_error_t fs_io_advise(const fs_buffer_t* view, size_t offset, size_t len, fs_io_advice_t advice) {
+    if (view == NULL || offset > view->len || len > view->len - offset) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (view->ptr == NULL || len == 0) {
+        return FS_ERROR_NONE;
+    }
+    
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t mask = (uintptr_t)(page > 0 ? page : 4096) - 1;
+    uintptr_t start = ((uintptr_t)view->ptr + offset) & ~mask;
+    uintptr_t end = (uintptr_t)view->ptr + offset + len;
+    
+    // Best effort: the kernel may reject ranges that are not (fully) mapped.
+    madvise((void*)start, (size_t)(end - start), fs_io_madvise_flag(advice));
+    return FS_ERROR_NONE;
+}
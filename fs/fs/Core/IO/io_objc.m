@@ -0,0 +1,95 @@
+//
+//  io_objc.m
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <fs/io.h>
+#import <fs/bridge.h>
+#include <Foundation/Foundation.h>
+
+static void fs_io_save_nsdata_done(void* context, fs_error_t error) {
+    void (^completion)(fs_error_t) = (__bridge_transfer void (^)(fs_error_t))context;
+    completion(error);
+}
+
+fs_error_t fs_io_save_nsdata_async(NSData* data, NSString* path, void (^completion)(fs_error_t error)) {
+    fs_io_engine_t* engine = fs_io_engine_shared();
+    if (engine == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (data == nil || path.length == 0) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    fs_managed_buffer_t contents;
+    fs_error_t error = fs_managed_buffer_from_nsdata(data, &contents);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    void* context = completion ? (__bridge_retained void *)[completion copy] : NULL;
+    error = fs_io_save_async(engine, path.fileSystemRepresentation, &contents,
+                             context ? fs_io_save_nsdata_done : NULL, context);
+    if (error != FS_ERROR_NONE && context != NULL) {
+        CFRelease(context);
+    }
+    fs_managed_buffer_release(&contents);
+    return error;
+}
+
+static void fs_io_save_nsdata_stamped_done(void* context, fs_error_t error, fs_io_stamp_t stamp) {
+    void (^completion)(fs_error_t, fs_io_stamp_t) = (__bridge_transfer void (^)(fs_error_t, fs_io_stamp_t))context;
+    completion(error, stamp);
+}
+
+fs_error_t fs_io_save_nsdata_stamped_async(NSData* data, NSString* path,
+                                           void (^completion)(fs_error_t error, fs_io_stamp_t stamp)) {
+    fs_io_engine_t* engine = fs_io_engine_shared();
+    if (engine == NULL) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    if (data == nil || path.length == 0) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    
+    fs_managed_buffer_t contents;
+    fs_error_t error = fs_managed_buffer_from_nsdata(data, &contents);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+    
+    void* context = completion ? (__bridge_retained void *)[completion copy] : NULL;
+    error = fs_io_save_stamped_async(engine, path.fileSystemRepresentation, &contents,
+                                     context ? fs_io_save_nsdata_stamped_done : NULL, context);
+    if (error != FS_ERROR_NONE && context != NULL) {
+        CFRelease(context);
+    }
+    fs_managed_buffer_release(&contents);
+    return error;
+}
@@ -0,0 +1,314 @@
+//
+//  io_pipeline.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fs/pipeline.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ There is one bounded queue in front of every stage, and the pool of free
+ items is a queue too: fs_pipeline_submit() pops from it and the last stage
+ pushes back. The pool holds enough items to fill every queue and keep every
+ worker busy, so the queues, not the pool, are what throttle a stage. Only
+ the last stage never blocks on a push, which rules out a cycle of waiters.
+ */
+
+typedef struct {
+    fs_pipeline_item_t** slots;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    bool closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} fs_pipeline_queue_t;
+
+typedef struct {
+    fs_pipeline_t* pipeline;
+    size_t stage;
+} fs_pipeline_worker_t;
+
+struct fs_pipeline {
+    fs_pipeline_stage_t* stages;
+    size_t stage_count;
+    fs_pipeline_queue_t* queues;
+    fs_pipeline_queue_t pool;
+    fs_pipeline_item_t* items;
+    unsigned char* buffers;
+    size_t item_count;
+    pthread_t* threads;
+    fs_pipeline_worker_t* workers;
+    size_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    size_t in_flight;
+    _Atomic int error;
+};
+
+static bool fs_pipeline_queue_init(fs_pipeline_queue_t* queue, size_t capacity) {
+    memset(queue, 0, sizeof(*queue));
+    queue->slots = malloc(capacity * sizeof(*queue->slots));
+    if (!queue->slots) {
+        return false;
+    }
+    queue->capacity = capacity;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return true;
+}
+
+static void fs_pipeline_queue_destroy(fs_pipeline_queue_t* queue) {
+    if (!queue->slots) {
+        return;
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+static void fs_pipeline_queue_push(fs_pipeline_queue_t* queue, fs_pipeline_item_t* item) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    queue->slots[(queue->head + queue->count++) % queue->capacity] = item;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Returns NULL once the queue is closed and drained. */
+static fs_pipeline_item_t* fs_pipeline_queue_pop(fs_pipeline_queue_t* queue) {
+    fs_pipeline_item_t* item = NULL;
+    
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->count && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    if (queue->count) {
+        item = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+static void fs_pipeline_queue_close(fs_pipeline_queue_t* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void fs_pipeline_retire(fs_pipeline_t* pipeline, fs_pipeline_item_t* item) {
+    fs_pipeline_queue_push(&pipeline->pool, item);
+    
+    pthread_mutex_lock(&pipeline->lock);
+    if (--pipeline->in_flight == 0) {
+        pthread_cond_broadcast(&pipeline->idle);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+static void* fs_pipeline_worker_main(void* arg) {
+    fs_pipeline_worker_t* worker = arg;
+    fs_pipeline_t* pipeline = worker->pipeline;
+    const fs_pipeline_stage_t* stage = &pipeline->stages[worker->stage];
+    bool last = worker->stage + 1 == pipeline->stage_count;
+    fs_pipeline_item_t* item;
+    
+    while ((item = fs_pipeline_queue_pop(&pipeline->queues[worker->stage]))) {
+        bool failed = atomic_load_explicit(&pipeline->error, memory_order_relaxed) != FS_ERROR_NONE;
+        
+        if (!failed) {
+            fs_error_t error = stage->run(stage->context, item);
+            if (error != FS_ERROR_NONE) {
+                int expected = FS_ERROR_NONE;
+                atomic_compare_exchange_strong(&pipeline->error, &expected, (int)error);
+                failed = true;
+            }
+        }
+        if (last || failed) {
+            fs_pipeline_retire(pipeline, item);
+        } else {
+            fs_pipeline_queue_push(&pipeline->queues[worker->stage + 1], item);
+        }
+    }
+    return NULL;
+}
+
+/* Closes every queue, joins the started workers and frees everything. */
+static void fs_pipeline_free(fs_pipeline_t* pipeline, size_t started) {
+    if (pipeline->queues) {
+        for (size_t i = 0; i < pipeline->stage_count; i++) {
+            if (pipeline->queues[i].slots) {
+                fs_pipeline_queue_close(&pipeline->queues[i]);
+            }
+        }
+        for (size_t i = 0; i < started; i++) {
+            pthread_join(pipeline->threads[i], NULL);
+        }
+        for (size_t i = 0; i < pipeline->stage_count; i++) {
+            fs_pipeline_queue_destroy(&pipeline->queues[i]);
+        }
+    }
+    fs_pipeline_queue_destroy(&pipeline->pool);
+    pthread_mutex_destroy(&pipeline->lock);
+    pthread_cond_destroy(&pipeline->idle);
+    free(pipeline->threads);
+    free(pipeline->workers);
+    free(pipeline->items);
+    free(pipeline->buffers);
+    free(pipeline->queues);
+    free(pipeline->stages);
+    free(pipeline);
+}
+
+fs_error_t fs_pipeline_create(const fs_pipeline_stage_t* stages, size_t count,
+                              const fs_pipeline_config_t* config, fs_pipeline_t** out) {
+    fs_pipeline_t* pipeline;
+    size_t depth, threads = 0, started = 0;
+    
+    if (!out) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    *out = NULL;
+    if (!stages || !count || !config || !config->buffer_size) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!stages[i].run) {
+            return FS_ERROR_INVALID_ARGUMENT;
+        }
+        threads += stages[i].workers ? stages[i].workers : 1;
+    }
+    depth = config->queue_depth ? config->queue_depth : FS_PIPELINE_QUEUE_DEPTH;
+    
+    pipeline = calloc(1, sizeof(*pipeline));
+    if (!pipeline) {
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->idle, NULL);
+    atomic_init(&pipeline->error, FS_ERROR_NONE);
+    pipeline->stage_count = count;
+    pipeline->item_count = count * depth + threads;
+    pipeline->thread_count = threads;
+    pipeline->stages = malloc(count * sizeof(*stages));
+    pipeline->queues = calloc(count, sizeof(*pipeline->queues));
+    pipeline->items = calloc(pipeline->item_count, sizeof(*pipeline->items));
+    pipeline->buffers = malloc(pipeline->item_count * config->buffer_size);
+    pipeline->threads = malloc(threads * sizeof(*pipeline->threads));
+    pipeline->workers = malloc(threads * sizeof(*pipeline->workers));
+    if (!pipeline->stages || !pipeline->queues || !pipeline->items || !pipeline->buffers ||
+        !pipeline->threads || !pipeline->workers || !fs_pipeline_queue_init(&pipeline->pool, pipeline->item_count)) {
+        fs_pipeline_free(pipeline, 0);
+        return FS_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(pipeline->stages, stages, count * sizeof(*stages));
+    for (size_t i = 0; i < count; i++) {
+        if (!fs_pipeline_queue_init(&pipeline->queues[i], depth)) {
+            fs_pipeline_free(pipeline, 0);
+            return FS_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    for (size_t i = 0; i < pipeline->item_count; i++) {
+        fs_pipeline_item_t* item = &pipeline->items[i];
+        item->buffer = pipeline->buffers + i * config->buffer_size;
+        item->buffer_size = config->buffer_size;
+        fs_pipeline_queue_push(&pipeline->pool, item);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        unsigned workers = stages[i].workers ? stages[i].workers : 1;
+        for (unsigned w = 0; w < workers; w++, started++) {
+            pipeline->workers[started].pipeline = pipeline;
+            pipeline->workers[started].stage = i;
+            if (pthread_create(&pipeline->threads[started], NULL, fs_pipeline_worker_main,
+                               &pipeline->workers[started]) != 0) {
+                fs_pipeline_free(pipeline, started);
+                return FS_ERROR_UNKNOWN;
+            }
+        }
+    }
+    
+    *out = pipeline;
+    return FS_ERROR_NONE;
+}
+
+void fs_pipeline_destroy(fs_pipeline_t* pipeline) {
+    if (!pipeline) {
+        return;
+    }
+    fs_pipeline_finish(pipeline);
+    fs_pipeline_free(pipeline, pipeline->thread_count);
+}
+
+fs_error_t fs_pipeline_submit(fs_pipeline_t* pipeline, const void* input, size_t len, uint64_t tag, void* user) {
+    fs_pipeline_item_t* item;
+    int error = atomic_load_explicit(&pipeline->error, memory_order_relaxed);
+    
+    if (error != FS_ERROR_NONE) {
+        return (fs_error_t)error;
+    }
+    
+    item = fs_pipeline_queue_pop(&pipeline->pool);
+    item->input = input;
+    item->input_len = len;
+    item->tag = tag;
+    item->user = user;
+    item->len = 0;
+    
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->in_flight++;
+    pthread_mutex_unlock(&pipeline->lock);
+    
+    fs_pipeline_queue_push(&pipeline->queues[0], item);
+    return FS_ERROR_NONE;
+}
+
+fs_error_t fs_pipeline_finish(fs_pipeline_t* pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->in_flight) {
+        pthread_cond_wait(&pipeline->idle, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    
+    return (fs_error_t)atomic_exchange(&pipeline->error, FS_ERROR_NONE);
+}
@@ -31,6 +31,10 @@
 
 #include <cyfn.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "cyfn_internal.h"
 
 /*
  This is an implementation of the AES algorithm, specifically ECB, CTR and CBC mode.
@@ -62,23 +66,16 @@
  For AES192/256 the key size is proportionally larger.
  */
 
-#define CYFN_Nb 4
-
-#if defined(CYFN_AES256) && (CYFN_AES256 == 1)
-#define CYFN_Nk 8
-#define CYFN_Nr 14
-#elif defined(CYFN_AES192) && (CYFN_AES192 == 1)
-#define CYFN_Nk 6
-#define CYFN_Nr 12
-#else
-#define CYFN_Nk 4
-#define CYFN_Nr 10
-#endif
-
 #ifndef CYFN_MULTIPLY_AS_A_FUNCTION
 #define CYFN_MULTIPLY_AS_A_FUNCTION 0
 #endif
 
+// The software rounds of the portable backend are selected with CYFN_SOFT_AES
+// (cyfn.h). The byte-wise rounds below are only compiled for
+// CYFN_SOFT_AES_BYTEWISE; CYFN_MULTIPLY_AS_A_FUNCTION applies to them and to
+// the inverse key schedule.
+#define CYFN_BYTEWISE_ROUNDS (CYFN_SOFT_AES == CYFN_SOFT_AES_BYTEWISE)
+
 /* state - array holding the intermediate results during decryption. */
 typedef uint8_t cyfn_state_t[4][4];
 
@@ -88,6 +85,7 @@ typedef uint8_t cyfn_state_t[4][4];
  This can be useful in (embedded) bootloader applications, where ROM is often limited.
 */
 
+#if CYFN_SOFT_AES != CYFN_SOFT_AES_BITSLICE
 /**
  * @brief A static constant array representing the S-box.
  *
@@ -112,8 +110,9 @@ static const uint8_t cyfn_sbox[256] = {
     0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
     0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
     0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 };
+#endif
 
-#if (defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
+#if CYFN_BYTEWISE_ROUNDS && ((defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1))
 /**
  * The cyfn_rsbox array is a static constant array of 256 uint8_t elements.
  * It is used as a reverse S-box in cryptographic algorithms.
@@ -167,8 +166,21 @@ static const uint8_t cyfn_Rcon[11] = {
     0x8d, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
 };
 
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+// Key bytes must not index a table either; SubWord goes through the bitsliced S-box.
+#define cyfn_subWord(word) cyfn_bitslice_sub_word(word)
+#else
 #define cyfn_getSBoxValue(num) (cyfn_sbox[(num)])
 
+/// SubWord(): applies the S-box to each of the four bytes of a key schedule word.
+static inline void cyfn_subWord(uint8_t* word) {
+    word[0] = cyfn_getSBoxValue(word[0]);
+    word[1] = cyfn_getSBoxValue(word[1]);
+    word[2] = cyfn_getSBoxValue(word[2]);
+    word[3] = cyfn_getSBoxValue(word[3]);
+}
+#endif
+
 /**
  * @brief Expands the cipher key into a series of round keys for AES encryption.
  *
@@ -198,7 +210,7 @@ static const uint8_t cyfn_Rcon[11] = {
  *       apply the S-box substitution to each byte.
  *    c. XOR the word with the word CYFN_Nk positions earlier in the RoundKey array.
  *
- * @see cyfn_getSBoxValue
+ * @see cyfn_subWord
  * @see cyfn_Rcon
  */
 static void cyfn_keyExpansion(
@@ -240,12 +252,7 @@ static void cyfn_keyExpansion(
             // SubWord() is a function that takes a four-byte input word and
             // applies the S-box to each of the four bytes to produce an output word.
             
-            {
-                tempa[0] = cyfn_getSBoxValue(tempa[0]);
-                tempa[1] = cyfn_getSBoxValue(tempa[1]);
-                tempa[2] = cyfn_getSBoxValue(tempa[2]);
-                tempa[3] = cyfn_getSBoxValue(tempa[3]);
-            }
+            cyfn_subWord(tempa);
             
             tempa[0] = tempa[0] ^ cyfn_Rcon[i/CYFN_Nk];
         }
@@ -253,12 +260,7 @@ static void cyfn_keyExpansion(
 #if defined(CYFN_AES256) && (CYFN_AES256 == 1)
         
         if (i % CYFN_Nk == 4) {
-            {
-                tempa[0] = cyfn_getSBoxValue(tempa[0]);
-                tempa[1] = cyfn_getSBoxValue(tempa[1]);
-                tempa[2] = cyfn_getSBoxValue(tempa[2]);
-                tempa[3] = cyfn_getSBoxValue(tempa[3]);
-            }
+            cyfn_subWord(tempa);
         }
 #endif /* if defined(CYFN_AES256) && (CYFN_AES256 == 1) */
         
@@ -270,6 +272,10 @@ static void cyfn_keyExpansion(
     }
 }
 
+#if CYFN_DECRYPT
+static void cyfn_invKeyExpansion(uint8_t* InvRoundKey, const uint8_t* RoundKey);
+#endif
+
 /**
  * @brief Initializes the cyfn context with the provided key.
  *
@@ -289,6 +295,12 @@ void cyfn_init_ctx(
                    const uint8_t* key
                    ) {
     cyfn_keyExpansion(ctx->cyfn_roundKey, key);
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+    cyfn_bitslice_key_schedule(ctx->cyfn_bsRoundKey, ctx->cyfn_roundKey);
+#endif
+#if CYFN_DECRYPT
+    cyfn_invKeyExpansion(ctx->cyfn_invRoundKey, ctx->cyfn_roundKey);
+#endif
 }
 
 #if (defined(CYFN_CBC) && (CYFN_CBC == 1)) || (defined(CYFN_CTR) && (CYFN_CTR == 1))
@@ -309,7 +321,7 @@ void cyfn_init_ctx_iv(
                       const uint8_t* key,
                       const uint8_t* iv
                       ) {
-    cyfn_keyExpansion(ctx->cyfn_roundKey, key);
+    cyfn_init_ctx(ctx, key);
     memcpy (ctx->cyfn_iv, iv, CYFN_AES_BLOCKLEN);
 }
 
@@ -340,6 +352,7 @@ void cyfn_ctx_set_iv(
 // This function adds the round key to state.
 // The round key is added to the state by an XOR function.
 
+#if CYFN_BYTEWISE_ROUNDS
 /**
  * @brief Adds the round key to the state during the AES encryption process.
  *
@@ -469,6 +482,9 @@ static void ShiftRows(cyfn_state_t* state) {
     (*state)[1][3] = temp;
 }
 
+#endif // #if CYFN_BYTEWISE_ROUNDS
+
+#if CYFN_BYTEWISE_ROUNDS || CYFN_DECRYPT
 /**
  * @brief Multiplies a given byte by 2 in the Galois Field (2^8).
  *
@@ -485,7 +501,9 @@ static void ShiftRows(cyfn_state_t* state) {
 static uint8_t xtime(uint8_t x) {
     return ((x<<1) ^ (((x>>7) & 1) * 0x1b));
 }
+#endif
 
+#if CYFN_BYTEWISE_ROUNDS
 // MixColumns function mixes the columns of the state matrix
 
 /**
@@ -529,11 +547,13 @@ static void MixColumns(cyfn_state_t* state) {
         Tm  = (*state)[i][3] ^ t ;              Tm = xtime(Tm);  (*state)[i][3] ^= Tm ^ Tmp ;
     }
 }
+#endif // #if CYFN_BYTEWISE_ROUNDS
 
 // Multiply is used to multiply numbers in the field GF(2^8)
 // Note: The last call to xtime() is unneeded, but often ends up generating a smaller binary
 //       The compiler seems to be able to vectorize the operation better this way.
-#if MULTIPLY_AS_A_FUNCTION
+#if CYFN_DECRYPT
+#if CYFN_MULTIPLY_AS_A_FUNCTION
 static uint8_t Multiply(uint8_t x, uint8_t y) {
     return (((y & 1) * x) ^
             ((y>>1 & 1) * xtime(x)) ^
@@ -551,10 +571,9 @@ static uint8_t Multiply(uint8_t x, uint8_t y) {
 ((y>>4 & 1) * xtime(xtime(xtime(xtime(x))))))   \
 
 #endif
+#endif // #if CYFN_DECRYPT
 
-#if (defined(CYFN_CBC) && CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
-
-#define cyfn_getSBoxInvert(num) (cyfn_rsbox[(num)])
+#if (defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
 
 // MixColumns function mixes the columns of the state matrix.
 // The method used to multiply may be difficult to understand for the inexperienced.
@@ -575,6 +594,8 @@ static void InvMixColumns(cyfn_state_t* state) {
     }
 }
 
+#if CYFN_BYTEWISE_ROUNDS
+#define cyfn_getSBoxInvert(num) (cyfn_rsbox[(num)])
 
 // The SubBytes Function Substitutes the values in the
 // state matrix with values in an S-box.
@@ -613,8 +634,10 @@ static void InvShiftRows(cyfn_state_t* state) {
     (*state)[2][3] = (*state)[3][3];
     (*state)[3][3] = temp;
 }
-#endif // #if (defined(CBC) && CBC == 1) || (defined(ECB) && ECB == 1)
+#endif // #if CYFN_BYTEWISE_ROUNDS
+#endif // #if (defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
 
+#if CYFN_BYTEWISE_ROUNDS
 // Cipher is the main function that encrypts the PlainText.
 static void Cipher(cyfn_state_t* state, const uint8_t* RoundKey) {
     uint8_t round = 0;
@@ -639,8 +662,7 @@ static void Cipher(cyfn_state_t* state, const uint8_t* RoundKey) {
     AddRoundKey(CYFN_Nr, state, RoundKey);
 }
 
-//#if (defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
-#if (defined(CYFN_CBC) && CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
+#if (defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1)
 static void InvCipher(cyfn_state_t* state, const uint8_t* RoundKey) {
     uint8_t round = 0;
     
@@ -663,6 +685,238 @@ static void InvCipher(cyfn_state_t* state, const uint8_t* RoundKey) {
     
 }
 #endif /* #if (defined(CYFN_CBC) && CYFN_CBC == 1) || (defined(CYFN_ECB) && CYFN_ECB == 1) */
+#endif /* #if CYFN_BYTEWISE_ROUNDS */
+
+#if CYFN_DECRYPT
+/**
+ * @brief Derives the decryption schedule used by the equivalent inverse cipher.
+ *
+ * The hardware and table-driven backends decrypt with the round keys in reverse
+ * order and InvMixColumns applied to all but the first and last of them
+ * (FIPS-197, section 5.3.5). The schedule only depends on the key, so it is
+ * computed once in `cyfn_init_ctx`.
+ *
+ * @param[out] InvRoundKey Destination for the (CYFN_Nr + 1) inverse round keys.
+ * @param[in]  RoundKey    The expanded encryption key.
+ */
+static void cyfn_invKeyExpansion(uint8_t* InvRoundKey, const uint8_t* RoundKey) {
+    unsigned round;
+    
+    memcpy(InvRoundKey, RoundKey + (CYFN_Nr * CYFN_AES_BLOCKLEN), CYFN_AES_BLOCKLEN);
+    for (round = 1; round < CYFN_Nr; ++round) {
+        uint8_t* rk = InvRoundKey + (round * CYFN_AES_BLOCKLEN);
+        memcpy(rk, RoundKey + ((CYFN_Nr - round) * CYFN_AES_BLOCKLEN), CYFN_AES_BLOCKLEN);
+        InvMixColumns((cyfn_state_t*)rk);
+    }
+    memcpy(InvRoundKey + (CYFN_Nr * CYFN_AES_BLOCKLEN), RoundKey, CYFN_AES_BLOCKLEN);
+}
+#endif /* #if CYFN_DECRYPT */
+
+/*****************************************************************************/
+/* Backends:                                                                 */
+/*****************************************************************************/
+
+static int cyfn_portable_is_supported(void) {
+    return 1;
+}
+
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_TTABLE
+#define cyfn_portable_encrypt_blocks cyfn_ttable_encrypt_blocks
+#define cyfn_portable_decrypt_blocks cyfn_ttable_decrypt_blocks
+#elif CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+#define cyfn_portable_encrypt_blocks cyfn_bitslice_encrypt_blocks
+#define cyfn_portable_decrypt_blocks cyfn_bitslice_decrypt_blocks
+#else
+static void cyfn_portable_encrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        Cipher((cyfn_state_t*)buf, ctx->cyfn_roundKey);
+    }
+}
+
+#if CYFN_DECRYPT
+static void cyfn_portable_decrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        InvCipher((cyfn_state_t*)buf, ctx->cyfn_roundKey);
+    }
+}
+#endif
+#endif /* CYFN_SOFT_AES */
+
+#if CYFN_CTR_KERNEL
+void cyfn_ctr_blocks_generic(void (*encrypt_blocks)(const struct cyfn_ctx*, uint8_t*, size_t),
+                             const struct cyfn_ctx* ctx, uint8_t* counter, uint8_t* buf, size_t nblocks) {
+    uint8_t keystream[CYFN_CTR_BATCH * CYFN_AES_BLOCKLEN];
+    uint64_t hi = cyfn_load_be64(counter);
+    uint64_t lo = cyfn_load_be64(counter + 8);
+    
+    while (nblocks > 0) {
+        size_t batch = (nblocks < CYFN_CTR_BATCH) ? nblocks : CYFN_CTR_BATCH;
+        size_t j;
+        
+        for (j = 0; j < batch; ++j) {
+            cyfn_store_be64(keystream + (j * CYFN_AES_BLOCKLEN), hi);
+            cyfn_store_be64(keystream + (j * CYFN_AES_BLOCKLEN) + 8, lo);
+            cyfn_ctr_add(&hi, &lo, 1);
+        }
+        
+        encrypt_blocks(ctx, keystream, batch);
+        cyfn_xor_bytes(buf, keystream, batch * CYFN_AES_BLOCKLEN);
+        
+        buf += batch * CYFN_AES_BLOCKLEN;
+        nblocks -= batch;
+    }
+    
+    cyfn_store_be64(counter, hi);
+    cyfn_store_be64(counter + 8, lo);
+}
+
+static void cyfn_portable_ctr_blocks(const struct cyfn_ctx* ctx, uint8_t* counter, uint8_t* buf, size_t nblocks) {
+    cyfn_ctr_blocks_generic(cyfn_portable_encrypt_blocks, ctx, counter, buf, nblocks);
+}
+#endif
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+void cyfn_cbc_decrypt_generic(void (*decrypt_blocks)(const struct cyfn_ctx*, uint8_t*, size_t),
+                              const struct cyfn_ctx* ctx, uint8_t* iv, uint8_t* buf, size_t nblocks) {
+    uint8_t saved[CYFN_CBC_BATCH * CYFN_AES_BLOCKLEN];
+    
+    while (nblocks > 0) {
+        size_t batch = (nblocks < CYFN_CBC_BATCH) ? nblocks : CYFN_CBC_BATCH;
+        size_t bytes = batch * CYFN_AES_BLOCKLEN;
+        
+        memcpy(saved, buf, bytes);
+        decrypt_blocks(ctx, buf, batch);
+        
+        // Block 0 chains from the IV, block j from ciphertext block j - 1.
+        cyfn_xor_bytes(buf, iv, CYFN_AES_BLOCKLEN);
+        cyfn_xor_bytes(buf + CYFN_AES_BLOCKLEN, saved, bytes - CYFN_AES_BLOCKLEN);
+        memcpy(iv, saved + bytes - CYFN_AES_BLOCKLEN, CYFN_AES_BLOCKLEN);
+        
+        buf += bytes;
+        nblocks -= batch;
+    }
+}
+
+static void cyfn_portable_cbc_decrypt(const struct cyfn_ctx* ctx, uint8_t* iv, uint8_t* buf, size_t nblocks) {
+    cyfn_cbc_decrypt_generic(cyfn_portable_decrypt_blocks, ctx, iv, buf, nblocks);
+}
+#endif
+
+const struct cyfn_backend cyfn_backend_portable = {
+    .id = CYFN_BACKEND_PORTABLE,
+    .is_supported = cyfn_portable_is_supported,
+    .encrypt_blocks = cyfn_portable_encrypt_blocks,
+#if CYFN_DECRYPT
+    .decrypt_blocks = cyfn_portable_decrypt_blocks,
+#endif
+#if CYFN_CTR_KERNEL
+    .ctr_blocks = cyfn_portable_ctr_blocks,
+#endif
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+    .cbc_decrypt = cyfn_portable_cbc_decrypt,
+#endif
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    .ghash_is_supported = cyfn_portable_is_supported,
+    .ghash_init = cyfn_ghash_portable_init,
+    .ghash_blocks = cyfn_ghash_portable_blocks,
+#endif
+};
+
+/**
+ * @brief Returns the compiled-in backend for an identifier, or NULL.
+ */
+static const struct cyfn_backend* cyfn_backend_lookup(cyfn_backend_t backend) {
+    switch (backend) {
+        case CYFN_BACKEND_PORTABLE:
+            return &cyfn_backend_portable;
+#if CYFN_HAVE_AESNI
+        case CYFN_BACKEND_AESNI:
+            return &cyfn_backend_aesni;
+#endif
+#if CYFN_HAVE_ARMV8
+        case CYFN_BACKEND_ARMV8:
+            return &cyfn_backend_armv8;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+// Preference order for CYFN_BACKEND_AUTO, fastest first.
+static const cyfn_backend_t cyfn_backend_preference[] = {
+    CYFN_BACKEND_AESNI,
+    CYFN_BACKEND_ARMV8,
+    CYFN_BACKEND_PORTABLE
+};
+
+static _Atomic(const struct cyfn_backend*) cyfn_backend_current = NULL;
+static const struct cyfn_backend* cyfn_backend_best = &cyfn_backend_portable;
+static pthread_once_t cyfn_backend_once = PTHREAD_ONCE_INIT;
+
+static void cyfn_backend_resolve(void) {
+    size_t i;
+    
+    for (i = 0; i < sizeof(cyfn_backend_preference) / sizeof(cyfn_backend_preference[0]); ++i) {
+        const struct cyfn_backend* candidate = cyfn_backend_lookup(cyfn_backend_preference[i]);
+        if (candidate && candidate->is_supported()) {
+            cyfn_backend_best = candidate;
+            break;
+        }
+    }
+    
+    const struct cyfn_backend* expected = NULL;
+    atomic_compare_exchange_strong(&cyfn_backend_current, &expected, cyfn_backend_best);
+}
+
+const struct cyfn_backend* cyfn_active_backend(void) {
+    const struct cyfn_backend* backend = atomic_load_explicit(&cyfn_backend_current, memory_order_acquire);
+    if (backend) {
+        return backend;
+    }
+    
+    pthread_once(&cyfn_backend_once, cyfn_backend_resolve);
+    return atomic_load_explicit(&cyfn_backend_current, memory_order_acquire);
+}
+
+int cyfn_backend_is_available(cyfn_backend_t backend) {
+    if (backend == CYFN_BACKEND_AUTO) {
+        return 1;
+    }
+    
+    const struct cyfn_backend* candidate = cyfn_backend_lookup(backend);
+    return (candidate && candidate->is_supported()) ? 1 : 0;
+}
+
+int cyfn_set_backend(cyfn_backend_t backend) {
+    const struct cyfn_backend* selected;
+    
+    if (backend == CYFN_BACKEND_AUTO) {
+        pthread_once(&cyfn_backend_once, cyfn_backend_resolve);
+        selected = cyfn_backend_best;
+    } else {
+        selected = cyfn_backend_lookup(backend);
+        if (!selected || !selected->is_supported()) {
+            return -1;
+        }
+    }
+    
+    atomic_store_explicit(&cyfn_backend_current, selected, memory_order_release);
+    return 0;
+}
+
+cyfn_backend_t cyfn_get_backend(void) {
+    return cyfn_active_backend()->id;
+}
+
+const char* cyfn_backend_name(cyfn_backend_t backend) {
+    switch (backend) {
+        case CYFN_BACKEND_AUTO:     return "auto";
+        case CYFN_BACKEND_PORTABLE: return "portable";
+        case CYFN_BACKEND_AESNI:    return "aesni";
+        case CYFN_BACKEND_ARMV8:    return "armv8";
+        default:                    return "unknown";
+    }
+}
 
 /*****************************************************************************/
 /* Public functions:                              */
@@ -671,12 +925,12 @@ static void InvCipher(cyfn_state_t* state, const uint8_t* RoundKey) {
 
 void cyfn_ecb_encrypt(const struct cyfn_ctx* ctx, uint8_t* buf) {
     // The next function call encrypts the PlainText with the Key using AES algorithm.
-    Cipher((cyfn_state_t*)buf, ctx->cyfn_roundKey);
+    cyfn_active_backend()->encrypt_blocks(ctx, buf, 1);
 }
 
 void cyfn_ecb_decrypt(const struct cyfn_ctx* ctx, uint8_t* buf) {
     // The next function call decrypts the PlainText with the Key using AES algorithm.
-    InvCipher((cyfn_state_t*)buf, ctx->cyfn_roundKey);
+    cyfn_active_backend()->decrypt_blocks(ctx, buf, 1);
 }
 
 #endif /* #if defined(CYFN_ECB) && (CYFN_ECB == 1) */
@@ -693,10 +947,11 @@ static void XorWithIv(uint8_t* buf, const uint8_t* Iv) {
 void cyfn_cbc_encrypt_buffer(struct cyfn_ctx *ctx, uint8_t* buf, size_t length) {
     size_t i;
     uint8_t *Iv = ctx->cyfn_iv;
+    const struct cyfn_backend* backend = cyfn_active_backend();
     
     for (i = 0; i < length; i += CYFN_AES_BLOCKLEN) {
         XorWithIv(buf, Iv);
-        Cipher((cyfn_state_t*)buf, ctx->cyfn_roundKey);
+        backend->encrypt_blocks(ctx, buf, 1);
         Iv = buf;
         buf += CYFN_AES_BLOCKLEN;
     }
@@ -704,18 +959,17 @@ void cyfn_cbc_encrypt_buffer(struct cyfn_ctx *ctx, uint8_t* buf, size_t length)
     memcpy(ctx->cyfn_iv, Iv, CYFN_AES_BLOCKLEN);
 }
 
+/*
+ Unlike encryption, CBC decryption has no dependency between blocks once the
+ ciphertext is known, so the backend decrypts several blocks per iteration
+ and carries the chaining block itself instead of copying it through ctx.
+ */
 void cyfn_cbc_decrypt_buffer(struct cyfn_ctx* ctx, uint8_t* buf, size_t length) {
-    size_t i;
-    uint8_t storeNextIv[CYFN_AES_BLOCKLEN];
+    size_t nblocks = length / CYFN_AES_BLOCKLEN;
     
-    for (i = 0; i < length; i += CYFN_AES_BLOCKLEN) {
-        memcpy(storeNextIv, buf, CYFN_AES_BLOCKLEN);
-        InvCipher((cyfn_state_t*)buf, ctx->cyfn_roundKey);
-        XorWithIv(buf, ctx->cyfn_iv);
-        memcpy(ctx->cyfn_iv, storeNextIv, CYFN_AES_BLOCKLEN);
-        buf += CYFN_AES_BLOCKLEN;
+    if (nblocks > 0) {
+        cyfn_active_backend()->cbc_decrypt(ctx, ctx->cyfn_iv, buf, nblocks);
     }
-    
 }
 
 #endif /* #if defined(CYFN_CBC) && (CYFN_CBC == 1) */
@@ -725,34 +979,102 @@ void cyfn_cbc_decrypt_buffer(struct cyfn_ctx* ctx, uint8_t* buf, size_t length)
 /*
  Symmetrical operation: same function for encrypting as for decrypting.
  Note any IV/nonce should never be reused with the same key
+
+ Full blocks are handed to the backend's multi-block CTR kernel. A trailing
+ partial block consumes a whole counter value, so the IV left in ctx is the
+ same as with a block-at-a-time implementation.
  */
 void cyfn_ctr_xcrypt_buffer(struct cyfn_ctx* ctx, uint8_t* buf, size_t length) {
-    uint8_t buffer[CYFN_AES_BLOCKLEN];
+    const struct cyfn_backend* backend = cyfn_active_backend();
+    size_t nblocks = length / CYFN_AES_BLOCKLEN;
+    size_t tail = length % CYFN_AES_BLOCKLEN;
     
-    size_t i;
-    int bi;
+    if (nblocks > 0) {
+        backend->ctr_blocks(ctx, ctx->cyfn_iv, buf, nblocks);
+        buf += nblocks * CYFN_AES_BLOCKLEN;
+    }
     
-    for (i = 0, bi = CYFN_AES_BLOCKLEN; i < length; ++i, ++bi) {
-        if (bi == CYFN_AES_BLOCKLEN) {
-            memcpy(buffer, ctx->cyfn_iv, CYFN_AES_BLOCKLEN);
-            Cipher((cyfn_state_t*)buffer,ctx->cyfn_roundKey);
-            
-            /* Increment Iv and handle overflow */
-            for (bi = (CYFN_AES_BLOCKLEN - 1); bi >= 0; --bi) {
-                if (ctx->cyfn_iv[bi] == 255) {
-                    ctx->cyfn_iv[bi] = 0;
-                    continue;
-                }
-                
-                ctx->cyfn_iv[bi] += 1;
-                break;
-            }
-            
-            bi = 0;
+    if (tail > 0) {
+        uint8_t buffer[CYFN_AES_BLOCKLEN] = { 0 };
+        
+        backend->ctr_blocks(ctx, ctx->cyfn_iv, buffer, 1);
+        cyfn_xor_bytes(buf, buffer, tail);
+    }
+}
+
+/**
+ * @brief Computes the counter block for block `index` of a stream starting at `iv`.
+ */
+static void cyfn_ctr_counter_at(const uint8_t* iv, uint64_t index, uint8_t* counter) {
+    uint64_t hi = cyfn_load_be64(iv);
+    uint64_t lo = cyfn_load_be64(iv + 8);
+    
+    cyfn_ctr_add(&hi, &lo, index);
+    cyfn_store_be64(counter, hi);
+    cyfn_store_be64(counter + 8, lo);
+}
+
+void cyfn_ctr_xcrypt_at(const struct cyfn_ctx* ctx, const uint8_t* iv, uint64_t offset, uint8_t* buf, size_t length) {
+    const struct cyfn_backend* backend = cyfn_active_backend();
+    uint8_t counter[CYFN_AES_BLOCKLEN];
+    size_t skip = (size_t)(offset % CYFN_AES_BLOCKLEN);
+    size_t nblocks;
+    
+    if (length == 0) {
+        return;
+    }
+    
+    cyfn_ctr_counter_at(iv, offset / CYFN_AES_BLOCKLEN, counter);
+    
+    // Leading partial block: use the tail of its keystream.
+    if (skip > 0) {
+        uint8_t buffer[CYFN_AES_BLOCKLEN] = { 0 };
+        size_t n = CYFN_AES_BLOCKLEN - skip;
+        
+        if (n > length) {
+            n = length;
+        }
+        
+        backend->ctr_blocks(ctx, counter, buffer, 1);
+        cyfn_xor_bytes(buf, buffer + skip, n);
+        buf += n;
+        length -= n;
+    }
+    
+    nblocks = length / CYFN_AES_BLOCKLEN;
+    if (nblocks > 0) {
+        backend->ctr_blocks(ctx, counter, buf, nblocks);
+        buf += nblocks * CYFN_AES_BLOCKLEN;
+        length -= nblocks * CYFN_AES_BLOCKLEN;
+    }
+    
+    if (length > 0) {
+        uint8_t buffer[CYFN_AES_BLOCKLEN] = { 0 };
+        
+        backend->ctr_blocks(ctx, counter, buffer, 1);
+        cyfn_xor_bytes(buf, buffer, length);
+    }
+}
+
+// Chunk size for the out-of-place variant: small enough that the copied
+// chunk is still in L1 when the keystream is XORed into it.
+#define CYFN_CTR_COPY_CHUNK 4096
+
+void cyfn_ctr_xcrypt_copy_at(const struct cyfn_ctx* ctx, const uint8_t* iv, uint64_t offset,
+                             const uint8_t* in, uint8_t* out, size_t length) {
+    while (length > 0) {
+        size_t n = (length < CYFN_CTR_COPY_CHUNK) ? length : CYFN_CTR_COPY_CHUNK;
+        
+        if (out != in) {
+            memcpy(out, in, n);
         }
+        cyfn_ctr_xcrypt_at(ctx, iv, offset, out, n);
         
-        buf[i] = (buf[i] ^ buffer[bi]);
+        in += n;
+        out += n;
+        offset += n;
+        length -= n;
     }
 }
 
-#endif /* #if defined(CYFN_CTR) && (CYFN_CTR == 1) */
\ No newline at end of file
+#endif /* #if defined(CYFN_CTR) && (CYFN_CTR == 1) */
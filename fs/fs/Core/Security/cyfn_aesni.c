@@ -0,0 +1,372 @@
+//
+//  cyfn_aesni.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cyfn_internal.h"
+
+#if CYFN_HAVE_AESNI
+
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+/*
+ AES-NI backend for x86_64.
+
+ The expanded key produced by cyfn_keyExpansion is already in the byte order
+ AESENC expects, so round keys are loaded straight from the context. Decryption
+ uses the equivalent inverse cipher schedule in cyfn_invRoundKey with AESDEC.
+
+ Functions are compiled with a target attribute so the rest of the library
+ does not have to be built with -maes; they are only ever called after
+ cyfn_aesni_is_supported() returned non-zero.
+ */
+
+#define CYFN_AESNI_TARGET __attribute__((target("aes,sse2")))
+
+static int cyfn_aesni_is_supported(void) {
+    unsigned int eax, ebx, ecx, edx;
+    
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ecx & bit_AES) != 0;
+}
+
+CYFN_AESNI_TARGET
+static inline void cyfn_aesni_load_keys(__m128i* rk, const uint8_t* RoundKey) {
+    int round;
+    for (round = 0; round <= CYFN_Nr; ++round) {
+        rk[round] = _mm_loadu_si128((const __m128i*)(RoundKey + (round * CYFN_AES_BLOCKLEN)));
+    }
+}
+
+CYFN_AESNI_TARGET
+static void cyfn_aesni_encrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    __m128i rk[CYFN_Nr + 1];
+    int round;
+    
+    cyfn_aesni_load_keys(rk, ctx->cyfn_roundKey);
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        __m128i state = _mm_loadu_si128((const __m128i*)buf);
+        
+        state = _mm_xor_si128(state, rk[0]);
+        for (round = 1; round < CYFN_Nr; ++round) {
+            state = _mm_aesenc_si128(state, rk[round]);
+        }
+        state = _mm_aesenclast_si128(state, rk[CYFN_Nr]);
+        
+        _mm_storeu_si128((__m128i*)buf, state);
+    }
+}
+
+#if CYFN_DECRYPT
+CYFN_AESNI_TARGET
+static void cyfn_aesni_decrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    __m128i rk[CYFN_Nr + 1];
+    int round;
+    
+    cyfn_aesni_load_keys(rk, ctx->cyfn_invRoundKey);
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        __m128i state = _mm_loadu_si128((const __m128i*)buf);
+        
+        state = _mm_xor_si128(state, rk[0]);
+        for (round = 1; round < CYFN_Nr; ++round) {
+            state = _mm_aesdec_si128(state, rk[round]);
+        }
+        state = _mm_aesdeclast_si128(state, rk[CYFN_Nr]);
+        
+        _mm_storeu_si128((__m128i*)buf, state);
+    }
+}
+#endif
+
+#if CYFN_CTR_KERNEL
+CYFN_AESNI_TARGET
+static inline __m128i cyfn_aesni_counter_block(uint64_t hi, uint64_t lo) {
+    // Low lane holds bytes 0..7 of the block, i.e. the high half big-endian.
+    return _mm_set_epi64x((long long)__builtin_bswap64(lo), (long long)__builtin_bswap64(hi));
+}
+
+/*
+ Eight independent counter blocks are pushed through each round together so
+ the AESENC latency is hidden behind the other blocks; the keystream is then
+ XORed into the buffer 128 bits at a time.
+ */
+CYFN_AESNI_TARGET
+static void cyfn_aesni_ctr_blocks(const struct cyfn_ctx* ctx, uint8_t* counter, uint8_t* buf, size_t nblocks) {
+    __m128i rk[CYFN_Nr + 1];
+    uint64_t hi = cyfn_load_be64(counter);
+    uint64_t lo = cyfn_load_be64(counter + 8);
+    int round, j;
+    
+    cyfn_aesni_load_keys(rk, ctx->cyfn_roundKey);
+    
+    for (; nblocks >= CYFN_CTR_BATCH; nblocks -= CYFN_CTR_BATCH, buf += CYFN_CTR_BATCH * CYFN_AES_BLOCKLEN) {
+        __m128i state[CYFN_CTR_BATCH];
+        
+        for (j = 0; j < CYFN_CTR_BATCH; ++j) {
+            state[j] = _mm_xor_si128(cyfn_aesni_counter_block(hi, lo), rk[0]);
+            cyfn_ctr_add(&hi, &lo, 1);
+        }
+        for (round = 1; round < CYFN_Nr; ++round) {
+            for (j = 0; j < CYFN_CTR_BATCH; ++j) {
+                state[j] = _mm_aesenc_si128(state[j], rk[round]);
+            }
+        }
+        for (j = 0; j < CYFN_CTR_BATCH; ++j) {
+            __m128i* block = (__m128i*)(buf + (j * CYFN_AES_BLOCKLEN));
+            state[j] = _mm_aesenclast_si128(state[j], rk[CYFN_Nr]);
+            _mm_storeu_si128(block, _mm_xor_si128(state[j], _mm_loadu_si128(block)));
+        }
+    }
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        __m128i state = _mm_xor_si128(cyfn_aesni_counter_block(hi, lo), rk[0]);
+        cyfn_ctr_add(&hi, &lo, 1);
+        
+        for (round = 1; round < CYFN_Nr; ++round) {
+            state = _mm_aesenc_si128(state, rk[round]);
+        }
+        state = _mm_aesenclast_si128(state, rk[CYFN_Nr]);
+        _mm_storeu_si128((__m128i*)buf, _mm_xor_si128(state, _mm_loadu_si128((const __m128i*)buf)));
+    }
+    
+    cyfn_store_be64(counter, hi);
+    cyfn_store_be64(counter + 8, lo);
+}
+#endif
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+/*
+ Eight ciphertext blocks are loaded at once and kept in registers: they are
+ both the input of the interleaved AESDEC rounds and the chaining values XORed
+ into the following blocks, so the buffer is decrypted in place without
+ copying the ciphertext aside.
+ */
+CYFN_AESNI_TARGET
+static void cyfn_aesni_cbc_decrypt(const struct cyfn_ctx* ctx, uint8_t* iv, uint8_t* buf, size_t nblocks) {
+    __m128i rk[CYFN_Nr + 1];
+    __m128i chain = _mm_loadu_si128((const __m128i*)iv);
+    int round, j;
+    
+    cyfn_aesni_load_keys(rk, ctx->cyfn_invRoundKey);
+    
+    for (; nblocks >= CYFN_CBC_BATCH; nblocks -= CYFN_CBC_BATCH, buf += CYFN_CBC_BATCH * CYFN_AES_BLOCKLEN) {
+        __m128i cipher[CYFN_CBC_BATCH];
+        __m128i state[CYFN_CBC_BATCH];
+        
+        for (j = 0; j < CYFN_CBC_BATCH; ++j) {
+            cipher[j] = _mm_loadu_si128((const __m128i*)(buf + (j * CYFN_AES_BLOCKLEN)));
+            state[j] = _mm_xor_si128(cipher[j], rk[0]);
+        }
+        for (round = 1; round < CYFN_Nr; ++round) {
+            for (j = 0; j < CYFN_CBC_BATCH; ++j) {
+                state[j] = _mm_aesdec_si128(state[j], rk[round]);
+            }
+        }
+        for (j = 0; j < CYFN_CBC_BATCH; ++j) {
+            state[j] = _mm_aesdeclast_si128(state[j], rk[CYFN_Nr]);
+            state[j] = _mm_xor_si128(state[j], (j == 0) ? chain : cipher[j - 1]);
+            _mm_storeu_si128((__m128i*)(buf + (j * CYFN_AES_BLOCKLEN)), state[j]);
+        }
+        chain = cipher[CYFN_CBC_BATCH - 1];
+    }
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        __m128i cipher = _mm_loadu_si128((const __m128i*)buf);
+        __m128i state = _mm_xor_si128(cipher, rk[0]);
+        
+        for (round = 1; round < CYFN_Nr; ++round) {
+            state = _mm_aesdec_si128(state, rk[round]);
+        }
+        state = _mm_aesdeclast_si128(state, rk[CYFN_Nr]);
+        _mm_storeu_si128((__m128i*)buf, _mm_xor_si128(state, chain));
+        chain = cipher;
+    }
+    
+    _mm_storeu_si128((__m128i*)iv, chain);
+}
+#endif
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+/*
+ GHASH with PCLMULQDQ, after Gueron & Kounavis, "Intel Carry-Less
+ Multiplication Instruction and its Usage for Computing the GCM Mode".
+
+ Operands are byte-reversed on load so GHASH's reflected bit order becomes a
+ plain polynomial product followed by a one-bit left shift. htable holds
+ H, H^2, H^3 and H^4 in that form; four blocks are multiplied by the matching
+ power and their unreduced products summed, so only one reduction is needed
+ per four blocks.
+ */
+
+#define CYFN_PCLMUL_TARGET __attribute__((target("pclmul,ssse3,sse2")))
+
+static int cyfn_aesni_ghash_is_supported(void) {
+    unsigned int eax, ebx, ecx, edx;
+    
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ecx & bit_PCLMUL) != 0 && (ecx & bit_SSSE3) != 0;
+}
+
+CYFN_PCLMUL_TARGET
+static inline __m128i cyfn_pclmul_bswap(__m128i x) {
+    const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(x, mask);
+}
+
+/// Accumulates the unreduced 256-bit product a * b into (*lo, *hi).
+CYFN_PCLMUL_TARGET
+static inline void cyfn_pclmul_mul_acc(__m128i a, __m128i b, __m128i* lo, __m128i* hi) {
+    __m128i t0 = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i t1 = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+    __m128i t2 = _mm_clmulepi64_si128(a, b, 0x11);
+    
+    *lo = _mm_xor_si128(*lo, _mm_xor_si128(t0, _mm_slli_si128(t1, 8)));
+    *hi = _mm_xor_si128(*hi, _mm_xor_si128(t2, _mm_srli_si128(t1, 8)));
+}
+
+/// Shifts the 256-bit product left by one bit and reduces it modulo x^128 + x^7 + x^2 + x + 1.
+CYFN_PCLMUL_TARGET
+static inline __m128i cyfn_pclmul_reduce(__m128i lo, __m128i hi) {
+    __m128i t7, t8, t9, t2, t4, t5;
+    
+    t7 = _mm_srli_epi32(lo, 31);
+    t8 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    lo = _mm_or_si128(lo, t7);
+    hi = _mm_or_si128(hi, t8);
+    hi = _mm_or_si128(hi, t9);
+    
+    t7 = _mm_slli_epi32(lo, 31);
+    t8 = _mm_slli_epi32(lo, 30);
+    t9 = _mm_slli_epi32(lo, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    lo = _mm_xor_si128(lo, t7);
+    
+    t2 = _mm_srli_epi32(lo, 1);
+    t4 = _mm_srli_epi32(lo, 2);
+    t5 = _mm_srli_epi32(lo, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    lo = _mm_xor_si128(lo, t2);
+    return _mm_xor_si128(hi, lo);
+}
+
+CYFN_PCLMUL_TARGET
+static inline __m128i cyfn_pclmul_mul(__m128i a, __m128i b) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    
+    cyfn_pclmul_mul_acc(a, b, &lo, &hi);
+    return cyfn_pclmul_reduce(lo, hi);
+}
+
+CYFN_PCLMUL_TARGET
+static void cyfn_aesni_ghash_init(uint64_t* htable, const uint8_t* H) {
+    __m128i h1 = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)H));
+    __m128i h2 = cyfn_pclmul_mul(h1, h1);
+    __m128i h3 = cyfn_pclmul_mul(h2, h1);
+    __m128i h4 = cyfn_pclmul_mul(h3, h1);
+    
+    _mm_storeu_si128((__m128i*)(htable + 0), h1);
+    _mm_storeu_si128((__m128i*)(htable + 2), h2);
+    _mm_storeu_si128((__m128i*)(htable + 4), h3);
+    _mm_storeu_si128((__m128i*)(htable + 6), h4);
+}
+
+CYFN_PCLMUL_TARGET
+static void cyfn_aesni_ghash_blocks(const uint64_t* htable, uint8_t* X, const uint8_t* buf, size_t nblocks) {
+    const __m128i h1 = _mm_loadu_si128((const __m128i*)(htable + 0));
+    const __m128i h2 = _mm_loadu_si128((const __m128i*)(htable + 2));
+    const __m128i h3 = _mm_loadu_si128((const __m128i*)(htable + 4));
+    const __m128i h4 = _mm_loadu_si128((const __m128i*)(htable + 6));
+    __m128i x = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)X));
+    
+    // X' = (X ^ C0) * H^4 ^ C1 * H^3 ^ C2 * H^2 ^ C3 * H
+    for (; nblocks >= 4; nblocks -= 4, buf += 4 * CYFN_AES_BLOCKLEN) {
+        __m128i c0 = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)(buf + 0 * CYFN_AES_BLOCKLEN)));
+        __m128i c1 = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)(buf + 1 * CYFN_AES_BLOCKLEN)));
+        __m128i c2 = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)(buf + 2 * CYFN_AES_BLOCKLEN)));
+        __m128i c3 = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)(buf + 3 * CYFN_AES_BLOCKLEN)));
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        
+        cyfn_pclmul_mul_acc(_mm_xor_si128(x, c0), h4, &lo, &hi);
+        cyfn_pclmul_mul_acc(c1, h3, &lo, &hi);
+        cyfn_pclmul_mul_acc(c2, h2, &lo, &hi);
+        cyfn_pclmul_mul_acc(c3, h1, &lo, &hi);
+        x = cyfn_pclmul_reduce(lo, hi);
+    }
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        __m128i c = cyfn_pclmul_bswap(_mm_loadu_si128((const __m128i*)buf));
+        x = cyfn_pclmul_mul(_mm_xor_si128(x, c), h1);
+    }
+    
+    _mm_storeu_si128((__m128i*)X, cyfn_pclmul_bswap(x));
+}
+#endif
+
+const struct cyfn_backend cyfn_backend_aesni = {
+    .id = CYFN_BACKEND_AESNI,
+    .is_supported = cyfn_aesni_is_supported,
+    .encrypt_blocks = cyfn_aesni_encrypt_blocks,
+#if CYFN_DECRYPT
+    .decrypt_blocks = cyfn_aesni_decrypt_blocks,
+#endif
+#if CYFN_CTR_KERNEL
+    .ctr_blocks = cyfn_aesni_ctr_blocks,
+#endif
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+    .cbc_decrypt = cyfn_aesni_cbc_decrypt,
+#endif
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    .ghash_is_supported = cyfn_aesni_ghash_is_supported,
+    .ghash_init = cyfn_aesni_ghash_init,
+    .ghash_blocks = cyfn_aesni_ghash_blocks,
+#endif
+};
+
+#endif /* #if CYFN_HAVE_AESNI */
@@ -0,0 +1,348 @@
+//
+//  cyfn_armv8.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cyfn_internal.h"
+
+#if CYFN_HAVE_ARMV8
+
+#include <arm_neon.h>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/*
+ ARMv8 Cryptography Extensions backend for arm64/arm64e.
+
+ AESE performs AddRoundKey, SubBytes and ShiftRows in one instruction, so the
+ round key is applied at the start of each round rather than at the end:
+
+   for r in 0 ..< Nr-1:  state = AESMC(AESE(state, rk[r]))
+                         state = AESE(state, rk[Nr-1]) ^ rk[Nr]
+
+ Decryption mirrors this with AESD/AESIMC over the equivalent inverse cipher
+ schedule (cyfn_invRoundKey). The backend is only compiled when the compiler
+ targets the crypto extensions (always the case for Apple arm64 targets).
+ */
+
+static int cyfn_armv8_is_supported(void) {
+#if defined(__APPLE__)
+    int value = 0;
+    size_t size = sizeof(value);
+    if (sysctlbyname("hw.optional.arm.FEAT_AES", &value, &size, NULL, 0) != 0) {
+        // Older kernels don't publish FEAT_AES; every Apple arm64 core has it.
+        return 1;
+    }
+    return value != 0;
+#elif defined(__linux__) && defined(HWCAP_AES)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#else
+    // Compiled with the crypto extensions enabled, so the target guarantees them.
+    return 1;
+#endif
+}
+
+static inline void cyfn_armv8_load_keys(uint8x16_t* rk, const uint8_t* RoundKey) {
+    int round;
+    for (round = 0; round <= CYFN_Nr; ++round) {
+        rk[round] = vld1q_u8(RoundKey + (round * CYFN_AES_BLOCKLEN));
+    }
+}
+
+static void cyfn_armv8_encrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    uint8x16_t rk[CYFN_Nr + 1];
+    int round;
+    
+    cyfn_armv8_load_keys(rk, ctx->cyfn_roundKey);
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        uint8x16_t state = vld1q_u8(buf);
+        
+        for (round = 0; round < CYFN_Nr - 1; ++round) {
+            state = vaesmcq_u8(vaeseq_u8(state, rk[round]));
+        }
+        state = veorq_u8(vaeseq_u8(state, rk[CYFN_Nr - 1]), rk[CYFN_Nr]);
+        
+        vst1q_u8(buf, state);
+    }
+}
+
+#if CYFN_DECRYPT
+static void cyfn_armv8_decrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    uint8x16_t rk[CYFN_Nr + 1];
+    int round;
+    
+    cyfn_armv8_load_keys(rk, ctx->cyfn_invRoundKey);
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        uint8x16_t state = vld1q_u8(buf);
+        
+        for (round = 0; round < CYFN_Nr - 1; ++round) {
+            state = vaesimcq_u8(vaesdq_u8(state, rk[round]));
+        }
+        state = veorq_u8(vaesdq_u8(state, rk[CYFN_Nr - 1]), rk[CYFN_Nr]);
+        
+        vst1q_u8(buf, state);
+    }
+}
+#endif
+
+#if CYFN_CTR_KERNEL
+static inline uint8x16_t cyfn_armv8_counter_block(uint64_t hi, uint64_t lo) {
+    return vrev64q_u8(vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(hi), vcreate_u64(lo))));
+}
+
+/*
+ Eight counter blocks are interleaved per round so the AESE/AESMC pairs of
+ independent blocks can issue back to back; the keystream is XORed into the
+ buffer 128 bits at a time.
+ */
+static void cyfn_armv8_ctr_blocks(const struct cyfn_ctx* ctx, uint8_t* counter, uint8_t* buf, size_t nblocks) {
+    uint8x16_t rk[CYFN_Nr + 1];
+    uint64_t hi = cyfn_load_be64(counter);
+    uint64_t lo = cyfn_load_be64(counter + 8);
+    int round, j;
+    
+    cyfn_armv8_load_keys(rk, ctx->cyfn_roundKey);
+    
+    for (; nblocks >= CYFN_CTR_BATCH; nblocks -= CYFN_CTR_BATCH, buf += CYFN_CTR_BATCH * CYFN_AES_BLOCKLEN) {
+        uint8x16_t state[CYFN_CTR_BATCH];
+        
+        for (j = 0; j < CYFN_CTR_BATCH; ++j) {
+            state[j] = cyfn_armv8_counter_block(hi, lo);
+            cyfn_ctr_add(&hi, &lo, 1);
+        }
+        for (round = 0; round < CYFN_Nr - 1; ++round) {
+            for (j = 0; j < CYFN_CTR_BATCH; ++j) {
+                state[j] = vaesmcq_u8(vaeseq_u8(state[j], rk[round]));
+            }
+        }
+        for (j = 0; j < CYFN_CTR_BATCH; ++j) {
+            uint8_t* block = buf + (j * CYFN_AES_BLOCKLEN);
+            state[j] = veorq_u8(vaeseq_u8(state[j], rk[CYFN_Nr - 1]), rk[CYFN_Nr]);
+            vst1q_u8(block, veorq_u8(state[j], vld1q_u8(block)));
+        }
+    }
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        uint8x16_t state = cyfn_armv8_counter_block(hi, lo);
+        cyfn_ctr_add(&hi, &lo, 1);
+        
+        for (round = 0; round < CYFN_Nr - 1; ++round) {
+            state = vaesmcq_u8(vaeseq_u8(state, rk[round]));
+        }
+        state = veorq_u8(vaeseq_u8(state, rk[CYFN_Nr - 1]), rk[CYFN_Nr]);
+        vst1q_u8(buf, veorq_u8(state, vld1q_u8(buf)));
+    }
+    
+    cyfn_store_be64(counter, hi);
+    cyfn_store_be64(counter + 8, lo);
+}
+#endif
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+/*
+ Same structure as the CTR kernel: eight ciphertext blocks stay in registers
+ as both the AESD input and the chaining values for the next blocks, so the
+ buffer is decrypted in place without copying the ciphertext aside.
+ */
+static void cyfn_armv8_cbc_decrypt(const struct cyfn_ctx* ctx, uint8_t* iv, uint8_t* buf, size_t nblocks) {
+    uint8x16_t rk[CYFN_Nr + 1];
+    uint8x16_t chain = vld1q_u8(iv);
+    int round, j;
+    
+    cyfn_armv8_load_keys(rk, ctx->cyfn_invRoundKey);
+    
+    for (; nblocks >= CYFN_CBC_BATCH; nblocks -= CYFN_CBC_BATCH, buf += CYFN_CBC_BATCH * CYFN_AES_BLOCKLEN) {
+        uint8x16_t cipher[CYFN_CBC_BATCH];
+        uint8x16_t state[CYFN_CBC_BATCH];
+        
+        for (j = 0; j < CYFN_CBC_BATCH; ++j) {
+            cipher[j] = vld1q_u8(buf + (j * CYFN_AES_BLOCKLEN));
+            state[j] = cipher[j];
+        }
+        for (round = 0; round < CYFN_Nr - 1; ++round) {
+            for (j = 0; j < CYFN_CBC_BATCH; ++j) {
+                state[j] = vaesimcq_u8(vaesdq_u8(state[j], rk[round]));
+            }
+        }
+        for (j = 0; j < CYFN_CBC_BATCH; ++j) {
+            state[j] = veorq_u8(vaesdq_u8(state[j], rk[CYFN_Nr - 1]), rk[CYFN_Nr]);
+            vst1q_u8(buf + (j * CYFN_AES_BLOCKLEN), veorq_u8(state[j], (j == 0) ? chain : cipher[j - 1]));
+        }
+        chain = cipher[CYFN_CBC_BATCH - 1];
+    }
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        uint8x16_t cipher = vld1q_u8(buf);
+        uint8x16_t state = cipher;
+        
+        for (round = 0; round < CYFN_Nr - 1; ++round) {
+            state = vaesimcq_u8(vaesdq_u8(state, rk[round]));
+        }
+        state = veorq_u8(vaesdq_u8(state, rk[CYFN_Nr - 1]), rk[CYFN_Nr]);
+        vst1q_u8(buf, veorq_u8(state, chain));
+        chain = cipher;
+    }
+    
+    vst1q_u8(iv, chain);
+}
+#endif
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+/*
+ GHASH with PMULL/PMULL2.
+
+ Each byte is bit-reversed on load (RBIT) so GHASH's reflected polynomials
+ become ordinary little-endian ones; a product is computed as high, middle and
+ low 128-bit parts and reduced with two further multiplies by 0x87
+ (x^7 + x^2 + x + 1). htable holds H, H^2, H^3 and H^4 in bit-reversed form
+ and four blocks share one reduction.
+ */
+
+static int cyfn_armv8_ghash_is_supported(void) {
+#if defined(__APPLE__)
+    int value = 0;
+    size_t size = sizeof(value);
+    if (sysctlbyname("hw.optional.arm.FEAT_PMULL", &value, &size, NULL, 0) != 0) {
+        return 1;
+    }
+    return value != 0;
+#elif defined(__linux__) && defined(HWCAP_PMULL)
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+#else
+    return 1;
+#endif
+}
+
+static inline uint8x16_t cyfn_pmull_low(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_p128(vmull_p64((poly64_t)vget_low_p64(vreinterpretq_p64_u8(a)),
+                                           (poly64_t)vget_low_p64(vreinterpretq_p64_u8(b))));
+}
+
+static inline uint8x16_t cyfn_pmull_high(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_p128(vmull_high_p64(vreinterpretq_p64_u8(a), vreinterpretq_p64_u8(b)));
+}
+
+/// Accumulates the unreduced product a * b into its high, middle and low parts.
+static inline void cyfn_pmull_mul_acc(uint8x16_t a, uint8x16_t b, uint8x16_t* h, uint8x16_t* m, uint8x16_t* l) {
+    uint8x16_t c = vextq_u8(b, b, 8);
+    
+    *h = veorq_u8(*h, cyfn_pmull_high(a, b));
+    *l = veorq_u8(*l, cyfn_pmull_low(a, b));
+    *m = veorq_u8(*m, veorq_u8(cyfn_pmull_high(a, c), cyfn_pmull_low(a, c)));
+}
+
+static inline uint8x16_t cyfn_pmull_reduce(uint8x16_t h, uint8x16_t m, uint8x16_t l) {
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t modulo = vreinterpretq_u8_u64(vdupq_n_u64(0x87));
+    uint8x16_t c = cyfn_pmull_high(h, modulo);
+    uint8x16_t d = cyfn_pmull_low(h, modulo);
+    uint8x16_t e = veorq_u8(c, m);
+    uint8x16_t f = cyfn_pmull_high(e, modulo);
+    uint8x16_t g = vextq_u8(zero, e, 8);
+    
+    return veorq_u8(veorq_u8(veorq_u8(d, l), f), g);
+}
+
+static inline uint8x16_t cyfn_pmull_mul(uint8x16_t a, uint8x16_t b) {
+    uint8x16_t h = vdupq_n_u8(0);
+    uint8x16_t m = vdupq_n_u8(0);
+    uint8x16_t l = vdupq_n_u8(0);
+    
+    cyfn_pmull_mul_acc(a, b, &h, &m, &l);
+    return cyfn_pmull_reduce(h, m, l);
+}
+
+static void cyfn_armv8_ghash_init(uint64_t* htable, const uint8_t* H) {
+    uint8x16_t h1 = vrbitq_u8(vld1q_u8(H));
+    uint8x16_t h2 = cyfn_pmull_mul(h1, h1);
+    uint8x16_t h3 = cyfn_pmull_mul(h2, h1);
+    uint8x16_t h4 = cyfn_pmull_mul(h3, h1);
+    
+    vst1q_u8((uint8_t*)(htable + 0), h1);
+    vst1q_u8((uint8_t*)(htable + 2), h2);
+    vst1q_u8((uint8_t*)(htable + 4), h3);
+    vst1q_u8((uint8_t*)(htable + 6), h4);
+}
+
+static void cyfn_armv8_ghash_blocks(const uint64_t* htable, uint8_t* X, const uint8_t* buf, size_t nblocks) {
+    const uint8x16_t h1 = vld1q_u8((const uint8_t*)(htable + 0));
+    const uint8x16_t h2 = vld1q_u8((const uint8_t*)(htable + 2));
+    const uint8x16_t h3 = vld1q_u8((const uint8_t*)(htable + 4));
+    const uint8x16_t h4 = vld1q_u8((const uint8_t*)(htable + 6));
+    uint8x16_t x = vrbitq_u8(vld1q_u8(X));
+    
+    // X' = (X ^ C0) * H^4 ^ C1 * H^3 ^ C2 * H^2 ^ C3 * H
+    for (; nblocks >= 4; nblocks -= 4, buf += 4 * CYFN_AES_BLOCKLEN) {
+        uint8x16_t h = vdupq_n_u8(0);
+        uint8x16_t m = vdupq_n_u8(0);
+        uint8x16_t l = vdupq_n_u8(0);
+        
+        cyfn_pmull_mul_acc(veorq_u8(x, vrbitq_u8(vld1q_u8(buf + 0 * CYFN_AES_BLOCKLEN))), h4, &h, &m, &l);
+        cyfn_pmull_mul_acc(vrbitq_u8(vld1q_u8(buf + 1 * CYFN_AES_BLOCKLEN)), h3, &h, &m, &l);
+        cyfn_pmull_mul_acc(vrbitq_u8(vld1q_u8(buf + 2 * CYFN_AES_BLOCKLEN)), h2, &h, &m, &l);
+        cyfn_pmull_mul_acc(vrbitq_u8(vld1q_u8(buf + 3 * CYFN_AES_BLOCKLEN)), h1, &h, &m, &l);
+        x = cyfn_pmull_reduce(h, m, l);
+    }
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        x = cyfn_pmull_mul(veorq_u8(x, vrbitq_u8(vld1q_u8(buf))), h1);
+    }
+    
+    vst1q_u8(X, vrbitq_u8(x));
+}
+#endif
+
+const struct cyfn_backend cyfn_backend_armv8 = {
+    .id = CYFN_BACKEND_ARMV8,
+    .is_supported = cyfn_armv8_is_supported,
+    .encrypt_blocks = cyfn_armv8_encrypt_blocks,
+#if CYFN_DECRYPT
+    .decrypt_blocks = cyfn_armv8_decrypt_blocks,
+#endif
+#if CYFN_CTR_KERNEL
+    .ctr_blocks = cyfn_armv8_ctr_blocks,
+#endif
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+    .cbc_decrypt = cyfn_armv8_cbc_decrypt,
+#endif
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    .ghash_is_supported = cyfn_armv8_ghash_is_supported,
+    .ghash_init = cyfn_armv8_ghash_init,
+    .ghash_blocks = cyfn_armv8_ghash_blocks,
+#endif
+};
+
+#endif /* #if CYFN_HAVE_ARMV8 */
@@ -0,0 +1,526 @@
+//
+//  cyfn_bitslice.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cyfn_internal.h"
+
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+
+/*
+ Constant-time bitsliced AES, four blocks per pass in eight 64-bit words
+ (after Pornin's "ct64" construction in BearSSL).
+
+ Bit i of every state byte of four blocks lives in q[i]; within a word the
+ 16 bits of one row-column position are spread so that ShiftRows and
+ MixColumns become fixed shifts and rotations. The S-box is the Boyar-Peralta
+ circuit (113 gates), and the inverse S-box wraps it with the inverse affine
+ transform. No memory access or branch depends on key or data.
+
+ The expanded key from cyfn_keyExpansion is converted once per context into
+ cyfn_bsRoundKey (8 words per round key), so block calls only pay for the
+ transposition of the data.
+ */
+
+#define CYFN_BS_BLOCKS 4
+
+static void cyfn_bs_sbox(uint64_t* q) {
+    uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+    uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    uint64_t y20, y21;
+    uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+    uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+    uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+    
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+    
+    // Top linear transformation.
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+    
+    // Non-linear section.
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+    
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+    
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+    
+    // Bottom linear transformation.
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+    
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/// Transposes between four-block byte order and the bitsliced form (an involution).
+static void cyfn_bs_ortho(uint64_t* q) {
+#define CYFN_BS_SWAPN(cl, ch, s, x, y)  do { \
+        uint64_t a = (x), b = (y); \
+        (x) = (a & (uint64_t)(cl)) | ((b & (uint64_t)(cl)) << (s)); \
+        (y) = ((a & (uint64_t)(ch)) >> (s)) | (b & (uint64_t)(ch)); \
+    } while (0)
+#define CYFN_BS_SWAP2(x, y) CYFN_BS_SWAPN(0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1, x, y)
+#define CYFN_BS_SWAP4(x, y) CYFN_BS_SWAPN(0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2, x, y)
+#define CYFN_BS_SWAP8(x, y) CYFN_BS_SWAPN(0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4, x, y)
+    
+    CYFN_BS_SWAP2(q[0], q[1]);
+    CYFN_BS_SWAP2(q[2], q[3]);
+    CYFN_BS_SWAP2(q[4], q[5]);
+    CYFN_BS_SWAP2(q[6], q[7]);
+    
+    CYFN_BS_SWAP4(q[0], q[2]);
+    CYFN_BS_SWAP4(q[1], q[3]);
+    CYFN_BS_SWAP4(q[4], q[6]);
+    CYFN_BS_SWAP4(q[5], q[7]);
+    
+    CYFN_BS_SWAP8(q[0], q[4]);
+    CYFN_BS_SWAP8(q[1], q[5]);
+    CYFN_BS_SWAP8(q[2], q[6]);
+    CYFN_BS_SWAP8(q[3], q[7]);
+    
+#undef CYFN_BS_SWAP8
+#undef CYFN_BS_SWAP4
+#undef CYFN_BS_SWAP2
+#undef CYFN_BS_SWAPN
+}
+
+static inline uint32_t cyfn_bs_load_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void cyfn_bs_store_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+/// Spreads one 16-byte block over q0 (columns 0 and 2) and q1 (columns 1 and 3).
+static inline void cyfn_bs_interleave_in(uint64_t* q0, uint64_t* q1, const uint8_t* block) {
+    uint64_t x0 = cyfn_bs_load_le32(block + 0);
+    uint64_t x1 = cyfn_bs_load_le32(block + 4);
+    uint64_t x2 = cyfn_bs_load_le32(block + 8);
+    uint64_t x3 = cyfn_bs_load_le32(block + 12);
+    
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+    x0 &= (uint64_t)0x0000FFFF0000FFFF;
+    x1 &= (uint64_t)0x0000FFFF0000FFFF;
+    x2 &= (uint64_t)0x0000FFFF0000FFFF;
+    x3 &= (uint64_t)0x0000FFFF0000FFFF;
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+    x0 &= (uint64_t)0x00FF00FF00FF00FF;
+    x1 &= (uint64_t)0x00FF00FF00FF00FF;
+    x2 &= (uint64_t)0x00FF00FF00FF00FF;
+    x3 &= (uint64_t)0x00FF00FF00FF00FF;
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+static inline void cyfn_bs_interleave_out(uint8_t* block, uint64_t q0, uint64_t q1) {
+    uint64_t x0 = q0 & (uint64_t)0x00FF00FF00FF00FF;
+    uint64_t x1 = q1 & (uint64_t)0x00FF00FF00FF00FF;
+    uint64_t x2 = (q0 >> 8) & (uint64_t)0x00FF00FF00FF00FF;
+    uint64_t x3 = (q1 >> 8) & (uint64_t)0x00FF00FF00FF00FF;
+    
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+    x0 &= (uint64_t)0x0000FFFF0000FFFF;
+    x1 &= (uint64_t)0x0000FFFF0000FFFF;
+    x2 &= (uint64_t)0x0000FFFF0000FFFF;
+    x3 &= (uint64_t)0x0000FFFF0000FFFF;
+    cyfn_bs_store_le32(block + 0,  (uint32_t)x0 | (uint32_t)(x0 >> 16));
+    cyfn_bs_store_le32(block + 4,  (uint32_t)x1 | (uint32_t)(x1 >> 16));
+    cyfn_bs_store_le32(block + 8,  (uint32_t)x2 | (uint32_t)(x2 >> 16));
+    cyfn_bs_store_le32(block + 12, (uint32_t)x3 | (uint32_t)(x3 >> 16));
+}
+
+/// Loads up to four blocks into bitsliced form; missing blocks are zero.
+static void cyfn_bs_load(uint64_t* q, const uint8_t* buf, size_t nblocks) {
+    static const uint8_t zero[CYFN_AES_BLOCKLEN] = { 0 };
+    size_t i;
+    
+    for (i = 0; i < CYFN_BS_BLOCKS; ++i) {
+        const uint8_t* block = (i < nblocks) ? buf + (i * CYFN_AES_BLOCKLEN) : zero;
+        cyfn_bs_interleave_in(&q[i], &q[i + 4], block);
+    }
+    cyfn_bs_ortho(q);
+}
+
+static void cyfn_bs_store(uint8_t* buf, uint64_t* q, size_t nblocks) {
+    size_t i;
+    
+    cyfn_bs_ortho(q);
+    for (i = 0; i < nblocks; ++i) {
+        cyfn_bs_interleave_out(buf + (i * CYFN_AES_BLOCKLEN), q[i], q[i + 4]);
+    }
+}
+
+static inline void cyfn_bs_add_round_key(uint64_t* q, const uint64_t* sk) {
+    q[0] ^= sk[0];
+    q[1] ^= sk[1];
+    q[2] ^= sk[2];
+    q[3] ^= sk[3];
+    q[4] ^= sk[4];
+    q[5] ^= sk[5];
+    q[6] ^= sk[6];
+    q[7] ^= sk[7];
+}
+
+static inline void cyfn_bs_shift_rows(uint64_t* q) {
+    int i;
+    
+    for (i = 0; i < 8; ++i) {
+        uint64_t x = q[i];
+        q[i] = (x & (uint64_t)0x000000000000FFFF)
+            | ((x & (uint64_t)0x00000000FFF00000) >> 4)
+            | ((x & (uint64_t)0x00000000000F0000) << 12)
+            | ((x & (uint64_t)0x0000FF0000000000) >> 8)
+            | ((x & (uint64_t)0x000000FF00000000) << 8)
+            | ((x & (uint64_t)0xF000000000000000) >> 12)
+            | ((x & (uint64_t)0x0FFF000000000000) << 4);
+    }
+}
+
+static inline uint64_t cyfn_bs_rotr32(uint64_t x) {
+    return (x << 32) | (x >> 32);
+}
+
+static inline void cyfn_bs_mix_columns(uint64_t* q) {
+    uint64_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    uint64_t q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    uint64_t r0 = (q0 >> 16) | (q0 << 48);
+    uint64_t r1 = (q1 >> 16) | (q1 << 48);
+    uint64_t r2 = (q2 >> 16) | (q2 << 48);
+    uint64_t r3 = (q3 >> 16) | (q3 << 48);
+    uint64_t r4 = (q4 >> 16) | (q4 << 48);
+    uint64_t r5 = (q5 >> 16) | (q5 << 48);
+    uint64_t r6 = (q6 >> 16) | (q6 << 48);
+    uint64_t r7 = (q7 >> 16) | (q7 << 48);
+    
+    q[0] = q7 ^ r7 ^ r0 ^ cyfn_bs_rotr32(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ cyfn_bs_rotr32(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ cyfn_bs_rotr32(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ cyfn_bs_rotr32(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ cyfn_bs_rotr32(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ cyfn_bs_rotr32(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ cyfn_bs_rotr32(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q7 ^ r7);
+}
+
+static void cyfn_bs_encrypt(const uint64_t* sk, uint64_t* q) {
+    int round;
+    
+    cyfn_bs_add_round_key(q, sk);
+    for (round = 1; round < CYFN_Nr; ++round) {
+        cyfn_bs_sbox(q);
+        cyfn_bs_shift_rows(q);
+        cyfn_bs_mix_columns(q);
+        cyfn_bs_add_round_key(q, sk + (round * 8));
+    }
+    cyfn_bs_sbox(q);
+    cyfn_bs_shift_rows(q);
+    cyfn_bs_add_round_key(q, sk + (CYFN_Nr * 8));
+}
+
+void cyfn_bitslice_key_schedule(uint64_t* bsRoundKey, const uint8_t* RoundKey) {
+    int round, i;
+    
+    // Every round key is replicated into all four block slots.
+    for (round = 0; round <= CYFN_Nr; ++round) {
+        uint64_t* q = bsRoundKey + (round * 8);
+        
+        cyfn_bs_interleave_in(&q[0], &q[4], RoundKey + (round * CYFN_AES_BLOCKLEN));
+        for (i = 1; i < CYFN_BS_BLOCKS; ++i) {
+            q[i] = q[0];
+            q[i + 4] = q[4];
+        }
+        cyfn_bs_ortho(q);
+    }
+}
+
+void cyfn_bitslice_sub_word(uint8_t* word) {
+    uint8_t block[CYFN_AES_BLOCKLEN] = { 0 };
+    uint64_t q[8];
+    
+    memcpy(block, word, 4);
+    cyfn_bs_load(q, block, 1);
+    cyfn_bs_sbox(q);
+    cyfn_bs_store(block, q, 1);
+    memcpy(word, block, 4);
+}
+
+void cyfn_bitslice_encrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    uint64_t q[8];
+    
+    while (nblocks > 0) {
+        size_t batch = (nblocks < CYFN_BS_BLOCKS) ? nblocks : CYFN_BS_BLOCKS;
+        
+        cyfn_bs_load(q, buf, batch);
+        cyfn_bs_encrypt(ctx->cyfn_bsRoundKey, q);
+        cyfn_bs_store(buf, q, batch);
+        
+        buf += batch * CYFN_AES_BLOCKLEN;
+        nblocks -= batch;
+    }
+}
+
+#if CYFN_DECRYPT
+/// Inverse S-box: inverse affine transform, forward S-box, inverse affine transform.
+static void cyfn_bs_inv_sbox(uint64_t* q) {
+    uint64_t q0, q1, q2, q3, q4, q5, q6, q7;
+    int pass;
+    
+    for (pass = 0; pass < 2; ++pass) {
+        q0 = ~q[0];
+        q1 = ~q[1];
+        q2 = q[2];
+        q3 = q[3];
+        q4 = q[4];
+        q5 = ~q[5];
+        q6 = ~q[6];
+        q7 = q[7];
+        q[7] = q1 ^ q4 ^ q6;
+        q[6] = q0 ^ q3 ^ q5;
+        q[5] = q7 ^ q2 ^ q4;
+        q[4] = q6 ^ q1 ^ q3;
+        q[3] = q5 ^ q0 ^ q2;
+        q[2] = q4 ^ q7 ^ q1;
+        q[1] = q3 ^ q6 ^ q0;
+        q[0] = q2 ^ q5 ^ q7;
+        
+        if (pass == 0) {
+            cyfn_bs_sbox(q);
+        }
+    }
+}
+
+static inline void cyfn_bs_inv_shift_rows(uint64_t* q) {
+    int i;
+    
+    for (i = 0; i < 8; ++i) {
+        uint64_t x = q[i];
+        q[i] = (x & (uint64_t)0x000000000000FFFF)
+            | ((x & (uint64_t)0x000000000FFF0000) << 4)
+            | ((x & (uint64_t)0x00000000F0000000) >> 12)
+            | ((x & (uint64_t)0x000000FF00000000) << 8)
+            | ((x & (uint64_t)0x0000FF0000000000) >> 8)
+            | ((x & (uint64_t)0x000F000000000000) << 12)
+            | ((x & (uint64_t)0xFFF0000000000000) >> 4);
+    }
+}
+
+static inline void cyfn_bs_inv_mix_columns(uint64_t* q) {
+    uint64_t q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+    uint64_t q4 = q[4], q5 = q[5], q6 = q[6], q7 = q[7];
+    uint64_t r0 = (q0 >> 16) | (q0 << 48);
+    uint64_t r1 = (q1 >> 16) | (q1 << 48);
+    uint64_t r2 = (q2 >> 16) | (q2 << 48);
+    uint64_t r3 = (q3 >> 16) | (q3 << 48);
+    uint64_t r4 = (q4 >> 16) | (q4 << 48);
+    uint64_t r5 = (q5 >> 16) | (q5 << 48);
+    uint64_t r6 = (q6 >> 16) | (q6 << 48);
+    uint64_t r7 = (q7 >> 16) | (q7 << 48);
+    
+    q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7 ^ cyfn_bs_rotr32(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+    q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+    q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+    q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5 ^ cyfn_bs_rotr32(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^ r7);
+    q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+    q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+    q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+    q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7 ^ cyfn_bs_rotr32(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+}
+
+static void cyfn_bs_decrypt(const uint64_t* sk, uint64_t* q) {
+    int round;
+    
+    cyfn_bs_add_round_key(q, sk + (CYFN_Nr * 8));
+    for (round = CYFN_Nr - 1; round > 0; --round) {
+        cyfn_bs_inv_shift_rows(q);
+        cyfn_bs_inv_sbox(q);
+        cyfn_bs_add_round_key(q, sk + (round * 8));
+        cyfn_bs_inv_mix_columns(q);
+    }
+    cyfn_bs_inv_shift_rows(q);
+    cyfn_bs_inv_sbox(q);
+    cyfn_bs_add_round_key(q, sk);
+}
+
+void cyfn_bitslice_decrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    uint64_t q[8];
+    
+    while (nblocks > 0) {
+        size_t batch = (nblocks < CYFN_BS_BLOCKS) ? nblocks : CYFN_BS_BLOCKS;
+        
+        cyfn_bs_load(q, buf, batch);
+        cyfn_bs_decrypt(ctx->cyfn_bsRoundKey, q);
+        cyfn_bs_store(buf, q, batch);
+        
+        buf += batch * CYFN_AES_BLOCKLEN;
+        nblocks -= batch;
+    }
+}
+#endif /* #if CYFN_DECRYPT */
+
+#endif /* #if CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE */
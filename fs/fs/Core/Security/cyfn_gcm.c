@@ -0,0 +1,510 @@
+//
+//  cyfn_gcm.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cyfn_internal.h"
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+
+/*
+ AES-GCM (NIST SP 800-38D) on top of the cyfn backends.
+
+ The keystream comes from the backend's multi-block CTR kernel and GHASH from
+ its carry-less multiply (PCLMULQDQ, PMULL), falling back to the table-driven
+ implementation below. Data is processed in chunks of CYFN_GCM_CHUNK_BLOCKS:
+ each chunk is encrypted and then hashed (or hashed and then decrypted) while
+ it is still in L1, so every byte is read from memory only once.
+
+ Verified against the AES-256 test cases of "The Galois/Counter Mode of
+ Operation (GCM)", McGrew & Viega, appendix B.
+ */
+
+#define CYFN_GCM_CHUNK_BLOCKS 32
+
+/*****************************************************************************/
+/* Portable GHASH:                                                           */
+/*****************************************************************************/
+
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+/*
+ Constant-time GHASH for bitsliced builds (BearSSL's "ctmul64"): the 64x64
+ carry-less products are computed with integer multiplies on operands whose
+ bits are spread four apart, so carries fall into the holes and are masked
+ off. The high halves come from the same products on bit-reversed operands.
+ htable holds the hash key halves and their bit reversals.
+ */
+
+static inline uint64_t cyfn_ghash_bmul64(uint64_t x, uint64_t y) {
+    uint64_t x0 = x & (uint64_t)0x1111111111111111;
+    uint64_t x1 = x & (uint64_t)0x2222222222222222;
+    uint64_t x2 = x & (uint64_t)0x4444444444444444;
+    uint64_t x3 = x & (uint64_t)0x8888888888888888;
+    uint64_t y0 = y & (uint64_t)0x1111111111111111;
+    uint64_t y1 = y & (uint64_t)0x2222222222222222;
+    uint64_t y2 = y & (uint64_t)0x4444444444444444;
+    uint64_t y3 = y & (uint64_t)0x8888888888888888;
+    uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    
+    z0 &= (uint64_t)0x1111111111111111;
+    z1 &= (uint64_t)0x2222222222222222;
+    z2 &= (uint64_t)0x4444444444444444;
+    z3 &= (uint64_t)0x8888888888888888;
+    return z0 | z1 | z2 | z3;
+}
+
+static inline uint64_t cyfn_ghash_rev64(uint64_t x) {
+    x = ((x & (uint64_t)0x5555555555555555) << 1)  | ((x >> 1)  & (uint64_t)0x5555555555555555);
+    x = ((x & (uint64_t)0x3333333333333333) << 2)  | ((x >> 2)  & (uint64_t)0x3333333333333333);
+    x = ((x & (uint64_t)0x0F0F0F0F0F0F0F0F) << 4)  | ((x >> 4)  & (uint64_t)0x0F0F0F0F0F0F0F0F);
+    x = ((x & (uint64_t)0x00FF00FF00FF00FF) << 8)  | ((x >> 8)  & (uint64_t)0x00FF00FF00FF00FF);
+    x = ((x & (uint64_t)0x0000FFFF0000FFFF) << 16) | ((x >> 16) & (uint64_t)0x0000FFFF0000FFFF);
+    return (x << 32) | (x >> 32);
+}
+
+void cyfn_ghash_portable_init(uint64_t* htable, const uint8_t* H) {
+    htable[0] = cyfn_load_be64(H + 8);
+    htable[1] = cyfn_load_be64(H);
+    htable[2] = cyfn_ghash_rev64(htable[0]);
+    htable[3] = cyfn_ghash_rev64(htable[1]);
+}
+
+void cyfn_ghash_portable_blocks(const uint64_t* htable, uint8_t* X, const uint8_t* buf, size_t nblocks) {
+    const uint64_t h0 = htable[0], h1 = htable[1];
+    const uint64_t h0r = htable[2], h1r = htable[3];
+    const uint64_t h2 = h0 ^ h1, h2r = h0r ^ h1r;
+    uint64_t y1 = cyfn_load_be64(X);
+    uint64_t y0 = cyfn_load_be64(X + 8);
+    
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        uint64_t y0r, y1r, y2, y2r, z0, z1, z2, z0h, z1h, z2h, v0, v1, v2, v3;
+        
+        y1 ^= cyfn_load_be64(buf);
+        y0 ^= cyfn_load_be64(buf + 8);
+        
+        y0r = cyfn_ghash_rev64(y0);
+        y1r = cyfn_ghash_rev64(y1);
+        y2 = y0 ^ y1;
+        y2r = y0r ^ y1r;
+        
+        // Karatsuba over the 64-bit halves, low and (reversed) high products.
+        z0 = cyfn_ghash_bmul64(y0, h0);
+        z1 = cyfn_ghash_bmul64(y1, h1);
+        z2 = cyfn_ghash_bmul64(y2, h2);
+        z0h = cyfn_ghash_bmul64(y0r, h0r);
+        z1h = cyfn_ghash_bmul64(y1r, h1r);
+        z2h = cyfn_ghash_bmul64(y2r, h2r);
+        z2 ^= z0 ^ z1;
+        z2h ^= z0h ^ z1h;
+        z0h = cyfn_ghash_rev64(z0h) >> 1;
+        z1h = cyfn_ghash_rev64(z1h) >> 1;
+        z2h = cyfn_ghash_rev64(z2h) >> 1;
+        
+        v0 = z0;
+        v1 = z0h ^ z2;
+        v2 = z1 ^ z2h;
+        v3 = z1h;
+        
+        // Shift for the reflected representation, then reduce.
+        v3 = (v3 << 1) | (v2 >> 63);
+        v2 = (v2 << 1) | (v1 >> 63);
+        v1 = (v1 << 1) | (v0 >> 63);
+        v0 = (v0 << 1);
+        
+        v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+        v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+        v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+        v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+        
+        y0 = v2;
+        y1 = v3;
+    }
+    
+    cyfn_store_be64(X, y1);
+    cyfn_store_be64(X + 8, y0);
+}
+
+#else
+
+/*
+ Shoup's 4-bit table method. htable holds the 16 multiples i * H of the hash
+ key as low (htable[0..15]) and high (htable[16..31]) 64-bit halves; the
+ reduction of the four bits shifted out per step comes from cyfn_ghash_last4.
+ */
+static const uint64_t cyfn_ghash_last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+void cyfn_ghash_portable_init(uint64_t* htable, const uint8_t* H) {
+    uint64_t* HL = htable;
+    uint64_t* HH = htable + 16;
+    uint64_t vh = cyfn_load_be64(H);
+    uint64_t vl = cyfn_load_be64(H + 8);
+    int i, j;
+    
+    HL[8] = vl;
+    HH[8] = vh;
+    HL[0] = 0;
+    HH[0] = 0;
+    
+    for (i = 4; i > 0; i >>= 1) {
+        uint64_t T = (vl & 1) * 0xe1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ (T << 32);
+        HL[i] = vl;
+        HH[i] = vh;
+    }
+    
+    for (i = 2; i <= 8; i *= 2) {
+        for (j = 1; j < i; ++j) {
+            HH[i + j] = HH[i] ^ HH[j];
+            HL[i + j] = HL[i] ^ HL[j];
+        }
+    }
+}
+
+static void cyfn_ghash_portable_mult(const uint64_t* htable, uint8_t* X) {
+    const uint64_t* HL = htable;
+    const uint64_t* HH = htable + 16;
+    uint64_t zh, zl;
+    uint8_t lo, hi, rem;
+    int i;
+    
+    lo = X[15] & 0x0f;
+    zh = HH[lo];
+    zl = HL[lo];
+    
+    for (i = 15; i >= 0; --i) {
+        lo = X[i] & 0x0f;
+        hi = (X[i] >> 4) & 0x0f;
+        
+        if (i != 15) {
+            rem = (uint8_t)(zl & 0x0f);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (cyfn_ghash_last4[rem] << 48);
+            zh ^= HH[lo];
+            zl ^= HL[lo];
+        }
+        
+        rem = (uint8_t)(zl & 0x0f);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (cyfn_ghash_last4[rem] << 48);
+        zh ^= HH[hi];
+        zl ^= HL[hi];
+    }
+    
+    cyfn_store_be64(X, zh);
+    cyfn_store_be64(X + 8, zl);
+}
+
+void cyfn_ghash_portable_blocks(const uint64_t* htable, uint8_t* X, const uint8_t* buf, size_t nblocks) {
+    for (; nblocks > 0; --nblocks, buf += CYFN_AES_BLOCKLEN) {
+        cyfn_xor_bytes(X, buf, CYFN_AES_BLOCKLEN);
+        cyfn_ghash_portable_mult(htable, X);
+    }
+}
+#endif /* CYFN_SOFT_AES */
+
+/*****************************************************************************/
+/* GCM mode:                                                                 */
+/*****************************************************************************/
+
+static inline const struct cyfn_backend* cyfn_gcm_aes(const struct cyfn_gcm_ctx* ctx) {
+    return (const struct cyfn_backend*)ctx->cyfn_backend;
+}
+
+static inline const struct cyfn_backend* cyfn_gcm_hash(const struct cyfn_gcm_ctx* ctx) {
+    return (const struct cyfn_backend*)ctx->cyfn_ghash_backend;
+}
+
+static inline void cyfn_gcm_ghash(struct cyfn_gcm_ctx* ctx, const uint8_t* buf, size_t nblocks) {
+    cyfn_gcm_hash(ctx)->ghash_blocks(ctx->cyfn_htable, ctx->cyfn_ghash, buf, nblocks);
+}
+
+/**
+ * @brief XORs the keystream for `nblocks` blocks into `buf`.
+ *
+ * GCM increments only the low 32 bits of the counter block (inc32). The CTR
+ * kernels carry into the full 128 bits, so the run is split where the low word
+ * wraps and the upper 96 bits are restored.
+ */
+static void cyfn_gcm_ctr(struct cyfn_gcm_ctx* ctx, uint8_t* buf, size_t nblocks) {
+    const struct cyfn_backend* backend = cyfn_gcm_aes(ctx);
+    uint8_t upper[CYFN_AES_BLOCKLEN - 4];
+    
+    memcpy(upper, ctx->cyfn_counter, sizeof(upper));
+    
+    while (nblocks > 0) {
+        uint32_t low = (uint32_t)cyfn_load_be64(ctx->cyfn_counter + 8);
+        uint64_t until_wrap = 0x100000000ULL - low;
+        size_t n = ((uint64_t)nblocks < until_wrap) ? nblocks : (size_t)until_wrap;
+        
+        backend->ctr_blocks(&ctx->cyfn_aes, ctx->cyfn_counter, buf, n);
+        memcpy(ctx->cyfn_counter, upper, sizeof(upper));
+        
+        buf += n * CYFN_AES_BLOCKLEN;
+        nblocks -= n;
+    }
+}
+
+int cyfn_gcm_ctx_set_iv(struct cyfn_gcm_ctx* ctx, const uint8_t* iv, size_t iv_len) {
+    if (iv_len == 0) {
+        return -1;
+    }
+    
+    memset(ctx->cyfn_ghash, 0, CYFN_AES_BLOCKLEN);
+    
+    if (iv_len == CYFN_GCM_IVLEN) {
+        memcpy(ctx->cyfn_j0, iv, CYFN_GCM_IVLEN);
+        memset(ctx->cyfn_j0 + CYFN_GCM_IVLEN, 0, CYFN_AES_BLOCKLEN - CYFN_GCM_IVLEN);
+        ctx->cyfn_j0[CYFN_AES_BLOCKLEN - 1] = 1;
+    } else {
+        // J0 = GHASH(IV || 0-padding || 0^64 || [len(IV)]_64)
+        uint8_t block[CYFN_AES_BLOCKLEN];
+        size_t full = iv_len / CYFN_AES_BLOCKLEN;
+        size_t rest = iv_len % CYFN_AES_BLOCKLEN;
+        
+        cyfn_gcm_ghash(ctx, iv, full);
+        if (rest > 0) {
+            memset(block, 0, sizeof(block));
+            memcpy(block, iv + (full * CYFN_AES_BLOCKLEN), rest);
+            cyfn_gcm_ghash(ctx, block, 1);
+        }
+        cyfn_store_be64(block, 0);
+        cyfn_store_be64(block + 8, (uint64_t)iv_len * 8);
+        cyfn_gcm_ghash(ctx, block, 1);
+        
+        memcpy(ctx->cyfn_j0, ctx->cyfn_ghash, CYFN_AES_BLOCKLEN);
+        memset(ctx->cyfn_ghash, 0, CYFN_AES_BLOCKLEN);
+    }
+    
+    // The first keystream block uses inc32(J0); J0 itself encrypts the tag.
+    memcpy(ctx->cyfn_counter, ctx->cyfn_j0, CYFN_AES_BLOCKLEN);
+    {
+        uint32_t low = (uint32_t)cyfn_load_be64(ctx->cyfn_counter + 8) + 1;
+        ctx->cyfn_counter[12] = (uint8_t)(low >> 24);
+        ctx->cyfn_counter[13] = (uint8_t)(low >> 16);
+        ctx->cyfn_counter[14] = (uint8_t)(low >> 8);
+        ctx->cyfn_counter[15] = (uint8_t)low;
+    }
+    
+    ctx->cyfn_aad_len = 0;
+    ctx->cyfn_text_len = 0;
+    return 0;
+}
+
+int cyfn_gcm_init_ctx(struct cyfn_gcm_ctx* ctx, const uint8_t* key, const uint8_t* iv, size_t iv_len) {
+    const struct cyfn_backend* backend = cyfn_active_backend();
+    uint8_t H[CYFN_AES_BLOCKLEN] = { 0 };
+    
+    if (iv_len == 0) {
+        return -1;
+    }
+    
+    cyfn_init_ctx(&ctx->cyfn_aes, key);
+    ctx->cyfn_backend = backend;
+    ctx->cyfn_ghash_backend = backend->ghash_is_supported() ? backend : &cyfn_backend_portable;
+    
+    backend->encrypt_blocks(&ctx->cyfn_aes, H, 1);
+    cyfn_gcm_hash(ctx)->ghash_init(ctx->cyfn_htable, H);
+    memset(H, 0, sizeof(H));
+    
+    return cyfn_gcm_ctx_set_iv(ctx, iv, iv_len);
+}
+
+int cyfn_gcm_update_aad(struct cyfn_gcm_ctx* ctx, const uint8_t* aad, size_t length) {
+    size_t used = (size_t)(ctx->cyfn_aad_len % CYFN_AES_BLOCKLEN);
+    size_t full;
+    
+    if (ctx->cyfn_text_len > 0) {
+        return -1;
+    }
+    
+    ctx->cyfn_aad_len += length;
+    
+    if (used > 0) {
+        size_t n = CYFN_AES_BLOCKLEN - used;
+        if (n > length) {
+            n = length;
+        }
+        
+        memcpy(ctx->cyfn_pending + used, aad, n);
+        aad += n;
+        length -= n;
+        
+        if (used + n < CYFN_AES_BLOCKLEN) {
+            return 0;
+        }
+        cyfn_gcm_ghash(ctx, ctx->cyfn_pending, 1);
+    }
+    
+    full = length / CYFN_AES_BLOCKLEN;
+    cyfn_gcm_ghash(ctx, aad, full);
+    memcpy(ctx->cyfn_pending, aad + (full * CYFN_AES_BLOCKLEN), length % CYFN_AES_BLOCKLEN);
+    return 0;
+}
+
+/**
+ * @brief Shared body of the encrypt/decrypt updates.
+ *
+ * GHASH always runs over the ciphertext: after the XOR when encrypting and
+ * before it when decrypting.
+ */
+static void cyfn_gcm_update(struct cyfn_gcm_ctx* ctx, uint8_t* buf, size_t length, int encrypt) {
+    size_t used, i;
+    
+    if (length == 0) {
+        return;
+    }
+    
+    // First ciphertext byte: close the zero-padded AAD block.
+    if (ctx->cyfn_text_len == 0 && (ctx->cyfn_aad_len % CYFN_AES_BLOCKLEN) != 0) {
+        size_t pending = (size_t)(ctx->cyfn_aad_len % CYFN_AES_BLOCKLEN);
+        memset(ctx->cyfn_pending + pending, 0, CYFN_AES_BLOCKLEN - pending);
+        cyfn_gcm_ghash(ctx, ctx->cyfn_pending, 1);
+    }
+    
+    used = (size_t)(ctx->cyfn_text_len % CYFN_AES_BLOCKLEN);
+    ctx->cyfn_text_len += length;
+    
+    // Finish the partial block left by the previous call.
+    if (used > 0) {
+        size_t n = CYFN_AES_BLOCKLEN - used;
+        if (n > length) {
+            n = length;
+        }
+        
+        for (i = 0; i < n; ++i) {
+            if (!encrypt) {
+                ctx->cyfn_pending[used + i] = buf[i];
+            }
+            buf[i] ^= ctx->cyfn_keystream[used + i];
+            if (encrypt) {
+                ctx->cyfn_pending[used + i] = buf[i];
+            }
+        }
+        
+        buf += n;
+        length -= n;
+        
+        if (used + n < CYFN_AES_BLOCKLEN) {
+            return;
+        }
+        cyfn_gcm_ghash(ctx, ctx->cyfn_pending, 1);
+    }
+    
+    while (length >= CYFN_AES_BLOCKLEN) {
+        size_t nblocks = length / CYFN_AES_BLOCKLEN;
+        if (nblocks > CYFN_GCM_CHUNK_BLOCKS) {
+            nblocks = CYFN_GCM_CHUNK_BLOCKS;
+        }
+        
+        if (encrypt) {
+            cyfn_gcm_ctr(ctx, buf, nblocks);
+            cyfn_gcm_ghash(ctx, buf, nblocks);
+        } else {
+            cyfn_gcm_ghash(ctx, buf, nblocks);
+            cyfn_gcm_ctr(ctx, buf, nblocks);
+        }
+        
+        buf += nblocks * CYFN_AES_BLOCKLEN;
+        length -= nblocks * CYFN_AES_BLOCKLEN;
+    }
+    
+    // Start a new partial block; its unused keystream is kept for the next call.
+    if (length > 0) {
+        memset(ctx->cyfn_keystream, 0, CYFN_AES_BLOCKLEN);
+        cyfn_gcm_ctr(ctx, ctx->cyfn_keystream, 1);
+        
+        for (i = 0; i < length; ++i) {
+            if (!encrypt) {
+                ctx->cyfn_pending[i] = buf[i];
+            }
+            buf[i] ^= ctx->cyfn_keystream[i];
+            if (encrypt) {
+                ctx->cyfn_pending[i] = buf[i];
+            }
+        }
+    }
+}
+
+void cyfn_gcm_encrypt_update(struct cyfn_gcm_ctx* ctx, uint8_t* buf, size_t length) {
+    cyfn_gcm_update(ctx, buf, length, 1);
+}
+
+void cyfn_gcm_decrypt_update(struct cyfn_gcm_ctx* ctx, uint8_t* buf, size_t length) {
+    cyfn_gcm_update(ctx, buf, length, 0);
+}
+
+static void cyfn_gcm_compute_tag(struct cyfn_gcm_ctx* ctx, uint8_t* tag) {
+    uint8_t block[CYFN_AES_BLOCKLEN];
+    size_t pending = (size_t)((ctx->cyfn_text_len > 0 ? ctx->cyfn_text_len : ctx->cyfn_aad_len) % CYFN_AES_BLOCKLEN);
+    
+    if (pending > 0) {
+        memset(ctx->cyfn_pending + pending, 0, CYFN_AES_BLOCKLEN - pending);
+        cyfn_gcm_ghash(ctx, ctx->cyfn_pending, 1);
+    }
+    
+    cyfn_store_be64(block, ctx->cyfn_aad_len * 8);
+    cyfn_store_be64(block + 8, ctx->cyfn_text_len * 8);
+    cyfn_gcm_ghash(ctx, block, 1);
+    
+    memcpy(tag, ctx->cyfn_j0, CYFN_AES_BLOCKLEN);
+    cyfn_gcm_aes(ctx)->encrypt_blocks(&ctx->cyfn_aes, tag, 1);
+    cyfn_xor_bytes(tag, ctx->cyfn_ghash, CYFN_AES_BLOCKLEN);
+}
+
+void cyfn_gcm_finish(struct cyfn_gcm_ctx* ctx, uint8_t* tag, size_t tag_len) {
+    uint8_t full[CYFN_AES_BLOCKLEN];
+    
+    cyfn_gcm_compute_tag(ctx, full);
+    memcpy(tag, full, (tag_len < CYFN_GCM_TAGLEN) ? tag_len : CYFN_GCM_TAGLEN);
+}
+
+int cyfn_gcm_verify(struct cyfn_gcm_ctx* ctx, const uint8_t* tag, size_t tag_len) {
+    uint8_t full[CYFN_AES_BLOCKLEN];
+    uint8_t diff = 0;
+    size_t i;
+    
+    if (tag_len == 0 || tag_len > CYFN_GCM_TAGLEN) {
+        return -1;
+    }
+    
+    cyfn_gcm_compute_tag(ctx, full);
+    for (i = 0; i < tag_len; ++i) {
+        diff |= full[i] ^ tag[i];
+    }
+    return (diff == 0) ? 0 : -1;
+}
+
+#endif /* #if defined(CYFN_GCM) && (CYFN_GCM == 1) */
@@ -0,0 +1,239 @@
+//
+//  cyfn_internal.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//  Private interface shared by the cyfn translation units. Not a public header.
+
+#ifndef CYFN_INTERNAL_H
+#define CYFN_INTERNAL_H
+
+#include <cyfn.h>
+#include <string.h>
+
+#define CYFN_Nb 4
+
+#if defined(CYFN_AES256) && (CYFN_AES256 == 1)
+#define CYFN_Nk 8
+#define CYFN_Nr 14
+#elif defined(CYFN_AES192) && (CYFN_AES192 == 1)
+#define CYFN_Nk 6
+#define CYFN_Nr 12
+#else
+#define CYFN_Nk 4
+#define CYFN_Nr 10
+#endif
+
+#if (defined(CYFN_CBC) && (CYFN_CBC == 1)) || (defined(CYFN_ECB) && (CYFN_ECB == 1))
+#define CYFN_DECRYPT 1
+#else
+#define CYFN_DECRYPT 0
+#endif
+
+// The CTR keystream kernels also drive GCM.
+#if (defined(CYFN_CTR) && (CYFN_CTR == 1)) || (defined(CYFN_GCM) && (CYFN_GCM == 1))
+#define CYFN_CTR_KERNEL 1
+#else
+#define CYFN_CTR_KERNEL 0
+#endif
+
+#if defined(CYFN_HW_ACCEL) && (CYFN_HW_ACCEL == 1) && \
+    (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CYFN_HAVE_AESNI 1
+#else
+#define CYFN_HAVE_AESNI 0
+#endif
+
+#if defined(CYFN_HW_ACCEL) && (CYFN_HW_ACCEL == 1) && defined(__aarch64__) && \
+    (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define CYFN_HAVE_ARMV8 1
+#else
+#define CYFN_HAVE_ARMV8 0
+#endif
+
+// Number of counter blocks processed per CTR iteration. Eight blocks keep the
+// AES units of current x86_64 and Apple cores busy while staying in registers.
+#define CYFN_CTR_BATCH 8
+
+// Number of ciphertext blocks decrypted together by the CBC kernels.
+#define CYFN_CBC_BATCH 8
+
+/**
+ * @brief Function table implemented by every AES backend.
+ *
+ * Block functions operate in place on `nblocks` consecutive 16-byte blocks.
+ * Encryption uses `ctx->cyfn_roundKey`; decryption uses the equivalent inverse
+ * cipher schedule in `ctx->cyfn_invRoundKey` (or the forward schedule for
+ * backends that implement the straightforward inverse cipher).
+ *
+ * @field id The public identifier of the backend.
+ * @field is_supported Returns non-zero when the running CPU can execute the backend.
+ * @field encrypt_blocks Encrypts blocks in place (ECB).
+ * @field decrypt_blocks Decrypts blocks in place (ECB).
+ * @field ctr_blocks XORs the keystream for `nblocks` full blocks into `buf`,
+ *                   starting at the big-endian counter block `counter` and
+ *                   advancing it by `nblocks`.
+ * @field cbc_decrypt Decrypts `nblocks` CBC blocks in place, chaining from `iv`
+ *                    and leaving the last ciphertext block in it.
+ * @field ghash_is_supported Returns non-zero when the carry-less multiply used
+ *                           by `ghash_init`/`ghash_blocks` is available.
+ * @field ghash_init Precomputes the GHASH key material for hash key `H`.
+ * @field ghash_blocks Folds `nblocks` full blocks into the GHASH accumulator `X`.
+ */
+struct cyfn_backend {
+    cyfn_backend_t id;
+    int (*is_supported)(void);
+    void (*encrypt_blocks)(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks);
+#if CYFN_DECRYPT
+    void (*decrypt_blocks)(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks);
+#endif
+#if CYFN_CTR_KERNEL
+    void (*ctr_blocks)(const struct cyfn_ctx* ctx, uint8_t* counter, uint8_t* buf, size_t nblocks);
+#endif
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+    void (*cbc_decrypt)(const struct cyfn_ctx* ctx, uint8_t* iv, uint8_t* buf, size_t nblocks);
+#endif
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    int (*ghash_is_supported)(void);
+    void (*ghash_init)(uint64_t* htable, const uint8_t* H);
+    void (*ghash_blocks)(const uint64_t* htable, uint8_t* X, const uint8_t* buf, size_t nblocks);
+#endif
+};
+
+/**
+ * @brief Returns the backend used by the public cyfn functions.
+ *
+ * Resolves the fastest supported backend on first call.
+ */
+const struct cyfn_backend* cyfn_active_backend(void);
+
+extern const struct cyfn_backend cyfn_backend_portable;
+
+#if CYFN_CTR_KERNEL
+/**
+ * @brief CTR kernel for backends without a fused implementation.
+ *
+ * Builds CYFN_CTR_BATCH counter blocks at a time, encrypts them with a single
+ * `encrypt_blocks` call and XORs the keystream into `buf` a word at a time.
+ */
+void cyfn_ctr_blocks_generic(void (*encrypt_blocks)(const struct cyfn_ctx*, uint8_t*, size_t),
+                             const struct cyfn_ctx* ctx, uint8_t* counter, uint8_t* buf, size_t nblocks);
+#endif
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+/**
+ * @brief CBC decryption kernel for backends without a fused implementation.
+ *
+ * Saves CYFN_CBC_BATCH ciphertext blocks with one copy, decrypts them with a
+ * single `decrypt_blocks` call and XORs in the chaining values.
+ */
+void cyfn_cbc_decrypt_generic(void (*decrypt_blocks)(const struct cyfn_ctx*, uint8_t*, size_t),
+                              const struct cyfn_ctx* ctx, uint8_t* iv, uint8_t* buf, size_t nblocks);
+#endif
+
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_TTABLE
+/**
+ * @brief T-table rounds used by the portable backend (cyfn_ttable.c).
+ *
+ * Decryption uses the equivalent inverse cipher schedule in `cyfn_invRoundKey`.
+ */
+void cyfn_ttable_encrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks);
+#if CYFN_DECRYPT
+void cyfn_ttable_decrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks);
+#endif
+#elif CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+/**
+ * @brief Constant-time bitsliced rounds used by the portable backend (cyfn_bitslice.c).
+ *
+ * `cyfn_bitslice_key_schedule` converts the expanded key into the bitsliced
+ * form kept in `cyfn_bsRoundKey`; both directions use that forward schedule.
+ * `cyfn_bitslice_sub_word` is the S-box for the key expansion.
+ */
+void cyfn_bitslice_key_schedule(uint64_t* bsRoundKey, const uint8_t* RoundKey);
+void cyfn_bitslice_sub_word(uint8_t* word);
+void cyfn_bitslice_encrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks);
+#if CYFN_DECRYPT
+void cyfn_bitslice_decrypt_blocks(const struct cyfn_ctx* ctx, uint8_t* buf, size_t nblocks);
+#endif
+#endif
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+/**
+ * @brief Software GHASH used without CLMUL/PMULL: 4-bit tables (Shoup's method),
+ *        or a constant-time multiply in CYFN_SOFT_AES_BITSLICE builds.
+ */
+void cyfn_ghash_portable_init(uint64_t* htable, const uint8_t* H);
+void cyfn_ghash_portable_blocks(const uint64_t* htable, uint8_t* X, const uint8_t* buf, size_t nblocks);
+#endif
+
+/*
+ The CTR counter block is a single 128-bit big-endian integer. It is handled as
+ two 64-bit halves so the common case is one add; the carry into the high half
+ keeps the result identical to the byte-wise increment.
+ */
+static inline uint64_t cyfn_load_be64(const uint8_t* p) {
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8)  | (uint64_t)p[7];
+}
+
+static inline void cyfn_store_be64(uint8_t* p, uint64_t v) {
+    p[0] = (uint8_t)(v >> 56); p[1] = (uint8_t)(v >> 48); p[2] = (uint8_t)(v >> 40); p[3] = (uint8_t)(v >> 32);
+    p[4] = (uint8_t)(v >> 24); p[5] = (uint8_t)(v >> 16); p[6] = (uint8_t)(v >> 8);  p[7] = (uint8_t)v;
+}
+
+static inline void cyfn_ctr_add(uint64_t* hi, uint64_t* lo, uint64_t n) {
+    uint64_t prev = *lo;
+    *lo += n;
+    *hi += (*lo < prev);
+}
+
+static inline void cyfn_xor_bytes(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, sizeof(a));
+        memcpy(&b, src + i, sizeof(b));
+        a ^= b;
+        memcpy(dst + i, &a, sizeof(a));
+    }
+    for (; i < len; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+#if CYFN_HAVE_AESNI
+extern const struct cyfn_backend cyfn_backend_aesni;
+#endif
+
+#if CYFN_HAVE_ARMV8
+extern const struct cyfn_backend cyfn_backend_armv8;
+#endif
+
+#endif
@@ -0,0 +1,278 @@
+//
+//  cyfn_parallel.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cyfn_internal.h"
+
+#if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1)
+
+#include <stdatomic.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ Multi-core CTR and CBC decryption.
+
+ Both modes decompose into independent ranges: CTR derives the counter of any
+ block from the IV, and CBC decryption of block i only needs ciphertext block
+ i - 1. Buffers above the threshold are cut into block-aligned chunks that are
+ processed by dispatch_apply on Apple platforms and by a small fork-join pool
+ of pthreads elsewhere; the calling thread always takes part.
+ */
+
+// Smallest amount of work handed to one worker.
+#define CYFN_PARALLEL_CHUNK_MIN (256 * 1024)
+
+// Chunks per core, so faster cores can pick up the slack of slower ones.
+#define CYFN_PARALLEL_CHUNKS_PER_CPU 4
+
+#define CYFN_PARALLEL_MAX_THREADS 64
+
+static _Atomic size_t cyfn_parallel_threshold = CYFN_PARALLEL_THRESHOLD;
+
+void cyfn_set_parallel_threshold(size_t bytes) {
+    atomic_store_explicit(&cyfn_parallel_threshold, bytes ? bytes : (size_t)CYFN_PARALLEL_THRESHOLD,
+                          memory_order_relaxed);
+}
+
+size_t cyfn_get_parallel_threshold(void) {
+    return atomic_load_explicit(&cyfn_parallel_threshold, memory_order_relaxed);
+}
+
+#if (defined(CYFN_CTR) && (CYFN_CTR == 1)) || (defined(CYFN_CBC) && (CYFN_CBC == 1))
+static size_t cyfn_parallel_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (size_t)n : 1;
+}
+
+/**
+ * @brief Splits `length` bytes into block-aligned chunks.
+ *
+ * @return The number of chunks; `*chunk` receives the size of all but the last one.
+ */
+static size_t cyfn_parallel_plan(size_t length, size_t* chunk) {
+    size_t cpus = cyfn_parallel_cpu_count();
+    size_t count = cpus * CYFN_PARALLEL_CHUNKS_PER_CPU;
+    size_t size;
+    
+    if (length / count < CYFN_PARALLEL_CHUNK_MIN) {
+        count = length / CYFN_PARALLEL_CHUNK_MIN;
+    }
+    if (count < 1) {
+        count = 1;
+    }
+    
+    size = (length + count - 1) / count;
+    size = (size + CYFN_AES_BLOCKLEN - 1) & ~(size_t)(CYFN_AES_BLOCKLEN - 1);
+    
+    *chunk = size;
+    return (length + size - 1) / size;
+}
+
+typedef void (*cyfn_parallel_work_fn)(void* context, size_t index);
+
+#if !defined(__APPLE__)
+struct cyfn_parallel_job {
+    void* context;
+    cyfn_parallel_work_fn work;
+    size_t count;
+    _Atomic size_t next;
+};
+
+static void* cyfn_parallel_worker(void* arg) {
+    struct cyfn_parallel_job* job = arg;
+    size_t index;
+    
+    while ((index = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed)) < job->count) {
+        job->work(job->context, index);
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Runs `work(context, i)` for every i in [0, count) and waits for completion.
+ */
+static void cyfn_parallel_for(size_t count, void* context, cyfn_parallel_work_fn work) {
+#if defined(__APPLE__)
+    dispatch_apply_f(count, DISPATCH_APPLY_AUTO, context, work);
+#else
+    pthread_t threads[CYFN_PARALLEL_MAX_THREADS];
+    struct cyfn_parallel_job job;
+    size_t nthreads = cyfn_parallel_cpu_count();
+    size_t started = 0;
+    size_t i;
+    
+    job.context = context;
+    job.work = work;
+    job.count = count;
+    atomic_init(&job.next, 0);
+    
+    if (nthreads > count) {
+        nthreads = count;
+    }
+    if (nthreads > CYFN_PARALLEL_MAX_THREADS) {
+        nthreads = CYFN_PARALLEL_MAX_THREADS;
+    }
+    
+    // The calling thread is one of the workers; if a thread cannot be created
+    // the remaining chunks are simply picked up by the others.
+    for (i = 1; i < nthreads; ++i) {
+        if (pthread_create(&threads[started], NULL, cyfn_parallel_worker, &job) == 0) {
+            ++started;
+        }
+    }
+    
+    cyfn_parallel_worker(&job);
+    
+    for (i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+#endif
+}
+
+#if defined(CYFN_CTR) && (CYFN_CTR == 1)
+struct cyfn_ctr_job {
+    const struct cyfn_ctx* ctx;
+    uint8_t iv[CYFN_AES_BLOCKLEN];
+    uint8_t* buf;
+    size_t length;
+    size_t chunk;
+};
+
+static void cyfn_ctr_job_run(void* context, size_t index) {
+    const struct cyfn_ctr_job* job = context;
+    size_t offset = index * job->chunk;
+    size_t n = (job->length - offset < job->chunk) ? (job->length - offset) : job->chunk;
+    
+    cyfn_ctr_xcrypt_at(job->ctx, job->iv, offset, job->buf + offset, n);
+}
+
+void cyfn_ctr_xcrypt_buffer_parallel(struct cyfn_ctx* ctx, uint8_t* buf, size_t length) {
+    struct cyfn_ctr_job job;
+    size_t count;
+    uint64_t hi, lo;
+    
+    if (length < cyfn_get_parallel_threshold()) {
+        cyfn_ctr_xcrypt_buffer(ctx, buf, length);
+        return;
+    }
+    
+    count = cyfn_parallel_plan(length, &job.chunk);
+    if (count < 2) {
+        cyfn_ctr_xcrypt_buffer(ctx, buf, length);
+        return;
+    }
+    
+    job.ctx = ctx;
+    job.buf = buf;
+    job.length = length;
+    memcpy(job.iv, ctx->cyfn_iv, CYFN_AES_BLOCKLEN);
+    
+    cyfn_parallel_for(count, &job, cyfn_ctr_job_run);
+    
+    // Advance the IV exactly like the serial path: one counter per started block.
+    hi = cyfn_load_be64(job.iv);
+    lo = cyfn_load_be64(job.iv + 8);
+    cyfn_ctr_add(&hi, &lo, (length + CYFN_AES_BLOCKLEN - 1) / CYFN_AES_BLOCKLEN);
+    cyfn_store_be64(ctx->cyfn_iv, hi);
+    cyfn_store_be64(ctx->cyfn_iv + 8, lo);
+}
+#endif /* #if defined(CYFN_CTR) && (CYFN_CTR == 1) */
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+struct cyfn_cbc_job {
+    const struct cyfn_ctx* ctx;
+    uint8_t* buf;
+    size_t length;
+    size_t chunk;
+    // The ciphertext block preceding each chunk, captured before any worker
+    // starts overwriting the buffer.
+    uint8_t (*prev)[CYFN_AES_BLOCKLEN];
+};
+
+static void cyfn_cbc_job_run(void* context, size_t index) {
+    const struct cyfn_cbc_job* job = context;
+    size_t offset = index * job->chunk;
+    size_t n = (job->length - offset < job->chunk) ? (job->length - offset) : job->chunk;
+    struct cyfn_ctx local = *job->ctx;
+    
+    memcpy(local.cyfn_iv, job->prev[index], CYFN_AES_BLOCKLEN);
+    cyfn_cbc_decrypt_buffer(&local, job->buf + offset, n);
+}
+
+void cyfn_cbc_decrypt_buffer_parallel(struct cyfn_ctx* ctx, uint8_t* buf, size_t length) {
+    uint8_t prev[CYFN_PARALLEL_MAX_THREADS * CYFN_PARALLEL_CHUNKS_PER_CPU][CYFN_AES_BLOCKLEN];
+    struct cyfn_cbc_job job;
+    size_t count;
+    size_t i;
+    
+    length -= length % CYFN_AES_BLOCKLEN;
+    
+    if (length < cyfn_get_parallel_threshold()) {
+        cyfn_cbc_decrypt_buffer(ctx, buf, length);
+        return;
+    }
+    
+    count = cyfn_parallel_plan(length, &job.chunk);
+    if (count > sizeof(prev) / sizeof(prev[0])) {
+        job.chunk = (length / (sizeof(prev) / sizeof(prev[0])) + CYFN_AES_BLOCKLEN) & ~(size_t)(CYFN_AES_BLOCKLEN - 1);
+        count = (length + job.chunk - 1) / job.chunk;
+    }
+    if (count < 2) {
+        cyfn_cbc_decrypt_buffer(ctx, buf, length);
+        return;
+    }
+    
+    memcpy(prev[0], ctx->cyfn_iv, CYFN_AES_BLOCKLEN);
+    for (i = 1; i < count; ++i) {
+        memcpy(prev[i], buf + (i * job.chunk) - CYFN_AES_BLOCKLEN, CYFN_AES_BLOCKLEN);
+    }
+    
+    job.ctx = ctx;
+    job.buf = buf;
+    job.length = length;
+    job.prev = prev;
+    
+    // The last ciphertext block becomes the IV for the next call.
+    memcpy(ctx->cyfn_iv, buf + length - CYFN_AES_BLOCKLEN, CYFN_AES_BLOCKLEN);
+    
+    cyfn_parallel_for(count, &job, cyfn_cbc_job_run);
+}
+#endif /* #if defined(CYFN_CBC) && (CYFN_CBC == 1) */
+
+#endif /* #if (defined(CYFN_CTR) && (CYFN_CTR == 1)) || (defined(CYFN_CBC) && (CYFN_CBC == 1)) */
+
+#endif /* #if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1) */
@@ -0,0 +1,87 @@
+//
+//  SCBackup.h
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <Foundation/Foundation.h>
+#include <fs/chunk.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// One backup of a document, as recorded by `SCBackupParser`.
+///
+/// A backup does not hold the document's bytes. It is a manifest: the ordered
+/// list of content-defined chunks that reassemble the document, each named by
+/// its `fs_chunk_id_t`. Chunks are shared by every backup (of any document)
+/// that contains them, so consecutive backups of a large document only store
+/// the chunks around the edits.
+NS_CLASS_AVAILABLE(15, 18)
+@interface SCBackup : NSObject
+
+/// Names the backup within its document; identifiers sort by creation time.
+@property (nonatomic, readonly, copy) NSString *identifier;
+
+/// The path of the document when it was backed up.
+@property (nonatomic, readonly, copy) NSString *filePath;
+
+/// When the backup was taken.
+@property (nonatomic, readonly, strong) NSDate *date;
+
+/// The size of the document in bytes.
+@property (nonatomic, readonly) uint64_t size;
+
+/// The number of chunks in the document.
+@property (nonatomic, readonly) NSUInteger chunkCount;
+
+/// `chunkCount` `fs_chunk_id_t` values, in document order.
+@property (nonatomic, readonly, strong) NSData *chunkIDs;
+
+/// `chunkCount` `uint32_t` chunk lengths, in document order.
+@property (nonatomic, readonly, strong) NSData *chunkLengths;
+
+/// Creates a backup record.
+///
+/// @param chunkIDs `fs_chunk_id_t` values; must hold as many chunks as `chunkLengths`.
+/// @param chunkLengths `uint32_t` lengths that add up to `size`.
+/// @return `nil` if the chunk lists disagree with each other or with `size`.
+- (nullable instancetype)initWithIdentifier:(NSString *)identifier
+                                   filePath:(NSString *)filePath
+                                       date:(NSDate *)date
+                                       size:(uint64_t)size
+                                   chunkIDs:(NSData *)chunkIDs
+                               chunkLengths:(NSData *)chunkLengths NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns `YES` if both backups reassemble to the same bytes.
+- (BOOL)hasSameContentsAsBackup:(SCBackup *)backup;
+
+@end
+
+NS_ASSUME_NONNULL_END
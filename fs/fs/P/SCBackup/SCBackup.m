@@ -0,0 +1,81 @@
+//
+//  SCBackup.m
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import "SCBackup.h"
+
+@implementation SCBackup
+
+- (nullable instancetype)initWithIdentifier:(NSString *)identifier
+                                   filePath:(NSString *)filePath
+                                       date:(NSDate *)date
+                                       size:(uint64_t)size
+                                   chunkIDs:(NSData *)chunkIDs
+                               chunkLengths:(NSData *)chunkLengths {
+    NSUInteger count = chunkIDs.length / sizeof(fs_chunk_id_t);
+    if (chunkIDs.length % sizeof(fs_chunk_id_t) || chunkLengths.length != count * sizeof(uint32_t)) {
+        return nil;
+    }
+
+    const uint32_t *lengths = chunkLengths.bytes;
+    uint64_t total = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        total += lengths[i];
+    }
+    if (total != size) {
+        return nil;
+    }
+
+    self = [super init];
+    if (self) {
+        _identifier = [identifier copy];
+        _filePath = [filePath copy];
+        _date = date;
+        _size = size;
+        _chunkCount = count;
+        _chunkIDs = [chunkIDs copy];
+        _chunkLengths = [chunkLengths copy];
+    }
+    return self;
+}
+
+- (BOOL)hasSameContentsAsBackup:(SCBackup *)backup {
+    // Equal ids imply equal lengths, but comparing them is cheap.
+    return _size == backup.size &&
+           [_chunkIDs isEqualToData:backup.chunkIDs] &&
+           [_chunkLengths isEqualToData:backup.chunkLengths];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<SCBackup %@ %@: %llu bytes in %lu chunks>",
+            _identifier, _filePath.lastPathComponent, _size, (unsigned long)_chunkCount];
+}
+
+@end
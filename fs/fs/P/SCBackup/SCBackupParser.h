@@ -0,0 +1,140 @@
+//
+//  SCBackupParser.h
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//  Description:
+//  SCBackupParser keeps deduplicated local backups of documents in a backup
+//  directory:
+//
+//  <directory>/chunks/<xx>/<chunk id>          chunk contents, shared by all backups
+//  <directory>/manifests/<document>/<id>.scbm  one manifest per backup
+//
+//  A document is split into content-defined chunks (see fs/chunk.h). Chunks
+//  already in the store are not written again, so backing up a small edit to
+//  a large document writes the few chunks around the edit plus a manifest of
+//  20 bytes per chunk, and backing up an unchanged document writes nothing.
+//
+//  New chunks are compressed, encrypted when a key is set, and written by a
+//  pipeline whose stages run concurrently (see fs/pipeline.h).
+//
+
+#import <Foundation/Foundation.h>
+#import "SCBackup.h"
+#import "SCConfig.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Creates, lists, restores and prunes local backups in one backup directory.
+///
+/// All operations on a parser are serialized on its own queue, so a backup
+/// never races a garbage collection. Use one parser per directory.
+NS_CLASS_AVAILABLE(15, 18)
+@interface SCBackupParser : NSObject
+
+/// The backup directory; created on the first backup.
+@property (nonatomic, readonly, copy) NSString *directory;
+
+/// The AES key (`CYFN_AES_KEYLEN` bytes) chunks are encrypted with, or `nil`.
+///
+/// When set, new chunks are encrypted with AES-GCM, and chunks stored
+/// unencrypted by earlier backups are written again, encrypted. Restoring
+/// encrypted chunks needs the same key.
+@property (atomic, copy, nullable) NSData *encryptionKey;
+
+/// Creates a parser for the backups in `directory`.
+- (instancetype)initWithDirectory:(NSString *)directory NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Backs up the file at `filePath`.
+///
+/// The file is chunked and the chunks are hashed in parallel; only chunks
+/// missing from the store are written. All chunks are flushed before the
+/// manifest, so a crash never leaves a manifest with missing chunks.
+///
+/// @param filePath The document to back up.
+/// @return The new backup, the newest existing one if the document did not
+///         change since, or `nil` if the document could not be read or the
+///         backup could not be written.
+- (nullable SCBackup *)backupFileAtPath:(NSString *)filePath;
+
+/// Backs up the file at `filePath` as `config` asks.
+///
+/// Does nothing unless `config.localBackup` is set, nor if
+/// `config.encryptionEnabled` is set without an `encryptionKey`. When
+/// `config.revisions` is positive, only that many backups of the document are
+/// kept and chunks no longer used by any backup are removed.
+///
+/// @return The backup, or `nil` if local backups are disabled or it failed.
+- (nullable SCBackup *)backupFileAtPath:(NSString *)filePath config:(SCConfig *)config;
+
+/// Runs `backupFileAtPath:config:` on the parser's queue.
+///
+/// @param completion Called on the main queue with the backup, or `nil`; may be `nil`.
+- (void)backupFileAtPath:(NSString *)filePath
+                  config:(SCConfig *)config
+              completion:(nullable void (^)(SCBackup *_Nullable backup))completion;
+
+/// Returns the backups of the document at `filePath`, newest first.
+- (NSArray<SCBackup *> *)backupsForFileAtPath:(NSString *)filePath;
+
+/// Reassembles `backup` and atomically writes it to `path`.
+///
+/// Every chunk is read and verified against its id in parallel.
+///
+/// @return `YES` on success, `NO` if a chunk is missing or damaged or `path` could not be written.
+- (BOOL)restoreBackup:(SCBackup *)backup toPath:(NSString *)path;
+
+/// Removes the manifest of `backup`. Its chunks stay until `collectGarbage`.
+///
+/// @return `YES` if the manifest was removed.
+- (BOOL)removeBackup:(SCBackup *)backup;
+
+/// Removes all but the newest `count` backups of the document at `filePath`.
+///
+/// @return The number of backups removed.
+- (NSUInteger)pruneBackupsForFileAtPath:(NSString *)filePath keeping:(NSUInteger)count;
+
+/// Removes every chunk not used by any backup in the directory.
+///
+/// @return The number of chunks removed.
+- (NSUInteger)collectGarbage;
+
+/// Encodes `backup` as a manifest.
++ (NSData *)manifestDataForBackup:(SCBackup *)backup;
+
+/// Decodes a manifest written by `manifestDataForBackup:`.
+///
+/// @return `nil` if the data is truncated, corrupt or of an unknown version.
++ (nullable SCBackup *)backupFromManifestData:(NSData *)data identifier:(NSString *)identifier;
+
+@end
+
+NS_ASSUME_NONNULL_END
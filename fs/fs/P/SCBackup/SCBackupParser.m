@@ -0,0 +1,943 @@
+//
+//  SCBackupParser.m
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import "SCBackupParser.h"
+#include <fs/chunk.h>
+#include <fs/compress.h>
+#include <fs/cyfn.h>
+#include <fs/fslog.h>
+#include <fs/io.h>
+#include <fs/journal.h>
+#include <fs/pipeline.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ Manifest layout (native byte order; the magic doubles as an endianness check):
+
+   SCBackupManifestHeader
+   fs_chunk_id_t[chunkCount]   chunk ids in document order
+   uint32_t[chunkCount]        chunk lengths
+   path                        `pathLength` bytes of UTF-8, not NUL-terminated
+
+ The checksum is fs_chunk_hash() over every byte after the `checksum` field.
+ */
+#define SC_BACKUP_MANIFEST_MAGIC 0x4d424353u /* "SCBM" */
+#define SC_BACKUP_MANIFEST_VERSION 2  /* 2: chunk ids keyed per stripe position */
+#define SC_BACKUP_MANIFEST_EXTENSION @"scbm"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint64_t checksum;
+    uint32_t chunkCount;
+    uint32_t pathLength;
+    uint64_t documentSize;
+    int64_t created;  // milliseconds since 1970
+} SCBackupManifestHeader;
+
+_Static_assert(sizeof(SCBackupManifestHeader) % 8 == 0, "chunk ids must stay 8-byte aligned");
+
+#define SC_BACKUP_CHECKED_FROM (offsetof(SCBackupManifestHeader, checksum) + sizeof(uint64_t))
+
+static uint64_t SCBackupManifestChecksum(const uint8_t *bytes, size_t len) {
+    return fs_chunk_hash(bytes + SC_BACKUP_CHECKED_FROM, len - SC_BACKUP_CHECKED_FROM).lo;
+}
+
+/// Manifests are grouped by a hash of the standardized document path.
+static NSString *SCBackupDocumentKey(NSString *filePath) {
+    const char *path = filePath.stringByStandardizingPath.fileSystemRepresentation;
+    char hex[FS_CHUNK_ID_HEX_LEN + 1];
+    fs_chunk_id_hex(fs_chunk_hash(path, strlen(path)), hex);
+    return @(hex);
+}
+
+static BOOL SCBackupChunkPath(char *out, size_t size, const char *chunksDirectory, fs_chunk_id_t chunkID) {
+    char hex[FS_CHUNK_ID_HEX_LEN + 1];
+    fs_chunk_id_hex(chunkID, hex);
+    int written = snprintf(out, size, "%s/%.2s/%s", chunksDirectory, hex, hex);
+    return written > 0 && (size_t)written < size;
+}
+
+static BOOL SCBackupParseChunkName(const char *name, fs_chunk_id_t *out) {
+    uint64_t half[2] = { 0, 0 };
+    for (unsigned i = 0; i < FS_CHUNK_ID_HEX_LEN; i++) {
+        char c = name[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = (unsigned)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = (unsigned)(c - 'a' + 10);
+        } else {
+            return NO;
+        }
+        half[i / 16] = (half[i / 16] << 4) | digit;
+    }
+    if (name[FS_CHUNK_ID_HEX_LEN] != '\0') {
+        return NO;
+    }
+    out->hi = half[0];
+    out->lo = half[1];
+    return YES;
+}
+
+static int SCBackupCompareChunkIDs(const void *a, const void *b) {
+    const fs_chunk_id_t *x = a, *y = b;
+    if (x->hi != y->hi) return x->hi < y->hi ? -1 : 1;
+    if (x->lo != y->lo) return x->lo < y->lo ? -1 : 1;
+    return 0;
+}
+
+/// Writes a chunk under a temporary name and renames it into place.
+///
+/// Chunks are only fsync()ed: the full flush of the manifest written after
+/// them also flushes the drive cache holding them.
+static BOOL SCBackupWriteChunk(const char *path, const uint8_t *bytes, size_t len) {
+    char temp[PATH_MAX];
+    int written = snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+    if (written <= 0 || (size_t)written >= sizeof(temp)) {
+        return NO;
+    }
+
+    int fd = mkstemp(temp);
+    if (fd < 0) {
+        return NO;
+    }
+    fchmod(fd, 0644);
+
+    BOOL ok = YES;
+    while (len && ok) {
+        ssize_t n = write(fd, bytes, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = n > 0;
+        if (ok) {
+            bytes += n;
+            len -= (size_t)n;
+        }
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(temp, path) == 0;
+    if (!ok) {
+        unlink(temp);
+    }
+    return ok;
+}
+
+/*
+ Stored chunk layout:
+
+   SCBackupChunkHeader
+   IV                  CYFN_GCM_IVLEN bytes, zero unless encrypted
+   payload             `storedLength` bytes: an LZ4 block, or the chunk itself
+                       when it does not compress
+   tag                 CYFN_GCM_TAGLEN bytes, encrypted chunks only
+
+ Encryption is AES-GCM over the payload, authenticating the header and the
+ chunk id, so a stored chunk cannot be swapped for another one of the store.
+ */
+#define SC_BACKUP_CHUNK_MAGIC 0x4b424353u /* "SCBK" */
+#define SC_BACKUP_CHUNK_VERSION 1
+
+typedef NS_OPTIONS(uint8_t, SCBackupChunkFlags) {
+    SCBackupChunkFlagCompressed = 1u << 0,
+    SCBackupChunkFlagEncrypted  = 1u << 1,
+};
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t length;        // of the chunk
+    uint32_t storedLength;  // of the payload
+} SCBackupChunkHeader;
+
+#define SC_BACKUP_PAYLOAD_OFFSET (sizeof(SCBackupChunkHeader) + CYFN_GCM_IVLEN)
+#define SC_BACKUP_CHUNK_OVERHEAD (SC_BACKUP_PAYLOAD_OFFSET + CYFN_GCM_TAGLEN)
+
+// Chunk files are written by a few threads; more only contend for the disk.
+#define SC_BACKUP_WRITERS 2
+
+static void SCBackupChunkCipher(struct cyfn_gcm_ctx *ctx, const uint8_t *key, const uint8_t *file,
+                                fs_chunk_id_t chunkID) {
+    cyfn_gcm_init_ctx(ctx, key, file + sizeof(SCBackupChunkHeader), CYFN_GCM_IVLEN);
+    cyfn_gcm_update_aad(ctx, file, sizeof(SCBackupChunkHeader));
+    cyfn_gcm_update_aad(ctx, (const uint8_t *)&chunkID, sizeof(chunkID));
+}
+
+/// Reads a stored chunk and decodes it into the `len` bytes at `out`.
+static BOOL SCBackupLoadChunk(const char *path, fs_chunk_id_t chunkID, const uint8_t *_Nullable key,
+                              uint8_t *out, size_t len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NO;
+    }
+
+    struct stat st;
+    uint8_t *file = NULL;
+    size_t size = 0;
+    BOOL ok = fstat(fd, &st) == 0 && (uint64_t)st.st_size >= SC_BACKUP_PAYLOAD_OFFSET &&
+              (uint64_t)st.st_size <= SC_BACKUP_CHUNK_OVERHEAD + fs_compress_bound(len);
+    if (ok) {
+        size = (size_t)st.st_size;
+        file = malloc(size);
+        ok = file != NULL;
+    }
+    for (size_t done = 0; ok && done < size;) {
+        ssize_t n = pread(fd, file + done, size - done, (off_t)done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = n > 0;
+        if (ok) {
+            done += (size_t)n;
+        }
+    }
+    close(fd);
+
+    SCBackupChunkHeader header;
+    if (ok) {
+        memcpy(&header, file, sizeof(header));
+        BOOL encrypted = (header.flags & SCBackupChunkFlagEncrypted) != 0;
+        ok = header.magic == SC_BACKUP_CHUNK_MAGIC && header.version == SC_BACKUP_CHUNK_VERSION &&
+             header.length == len &&
+             SC_BACKUP_PAYLOAD_OFFSET + (uint64_t)header.storedLength + (encrypted ? CYFN_GCM_TAGLEN : 0) == size &&
+             (!encrypted || key);
+    }
+
+    uint8_t *payload = file + SC_BACKUP_PAYLOAD_OFFSET;
+    if (ok && (header.flags & SCBackupChunkFlagEncrypted)) {
+        struct cyfn_gcm_ctx ctx;
+        SCBackupChunkCipher(&ctx, key, file, chunkID);
+        cyfn_gcm_decrypt_update(&ctx, payload, header.storedLength);
+        ok = cyfn_gcm_verify(&ctx, payload + header.storedLength, CYFN_GCM_TAGLEN) == 0;
+        memset(&ctx, 0, sizeof(ctx));
+    }
+    if (ok && (header.flags & SCBackupChunkFlagCompressed)) {
+        size_t decompressed;
+        ok = fs_decompress(payload, header.storedLength, out, len, &decompressed) == FS_ERROR_NONE &&
+             decompressed == len;
+    } else if (ok) {
+        ok = header.storedLength == len;
+        if (ok) {
+            memcpy(out, payload, len);
+        }
+    }
+
+    free(file);
+    return ok;
+}
+
+/// Returns `YES` if the chunk is stored, and encrypted if `encrypted` is set.
+static BOOL SCBackupChunkIsStored(const char *path, BOOL encrypted) {
+    if (!encrypted) {
+        return access(path, F_OK) == 0;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NO;
+    }
+    SCBackupChunkHeader header;
+    BOOL stored = pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                  header.magic == SC_BACKUP_CHUNK_MAGIC && (header.flags & SCBackupChunkFlagEncrypted);
+    close(fd);
+    return stored;
+}
+
+#pragma mark - Write pipeline
+
+/*
+ New chunks go through compress -> encrypt -> write stages, each on its own
+ threads (see fs/pipeline.h), so compressing one chunk overlaps encrypting
+ the previous one and writing the one before that. Items are chunk indices;
+ the input is the chunk in the mapped document.
+ */
+typedef struct {
+    const char *chunksDirectory;
+    const fs_chunk_id_t *ids;
+    const uint8_t *_Nullable key;
+} SCBackupPipelineContext;
+
+static fs_error_t SCBackupCompressStage(void *context, fs_pipeline_item_t *item) {
+    uint8_t *payload = item->buffer + SC_BACKUP_PAYLOAD_OFFSET;
+    size_t capacity = item->buffer_size - SC_BACKUP_CHUNK_OVERHEAD;
+    SCBackupChunkHeader header = {
+        .magic = SC_BACKUP_CHUNK_MAGIC,
+        .version = SC_BACKUP_CHUNK_VERSION,
+        .length = (uint32_t)item->input_len,
+    };
+    size_t compressed;
+
+    if (item->input_len > capacity) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    // Incompressible chunks are stored as they are.
+    if (fs_compress(item->input, item->input_len, payload, capacity, &compressed) == FS_ERROR_NONE &&
+        compressed < item->input_len) {
+        header.flags = SCBackupChunkFlagCompressed;
+        header.storedLength = (uint32_t)compressed;
+    } else {
+        if (item->input_len) memcpy(payload, item->input, item->input_len);
+        header.storedLength = (uint32_t)item->input_len;
+    }
+
+    memcpy(item->buffer, &header, sizeof(header));
+    memset(item->buffer + sizeof(header), 0, CYFN_GCM_IVLEN);
+    item->len = SC_BACKUP_PAYLOAD_OFFSET + header.storedLength;
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t SCBackupEncryptStage(void *context, fs_pipeline_item_t *item) {
+    const SCBackupPipelineContext *pipeline = context;
+    SCBackupChunkHeader header;
+    struct cyfn_gcm_ctx ctx;
+    fs_signpost_id_t signpost = FS_SIGNPOST_BEGIN(FS_SIGNPOST_ENCRYPT);
+
+    memcpy(&header, item->buffer, sizeof(header));
+    header.flags |= SCBackupChunkFlagEncrypted;
+    memcpy(item->buffer, &header, sizeof(header));
+    arc4random_buf(item->buffer + sizeof(header), CYFN_GCM_IVLEN);
+
+    SCBackupChunkCipher(&ctx, pipeline->key, item->buffer, pipeline->ids[item->tag]);
+    cyfn_gcm_encrypt_update(&ctx, item->buffer + SC_BACKUP_PAYLOAD_OFFSET, header.storedLength);
+    cyfn_gcm_finish(&ctx, item->buffer + item->len, CYFN_GCM_TAGLEN);
+    memset(&ctx, 0, sizeof(ctx));
+    item->len += CYFN_GCM_TAGLEN;
+    FS_SIGNPOST_END(FS_SIGNPOST_ENCRYPT, signpost);
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t SCBackupWriteStage(void *context, fs_pipeline_item_t *item) {
+    const SCBackupPipelineContext *pipeline = context;
+    char chunkPath[PATH_MAX];
+
+    if (!SCBackupChunkPath(chunkPath, sizeof(chunkPath), pipeline->chunksDirectory, pipeline->ids[item->tag])) {
+        return FS_ERROR_INVALID_ARGUMENT;
+    }
+    return SCBackupWriteChunk(chunkPath, item->buffer, item->len) ? FS_ERROR_NONE : FS_ERROR_IO;
+}
+
+/// Stores the chunks at `indices` through the write pipeline.
+static fs_error_t SCBackupStoreChunks(const SCBackupPipelineContext *context, const uint8_t *bytes,
+                                      const size_t *ends, const size_t *indices, size_t count) {
+    if (!count) {
+        return FS_ERROR_NONE;
+    }
+
+    unsigned cpus = (unsigned)MAX((NSUInteger)1, [NSProcessInfo processInfo].activeProcessorCount);
+    fs_pipeline_stage_t stages[3];
+    size_t stageCount = 0;
+    // Compression is the slowest stage per byte, hardware AES the fastest.
+    stages[stageCount++] = (fs_pipeline_stage_t){ SCBackupCompressStage, (void *)context, MAX(1u, cpus / 2) };
+    if (context->key) {
+        stages[stageCount++] = (fs_pipeline_stage_t){ SCBackupEncryptStage, (void *)context, MAX(1u, cpus / 4) };
+    }
+    stages[stageCount++] = (fs_pipeline_stage_t){ SCBackupWriteStage, (void *)context, SC_BACKUP_WRITERS };
+
+    fs_pipeline_config_t config = {
+        .queue_depth = 0,
+        .buffer_size = SC_BACKUP_CHUNK_OVERHEAD + fs_compress_bound(FS_CHUNK_MAX_SIZE),
+    };
+    fs_pipeline_t *pipeline;
+    fs_error_t error = fs_pipeline_create(stages, stageCount, &config, &pipeline);
+    if (error != FS_ERROR_NONE) {
+        return error;
+    }
+
+    for (size_t k = 0; k < count && error == FS_ERROR_NONE; k++) {
+        size_t i = indices[k];
+        size_t start = i ? ends[i - 1] : 0;
+        error = fs_pipeline_submit(pipeline, bytes + start, ends[i] - start, i, NULL);
+    }
+    fs_error_t finished = fs_pipeline_finish(pipeline);
+    fs_pipeline_destroy(pipeline);
+    return error != FS_ERROR_NONE ? error : finished;
+}
+
+@implementation SCBackupParser {
+    dispatch_queue_t _queue;
+    BOOL _storePrepared;
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory {
+    self = [super init];
+    if (self) {
+        _directory = [directory.stringByStandardizingPath copy];
+        _queue = dispatch_queue_create("com.scribblelab.scbackup", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+#pragma mark - Public
+
+- (nullable SCBackup *)backupFileAtPath:(NSString *)filePath {
+    __block SCBackup *backup;
+    dispatch_sync(_queue, ^{
+        backup = [self _backupFileAtPath:filePath keepingRevisions:0];
+    });
+    return backup;
+}
+
+- (nullable SCBackup *)backupFileAtPath:(NSString *)filePath config:(SCConfig *)config {
+    if (![self _shouldBackUpWithConfig:config]) {
+        return nil;
+    }
+
+    NSInteger revisions = config.revisions;
+    __block SCBackup *backup;
+    dispatch_sync(_queue, ^{
+        backup = [self _backupFileAtPath:filePath keepingRevisions:revisions];
+    });
+    return backup;
+}
+
+- (void)backupFileAtPath:(NSString *)filePath
+                  config:(SCConfig *)config
+              completion:(nullable void (^)(SCBackup *_Nullable backup))completion {
+    // Read the settings now; the config may change before the queue gets to it.
+    BOOL localBackup = [self _shouldBackUpWithConfig:config];
+    NSInteger revisions = config.revisions;
+    NSString *path = [filePath copy];
+
+    dispatch_async(_queue, ^{
+        SCBackup *backup = localBackup ? [self _backupFileAtPath:path keepingRevisions:revisions] : nil;
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completion(backup);
+            });
+        }
+    });
+}
+
+- (NSArray<SCBackup *> *)backupsForFileAtPath:(NSString *)filePath {
+    NSMutableArray<SCBackup *> *backups = [NSMutableArray array];
+    dispatch_sync(_queue, ^{
+        NSString *key = SCBackupDocumentKey(filePath);
+        for (NSString *identifier in [self _identifiersForDocumentKey:key]) {
+            SCBackup *backup = [self _backupWithIdentifier:identifier documentKey:key];
+            if (backup) {
+                [backups addObject:backup];
+            }
+        }
+    });
+    return backups;
+}
+
+- (BOOL)restoreBackup:(SCBackup *)backup toPath:(NSString *)path {
+    __block BOOL restored = NO;
+    dispatch_sync(_queue, ^{
+        restored = [self _restoreBackup:backup toPath:path];
+    });
+    return restored;
+}
+
+- (BOOL)removeBackup:(SCBackup *)backup {
+    __block BOOL removed = NO;
+    dispatch_sync(_queue, ^{
+        NSString *manifest = [self _manifestPathForIdentifier:backup.identifier
+                                                  documentKey:SCBackupDocumentKey(backup.filePath)];
+        removed = unlink(manifest.fileSystemRepresentation) == 0;
+    });
+    return removed;
+}
+
+- (NSUInteger)pruneBackupsForFileAtPath:(NSString *)filePath keeping:(NSUInteger)count {
+    __block NSUInteger removed = 0;
+    dispatch_sync(_queue, ^{
+        removed = [self _pruneDocumentKey:SCBackupDocumentKey(filePath) keeping:count];
+    });
+    return removed;
+}
+
+- (NSUInteger)collectGarbage {
+    __block NSUInteger removed = 0;
+    dispatch_sync(_queue, ^{
+        removed = [self _collectGarbage];
+    });
+    return removed;
+}
+
+#pragma mark - Manifests
+
++ (NSData *)manifestDataForBackup:(SCBackup *)backup {
+    NSData *path = [backup.filePath dataUsingEncoding:NSUTF8StringEncoding];
+    size_t idsLength = backup.chunkIDs.length;
+    size_t lengthsLength = backup.chunkLengths.length;
+    size_t total = sizeof(SCBackupManifestHeader) + idsLength + lengthsLength + path.length;
+
+    NSMutableData *data = [NSMutableData dataWithLength:total];
+    uint8_t *bytes = data.mutableBytes;
+
+    SCBackupManifestHeader header = {
+        .magic = SC_BACKUP_MANIFEST_MAGIC,
+        .version = SC_BACKUP_MANIFEST_VERSION,
+        .headerSize = sizeof(SCBackupManifestHeader),
+        .chunkCount = (uint32_t)backup.chunkCount,
+        .pathLength = (uint32_t)path.length,
+        .documentSize = backup.size,
+        .created = (int64_t)llround(backup.date.timeIntervalSince1970 * 1000.0),
+    };
+
+    size_t offset = sizeof(header);
+    memcpy(bytes + offset, backup.chunkIDs.bytes, idsLength);
+    offset += idsLength;
+    memcpy(bytes + offset, backup.chunkLengths.bytes, lengthsLength);
+    offset += lengthsLength;
+    memcpy(bytes + offset, path.bytes, path.length);
+
+    memcpy(bytes, &header, sizeof(header));
+    header.checksum = SCBackupManifestChecksum(bytes, total);
+    memcpy(bytes, &header, sizeof(header));
+    return data;
+}
+
++ (nullable SCBackup *)backupFromManifestData:(NSData *)data identifier:(NSString *)identifier {
+    const uint8_t *bytes = data.bytes;
+    size_t len = data.length;
+
+    SCBackupManifestHeader header;
+    if (len < sizeof(header)) {
+        return nil;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != SC_BACKUP_MANIFEST_MAGIC ||
+        header.version != SC_BACKUP_MANIFEST_VERSION ||
+        header.headerSize != sizeof(header)) {
+        return nil;
+    }
+
+    uint64_t idsLength = (uint64_t)header.chunkCount * sizeof(fs_chunk_id_t);
+    uint64_t lengthsLength = (uint64_t)header.chunkCount * sizeof(uint32_t);
+    if (sizeof(header) + idsLength + lengthsLength + header.pathLength != len ||
+        SCBackupManifestChecksum(bytes, len) != header.checksum) {
+        return nil;
+    }
+
+    size_t offset = sizeof(header);
+    NSData *chunkIDs = [data subdataWithRange:NSMakeRange(offset, (NSUInteger)idsLength)];
+    offset += idsLength;
+    NSData *chunkLengths = [data subdataWithRange:NSMakeRange(offset, (NSUInteger)lengthsLength)];
+    offset += lengthsLength;
+    NSString *filePath = [[NSString alloc] initWithBytes:bytes + offset
+                                                  length:header.pathLength
+                                                encoding:NSUTF8StringEncoding];
+    if (!filePath) {
+        return nil;
+    }
+
+    return [[SCBackup alloc] initWithIdentifier:identifier
+                                       filePath:filePath
+                                           date:[NSDate dateWithTimeIntervalSince1970:header.created / 1000.0]
+                                           size:header.documentSize
+                                       chunkIDs:chunkIDs
+                                   chunkLengths:chunkLengths];
+}
+
+#pragma mark - Private
+
+- (BOOL)_shouldBackUpWithConfig:(SCConfig *)config {
+    if (!config.localBackup) {
+        return NO;
+    }
+    if (config.encryptionEnabled && !self.encryptionKey) {
+        FS_LOG_ERROR("SCBackupParser", "Not backing up an encrypted document without an encryption key");
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Private (on _queue)
+
+- (NSString *)_chunksDirectory {
+    return [_directory stringByAppendingPathComponent:@"chunks"];
+}
+
+- (NSString *)_manifestsDirectory {
+    return [_directory stringByAppendingPathComponent:@"manifests"];
+}
+
+- (NSString *)_manifestPathForIdentifier:(NSString *)identifier documentKey:(NSString *)key {
+    NSString *name = [identifier stringByAppendingPathExtension:SC_BACKUP_MANIFEST_EXTENSION];
+    return [[[self _manifestsDirectory] stringByAppendingPathComponent:key] stringByAppendingPathComponent:name];
+}
+
+/// Creates the chunk directory and its 256 fan-out directories once.
+- (BOOL)_prepareStore {
+    if (_storePrepared) {
+        return YES;
+    }
+
+    NSString *chunks = [self _chunksDirectory];
+    if (![[NSFileManager defaultManager] createDirectoryAtPath:chunks
+                                   withIntermediateDirectories:YES
+                                                    attributes:nil
+                                                         error:nil]) {
+        FS_LOG_ERROR("SCBackupParser", "Could not create backup directory at path: %s", chunks.UTF8String);
+        return NO;
+    }
+    for (unsigned i = 0; i < 256; i++) {
+        NSString *fanout = [chunks stringByAppendingFormat:@"/%02x", i];
+        if (mkdir(fanout.fileSystemRepresentation, 0755) != 0 && errno != EEXIST) {
+            FS_LOG_ERROR("SCBackupParser", "Could not create backup directory at path: %s", fanout.UTF8String);
+            return NO;
+        }
+    }
+    _storePrepared = YES;
+    return YES;
+}
+
+/// Returns the backup identifiers of a document, newest first.
+- (NSArray<NSString *> *)_identifiersForDocumentKey:(NSString *)key {
+    NSString *directory = [[self _manifestsDirectory] stringByAppendingPathComponent:key];
+    NSArray<NSString *> *names = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:nil];
+    NSMutableArray<NSString *> *identifiers = [NSMutableArray arrayWithCapacity:names.count];
+
+    for (NSString *name in names) {
+        if ([name.pathExtension isEqualToString:SC_BACKUP_MANIFEST_EXTENSION]) {
+            [identifiers addObject:name.stringByDeletingPathExtension];
+        }
+    }
+    // Identifiers are fixed-width millisecond timestamps.
+    [identifiers sortUsingComparator:^NSComparisonResult(NSString *a, NSString *b) {
+        return [b compare:a];
+    }];
+    return identifiers;
+}
+
+- (nullable SCBackup *)_backupWithIdentifier:(NSString *)identifier documentKey:(NSString *)key {
+    NSString *path = [self _manifestPathForIdentifier:identifier documentKey:key];
+
+    fs_managed_buffer_t contents;
+    if (fs_io_map(path.fileSystemRepresentation, FS_IO_ADVICE_SEQUENTIAL, &contents) != FS_ERROR_NONE) {
+        return nil;
+    }
+    NSData *data = fs_managed_buffer_nsdata(contents);
+    fs_managed_buffer_release(&contents);
+
+    SCBackup *backup = [SCBackupParser backupFromManifestData:data identifier:identifier];
+    if (!backup) {
+        FS_LOG_ERROR("SCBackupParser", "Ignoring damaged backup manifest at path: %s", path.UTF8String);
+    }
+    return backup;
+}
+
+- (nullable SCBackup *)_backupFileAtPath:(NSString *)filePath keepingRevisions:(NSInteger)revisions {
+    fs_signpost_id_t signpost = FS_SIGNPOST_BEGIN(FS_SIGNPOST_BACKUP);
+    SCBackup *backup = [self _storeBackupOfFileAtPath:filePath keepingRevisions:revisions];
+    FS_SIGNPOST_END(FS_SIGNPOST_BACKUP, signpost);
+    return backup;
+}
+
+- (nullable SCBackup *)_storeBackupOfFileAtPath:(NSString *)filePath keepingRevisions:(NSInteger)revisions {
+    NSString *path = filePath.stringByStandardizingPath;
+    struct stat st;
+    if (stat(path.fileSystemRepresentation, &st) != 0 || !S_ISREG(st.st_mode)) {
+        FS_LOG_ERROR("SCBackupParser", "File does not exist at path: %s", path.UTF8String);
+        return nil;
+    }
+    NSData *encryptionKey = self.encryptionKey;
+    if (encryptionKey && encryptionKey.length != CYFN_AES_KEYLEN) {
+        FS_LOG_ERROR("SCBackupParser", "Encryption key must be %d bytes long", CYFN_AES_KEYLEN);
+        return nil;
+    }
+    if (![self _prepareStore]) {
+        return nil;
+    }
+
+    fs_managed_buffer_t contents;
+    const uint8_t *bytes = NULL;
+    size_t length = 0;
+    BOOL mapped = NO;
+    if (st.st_size > 0) {
+        fs_error_t readError = fs_io_map(path.fileSystemRepresentation, FS_IO_ADVICE_SEQUENTIAL, &contents);
+        if (readError != FS_ERROR_NONE) {
+            FS_LOG_ERROR("SCBackupParser", "Error reading file at path: %s (fs error %d)", path.UTF8String,
+                         (int)readError);
+            return nil;
+        }
+        mapped = YES;
+        bytes = contents.buffer.ptr;
+        length = contents.buffer.len;
+    }
+
+    size_t *ends = NULL;
+    size_t count = 0;
+    if (fs_chunk_split(bytes, length, NULL, &ends, &count) != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCBackupParser", "Out of memory while chunking file at path: %s", path.UTF8String);
+        if (mapped) fs_managed_buffer_release(&contents);
+        return nil;
+    }
+
+    NSMutableData *chunkIDs = [NSMutableData dataWithLength:count * sizeof(fs_chunk_id_t)];
+    NSMutableData *chunkLengths = [NSMutableData dataWithLength:count * sizeof(uint32_t)];
+    fs_chunk_id_t *ids = chunkIDs.mutableBytes;
+    uint32_t *lengths = chunkLengths.mutableBytes;
+
+    // Boundaries need one sequential pass; the chunks are then hashed in parallel.
+    dispatch_apply(count, DISPATCH_APPLY_AUTO, ^(size_t i) {
+        size_t start = i ? ends[i - 1] : 0;
+        lengths[i] = (uint32_t)(ends[i] - start);
+        ids[i] = fs_chunk_hash(bytes + start, ends[i] - start);
+    });
+
+    NSString *key = SCBackupDocumentKey(path);
+    NSArray<NSString *> *identifiers = [self _identifiersForDocumentKey:key];
+    SCBackup *latest = identifiers.count ? [self _backupWithIdentifier:identifiers.firstObject documentKey:key] : nil;
+    // An unchanged document needs no manifest; its chunks are still checked,
+    // in case they predate the encryption key.
+    BOOL unchanged = latest && latest.size == length &&
+                     [latest.chunkIDs isEqualToData:chunkIDs] && [latest.chunkLengths isEqualToData:chunkLengths];
+
+    // Find the chunks not stored yet (or stored unencrypted while encrypting),
+    // then hand each distinct one to the write pipeline once.
+    SCBackupPipelineContext context = {
+        .chunksDirectory = [self _chunksDirectory].fileSystemRepresentation,
+        .ids = ids,
+        .key = encryptionKey.bytes,
+    };
+    uint8_t *missing = calloc(count ? count : 1, 1);
+    size_t *indices = malloc((count ? count : 1) * sizeof(size_t));
+    if (!missing || !indices) {
+        free(missing);
+        free(indices);
+        free(ends);
+        if (mapped) fs_managed_buffer_release(&contents);
+        FS_LOG_ERROR("SCBackupParser", "Out of memory while backing up file at path: %s", path.UTF8String);
+        return nil;
+    }
+    dispatch_apply(count, DISPATCH_APPLY_AUTO, ^(size_t i) {
+        char chunkPath[PATH_MAX];
+        missing[i] = !SCBackupChunkPath(chunkPath, sizeof(chunkPath), context.chunksDirectory, ids[i]) ||
+                     !SCBackupChunkIsStored(chunkPath, context.key != NULL);
+    });
+
+    size_t missingCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (missing[i]) {
+            indices[missingCount++] = i;
+        }
+    }
+    // Repeated content (e.g. runs of zeros) yields the same chunk many times.
+    if (missingCount > 1) {
+        qsort_b(indices, missingCount, sizeof(size_t), ^int(const void *a, const void *b) {
+            int order = SCBackupCompareChunkIDs(&ids[*(const size_t *)a], &ids[*(const size_t *)b]);
+            return order ? order : (*(const size_t *)a < *(const size_t *)b ? -1 : 1);
+        });
+        size_t unique = 1;
+        for (size_t k = 1; k < missingCount; k++) {
+            if (!fs_chunk_id_equal(ids[indices[k]], ids[indices[unique - 1]])) {
+                indices[unique++] = indices[k];
+            }
+        }
+        missingCount = unique;
+    }
+
+    fs_error_t storeError = SCBackupStoreChunks(&context, bytes, ends, indices, missingCount);
+    free(missing);
+    free(indices);
+    free(ends);
+    if (mapped) fs_managed_buffer_release(&contents);
+
+    if (storeError != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCBackupParser", "Error writing backup chunks for file at path: %s (fs error %d)",
+                     path.UTF8String, (int)storeError);
+        return nil;
+    }
+    if (unchanged) {
+        return latest;
+    }
+
+    // Keep identifiers increasing even if the clock went backwards.
+    long long milliseconds = llround([NSDate date].timeIntervalSince1970 * 1000.0);
+    if (identifiers.count) {
+        milliseconds = MAX(milliseconds, identifiers.firstObject.longLongValue + 1);
+    }
+    NSString *identifier = [NSString stringWithFormat:@"%013lld", milliseconds];
+    SCBackup *backup = [[SCBackup alloc] initWithIdentifier:identifier
+                                                   filePath:path
+                                                       date:[NSDate dateWithTimeIntervalSince1970:milliseconds / 1000.0]
+                                                       size:length
+                                                   chunkIDs:chunkIDs
+                                               chunkLengths:chunkLengths];
+
+    NSString *manifestPath = [self _manifestPathForIdentifier:identifier documentKey:key];
+    [[NSFileManager defaultManager] createDirectoryAtPath:manifestPath.stringByDeletingLastPathComponent
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    NSData *manifest = [SCBackupParser manifestDataForBackup:backup];
+    fs_error_t writeError = fs_journal_rewrite(manifestPath.fileSystemRepresentation, manifest.bytes, manifest.length);
+    if (writeError != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCBackupParser", "Error writing backup manifest at path: %s (fs error %d)",
+                     manifestPath.UTF8String, (int)writeError);
+        return nil;
+    }
+
+    if (revisions > 0 && [self _pruneDocumentKey:key keeping:(NSUInteger)revisions]) {
+        [self _collectGarbage];
+    }
+    return backup;
+}
+
+- (BOOL)_restoreBackup:(SCBackup *)backup toPath:(NSString *)path {
+    NSUInteger count = backup.chunkCount;
+    if (backup.size > NSUIntegerMax) {
+        return NO;
+    }
+
+    NSMutableData *contents = [NSMutableData dataWithLength:(NSUInteger)backup.size];
+    size_t *offsets = malloc((count + 1) * sizeof(size_t));
+    if (!contents || !offsets) {
+        free(offsets);
+        FS_LOG_ERROR("SCBackupParser", "Out of memory while restoring backup %s", backup.identifier.UTF8String);
+        return NO;
+    }
+
+    const fs_chunk_id_t *ids = backup.chunkIDs.bytes;
+    const uint32_t *lengths = backup.chunkLengths.bytes;
+    offsets[0] = 0;
+    for (NSUInteger i = 0; i < count; i++) {
+        offsets[i + 1] = offsets[i] + lengths[i];
+    }
+
+    uint8_t *out = contents.mutableBytes;
+    const char *chunksDirectory = [self _chunksDirectory].fileSystemRepresentation;
+    NSData *keyData = self.encryptionKey;
+    const uint8_t *key = keyData.length == CYFN_AES_KEYLEN ? keyData.bytes : NULL;
+    atomic_bool failed = false;
+    atomic_bool *failedRef = &failed;
+    dispatch_apply(count, DISPATCH_APPLY_AUTO, ^(size_t i) {
+        char chunkPath[PATH_MAX];
+        if (!SCBackupChunkPath(chunkPath, sizeof(chunkPath), chunksDirectory, ids[i]) ||
+            !SCBackupLoadChunk(chunkPath, ids[i], key, out + offsets[i], lengths[i]) ||
+            !fs_chunk_id_equal(fs_chunk_hash(out + offsets[i], lengths[i]), ids[i])) {
+            atomic_store(failedRef, true);
+        }
+    });
+    free(offsets);
+
+    if (atomic_load(&failed)) {
+        FS_LOG_ERROR("SCBackupParser", "Backup %s has missing or damaged chunks", backup.identifier.UTF8String);
+        return NO;
+    }
+
+    fs_error_t writeError = fs_journal_rewrite(path.fileSystemRepresentation, out, contents.length);
+    if (writeError != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCBackupParser", "Error restoring backup to path: %s (fs error %d)", path.UTF8String,
+                     (int)writeError);
+        return NO;
+    }
+    return YES;
+}
+
+- (NSUInteger)_pruneDocumentKey:(NSString *)key keeping:(NSUInteger)count {
+    NSArray<NSString *> *identifiers = [self _identifiersForDocumentKey:key];
+    NSUInteger removed = 0;
+
+    for (NSUInteger i = count; i < identifiers.count; i++) {
+        NSString *manifest = [self _manifestPathForIdentifier:identifiers[i] documentKey:key];
+        if (unlink(manifest.fileSystemRepresentation) == 0) {
+            removed++;
+        }
+    }
+    return removed;
+}
+
+- (NSUInteger)_collectGarbage {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *manifests = [self _manifestsDirectory];
+    NSMutableData *live = [NSMutableData data];
+
+    // Mark: every chunk of every manifest. A manifest that cannot be read
+    // might still be needed, so nothing is swept in that case.
+    for (NSString *key in [fileManager contentsOfDirectoryAtPath:manifests error:nil]) {
+        for (NSString *identifier in [self _identifiersForDocumentKey:key]) {
+            SCBackup *backup = [self _backupWithIdentifier:identifier documentKey:key];
+            if (!backup) {
+                FS_LOG_ERROR("SCBackupParser", "Skipping garbage collection in: %s", _directory.UTF8String);
+                return 0;
+            }
+            [live appendData:backup.chunkIDs];
+        }
+    }
+
+    fs_chunk_id_t *ids = live.mutableBytes;
+    size_t count = live.length / sizeof(fs_chunk_id_t);
+    if (count) {
+        qsort(ids, count, sizeof(fs_chunk_id_t), SCBackupCompareChunkIDs);
+    }
+
+    // Sweep. Names that are not ids are temporaries of interrupted writes.
+    NSString *chunks = [self _chunksDirectory];
+    NSUInteger removed = 0;
+    for (unsigned i = 0; i < 256; i++) {
+        NSString *fanout = [chunks stringByAppendingFormat:@"/%02x", i];
+        DIR *dir = opendir(fanout.fileSystemRepresentation);
+        if (!dir) {
+            continue;
+        }
+
+        int dirFd = dirfd(dir);
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            fs_chunk_id_t chunkID;
+            if (!SCBackupParseChunkName(entry->d_name, &chunkID)) {
+                unlinkat(dirFd, entry->d_name, 0);
+                continue;
+            }
+            if (!count || !bsearch(&chunkID, ids, count, sizeof(fs_chunk_id_t), SCBackupCompareChunkIDs)) {
+                if (unlinkat(dirFd, entry->d_name, 0) == 0) {
+                    removed++;
+                }
+            }
+        }
+        closedir(dir);
+    }
+    return removed;
+}
+
+@end
@@ -33,6 +33,19 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class SCConfig;
+
+/// Receives coalesced change notifications from an `SCConfig`.
+NS_AVAILABLE(15, 18)
+@protocol SCConfigObserver <NSObject>
+/// Called on the main queue once per run loop turn in which properties changed.
+///
+/// - Parameters:
+///   - config: The configuration that changed.
+///   - keys: The property names assigned a different value since the last call.
+- (void)config:(SCConfig *)config didChangeKeys:(NSSet<NSString *> *)keys;
+@end
+
 /// **SCConfig** is a configuration model for managing ScribbleLab application settings.
 ///
 /// This class encapsulates **metadata, sync settings, encryption, autosave, and document settings** 
@@ -45,6 +58,19 @@ NS_ASSUME_NONNULL_BEGIN
 NS_AVAILABLE(15, 18)
 @interface SCConfig : NSObject
 
+#pragma mark - Change Tracking
+/// Notified of property changes, coalesced per main run loop turn.
+///
+/// Assigning a property its current value is not a change.
+@property (atomic, weak, nullable) id<SCConfigObserver> observer;
+
+/// `YES` when properties changed since the configuration was last loaded or saved
+/// through `_saveChangesToFileAsync:completion:`.
+@property (nonatomic, readonly, getter=isDirty) BOOL dirty;
+
+/// The property names changed since the configuration was last loaded or saved.
+@property (nonatomic, readonly, copy) NSSet<NSString *> *dirtyKeys;
+
 #pragma mark - Metadata
 /// The creation date of the configuration file.
 /// This is typically set when the document is first created.
@@ -99,7 +125,7 @@ NS_AVAILABLE(15, 18)
 @property (nonatomic, assign) BOOL encryptionEnabled;
 
 /// The encryption algorithm used for securing the document.
-/// Example values: "AES-256", "RSA", "ChaCha20".
+/// Example values: "AES-256", "AES-256-GCM", "RSA", "ChaCha20".
 @property (nonatomic, strong) NSString *encryptionAlgorithm;
 
 /// The encryption key used for securing the document.
@@ -172,6 +198,31 @@ NS_AVAILABLE(15, 18)
 /// @note **Requires write permissions** to the specified directory.
 - (void)_saveConfigToFile:(NSString *)filePath;
 
+/// Saves the configuration to a specified file path without blocking the caller.
+///
+/// The XML is built on the calling thread; writing, flushing and atomically
+/// replacing the file happen on the shared I/O engine, so this is safe to call
+/// from the editing thread (e.g. on every autosave tick).
+///
+/// @param filePath The file path where the configuration should be saved.
+/// @param completion Called with the outcome on a background thread; may be `nil`.
+- (void)_saveConfigToFileAsync:(NSString *)filePath completion:(nullable void (^)(BOOL success))completion;
+
+/// Saves the configuration like `_saveConfigToFileAsync:completion:`, but only if it is dirty.
+///
+/// The XML is built and the dirty set cleared in one step, so changes made
+/// while the write is in flight are picked up by the next call. If the write
+/// fails, the keys it covered are marked dirty again.
+///
+/// @param filePath The file path where the configuration should be saved.
+/// @param completion Called with the outcome on a background thread; may be `nil`.
+///                   Not called when nothing was written.
+/// @return `NO` without writing when nothing changed.
+- (BOOL)_saveChangesToFileAsync:(NSString *)filePath completion:(nullable void (^)(BOOL success))completion;
+
+/// Forgets all recorded changes, e.g. after the configuration was loaded from disk.
+- (void)_resetChangeTracking;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -30,33 +30,173 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #import "SCConfig.h"
+#import "SCConfigCache.h"
+#include <fs/fslog.h>
+#include <fs/io.h>
+#include <os/lock.h>
 
-@implementation SCConfig
+/*
+ Every setter goes through one of these: the assignment happens under `_lock`
+ (so a save can snapshot the XML consistently from another thread) and only a
+ different value records the key as changed.
+ */
+#define SC_CONFIG_OBJECT_SETTER(type, name, Name)                     \
+    - (void)set##Name:(type)value {                                   \
+        os_unfair_lock_lock(&_lock);                                  \
+        BOOL changed = !(_##name == value || [_##name isEqual:value]); \
+        if (changed) {                                                \
+            _##name = value;                                          \
+        }                                                             \
+        os_unfair_lock_unlock(&_lock);                                \
+        if (changed) {                                                \
+            [self _noteChangedKey:@#name];                            \
+        }                                                             \
+    }
 
-- (void)_saveConfigToFile:(NSString *)filePath {
+#define SC_CONFIG_SCALAR_SETTER(type, name, Name)                     \
+    - (void)set##Name:(type)value {                                   \
+        os_unfair_lock_lock(&_lock);                                  \
+        BOOL changed = (_##name != value);                            \
+        _##name = value;                                              \
+        os_unfair_lock_unlock(&_lock);                                \
+        if (changed) {                                                \
+            [self _noteChangedKey:@#name];                            \
+        }                                                             \
+    }
+
+@implementation SCConfig {
+    os_unfair_lock _lock;
+    // Changed since the last load or save.
+    NSMutableSet<NSString *> *_dirtyKeys;
+    // Changed since the observer was last notified.
+    NSMutableSet<NSString *> *_pendingKeys;
+    BOOL _notifyScheduled;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _dirtyKeys = [[NSMutableSet alloc] init];
+        _pendingKeys = [[NSMutableSet alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Setters
+
+SC_CONFIG_OBJECT_SETTER(NSString *, created, Created)
+SC_CONFIG_OBJECT_SETTER(NSString *, modified, Modified)
+SC_CONFIG_OBJECT_SETTER(NSString *, author, Author)
+SC_CONFIG_OBJECT_SETTER(NSString *, title, Title)
+SC_CONFIG_OBJECT_SETTER(NSString *, theme, Theme)
+SC_CONFIG_SCALAR_SETTER(BOOL, syncEnabled, SyncEnabled)
+SC_CONFIG_OBJECT_SETTER(NSString *, syncProvider, SyncProvider)
+SC_CONFIG_SCALAR_SETTER(NSInteger, syncFrequency, SyncFrequency)
+SC_CONFIG_SCALAR_SETTER(BOOL, syncOnSave, SyncOnSave)
+SC_CONFIG_SCALAR_SETTER(BOOL, periodicSync, PeriodicSync)
+SC_CONFIG_SCALAR_SETTER(BOOL, cloudSync, CloudSync)
+SC_CONFIG_SCALAR_SETTER(BOOL, localBackup, LocalBackup)
+SC_CONFIG_SCALAR_SETTER(BOOL, encryptionEnabled, EncryptionEnabled)
+SC_CONFIG_OBJECT_SETTER(NSString *, encryptionAlgorithm, EncryptionAlgorithm)
+SC_CONFIG_OBJECT_SETTER(NSString *, encryptionKey, EncryptionKey)
+SC_CONFIG_SCALAR_SETTER(NSInteger, encryptionKeyLength, EncryptionKeyLength)
+SC_CONFIG_SCALAR_SETTER(NSInteger, autosaveInterval, AutosaveInterval)
+SC_CONFIG_SCALAR_SETTER(NSInteger, revisions, Revisions)
+SC_CONFIG_OBJECT_SETTER(NSString *, canvasSize, CanvasSize)
+SC_CONFIG_OBJECT_SETTER(NSString *, pageOrientation, PageOrientation)
+SC_CONFIG_OBJECT_SETTER(NSString *, background, Background)
+SC_CONFIG_SCALAR_SETTER(NSInteger, dpi, Dpi)
+SC_CONFIG_OBJECT_SETTER(NSString *, margins, Margins)
+SC_CONFIG_OBJECT_SETTER(NSString *, lineSpacing, LineSpacing)
+SC_CONFIG_OBJECT_SETTER(NSString *, colorSpace, ColorSpace)
+SC_CONFIG_SCALAR_SETTER(NSInteger, bitDepth, BitDepth)
+SC_CONFIG_OBJECT_SETTER(NSString *, resolution, Resolution)
+SC_CONFIG_OBJECT_SETTER(NSString *, lineCoding, LineCoding)
+
+#pragma mark - Change Tracking
+
+- (void)_noteChangedKey:(NSString *)key {
+    BOOL schedule = NO;
+
+    os_unfair_lock_lock(&_lock);
+    [_dirtyKeys addObject:key];
+    [_pendingKeys addObject:key];
+    if (!_notifyScheduled) {
+        _notifyScheduled = YES;
+        schedule = YES;
+    }
+    os_unfair_lock_unlock(&_lock);
+
+    if (schedule) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self _deliverChanges];
+        });
+    }
+}
+
+- (void)_deliverChanges {
+    os_unfair_lock_lock(&_lock);
+    NSSet<NSString *> *keys = [_pendingKeys copy];
+    [_pendingKeys removeAllObjects];
+    _notifyScheduled = NO;
+    os_unfair_lock_unlock(&_lock);
+
+    id<SCConfigObserver> observer = self.observer;
+    if (keys.count != 0 && observer) {
+        [observer config:self didChangeKeys:keys];
+    }
+}
+
+- (BOOL)isDirty {
+    os_unfair_lock_lock(&_lock);
+    BOOL dirty = _dirtyKeys.count != 0;
+    os_unfair_lock_unlock(&_lock);
+    return dirty;
+}
+
+- (NSSet<NSString *> *)dirtyKeys {
+    os_unfair_lock_lock(&_lock);
+    NSSet<NSString *> *keys = [_dirtyKeys copy];
+    os_unfair_lock_unlock(&_lock);
+    return keys;
+}
+
+- (void)_resetChangeTracking {
+    os_unfair_lock_lock(&_lock);
+    [_dirtyKeys removeAllObjects];
+    [_pendingKeys removeAllObjects];
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Serialization
+
+- (NSString *)_configXMLString {
     NSMutableString *xmlContent = [NSMutableString stringWithString:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"];
     [xmlContent appendString:@"<scconfig>\n"];
 
+    // Unset fields are NSNull so the literal does not throw; they are skipped.
+    NSNull *unset = [NSNull null];
     NSDictionary *fields = @{
-        @"created": self.created,
-        @"modified": self.modified,
-        @"author": self.author,
-        @"title": self.title,
-        @"theme": self.theme,
-        @"provider": self.syncProvider,
-        @"algorithm": self.encryptionAlgorithm,
-        @"key": self.encryptionKey,
-        @"canvasSize": self.canvasSize,
-        @"pageOrientation": self.pageOrientation,
-        @"background": self.background,
-        @"margins": self.margins,
-        @"lineSpacing": self.lineSpacing,
-        @"resolution": self.resolution,
-        @"lineCoding": self.lineCoding
+        @"created": self.created ?: unset,
+        @"modified": self.modified ?: unset,
+        @"author": self.author ?: unset,
+        @"title": self.title ?: unset,
+        @"theme": self.theme ?: unset,
+        @"provider": self.syncProvider ?: unset,
+        @"algorithm": self.encryptionAlgorithm ?: unset,
+        @"key": self.encryptionKey ?: unset,
+        @"canvasSize": self.canvasSize ?: unset,
+        @"pageOrientation": self.pageOrientation ?: unset,
+        @"background": self.background ?: unset,
+        @"margins": self.margins ?: unset,
+        @"lineSpacing": self.lineSpacing ?: unset,
+        @"resolution": self.resolution ?: unset,
+        @"lineCoding": self.lineCoding ?: unset
     };
 
     for (NSString *key in fields) {
-        if (fields[key]) {
+        if (fields[key] != unset) {
             [xmlContent appendFormat:@"  <%@>%@</%@>\n", key, fields[key], key];
         }
     }
@@ -88,12 +228,81 @@
     }
 
     [xmlContent appendString:@"</scconfig>\n"];
+    return xmlContent;
+}
+
+- (void)_saveConfigToFile:(NSString *)filePath {
+    os_unfair_lock_lock(&_lock);
+    NSString *xmlContent = [self _configXMLString];
+    NSMutableData *cacheData = [self _cacheData];
+    os_unfair_lock_unlock(&_lock);
 
     NSError *error;
     [xmlContent writeToFile:filePath atomically:YES encoding:NSUTF8StringEncoding error:&error];
 
     if (error) {
-        NSLog(@"[SCConfig] Failed to save config file: %@", error.localizedDescription);
+        FS_LOG_ERROR("SCConfig", "Failed to save config file: %s", error.localizedDescription.UTF8String);
+        return;
+    }
+    [SCConfig _writeCacheData:cacheData forFile:filePath];
+}
+
+- (void)_saveConfigToFileAsync:(NSString *)filePath completion:(nullable void (^)(BOOL success))completion {
+    // Serializing is cheap; the write, flush and rename run on the I/O engine.
+    os_unfair_lock_lock(&_lock);
+    NSData *xmlData = [[self _configXMLString] dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableData *cacheData = [self _cacheData];
+    os_unfair_lock_unlock(&_lock);
+
+    [self _writeConfigData:xmlData cacheData:cacheData toFile:filePath completion:completion];
+}
+
+- (BOOL)_saveChangesToFileAsync:(NSString *)filePath completion:(nullable void (^)(BOOL success))completion {
+    os_unfair_lock_lock(&_lock);
+    if (_dirtyKeys.count == 0) {
+        os_unfair_lock_unlock(&_lock);
+        return NO;
+    }
+    NSSet<NSString *> *keys = [_dirtyKeys copy];
+    [_dirtyKeys removeAllObjects];
+    NSData *xmlData = [[self _configXMLString] dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableData *cacheData = [self _cacheData];
+    os_unfair_lock_unlock(&_lock);
+
+    __weak SCConfig *weakSelf = self;
+    [self _writeConfigData:xmlData cacheData:cacheData toFile:filePath completion:^(BOOL success) {
+        SCConfig *config = weakSelf;
+        if (!success && config) {
+            os_unfair_lock_lock(&config->_lock);
+            [config->_dirtyKeys unionSet:keys];
+            os_unfair_lock_unlock(&config->_lock);
+        }
+        if (completion) {
+            completion(success);
+        }
+    }];
+    return YES;
+}
+
+// The cache is stamped with the file these bytes went to, not whatever is at the path by now.
+- (void)_writeConfigData:(NSData *)xmlData cacheData:(NSMutableData *)cacheData toFile:(NSString *)filePath
+              completion:(nullable void (^)(BOOL success))completion {
+    fs_error_t error = fs_io_save_nsdata_stamped_async(xmlData, filePath, ^(fs_error_t result, fs_io_stamp_t stamp) {
+        if (result != FS_ERROR_NONE) {
+            FS_LOG_ERROR("SCConfig", "Failed to save config file: %s (fs error %d)", filePath.UTF8String, (int)result);
+        } else {
+            [SCConfig _writeCacheData:cacheData forFile:filePath stamp:stamp];
+        }
+        if (completion) {
+            completion(result == FS_ERROR_NONE);
+        }
+    });
+
+    if (error != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCConfig", "Failed to save config file: %s (fs error %d)", filePath.UTF8String, (int)error);
+        if (completion) {
+            completion(NO);
+        }
     }
 }
 
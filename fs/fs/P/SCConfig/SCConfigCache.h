@@ -0,0 +1,76 @@
+//
+//  SCConfigCache.h
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//  Private interface shared by SCConfig and SCConfigParser. Not a public header.
+
+#import <Foundation/Foundation.h>
+#import "SCConfig.h"
+#include <fs/io.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Version of the binary cache layout; bump on any change to SCConfigCache.m.
+#define SC_CONFIG_CACHE_VERSION 1
+
+/// Returns the path of the binary cache kept next to the XML config at `configPath`.
+FOUNDATION_EXTERN NSString *SCConfigCachePath(NSString *configPath);
+
+/// A compact, memory-mappable binary form of `SCConfig`.
+///
+/// The XML file stays canonical; the cache records the size and modification
+/// time of the XML it was built from and is ignored as soon as either differs,
+/// the checksum fails, or the layout version changed.
+@interface SCConfig (SCConfigCache)
+
+/// Loads the configuration from the cache of the XML file at `filePath`.
+///
+/// @return `nil` if the cache is missing, corrupt or older than the XML file.
++ (nullable SCConfig *)_configFromCacheForFile:(NSString *)filePath;
+
+/// Encodes the current values. The result is stamped with the XML file's
+/// size and modification time by `_writeCacheData:forFile:`.
+///
+/// @note Reads the properties directly; callers serialize against writers the
+///       same way they do for `_configXMLString`.
+- (NSMutableData *)_cacheData;
+
+/// Stamps `data` with the current size and modification time of `filePath`
+/// and saves it to the cache path on the I/O engine. Does nothing if the XML
+/// file cannot be examined.
++ (void)_writeCacheData:(NSMutableData *)data forFile:(NSString *)filePath;
+
+/// Stamps `data` with `stamp`, the XML file's as written by the caller, and
+/// saves it to the cache path on the I/O engine.
++ (void)_writeCacheData:(NSMutableData *)data forFile:(NSString *)filePath stamp:(fs_io_stamp_t)stamp;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,305 @@
+//
+//  SCConfigCache.m
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import "SCConfigCache.h"
+#include <fs/fslog.h>
+#include <fs/io.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+ Layout (native byte order; the magic doubles as an endianness check):
+
+   SCConfigCacheHeader   fixed-offset numeric fields and the string directory
+   string bytes          UTF-8, each NUL-terminated, addressed by the directory
+
+ The checksum is FNV-1a over every byte after the `checksum` field, so it also
+ covers the source stamp and the string table.
+ */
+#define SC_CONFIG_CACHE_MAGIC 0x42434353u /* "SCCB" */
+#define SC_CONFIG_CACHE_NIL UINT32_MAX
+
+typedef NS_ENUM(uint32_t, SCConfigCacheString) {
+    SCConfigCacheStringCreated,
+    SCConfigCacheStringModified,
+    SCConfigCacheStringAuthor,
+    SCConfigCacheStringTitle,
+    SCConfigCacheStringTheme,
+    SCConfigCacheStringSyncProvider,
+    SCConfigCacheStringEncryptionAlgorithm,
+    SCConfigCacheStringEncryptionKey,
+    SCConfigCacheStringCanvasSize,
+    SCConfigCacheStringPageOrientation,
+    SCConfigCacheStringBackground,
+    SCConfigCacheStringMargins,
+    SCConfigCacheStringLineSpacing,
+    SCConfigCacheStringColorSpace,
+    SCConfigCacheStringResolution,
+    SCConfigCacheStringLineCoding,
+    SCConfigCacheStringCount
+};
+
+typedef NS_ENUM(uint32_t, SCConfigCacheInteger) {
+    SCConfigCacheIntegerSyncFrequency,
+    SCConfigCacheIntegerEncryptionKeyLength,
+    SCConfigCacheIntegerAutosaveInterval,
+    SCConfigCacheIntegerRevisions,
+    SCConfigCacheIntegerDpi,
+    SCConfigCacheIntegerBitDepth,
+    SCConfigCacheIntegerCount
+};
+
+typedef NS_OPTIONS(uint32_t, SCConfigCacheFlags) {
+    SCConfigCacheFlagSyncEnabled       = 1u << 0,
+    SCConfigCacheFlagSyncOnSave        = 1u << 1,
+    SCConfigCacheFlagPeriodicSync      = 1u << 2,
+    SCConfigCacheFlagCloudSync         = 1u << 3,
+    SCConfigCacheFlagLocalBackup       = 1u << 4,
+    SCConfigCacheFlagEncryptionEnabled = 1u << 5,
+};
+
+typedef struct {
+    uint32_t offset;  // from the start of the file, or SC_CONFIG_CACHE_NIL
+    uint32_t length;  // in bytes, excluding the terminating NUL
+} SCConfigCacheStringRef;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t fileSize;
+    uint32_t checksum;
+    int64_t sourceMtimeSec;
+    int64_t sourceMtimeNsec;
+    uint64_t sourceSize;
+    uint32_t flags;
+    uint32_t reserved;
+    int64_t integers[SCConfigCacheIntegerCount];
+    SCConfigCacheStringRef strings[SCConfigCacheStringCount];
+} SCConfigCacheHeader;
+
+_Static_assert(sizeof(SCConfigCacheHeader) % 8 == 0, "string table must stay 8-byte aligned");
+
+#define SC_CONFIG_CACHE_CHECKED_FROM (offsetof(SCConfigCacheHeader, checksum) + sizeof(uint32_t))
+
+static uint32_t SCConfigCacheChecksum(const uint8_t *bytes, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = SC_CONFIG_CACHE_CHECKED_FROM; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+NSString *SCConfigCachePath(NSString *configPath) {
+    return [configPath stringByAppendingPathExtension:@"sccache"];
+}
+
+@implementation SCConfig (SCConfigCache)
+
++ (nullable SCConfig *)_configFromCacheForFile:(NSString *)filePath {
+    struct stat source;
+    if (stat(filePath.fileSystemRepresentation, &source) != 0) {
+        return nil;
+    }
+
+    fs_managed_buffer_t contents;
+    if (fs_io_map(SCConfigCachePath(filePath).fileSystemRepresentation, FS_IO_ADVICE_WILLNEED, &contents) != FS_ERROR_NONE) {
+        return nil;
+    }
+
+    SCConfig *config = [self _configFromCacheBytes:contents.buffer.ptr length:contents.buffer.len source:&source];
+    fs_managed_buffer_release(&contents);
+    return config;
+}
+
++ (nullable SCConfig *)_configFromCacheBytes:(const uint8_t *)bytes length:(size_t)len source:(const struct stat *)source {
+    SCConfigCacheHeader header;
+    if (len < sizeof(header)) {
+        return nil;
+    }
+    memcpy(&header, bytes, sizeof(header));
+
+    if (header.magic != SC_CONFIG_CACHE_MAGIC || header.version != SC_CONFIG_CACHE_VERSION ||
+        header.headerSize != sizeof(header) || header.fileSize != len ||
+        header.checksum != SCConfigCacheChecksum(bytes, len)) {
+        return nil;
+    }
+    if (header.sourceSize != (uint64_t)source->st_size ||
+        header.sourceMtimeSec != (int64_t)source->st_mtimespec.tv_sec ||
+        header.sourceMtimeNsec != (int64_t)source->st_mtimespec.tv_nsec) {
+        return nil;
+    }
+
+    NSString *strings[SCConfigCacheStringCount];
+    for (uint32_t i = 0; i < SCConfigCacheStringCount; i++) {
+        SCConfigCacheStringRef ref = header.strings[i];
+        strings[i] = nil;
+        if (ref.offset == SC_CONFIG_CACHE_NIL) {
+            continue;
+        }
+        if (ref.offset < sizeof(header) || ref.offset > len || ref.length >= len - ref.offset) {
+            return nil;
+        }
+        strings[i] = [[NSString alloc] initWithBytes:bytes + ref.offset length:ref.length encoding:NSUTF8StringEncoding];
+        if (!strings[i]) {
+            return nil;
+        }
+    }
+
+    SCConfig *config = [[SCConfig alloc] init];
+    config.created = strings[SCConfigCacheStringCreated];
+    config.modified = strings[SCConfigCacheStringModified];
+    config.author = strings[SCConfigCacheStringAuthor];
+    config.title = strings[SCConfigCacheStringTitle];
+    config.theme = strings[SCConfigCacheStringTheme];
+    config.syncProvider = strings[SCConfigCacheStringSyncProvider];
+    config.encryptionAlgorithm = strings[SCConfigCacheStringEncryptionAlgorithm];
+    config.encryptionKey = strings[SCConfigCacheStringEncryptionKey];
+    config.canvasSize = strings[SCConfigCacheStringCanvasSize];
+    config.pageOrientation = strings[SCConfigCacheStringPageOrientation];
+    config.background = strings[SCConfigCacheStringBackground];
+    config.margins = strings[SCConfigCacheStringMargins];
+    config.lineSpacing = strings[SCConfigCacheStringLineSpacing];
+    config.colorSpace = strings[SCConfigCacheStringColorSpace];
+    config.resolution = strings[SCConfigCacheStringResolution];
+    config.lineCoding = strings[SCConfigCacheStringLineCoding];
+
+    config.syncFrequency = (NSInteger)header.integers[SCConfigCacheIntegerSyncFrequency];
+    config.encryptionKeyLength = (NSInteger)header.integers[SCConfigCacheIntegerEncryptionKeyLength];
+    config.autosaveInterval = (NSInteger)header.integers[SCConfigCacheIntegerAutosaveInterval];
+    config.revisions = (NSInteger)header.integers[SCConfigCacheIntegerRevisions];
+    config.dpi = (NSInteger)header.integers[SCConfigCacheIntegerDpi];
+    config.bitDepth = (NSInteger)header.integers[SCConfigCacheIntegerBitDepth];
+
+    config.syncEnabled = (header.flags & SCConfigCacheFlagSyncEnabled) != 0;
+    config.syncOnSave = (header.flags & SCConfigCacheFlagSyncOnSave) != 0;
+    config.periodicSync = (header.flags & SCConfigCacheFlagPeriodicSync) != 0;
+    config.cloudSync = (header.flags & SCConfigCacheFlagCloudSync) != 0;
+    config.localBackup = (header.flags & SCConfigCacheFlagLocalBackup) != 0;
+    config.encryptionEnabled = (header.flags & SCConfigCacheFlagEncryptionEnabled) != 0;
+
+    // Loaded state matches the file on disk.
+    [config _resetChangeTracking];
+    return config;
+}
+
+- (NSMutableData *)_cacheData {
+    NSString *strings[SCConfigCacheStringCount] = {
+        [SCConfigCacheStringCreated] = self.created,
+        [SCConfigCacheStringModified] = self.modified,
+        [SCConfigCacheStringAuthor] = self.author,
+        [SCConfigCacheStringTitle] = self.title,
+        [SCConfigCacheStringTheme] = self.theme,
+        [SCConfigCacheStringSyncProvider] = self.syncProvider,
+        [SCConfigCacheStringEncryptionAlgorithm] = self.encryptionAlgorithm,
+        [SCConfigCacheStringEncryptionKey] = self.encryptionKey,
+        [SCConfigCacheStringCanvasSize] = self.canvasSize,
+        [SCConfigCacheStringPageOrientation] = self.pageOrientation,
+        [SCConfigCacheStringBackground] = self.background,
+        [SCConfigCacheStringMargins] = self.margins,
+        [SCConfigCacheStringLineSpacing] = self.lineSpacing,
+        [SCConfigCacheStringColorSpace] = self.colorSpace,
+        [SCConfigCacheStringResolution] = self.resolution,
+        [SCConfigCacheStringLineCoding] = self.lineCoding,
+    };
+
+    SCConfigCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SC_CONFIG_CACHE_MAGIC;
+    header.version = SC_CONFIG_CACHE_VERSION;
+    header.headerSize = sizeof(header);
+
+    header.integers[SCConfigCacheIntegerSyncFrequency] = self.syncFrequency;
+    header.integers[SCConfigCacheIntegerEncryptionKeyLength] = self.encryptionKeyLength;
+    header.integers[SCConfigCacheIntegerAutosaveInterval] = self.autosaveInterval;
+    header.integers[SCConfigCacheIntegerRevisions] = self.revisions;
+    header.integers[SCConfigCacheIntegerDpi] = self.dpi;
+    header.integers[SCConfigCacheIntegerBitDepth] = self.bitDepth;
+
+    header.flags = (self.syncEnabled ? SCConfigCacheFlagSyncEnabled : 0) |
+                   (self.syncOnSave ? SCConfigCacheFlagSyncOnSave : 0) |
+                   (self.periodicSync ? SCConfigCacheFlagPeriodicSync : 0) |
+                   (self.cloudSync ? SCConfigCacheFlagCloudSync : 0) |
+                   (self.localBackup ? SCConfigCacheFlagLocalBackup : 0) |
+                   (self.encryptionEnabled ? SCConfigCacheFlagEncryptionEnabled : 0);
+
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(header)];
+    for (uint32_t i = 0; i < SCConfigCacheStringCount; i++) {
+        const char *utf8 = strings[i].UTF8String;
+        if (!utf8) {
+            header.strings[i] = (SCConfigCacheStringRef){ SC_CONFIG_CACHE_NIL, 0 };
+            continue;
+        }
+        size_t length = strlen(utf8);
+        header.strings[i] = (SCConfigCacheStringRef){ (uint32_t)data.length, (uint32_t)length };
+        [data appendBytes:utf8 length:length + 1];
+    }
+
+    header.fileSize = (uint32_t)data.length;
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(header)) withBytes:&header];
+    return data;
+}
+
++ (void)_writeCacheData:(NSMutableData *)data forFile:(NSString *)filePath {
+    struct stat source;
+    if (stat(filePath.fileSystemRepresentation, &source) != 0) {
+        return;
+    }
+    fs_io_stamp_t stamp = {
+        (uint64_t)source.st_size,
+        (int64_t)source.st_mtimespec.tv_sec,
+        (int64_t)source.st_mtimespec.tv_nsec,
+    };
+    [self _writeCacheData:data forFile:filePath stamp:stamp];
+}
+
++ (void)_writeCacheData:(NSMutableData *)data forFile:(NSString *)filePath stamp:(fs_io_stamp_t)stamp {
+    if (data.length < sizeof(SCConfigCacheHeader)) {
+        return;
+    }
+
+    SCConfigCacheHeader *header = (SCConfigCacheHeader *)data.mutableBytes;
+    header->sourceMtimeSec = stamp.mtime_sec;
+    header->sourceMtimeNsec = stamp.mtime_nsec;
+    header->sourceSize = stamp.size;
+    header->checksum = SCConfigCacheChecksum(data.bytes, data.length);
+
+    NSString *cachePath = SCConfigCachePath(filePath);
+    fs_io_save_nsdata_async(data, cachePath, ^(fs_error_t result) {
+        if (result != FS_ERROR_NONE) {
+            FS_LOG_ERROR("SCConfig", "Failed to write config cache: %s (fs error %d)", cachePath.UTF8String,
+                         (int)result);
+        }
+    });
+}
+
+@end
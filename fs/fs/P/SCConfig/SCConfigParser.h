@@ -56,8 +56,18 @@ NS_AVAILABLE(15, 18)
 /// Use this method to respond to configuration changes, such as  
 /// reloading UI elements, updating settings, or refreshing stored values
 - (void)configDidChange;
+
+@optional
+/// Called instead of `configDidChange` with the property names that changed.
+///
+/// Changes are coalesced: one call covers every assignment made during a
+/// main run loop turn. Delivered on the main queue.
+- (void)configDidChangeKeys:(NSSet<NSString *> *)keys;
 @end
 
+/// Seconds without further changes before a modified configuration is saved.
+FOUNDATION_EXPORT const NSTimeInterval SCConfigParserSaveDelay NS_AVAILABLE(15, 18);
+
 /// A class responsible for parsing and managing configuration files.
 ///
 /// This parser reads an XML-based configuration file, extracts settings,  
@@ -68,6 +78,10 @@ NS_AVAILABLE(15, 18)
 /// ensuring that changes to the configuration file are reflected within  
 /// the ScribbleLabApp without requiring a restart.
 ///
+/// Changes to `config` are written behind: once no property has changed for
+/// `SCConfigParserSaveDelay` seconds, the file is rewritten in the background,
+/// and not at all if nothing actually changed.
+///
 /// ```objc
 /// SCConfigParser *parser = [[SCConfigParser alloc] initWithXML:@"config.xml"];
 /// if ([parser parse]) {
@@ -76,14 +90,16 @@ NS_AVAILABLE(15, 18)
 /// }
 /// ```
 NS_CLASS_AVAILABLE(15, 18)
-@interface SCConfigParser : NSObject <NSXMLParserDelegate>
+@interface SCConfigParser : NSObject <NSXMLParserDelegate, SCConfigObserver>
 
 #pragma mark - Properties
 /// The current configuration object parsed from the file.
 ///
 /// This object contains all the settings extracted from the XML file.  
-/// Any modifications made to this object **do not** automatically persist  
-/// to disk. Call `saveConfigToFile:` to store changes.
+/// Modifications made to this object are saved to `configFilePath`  
+/// `SCConfigParserSaveDelay` seconds after the last one. Call  
+/// `flushPendingChanges` to start that save right away, or  
+/// `saveConfigToFile:` to write the configuration elsewhere.
 ///
 /// - Note: This property is marked as `atomic` for thread safety.
 @property (atomic, strong) SCConfig *config;
@@ -118,6 +134,17 @@ NS_CLASS_AVAILABLE(15, 18)
 /// - Returns: An instance of `SCConfigParser` ready for parsing.
 - (nullable instancetype)initWithXML:(NSString *)filePath NS_DESIGNATED_INITIALIZER;
 
+/// Loads a configuration file on a background worker of the shared `SCDocumentLoader`.
+///
+/// Use `-[SCDocumentLoader loadConfigsAtPaths:completion:batchCompletion:]`
+/// to load many documents at once or to cancel loads.
+///
+/// - Parameters:
+///   - filePath: The full path to the XML configuration file.
+///   - completion: Called on the main queue with the parser, or `nil` if the file could not be read.
++ (void)loadConfigAtPath:(NSString *)filePath
+              completion:(void (^)(SCConfigParser *_Nullable parser))completion;
+
 #pragma mark - Methods
 /// Parses the XML configuration file.
 ///
@@ -141,6 +168,15 @@ NS_CLASS_AVAILABLE(15, 18)
 ///   to write to the file.
 - (void)saveConfigToFile:(NSString *)filePath;
 
+/// Schedules a write-behind save of `config` to `configFilePath`.
+///
+/// Calls within `SCConfigParserSaveDelay` of each other collapse into one
+/// write, which is skipped if `config` has no unsaved changes.
+- (void)configDidChange;
+
+/// Starts any pending write-behind save immediately.
+- (void)flushPendingChanges;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -45,14 +45,166 @@
 
 #import "SCConfig.h"
 #import "SCConfigParser.h"
+#import "SCConfigCache.h"
+#import "SCDocumentLoader.h"
 #include <Foundation/Foundation.h>
+#include <fs/fslog.h>
+#include <fs/io.h>
+#include <os/lock.h>
 
-@interface SCConfigParser ()
-@property (nonatomic, strong, nullable) NSMutableString *currentElementValue;
+const NSTimeInterval SCConfigParserSaveDelay = 1.0;
+
+typedef NS_ENUM(uint8_t, SCConfigField) {
+    SCConfigFieldNone = 0,
+    SCConfigFieldRoot,
+    SCConfigFieldCreated,
+    SCConfigFieldModified,
+    SCConfigFieldAuthor,
+    SCConfigFieldTitle,
+    SCConfigFieldTheme,
+    SCConfigFieldSyncEnabled,
+    SCConfigFieldSyncProvider,
+    SCConfigFieldSyncFrequency,
+    SCConfigFieldSyncOnSave,
+    SCConfigFieldPeriodicSync,
+    SCConfigFieldCloudSync,
+    SCConfigFieldLocalBackup,
+    SCConfigFieldEncryptionEnabled,
+    SCConfigFieldEncryptionAlgorithm,
+    SCConfigFieldEncryptionKey,
+    SCConfigFieldEncryptionKeyLength,
+    SCConfigFieldAutosaveInterval,
+    SCConfigFieldRevisions,
+    SCConfigFieldCanvasSize,
+    SCConfigFieldPageOrientation,
+    SCConfigFieldBackground,
+    SCConfigFieldDpi,
+    SCConfigFieldMargins,
+    SCConfigFieldLineSpacing,
+    SCConfigFieldColorSpace,
+    SCConfigFieldBitDepth,
+    SCConfigFieldResolution,
+    SCConfigFieldLineCoding,
+};
+
+typedef struct {
+    const char *tag;
+    SCConfigField field;
+} SCConfigTag;
+
+// Tags written by -[SCConfig _configXMLString], followed by the property
+// names of the fields whose tag differs, which older files may still use.
+static const SCConfigTag SCConfigTags[] = {
+    { "scconfig",            SCConfigFieldRoot },
+    { "created",             SCConfigFieldCreated },
+    { "modified",            SCConfigFieldModified },
+    { "author",              SCConfigFieldAuthor },
+    { "title",               SCConfigFieldTitle },
+    { "theme",               SCConfigFieldTheme },
+    { "enabled",             SCConfigFieldSyncEnabled },
+    { "provider",            SCConfigFieldSyncProvider },
+    { "frequency",           SCConfigFieldSyncFrequency },
+    { "syncOnSave",          SCConfigFieldSyncOnSave },
+    { "periodicSync",        SCConfigFieldPeriodicSync },
+    { "cloudSync",           SCConfigFieldCloudSync },
+    { "localBackup",         SCConfigFieldLocalBackup },
+    { "encryption",          SCConfigFieldEncryptionEnabled },
+    { "algorithm",           SCConfigFieldEncryptionAlgorithm },
+    { "key",                 SCConfigFieldEncryptionKey },
+    { "keyLength",           SCConfigFieldEncryptionKeyLength },
+    { "autosave",            SCConfigFieldAutosaveInterval },
+    { "revisions",           SCConfigFieldRevisions },
+    { "canvasSize",          SCConfigFieldCanvasSize },
+    { "pageOrientation",     SCConfigFieldPageOrientation },
+    { "background",          SCConfigFieldBackground },
+    { "dpi",                 SCConfigFieldDpi },
+    { "margins",             SCConfigFieldMargins },
+    { "lineSpacing",         SCConfigFieldLineSpacing },
+    { "colorSpace",          SCConfigFieldColorSpace },
+    { "bitDepth",            SCConfigFieldBitDepth },
+    { "resolution",          SCConfigFieldResolution },
+    { "lineCoding",          SCConfigFieldLineCoding },
+    { "syncEnabled",         SCConfigFieldSyncEnabled },
+    { "syncProvider",        SCConfigFieldSyncProvider },
+    { "syncFrequency",       SCConfigFieldSyncFrequency },
+    { "encryptionEnabled",   SCConfigFieldEncryptionEnabled },
+    { "encryptionAlgorithm", SCConfigFieldEncryptionAlgorithm },
+    { "encryptionKey",       SCConfigFieldEncryptionKey },
+    { "encryptionKeyLength", SCConfigFieldEncryptionKeyLength },
+    { "autosaveInterval",    SCConfigFieldAutosaveInterval },
+};
+
+/*
+ Perfect hash over SCConfigTags: the first, middle and last byte plus the
+ length are packed into a word and multiplied, and the top bits pick one of
+ SC_CONFIG_TAG_SLOTS slots. The multiplier was searched so that every tag above
+ lands in its own slot; SCConfigTagTable() asserts that, so adding a tag that
+ collides means picking a new multiplier. A lookup is one multiply and one
+ strcmp against the single candidate.
+ */
+#define SC_CONFIG_TAG_BITS 7
+#define SC_CONFIG_TAG_SLOTS (1u << SC_CONFIG_TAG_BITS)
+#define SC_CONFIG_TAG_MULTIPLIER 0xec3b9605u
+#define SC_CONFIG_TAG_MAX 32
+
+static inline uint32_t SCConfigTagSlot(const char *tag, size_t len) {
+    uint32_t word =  (uint32_t)(uint8_t)tag[0]
+                  | ((uint32_t)(uint8_t)tag[len - 1] << 8)
+                  | ((uint32_t)(uint8_t)tag[len / 2] << 16)
+                  | ((uint32_t)len << 24);
+    return (word * SC_CONFIG_TAG_MULTIPLIER) >> (32 - SC_CONFIG_TAG_BITS);
+}
+
+// Slot to SCConfigTags index plus one; zero marks an empty slot.
+static const uint8_t *SCConfigTagTable(void) {
+    static uint8_t table[SC_CONFIG_TAG_SLOTS];
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        for (size_t i = 0; i < sizeof(SCConfigTags) / sizeof(SCConfigTags[0]); i++) {
+            const char *tag = SCConfigTags[i].tag;
+            uint32_t slot = SCConfigTagSlot(tag, strlen(tag));
+            NSCAssert(table[slot] == 0, @"SCConfigParser tag '%s' collides with '%s'",
+                      tag, SCConfigTags[table[slot] - 1].tag);
+            table[slot] = (uint8_t)(i + 1);
+        }
+    });
+    return table;
+}
+
+static SCConfigField SCConfigFieldForElement(NSString *elementName) {
+    char tag[SC_CONFIG_TAG_MAX];
+    // Tags are short ASCII; anything else cannot name a field.
+    if (![elementName getCString:tag maxLength:sizeof(tag) encoding:NSASCIIStringEncoding]) {
+        return SCConfigFieldNone;
+    }
+    size_t len = strlen(tag);
+    if (len == 0) {
+        return SCConfigFieldNone;
+    }
+
+    uint8_t entry = SCConfigTagTable()[SCConfigTagSlot(tag, len)];
+    if (entry == 0 || strcmp(SCConfigTags[entry - 1].tag, tag) != 0) {
+        return SCConfigFieldNone;
+    }
+    return SCConfigTags[entry - 1].field;
+}
+
+@interface SCConfigParser () {
+    SCConfigField _currentField;
+    // Reused for every element; only filled while inside a known field.
+    NSMutableString *_characters;
+
+    os_unfair_lock _configLock;
+    // Write-behind: every change re-arms the timer, which saves on `_saveQueue`.
+    dispatch_queue_t _saveQueue;
+    dispatch_source_t _saveTimer;
+}
 @end
 
 @implementation SCConfigParser
 
+@synthesize config = _config;
+
 - (nullable instancetype)init {
     return [self initWithXML:@""];
 }
@@ -60,22 +212,87 @@
 - (nullable instancetype)initWithXML:(NSString *)filePath {
     self = [super init];
     if (self) {
+        _configLock = OS_UNFAIR_LOCK_INIT;
         _configFilePath = [filePath copy];
         _config = [[SCConfig alloc] init];
+        _config.observer = self;
+
+        _saveQueue = dispatch_queue_create("com.scribblelab.scconfig.save", DISPATCH_QUEUE_SERIAL);
+        _saveTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _saveQueue);
+        __weak SCConfigParser *weakSelf = self;
+        dispatch_source_set_event_handler(_saveTimer, ^{
+            [weakSelf _writeBehind];
+        });
+        dispatch_source_set_timer(_saveTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(_saveTimer);
+
+        // A cache built from the current XML skips NSXMLParser entirely.
+        SCConfig *cached = filePath.length != 0 ? [SCConfig _configFromCacheForFile:filePath] : nil;
+        if (cached) {
+            self.config = cached;
+            return self;
+        }
 
-        NSData *xmlData = [NSData dataWithContentsOfFile:filePath];
-        if (!xmlData) {
-            NSLog(@"[SCConfigParser] Error: Unable to read file at path: %@", filePath);
+        // Mapped lazily; NSXMLParser walks the bytes front to back.
+        fs_managed_buffer_t contents;
+        if (filePath.length == 0 ||
+            fs_io_map(filePath.fileSystemRepresentation, FS_IO_ADVICE_SEQUENTIAL, &contents) != FS_ERROR_NONE) {
+            FS_LOG_ERROR("SCConfigParser", "Unable to read file at path: %s", filePath.UTF8String);
             return nil;
         }
+        NSData *xmlData = fs_managed_buffer_nsdata(contents);
+        fs_managed_buffer_release(&contents);
 
         NSXMLParser *parser = [[NSXMLParser alloc] initWithData:xmlData];
         parser.delegate = self;
-        [parser parse];
+        fs_signpost_id_t signpost = FS_SIGNPOST_BEGIN(FS_SIGNPOST_PARSE);
+        BOOL parsed = [parser parse];
+        FS_SIGNPOST_END(FS_SIGNPOST_PARSE, signpost);
+
+        // What was just read matches the file; only later edits need saving.
+        SCConfig *config = self.config;
+        [config _resetChangeTracking];
+        if (parsed) {
+            [SCConfig _writeCacheData:[config _cacheData] forFile:filePath];
+        }
     }
     return self;
 }
 
++ (void)loadConfigAtPath:(NSString *)filePath
+              completion:(void (^)(SCConfigParser *_Nullable parser))completion {
+    [[SCDocumentLoader sharedLoader] loadConfigsAtPaths:@[ filePath ]
+                                             completion:^(NSString *path, SCConfigParser *parser) {
+                                                 completion(parser);
+                                             }
+                                        batchCompletion:nil];
+}
+
+- (void)dealloc {
+    if (_saveTimer) {
+        dispatch_source_cancel(_saveTimer);
+    }
+    // Hand unsaved changes to the I/O engine; the write outlives the parser.
+    if (_configFilePath.length != 0) {
+        [_config _saveChangesToFileAsync:_configFilePath completion:nil];
+    }
+}
+
+- (SCConfig *)config {
+    os_unfair_lock_lock(&_configLock);
+    SCConfig *config = _config;
+    os_unfair_lock_unlock(&_configLock);
+    return config;
+}
+
+- (void)setConfig:(SCConfig *)config {
+    config.observer = self;
+
+    os_unfair_lock_lock(&_configLock);
+    _config = config;
+    os_unfair_lock_unlock(&_configLock);
+}
+
 - (void)saveConfigToFile:(NSString *)filePath {
     [self.config _saveConfigToFile:filePath];
 }
@@ -85,8 +302,41 @@
 }
 
 - (void)configDidChange {
-    if (self.configFilePath) {
-        [self saveConfigToFile:self.configFilePath];
+    int64_t delay = (int64_t)(SCConfigParserSaveDelay * NSEC_PER_SEC);
+    dispatch_source_set_timer(_saveTimer, dispatch_time(DISPATCH_TIME_NOW, delay),
+                              DISPATCH_TIME_FOREVER, (uint64_t)delay / 10);
+}
+
+- (void)flushPendingChanges {
+    dispatch_source_set_timer(_saveTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+    dispatch_sync(_saveQueue, ^{
+        [self _writeBehind];
+    });
+}
+
+- (void)_writeBehind {
+    NSString *filePath = self.configFilePath;
+    if (filePath.length == 0) {
+        return;
+    }
+    // Returns NO without touching the disk when nothing changed.
+    [self.config _saveChangesToFileAsync:filePath completion:nil];
+}
+
+#pragma mark - SCConfigObserver
+
+- (void)config:(SCConfig *)config didChangeKeys:(NSSet<NSString *> *)keys {
+    if (config != self.config) {
+        return;
+    }
+
+    [self configDidChange];
+
+    id<SCConfigDelegate> delegate = self.delegate;
+    if ([delegate respondsToSelector:@selector(configDidChangeKeys:)]) {
+        [delegate configDidChangeKeys:keys];
+    } else {
+        [delegate configDidChange];
     }
 }
 
@@ -96,33 +346,81 @@
   namespaceURI:(nullable NSString *)namespaceURI
   qualifiedName:(nullable NSString *)qName attributes:(NSDictionary<NSString *, NSString *> *)attributeDict {
     
-    self.currentElementValue = [[NSMutableString alloc] init];
+    _currentField = SCConfigFieldForElement(elementName);
 
-    if ([elementName isEqualToString:@"scconfig"]) {
+    if (_currentField == SCConfigFieldRoot) {
         self.config = [[SCConfig alloc] init];
+        _currentField = SCConfigFieldNone;
+        return;
+    }
+
+    if (_currentField != SCConfigFieldNone) {
+        if (!_characters) {
+            _characters = [[NSMutableString alloc] initWithCapacity:64];
+        }
+        [_characters setString:@""];
     }
 }
 
 - (void)parser:(NSXMLParser *)parser foundCharacters:(nonnull NSString *)string {
-    [self.currentElementValue appendString:string];
+    if (_currentField != SCConfigFieldNone) {
+        [_characters appendString:string];
+    }
 }
 
 - (void)parser:(NSXMLParser *)parser didEndElement:(nonnull NSString *)elementName
   namespaceURI:(nullable NSString *)namespaceURI qualifiedName:(nullable NSString *)qName {
     
-    if (!self.currentElementValue) {
+    SCConfigField field = _currentField;
+    _currentField = SCConfigFieldNone;
+    if (field == SCConfigFieldNone) {
         return;
     }
-    
-    NSString *trimmedValue = [self.currentElementValue stringByTrimmingCharactersInSet:
-                             [NSCharacterSet whitespaceAndNewlineCharacterSet]];
 
-    if ([self.config respondsToSelector:NSSelectorFromString(elementName)]) {
-        [self.config setValue:trimmedValue forKey:elementName];
-    }
+    // Change notifications are coalesced by SCConfig, not sent per element.
+    [self applyValue:[_characters stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]]
+             toField:field];
+}
+
+#pragma mark - Field Dispatch
+
+// Numbers and booleans are parsed the way KVC coerced them before:
+// -integerValue and -boolValue ("true", "YES" and non-zero digits are YES).
+- (void)applyValue:(NSString *)value toField:(SCConfigField)field {
+    SCConfig *config = self.config;
 
-    if ([self.delegate respondsToSelector:@selector(configDidChange)]) {
-        [self.delegate configDidChange];
+    switch (field) {
+        case SCConfigFieldCreated:             config.created = value; break;
+        case SCConfigFieldModified:            config.modified = value; break;
+        case SCConfigFieldAuthor:              config.author = value; break;
+        case SCConfigFieldTitle:               config.title = value; break;
+        case SCConfigFieldTheme:               config.theme = value; break;
+        case SCConfigFieldSyncEnabled:         config.syncEnabled = value.boolValue; break;
+        case SCConfigFieldSyncProvider:        config.syncProvider = value; break;
+        case SCConfigFieldSyncFrequency:       config.syncFrequency = value.integerValue; break;
+        case SCConfigFieldSyncOnSave:          config.syncOnSave = value.boolValue; break;
+        case SCConfigFieldPeriodicSync:        config.periodicSync = value.boolValue; break;
+        case SCConfigFieldCloudSync:           config.cloudSync = value.boolValue; break;
+        case SCConfigFieldLocalBackup:         config.localBackup = value.boolValue; break;
+        case SCConfigFieldEncryptionEnabled:   config.encryptionEnabled = value.boolValue; break;
+        case SCConfigFieldEncryptionAlgorithm: config.encryptionAlgorithm = value; break;
+        case SCConfigFieldEncryptionKey:       config.encryptionKey = value; break;
+        case SCConfigFieldEncryptionKeyLength: config.encryptionKeyLength = value.integerValue; break;
+        case SCConfigFieldAutosaveInterval:    config.autosaveInterval = value.integerValue; break;
+        case SCConfigFieldRevisions:           config.revisions = value.integerValue; break;
+        case SCConfigFieldCanvasSize:          config.canvasSize = value; break;
+        case SCConfigFieldPageOrientation:     config.pageOrientation = value; break;
+        case SCConfigFieldBackground:          config.background = value; break;
+        case SCConfigFieldDpi:                 config.dpi = value.integerValue; break;
+        case SCConfigFieldMargins:             config.margins = value; break;
+        case SCConfigFieldLineSpacing:         config.lineSpacing = value; break;
+        case SCConfigFieldColorSpace:          config.colorSpace = value; break;
+        case SCConfigFieldBitDepth:            config.bitDepth = value.integerValue; break;
+        case SCConfigFieldResolution:          config.resolution = value; break;
+        case SCConfigFieldLineCoding:          config.lineCoding = value; break;
+        case SCConfigFieldNone:
+        case SCConfigFieldRoot:
+            break;
     }
 }
 
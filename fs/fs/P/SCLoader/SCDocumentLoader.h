@@ -0,0 +1,123 @@
+//
+//  SCDocumentLoader.h
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <Foundation/Foundation.h>
+#import "SCConfigParser.h"
+#import "SCState.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A batch of documents being loaded by an `SCDocumentLoader`.
+///
+/// Keep the batch to cancel documents that are no longer needed, e.g. the
+/// ones the user scrolled past. Cancelled documents that have not been parsed
+/// yet are skipped, and no completion is delivered for any cancelled document.
+NS_CLASS_AVAILABLE(15, 18)
+@interface SCLoadBatch : NSObject
+
+/// The number of documents neither delivered nor cancelled yet.
+@property (nonatomic, readonly) NSUInteger pendingCount;
+
+/// Cancels loading the document at `path`; does nothing if it was delivered.
+- (void)cancelPath:(NSString *)path;
+
+/// Cancels every document of the batch that has not been delivered.
+- (void)cancel;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// Loads `scconfig` and `.scstate` files off the calling thread.
+///
+/// Documents are parsed concurrently on a bounded pool of workers, and each
+/// result is delivered on `completionQueue` as soon as it is ready, in no
+/// particular order. Opening a workspace submits all of its documents as one
+/// batch and cancels the ones no longer on screen.
+///
+/// ```objc
+/// SCLoadBatch *batch = [[SCDocumentLoader sharedLoader] loadConfigsAtPaths:paths
+///     completion:^(NSString *path, SCConfigParser *parser) { ... }
+///     batchCompletion:nil];
+/// ```
+NS_CLASS_AVAILABLE(15, 18)
+@interface SCDocumentLoader : NSObject
+
+/// A loader with one worker per active processor, delivering on the main queue.
+@property (class, nonatomic, readonly) SCDocumentLoader *sharedLoader;
+
+/// The queue results are delivered on. Defaults to the main queue.
+@property (atomic, strong) dispatch_queue_t completionQueue;
+
+/// The maximum number of documents parsed at the same time.
+@property (nonatomic, readonly) NSUInteger maxConcurrentLoads;
+
+/// Creates a loader.
+///
+/// @param maxConcurrentLoads Maximum number of documents parsed at the same time;
+///                           0 for one per active processor.
+- (instancetype)initWithMaxConcurrentLoads:(NSUInteger)maxConcurrentLoads NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init;
+
+/// Loads configuration files.
+///
+/// @param paths The `scconfig` files to load.
+/// @param completion Called once per document that was not cancelled, with
+///                   `nil` if the file could not be read.
+/// @param batchCompletion Called after every document was delivered or
+///                        cancelled; may be `nil`.
+/// @return The batch, for cancellation.
+- (SCLoadBatch *)loadConfigsAtPaths:(NSArray<NSString *> *)paths
+                         completion:(void (^)(NSString *path, SCConfigParser *_Nullable parser))completion
+                    batchCompletion:(nullable void (^)(void))batchCompletion;
+
+/// Loads state files, like `loadConfigsAtPaths:completion:batchCompletion:`.
+///
+/// Journaled states only decode their header here; history is replayed on first use.
+- (SCLoadBatch *)loadStatesAtPaths:(NSArray<NSString *> *)paths
+                        completion:(void (^)(NSString *path, SCState *_Nullable state))completion
+                   batchCompletion:(nullable void (^)(void))batchCompletion;
+
+/// Loads state files together with the configurations of their documents.
+///
+/// Each state whose path has an entry in `configs` gets that configuration's
+/// `revisions` as its `historyLimit` (when positive) before it is delivered.
+///
+/// @param configs The configuration of each state's document, keyed by state path.
+- (SCLoadBatch *)loadStatesAtPaths:(NSArray<NSString *> *)paths
+                           configs:(NSDictionary<NSString *, SCConfig *> *)configs
+                        completion:(void (^)(NSString *path, SCState *_Nullable state))completion
+                   batchCompletion:(nullable void (^)(void))batchCompletion;
+
+@end
+
+NS_ASSUME_NONNULL_END
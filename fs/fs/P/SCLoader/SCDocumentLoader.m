@@ -0,0 +1,242 @@
+//
+//  SCDocumentLoader.m
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import "SCDocumentLoader.h"
+#import "SCStateParser.h"
+#include <os/lock.h>
+
+@interface SCLoadBatch ()
+- (instancetype)initPrivate NS_DESIGNATED_INITIALIZER;
+- (void)addOperation:(NSOperation *)operation forPath:(NSString *)path;
+- (void)finishOperation:(NSOperation *)operation forPath:(NSString *)path;
+@end
+
+@implementation SCLoadBatch {
+    os_unfair_lock _lock;
+    // Operations not yet delivered or cancelled, by path; a path may be listed twice.
+    NSMutableDictionary<NSString *, NSMutableArray<NSOperation *> *> *_operations;
+    NSUInteger _pendingCount;
+}
+
+- (instancetype)initPrivate {
+    self = [super init];
+    if (self) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _operations = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)addOperation:(NSOperation *)operation forPath:(NSString *)path {
+    os_unfair_lock_lock(&_lock);
+    NSMutableArray<NSOperation *> *operations = _operations[path];
+    if (!operations) {
+        operations = [[NSMutableArray alloc] initWithCapacity:1];
+        _operations[path] = operations;
+    }
+    [operations addObject:operation];
+    _pendingCount++;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)finishOperation:(NSOperation *)operation forPath:(NSString *)path {
+    os_unfair_lock_lock(&_lock);
+    NSMutableArray<NSOperation *> *operations = _operations[path];
+    NSUInteger index = [operations indexOfObjectIdenticalTo:operation];
+    if (index != NSNotFound) {
+        [operations removeObjectAtIndex:index];
+        if (operations.count == 0) {
+            [_operations removeObjectForKey:path];
+        }
+        _pendingCount--;
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (NSUInteger)pendingCount {
+    os_unfair_lock_lock(&_lock);
+    NSUInteger count = _pendingCount;
+    os_unfair_lock_unlock(&_lock);
+    return count;
+}
+
+- (void)cancelPath:(NSString *)path {
+    os_unfair_lock_lock(&_lock);
+    NSArray<NSOperation *> *operations = [_operations[path] copy];
+    os_unfair_lock_unlock(&_lock);
+
+    for (NSOperation *operation in operations) {
+        [operation cancel];
+        [self finishOperation:operation forPath:path];
+    }
+}
+
+- (void)cancel {
+    os_unfair_lock_lock(&_lock);
+    NSArray<NSString *> *paths = _operations.allKeys;
+    os_unfair_lock_unlock(&_lock);
+
+    for (NSString *path in paths) {
+        [self cancelPath:path];
+    }
+}
+
+@end
+
+@implementation SCDocumentLoader {
+    NSOperationQueue *_queue;
+}
+
++ (SCDocumentLoader *)sharedLoader {
+    static SCDocumentLoader *loader;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        loader = [[SCDocumentLoader alloc] initWithMaxConcurrentLoads:0];
+    });
+    return loader;
+}
+
+- (instancetype)init {
+    return [self initWithMaxConcurrentLoads:0];
+}
+
+- (instancetype)initWithMaxConcurrentLoads:(NSUInteger)maxConcurrentLoads {
+    self = [super init];
+    if (self) {
+        _maxConcurrentLoads = maxConcurrentLoads ?: MAX(NSProcessInfo.processInfo.activeProcessorCount, (NSUInteger)1);
+        _completionQueue = dispatch_get_main_queue();
+
+        _queue = [[NSOperationQueue alloc] init];
+        _queue.name = @"com.scribblelab.documentloader";
+        _queue.maxConcurrentOperationCount = (NSInteger)_maxConcurrentLoads;
+        _queue.qualityOfService = NSQualityOfServiceUserInitiated;
+    }
+    return self;
+}
+
+/*
+ One operation per path. The batch group is entered per operation and left
+ from its completion block, which also runs for operations cancelled before
+ they started. Results go to the completion queue through the same group, so
+ `batchCompletion` runs after the last delivery.
+ */
+- (SCLoadBatch *)loadPaths:(NSArray<NSString *> *)paths
+                      load:(id _Nullable (^)(NSString *path))load
+                completion:(void (^)(NSString *path, id _Nullable result))completion
+           batchCompletion:(nullable void (^)(void))batchCompletion {
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t completionQueue = self.completionQueue;
+    SCLoadBatch *batch = [[SCLoadBatch alloc] initPrivate];
+    NSMutableArray<NSOperation *> *operations = [NSMutableArray arrayWithCapacity:paths.count];
+
+    for (NSString *path in paths) {
+        NSBlockOperation *operation = [[NSBlockOperation alloc] init];
+        __weak NSBlockOperation *weakOperation = operation;
+        __weak SCLoadBatch *weakBatch = batch;
+
+        [operation addExecutionBlock:^{
+            NSBlockOperation *strongOperation = weakOperation;
+            if (!strongOperation || strongOperation.isCancelled) {
+                return;
+            }
+            id result = load(path);
+
+            dispatch_group_async(group, completionQueue, ^{
+                // Cancelled while parsing or while waiting for the completion queue.
+                if (strongOperation.isCancelled) {
+                    return;
+                }
+                [weakBatch finishOperation:strongOperation forPath:path];
+                completion(path, result);
+            });
+        }];
+
+        dispatch_group_enter(group);
+        operation.completionBlock = ^{
+            dispatch_group_leave(group);
+        };
+
+        [batch addOperation:operation forPath:path];
+        [operations addObject:operation];
+    }
+
+    if (batchCompletion) {
+        // Keeps the batch alive until it is done, so the caller may drop it.
+        dispatch_group_notify(group, completionQueue, ^{
+            (void)batch;
+            batchCompletion();
+        });
+    }
+
+    [_queue addOperations:operations waitUntilFinished:NO];
+    return batch;
+}
+
+- (SCLoadBatch *)loadConfigsAtPaths:(NSArray<NSString *> *)paths
+                         completion:(void (^)(NSString *path, SCConfigParser *_Nullable parser))completion
+                    batchCompletion:(nullable void (^)(void))batchCompletion {
+    return [self loadPaths:paths
+                      load:^id (NSString *path) {
+                          return [[SCConfigParser alloc] initWithXML:path];
+                      }
+                completion:^(NSString *path, id result) {
+                    completion(path, result);
+                }
+           batchCompletion:batchCompletion];
+}
+
+- (SCLoadBatch *)loadStatesAtPaths:(NSArray<NSString *> *)paths
+                        completion:(void (^)(NSString *path, SCState *_Nullable state))completion
+                   batchCompletion:(nullable void (^)(void))batchCompletion {
+    return [self loadStatesAtPaths:paths configs:@{} completion:completion batchCompletion:batchCompletion];
+}
+
+- (SCLoadBatch *)loadStatesAtPaths:(NSArray<NSString *> *)paths
+                           configs:(NSDictionary<NSString *, SCConfig *> *)configs
+                        completion:(void (^)(NSString *path, SCState *_Nullable state))completion
+                   batchCompletion:(nullable void (^)(void))batchCompletion {
+    configs = [configs copy];
+    return [self loadPaths:paths
+                      load:^id (NSString *path) {
+                          SCState *state = [SCStateParser loadStateFromFile:path];
+                          NSInteger revisions = configs[path].revisions;
+                          if (state && revisions > 0) {
+                              state.historyLimit = (NSUInteger)revisions;
+                          }
+                          return state;
+                      }
+                completion:^(NSString *path, id result) {
+                    completion(path, result);
+                }
+           batchCompletion:batchCompletion];
+}
+
+@end
@@ -58,6 +58,11 @@ NS_AVAILABLE(15, 18)
 /// - `"command"`: The action performed (e.g., `"bold"`, `"delete"`)
 /// - `"stateBefore"`: The document state before the action
 /// - `"stateAfter"`: The document state after the action
+///
+/// The history is stored as deltas between consecutive states (see
+/// `fs/undo.h`); reading this property rebuilds every entry, so prefer
+/// `pushUndoEntry:`, `popUndoEntry` and `popRedoEntry` while editing.
+/// Values must be JSON-serializable, like the rest of the `.scstate` file.
 @property (nonatomic, strong) NSArray<NSDictionary *> *undoHistory;
 
 /// A list of redo operations, similar to `undoHistory`.
@@ -68,6 +73,19 @@ NS_AVAILABLE(15, 18)
 /// - `"stateAfter"`: The document state after redo
 @property (nonatomic, strong) NSArray<NSDictionary *> *redoHistory;
 
+/// The maximum number of entries kept in each of the undo and redo histories.
+///
+/// When a history is full, recording a new entry drops its oldest one. `0`
+/// keeps everything. `SCDocumentLoader` sets it to the document's positive
+/// `SCConfig.revisions` when states are loaded with their configurations.
+@property (nonatomic, assign) NSUInteger historyLimit;
+
+/// The number of entries in `undoHistory`.
+@property (nonatomic, readonly) NSUInteger undoCount;
+
+/// The number of entries in `redoHistory`.
+@property (nonatomic, readonly) NSUInteger redoCount;
+
 /// Stores the current state of the mouse.
 ///
 /// This dictionary may contain:
@@ -120,6 +138,22 @@ NS_AVAILABLE(15, 18)
 /// @return A dictionary representation of the current state.
 - (NSDictionary *)toDictionary;
 
+/// Records a new undo entry and clears the redo history.
+///
+/// @param entry A dictionary in the `undoHistory` format.
+/// @return `NO` if the entry could not be encoded as JSON or stored.
+- (BOOL)pushUndoEntry:(NSDictionary *)entry;
+
+/// Removes the newest undo entry and moves it to the redo history.
+///
+/// @return The entry to undo, or `nil` if there is none.
+- (nullable NSDictionary *)popUndoEntry;
+
+/// Removes the newest redo entry and moves it back to the undo history.
+///
+/// @return The entry to redo, or `nil` if there is none.
+- (nullable NSDictionary *)popRedoEntry;
+
 @end
 
 NS_ASSUME_NONNULL_END
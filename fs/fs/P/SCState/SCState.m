@@ -30,9 +30,57 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #import <fs/SCState.h>
+#import "SCStateJournal.h"
 #include <Foundation/Foundation.h>
+#include <fs/fslog.h>
+#include <fs/undo.h>
 
-@implementation SCState
+/*
+ Undo and redo entries live in two fs_undo_log_t as canonical JSON: the
+ "command" part is the entry without its states, and each state is encoded
+ with sorted keys so unchanged parts of consecutive states are byte-identical
+ and the log stores only what changed. An absent state is stored as empty bytes.
+ */
+static NSString *const SCStateBeforeKey = @"stateBefore";
+static NSString *const SCStateAfterKey = @"stateAfter";
+
+static NSData *_Nullable SCStateEncodeJSON(id _Nullable object) {
+    if (!object) {
+        return [NSData data];
+    }
+    NSError *error = nil;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:object
+                    options:NSJSONWritingSortedKeys | NSJSONWritingFragmentsAllowed error:&error];
+    if (!data) {
+        FS_LOG_ERROR("SCState", "Undo entry is not JSON-serializable: %s", error.localizedDescription.UTF8String);
+    }
+    return data;
+}
+
+// Takes ownership of the malloc'd bytes.
+static id _Nullable SCStateDecodeJSON(fs_data_t data) {
+    if (data.len == 0) {
+        free(data.bytes);
+        return nil;
+    }
+    NSData *json = [NSData dataWithBytesNoCopy:data.bytes length:data.len freeWhenDone:YES];
+    return [NSJSONSerialization JSONObjectWithData:json
+            options:NSJSONReadingMutableContainers | NSJSONReadingFragmentsAllowed error:nil];
+}
+
+static inline fs_data_t SCStateBytes(NSData *data) {
+    return (fs_data_t){ (void *)data.bytes, data.length, false };
+}
+
+@implementation SCState {
+    fs_undo_log_t *_undoLog;
+    fs_undo_log_t *_redoLog;
+    SCStateJournal *_journal;
+
+    // History not yet replayed from the journal the state was loaded from.
+    NSData *_deferredJournal;
+    NSData *_deferredRecords;
+}
 
 - (instancetype)init {
     return [self initWithDictionary:@{}];
@@ -45,8 +93,14 @@
         _lastModified = timestampString ? [self dateFromISOString:timestampString] : [NSDate date];
 
         _autosaveEnabled = [dictionary[@"autosaveEnabled"] boolValue];
-        _undoHistory = [dictionary[@"undoHistory"] ?: @[] mutableCopy];
-        _redoHistory = [dictionary[@"redoHistory"] ?: @[] mutableCopy];
+        if (fs_undo_log_create(0, 0, &_undoLog) != FS_ERROR_NONE ||
+            fs_undo_log_create(0, 0, &_redoLog) != FS_ERROR_NONE) {
+            return nil;
+        }
+        _journal = [[SCStateJournal alloc] init];
+        self.historyLimit = [dictionary[@"historyLimit"] unsignedIntegerValue];
+        self.undoHistory = dictionary[@"undoHistory"] ?: @[];
+        self.redoHistory = dictionary[@"redoHistory"] ?: @[];
         _mouseState = [dictionary[@"mouseState"] ?: @{} mutableCopy];
         _keyboardState = [dictionary[@"keyboardState"] ?: @{} mutableCopy];
         _selectionState = [dictionary[@"selectionState"] ?: @{} mutableCopy];
@@ -69,16 +123,222 @@
     };
 }
 
+- (void)dealloc {
+    fs_undo_log_destroy(_undoLog);
+    fs_undo_log_destroy(_redoLog);
+}
+
+#pragma mark - History
+
+- (NSArray<NSDictionary *> *)undoHistory {
+    [self _loadHistoryIfNeeded];
+    return [self entriesOfLog:_undoLog];
+}
+
+- (void)setUndoHistory:(NSArray<NSDictionary *> *)undoHistory {
+    [self _loadHistoryIfNeeded];
+    [self replaceEntriesOfLog:_undoLog withEntries:undoHistory];
+}
+
+- (NSArray<NSDictionary *> *)redoHistory {
+    [self _loadHistoryIfNeeded];
+    return [self entriesOfLog:_redoLog];
+}
+
+- (void)setRedoHistory:(NSArray<NSDictionary *> *)redoHistory {
+    [self _loadHistoryIfNeeded];
+    [self replaceEntriesOfLog:_redoLog withEntries:redoHistory];
+}
+
+- (void)setHistoryLimit:(NSUInteger)historyLimit {
+    // Reapplying the document's limit after a load must not replay a deferred history.
+    if (historyLimit == _historyLimit) {
+        return;
+    }
+    [self _loadHistoryIfNeeded];
+    _historyLimit = historyLimit;
+    fs_undo_log_set_limit(_undoLog, historyLimit);
+    fs_undo_log_set_limit(_redoLog, historyLimit);
+    [_journal recordLimit:historyLimit];
+}
+
+- (NSUInteger)undoCount {
+    [self _loadHistoryIfNeeded];
+    return fs_undo_log_count(_undoLog);
+}
+
+- (NSUInteger)redoCount {
+    [self _loadHistoryIfNeeded];
+    return fs_undo_log_count(_redoLog);
+}
+
+- (BOOL)pushUndoEntry:(NSDictionary *)entry {
+    [self _loadHistoryIfNeeded];
+    if (![self appendEntry:entry toLog:_undoLog]) {
+        return NO;
+    }
+    if (fs_undo_log_count(_redoLog) != 0) {
+        fs_undo_log_clear(_redoLog);
+        [_journal recordClearRedo:YES];
+    }
+    return YES;
+}
+
+- (nullable NSDictionary *)popUndoEntry {
+    [self _loadHistoryIfNeeded];
+    return [self moveNewestEntryFromLog:_undoLog toLog:_redoLog];
+}
+
+- (nullable NSDictionary *)popRedoEntry {
+    [self _loadHistoryIfNeeded];
+    return [self moveNewestEntryFromLog:_redoLog toLog:_undoLog];
+}
+
+- (BOOL)appendEntry:(NSDictionary *)entry toLog:(fs_undo_log_t *)log {
+    NSMutableDictionary *command = [entry mutableCopy];
+    [command removeObjectsForKeys:@[ SCStateBeforeKey, SCStateAfterKey ]];
+
+    NSData *commandData = SCStateEncodeJSON(command);
+    NSData *before = SCStateEncodeJSON(entry[SCStateBeforeKey]);
+    NSData *after = SCStateEncodeJSON(entry[SCStateAfterKey]);
+    if (!commandData || !before || !after) {
+        return NO;
+    }
+
+    fs_data_t commandBytes = SCStateBytes(commandData);
+    fs_data_t beforeBytes = SCStateBytes(before);
+    fs_data_t afterBytes = SCStateBytes(after);
+    if (fs_undo_log_push(log, commandBytes, beforeBytes, afterBytes) != FS_ERROR_NONE) {
+        return NO;
+    }
+    [_journal recordPush:commandBytes before:beforeBytes after:afterBytes redo:log == _redoLog];
+    return YES;
+}
+
+// Moves the stored bytes as they are; only the returned dictionary is decoded.
+- (nullable NSDictionary *)moveNewestEntryFromLog:(fs_undo_log_t *)from toLog:(fs_undo_log_t *)to {
+    fs_data_t command, before, after;
+    if (fs_undo_log_pop(from, &command, &before, &after) != FS_ERROR_NONE) {
+        return nil;
+    }
+    [_journal recordPopRedo:from == _redoLog];
+
+    if (fs_undo_log_push(to, command, before, after) != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCState", "Out of memory while moving a history entry");
+    } else {
+        [_journal recordPush:command before:before after:after redo:to == _redoLog];
+    }
+    return [self entryWithCommand:command before:before after:after];
+}
+
+- (nullable NSDictionary *)entryWithCommand:(fs_data_t)command before:(fs_data_t)before after:(fs_data_t)after {
+    NSMutableDictionary *entry = SCStateDecodeJSON(command);
+    id stateBefore = SCStateDecodeJSON(before);
+    id stateAfter = SCStateDecodeJSON(after);
+
+    if (![entry isKindOfClass:[NSMutableDictionary class]]) {
+        return nil;
+    }
+    if (stateBefore) {
+        entry[SCStateBeforeKey] = stateBefore;
+    }
+    if (stateAfter) {
+        entry[SCStateAfterKey] = stateAfter;
+    }
+    return entry;
+}
+
+- (NSArray<NSDictionary *> *)entriesOfLog:(fs_undo_log_t *)log {
+    size_t count = fs_undo_log_count(log);
+    NSMutableArray<NSDictionary *> *entries = [NSMutableArray arrayWithCapacity:count];
+
+    for (size_t i = 0; i < count; i++) {
+        fs_data_t command, before, after;
+        if (fs_undo_log_get(log, i, &command, &before, &after) != FS_ERROR_NONE) {
+            break;
+        }
+        NSDictionary *entry = [self entryWithCommand:command before:before after:after];
+        if (entry) {
+            [entries addObject:entry];
+        }
+    }
+    return entries;
+}
+
+- (void)replaceEntriesOfLog:(fs_undo_log_t *)log withEntries:(NSArray<NSDictionary *> *)entries {
+    fs_undo_log_clear(log);
+    [_journal recordClearRedo:log == _redoLog];
+
+    for (NSDictionary *entry in entries) {
+        if (![entry isKindOfClass:[NSDictionary class]] || ![self appendEntry:entry toLog:log]) {
+            FS_LOG_ERROR("SCState", "Dropping invalid history entry");
+        }
+    }
+}
+
+#pragma mark - Journal
+
+- (SCStateJournal *)_journal {
+    return _journal;
+}
+
+- (NSDictionary *)_journalHeader {
+    return @{
+        @"lastModified": [self isoStringFromDate:_lastModified],
+        @"autosaveEnabled": @(self.autosaveEnabled),
+        @"historyLimit": @(self.historyLimit),
+        @"mouseState": self.mouseState,
+        @"keyboardState": self.keyboardState,
+        @"selectionState": self.selectionState,
+        @"metadata": self.metadata ?: @{}
+    };
+}
+
+- (void)_deferHistoryFromJournal:(NSData *)journal records:(NSData *)records {
+    _deferredJournal = journal;
+    _deferredRecords = records;
+}
+
+- (void)_loadHistoryIfNeeded {
+    if (!_deferredJournal) {
+        return;
+    }
+    NSData *journal = _deferredJournal;
+    NSData *records = _deferredRecords;
+    _deferredJournal = nil;
+    _deferredRecords = nil;
+
+    [_journal setLastState:SCStateJournalReplay(journal, records, _undoLog, _redoLog)];
+}
+
+- (fs_undo_log_t *)_undoLog {
+    return _undoLog;
+}
+
+- (fs_undo_log_t *)_redoLog {
+    return _redoLog;
+}
+
+#pragma mark - Dates
+
+// NSDateFormatter is expensive to create and safe to share across threads.
+static NSDateFormatter *SCStateISOFormatter(void) {
+    static NSDateFormatter *formatter;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        formatter = [[NSDateFormatter alloc] init];
+        formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSSZ";
+    });
+    return formatter;
+}
+
 - (NSDate *)dateFromISOString:(NSString *)isoString {
-    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
-    formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSSZ";
-    return [formatter dateFromString:isoString];
+    return [SCStateISOFormatter() dateFromString:isoString];
 }
 
 - (NSString *)isoStringFromDate:(NSDate *)date {
-    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
-    formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss.SSSZ";
-    return [formatter stringFromDate:date];
+    return [SCStateISOFormatter() stringFromDate:date];
 }
 
 @end
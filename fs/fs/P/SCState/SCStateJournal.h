@@ -0,0 +1,143 @@
+//
+//  SCStateJournal.h
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//  Private interface shared by SCState and SCStateParser. Not a public header.
+
+#import <Foundation/Foundation.h>
+#import "SCState.h"
+#include <fs/undo.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Journaled `.scstate` files (see fs/journal.h for the framing).
+
+ A save appends the history operations recorded since the previous save,
+ followed by a header record holding everything except the history (dates,
+ cursor, selection, keyboard state, metadata) as JSON. The last header record
+ wins, and the history is rebuilt by replaying the operations in order. That
+ replay is deferred until the history is first used, so reopening a document
+ only decodes one small header.
+
+ Push records hold states the way fs_undo_log_t does (fs_undo_delta_t): the
+ "before" state as a delta against the "after" state of the previous push in
+ the file, the "after" state as a delta against its "before". The chain
+ starts from an empty state at the top of the file, so an edit usually
+ journals a few dozen bytes whatever the document size.
+
+ Once appends have grown the file to more than twice its size after the last
+ compaction, the next save rewrites it as a single header and one push per
+ live history entry, chained the same way.
+ */
+
+/// Four-character format tag of `.scstate` journals.
+#define SC_STATE_JOURNAL_FORMAT 0x54534353u /* "SCST" */
+
+typedef NS_ENUM(uint32_t, SCStateRecordType) {
+    SCStateRecordHeader = 1,    // JSON object
+    SCStateRecordUndoPush = 2,  // u32 command length, before prefix, suffix, middle length, after prefix,
+                                // suffix, middle length, then the command and both middles
+    SCStateRecordRedoPush = 3,
+    SCStateRecordUndoPop = 4,   // empty
+    SCStateRecordRedoPop = 5,
+    SCStateRecordUndoClear = 6,
+    SCStateRecordRedoClear = 7,
+    SCStateRecordLimit = 8,     // u64 history limit for both logs
+};
+
+/// Collects the history operations of one `SCState` between saves.
+///
+/// Operations are only recorded once the state is bound to a journal file,
+/// i.e. after it was loaded from or saved to one.
+@interface SCStateJournal : NSObject
+
+- (void)recordPush:(fs_data_t)command before:(fs_data_t)before after:(fs_data_t)after redo:(BOOL)redo;
+- (void)recordPopRedo:(BOOL)redo;
+- (void)recordClearRedo:(BOOL)redo;
+- (void)recordLimit:(NSUInteger)limit;
+
+/// Sets the newest state of a replayed history, which the next push is encoded against.
+///
+/// `nil` if the history could not be replayed; the next push then makes the next save compact.
+- (void)setLastState:(nullable NSData *)state;
+
+@end
+
+@interface SCState (SCStateJournal)
+
+/// The journal recording this state's history operations.
+- (SCStateJournal *)_journal;
+
+/// Everything except the history, in the `toDictionary` format.
+- (NSDictionary *)_journalHeader;
+
+/// Defers loading the history until it is first used.
+///
+/// @param journal The journal file contents; kept alive until then.
+/// @param records `SCStateJournalRecordRef`s of the history records, in file order.
+- (void)_deferHistoryFromJournal:(NSData *)journal records:(NSData *)records;
+
+/// Rebuilds a deferred history; called by everything that reads or changes it.
+- (void)_loadHistoryIfNeeded;
+
+- (fs_undo_log_t *)_undoLog;
+- (fs_undo_log_t *)_redoLog;
+
+@end
+
+typedef struct {
+    size_t offset;
+    size_t len;
+    SCStateRecordType type;
+} SCStateJournalRecordRef;
+
+/// Returns `YES` if `data` starts with a `.scstate` journal header.
+FOUNDATION_EXTERN BOOL SCStateJournalDetect(NSData *data);
+
+/// Loads the header of a journal; the history is deferred.
+FOUNDATION_EXTERN SCState *_Nullable SCStateJournalLoad(NSData *data, NSString *filePath);
+
+/// Replays deferred history records into the logs.
+///
+/// @return The state after the last push, or `nil` if a record could not be decoded.
+FOUNDATION_EXTERN NSData *_Nullable SCStateJournalReplay(NSData *journal, NSData *records,
+                                                         fs_undo_log_t *undoLog, fs_undo_log_t *redoLog);
+
+/// Saves `state` by appending to or compacting its journal at `filePath`.
+///
+/// The bytes are prepared on the calling thread; the file is written on a
+/// serial background queue, so saves of the same state land in order. With
+/// `wait`, returns after the write with its outcome; otherwise returns `YES`
+/// and reports the outcome through `completion` on that queue.
+FOUNDATION_EXTERN BOOL SCStateJournalSave(SCState *state, NSString *filePath, BOOL wait,
+                                          void (^_Nullable completion)(BOOL success));
+
+NS_ASSUME_NONNULL_END
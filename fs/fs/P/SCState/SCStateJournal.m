@@ -0,0 +1,403 @@
+//
+//  SCStateJournal.m
+//  ScribbleLabApp File Configurations
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import "SCStateJournal.h"
+#include <fs/fslog.h>
+#include <fs/journal.h>
+#include <string.h>
+
+// Pending operations beyond this are dropped in favor of compacting on the next save.
+#define SC_STATE_JOURNAL_PENDING_MAX (4u << 20)
+// Appends may grow the file to twice its compacted size plus this before compacting.
+#define SC_STATE_JOURNAL_SLACK (64u << 10)
+
+static dispatch_queue_t SCStateJournalQueue(void) {
+    static dispatch_queue_t queue;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        queue = dispatch_queue_create("com.scribblelab.scstate.journal", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+static void SCStateAppendRecord(NSMutableData *data, SCStateRecordType type, const fs_buffer_t *parts, size_t count) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        len += parts[i].len;
+    }
+    NSUInteger at = data.length;
+    [data increaseLengthBy:fs_journal_record_size(len)];
+    fs_journal_write_record((unsigned char *)data.mutableBytes + at, type, parts, count);
+}
+
+// `last` is the state after the previous push in the file; `before` is encoded against it.
+static void SCStateAppendPush(NSMutableData *data, SCStateRecordType type, fs_data_t last,
+                              fs_data_t command, fs_data_t before, fs_data_t after) {
+    fs_undo_delta_t beforeDelta = fs_undo_delta_encode(last, before);
+    fs_undo_delta_t afterDelta = fs_undo_delta_encode(before, after);
+    size_t beforeMiddle = before.len - beforeDelta.prefix - beforeDelta.suffix;
+    size_t afterMiddle = after.len - afterDelta.prefix - afterDelta.suffix;
+    uint32_t lens[7] = {
+        (uint32_t)command.len,
+        (uint32_t)beforeDelta.prefix, (uint32_t)beforeDelta.suffix, (uint32_t)beforeMiddle,
+        (uint32_t)afterDelta.prefix, (uint32_t)afterDelta.suffix, (uint32_t)afterMiddle,
+    };
+    fs_buffer_t parts[4] = {
+        { lens, sizeof(lens) },
+        { command.bytes, command.len },
+        { (unsigned char *)before.bytes + beforeDelta.prefix, beforeMiddle },
+        { (unsigned char *)after.bytes + afterDelta.prefix, afterMiddle },
+    };
+    SCStateAppendRecord(data, type, parts, 4);
+}
+
+static void SCStateAppendLimit(NSMutableData *data, NSUInteger limit) {
+    uint64_t value = limit;
+    fs_buffer_t part = { &value, sizeof(value) };
+    SCStateAppendRecord(data, SCStateRecordLimit, &part, 1);
+}
+
+@interface SCStateJournal ()
+// Set on the journal queue when a write fails, read when preparing the next save.
+@property (atomic, assign) BOOL failed;
+@end
+
+@implementation SCStateJournal {
+    NSMutableData *_pending;
+    // Set when `_pending` no longer covers every operation since the last save.
+    BOOL _incomplete;
+
+    // Describe the file as it will be once every queued write has finished.
+    NSString *_path;
+    uint64_t _end;
+    uint64_t _compactedLength;
+    // The state after the last push in the file; nil until a deferred history is replayed.
+    NSData *_lastState;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _pending = [[NSMutableData alloc] init];
+    }
+    return self;
+}
+
+- (void)bindToPath:(NSString *)path end:(uint64_t)end compactedLength:(uint64_t)compactedLength
+         lastState:(nullable NSData *)lastState {
+    _path = [path copy];
+    _end = end;
+    _compactedLength = compactedLength;
+    _lastState = lastState;
+    _pending.length = 0;
+    _incomplete = NO;
+}
+
+- (void)setLastState:(nullable NSData *)state {
+    _lastState = state;
+}
+
+- (BOOL)needsCompactionForPath:(NSString *)path {
+    return !_path || ![_path isEqualToString:path] || _incomplete || self.failed ||
+           _end > 2 * _compactedLength + SC_STATE_JOURNAL_SLACK;
+}
+
+- (NSData *)takePending {
+    NSData *pending = _pending;
+    _pending = [[NSMutableData alloc] init];
+    return pending;
+}
+
+// Returns the offset the next append starts at and accounts for its bytes.
+- (uint64_t)reserveAppendOfLength:(NSUInteger)length {
+    uint64_t offset = _end;
+    _end += length;
+    return offset;
+}
+
+- (BOOL)isRecording {
+    return _path != nil && !_incomplete;
+}
+
+- (void)dropPending {
+    _pending = [[NSMutableData alloc] init];
+    _incomplete = YES;
+}
+
+- (void)recordPush:(fs_data_t)command before:(fs_data_t)before after:(fs_data_t)after redo:(BOOL)redo {
+    if (![self isRecording]) {
+        return;
+    }
+    if (!_lastState) {
+        // Nothing to encode against; the next save compacts.
+        [self dropPending];
+        return;
+    }
+    fs_data_t last = { (void *)_lastState.bytes, _lastState.length, false };
+    SCStateAppendPush(_pending, redo ? SCStateRecordRedoPush : SCStateRecordUndoPush, last, command, before, after);
+    _lastState = [NSData dataWithBytes:after.bytes length:after.len];
+    if (_pending.length > SC_STATE_JOURNAL_PENDING_MAX) {
+        [self dropPending];
+    }
+}
+
+- (void)recordPopRedo:(BOOL)redo {
+    if ([self isRecording]) {
+        SCStateAppendRecord(_pending, redo ? SCStateRecordRedoPop : SCStateRecordUndoPop, NULL, 0);
+    }
+}
+
+- (void)recordClearRedo:(BOOL)redo {
+    if ([self isRecording]) {
+        SCStateAppendRecord(_pending, redo ? SCStateRecordRedoClear : SCStateRecordUndoClear, NULL, 0);
+    }
+}
+
+- (void)recordLimit:(NSUInteger)limit {
+    if ([self isRecording]) {
+        SCStateAppendLimit(_pending, limit);
+    }
+}
+
+@end
+
+#pragma mark - Loading
+
+BOOL SCStateJournalDetect(NSData *data) {
+    size_t offset;
+    return fs_journal_begin((fs_buffer_t){ (void *)data.bytes, data.length }, SC_STATE_JOURNAL_FORMAT,
+                            NULL, &offset) == FS_ERROR_NONE;
+}
+
+SCState *_Nullable SCStateJournalLoad(NSData *data, NSString *filePath) {
+    fs_buffer_t journal = { (void *)data.bytes, data.length };
+    uint64_t compactedLength;
+    size_t offset;
+    if (fs_journal_begin(journal, SC_STATE_JOURNAL_FORMAT, &compactedLength, &offset) != FS_ERROR_NONE) {
+        return nil;
+    }
+
+    // Only the last header is decoded; history records are just indexed.
+    NSMutableData *records = [[NSMutableData alloc] init];
+    fs_journal_record_t record;
+    fs_journal_record_t header = { 0 };
+    BOOL haveHeader = NO;
+    while (fs_journal_next(journal, &offset, &record)) {
+        if (record.type == SCStateRecordHeader) {
+            header = record;
+            haveHeader = YES;
+        } else if (record.type >= SCStateRecordUndoPush && record.type <= SCStateRecordLimit) {
+            SCStateJournalRecordRef ref = { record.offset, record.len, (SCStateRecordType)record.type };
+            [records appendBytes:&ref length:sizeof(ref)];
+        }
+    }
+    if (!haveHeader) {
+        return nil;
+    }
+
+    NSData *headerJSON = [NSData dataWithBytesNoCopy:(void *)header.payload length:header.len freeWhenDone:NO];
+    NSDictionary *dictionary = [NSJSONSerialization JSONObjectWithData:headerJSON
+                                options:NSJSONReadingMutableContainers error:nil];
+    if (![dictionary isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+
+    SCState *state = [[SCState alloc] initWithDictionary:dictionary];
+    if (records.length != 0) {
+        [state _deferHistoryFromJournal:data records:records];
+    }
+    // `offset` is where the valid journal ends; a torn tail is cut by the next append.
+    [[state _journal] bindToPath:filePath end:offset compactedLength:compactedLength
+                       lastState:records.length != 0 ? nil : [NSData data]];
+    return state;
+}
+
+// Decodes a push against `last`; `before` and `after` are malloc'd.
+static BOOL SCStateReadPush(const unsigned char *payload, size_t len, fs_data_t last,
+                            fs_data_t *command, fs_data_t *before, fs_data_t *after) {
+    uint32_t lens[7];
+    if (len < sizeof(lens)) {
+        return NO;
+    }
+    memcpy(lens, payload, sizeof(lens));
+    if ((uint64_t)lens[0] + lens[3] + lens[6] != len - sizeof(lens)) {
+        return NO;
+    }
+
+    const unsigned char *p = payload + sizeof(lens);
+    fs_data_t beforeMiddle = { (void *)(p + lens[0]), lens[3], false };
+    fs_data_t afterMiddle = { (void *)(p + lens[0] + lens[3]), lens[6], false };
+    *command = (fs_data_t){ (void *)p, lens[0], false };
+    if (fs_undo_delta_apply(last, (fs_undo_delta_t){ lens[1], lens[2] }, beforeMiddle, before) != FS_ERROR_NONE) {
+        return NO;
+    }
+    if (fs_undo_delta_apply(*before, (fs_undo_delta_t){ lens[4], lens[5] }, afterMiddle, after) != FS_ERROR_NONE) {
+        free(before->bytes);
+        return NO;
+    }
+    return YES;
+}
+
+NSData *_Nullable SCStateJournalReplay(NSData *journal, NSData *records, fs_undo_log_t *undoLog,
+                                       fs_undo_log_t *redoLog) {
+    const unsigned char *bytes = journal.bytes;
+    const SCStateJournalRecordRef *refs = records.bytes;
+    size_t count = records.length / sizeof(SCStateJournalRecordRef);
+    fs_data_t last = { NULL, 0, false };
+
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char *payload = bytes + refs[i].offset + FS_JOURNAL_RECORD_HEADER_SIZE;
+        size_t len = refs[i].len;
+        fs_data_t command, before, after;
+
+        switch (refs[i].type) {
+            case SCStateRecordUndoPush:
+            case SCStateRecordRedoPush:
+                if (!SCStateReadPush(payload, len, last, &command, &before, &after)) {
+                    // Every later push is encoded against this one.
+                    FS_LOG_ERROR("SCStateParser", "Undecodable history record in state journal");
+                    free(last.bytes);
+                    return nil;
+                }
+                fs_undo_log_push(refs[i].type == SCStateRecordUndoPush ? undoLog : redoLog, command, before, after);
+                free(before.bytes);
+                free(last.bytes);
+                last = after;
+                break;
+            case SCStateRecordUndoPop:
+                fs_undo_log_pop(undoLog, NULL, NULL, NULL);
+                break;
+            case SCStateRecordRedoPop:
+                fs_undo_log_pop(redoLog, NULL, NULL, NULL);
+                break;
+            case SCStateRecordUndoClear:
+                fs_undo_log_clear(undoLog);
+                break;
+            case SCStateRecordRedoClear:
+                fs_undo_log_clear(redoLog);
+                break;
+            case SCStateRecordLimit:
+                if (len == sizeof(uint64_t)) {
+                    uint64_t limit;
+                    memcpy(&limit, payload, sizeof(limit));
+                    fs_undo_log_set_limit(undoLog, (size_t)limit);
+                    fs_undo_log_set_limit(redoLog, (size_t)limit);
+                }
+                break;
+            case SCStateRecordHeader:
+                break;
+        }
+    }
+    return last.bytes ? [NSData dataWithBytesNoCopy:last.bytes length:last.len freeWhenDone:YES] : [NSData data];
+}
+
+#pragma mark - Saving
+
+static void SCStateAppendHeader(NSMutableData *data, SCState *state) {
+    NSData *json = [NSJSONSerialization dataWithJSONObject:[state _journalHeader] options:0 error:nil];
+    fs_buffer_t part = { (void *)json.bytes, json.length };
+    SCStateAppendRecord(data, SCStateRecordHeader, &part, 1);
+}
+
+// Chains the pushes from `*last` on, as appends do, and leaves the newest state in it.
+static void SCStateAppendLog(NSMutableData *data, fs_undo_log_t *log, SCStateRecordType type, fs_data_t *last) {
+    size_t count = fs_undo_log_count(log);
+    for (size_t i = 0; i < count; i++) {
+        fs_data_t command, before, after;
+        if (fs_undo_log_get(log, i, &command, &before, &after) == FS_ERROR_NONE) {
+            SCStateAppendPush(data, type, *last, command, before, after);
+            free(command.bytes);
+            free(before.bytes);
+            free(last->bytes);
+            *last = after;
+        }
+    }
+}
+
+BOOL SCStateJournalSave(SCState *state, NSString *filePath, BOOL wait, void (^_Nullable completion)(BOOL success)) {
+    SCStateJournal *journal = [state _journal];
+    NSString *path = [filePath copy];
+    BOOL compact = [journal needsCompactionForPath:path];
+
+    NSMutableData *data;
+    uint64_t offset = 0;
+    if (compact) {
+        [state _loadHistoryIfNeeded];
+
+        fs_data_t last = { NULL, 0, false };
+        data = [NSMutableData dataWithLength:FS_JOURNAL_HEADER_SIZE];
+        SCStateAppendLimit(data, state.historyLimit);
+        SCStateAppendLog(data, [state _undoLog], SCStateRecordUndoPush, &last);
+        SCStateAppendLog(data, [state _redoLog], SCStateRecordRedoPush, &last);
+        SCStateAppendHeader(data, state);
+        // The header's user value remembers the compacted size.
+        fs_journal_write_header(data.mutableBytes, SC_STATE_JOURNAL_FORMAT, data.length);
+        [journal bindToPath:path end:data.length compactedLength:data.length
+                  lastState:last.bytes ? [NSData dataWithBytesNoCopy:last.bytes length:last.len freeWhenDone:YES]
+                                       : [NSData data]];
+    } else {
+        data = [[journal takePending] mutableCopy];
+        SCStateAppendHeader(data, state);
+        offset = [journal reserveAppendOfLength:data.length];
+    }
+
+    __block BOOL success = NO;
+    void (^write)(void) = ^{
+        fs_error_t error;
+        if (compact) {
+            error = fs_journal_rewrite(path.fileSystemRepresentation, data.bytes, data.length);
+        } else if (journal.failed) {
+            // An earlier append is missing; this one would leave a gap.
+            error = FS_ERROR_IO;
+        } else {
+            error = fs_journal_append(path.fileSystemRepresentation, offset, data.bytes, data.length);
+        }
+
+        success = error == FS_ERROR_NONE;
+        if (compact || !success) {
+            journal.failed = !success;
+        }
+        if (!success) {
+            FS_LOG_ERROR("SCStateParser", "Error writing state journal at path: %s (fs error %d)",
+                         path.UTF8String, (int)error);
+        }
+        if (completion) {
+            completion(success);
+        }
+    };
+
+    if (wait) {
+        dispatch_sync(SCStateJournalQueue(), write);
+        return success;
+    }
+    dispatch_async(SCStateJournalQueue(), write);
+    return YES;
+}
@@ -35,7 +35,8 @@
 //  of `.scstate` files, which store metadata related to document state in
 //  ScribbleLabApp.
 //
-//  The `.scstate` files are stored in JSON format and contain information such as:
+//  The `.scstate` files are append-only journals (older files are plain JSON,
+//  which is still read) and contain information such as:
 //  - Undo/redo history
 //  - Last modification date
 //  - Autosave preferences
@@ -66,18 +67,32 @@ NS_AVAILABLE(15, 18)
 
 /// Loads an `.scstate` file and parses its contents into an `SCState` object.
 ///
-/// This method reads a JSON file from disk, validates its structure, and
-/// initializes an `SCState` object with the extracted data.
+/// This method reads the file from disk, validates its structure, and
+/// initializes an `SCState` object with the extracted data. For journaled
+/// files only the small header (dates, cursor, selection, metadata) is
+/// decoded; the undo/redo history is replayed when it is first used.
 ///
 /// @param filePath The full path to the `.scstate` file.
 /// @return An `SCState` object if parsing succeeds, or `nil` if the file could not be read or was invalid.
 /// @note This method returns `nil` if the JSON structure is incorrect or the file is missing.
 + (nullable SCState *)loadStateFromFile:(NSString *)filePath;
 
-/// Saves the given `SCState` object to a `.scstate` JSON file.
+/// Loads an `.scstate` file on a background worker of the shared `SCDocumentLoader`.
 ///
-/// This method converts the `SCState` object into a JSON representation and
-/// writes it to disk.
+/// Use `-[SCDocumentLoader loadStatesAtPaths:completion:batchCompletion:]`
+/// to load many documents at once or to cancel loads.
+///
+/// @param filePath The full path to the `.scstate` file.
+/// @param completion Called on the main queue with the state, or `nil` if the file could not be read.
++ (void)loadStateFromFile:(NSString *)filePath
+               completion:(void (^)(SCState *_Nullable state))completion;
+
+/// Saves the given `SCState` object to a `.scstate` file.
+///
+/// If the state was loaded from or last saved to `filePath`, only the history
+/// changes since then and a new header are appended and flushed. Otherwise, or
+/// once appends have doubled the file, it is compacted: rewritten atomically
+/// with just the live history.
 ///
 /// @param state The `SCState` object containing the document state.
 /// @param filePath The destination file path where the `.scstate` file should be saved.
@@ -85,6 +100,18 @@ NS_AVAILABLE(15, 18)
 /// @note If saving fails, an error message is logged, but the method does not throw exceptions.
 + (BOOL)saveState:(SCState *)state toFile:(NSString *)filePath;
 
+/// Saves the given `SCState` object to a `.scstate` file without blocking the caller.
+///
+/// Works like `saveState:toFile:`. The bytes are prepared on the calling
+/// thread; they are written and flushed on a serial background queue, so
+/// consecutive saves land in order.
+///
+/// @param state The `SCState` object containing the document state.
+/// @param filePath The destination file path where the `.scstate` file should be saved.
+/// @param completion Called with the outcome on a background thread; may be `nil`.
++ (void)saveState:(SCState *)state toFile:(NSString *)filePath
+       completion:(nullable void (^)(BOOL success))completion;
+
 @end
 
 NS_ASSUME_NONNULL_END
\ No newline at end of file
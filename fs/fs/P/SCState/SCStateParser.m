@@ -36,7 +36,8 @@
 //  of `.scstate` files, which store metadata related to document state in
 //  ScribbleLabApp.
 //
-//  The `.scstate` files are stored in JSON format and contain information such as:
+//  The `.scstate` files are append-only journals (older files are plain JSON,
+//  which is still read) and contain information such as:
 //  - Undo/redo history
 //  - Last modification date
 //  - Autosave preferences
@@ -49,65 +50,91 @@
 
 #import "SCState.h"
 #import "SCStateParser.h"
+#import "SCStateJournal.h"
+#import "SCDocumentLoader.h"
 #include <Foundation/Foundation.h>
+#include <fs/fslog.h>
+#include <fs/io.h>
 
 @implementation SCStateParser
 
 + (nullable SCState *)loadStateFromFile:(NSString *)filePath {
+    fs_signpost_id_t signpost = FS_SIGNPOST_BEGIN(FS_SIGNPOST_PARSE);
+    SCState *state = [self _loadStateFromFile:filePath];
+    FS_SIGNPOST_END(FS_SIGNPOST_PARSE, signpost);
+    return state;
+}
+
++ (nullable SCState *)_loadStateFromFile:(NSString *)filePath {
     if (![[NSFileManager defaultManager] fileExistsAtPath:filePath]) {
-        NSLog(@"[SCStateParser]: State File does not exist at path: %@", filePath);
+        FS_LOG_ERROR("SCStateParser", "State File does not exist at path: %s", filePath.UTF8String);
         return nil;
     }
 
-    NSError *readError = nil;
-    NSData *data = [NSData dataWithContentsOfFile:filePath options:0 error:&readError];
+    fs_managed_buffer_t contents;
+    fs_error_t readError = fs_io_map(filePath.fileSystemRepresentation, FS_IO_ADVICE_SEQUENTIAL, &contents);
 
-    if (!data) {
-        NSLog(@"[SCStateParser]: Error reading file at path: %@\n%@", filePath,
-              readError.localizedDescription);
+    if (readError != FS_ERROR_NONE) {
+        FS_LOG_ERROR("SCStateParser", "Error reading file at path: %s (fs error %d)", filePath.UTF8String,
+                     (int)readError);
         return nil;
     }
 
+    NSData *data = fs_managed_buffer_nsdata(contents);
+    fs_managed_buffer_release(&contents);
+
+    // Journals decode only their header here; the history waits until it is used.
+    if (SCStateJournalDetect(data)) {
+        SCState *state = SCStateJournalLoad(data, filePath);
+        if (!state) {
+            FS_LOG_ERROR("SCStateParser", "Error reading state journal at path: %s", filePath.UTF8String);
+        }
+        return state;
+    }
+
+    // Files written before journaling are plain JSON.
     NSError *jsonError = nil;
     NSDictionary *jsonDict = [NSJSONSerialization JSONObjectWithData:data
                              options:NSJSONReadingMutableContainers error:&jsonError];
     
     if (!jsonDict || ![jsonDict isKindOfClass:[NSDictionary class]]) {
-        NSLog(@"[SCStateParser]: Error parsing JSON data from file at path: %@\n%@", filePath, 
-              jsonError.localizedDescription);
+        FS_LOG_ERROR("SCStateParser", "Error parsing JSON data from file at path: %s: %s", filePath.UTF8String,
+                     jsonError.localizedDescription.UTF8String);
         return nil;
     }
 
     return [[SCState alloc] initWithDictionary:jsonDict];
 }
 
++ (void)loadStateFromFile:(NSString *)filePath
+               completion:(void (^)(SCState *_Nullable state))completion {
+    [[SCDocumentLoader sharedLoader] loadStatesAtPaths:@[ filePath ]
+                                            completion:^(NSString *path, SCState *state) {
+                                                completion(state);
+                                            }
+                                       batchCompletion:nil];
+}
+
 + (BOOL)saveState:(SCState *)state toFile:(NSString *)filePath {
     if (!state) {
-        NSLog(@"[SCStateParser]: Cannot save nil state object to file at path: %@", filePath);
+        FS_LOG_ERROR("SCStateParser", "Cannot save nil state object to file at path: %s", filePath.UTF8String);
         return NO;
     }
 
-    NSDictionary *stateDict = [state toDictionary];
-
-    NSError *jsonError = nil;
-    NSData *jsonData = [NSJSONSerialization dataWithJSONObject:stateDict 
-                       options:NSJSONWritingPrettyPrinted error:&jsonError];
+    return SCStateJournalSave(state, filePath, YES, nil);
+}
 
-    if (!jsonData) {
-        NSLog(@"[SCStateParser]: Error serializing state object to JSON data for file at path: %@\n%@", 
-              filePath, jsonError.localizedDescription);
-        return NO;
++ (void)saveState:(SCState *)state toFile:(NSString *)filePath
+       completion:(nullable void (^)(BOOL success))completion {
+    if (!state) {
+        FS_LOG_ERROR("SCStateParser", "Cannot save nil state object to file at path: %s", filePath.UTF8String);
+        if (completion) {
+            completion(NO);
+        }
+        return;
     }
 
-    NSError *writeError = nil;
-    BOOL success = [jsonData writeToFile:filePath options:NSDataWritingAtomic error:&writeError];
-
-    if (!success) {
-        NSLog(@"[SCStateParser]: Error writing JSON data to file at path: %@\n%@", filePath, 
-              writeError.localizedDescription);
-    }
-    
-    return success;
+    SCStateJournalSave(state, filePath, NO, completion);
 }
 
 @end
@@ -46,17 +46,29 @@ FOUNDATION_EXPORT const unsigned char fsVersionString[];
 #import <fs/rtc.h>
 
 #pragma mark - Editor Core
+#import <fs/arena.h>
+#import <fs/bridge.h>
+#import <fs/dictionary.h>
 #import <fs/encoding.h>
 #import <fs/format.h>
+#import <fs/fslog.h>
 #import <fs/interop.h>
+#import <fs/undo.h>
 
 #pragma mark - IO
 #import <fs/io.h>
+#import <fs/journal.h>
+#import <fs/chunk.h>
+#import <fs/compress.h>
+#import <fs/pipeline.h>
 #import <fs/access.h>
 
 #pragma mark - P
+#import <fs/SCBackup.h>
+#import <fs/SCBackupParser.h>
 #import <fs/SCConfig.h>
 #import <fs/SCConfigPraser.h>
+#import <fs/SCDocumentLoader.h>
 #import <fs/SCState.h>
 #import <fs/SCStatePraser.h>
 
@@ -0,0 +1,160 @@
+//
+//  arena.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_ARENA_H
+#define FS_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
+
+/*
+ Region allocator for the short-lived values of a parse or render pass.
+
+ Allocations are bumped out of large blocks and released all at once with
+ fs_arena_reset(), which keeps the blocks for the next pass. Values made with
+ the fs_arena_* helpers have `owned == false`: the arena owns their memory and
+ they must not be freed individually. An arena is not thread-safe; worker
+ threads use their own, e.g. fs_arena_thread().
+ */
+
+/* Default block size when 0 is passed to fs_arena_init() */
+#define FS_ARENA_BLOCK_SIZE (64 * 1024)
+
+/* Alignment of fs_arena_alloc() and of the typed helpers */
+#define FS_ARENA_ALIGN 16
+
+struct fs_arena_block;
+
+typedef struct {
+    struct fs_arena_block* __nullable first;
+    struct fs_arena_block* __nullable current;
+    struct fs_arena_block* __nullable large;    // oversized allocations, newest first
+    uint8_t* __nullable pos;
+    uint8_t* __nullable end;
+    uint8_t* __nullable last;                   // start of the most recent allocation
+    size_t block_size;
+} __fs_SWIFT_NAME__(FSArena) fs_arena_t;
+
+/* A position to rewind to, for scratch allocations inside a pass */
+typedef struct {
+    struct fs_arena_block* __nullable block;
+    struct fs_arena_block* __nullable large;
+    uint8_t* __nullable pos;
+} __fs_SWIFT_NAME__(FSArenaMark) fs_arena_mark_t;
+
+/**
+ * Initializes an empty arena; no memory is allocated until the first use.
+ *
+ * @param arena The arena.
+ * @param block_size Size of the blocks to carve allocations from, 0 for
+ *        `FS_ARENA_BLOCK_SIZE`. Larger requests get a block of their own.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_arena_init(fs_arena_t* __nonnull arena, size_t block_size)
+    __fs_SWIFT_NAME__(FSArena.init(self:blockSize:));
+
+/** Frees all memory of the arena. Values allocated from it become invalid. */
+void fs_arena_destroy(fs_arena_t* __nonnull arena)
+    __fs_SWIFT_NAME__(FSArena.destroy(self:));
+
+/**
+ * Releases every allocation in O(1); blocks are kept for reuse, only
+ * oversized allocations are returned to the system.
+ */
+void fs_arena_reset(fs_arena_t* __nonnull arena)
+    __fs_SWIFT_NAME__(FSArena.reset(self:));
+
+/**
+ * Allocates `size` bytes aligned to `align` (a power of two, 0 for
+ * `FS_ARENA_ALIGN`). The memory is not zeroed.
+ *
+ * @return The allocation, or NULL when out of memory.
+ */
+void* __nullable fs_arena_alloc(fs_arena_t* __nonnull arena, size_t size, size_t align)
+    __fs_SWIFT_NAME__(FSArena.alloc(self:_:alignment:));
+
+/**
+ * Resizes an allocation. The most recent allocation grows or shrinks in
+ * place when its block has room, anything else is copied.
+ *
+ * @return The allocation, or NULL when out of memory (`ptr` stays valid).
+ */
+void* __nullable fs_arena_realloc(fs_arena_t* __nonnull arena, void* __nullable ptr, size_t old_size, size_t new_size)
+    __fs_SWIFT_NAME__(FSArena.realloc(self:_:oldSize:newSize:));
+
+/** Remembers the current position. */
+fs_arena_mark_t fs_arena_mark(const fs_arena_t* __nonnull arena)
+    __fs_SWIFT_NAME__(FSArena.mark(self:));
+
+/** Releases everything allocated since `mark`. */
+void fs_arena_rewind(fs_arena_t* __nonnull arena, fs_arena_mark_t mark)
+    __fs_SWIFT_NAME__(FSArena.rewind(self:to:));
+
+/**
+ * Copies `len` bytes of UTF-8 into the arena, NUL-terminated.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_arena_string(fs_arena_t* __nonnull arena, const char* __nullable utf8, size_t len, fs_string_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSArena.string(self:_:_:_:));
+
+/** Copies `len` bytes into the arena. */
+fs_error_t fs_arena_data(fs_arena_t* __nonnull arena, const void* __nullable bytes, size_t len, fs_data_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSArena.data(self:_:_:_:));
+
+/** Allocates an uninitialized buffer of `len` bytes. */
+fs_error_t fs_arena_buffer(fs_arena_t* __nonnull arena, size_t len, fs_buffer_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSArena.buffer(self:_:_:));
+
+/** Creates an empty array with room for `capacity` items. */
+fs_error_t fs_arena_array(fs_arena_t* __nonnull arena, size_t item_size, size_t capacity, fs_array_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSArena.array(self:itemSize:capacity:_:));
+
+/**
+ * Appends a copy of `item` to an arena array, doubling its capacity when full.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_arena_array_push(fs_arena_t* __nonnull arena, fs_array_t* __nonnull array, const void* __nonnull item)
+    __fs_SWIFT_NAME__(FSArena.push(self:_:_:));
+
+/**
+ * The calling thread's arena, created on first use and destroyed when the
+ * thread exits. Reset it at the end of each unit of work.
+ *
+ * @return The arena, or NULL when out of memory.
+ */
+fs_arena_t* __nullable fs_arena_thread(void)
+    __fs_SWIFT_NAME__(FSArena.thread());
+
+#endif /* FS_ARENA_H */
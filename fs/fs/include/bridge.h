@@ -0,0 +1,128 @@
+//
+//  bridge.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_BRIDGE_H
+#define FS_BRIDGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
+
+/*
+ Zero-copy hand-off of C-owned bytes to Swift and Objective-C.
+
+ A managed buffer pairs a view of the bytes with an owner object and the
+ fs_memory_management_t callbacks that keep it alive. Each copy of the view
+ that outlives its creator holds one reference; the memory is returned with
+ the last fs_managed_buffer_release(). Any storage can be exposed this way:
+ heap data, arena blocks kept alive by their owner, or memory-mapped files
+ released with munmap().
+ */
+
+/* Returns the memory of an adopted buffer; `context` is the one passed in */
+typedef void (*fs_bytes_deallocator)(void* __nullable ptr, size_t len, void* __nullable context);
+
+typedef struct {
+    fs_buffer_t buffer;
+    void* __nullable owner;
+    fs_memory_management_t memory;
+} __fs_SWIFT_NAME__(FSManagedBuffer) fs_managed_buffer_t;
+
+/**
+ * Takes ownership of `len` bytes at `ptr`. The returned buffer holds the only
+ * reference; `dealloc` is called once it is released.
+ *
+ * @param ptr The bytes, may be NULL when `len` is 0.
+ * @param len Number of bytes.
+ * @param dealloc Called with `ptr`, `len` and `context` when the last reference is released.
+ * @param context Passed to `dealloc`.
+ * @param out The managed buffer.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ *         On failure nothing is adopted and `dealloc` is not called.
+ */
+fs_error_t fs_managed_buffer_adopt(void* __nullable ptr, size_t len, fs_bytes_deallocator __nonnull dealloc,
+                                   void* __nullable context, fs_managed_buffer_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSManagedBuffer.init(adopting:count:deallocator:context:_:));
+
+/**
+ * Moves the bytes of an owned `fs_data_t` (allocated with malloc) into a
+ * managed buffer without copying. `data` is left empty.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY`, or `FS_ERROR_INVALID_ARGUMENT`
+ *         when `data` is not owned; borrowed bytes need an owner, see fs_managed_buffer_wrap().
+ */
+fs_error_t fs_managed_buffer_from_data(fs_data_t* __nonnull data, fs_managed_buffer_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSManagedBuffer.init(moving:_:));
+
+/**
+ * Wraps bytes that live as long as `owner`, taking one reference on it.
+ *
+ * @param ptr The bytes, may be NULL when `len` is 0.
+ * @param len Number of bytes.
+ * @param owner The object that keeps the bytes alive.
+ * @param memory Retain/release callbacks for `owner`.
+ * @param out The managed buffer.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_managed_buffer_wrap(void* __nullable ptr, size_t len, void* __nonnull owner,
+                                  const fs_memory_management_t* __nonnull memory, fs_managed_buffer_t* __nonnull out)
+    __fs_SWIFT_NAME__(FSManagedBuffer.init(wrapping:count:owner:memory:_:));
+
+/** Takes another reference for a copy of the view that is kept separately. */
+void fs_managed_buffer_retain(const fs_managed_buffer_t* __nonnull buffer)
+    __fs_SWIFT_NAME__(FSManagedBuffer.retain(self:));
+
+/** Drops a reference and clears the view. */
+void fs_managed_buffer_release(fs_managed_buffer_t* __nonnull buffer)
+    __fs_SWIFT_NAME__(FSManagedBuffer.release(self:));
+
+#ifdef __OBJC__
+#import <Foundation/Foundation.h>
+
+/**
+ * Returns an `NSData` (a `Data` in Swift) that shares the buffer's memory.
+ * It takes its own reference, so `buffer` may be released right away.
+ */
+NSData* _Nonnull fs_managed_buffer_nsdata(fs_managed_buffer_t buffer)
+    __fs_SWIFT_NAME__(getter:FSManagedBuffer.data(self:));
+
+/**
+ * Wraps the bytes of an immutable `data` without copying; the buffer keeps
+ * `data` alive.
+ *
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_managed_buffer_from_nsdata(NSData* _Nonnull data, fs_managed_buffer_t* _Nonnull out)
+    __fs_SWIFT_NAME__(FSManagedBuffer.init(data:_:));
+#endif
+
+#endif /* FS_BRIDGE_H */
@@ -0,0 +1,122 @@
+//
+//  chunk.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_CHUNK_H
+#define FS_CHUNK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
+
+/*
+ Content-defined chunking for deduplicated storage.
+
+ Boundaries are placed with FastCDC: a gear rolling hash is updated one byte
+ at a time and a boundary is cut where its top bits are zero. Below the
+ average size a stricter mask is used and above it a looser one (normalized
+ chunking), which keeps chunk sizes close to the average. Because the
+ decision only depends on the last 64 bytes, an edit moves the boundaries of
+ the chunks around it and leaves every other chunk, and its id, unchanged.
+
+ Chunks are named by a 128-bit non-cryptographic hash. The gear table and
+ the hash are part of the storage format: changing either changes every
+ boundary and id.
+ */
+
+/* Defaults for fs_chunker_config_t */
+#define FS_CHUNK_MIN_SIZE (8 * 1024)
+#define FS_CHUNK_AVG_SIZE (32 * 1024)
+#define FS_CHUNK_MAX_SIZE (256 * 1024)
+
+typedef struct {
+    /** No boundary is placed before this many bytes, 0 for `FS_CHUNK_MIN_SIZE` */
+    size_t min_size;
+    /** Target chunk size, rounded down to a power of two, 0 for `FS_CHUNK_AVG_SIZE` */
+    size_t avg_size;
+    /** A boundary is forced at this size, 0 for `FS_CHUNK_MAX_SIZE` */
+    size_t max_size;
+} __fs_SWIFT_NAME__(FSChunkerConfig) fs_chunker_config_t;
+
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} __fs_SWIFT_NAME__(FSChunkID) fs_chunk_id_t;
+
+/* Length of fs_chunk_id_hex() output, excluding the NUL */
+#define FS_CHUNK_ID_HEX_LEN 32
+
+/**
+ * Returns the length of the first chunk of `data`.
+ *
+ * @param data The bytes to split.
+ * @param len Length of `data`.
+ * @param config Chunk sizes; `NULL` for the defaults.
+ * @return The chunk length, at most `len`; 0 only if `len` is 0.
+ */
+size_t fs_chunk_next(const void* __nullable data, size_t len, const fs_chunker_config_t* __nullable config)
+    __fs_SWIFT_NAME__(fsChunkNext(_:_:_:));
+
+/**
+ * Splits `data` into chunks.
+ *
+ * @param data The bytes to split.
+ * @param len Length of `data`.
+ * @param config Chunk sizes; `NULL` for the defaults.
+ * @param ends Receives a malloc'd array with the end offset of every chunk; free() it.
+ * @param count Receives the number of chunks.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_chunk_split(const void* __nullable data, size_t len, const fs_chunker_config_t* __nullable config,
+                          size_t* __nullable* __nonnull ends, size_t* __nonnull count)
+    __fs_SWIFT_NAME__(fsChunkSplit(_:_:_:_:_:));
+
+/**
+ * Computes the id of a chunk. Safe to call from several threads at once.
+ */
+fs_chunk_id_t fs_chunk_hash(const void* __nullable data, size_t len)
+    __fs_SWIFT_NAME__(fsChunkHash(_:_:));
+
+/** Compares two ids. */
+static inline bool fs_chunk_id_equal(fs_chunk_id_t a, fs_chunk_id_t b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+/**
+ * Formats an id as 32 lowercase hex digits, high half first.
+ *
+ * @param id The id.
+ * @param out At least `FS_CHUNK_ID_HEX_LEN + 1` bytes; NUL-terminated.
+ */
+void fs_chunk_id_hex(fs_chunk_id_t id, char* __nonnull out)
+    __fs_SWIFT_NAME__(fsChunkIDHex(_:_:));
+
+#endif
@@ -0,0 +1,88 @@
+//
+//  compress.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_COMPRESS_H
+#define FS_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fs/interop.h>
+
+/*
+ Fast block compression in the LZ4 block format.
+
+ Greedy matching through a 4096-entry hash table of 4-byte sequences, with
+ lengths and offsets encoded as LZ4 sequences, so any LZ4 block decoder can
+ read the output. Compression runs at several hundred MB/s per core and
+ decompression at memory speed; both are stateless and safe to call from
+ several threads at once. The decoder checks every length against both
+ buffers and never reads or writes outside them, so it can be fed untrusted
+ input.
+ */
+
+/**
+ * Returns the largest possible size of compressing `len` bytes.
+ */
+static inline size_t fs_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+/**
+ * Compresses a block.
+ *
+ * @param src The bytes to compress.
+ * @param len Length of `src`, at most 2 GiB.
+ * @param dst Receives the compressed block.
+ * @param capacity Size of `dst`; `fs_compress_bound(len)` always suffices.
+ * @param out_len Receives the compressed length.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` if `dst` is too small.
+ */
+fs_error_t fs_compress(const void* __nullable src, size_t len, void* __nonnull dst, size_t capacity,
+                       size_t* __nonnull out_len)
+    __fs_SWIFT_NAME__(fsCompress(_:_:_:_:_:));
+
+/**
+ * Decompresses a block produced by fs_compress() or any LZ4 block encoder.
+ *
+ * @param src The compressed block.
+ * @param len Length of `src`.
+ * @param dst Receives the original bytes. Bytes past the decompressed length may
+ *            be overwritten.
+ * @param capacity Size of `dst`.
+ * @param out_len Receives the decompressed length.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` if the block is
+ *         malformed or does not fit in `dst`.
+ */
+fs_error_t fs_decompress(const void* __nullable src, size_t len, void* __nonnull dst, size_t capacity,
+                         size_t* __nonnull out_len)
+    __fs_SWIFT_NAME__(fsDecompress(_:_:_:_:_:));
+
+#endif
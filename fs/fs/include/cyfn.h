@@ -48,10 +48,51 @@
 #define CYFN_CTR 1
 #endif
 
+// Authenticated encryption (AES-GCM)
+#ifndef CYFN_GCM
+#define CYFN_GCM 1
+#endif
+
 #define CYFN_AES256 1
 
+// Hardware AES (AES-NI on x86_64, ARMv8 Crypto Extensions on arm64/arm64e).
+// The instruction set actually used is detected at runtime; set this to 0 to
+// build the portable implementation only.
+#ifndef CYFN_HW_ACCEL
+#define CYFN_HW_ACCEL 1
+#endif
+
+// Software AES used by the portable backend (and wherever no AES instructions
+// are available):
+//   CYFN_SOFT_AES_BYTEWISE  byte-oriented reference rounds; smallest code.
+//   CYFN_SOFT_AES_TTABLE    32-bit T-tables; fastest, but table lookups are
+//                           data dependent and leak through cache timing.
+//   CYFN_SOFT_AES_BITSLICE  bitsliced, four blocks at a time; no secret-dependent
+//                           memory accesses or branches (constant time).
+#define CYFN_SOFT_AES_BYTEWISE 0
+#define CYFN_SOFT_AES_TTABLE   1
+#define CYFN_SOFT_AES_BITSLICE 2
+
+#ifndef CYFN_SOFT_AES
+#define CYFN_SOFT_AES CYFN_SOFT_AES_BYTEWISE
+#endif
+
+// Multi-core variants of the CTR and CBC decryption functions.
+#ifndef CYFN_PARALLEL
+#define CYFN_PARALLEL 1
+#endif
+
+// Default buffer size, in bytes, from which the parallel variants split work
+// across cores. Can be changed at runtime with cyfn_set_parallel_threshold().
+#ifndef CYFN_PARALLEL_THRESHOLD
+#define CYFN_PARALLEL_THRESHOLD (1024 * 1024)
+#endif
+
 #define CYFN_AES_BLOCKLEN 16
 
+#define CYFN_GCM_IVLEN 12
+#define CYFN_GCM_TAGLEN 16
+
 #if defined(CYFN_AES256) && (CYFN_AES256 == 1)
 #define CYFN_AES_KEYLEN 32
 #define CYFN_AES_keyExpSize 240
@@ -69,16 +110,78 @@
  * This structure contains the expanded key and, optionally, the initialization vector (IV).
  *
  * @field cyfn_roundKey Expanded encryption key.
+ * @field cyfn_bsRoundKey Bitsliced copy of the expanded key (CYFN_SOFT_AES_BITSLICE only).
  * @field cyfn_iv Initialization vector (IV) used for CBC and CTR modes.
  */
 struct cyfn_ctx {
     uint8_t cyfn_roundKey[CYFN_AES_keyExpSize];
     
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+    uint64_t cyfn_bsRoundKey[CYFN_AES_keyExpSize / 2];
+#endif
+    
+#if (defined(CYFN_CBC) && (CYFN_CBC == 1)) || (defined(CYFN_ECB) && (CYFN_ECB == 1))
+    uint8_t cyfn_invRoundKey[CYFN_AES_keyExpSize];
+#endif
+    
 #if (defined(CYFN_CBC) && (CYFN_CBC == 1)) || (defined(CYFN_CTR) && (CYFN_CTR == 1))
     uint8_t cyfn_iv[CYFN_AES_BLOCKLEN];
 #endif
 };
 
+/**
+ * Identifies an AES implementation that cyfn can dispatch to.
+ *
+ * All backends produce identical output and share the same `struct cyfn_ctx`
+ * layout, so a context can be used with any of them.
+ *
+ * @constant CYFN_BACKEND_AUTO The fastest backend supported by the running CPU.
+ * @constant CYFN_BACKEND_PORTABLE The software implementation selected by `CYFN_SOFT_AES`.
+ * @constant CYFN_BACKEND_AESNI x86_64 AES-NI instructions.
+ * @constant CYFN_BACKEND_ARMV8 ARMv8 Cryptography Extensions (AESE/AESD).
+ */
+typedef enum {
+    CYFN_BACKEND_AUTO = 0,
+    CYFN_BACKEND_PORTABLE,
+    CYFN_BACKEND_AESNI,
+    CYFN_BACKEND_ARMV8,
+    CYFN_BACKEND_MAX
+} cyfn_backend_t;
+
+/**
+ * Selects the AES implementation used by all cyfn functions.
+ *
+ * The backend is chosen automatically on first use, so calling this is only
+ * needed to pin a specific implementation (e.g. for testing or benchmarking).
+ *
+ * @param backend The backend to use, or `CYFN_BACKEND_AUTO` to restore automatic selection.
+ * @return 0 on success, -1 if the backend is not available on this CPU or build.
+ */
+int cyfn_set_backend(cyfn_backend_t backend);
+
+/**
+ * Returns the AES implementation currently in use.
+ *
+ * @return The active backend; never `CYFN_BACKEND_AUTO`.
+ */
+cyfn_backend_t cyfn_get_backend(void);
+
+/**
+ * Tells whether a backend is compiled in and supported by the running CPU.
+ *
+ * @param backend The backend to query.
+ * @return 1 if the backend can be selected, 0 otherwise.
+ */
+int cyfn_backend_is_available(cyfn_backend_t backend);
+
+/**
+ * Returns a human-readable name for a backend (e.g. `"aesni"`).
+ *
+ * @param backend The backend to describe.
+ * @return A static string; `"unknown"` for out-of-range values.
+ */
+const char* cyfn_backend_name(cyfn_backend_t backend);
+
 /**
  * Initializes the encryption context with the provided key.
  *
@@ -179,6 +282,214 @@ void cyfn_cbc_decrypt_buffer(struct cyfn_ctx* ctx, uint8_t* buf, size_t length);
  */
 void cyfn_ctr_xcrypt_buffer(struct cyfn_ctx* ctx, uint8_t* buf, size_t length);
 
+/**
+ * Encrypts or decrypts data at an arbitrary byte offset of a CTR stream.
+ *
+ * The stream is identified by the key in `ctx` and its initial counter block `iv`
+ * (the IV the stream was started with). The counter for `offset` is derived
+ * directly, so any range can be rewritten or read without processing the bytes
+ * before it. `ctx->cyfn_iv` is neither read nor modified, which makes the call
+ * safe to issue concurrently on a shared context.
+ *
+ * @note The output matches `cyfn_ctr_xcrypt_buffer` as long as every call on the
+ *       stream, except possibly the last, processed a multiple of
+ *       `CYFN_AES_BLOCKLEN` bytes; that function discards the unused keystream of
+ *       a trailing partial block.
+ *
+ * @param ctx A pointer to the AES context structure holding the key.
+ * @param iv The initial counter block of the stream (`CYFN_AES_BLOCKLEN` bytes).
+ * @param offset The byte offset within the stream of `buf[0]`.
+ * @param buf A pointer to the data to be processed in place.
+ * @param length The length of the data in bytes.
+ */
+void cyfn_ctr_xcrypt_at(const struct cyfn_ctx* ctx, const uint8_t* iv, uint64_t offset, uint8_t* buf, size_t length);
+
+/**
+ * Out-of-place variant of `cyfn_ctr_xcrypt_at`.
+ *
+ * Reads from `in` (which may be a read-only mapping of an encrypted file) and
+ * writes the result to `out`. The buffers may be identical but must not
+ * otherwise overlap.
+ *
+ * @param ctx A pointer to the AES context structure holding the key.
+ * @param iv The initial counter block of the stream (`CYFN_AES_BLOCKLEN` bytes).
+ * @param offset The byte offset within the stream of `in[0]`.
+ * @param in A pointer to the source data.
+ * @param out A pointer to the destination buffer of at least `length` bytes.
+ * @param length The length of the data in bytes.
+ */
+void cyfn_ctr_xcrypt_copy_at(const struct cyfn_ctx* ctx, const uint8_t* iv, uint64_t offset,
+                             const uint8_t* in, uint8_t* out, size_t length);
+
 #endif // #if defined(CTR) && (CTR == 1)
 
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+
+/**
+ * A structure that holds the state of a streaming AES-GCM operation.
+ *
+ * Encryption and authentication happen in a single pass: each chunk of data is
+ * run through the CTR keystream and folded into GHASH while it is still in cache.
+ * The GHASH key material is laid out for the backend that was active when the
+ * context was initialized, so a context must not outlive a `cyfn_set_backend` call.
+ *
+ * @field cyfn_aes Expanded encryption key.
+ * @field cyfn_htable Precomputed multiples/powers of the hash key H (backend specific).
+ * @field cyfn_j0 Pre-counter block; encrypts the final tag.
+ * @field cyfn_counter Next counter block for the keystream.
+ * @field cyfn_ghash Running GHASH accumulator.
+ * @field cyfn_keystream Keystream of the current partial block.
+ * @field cyfn_pending Input collected for the current partial GHASH block.
+ * @field cyfn_aad_len Number of additional authenticated data bytes.
+ * @field cyfn_text_len Number of plaintext/ciphertext bytes.
+ * @field cyfn_backend Backend the context was initialized for (opaque).
+ * @field cyfn_ghash_backend Backend providing the GHASH implementation (opaque).
+ */
+struct cyfn_gcm_ctx {
+    struct cyfn_ctx cyfn_aes;
+    uint64_t cyfn_htable[32];
+    uint8_t cyfn_j0[CYFN_AES_BLOCKLEN];
+    uint8_t cyfn_counter[CYFN_AES_BLOCKLEN];
+    uint8_t cyfn_ghash[CYFN_AES_BLOCKLEN];
+    uint8_t cyfn_keystream[CYFN_AES_BLOCKLEN];
+    uint8_t cyfn_pending[CYFN_AES_BLOCKLEN];
+    uint64_t cyfn_aad_len;
+    uint64_t cyfn_text_len;
+    const void* cyfn_backend;
+    const void* cyfn_ghash_backend;
+};
+
+/**
+ * Initializes a GCM context with the provided key and IV.
+ *
+ * @note A 12-byte (`CYFN_GCM_IVLEN`) IV is strongly recommended; other lengths
+ *       are hashed into the pre-counter block as specified by NIST SP 800-38D.
+ *       No IV should ever be reused with the same key.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param key A pointer to the encryption key (`CYFN_AES_KEYLEN` bytes).
+ * @param iv A pointer to the initialization vector.
+ * @param iv_len The length of the IV in bytes (non-zero).
+ * @return 0 on success, -1 if `iv_len` is 0.
+ */
+int cyfn_gcm_init_ctx(struct cyfn_gcm_ctx* ctx, const uint8_t* key, const uint8_t* iv, size_t iv_len);
+
+/**
+ * Starts a new message on an initialized GCM context, keeping its key.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param iv A pointer to the new initialization vector.
+ * @param iv_len The length of the IV in bytes (non-zero).
+ * @return 0 on success, -1 if `iv_len` is 0.
+ */
+int cyfn_gcm_ctx_set_iv(struct cyfn_gcm_ctx* ctx, const uint8_t* iv, size_t iv_len);
+
+/**
+ * Adds additional authenticated data (AAD) to the message.
+ *
+ * AAD is authenticated but not encrypted. It may be supplied in several calls,
+ * all of which must come before the first encrypt/decrypt call.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param aad A pointer to the additional data.
+ * @param length The length of the data in bytes.
+ * @return 0 on success, -1 if encryption or decryption has already started.
+ */
+int cyfn_gcm_update_aad(struct cyfn_gcm_ctx* ctx, const uint8_t* aad, size_t length);
+
+/**
+ * Encrypts data in place and authenticates the resulting ciphertext.
+ *
+ * May be called repeatedly with chunks of any length.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param buf A pointer to the data to be encrypted.
+ * @param length The length of the data in bytes.
+ */
+void cyfn_gcm_encrypt_update(struct cyfn_gcm_ctx* ctx, uint8_t* buf, size_t length);
+
+/**
+ * Authenticates ciphertext and decrypts it in place.
+ *
+ * May be called repeatedly with chunks of any length. The plaintext must not be
+ * trusted until `cyfn_gcm_verify` succeeds.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param buf A pointer to the data to be decrypted.
+ * @param length The length of the data in bytes.
+ */
+void cyfn_gcm_decrypt_update(struct cyfn_gcm_ctx* ctx, uint8_t* buf, size_t length);
+
+/**
+ * Completes the message and produces the authentication tag.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param tag A pointer to the output buffer for the tag.
+ * @param tag_len The number of tag bytes to write (at most `CYFN_GCM_TAGLEN`).
+ */
+void cyfn_gcm_finish(struct cyfn_gcm_ctx* ctx, uint8_t* tag, size_t tag_len);
+
+/**
+ * Completes the message and checks it against an expected tag in constant time.
+ *
+ * @param ctx A pointer to the GCM context structure.
+ * @param tag A pointer to the expected tag.
+ * @param tag_len The length of the expected tag in bytes (at most `CYFN_GCM_TAGLEN`).
+ * @return 0 if the tag matches, -1 otherwise.
+ */
+int cyfn_gcm_verify(struct cyfn_gcm_ctx* ctx, const uint8_t* tag, size_t tag_len);
+
+#endif // #if defined(CYFN_GCM) && (CYFN_GCM == 1)
+
+#if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1)
+
+/**
+ * Sets the buffer size from which the parallel variants use more than one core.
+ *
+ * Buffers smaller than the threshold are processed on the calling thread by the
+ * corresponding single-threaded function.
+ *
+ * @param bytes The new threshold in bytes; 0 restores `CYFN_PARALLEL_THRESHOLD`.
+ */
+void cyfn_set_parallel_threshold(size_t bytes);
+
+/**
+ * Returns the buffer size from which the parallel variants use more than one core.
+ *
+ * @return The current threshold in bytes.
+ */
+size_t cyfn_get_parallel_threshold(void);
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+/**
+ * Decrypts data using AES in CBC mode, splitting large buffers across cores.
+ *
+ * Produces the same plaintext and leaves the same IV in `ctx` as
+ * `cyfn_cbc_decrypt_buffer`. Each worker starts from the ciphertext block that
+ * precedes its range, so the buffer is still decrypted in place.
+ *
+ * @param ctx A pointer to the AES context structure.
+ * @param buf A pointer to the data to be decrypted.
+ * @param length The length of the data in bytes (a multiple of `CYFN_AES_BLOCKLEN`).
+ */
+void cyfn_cbc_decrypt_buffer_parallel(struct cyfn_ctx* ctx, uint8_t* buf, size_t length);
+#endif
+
+#if defined(CYFN_CTR) && (CYFN_CTR == 1)
+/**
+ * Encrypts or decrypts data using AES in CTR mode, splitting large buffers across cores.
+ *
+ * Produces the same output and leaves the same IV in `ctx` as
+ * `cyfn_ctr_xcrypt_buffer`. Each worker derives the counter for its range
+ * directly from the IV.
+ *
+ * @param ctx A pointer to the AES context structure.
+ * @param buf A pointer to the data to be processed.
+ * @param length The length of the data in bytes.
+ */
+void cyfn_ctr_xcrypt_buffer_parallel(struct cyfn_ctx* ctx, uint8_t* buf, size_t length);
+#endif
+
+#endif // #if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+//
+//  dictionary.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_DICTIONARY_H
+#define FS_DICTIONARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
+
+/*
+ Hash-indexed fs_dictionary_t.
+
+ `keys` is a dense array of `count` fs_string_t and `values` the matching
+ array of `void*`, so the entries can be walked directly. `index` is an
+ open-addressing table in the style of SwissTable: one control byte per slot
+ holding 7 bits of the hash, probed 16 slots at a time with SSE2 or NEON,
+ pointing into the dense arrays. Lookups and inserts are O(1) and touch one
+ cache line of control bytes in the common case.
+
+ By default removal moves the last entry into the hole. With
+ `FS_DICT_ORDERED` the arrays stay in insertion order for serialization, at
+ the price of O(n) removal.
+ */
+
+/* Keep `keys`/`values` in insertion order */
+#define FS_DICT_ORDERED      (1 << 0)
+/* Store the caller's key pointers instead of copying the bytes; keys must outlive the dictionary */
+#define FS_DICT_BORROW_KEYS  (1 << 1)
+
+/**
+ * Initializes an empty dictionary.
+ *
+ * @param dict The dictionary.
+ * @param capacity Number of entries to reserve room for.
+ * @param options `FS_DICT_*` flags.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_dict_init(fs_dictionary_t* __nonnull dict, size_t capacity, uint32_t options)
+    __fs_SWIFT_NAME__(FSDictionary.init(self:capacity:options:));
+
+/** Frees the index, the arrays and copied keys. Values are not touched. */
+void fs_dict_free(fs_dictionary_t* __nonnull dict)
+    __fs_SWIFT_NAME__(FSDictionary.free(self:));
+
+/** Removes all entries, keeping the allocated capacity. */
+void fs_dict_clear(fs_dictionary_t* __nonnull dict)
+    __fs_SWIFT_NAME__(FSDictionary.clear(self:));
+
+/**
+ * Makes room for `count` entries in total without further allocation.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_dict_reserve(fs_dictionary_t* __nonnull dict, size_t count)
+    __fs_SWIFT_NAME__(FSDictionary.reserve(self:_:));
+
+/**
+ * Inserts `key` or replaces its value.
+ *
+ * @param dict The dictionary.
+ * @param key The key bytes, matched exactly (UTF-8 or binary).
+ * @param key_len Length of the key.
+ * @param value The value to store.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_dict_set(fs_dictionary_t* __nonnull dict, const char* __nullable key, size_t key_len, void* __nullable value)
+    __fs_SWIFT_NAME__(FSDictionary.set(self:_:_:_:));
+
+/**
+ * Looks up `key`.
+ *
+ * @param value Receives the stored value if found; may be NULL.
+ * @return Whether the key exists.
+ */
+bool fs_dict_find(const fs_dictionary_t* __nonnull dict, const char* __nullable key, size_t key_len,
+                  void* __nullable* __nullable value)
+    __fs_SWIFT_NAME__(FSDictionary.find(self:_:_:_:));
+
+/**
+ * Position of `key` in `keys`/`values`, or `SIZE_MAX` if it does not exist.
+ * Positions change when entries are removed.
+ */
+size_t fs_dict_position(const fs_dictionary_t* __nonnull dict, const char* __nullable key, size_t key_len)
+    __fs_SWIFT_NAME__(FSDictionary.position(self:_:_:));
+
+/**
+ * Removes `key`.
+ *
+ * @param value Receives the removed value; may be NULL.
+ * @return Whether the key existed.
+ */
+bool fs_dict_remove(fs_dictionary_t* __nonnull dict, const char* __nullable key, size_t key_len,
+                    void* __nullable* __nullable value)
+    __fs_SWIFT_NAME__(FSDictionary.remove(self:_:_:_:));
+
+/** The key at `position` (< `count`). */
+static inline const fs_string_t* __nonnull fs_dict_key_at(const fs_dictionary_t* __nonnull dict, size_t position) {
+    return (const fs_string_t*)dict->keys + position;
+}
+
+/** The value at `position` (< `count`). */
+static inline void* __nullable fs_dict_value_at(const fs_dictionary_t* __nonnull dict, size_t position) {
+    return ((void* const*)dict->values)[position];
+}
+
+#endif /* FS_DICTIONARY_H */
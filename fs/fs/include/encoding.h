@@ -33,7 +33,9 @@
 #define ENCODING_H
 
 #include <stdint.h>
-#include <fs/fs.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
 
 #ifndef FS_UNSUPPORTED_ENCODING
     #define FS_UNSUPPORTED_ENCODING(name) ((void)("[WARN]: " name " encoding is not supported on this platform "))
@@ -147,8 +149,6 @@ typedef enum {
 #endif
 
 #define FS_IS_UTF8(enc)      ((enc) & FS_ENC_F_VALID_UTF8)
-#define FS_IS_UTF16(enc)     ((enc) & (FS_ENC_F_VALID_UTF16LE | FS_ENC_F_VALID_UTF16BE))
-#define FS_IS_UTF32(enc)     ((enc) & (FS_ENC_F_VALID_UTF32LE | FS_ENC_F_VALID_UTF32BE))
 #define FS_IS_ASCII(enc)      ((enc) & FS_ENC_F_VALID_ASCII)
 
 #ifdef _WIN32
@@ -204,4 +204,117 @@ typedef struct {
     bool has_bom;
 } fs_enc_info_t;
 
+/**
+ * Classifies a buffer in a single pass.
+ *
+ * One vectorized scan (AVX2 or SSSE3 on x86_64, NEON on arm64, chosen at
+ * runtime) sniffs the BOM, validates UTF-8 with an ASCII fast path, detects
+ * NUL bytes and counts LF, CRLF and lone CR line endings.
+ *
+ * Without a BOM the result is, in order of preference: `FS_ENC_ASCII`,
+ * `FS_ENC_UTF8`, UTF-16/UTF-32 recognised from the position of NUL bytes,
+ * and for other 8-bit text `FS_ENC_WIN_1252` (if bytes 0x80-0x9F occur) or
+ * `FS_ENC_ISO_8859_1`. Buffers with NUL bytes that do not look like UTF-16/32
+ * get `FS_ENC_UNKNOWN` and `FS_ENC_F_BINARY`. MacRoman and EBCDIC are never
+ * guessed.
+ *
+ * `eol` is the most frequent line ending (`FS_EOL_DEFAULT` if there is none);
+ * `FS_ENC_F_MIXED_EOL` is set when more than one kind occurs. For UTF-16/32
+ * line endings are counted in code units. The UTF-16/32 flags report the
+ * detected encoding; surrogate pairing is checked when transcoding.
+ *
+ * @param data The bytes to classify (may be NULL when `len` is 0).
+ * @param len The number of bytes.
+ * @param info Receives the result.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` for NULL pointers.
+ */
+fs_error_t fs_enc_detect(const void* __nullable data, size_t len, fs_enc_info_t* __nonnull info)
+    __fs_SWIFT_NAME__(fsDetectEncoding(_:_:_:));
+
+/* Incremental detection options */
+#define FS_ENC_DETECT_EARLY_EXIT (1 << 0)
+
+/**
+ * State of an incremental detection. Caller-allocated and opaque; it holds
+ * partial UTF-8 sequences and CR/LF pairs across chunk boundaries, so memory
+ * use does not depend on the input size.
+ */
+typedef struct {
+    uint64_t _storage[64];
+} __fs_SWIFT_NAME__(FSEncodingDetector) fs_enc_detector_t;
+
+/**
+ * Prepares a detector.
+ *
+ * With `FS_ENC_DETECT_EARLY_EXIT` the detector stops as soon as more input
+ * cannot change the result, currently once the input is known to be binary
+ * (NUL bytes without a UTF-16/32 pattern in the first KiB).
+ *
+ * A non-zero `sample_limit` bounds the bytes examined: the result then
+ * describes the first `sample_limit` bytes, and a UTF-8 sequence cut by the
+ * limit is not treated as an error.
+ *
+ * @param detector The detector to initialize.
+ * @param options `FS_ENC_DETECT_*` flags.
+ * @param sample_limit Maximum number of bytes to examine, 0 for all.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_enc_detector_init(fs_enc_detector_t* __nonnull detector, uint32_t options, uint64_t sample_limit)
+    __fs_SWIFT_NAME__(FSEncodingDetector.reset(self:options:sampleLimit:));
+
+/**
+ * Feeds the next chunk. Chunks may have any size; input after the detector
+ * is done is ignored.
+ *
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_enc_detector_feed(fs_enc_detector_t* __nonnull detector, const void* __nullable data, size_t len)
+    __fs_SWIFT_NAME__(FSEncodingDetector.feed(self:_:_:));
+
+/**
+ * Whether the result is settled (early exit or sample limit reached), so the
+ * caller can stop reading.
+ */
+bool fs_enc_detector_done(const fs_enc_detector_t* __nonnull detector)
+    __fs_SWIFT_NAME__(getter:FSEncodingDetector.isDone(self:));
+
+/**
+ * Classifies everything fed so far; same result as `fs_enc_detect()` over the
+ * concatenated chunks. The detector must be initialized again before reuse.
+ *
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_enc_detector_finish(fs_enc_detector_t* __nonnull detector, fs_enc_info_t* __nonnull info)
+    __fs_SWIFT_NAME__(FSEncodingDetector.finish(self:_:));
+
+/* Transcoding options */
+#define FS_ENC_CONV_NORMALIZE_EOL (1 << 0)
+
+/**
+ * Transcodes a buffer to UTF-8 without allocating.
+ *
+ * Supports every `fs_enc_t` except `FS_ENC_UNKNOWN` and `FS_ENC_EBCDIC`. A
+ * leading BOM of the source encoding is dropped, ill-formed input (invalid
+ * UTF-8, unpaired surrogates, truncated code units, bytes >= 0x80 in ASCII)
+ * is replaced by U+FFFD. With `FS_ENC_CONV_NORMALIZE_EOL` every CRLF, CR and
+ * LF is written as `FS_EOL_DEFAULT` in the same pass.
+ *
+ * Call with `dst` (or `dst->ptr`) NULL to get the output length, then again
+ * with a buffer of at least that size.
+ *
+ * @param encoding The encoding of `src`.
+ * @param src The bytes to transcode (may be NULL when `len` is 0).
+ * @param len The number of bytes.
+ * @param options `FS_ENC_CONV_*` flags.
+ * @param dst Destination; `dst->len` is its capacity.
+ * @param written Receives the number of bytes written, or needed.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` if `dst` is too small
+ *         (`written` then holds the size needed and the contents of `dst`
+ *         are unspecified), `FS_ERROR_NOT_SUPPORTED` for the encoding, or
+ *         `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_enc_to_utf8(fs_enc_t encoding, const void* __nullable src, size_t len, uint32_t options,
+                          const fs_buffer_t* __nullable dst, size_t* __nonnull written)
+    __fs_SWIFT_NAME__(fsTranscodeToUTF8(_:_:_:_:_:_:));
+
 #endif
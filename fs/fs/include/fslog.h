@@ -28,3 +28,194 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_LOG_H
+#define FS_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <fs/interop.h>
+
+
+/* Logging.
+
+ FS_LOG_ERROR(), FS_LOG_INFO() and FS_LOG_DEBUG() format the message into a
+ ring buffer owned by the calling thread and return: no lock is taken and
+ nothing is written on the caller's thread. A background thread drains the
+ rings every `FS_LOG_DRAIN_MS` (sooner after an error or when a ring fills
+ up) and hands each message to the sink, which defaults to os_log on Apple
+ platforms and stderr elsewhere. When a ring is full the message is dropped
+ and counted rather than waited for.
+
+ Levels below `FS_LOG_LEVEL` are compiled out together with their arguments,
+ which are still type-checked. `category` must be a string with static
+ storage, usually a literal naming the component.
+ */
+
+typedef enum {
+    FS_LOG_DEBUG_LEVEL = 0,
+    FS_LOG_INFO_LEVEL = 1,
+    FS_LOG_ERROR_LEVEL = 2,
+    /** Logs nothing; only meaningful as a threshold */
+    FS_LOG_OFF_LEVEL = 3
+} __fs_SWIFT_NAME__(FSLogLevel) fs_log_level_t;
+
+/* Lowest level compiled in, as the number of an fs_log_level_t value */
+#ifndef FS_LOG_LEVEL
+#if defined(NDEBUG)
+#define FS_LOG_LEVEL 1
+#else
+#define FS_LOG_LEVEL 0
+#endif
+#endif
+
+/* Messages per thread buffered between drains (a power of two) */
+#ifndef FS_LOG_RING_SLOTS
+#define FS_LOG_RING_SLOTS 128
+#endif
+
+/* Longer messages are truncated */
+#define FS_LOG_MESSAGE_MAX 228
+
+/* Interval of the background drain */
+#define FS_LOG_DRAIN_MS 100
+
+typedef struct {
+    uint64_t time_ns;           // CLOCK_REALTIME when the message was logged
+    uint64_t thread;            // system thread id of the caller
+    fs_log_level_t level;
+    const char* __nonnull category;
+    const char* __nonnull message;  // NUL-terminated, valid during the sink call
+    size_t length;
+} __fs_SWIFT_NAME__(FSLogRecord) fs_log_record_t;
+
+/* Receives drained messages in order per thread, on the drain thread */
+typedef void (*fs_log_sink_t)(void* __nullable context, const fs_log_record_t* __nonnull record);
+
+/**
+ * Formats a message into the calling thread's ring. Prefer the FS_LOG_*
+ * macros, which compile out below `FS_LOG_LEVEL`.
+ *
+ * @param level Severity; messages below the runtime level are ignored.
+ * @param category Component name with static storage.
+ * @param format printf-style format.
+ */
+void fs_log(fs_log_level_t level, const char* __nonnull category, const char* __nonnull format, ...)
+    __attribute__((format(printf, 3, 4))) __fs_SWIFT_PRIVATE__;
+
+/** fs_log() with a `va_list`. */
+void fs_logv(fs_log_level_t level, const char* __nonnull category, const char* __nonnull format, va_list args)
+    __attribute__((format(printf, 3, 0))) __fs_SWIFT_PRIVATE__;
+
+/**
+ * Logs a preformatted message, for callers that cannot use varargs.
+ *
+ * @param level Severity; messages below the runtime level are ignored.
+ * @param category Component name with static storage.
+ * @param message The message; copied, truncated to `FS_LOG_MESSAGE_MAX` bytes.
+ */
+void fs_log_message(fs_log_level_t level, const char* __nonnull category, const char* __nonnull message)
+    __fs_SWIFT_NAME__(fsLogMessage(_:_:_:));
+
+/**
+ * Sets the lowest level that is logged at runtime. Levels compiled out by
+ * `FS_LOG_LEVEL` stay out.
+ */
+void fs_log_set_level(fs_log_level_t level)
+    __fs_SWIFT_NAME__(fsLogSetLevel(_:));
+
+/** Returns whether a message of `level` would be logged. */
+bool fs_log_enabled(fs_log_level_t level)
+    __fs_SWIFT_NAME__(fsLogIsEnabled(_:));
+
+/**
+ * Replaces the sink. Messages already drained are not affected; the call
+ * waits for a drain in progress.
+ *
+ * @param sink The new sink, or NULL for the default one.
+ * @param context Passed to `sink`.
+ */
+void fs_log_set_sink(fs_log_sink_t __nullable sink, void* __nullable context)
+    __fs_SWIFT_NAME__(fsLogSetSink(_:_:));
+
+/**
+ * Drains every ring on the calling thread and returns once the sink has seen
+ * all messages logged before the call. Also runs at exit.
+ */
+void fs_log_flush(void)
+    __fs_SWIFT_NAME__(fsLogFlush());
+
+/** Returns the number of messages dropped because a ring was full. */
+uint64_t fs_log_dropped(void)
+    __fs_SWIFT_NAME__(fsLogDropped());
+
+#if FS_LOG_LEVEL <= 0
+#define FS_LOG_DEBUG(category, ...) fs_log(FS_LOG_DEBUG_LEVEL, category, __VA_ARGS__)
+#else
+#define FS_LOG_DEBUG(category, ...) do { if (0) fs_log(FS_LOG_DEBUG_LEVEL, category, __VA_ARGS__); } while (0)
+#endif
+
+#if FS_LOG_LEVEL <= 1
+#define FS_LOG_INFO(category, ...) fs_log(FS_LOG_INFO_LEVEL, category, __VA_ARGS__)
+#else
+#define FS_LOG_INFO(category, ...) do { if (0) fs_log(FS_LOG_INFO_LEVEL, category, __VA_ARGS__); } while (0)
+#endif
+
+#if FS_LOG_LEVEL <= 2
+#define FS_LOG_ERROR(category, ...) fs_log(FS_LOG_ERROR_LEVEL, category, __VA_ARGS__)
+#else
+#define FS_LOG_ERROR(category, ...) do { if (0) fs_log(FS_LOG_ERROR_LEVEL, category, __VA_ARGS__); } while (0)
+#endif
+
+
+/* Signposts.
+
+ Intervals around the expensive stages, shown by Instruments' os_signpost
+ instrument under subsystem "com.scribblefoundation.fs", category "Stages".
+ Each interval gets its own id, so overlapping intervals on worker
+ threads pair up correctly. When no tool is recording, begin and end cost a
+ single check; on other platforms, and with `FS_SIGNPOST` set to 0, they do
+ nothing.
+ */
+
+#ifndef FS_SIGNPOST
+#define FS_SIGNPOST 1
+#endif
+
+typedef enum {
+    /** Reading a .scconfig or .scstate file */
+    FS_SIGNPOST_PARSE = 0,
+    /** Encrypting a chunk */
+    FS_SIGNPOST_ENCRYPT = 1,
+    /** Chunking and hashing a document for delta sync */
+    FS_SIGNPOST_SYNC = 2,
+    /** Backing up a document */
+    FS_SIGNPOST_BACKUP = 3
+} __fs_SWIFT_NAME__(FSSignpostStage) fs_signpost_stage_t;
+
+/* 0 when no interval was started */
+typedef uint64_t fs_signpost_id_t;
+
+/**
+ * Starts an interval of `stage`.
+ *
+ * @return The id to end it with, 0 when nothing is recording.
+ */
+fs_signpost_id_t fs_signpost_begin(fs_signpost_stage_t stage)
+    __fs_SWIFT_NAME__(fsSignpostBegin(_:));
+
+/** Ends the interval `id` returned by fs_signpost_begin() for the same stage. */
+void fs_signpost_end(fs_signpost_stage_t stage, fs_signpost_id_t id)
+    __fs_SWIFT_NAME__(fsSignpostEnd(_:_:));
+
+#if FS_SIGNPOST
+#define FS_SIGNPOST_BEGIN(stage) fs_signpost_begin(stage)
+#define FS_SIGNPOST_END(stage, id) fs_signpost_end(stage, id)
+#else
+#define FS_SIGNPOST_BEGIN(stage) ((fs_signpost_id_t)0)
+#define FS_SIGNPOST_END(stage, id) ((void)(id))
+#endif
+
+#endif /* FS_LOG_H */
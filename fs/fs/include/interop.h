@@ -149,6 +149,7 @@ typedef struct {
     size_t count;
     size_t capacity;
     bool owned;
+    void* __nullable index;     // hash index over `keys`, see dictionary.h
 } __fs_SWIFT_NAME__(FSDictionary) fs_dictionary_t;
 
 typedef enum {
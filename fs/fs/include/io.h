@@ -28,3 +28,226 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_IO_H
+#define FS_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fs/interop.h>
+#include <fs/bridge.h>
+
+/*
+ Read-only document access. Large files are memory-mapped so opening them
+ costs only the pages that are touched; small ones are read into the heap,
+ where a single read() is cheaper than setting up a mapping and faulting it
+ in. Either way the bytes come back as a managed buffer that can be handed to
+ Objective-C or Swift without copying.
+
+ Mapped views must not be written to, and a file truncated by another process
+ while mapped raises SIGBUS on access, as with any mapping.
+ */
+
+/* Files smaller than this are read instead of mapped */
+#define FS_IO_MAP_THRESHOLD (64 * 1024)
+
+typedef enum {
+    /** No particular access pattern */
+    FS_IO_ADVICE_NORMAL = 0,
+    /** Read front to back once; pages are read ahead aggressively */
+    FS_IO_ADVICE_SEQUENTIAL = 1,
+    /** Accessed at scattered offsets; read-ahead is disabled */
+    FS_IO_ADVICE_RANDOM = 2,
+    /** Needed soon; paging in starts in the background */
+    FS_IO_ADVICE_WILLNEED = 3
+} __fs_SWIFT_NAME__(FSIOAdvice) fs_io_advice_t;
+
+/**
+ * Opens a file as a read-only view of its contents.
+ *
+ * @param path Path of a regular file.
+ * @param advice Expected access pattern of the whole file.
+ * @param out The contents; release with fs_managed_buffer_release().
+ * @return `FS_ERROR_NONE`, `FS_ERROR_NOT_FOUND`, `FS_ERROR_PERMISSION`,
+ *         `FS_ERROR_OUT_OF_MEMORY`, `FS_ERROR_INVALID_ARGUMENT` (not a regular
+ *         file) or `FS_ERROR_IO`.
+ */
+fs_error_t fs_io_map(const char* __nonnull path, fs_io_advice_t advice, fs_managed_buffer_t* __nonnull out)
+    __fs_SWIFT_NAME__(fsMapFile(_:_:_:));
+
+/**
+ * Gives an access hint for part of a view returned by fs_io_map(), e.g. to
+ * prefetch the region around a scroll position. The range is widened to page
+ * boundaries. Hints are best effort and have no useful effect on heap-backed views.
+ *
+ * @param view The view.
+ * @param offset Start of the range within the view.
+ * @param len Length of the range.
+ * @param advice Expected access pattern of the range.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_io_advise(const fs_buffer_t* __nonnull view, size_t offset, size_t len, fs_io_advice_t advice)
+    __fs_SWIFT_NAME__(fsAdvise(_:_:_:_:));
+
+/*
+ Asynchronous reads and writes.
+
+ An engine runs requests off the calling thread on the fastest available
+ backend (dispatch_io on Apple platforms, io_uring on Linux, a small pool of
+ pread/pwrite threads elsewhere). At most `queue_depth` requests are in flight;
+ the rest wait in submission order and are handed to the backend in batches.
+ Each request completes exactly once through its `callback`, on an engine
+ thread, with `fs_result_t.value` pointing at the request. The request and its
+ buffer must stay valid until then.
+ */
+
+/* Defaults for fs_io_engine_config_t */
+#define FS_IO_QUEUE_DEPTH 64
+#define FS_IO_BATCH_SIZE 16
+
+typedef enum {
+    FS_IO_READ = 0,
+    FS_IO_WRITE = 1,
+    /** Flushes the file to stable storage; `offset` and `buffer` are ignored */
+    FS_IO_FSYNC = 2
+} __fs_SWIFT_NAME__(FSIOOperation) fs_io_op_t;
+
+typedef struct fs_io_request {
+    fs_io_op_t op;
+    int fd;
+    uint64_t offset;
+    /** Destination of a read, source of a write */
+    fs_buffer_t buffer;
+    /** Optional; setting its `is_cancelled` cancels the request like fs_io_cancel() */
+    fs_async_operation_t* __nullable operation;
+    fs_swift_result_callback __nullable callback;
+    void* __nullable context;
+    /** Bytes moved; less than `buffer.len` only for reads that hit end of file */
+    size_t transferred;
+    
+    /* Engine bookkeeping, zero-initialize and leave alone */
+    struct fs_io_request* __nullable _next;
+    void* __nullable _backend;
+    uint32_t _flags;
+} __fs_SWIFT_NAME__(FSIORequest) fs_io_request_t;
+
+typedef struct fs_io_engine fs_io_engine_t;
+
+typedef struct {
+    /** Maximum number of requests in flight, 0 for `FS_IO_QUEUE_DEPTH` */
+    uint32_t queue_depth;
+    /** Maximum number of requests handed to the backend at once, 0 for `FS_IO_BATCH_SIZE` */
+    uint32_t batch_size;
+} __fs_SWIFT_NAME__(FSIOEngineConfig) fs_io_engine_config_t;
+
+/**
+ * Creates an engine.
+ *
+ * @param config Limits, or NULL for the defaults.
+ * @param out The engine.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_INVALID_ARGUMENT`.
+ */
+fs_error_t fs_io_engine_create(const fs_io_engine_config_t* __nullable config, fs_io_engine_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(fsIOEngineCreate(_:_:));
+
+/**
+ * Cancels queued requests, waits for the ones in flight and frees the engine.
+ * Must not be called from a completion callback.
+ */
+void fs_io_engine_destroy(fs_io_engine_t* __nullable engine)
+    __fs_SWIFT_NAME__(fsIOEngineDestroy(_:));
+
+/** The process-wide engine used by autosave and backups; NULL if it cannot be created. */
+fs_io_engine_t* __nullable fs_io_engine_shared(void)
+    __fs_SWIFT_NAME__(fsIOEngineShared());
+
+/** Name of the backend in use: "dispatch_io", "io_uring" or "threads". */
+const char* __nonnull fs_io_engine_backend(const fs_io_engine_t* __nonnull engine)
+    __fs_SWIFT_NAME__(fsIOEngineBackend(_:));
+
+/**
+ * Queues `count` requests. Never blocks on I/O; returns as soon as the
+ * requests are queued or handed to the backend.
+ *
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` if a request is
+ *         malformed or already queued (nothing is queued then).
+ */
+fs_error_t fs_io_submit(fs_io_engine_t* __nonnull engine, fs_io_request_t* __nonnull const* __nonnull requests, size_t count)
+    __fs_SWIFT_NAME__(fsIOSubmit(_:_:_:));
+
+/**
+ * Cancels a request. A queued request completes with `FS_ERROR_CANCELLED`
+ * right away; one in flight is aborted if the backend still can, and
+ * otherwise completes normally.
+ *
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_NOT_FOUND` if the request is not queued or in flight.
+ */
+fs_error_t fs_io_cancel(fs_io_engine_t* __nonnull engine, fs_io_request_t* __nonnull request)
+    __fs_SWIFT_NAME__(fsIOCancel(_:_:));
+
+/** Waits until no request is queued or in flight. Must not be called from a completion callback. */
+void fs_io_engine_drain(fs_io_engine_t* __nonnull engine)
+    __fs_SWIFT_NAME__(fsIOEngineDrain(_:));
+
+/**
+ * Atomically replaces the file at `path` with `contents`: the bytes are
+ * written to a temporary file next to it, flushed and renamed into place,
+ * all on the engine. Only creating the temporary file happens on the calling
+ * thread.
+ *
+ * @param engine The engine, usually fs_io_engine_shared().
+ * @param path Destination path.
+ * @param contents The bytes; a reference is held until the save completes.
+ * @param callback Called once with the outcome on an engine thread; may be NULL.
+ * @param context Passed to `callback`.
+ * @return `FS_ERROR_NONE` if the save was started (`callback` then reports the
+ *         outcome), otherwise the error and `callback` is not called.
+ */
+fs_error_t fs_io_save_async(fs_io_engine_t* __nonnull engine, const char* __nonnull path,
+                            const fs_managed_buffer_t* __nonnull contents,
+                            fs_swift_error_callback __nullable callback, void* __nullable context)
+    __fs_SWIFT_NAME__(fsSaveAsync(_:_:_:_:_:));
+
+/** Size and modification time of a file, as stat() reports them. */
+typedef struct {
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+} __fs_SWIFT_NAME__(FSIOStamp) fs_io_stamp_t;
+
+typedef void (*fs_io_stamp_callback)(void* __nullable context, fs_error_t error, fs_io_stamp_t stamp);
+
+/**
+ * fs_io_save_async() that also reports the stamp of the file it wrote, taken
+ * from the temporary file just before the rename. Unlike a stat() of `path`
+ * afterwards, it cannot pick up a later writer's file.
+ *
+ * @param callback Called once with the outcome and, on success, the stamp
+ *        (zero otherwise) on an engine thread; may be NULL.
+ */
+fs_error_t fs_io_save_stamped_async(fs_io_engine_t* __nonnull engine, const char* __nonnull path,
+                                    const fs_managed_buffer_t* __nonnull contents,
+                                    fs_io_stamp_callback __nullable callback, void* __nullable context)
+    __fs_SWIFT_NAME__(fsSaveStampedAsync(_:_:_:_:_:));
+
+#ifdef __OBJC__
+#import <Foundation/Foundation.h>
+
+/**
+ * fs_io_save_async() for Objective-C callers, on the shared engine. `data` is
+ * written without copying; `completion` runs on an engine thread.
+ *
+ * @return `FS_ERROR_NONE` if the save was started, otherwise the error and
+ *         `completion` is not called.
+ */
+fs_error_t fs_io_save_nsdata_async(NSData* _Nonnull data, NSString* _Nonnull path,
+                                   void (^ _Nullable completion)(fs_error_t error))
+    __fs_SWIFT_NAME__(fsSaveAsync(_:to:completion:));
+
+/** fs_io_save_stamped_async() for Objective-C callers, like fs_io_save_nsdata_async(). */
+fs_error_t fs_io_save_nsdata_stamped_async(NSData* _Nonnull data, NSString* _Nonnull path,
+                                           void (^ _Nullable completion)(fs_error_t error, fs_io_stamp_t stamp))
+    __fs_SWIFT_NAME__(fsSaveStampedAsync(_:to:completion:));
+#endif
+
+#endif /* FS_IO_H */
@@ -0,0 +1,150 @@
+//
+//  journal.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_JOURNAL_H
+#define FS_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
+
+/*
+ Append-only record journals.
+
+ A journal file is a 16-byte header followed by records, each a 12-byte
+ header (payload length, caller-defined type, checksum) and the payload.
+ Saving appends records to the end; rewriting the whole file (compaction)
+ goes through a temporary file and rename, so readers always see either the
+ old or the new journal.
+
+ An append interrupted by a crash leaves a torn record at the end. Readers
+ stop at the first record whose length or checksum does not match, and the
+ next fs_journal_append() cuts the file back to the end of the last good
+ record before writing.
+
+ Records are read in place from a buffer, typically one returned by
+ fs_io_map(); nothing is copied.
+ */
+
+#define FS_JOURNAL_HEADER_SIZE 16
+#define FS_JOURNAL_RECORD_HEADER_SIZE 12
+
+/* Largest payload of a single record */
+#define FS_JOURNAL_RECORD_MAX ((size_t)UINT32_MAX)
+
+typedef struct {
+    /** Caller-defined record type */
+    uint32_t type;
+    /** Points into the journal buffer */
+    const void* __nonnull payload;
+    size_t len;
+    /** Offset of the record header within the journal */
+    size_t offset;
+} __fs_SWIFT_NAME__(FSJournalRecord) fs_journal_record_t;
+
+/** Bytes taken by a record with a `payload_len`-byte payload. */
+static inline size_t fs_journal_record_size(size_t payload_len) {
+    return FS_JOURNAL_RECORD_HEADER_SIZE + payload_len;
+}
+
+/**
+ * Writes a journal file header.
+ *
+ * @param dst At least `FS_JOURNAL_HEADER_SIZE` bytes.
+ * @param format Caller-defined format tag (e.g. a four-character code), checked when reading.
+ * @param user Caller-defined value stored in the header, e.g. the size of the file when it was compacted.
+ */
+void fs_journal_write_header(void* __nonnull dst, uint32_t format, uint64_t user)
+    __fs_SWIFT_NAME__(fsJournalWriteHeader(_:_:_:));
+
+/**
+ * Writes one record whose payload is the concatenation of `parts`.
+ *
+ * @param dst At least fs_journal_record_size() of the total payload length.
+ * @param type Caller-defined record type.
+ * @param parts Payload pieces.
+ * @param count Number of pieces.
+ * @return Bytes written, or 0 if the payload exceeds `FS_JOURNAL_RECORD_MAX`.
+ */
+size_t fs_journal_write_record(void* __nonnull dst, uint32_t type, const fs_buffer_t* __nullable parts, size_t count)
+    __fs_SWIFT_NAME__(fsJournalWriteRecord(_:_:_:_:));
+
+/**
+ * Validates the header of a journal and returns the offset of its first
+ * record, to be passed to fs_journal_next().
+ *
+ * @param journal The journal bytes.
+ * @param format The expected format tag.
+ * @param user Receives the header's user value; may be `NULL`.
+ * @param offset Receives the offset of the first record.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_NOT_SUPPORTED` when `journal` does not
+ *         start with a journal header of that format.
+ */
+fs_error_t fs_journal_begin(fs_buffer_t journal, uint32_t format, uint64_t* __nullable user, size_t* __nonnull offset)
+    __fs_SWIFT_NAME__(fsJournalBegin(_:_:_:_:));
+
+/**
+ * Reads the record at `*offset` and advances `*offset` past it.
+ *
+ * @return `false` at the end of the journal or at the first torn or corrupt
+ *         record; `*offset` is then the end of the valid journal.
+ */
+bool fs_journal_next(fs_buffer_t journal, size_t* __nonnull offset, fs_journal_record_t* __nonnull record)
+    __fs_SWIFT_NAME__(fsJournalNext(_:_:_:));
+
+/**
+ * Appends records to a journal file and flushes them to stable storage.
+ *
+ * Bytes after `end` (a torn record) are discarded first. Several records
+ * appended in one call share one flush, so callers batch to commit a group.
+ *
+ * @param path The journal file.
+ * @param end Offset where the valid journal ends, as left by fs_journal_next() or the previous append.
+ * @param bytes Encoded records.
+ * @param len Length of `bytes`.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_NOT_FOUND`, `FS_ERROR_PERMISSION`,
+ *         `FS_ERROR_INVALID_ARGUMENT` (the file is shorter than `end`, i.e.
+ *         it was replaced) or `FS_ERROR_IO`.
+ */
+fs_error_t fs_journal_append(const char* __nonnull path, uint64_t end, const void* __nullable bytes, size_t len)
+    __fs_SWIFT_NAME__(fsJournalAppend(_:_:_:_:));
+
+/**
+ * Replaces a journal file with `bytes` (a header and records) atomically:
+ * written to a temporary file, flushed, then renamed over `path`.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_NOT_FOUND`, `FS_ERROR_PERMISSION` or `FS_ERROR_IO`.
+ */
+fs_error_t fs_journal_rewrite(const char* __nonnull path, const void* __nonnull bytes, size_t len)
+    __fs_SWIFT_NAME__(fsJournalRewrite(_:_:_:));
+
+#endif
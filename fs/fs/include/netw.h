@@ -28,3 +28,503 @@
 //  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Networking
+
+#ifndef FS_NETW_H
+#define FS_NETW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+#include <fs/interop.h>
+
+/*
+ Receive ring.
+
+ fs_net_ring_t is the buffer a connection reads into and protocol parsers
+ work on in place. Its pages are mapped twice, back to back, so the unread
+ bytes are always one contiguous span, and so is the free space, even when
+ they wrap. Frames are parsed, unmasked and handed on where they were
+ received, and nothing is ever moved to make room.
+
+ A ring is used by one thread at a time.
+ */
+
+typedef struct fs_net_ring fs_net_ring_t;
+
+/**
+ * Creates a ring.
+ *
+ * @param capacity Minimum size in bytes; rounded up to whole pages.
+ * @param out Receives the ring.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         or `FS_ERROR_NOT_SUPPORTED` where pages cannot be mapped twice.
+ */
+fs_error_t fs_net_ring_create(size_t capacity, fs_net_ring_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSNetRing.create(capacity:_:));
+
+void fs_net_ring_destroy(fs_net_ring_t* __nullable ring)
+    __fs_SWIFT_NAME__(FSNetRing.destroy(self:));
+
+size_t fs_net_ring_capacity(const fs_net_ring_t* __nonnull ring)
+    __fs_SWIFT_NAME__(getter:FSNetRing.capacity(self:));
+
+/**
+ * Returns the free space, which starts at `*span`; read into it, then call
+ * fs_net_ring_produce().
+ */
+size_t fs_net_ring_write_span(fs_net_ring_t* __nonnull ring, uint8_t* __nullable* __nonnull span)
+    __fs_SWIFT_NAME__(FSNetRing.writeSpan(self:_:));
+
+/** Appends `length` bytes written at the write span. */
+void fs_net_ring_produce(fs_net_ring_t* __nonnull ring, size_t length)
+    __fs_SWIFT_NAME__(FSNetRing.produce(self:_:));
+
+/** Returns the unread bytes, which start at `*span` and may be modified in place. */
+size_t fs_net_ring_read_span(const fs_net_ring_t* __nonnull ring, uint8_t* __nullable* __nonnull span)
+    __fs_SWIFT_NAME__(FSNetRing.readSpan(self:_:));
+
+/** Releases the first `length` unread bytes. */
+void fs_net_ring_consume(fs_net_ring_t* __nonnull ring, size_t length)
+    __fs_SWIFT_NAME__(FSNetRing.consume(self:_:));
+
+/*
+ Event loop.
+
+ fs_net_loop_t waits for sockets to become readable or writable, with
+ kqueue on Apple platforms and epoll on Linux, and calls the handler of
+ each one that is ready. Watches are level-triggered; a handler that leaves
+ bytes unread is called again on the next run. On kqueue, watch changes are
+ handed to the kernel with the next wait instead of one call each.
+
+ A loop runs on one thread. fs_net_loop_wake() may be called from any
+ thread to end a wait early.
+ */
+
+typedef enum {
+    FS_NET_READABLE = 1,
+    FS_NET_WRITABLE = 2,
+} __fs_SWIFT_NAME__(FSNetEvents) fs_net_events_t;
+
+/** Called with the events ready on `fd`; errors and hang-ups are reported as the events watched. */
+typedef void (*fs_net_event_handler_t)(void* __nullable context, int fd, unsigned events);
+
+typedef struct fs_net_loop fs_net_loop_t;
+
+/**
+ * Creates a loop.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         `FS_ERROR_IO`, or `FS_ERROR_NOT_SUPPORTED` without kqueue or epoll.
+ */
+fs_error_t fs_net_loop_create(fs_net_loop_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSNetLoop.create(_:));
+
+/** Frees a loop; the sockets it watched are not closed. */
+void fs_net_loop_destroy(fs_net_loop_t* __nullable loop)
+    __fs_SWIFT_NAME__(FSNetLoop.destroy(self:));
+
+/**
+ * Watches `fd` for `events`, or changes what it is watched for. A socket
+ * watched for no events still stays registered.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY` or `FS_ERROR_IO`.
+ */
+fs_error_t fs_net_loop_watch(fs_net_loop_t* __nonnull loop, int fd, unsigned events,
+                             fs_net_event_handler_t __nonnull handler, void* __nullable context)
+    __fs_SWIFT_NAME__(FSNetLoop.watch(self:_:events:_:_:));
+
+/** Stops watching `fd`; events already collected for it are dropped. Call before closing it. */
+void fs_net_loop_unwatch(fs_net_loop_t* __nonnull loop, int fd)
+    __fs_SWIFT_NAME__(FSNetLoop.unwatch(self:_:));
+
+/**
+ * Waits up to `timeout_ms` (-1 for no limit) for events and handles them.
+ *
+ * @return `FS_ERROR_NONE`, also after a timeout, a wake or a signal, or `FS_ERROR_IO`.
+ */
+fs_error_t fs_net_loop_run(fs_net_loop_t* __nonnull loop, int timeout_ms)
+    __fs_SWIFT_NAME__(FSNetLoop.run(self:timeout:));
+
+/** Ends the current or next wait of fs_net_loop_run(); may be called from any thread. */
+fs_error_t fs_net_loop_wake(fs_net_loop_t* __nonnull loop)
+    __fs_SWIFT_NAME__(FSNetLoop.wake(self:));
+
+/** Milliseconds on a monotonic clock, for the `now_ms` arguments below. */
+uint64_t fs_net_now_ms(void)
+    __fs_SWIFT_NAME__(getter:FSNetLoop.nowMilliseconds());
+
+/*
+ Connection pool.
+
+ fs_net_pool_t opens TCP connections on a loop and keeps them per host, so a
+ protocol that can carry many requests on one connection reuses it instead
+ of paying a handshake each time. Each connection has a capacity, the number
+ of users it takes at once (1 until the protocol says otherwise);
+ fs_net_pool_acquire() returns the oldest connection to the host with room,
+ and opens a new one only when all are full. Connections nobody has used
+ for `idle_timeout_ms` are closed, and so are ones still connecting after
+ `connect_timeout_ms`.
+
+ Connections are non-blocking, have Nagle's algorithm off, and try each
+ address of the host in turn. Names are resolved with getaddrinfo(), which
+ blocks, and the addresses are kept for `dns_ttl_ms`. Bytes are read into a
+ receive ring per connection and handed to the handler there; writes go
+ straight to the socket, and whatever the socket does not take is queued
+ and sent when it is writable again.
+
+ A pool is used on the thread that runs its loop.
+ */
+
+/* Defaults for fs_net_pool_config_t */
+#define FS_NET_POOL_MAX_PER_HOST 4
+#define FS_NET_POOL_IDLE_TIMEOUT_MS 30000
+#define FS_NET_POOL_CONNECT_TIMEOUT_MS 10000
+#define FS_NET_POOL_DNS_TTL_MS 60000
+#define FS_NET_POOL_RING_CAPACITY ((size_t)64 << 10)
+
+typedef struct fs_net_conn fs_net_conn_t;
+
+/**
+ * What a pool tells about its connections. `opened` is called once a
+ * connection is established, `received` whenever bytes were added to its
+ * ring (consume what was handled), and `closed` when it failed, was closed
+ * by the peer (`FS_ERROR_NONE`), idled out (`FS_ERROR_NONE`), timed out
+ * connecting (`FS_ERROR_TIMEOUT`) or was closed with its pool
+ * (`FS_ERROR_CANCELLED`). It is not called for fs_net_conn_close().
+ */
+typedef struct {
+    void (* __nonnull opened)(void* __nullable context, fs_net_conn_t* __nonnull conn);
+    void (* __nonnull received)(void* __nullable context, fs_net_conn_t* __nonnull conn,
+                                fs_net_ring_t* __nonnull ring);
+    void (* __nonnull closed)(void* __nullable context, fs_net_conn_t* __nonnull conn, fs_error_t error);
+} __fs_SWIFT_NAME__(FSNetConnectionHandler) fs_net_conn_handler_t;
+
+typedef struct {
+    /** Connections per host, 0 for `FS_NET_POOL_MAX_PER_HOST` */
+    size_t max_per_host;
+    /** 0 for `FS_NET_POOL_IDLE_TIMEOUT_MS` */
+    uint32_t idle_timeout_ms;
+    /** 0 for `FS_NET_POOL_CONNECT_TIMEOUT_MS` */
+    uint32_t connect_timeout_ms;
+    /** 0 for `FS_NET_POOL_DNS_TTL_MS` */
+    uint32_t dns_ttl_ms;
+    /** Receive ring of each connection, 0 for `FS_NET_POOL_RING_CAPACITY` */
+    size_t ring_capacity;
+} __fs_SWIFT_NAME__(FSNetPoolConfig) fs_net_pool_config_t;
+
+typedef struct fs_net_pool fs_net_pool_t;
+
+/**
+ * Creates a pool.
+ *
+ * @param config NULL for the defaults.
+ * @param handler Copied; called for every connection.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_net_pool_create(fs_net_loop_t* __nonnull loop, const fs_net_pool_config_t* __nullable config,
+                              const fs_net_conn_handler_t* __nonnull handler, void* __nullable context,
+                              fs_net_pool_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSNetPool.create(loop:config:handler:_:_:));
+
+/** Closes every connection, calling `closed` with `FS_ERROR_CANCELLED`, and frees the pool. */
+void fs_net_pool_destroy(fs_net_pool_t* __nullable pool)
+    __fs_SWIFT_NAME__(FSNetPool.destroy(self:));
+
+/**
+ * Takes one unit of capacity on a connection to `host`, opening one if
+ * every connection is full. A new connection is still connecting; `opened`
+ * tells when it is not. Give the capacity back with fs_net_pool_release().
+ *
+ * @param out Receives the connection, or NULL when the host already has
+ *            `max_per_host` connections and all are full.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         `FS_ERROR_NOT_FOUND` when the name does not resolve, or `FS_ERROR_IO`.
+ */
+fs_error_t fs_net_pool_acquire(fs_net_pool_t* __nonnull pool, const char* __nonnull host, uint16_t port,
+                               uint64_t now_ms, fs_net_conn_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSNetPool.acquire(self:host:port:now:_:));
+
+/** Gives back what fs_net_pool_acquire() took; a connection left unused starts idling. */
+void fs_net_pool_release(fs_net_pool_t* __nonnull pool, fs_net_conn_t* __nonnull conn, uint64_t now_ms)
+    __fs_SWIFT_NAME__(FSNetPool.release(self:_:now:));
+
+/**
+ * Closes connections that idled or took too long to connect.
+ *
+ * @param deadline_ms Receives when to call again, or `UINT64_MAX`.
+ */
+void fs_net_pool_expire(fs_net_pool_t* __nonnull pool, uint64_t now_ms, uint64_t* __nonnull deadline_ms)
+    __fs_SWIFT_NAME__(FSNetPool.expire(self:now:_:));
+
+/** Sets how many users the connection takes at once; 0 retires it once its users are done. */
+void fs_net_conn_set_capacity(fs_net_conn_t* __nonnull conn, size_t capacity)
+    __fs_SWIFT_NAME__(setter:FSNetConnection.capacity(self:_:));
+
+/** The protocol state kept with the connection, NULL at first. */
+void* __nullable fs_net_conn_context(const fs_net_conn_t* __nonnull conn)
+    __fs_SWIFT_NAME__(getter:FSNetConnection.context(self:));
+
+void fs_net_conn_set_context(fs_net_conn_t* __nonnull conn, void* __nullable context)
+    __fs_SWIFT_NAME__(setter:FSNetConnection.context(self:_:));
+
+/**
+ * Writes `count` slices in order, queueing what the socket does not take.
+ * Bytes written before the connection is established are sent once it is.
+ * Takes the connection as `void*` so it can be the context of an
+ * fs_ws_writev_t.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         `FS_ERROR_CANCELLED` once the connection is closed, or `FS_ERROR_IO`.
+ */
+fs_error_t fs_net_conn_writev(void* __nullable conn, const struct iovec* __nonnull iov, int count)
+    __fs_SWIFT_NAME__(FSNetConnection.writev(_:_:_:));
+
+/** Closes a connection now, without calling `closed`, and drops what is still queued. */
+void fs_net_conn_close(fs_net_conn_t* __nonnull conn)
+    __fs_SWIFT_NAME__(FSNetConnection.close(self:));
+
+/*
+ WebSocket framing (RFC 6455), with permessage-deflate (RFC 7692).
+
+ fs_ws_t speaks the protocol on a connection whose opening handshake is
+ done. Frames are parsed straight out of a receive ring: payloads are
+ unmasked in place, 16 bytes at a time with SSE2 or NEON, and a message that
+ came in one uncompressed frame is passed to the handler where it lies.
+ Fragmented messages, and frames larger than what is in the ring, are
+ gathered into a buffer kept by the connection; compressed ones are inflated
+ into it. Once that buffer has grown to the largest message, receiving
+ allocates nothing.
+
+ Sending puts the frame header and the caller's payload slices into one
+ vectored write, so a server, which does not mask, never copies a payload.
+ A client masks into a scratch buffer, and compression deflates into it.
+ Pings are answered with pongs; pongs and close frames go to the handler.
+
+ With permessage-deflate, data messages of at least `FS_WS_DEFLATE_MIN`
+ bytes are compressed. With context takeover the compressor keeps its
+ window from one message to the next, so the repeated structure of small
+ edits and presence updates compresses away; `no_context_takeover` resets
+ it after every message, as negotiated for this side, and a message that
+ would not shrink then goes out uncompressed.
+
+ A connection is used by one thread at a time.
+ */
+
+/* Default for fs_ws_config_t.max_message */
+#define FS_WS_MAX_MESSAGE ((size_t)16 << 20)
+
+/* Smallest data message that is compressed */
+#define FS_WS_DEFLATE_MIN 16
+
+/* Most payload slices fs_ws_send() takes */
+#define FS_WS_MAX_SLICES 32
+
+typedef enum {
+    FS_WS_TEXT = 1,
+    FS_WS_BINARY = 2,
+    FS_WS_CLOSE = 8,
+    FS_WS_PING = 9,
+    FS_WS_PONG = 10,
+} __fs_SWIFT_NAME__(FSWebSocketOpcode) fs_ws_opcode_t;
+
+typedef enum {
+    FS_WS_CLIENT = 0,
+    FS_WS_SERVER = 1,
+} __fs_SWIFT_NAME__(FSWebSocketRole) fs_ws_role_t;
+
+/* Close status codes fs_ws_receive() asks for when it fails */
+#define FS_WS_CLOSE_NORMAL 1000
+#define FS_WS_CLOSE_PROTOCOL 1002
+#define FS_WS_CLOSE_INVALID_DATA 1007
+#define FS_WS_CLOSE_TOO_BIG 1009
+
+/**
+ * Writes `count` slices, in order and completely; the connection queues
+ * whatever the socket does not take at once. Slices are only valid during the call.
+ */
+typedef fs_error_t (*fs_ws_writev_t)(void* __nullable context, const struct iovec* __nonnull iov, int count);
+
+/** Receives a message; `data` is only valid during the call. Text has been checked to be UTF-8. */
+typedef void (*fs_ws_message_handler_t)(void* __nullable context, fs_ws_opcode_t opcode,
+                                        const uint8_t* __nullable data, size_t length);
+
+typedef struct {
+    fs_ws_role_t role;
+    /** permessage-deflate was negotiated */
+    bool deflate;
+    /** Reset the compressor after each message (client_ or server_no_context_takeover for this side) */
+    bool no_context_takeover;
+    /** Largest message accepted, 0 for `FS_WS_MAX_MESSAGE` */
+    size_t max_message;
+    fs_ws_writev_t __nonnull writev;
+    void* __nullable context;
+} __fs_SWIFT_NAME__(FSWebSocketConfig) fs_ws_config_t;
+
+typedef struct fs_ws fs_ws_t;
+
+/**
+ * Creates a connection.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_ws_create(const fs_ws_config_t* __nonnull config, fs_ws_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSWebSocket.create(config:_:));
+
+void fs_ws_destroy(fs_ws_t* __nullable ws)
+    __fs_SWIFT_NAME__(FSWebSocket.destroy(self:));
+
+/**
+ * Handles every complete frame in `ring` and consumes it; an incomplete
+ * frame at the end stays for the next call, after more bytes were read.
+ *
+ * @param handler Called with each message, in order.
+ * @return `FS_ERROR_NONE`; `FS_ERROR_INVALID_ARGUMENT` when the peer broke the
+ *         protocol, `FS_ERROR_NOT_SUPPORTED` for a message over `max_message`,
+ *         or the error of answering a ping. After an error the connection
+ *         must be closed with fs_ws_close_code().
+ */
+fs_error_t fs_ws_receive(fs_ws_t* __nonnull ws, fs_net_ring_t* __nonnull ring,
+                         fs_ws_message_handler_t __nonnull handler, void* __nullable context)
+    __fs_SWIFT_NAME__(FSWebSocket.receive(self:_:_:_:));
+
+/** The status to close with after fs_ws_receive() failed, `FS_WS_CLOSE_NORMAL` otherwise. */
+uint16_t fs_ws_close_code(const fs_ws_t* __nonnull ws)
+    __fs_SWIFT_NAME__(getter:FSWebSocket.closeCode(self:));
+
+/**
+ * Sends a message made of `count` slices as one frame.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` (control payloads are
+ *         at most 125 bytes), `FS_ERROR_CANCELLED` once a close was sent,
+ *         `FS_ERROR_OUT_OF_MEMORY`, or the error of the write.
+ */
+fs_error_t fs_ws_send(fs_ws_t* __nonnull ws, fs_ws_opcode_t opcode, const struct iovec* __nullable slices, int count)
+    __fs_SWIFT_NAME__(FSWebSocket.send(self:_:_:_:));
+
+/**
+ * Sends a close frame; no message can be sent after it.
+ *
+ * @param reason UTF-8, at most 123 bytes, or NULL.
+ */
+fs_error_t fs_ws_close(fs_ws_t* __nonnull ws, uint16_t code, const char* __nullable reason)
+    __fs_SWIFT_NAME__(FSWebSocket.close(self:code:reason:));
+
+/*
+ HTTP/2 client (RFC 9113).
+
+ fs_http_client_t sends requests over a connection pool, many at once on
+ each connection: every request is a stream, and a host gets another
+ connection only when the streams its server allows are all in use. Cloud
+ sync and self-hosted backends issue many small requests to a few hosts,
+ so after the first request to a host, a request costs one write and no
+ handshake. Header blocks are compressed with HPACK (RFC 7541) using the
+ dynamic table, so headers repeated on every request, such as the
+ authority, an authorization token or a content type, take a byte or two
+ after the first time.
+
+ Requests are written by the next fs_http_client_poll(), so requests made
+ together leave in one write. Request bodies are copied; response bodies
+ are gathered and passed whole to the completion. Requests the server
+ refused or did not process, and idempotent ones on a connection that was
+ lost before any response, are retried once on another connection.
+
+ The client speaks HTTP/2 over TCP with prior knowledge (the `http`
+ scheme), for servers or proxies that accept it. It is used on the thread
+ that runs its loop; completions are called there and must not destroy
+ the client.
+ */
+
+/* Defaults for fs_http_config_t */
+#define FS_HTTP_MAX_RESPONSE ((size_t)64 << 20)
+#define FS_HTTP_TIMEOUT_MS 30000
+
+typedef struct {
+    const char* __nonnull name;
+    const char* __nonnull value;
+} __fs_SWIFT_NAME__(FSHTTPHeader) fs_http_header_t;
+
+typedef struct {
+    /** e.g. "GET" or "POST" */
+    const char* __nonnull method;
+    const char* __nonnull host;
+    uint16_t port;
+    /** Path and query, starting with '/' */
+    const char* __nonnull path;
+    /** Names are sent in lowercase; connection-specific headers are dropped */
+    const fs_http_header_t* __nullable headers;
+    size_t header_count;
+    const void* __nullable body;
+    size_t body_length;
+    /** 0 for the client's timeout */
+    uint32_t timeout_ms;
+} __fs_SWIFT_NAME__(FSHTTPRequest) fs_http_request_t;
+
+typedef struct {
+    int status;
+    /** Response headers and trailers, with lowercase names */
+    const fs_http_header_t* __nullable headers;
+    size_t header_count;
+    const uint8_t* __nullable body;
+    size_t body_length;
+} __fs_SWIFT_NAME__(FSHTTPResponse) fs_http_response_t;
+
+/**
+ * Called once per request. On `FS_ERROR_NONE` the response, which is only
+ * valid during the call, is complete; otherwise it is NULL and the error is
+ * `FS_ERROR_TIMEOUT`, `FS_ERROR_IO` for a lost connection or broken
+ * protocol, `FS_ERROR_NOT_SUPPORTED` for a response over `max_response`,
+ * `FS_ERROR_CANCELLED` when the server reset the stream or the client was
+ * destroyed, or an error of fs_net_pool_acquire().
+ */
+typedef void (*fs_http_completion_t)(void* __nullable context, fs_error_t error,
+                                     const fs_http_response_t* __nullable response);
+
+typedef struct {
+    fs_net_pool_config_t pool;
+    /** Largest response body, 0 for `FS_HTTP_MAX_RESPONSE` */
+    size_t max_response;
+    /** Time from sending to the complete response, 0 for `FS_HTTP_TIMEOUT_MS` */
+    uint32_t timeout_ms;
+} __fs_SWIFT_NAME__(FSHTTPConfig) fs_http_config_t;
+
+typedef struct fs_http_client fs_http_client_t;
+
+/**
+ * Creates a client.
+ *
+ * @param config NULL for the defaults; rings smaller than 32 KiB are enlarged.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_http_client_create(fs_net_loop_t* __nonnull loop, const fs_http_config_t* __nullable config,
+                                 fs_http_client_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSHTTPClient.create(loop:config:_:));
+
+/** Completes every request with `FS_ERROR_CANCELLED`, closes the connections and frees the client. */
+void fs_http_client_destroy(fs_http_client_t* __nullable client)
+    __fs_SWIFT_NAME__(FSHTTPClient.destroy(self:));
+
+/**
+ * Starts a request; everything in `request` is copied.
+ *
+ * @return `FS_ERROR_NONE`, after which `completion` is called exactly once,
+ *         `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         `FS_ERROR_CANCELLED` while the client is being destroyed, or an
+ *         error of fs_net_pool_acquire().
+ */
+fs_error_t fs_http_client_send(fs_http_client_t* __nonnull client, const fs_http_request_t* __nonnull request,
+                               uint64_t now_ms, fs_http_completion_t __nonnull completion, void* __nullable context)
+    __fs_SWIFT_NAME__(FSHTTPClient.send(self:_:now:_:_:));
+
+/**
+ * Writes what requests and the protocol queued, times requests out and
+ * closes idle connections. Call it before every fs_net_loop_run().
+ *
+ * @param deadline_ms Receives when to call again, or `UINT64_MAX`.
+ */
+void fs_http_client_poll(fs_http_client_t* __nonnull client, uint64_t now_ms, uint64_t* __nonnull deadline_ms)
+    __fs_SWIFT_NAME__(FSHTTPClient.poll(self:now:_:));
+
+#endif
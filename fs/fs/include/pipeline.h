@@ -0,0 +1,134 @@
+//
+//  pipeline.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_PIPELINE_H
+#define FS_PIPELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fs/interop.h>
+
+/*
+ A multi-stage producer/consumer pipeline with backpressure.
+
+ Every stage runs on its own worker threads and takes items from a bounded
+ queue in front of it. An item carries one buffer from a pool that is
+ allocated when the pipeline is created and reused for every later item, so
+ a steady stream allocates nothing. When a stage falls behind its queue
+ fills, the stage before it blocks, and finally fs_pipeline_submit() blocks:
+ throughput is that of the slowest stage, and memory stays at
+ `(stages * queue_depth + workers) * buffer_size`.
+
+ Items are independent and may leave the pipeline in a different order than
+ they entered it. After a stage fails, the remaining stages are skipped for
+ every item still in flight and submit reports the error.
+ */
+
+/* Default for fs_pipeline_config_t.queue_depth */
+#define FS_PIPELINE_QUEUE_DEPTH 4
+
+typedef struct fs_pipeline fs_pipeline_t;
+
+typedef struct {
+    /** Input and caller values passed to fs_pipeline_submit() */
+    const void* __nullable input;
+    size_t input_len;
+    uint64_t tag;
+    void* __nullable user;
+    /** The item's pooled buffer, `buffer_size` bytes; stages work in it */
+    unsigned char* __nonnull buffer;
+    size_t buffer_size;
+    /** Bytes of `buffer` in use; 0 when the item enters the first stage */
+    size_t len;
+} __fs_SWIFT_NAME__(FSPipelineItem) fs_pipeline_item_t;
+
+/** Processes one item; any error stops the remaining stages for it and later items. */
+typedef fs_error_t (*fs_pipeline_stage_fn)(void* __nullable context, fs_pipeline_item_t* __nonnull item);
+
+typedef struct {
+    fs_pipeline_stage_fn __nonnull run;
+    void* __nullable context;
+    /** Threads running this stage, 0 for 1 */
+    unsigned workers;
+} __fs_SWIFT_NAME__(FSPipelineStage) fs_pipeline_stage_t;
+
+typedef struct {
+    /** Items waiting in front of each stage, 0 for `FS_PIPELINE_QUEUE_DEPTH` */
+    size_t queue_depth;
+    /** Size of each pooled buffer, non-zero */
+    size_t buffer_size;
+} __fs_SWIFT_NAME__(FSPipelineConfig) fs_pipeline_config_t;
+
+/**
+ * Creates a pipeline and starts its workers.
+ *
+ * @param stages The stages, in order; copied.
+ * @param count Number of stages, at least 1.
+ * @param config Queue depth and buffer size.
+ * @param out Receives the pipeline.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`
+ *         or `FS_ERROR_UNKNOWN` if a thread could not be started.
+ */
+fs_error_t fs_pipeline_create(const fs_pipeline_stage_t* __nonnull stages, size_t count,
+                              const fs_pipeline_config_t* __nonnull config, fs_pipeline_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(fsPipelineCreate(_:_:_:_:));
+
+/**
+ * Stops the workers and frees the pipeline; waits for items in flight first.
+ */
+void fs_pipeline_destroy(fs_pipeline_t* __nullable pipeline)
+    __fs_SWIFT_NAME__(fsPipelineDestroy(_:));
+
+/**
+ * Feeds one item to the first stage, blocking while the pipeline is full.
+ *
+ * `input` is not copied and must stay valid until fs_pipeline_finish() returns.
+ * Only one thread may submit at a time.
+ *
+ * @return `FS_ERROR_NONE`, or the first error returned by a stage, in which
+ *         case the item was not submitted.
+ */
+fs_error_t fs_pipeline_submit(fs_pipeline_t* __nonnull pipeline, const void* __nullable input, size_t len,
+                              uint64_t tag, void* __nullable user)
+    __fs_SWIFT_NAME__(fsPipelineSubmit(_:_:_:_:_:));
+
+/**
+ * Waits until every submitted item has left the pipeline.
+ *
+ * The pipeline can be used again afterwards, with the error cleared.
+ *
+ * @return `FS_ERROR_NONE`, or the first error returned by a stage since the
+ *         previous call.
+ */
+fs_error_t fs_pipeline_finish(fs_pipeline_t* __nonnull pipeline)
+    __fs_SWIFT_NAME__(fsPipelineFinish(_:));
+
+#endif
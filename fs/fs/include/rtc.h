@@ -29,4 +29,1021 @@
 //  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-// Collaboration
\ No newline at end of file
+// Collaboration
+
+#ifndef FS_RTC_H
+#define FS_RTC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/interop.h>
+#include <fs/chunk.h>
+
+/*
+ Document buffer.
+
+ A rope is a B-tree over the bytes of a document: leaves hold up to
+ `FS_ROPE_LEAF_MAX` bytes, branches up to `FS_ROPE_FANOUT` children and the
+ byte and newline counts of each child. Offset and line lookups, inserts and
+ deletes descend one path and cost O(log n) plus at most one leaf of copying,
+ whatever the size of the document.
+
+ Nodes are immutable once shared and reference counted, so a snapshot is
+ O(1) and later edits copy only the path they change. Diff and merge, undo
+ history and the transport all hold snapshots instead of copies of the text.
+ A rope may be edited while its snapshots are read on other threads; a single
+ rope must not be used from two threads at once.
+
+ Offsets are in bytes; lines are separated by '\n'.
+ */
+#define FS_ROPE_LEAF_MAX 1024
+#define FS_ROPE_FANOUT 16
+#define FS_ROPE_MAX_DEPTH 32
+
+typedef struct fs_rope fs_rope_t;
+typedef struct fs_rope_node fs_rope_node_t;
+
+/** Walks the bytes of a rope one leaf at a time; see fs_rope_iter_init(). */
+typedef struct {
+    const fs_rope_node_t* __nullable path[FS_ROPE_MAX_DEPTH];
+    uint8_t index[FS_ROPE_MAX_DEPTH];
+    size_t depth;
+    size_t skip;        // bytes to skip in the first leaf
+    size_t remaining;   // bytes left to return
+} __fs_SWIFT_NAME__(FSRopeIterator) fs_rope_iter_t;
+
+/**
+ * Creates a rope holding a copy of `bytes`.
+ *
+ * @param bytes The initial contents; may be `NULL` if `len` is 0.
+ * @param len Length of `bytes`.
+ * @param out Receives the rope.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_rope_create(const void* __nullable bytes, size_t len, fs_rope_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSRope.create(_:_:_:));
+
+/** Frees a rope; nodes shared with snapshots stay alive until their last rope is gone. */
+void fs_rope_destroy(fs_rope_t* __nullable rope)
+    __fs_SWIFT_NAME__(FSRope.destroy(self:));
+
+/**
+ * Creates an independent rope with the current contents of `rope` in O(1).
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_rope_snapshot(const fs_rope_t* __nonnull rope, fs_rope_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSRope.snapshot(self:_:));
+
+/** Returns the length in bytes. */
+size_t fs_rope_length(const fs_rope_t* __nonnull rope)
+    __fs_SWIFT_NAME__(getter:FSRope.length(self:));
+
+/** Returns the number of lines: one more than the number of '\n' bytes. */
+size_t fs_rope_line_count(const fs_rope_t* __nonnull rope)
+    __fs_SWIFT_NAME__(getter:FSRope.lineCount(self:));
+
+/** Returns `true` if both ropes are snapshots of the same, unedited contents (O(1)). */
+bool fs_rope_shares_contents(const fs_rope_t* __nonnull a, const fs_rope_t* __nonnull b)
+    __fs_SWIFT_NAME__(FSRope.sharesContents(self:_:));
+
+/**
+ * Inserts bytes.
+ *
+ * @param rope The rope.
+ * @param offset Where to insert, at most the length.
+ * @param bytes The bytes to insert; may be `NULL` if `len` is 0.
+ * @param len Length of `bytes`.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or
+ *         `FS_ERROR_OUT_OF_MEMORY`, in which case the rope is unchanged.
+ */
+fs_error_t fs_rope_insert(fs_rope_t* __nonnull rope, size_t offset, const void* __nullable bytes, size_t len)
+    __fs_SWIFT_NAME__(FSRope.insert(self:at:_:_:));
+
+/**
+ * Deletes `len` bytes at `offset`.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` (the range is out of
+ *         bounds) or `FS_ERROR_OUT_OF_MEMORY`, in which case the rope is unchanged.
+ */
+fs_error_t fs_rope_delete(fs_rope_t* __nonnull rope, size_t offset, size_t len)
+    __fs_SWIFT_NAME__(FSRope.delete(self:at:_:));
+
+/**
+ * Copies bytes out of the rope.
+ *
+ * @return The number of bytes copied: `len`, or fewer at the end of the rope.
+ */
+size_t fs_rope_copy(const fs_rope_t* __nonnull rope, size_t offset, void* __nonnull dst, size_t len)
+    __fs_SWIFT_NAME__(FSRope.copy(self:at:_:_:));
+
+/**
+ * Returns the byte at `offset`, which must be less than the length.
+ */
+unsigned char fs_rope_byte_at(const fs_rope_t* __nonnull rope, size_t offset)
+    __fs_SWIFT_NAME__(FSRope.byte(self:at:));
+
+/**
+ * Finds the start of a line.
+ *
+ * @param line Zero-based line number, less than fs_rope_line_count().
+ * @param offset Receives the offset of the line's first byte.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` if there is no such line.
+ */
+fs_error_t fs_rope_line_start(const fs_rope_t* __nonnull rope, size_t line, size_t* __nonnull offset)
+    __fs_SWIFT_NAME__(FSRope.lineStart(self:_:_:));
+
+/**
+ * Returns the zero-based line containing `offset` (offsets past the end give the last line).
+ */
+size_t fs_rope_line_at(const fs_rope_t* __nonnull rope, size_t offset)
+    __fs_SWIFT_NAME__(FSRope.line(self:at:));
+
+/**
+ * Starts iterating `len` bytes at `offset`; the range is clamped to the rope.
+ */
+void fs_rope_iter_init(fs_rope_iter_t* __nonnull iter, const fs_rope_t* __nonnull rope, size_t offset, size_t len)
+    __fs_SWIFT_NAME__(FSRopeIterator.init(_:_:_:_:));
+
+/**
+ * Returns the next run of bytes, pointing into the rope. The rope must not be
+ * edited while iterating; iterate a snapshot to edit at the same time.
+ *
+ * @return `false` once the range is exhausted.
+ */
+bool fs_rope_iter_next(fs_rope_iter_t* __nonnull iter, const unsigned char* __nullable* __nonnull bytes,
+                       size_t* __nonnull len)
+    __fs_SWIFT_NAME__(FSRopeIterator.next(self:_:_:));
+
+/*
+ Diff and merge.
+
+ Diffs compare lines (each including its '\n'). The common prefix and suffix
+ are found by comparing bytes, skipping leaves both ropes share; only the
+ lines in between are hashed and interned, and compared with Myers'
+ linear-space algorithm. A region whose edit cost exceeds the cap
+ is split at the lines that occur exactly once on both sides (patience diff)
+ and those pieces are diffed again; a region without such lines is reported
+ as replaced. The cap bounds the time on very different inputs at the price
+ of a longer, but still correct, edit script.
+ */
+
+/* Smallest automatic cost cap; larger inputs get about the square root of their line count */
+#define FS_DIFF_MIN_COST 256
+
+/** Diff tuning. */
+typedef struct {
+    /** Edit cost Myers may explore per region before falling back, 0 to pick one from the input size */
+    size_t max_cost;
+} __fs_SWIFT_NAME__(FSDiffConfig) fs_diff_config_t;
+
+/** Lines [a_start, a_start + a_count) of the old text became [b_start, b_start + b_count) of the new one. */
+typedef struct {
+    size_t a_start;
+    size_t a_count;
+    size_t b_start;
+    size_t b_count;
+} __fs_SWIFT_NAME__(FSDiffHunk) fs_diff_hunk_t;
+
+/** How fs_merge3() resolves regions both sides changed differently. */
+typedef enum {
+    FS_MERGE_KEEP_BOTH = 0,     // our lines, then theirs
+    FS_MERGE_PREFER_OURS = 1,
+    FS_MERGE_PREFER_THEIRS = 2,
+} __fs_SWIFT_NAME__(FSMergePolicy) fs_merge_policy_t;
+
+/**
+ * Computes the line hunks that turn `a` into `b`, in order.
+ *
+ * @param a The old text.
+ * @param b The new text.
+ * @param config Tuning, or `NULL` for the defaults.
+ * @param hunks Receives a `malloc`ed array, or `NULL` if the texts are equal.
+ * @param count Receives the number of hunks.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_NOT_SUPPORTED`
+ *         (more than 2^31 lines) or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_diff_lines(const fs_rope_t* __nonnull a, const fs_rope_t* __nonnull b,
+                         const fs_diff_config_t* __nullable config,
+                         fs_diff_hunk_t* __nullable* __nonnull hunks, size_t* __nonnull count)
+    __fs_SWIFT_NAME__(fsDiffLines(_:_:_:_:_:));
+
+/**
+ * Merges two descendants of a common base.
+ *
+ * Changes made on only one side are all kept. Where both sides changed the
+ * same lines identically the change is kept once; otherwise the region is a
+ * conflict resolved by `policy`. The result shares every unchanged leaf with
+ * `ours`; the work outside the two diffs depends on the size of the changes,
+ * not of the document.
+ *
+ * @param base The common ancestor.
+ * @param ours Our version.
+ * @param theirs Their version.
+ * @param config Diff tuning, or `NULL` for the defaults.
+ * @param policy How conflicts are resolved.
+ * @param out Receives the merged text.
+ * @param conflicts Receives the number of conflicting regions; may be `NULL`.
+ * @return `FS_ERROR_NONE` or an error from fs_diff_lines().
+ */
+fs_error_t fs_merge3(const fs_rope_t* __nonnull base, const fs_rope_t* __nonnull ours,
+                     const fs_rope_t* __nonnull theirs, const fs_diff_config_t* __nullable config,
+                     fs_merge_policy_t policy, fs_rope_t* __nullable* __nonnull out, size_t* __nullable conflicts)
+    __fs_SWIFT_NAME__(fsMerge3(_:_:_:_:_:_:_:));
+
+/*
+ Replicated sequence.
+
+ fs_crdt_t orders the characters of a shared document so that replicas that
+ have applied the same operations agree on the text, whatever order
+ concurrent operations arrived in (RGA: each insert names the character to
+ its left, concurrent inserts after the same character are ordered by
+ descending Lamport clock, then client). It holds positions and identities
+ only; the bytes live in the replica's fs_rope_t, which the caller edits at
+ the positions the CRDT reports.
+
+ Characters inserted together, or typed one after another by one client, are
+ one run: a single 28-byte item in a counted B-tree, plus a 16-byte entry in
+ a per-client index sorted by clock. Position lookups, id lookups and the
+ integration of a remote operation are O(log n). Deleted runs stay as
+ tombstones until fs_crdt_collect() is told they are causally stable.
+
+ Operations from one client must be applied in the order it made them, and
+ after the operations they refer to; fs_crdt_apply() reports
+ `FS_ERROR_NOT_FOUND` for one that arrives too early. Re-applying an
+ operation has no effect.
+ */
+
+/** Identifies a character: the client that inserted it and its Lamport clock there. Clocks start at 1. */
+typedef struct {
+    uint32_t client;
+    uint32_t clock;
+} __fs_SWIFT_NAME__(FSCRDTID) fs_crdt_id_t;
+
+/** The id of the document start, used as the origin of inserts at position 0. */
+#define FS_CRDT_ROOT ((fs_crdt_id_t){ 0, 0 })
+
+typedef enum {
+    FS_CRDT_INSERT = 0,
+    FS_CRDT_DELETE = 1,
+} __fs_SWIFT_NAME__(FSCRDTOperationKind) fs_crdt_op_kind_t;
+
+/**
+ * A replicated edit.
+ *
+ * An insert adds `length` characters with clocks `id.clock` onwards after
+ * `origin`. A delete has its own `id` and removes the `length` characters of
+ * client `origin.client` from clock `origin.clock` on.
+ */
+typedef struct {
+    fs_crdt_op_kind_t kind;
+    fs_crdt_id_t id;
+    fs_crdt_id_t origin;
+    uint32_t length;
+} __fs_SWIFT_NAME__(FSCRDTOperation) fs_crdt_op_t;
+
+typedef struct fs_crdt fs_crdt_t;
+
+/** Receives operations generated by a local edit. */
+typedef void (*fs_crdt_op_handler_t)(void* __nullable context, const fs_crdt_op_t* __nonnull op);
+
+/** Receives a range of visible positions an operation inserted or removed. */
+typedef void (*fs_crdt_range_handler_t)(void* __nullable context, size_t position, size_t length);
+
+/**
+ * Creates an empty replica.
+ *
+ * @param client This replica's client id, unique among the participants and not 0.
+ * @param out Receives the replica.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_crdt_create(uint32_t client, fs_crdt_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSCRDT.create(client:_:));
+
+void fs_crdt_destroy(fs_crdt_t* __nullable crdt)
+    __fs_SWIFT_NAME__(FSCRDT.destroy(self:));
+
+/** Returns the number of visible characters. */
+size_t fs_crdt_length(const fs_crdt_t* __nonnull crdt)
+    __fs_SWIFT_NAME__(getter:FSCRDT.length(self:));
+
+/** Returns the number of runs, tombstones included. */
+size_t fs_crdt_run_count(const fs_crdt_t* __nonnull crdt)
+    __fs_SWIFT_NAME__(getter:FSCRDT.runCount(self:));
+
+/** Returns the highest clock applied from `client`, 0 if none. */
+uint32_t fs_crdt_version(const fs_crdt_t* __nonnull crdt, uint32_t client)
+    __fs_SWIFT_NAME__(FSCRDT.version(self:client:));
+
+/**
+ * Records a local insert of `length` characters at `position`.
+ *
+ * @param op Receives the operation to send to the other replicas.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` (position past the end),
+ *         `FS_ERROR_NOT_SUPPORTED` (clocks exhausted) or `FS_ERROR_OUT_OF_MEMORY`;
+ *         after an error nothing changed.
+ */
+fs_error_t fs_crdt_insert(fs_crdt_t* __nonnull crdt, size_t position, uint32_t length, fs_crdt_op_t* __nonnull op)
+    __fs_SWIFT_NAME__(FSCRDT.insert(self:at:_:_:));
+
+/**
+ * Records a local delete of `length` characters at `position`.
+ *
+ * @param handler Called with each operation to send; one per run of
+ *                consecutive clocks of one client in the range.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_NOT_SUPPORTED`
+ *         (clocks exhausted) or `FS_ERROR_OUT_OF_MEMORY`; after an error nothing changed.
+ */
+fs_error_t fs_crdt_delete(fs_crdt_t* __nonnull crdt, size_t position, size_t length,
+                          fs_crdt_op_handler_t __nonnull handler, void* __nullable context)
+    __fs_SWIFT_NAME__(FSCRDT.delete(self:at:_:_:_:));
+
+/**
+ * Integrates an operation from another replica.
+ *
+ * @param handler Called, in order, with the visible ranges the operation
+ *                inserted or removed, to be applied to the rope as they come.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_NOT_FOUND`
+ *         (it refers to characters not applied yet) or `FS_ERROR_OUT_OF_MEMORY`;
+ *         after an error nothing changed.
+ */
+fs_error_t fs_crdt_apply(fs_crdt_t* __nonnull crdt, const fs_crdt_op_t* __nonnull op,
+                         fs_crdt_range_handler_t __nullable handler, void* __nullable context)
+    __fs_SWIFT_NAME__(FSCRDT.apply(self:_:_:_:));
+
+/**
+ * Drops tombstones nobody can refer to any more and merges adjacent runs.
+ *
+ * @param stable Causally stable clocks, one entry per client: every replica
+ *               has applied these operations, and every operation still to
+ *               come follows them. Clients not listed count as 0.
+ * @param count Number of entries in `stable`.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_OUT_OF_MEMORY`, in which case nothing changed.
+ */
+fs_error_t fs_crdt_collect(fs_crdt_t* __nonnull crdt, const fs_crdt_id_t* __nullable stable, size_t count)
+    __fs_SWIFT_NAME__(FSCRDT.collect(self:stable:_:));
+
+/**
+ * Encodes the replica, tombstones and the version of every client included,
+ * for fs_crdt_decode().
+ *
+ * @param bytes Receives the malloc'd encoding; free() it.
+ * @param length Receives its length.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_crdt_encode(const fs_crdt_t* __nonnull crdt, uint8_t* __nullable* __nonnull bytes,
+                          size_t* __nonnull length)
+    __fs_SWIFT_NAME__(FSCRDT.encode(self:_:_:));
+
+/**
+ * Recreates a replica from fs_crdt_encode() output in O(n), packing the runs
+ * as fs_crdt_collect() does.
+ *
+ * @param client This replica's client id, as for fs_crdt_create().
+ * @param out Receives the replica.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` for a malformed
+ *         encoding or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_crdt_decode(uint32_t client, const uint8_t* __nullable bytes, size_t length,
+                          fs_crdt_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSCRDT.decode(client:_:_:_:));
+
+
+/*
+ Operation transport.
+
+ fs_transport_t carries the operations of one link, a client and its server
+ or two peers, in both directions. Local operations wait up to `window_ms`
+ in a queue where typing, backspacing and forward deletes fold into single
+ operations, then leave together in one message: a varint sequence number,
+ a cumulative acknowledgement of the other side's messages, and the
+ operations, each a flag byte and varints that give the client and clocks
+ relative to the previous operation, followed by the inserted text. A burst
+ of typing costs its text plus about eight bytes.
+
+ Up to `max_in_flight` messages may be unacknowledged; later operations
+ wait, and keep folding, until an acknowledgement arrives. Acknowledgements
+ ride on outgoing messages; one is sent alone when nothing left for four
+ windows, or for one window once two messages are owed. After a reconnect, fs_transport_resend() sends every
+ unacknowledged message again; the receiving side drops the ones it had,
+ and fs_crdt_apply() ignores repeats anyway.
+
+ The transport does no I/O and reads no clock. Messages leave through the
+ send callback, arriving ones are handed to fs_transport_receive(), and
+ calls take the time of a monotonic clock in milliseconds.
+ */
+
+/* Defaults for fs_transport_config_t */
+#define FS_TRANSPORT_WINDOW_MS 25
+#define FS_TRANSPORT_MAX_MESSAGE 16384
+#define FS_TRANSPORT_MAX_IN_FLIGHT 4
+
+typedef struct {
+    /** How long a queued operation may wait for others, 0 for `FS_TRANSPORT_WINDOW_MS` */
+    uint32_t window_ms;
+    /** Largest encoded message, 0 for `FS_TRANSPORT_MAX_MESSAGE`, at least 64 */
+    size_t max_message;
+    /** Messages sent but not acknowledged, 0 for `FS_TRANSPORT_MAX_IN_FLIGHT` */
+    uint32_t max_in_flight;
+} __fs_SWIFT_NAME__(FSTransportConfig) fs_transport_config_t;
+
+typedef struct fs_transport fs_transport_t;
+
+/** Sends one encoded message; `bytes` is only valid during the call. */
+typedef void (*fs_transport_send_t)(void* __nullable context, const uint8_t* __nonnull bytes, size_t length);
+
+/** Receives a remote operation; `text` holds the `op->length` bytes of an insert and is NULL for a delete. */
+typedef void (*fs_transport_op_handler_t)(void* __nullable context, const fs_crdt_op_t* __nonnull op,
+                                          const uint8_t* __nullable text);
+
+/**
+ * Creates a transport; all message buffers are allocated here.
+ *
+ * @param config Limits, or NULL for the defaults.
+ * @param send Called with each message to put on the link.
+ * @param out Receives the transport.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_transport_create(const fs_transport_config_t* __nullable config, fs_transport_send_t __nonnull send,
+                               void* __nullable context, fs_transport_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSTransport.create(config:send:_:_:));
+
+void fs_transport_destroy(fs_transport_t* __nullable transport)
+    __fs_SWIFT_NAME__(FSTransport.destroy(self:));
+
+/**
+ * Queues a local operation, folding it into the previous one when it continues it.
+ *
+ * Operations of one client must be queued in the order fs_crdt_insert() and
+ * fs_crdt_delete() produced them.
+ *
+ * @param text The `op->length` inserted bytes, copied; NULL for a delete.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`,
+ *         in which case nothing was queued.
+ */
+fs_error_t fs_transport_queue(fs_transport_t* __nonnull transport, const fs_crdt_op_t* __nonnull op,
+                              const uint8_t* __nullable text, uint64_t now_ms)
+    __fs_SWIFT_NAME__(FSTransport.queue(self:_:text:now:));
+
+/**
+ * Sends what is due: queued operations whose window ran out, while fewer
+ * than `max_in_flight` messages are unacknowledged, and a pending acknowledgement.
+ *
+ * @param deadline_ms Receives the time by which to poll again, `UINT64_MAX`
+ *                    if nothing is waiting on the clock.
+ */
+void fs_transport_poll(fs_transport_t* __nonnull transport, uint64_t now_ms, uint64_t* __nullable deadline_ms)
+    __fs_SWIFT_NAME__(FSTransport.poll(self:now:_:));
+
+/** Like fs_transport_poll(), without waiting for the window; used before suspending. */
+void fs_transport_flush(fs_transport_t* __nonnull transport, uint64_t now_ms)
+    __fs_SWIFT_NAME__(FSTransport.flush(self:now:));
+
+/**
+ * Handles a message from the other side.
+ *
+ * @param handler Called with each operation of a message not seen before, in order.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` for a malformed
+ *         message, of which nothing was delivered.
+ */
+fs_error_t fs_transport_receive(fs_transport_t* __nonnull transport, const uint8_t* __nonnull bytes, size_t length,
+                                fs_transport_op_handler_t __nonnull handler, void* __nullable context,
+                                uint64_t now_ms)
+    __fs_SWIFT_NAME__(FSTransport.receive(self:_:_:_:_:now:));
+
+/** Sends every unacknowledged message again, oldest first; called after a reconnect. */
+void fs_transport_resend(fs_transport_t* __nonnull transport)
+    __fs_SWIFT_NAME__(FSTransport.resend(self:));
+
+/** Returns whether nothing is queued or waiting for an acknowledgement. */
+bool fs_transport_idle(const fs_transport_t* __nonnull transport)
+    __fs_SWIFT_NAME__(getter:FSTransport.isIdle(self:));
+
+
+/*
+ Delta sync.
+
+ A sync tree is a Merkle tree over a document cut into content-defined
+ chunks with the chunker defaults, the same chunks SCBackup stores. A node
+ lists its children, each an id and the number of document bytes below it,
+ and is named by the fs_chunk_hash() of that list, as a chunk is by the hash
+ of its bytes. A node closes after a child whose id has four chosen bits
+ clear, one in `FS_SYNC_FANOUT`, once it has two children, and after
+ `FS_SYNC_MAX_FANOUT`; the grouping is content-defined as well, so an edit
+ changes the chunks it touches and the nodes above them, and every other
+ subtree keeps its id.
+
+ A sync walks the tree of the side with the newer version, top down, and
+ opens only the subtrees the other side lacks. Pulling, it asks the other
+ side for each node it lacks (`FS_SYNC_EXPAND`) and then for the chunks
+ underneath that it does not hold (`FS_SYNC_FETCH`); pushing, it asks which
+ of its nodes and chunks the other side holds (`FS_SYNC_QUERY`) and sends
+ the missing ones (`FS_SYNC_UPLOAD`). An edit costs the chunks it changed
+ and the nodes on their paths to the root, whatever the size of the
+ document.
+
+ The sync does no I/O. fs_sync_next() hands out requests, which do not
+ depend on each other and may all be in flight at once, over one
+ fs_http_client_t connection or several; their results may come back in
+ any order. Discovery requests are handed out before transfers.
+
+ Node encoding: a level byte, 1 above the chunks, a varint child count and,
+ per child, the 16-byte id (`lo` then `hi`, little-endian) and a varint length.
+ */
+#define FS_SYNC_FANOUT 16
+#define FS_SYNC_MAX_FANOUT 64
+
+/* Largest encoded node */
+#define FS_SYNC_NODE_MAX (11 + FS_SYNC_MAX_FANOUT * 26)
+
+typedef struct fs_sync_tree fs_sync_tree_t;
+
+typedef enum {
+    /** Pull: get a node's encoding from the other side */
+    FS_SYNC_EXPAND = 0,
+    /** Pull: get a chunk from the other side */
+    FS_SYNC_FETCH = 1,
+    /** Push: ask whether the other side holds a node or chunk */
+    FS_SYNC_QUERY = 2,
+    /** Push: send a node's encoding or a chunk, from fs_sync_tree_node() or fs_sync_tree_chunk() */
+    FS_SYNC_UPLOAD = 3,
+} __fs_SWIFT_NAME__(FSSyncOp) fs_sync_op_t;
+
+typedef struct {
+    fs_sync_op_t op;
+    fs_chunk_id_t id;
+    /** Whether `id` names a chunk rather than a node */
+    bool chunk;
+    /** Bytes of the chunk, or of the document below the node; 0 for a root not fetched yet */
+    uint64_t length;
+} __fs_SWIFT_NAME__(FSSyncRequest) fs_sync_request_t;
+
+typedef struct fs_sync fs_sync_t;
+
+/**
+ * Chunks a document and builds its tree.
+ *
+ * @param data The document, which is not copied and must not change while the tree exists.
+ * @param out Receives the tree.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_sync_tree_create(const void* __nullable data, size_t length, fs_sync_tree_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSSyncTree.create(_:_:_:));
+
+/**
+ * Builds the tree of an edited document from the tree before the edit.
+ *
+ * Only the chunks from the one holding `offset` to the first boundary that
+ * survived the edit are cut and hashed again; the rest are taken from `base`.
+ * Several edits are passed as one range covering all of them.
+ *
+ * @param data The document after replacing `removed` bytes at `offset` with
+ *             `inserted` bytes; referenced like the data of fs_sync_tree_create().
+ * @param out Receives the new tree; `base` is unchanged.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` if the edit does not
+ *         fit the two lengths, or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_sync_tree_update(const fs_sync_tree_t* __nonnull base, const void* __nullable data, size_t length,
+                               size_t offset, size_t removed, size_t inserted,
+                               fs_sync_tree_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSSyncTree.update(self:_:_:offset:removed:inserted:_:));
+
+void fs_sync_tree_destroy(fs_sync_tree_t* __nullable tree)
+    __fs_SWIFT_NAME__(FSSyncTree.destroy(self:));
+
+/** Returns the id of the root node, which names the whole document. */
+fs_chunk_id_t fs_sync_tree_root(const fs_sync_tree_t* __nonnull tree)
+    __fs_SWIFT_NAME__(getter:FSSyncTree.root(self:));
+
+/** Returns whether the tree has a node (`chunk` false) or chunk with this id. */
+bool fs_sync_tree_contains(const fs_sync_tree_t* __nonnull tree, fs_chunk_id_t id, bool chunk)
+    __fs_SWIFT_NAME__(FSSyncTree.contains(self:_:chunk:));
+
+/**
+ * Encodes a node, to answer `FS_SYNC_EXPAND` or send an `FS_SYNC_UPLOAD`.
+ *
+ * @param bytes At least `FS_SYNC_NODE_MAX` bytes.
+ * @param length Receives the length of the encoding.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_NOT_FOUND` if the tree has no such node.
+ */
+fs_error_t fs_sync_tree_node(const fs_sync_tree_t* __nonnull tree, fs_chunk_id_t id, uint8_t* __nonnull bytes,
+                             size_t* __nonnull length)
+    __fs_SWIFT_NAME__(FSSyncTree.node(self:_:_:_:));
+
+/**
+ * Finds a chunk's bytes in the document, to answer `FS_SYNC_FETCH` or send an `FS_SYNC_UPLOAD`.
+ *
+ * @param bytes Receives a pointer into the document.
+ * @param length Receives the length of the chunk.
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_NOT_FOUND` if the tree has no such chunk.
+ */
+fs_error_t fs_sync_tree_chunk(const fs_sync_tree_t* __nonnull tree, fs_chunk_id_t id,
+                              const uint8_t* __nullable* __nonnull bytes, size_t* __nonnull length)
+    __fs_SWIFT_NAME__(FSSyncTree.chunk(self:_:_:_:));
+
+/**
+ * Starts fetching the version of the other side named by `root`.
+ *
+ * @param local The local tree, whose nodes and chunks are not fetched again,
+ *              or NULL to fetch everything; it must outlive the sync.
+ * @param out Receives the sync.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_sync_pull_create(const fs_sync_tree_t* __nullable local, fs_chunk_id_t root,
+                               fs_sync_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSSync.pull(local:root:_:));
+
+/**
+ * Starts sending the local version to the other side.
+ *
+ * Once fs_sync_done() returns true the other side holds every node and
+ * chunk of `local`, and its root may be published.
+ *
+ * @param local The tree to send; it must outlive the sync.
+ * @param out Receives the sync.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_sync_push_create(const fs_sync_tree_t* __nonnull local, fs_sync_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSSync.push(local:_:));
+
+void fs_sync_destroy(fs_sync_t* __nullable sync)
+    __fs_SWIFT_NAME__(FSSync.destroy(self:));
+
+/**
+ * Hands out requests not handed out before, discovery first.
+ *
+ * Each request stays in flight until it is answered with fs_sync_deliver(),
+ * fs_sync_answer() or fs_sync_sent(), or given back with fs_sync_retry().
+ *
+ * @param requests Room for `max` requests.
+ * @param count Receives the number handed out; 0 when everything left is in flight.
+ */
+void fs_sync_next(fs_sync_t* __nonnull sync, fs_sync_request_t* __nonnull requests, size_t max,
+                  size_t* __nonnull count)
+    __fs_SWIFT_NAME__(FSSync.next(self:_:_:_:));
+
+/**
+ * Answers an `FS_SYNC_EXPAND` or `FS_SYNC_FETCH` request with the bytes the other side sent.
+ *
+ * @param bytes Checked against the request's id, and copied.
+ * @return `FS_ERROR_NONE`; `FS_ERROR_INVALID_ARGUMENT` if the request is not
+ *         in flight or the bytes do not match it, in which case it is handed
+ *         out again; or `FS_ERROR_OUT_OF_MEMORY`, after which it is still in flight.
+ */
+fs_error_t fs_sync_deliver(fs_sync_t* __nonnull sync, const fs_sync_request_t* __nonnull request,
+                           const uint8_t* __nullable bytes, size_t length)
+    __fs_SWIFT_NAME__(FSSync.deliver(self:_:_:_:));
+
+/**
+ * Answers an `FS_SYNC_QUERY` request.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` if the request is not
+ *         in flight, or `FS_ERROR_OUT_OF_MEMORY`, after which it is still in flight.
+ */
+fs_error_t fs_sync_answer(fs_sync_t* __nonnull sync, const fs_sync_request_t* __nonnull request, bool present)
+    __fs_SWIFT_NAME__(FSSync.answer(self:_:present:));
+
+/**
+ * Completes an `FS_SYNC_UPLOAD` request the other side accepted.
+ *
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` if the request is not in flight.
+ */
+fs_error_t fs_sync_sent(fs_sync_t* __nonnull sync, const fs_sync_request_t* __nonnull request)
+    __fs_SWIFT_NAME__(FSSync.sent(self:_:));
+
+/**
+ * Gives back a request that failed, to be handed out again.
+ *
+ * @return `FS_ERROR_NONE`, or `FS_ERROR_INVALID_ARGUMENT` if the request is not in flight.
+ */
+fs_error_t fs_sync_retry(fs_sync_t* __nonnull sync, const fs_sync_request_t* __nonnull request)
+    __fs_SWIFT_NAME__(FSSync.retry(self:_:));
+
+/** Returns whether every request was handed out and answered. */
+bool fs_sync_done(const fs_sync_t* __nonnull sync)
+    __fs_SWIFT_NAME__(getter:FSSync.isDone(self:));
+
+/**
+ * Assembles the fetched version of a finished pull from the fetched chunks and the local ones.
+ *
+ * @param data Receives the malloc'd document; free() it after destroying `tree`.
+ * @param length Receives its length.
+ * @param tree Receives the tree of the document, whose root is the one pulled.
+ * @return `FS_ERROR_NONE`; `FS_ERROR_INVALID_ARGUMENT` for a push or a pull
+ *         that is not done, or if the fetched nodes do not build the pulled
+ *         root; or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_sync_finish(fs_sync_t* __nonnull sync, uint8_t* __nullable* __nonnull data, size_t* __nonnull length,
+                          fs_sync_tree_t* __nullable* __nonnull tree)
+    __fs_SWIFT_NAME__(FSSync.finish(self:_:_:_:));
+
+
+/*
+ Operation log.
+
+ fs_oplog_t keeps a document's collaboration state in two journal files
+ (see journal.h): the log at `path`, to which every operation applied to the
+ replica is appended, and a snapshot at `path` with ".snapshot" appended,
+ holding the fs_crdt_encode() of the replica, its text and the number of
+ operations it includes. Opening maps the snapshot, decodes it and replays
+ only the operations logged after it, so it costs the size of the document
+ and of its recent history, not of months of edits.
+
+ Appended operations are buffered and committed as one checksummed record
+ per group with a single flush: once the oldest has waited `commit_ms` or
+ the group reaches `commit_bytes`, from fs_oplog_poll(), or at once from
+ fs_oplog_commit(). A crash loses at most the group not committed yet, and
+ a group torn by one is dropped on the next open.
+
+ Once the log is larger than `snapshot_bytes` and than the last snapshot, a
+ commit writes a new snapshot, through a temporary file and rename, and
+ empties the log; the cost of snapshots stays proportional to the bytes
+ logged. Operations a crash leaves in the log after the snapshot that
+ includes them are skipped by count.
+
+ The replica and rope returned by fs_oplog_open() belong to the caller, who
+ edits them and appends each operation here right after applying it; they
+ must outlive the log. Calls take the time of a monotonic clock in
+ milliseconds.
+ */
+
+/* Defaults for fs_oplog_config_t */
+#define FS_OPLOG_COMMIT_MS 50
+#define FS_OPLOG_COMMIT_BYTES (64 * 1024)
+#define FS_OPLOG_SNAPSHOT_BYTES (1024 * 1024)
+
+typedef struct {
+    /** How long an appended operation may wait for others, 0 for `FS_OPLOG_COMMIT_MS` */
+    uint32_t commit_ms;
+    /** Encoded size at which a group is committed at once, 0 for `FS_OPLOG_COMMIT_BYTES` */
+    size_t commit_bytes;
+    /** A snapshot is written once the log outgrows this and the last snapshot, 0 for `FS_OPLOG_SNAPSHOT_BYTES` */
+    size_t snapshot_bytes;
+} __fs_SWIFT_NAME__(FSOpLogConfig) fs_oplog_config_t;
+
+typedef struct fs_oplog fs_oplog_t;
+
+/**
+ * Opens the log of a document, creating an empty one if there is none, and
+ * restores the document from its snapshot and the operations logged since.
+ *
+ * @param client This replica's client id, as for fs_crdt_create().
+ * @param config Limits, or NULL for the defaults.
+ * @param out Receives the log.
+ * @param crdt Receives the replica.
+ * @param rope Receives the text.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         `FS_ERROR_NOT_SUPPORTED` if the files are not an operation log or
+ *         are damaged, `FS_ERROR_NOT_FOUND` if the log continues a snapshot
+ *         that is missing, or an I/O error.
+ */
+fs_error_t fs_oplog_open(const char* __nonnull path, uint32_t client, const fs_oplog_config_t* __nullable config,
+                         fs_oplog_t* __nullable* __nonnull out, fs_crdt_t* __nullable* __nonnull crdt,
+                         fs_rope_t* __nullable* __nonnull rope)
+    __fs_SWIFT_NAME__(FSOpLog.open(_:client:config:_:_:_:));
+
+/** Frees the log; operations not committed are lost, so fs_oplog_commit() comes first. */
+void fs_oplog_close(fs_oplog_t* __nullable log)
+    __fs_SWIFT_NAME__(FSOpLog.close(self:));
+
+/**
+ * Adds an operation applied to the replica to the group being collected.
+ *
+ * @param text The `op->length` inserted bytes, copied; NULL for a delete.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT`, `FS_ERROR_OUT_OF_MEMORY`,
+ *         or the error of committing the full group first; after an error nothing was added.
+ */
+fs_error_t fs_oplog_append(fs_oplog_t* __nonnull log, const fs_crdt_op_t* __nonnull op,
+                           const uint8_t* __nullable text, uint64_t now_ms)
+    __fs_SWIFT_NAME__(FSOpLog.append(self:_:text:now:));
+
+/**
+ * Commits the group if it is due.
+ *
+ * @param deadline_ms Receives the time by which to poll again, `UINT64_MAX`
+ *                    if nothing is waiting.
+ * @return `FS_ERROR_NONE`, or the error of the commit; the group is kept and tried again.
+ */
+fs_error_t fs_oplog_poll(fs_oplog_t* __nonnull log, uint64_t now_ms, uint64_t* __nullable deadline_ms)
+    __fs_SWIFT_NAME__(FSOpLog.poll(self:now:_:));
+
+/**
+ * Writes and flushes the group now, then writes a snapshot if one is due.
+ *
+ * @return `FS_ERROR_NONE` or an I/O error; on failure the group is kept and
+ *         tried again by the next commit.
+ */
+fs_error_t fs_oplog_commit(fs_oplog_t* __nonnull log)
+    __fs_SWIFT_NAME__(FSOpLog.commit(self:));
+
+/**
+ * Commits the group, then replaces the snapshot with the current replica
+ * and text and empties the log, whatever their sizes.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY` or an I/O error.
+ */
+fs_error_t fs_oplog_snapshot(fs_oplog_t* __nonnull log)
+    __fs_SWIFT_NAME__(FSOpLog.snapshot(self:));
+
+/** Returns whether every appended operation is committed. */
+bool fs_oplog_idle(const fs_oplog_t* __nonnull log)
+    __fs_SWIFT_NAME__(getter:FSOpLog.isIdle(self:));
+
+
+/*
+ Presence.
+
+ Cursors, pointers and selections of the participants of a document, the
+ compact form of SCState's mouseState and selectionState. A server keeps
+ an fs_presence_hub_t per document and each participant an
+ fs_presence_client_t. Neither sends an update per change: changes wait
+ for the next tick, at most one every `tick_ms`, and only the fields that
+ differ from what was last sent go out, as deltas. Positions in a mouse
+ move usually take a byte each.
+
+ On a tick the hub encodes every participant's changes once, into one
+ batch, and gives it to a single send call that names all recipients. With
+ n participants a tick therefore costs n messages, where relaying every
+ move would cost about n² of them. A batch is at most `max_message`
+ bytes. Changes that do not fit wait for the next tick, and the following
+ batch starts where the last one stopped. Because of that limit, a busy
+ room uses a fixed bandwidth per participant however many are moving.
+
+ A message is a kind byte and then entries. Each entry is a varint user, a
+ field mask, and the fields in the mask. Each field is encoded against the
+ previous value the receiver holds for that user. A participant that joins
+ gets a snapshot of everyone else first, split over several messages when
+ large, and both directions start from all-zero state, so after a
+ reconnect the client calls fs_presence_client_reset() and the server
+ joins it again. Like the transport, neither side does I/O or reads a
+ clock, and the link must deliver messages in order.
+ */
+
+/* Defaults for fs_presence_config_t */
+#define FS_PRESENCE_TICK_MS 50
+#define FS_PRESENCE_MAX_MESSAGE 4096
+
+typedef struct {
+    int32_t x;                  // pointer position in document coordinates
+    int32_t y;
+    uint32_t cursor;            // caret offset
+    uint32_t anchor;            // other end of the selection, `cursor` when nothing is selected
+    uint8_t buttons;            // pressed mouse buttons: bit 0 left, 1 right, 2 middle
+    uint8_t status;             // application-defined, e.g. idle or typing
+} __fs_SWIFT_NAME__(FSPresence) fs_presence_t;
+
+/* Fields of fs_presence_t, as reported to fs_presence_handler_t */
+typedef enum {
+    FS_PRESENCE_POINTER = 1 << 0,       // `x` and `y`
+    FS_PRESENCE_BUTTONS = 1 << 1,
+    FS_PRESENCE_SELECTION = 1 << 2,     // `cursor` and `anchor`
+    FS_PRESENCE_STATUS = 1 << 3,
+    FS_PRESENCE_ALL = 0x0F
+} __fs_SWIFT_NAME__(FSPresenceField) fs_presence_field_t;
+
+typedef struct {
+    /** Shortest interval between two updates, 0 for `FS_PRESENCE_TICK_MS` */
+    uint32_t tick_ms;
+    /** Largest encoded message, 0 for `FS_PRESENCE_MAX_MESSAGE`, at least 64 */
+    size_t max_message;
+} __fs_SWIFT_NAME__(FSPresenceConfig) fs_presence_config_t;
+
+typedef struct fs_presence_hub fs_presence_hub_t;
+typedef struct fs_presence_client fs_presence_client_t;
+
+/** Sends one message to each of `count` users; `users` and `bytes` are only valid during the call. */
+typedef void (*fs_presence_fanout_t)(void* __nullable context, const uint32_t* __nonnull users, size_t count,
+                                     const uint8_t* __nonnull bytes, size_t length);
+
+/** Sends one message to the hub; `bytes` is only valid during the call. */
+typedef void (*fs_presence_send_t)(void* __nullable context, const uint8_t* __nonnull bytes, size_t length);
+
+/**
+ * Reports a remote participant: `changed` holds the fs_presence_field_t bits
+ * that changed, all of them when the participant has just appeared. `state`
+ * is NULL when the participant has left.
+ */
+typedef void (*fs_presence_handler_t)(void* __nullable context, uint32_t user,
+                                      const fs_presence_t* __nullable state, uint32_t changed);
+
+/**
+ * Creates the presence hub of a document.
+ *
+ * @param config Tick and message size, or NULL for the defaults.
+ * @param fanout Called with each message and its recipients.
+ * @param out Receives the hub.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_presence_hub_create(const fs_presence_config_t* __nullable config, fs_presence_fanout_t __nonnull fanout,
+                                  void* __nullable context, fs_presence_hub_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSPresenceHub.create(config:fanout:_:_:));
+
+void fs_presence_hub_destroy(fs_presence_hub_t* __nullable hub)
+    __fs_SWIFT_NAME__(FSPresenceHub.destroy(self:));
+
+/**
+ * Adds a participant, or starts it over when it is still present, e.g.
+ * after a reconnect. It gets a snapshot on the next tick and the others hear
+ * of it.
+ *
+ * @param user Nonzero id, usually the participant's CRDT client.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_presence_hub_join(fs_presence_hub_t* __nonnull hub, uint32_t user)
+    __fs_SWIFT_NAME__(FSPresenceHub.join(self:_:));
+
+/**
+ * Removes a participant; the others hear of it on the next tick.
+ *
+ * @return `FS_ERROR_NONE` or `FS_ERROR_NOT_FOUND`.
+ */
+fs_error_t fs_presence_hub_leave(fs_presence_hub_t* __nonnull hub, uint32_t user)
+    __fs_SWIFT_NAME__(FSPresenceHub.leave(self:_:));
+
+/**
+ * Handles a message from a participant, which may only update itself.
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_NOT_FOUND` for a user that has not
+ *         joined, or `FS_ERROR_INVALID_ARGUMENT` for a malformed message, of
+ *         which nothing was applied.
+ */
+fs_error_t fs_presence_hub_receive(fs_presence_hub_t* __nonnull hub, uint32_t user, const uint8_t* __nonnull bytes,
+                                   size_t length)
+    __fs_SWIFT_NAME__(FSPresenceHub.receive(self:from:_:_:));
+
+/**
+ * Sends the tick's batch and snapshots once `tick_ms` has passed since the
+ * last tick.
+ *
+ * @param deadline_ms Receives the time by which to poll again, `UINT64_MAX`
+ *                    if nothing is waiting on the clock.
+ */
+void fs_presence_hub_poll(fs_presence_hub_t* __nonnull hub, uint64_t now_ms, uint64_t* __nullable deadline_ms)
+    __fs_SWIFT_NAME__(FSPresenceHub.poll(self:now:_:));
+
+/** Returns the number of participants. */
+size_t fs_presence_hub_count(const fs_presence_hub_t* __nonnull hub)
+    __fs_SWIFT_NAME__(getter:FSPresenceHub.count(self:));
+
+/**
+ * Creates the presence of a local participant.
+ *
+ * @param user The id the hub knows the participant by.
+ * @param config Tick, or NULL for the defaults.
+ * @param send Called with each update for the hub.
+ * @param out Receives the client.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_presence_client_create(uint32_t user, const fs_presence_config_t* __nullable config,
+                                     fs_presence_send_t __nonnull send, void* __nullable context,
+                                     fs_presence_client_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(FSPresenceClient.create(user:config:send:_:_:));
+
+void fs_presence_client_destroy(fs_presence_client_t* __nullable client)
+    __fs_SWIFT_NAME__(FSPresenceClient.destroy(self:));
+
+/** Sets the local state; it is sent with the next tick if it differs from the last one sent. */
+void fs_presence_client_set(fs_presence_client_t* __nonnull client, const fs_presence_t* __nonnull state)
+    __fs_SWIFT_NAME__(FSPresenceClient.set(self:_:));
+
+/** Sends the local changes once `tick_ms` has passed since the last update. */
+void fs_presence_client_poll(fs_presence_client_t* __nonnull client, uint64_t now_ms,
+                             uint64_t* __nullable deadline_ms)
+    __fs_SWIFT_NAME__(FSPresenceClient.poll(self:now:_:));
+
+/**
+ * Handles a message from the hub.
+ *
+ * @param handler Called for each remote participant that appeared, changed or left.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_OUT_OF_MEMORY`, or
+ *         `FS_ERROR_INVALID_ARGUMENT` for a malformed message, of which
+ *         nothing was applied.
+ */
+fs_error_t fs_presence_client_receive(fs_presence_client_t* __nonnull client, const uint8_t* __nonnull bytes,
+                                      size_t length, fs_presence_handler_t __nullable handler,
+                                      void* __nullable context)
+    __fs_SWIFT_NAME__(FSPresenceClient.receive(self:_:_:_:_:));
+
+/**
+ * Looks up a remote participant.
+ *
+ * @return `FS_ERROR_NONE` or `FS_ERROR_NOT_FOUND`.
+ */
+fs_error_t fs_presence_client_get(const fs_presence_client_t* __nonnull client, uint32_t user,
+                                  fs_presence_t* __nonnull state)
+    __fs_SWIFT_NAME__(FSPresenceClient.get(self:_:_:));
+
+/** Returns the number of remote participants. */
+size_t fs_presence_client_count(const fs_presence_client_t* __nonnull client)
+    __fs_SWIFT_NAME__(getter:FSPresenceClient.count(self:));
+
+/**
+ * Starts the local state over from zero for a new connection, so the next
+ * update carries every field. Remote participants are kept until the
+ * hub's snapshot replaces them.
+ */
+void fs_presence_client_reset(fs_presence_client_t* __nonnull client)
+    __fs_SWIFT_NAME__(FSPresenceClient.reset(self:));
+
+#endif
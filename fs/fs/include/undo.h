@@ -0,0 +1,170 @@
+//
+//  undo.h
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_UNDO_H
+#define FS_UNDO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fs/interop.h>
+
+/*
+ Bounded undo/redo history.
+
+ Each entry is a command plus the document state before and after it, all
+ opaque bytes (SCState stores canonical JSON). States are kept as deltas
+ against the state recorded just before them: the common prefix and suffix
+ are shared and only the bytes in between are stored. Consecutive edits
+ usually touch a small part of the document and the "before" of one entry
+ is normally the "after" of the previous one, so most entries cost a few
+ dozen bytes regardless of document size.
+
+ Every `checkpoint_interval` states one is stored in full, which bounds the
+ work to rebuild any state. The newest state is also kept materialized so
+ pushing never rebuilds. Entries live in a ring; once `limit` entries are
+ held, pushing evicts the oldest one.
+ */
+
+/* Default number of states between full checkpoints */
+#define FS_UNDO_CHECKPOINT_INTERVAL 32
+
+typedef struct fs_undo_log fs_undo_log_t;
+
+/**
+ * Creates an empty history.
+ *
+ * @param limit Maximum number of entries, 0 for no limit.
+ * @param checkpoint_interval States between full checkpoints, 0 for `FS_UNDO_CHECKPOINT_INTERVAL`.
+ * @param out Receives the history; destroy with fs_undo_log_destroy().
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_undo_log_create(size_t limit, size_t checkpoint_interval, fs_undo_log_t* __nullable* __nonnull out)
+    __fs_SWIFT_NAME__(fsUndoLogCreate(_:_:_:));
+
+/** Frees the history and all its entries. */
+void fs_undo_log_destroy(fs_undo_log_t* __nullable log)
+    __fs_SWIFT_NAME__(fsUndoLogDestroy(_:));
+
+/** Removes all entries. */
+void fs_undo_log_clear(fs_undo_log_t* __nonnull log)
+    __fs_SWIFT_NAME__(fsUndoLogClear(_:));
+
+/** Number of entries held. */
+size_t fs_undo_log_count(const fs_undo_log_t* __nonnull log)
+    __fs_SWIFT_NAME__(fsUndoLogCount(_:));
+
+/** Bytes of entry data held, including the materialized newest state. */
+size_t fs_undo_log_footprint(const fs_undo_log_t* __nonnull log)
+    __fs_SWIFT_NAME__(fsUndoLogFootprint(_:));
+
+/**
+ * Changes the maximum number of entries, evicting the oldest ones if needed.
+ *
+ * @param log The history.
+ * @param limit Maximum number of entries, 0 for no limit.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_OUT_OF_MEMORY` (the limit is unchanged, some
+ *         entries may already have been evicted).
+ */
+fs_error_t fs_undo_log_set_limit(fs_undo_log_t* __nonnull log, size_t limit)
+    __fs_SWIFT_NAME__(fsUndoLogSetLimit(_:_:));
+
+/**
+ * Appends an entry, evicting the oldest one when the history is full.
+ *
+ * The bytes are copied.
+ *
+ * @param log The history.
+ * @param command Command bytes; may be empty.
+ * @param before State before the command; may be empty.
+ * @param after State after the command; may be empty.
+ * @return `FS_ERROR_NONE` or `FS_ERROR_OUT_OF_MEMORY` (the history is unchanged).
+ */
+fs_error_t fs_undo_log_push(fs_undo_log_t* __nonnull log, fs_data_t command, fs_data_t before, fs_data_t after)
+    __fs_SWIFT_NAME__(fsUndoLogPush(_:_:_:_:));
+
+/**
+ * Rebuilds an entry.
+ *
+ * Outputs are owned copies allocated with malloc(); pass `NULL` for any part
+ * that is not needed. Costs at most `checkpoint_interval` delta applications.
+ *
+ * @param log The history.
+ * @param index Entry index, 0 being the oldest.
+ * @return `FS_ERROR_NONE`, `FS_ERROR_NOT_FOUND` or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_undo_log_get(const fs_undo_log_t* __nonnull log, size_t index, fs_data_t* __nullable command,
+                           fs_data_t* __nullable before, fs_data_t* __nullable after)
+    __fs_SWIFT_NAME__(fsUndoLogGet(_:_:_:_:_:));
+
+/**
+ * Removes the newest entry, optionally returning it like fs_undo_log_get().
+ *
+ * @return `FS_ERROR_NONE`, `FS_ERROR_NOT_FOUND` (empty) or `FS_ERROR_OUT_OF_MEMORY`
+ *         (the history is unchanged).
+ */
+fs_error_t fs_undo_log_pop(fs_undo_log_t* __nonnull log, fs_data_t* __nullable command,
+                           fs_data_t* __nullable before, fs_data_t* __nullable after)
+    __fs_SWIFT_NAME__(fsUndoLogPop(_:_:_:_:));
+
+/**
+ * A state as a delta against the previous one: its first `prefix` and last
+ * `suffix` bytes are those of the previous state, and only the middle is its
+ * own. This is how the log stores states; it is public so that a history can
+ * be persisted in the same form.
+ */
+typedef struct {
+    size_t prefix;
+    size_t suffix;
+} __fs_SWIFT_NAME__(FSUndoDelta) fs_undo_delta_t;
+
+/**
+ * Computes the delta of `next` against `prev`.
+ *
+ * The middle of `next` runs from `prefix` to `next.len - suffix`. Equal states
+ * give an empty middle; unrelated ones give a delta with no shared bytes.
+ */
+fs_undo_delta_t fs_undo_delta_encode(fs_data_t prev, fs_data_t next)
+    __fs_SWIFT_NAME__(fsUndoDeltaEncode(_:_:));
+
+/**
+ * Rebuilds a state from the previous one and its delta.
+ *
+ * @param prev The previous state.
+ * @param delta The delta of the state against `prev`.
+ * @param middle The bytes between the shared prefix and suffix.
+ * @param out Receives the state, allocated with malloc().
+ * @return `FS_ERROR_NONE`, `FS_ERROR_INVALID_ARGUMENT` (the delta needs more bytes
+ *         than `prev` has) or `FS_ERROR_OUT_OF_MEMORY`.
+ */
+fs_error_t fs_undo_delta_apply(fs_data_t prev, fs_undo_delta_t delta, fs_data_t middle, fs_data_t* __nonnull out)
+    __fs_SWIFT_NAME__(fsUndoDeltaApply(_:_:_:_:));
+
+#endif
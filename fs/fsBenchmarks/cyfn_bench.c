@@ -0,0 +1,369 @@
+//
+//  cyfn_bench.c
+//  ScribbleLabApp File System Interface
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ cyfn throughput benchmark.
+
+ Measures key expansion and ECB, CBC (encrypt/decrypt), CTR and GCM over
+ buffer sizes from 64 B to 256 MB for every backend the running CPU supports,
+ plus the multi-core CTR and CBC decryption variants. Results are printed as
+ MB/s and cycles/byte (cycles per key for key expansion).
+
+ Cycles come from the time-stamp counter on x86; elsewhere they are derived
+ from wall time and the frequency given with -g, or omitted.
+
+ The software rounds of the portable backend are a build-time choice
+ (CYFN_SOFT_AES), so the build produces one executable per variant.
+
+   usage: cyfn_bench [-b backend] [-m max-bytes] [-t min-seconds] [-g ghz] [-c]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <cyfn.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYFN_BENCH_HAVE_TSC 1
+#else
+#define CYFN_BENCH_HAVE_TSC 0
+#endif
+
+#if CYFN_SOFT_AES == CYFN_SOFT_AES_TTABLE
+#define CYFN_BENCH_SOFT_NAME "ttable"
+#elif CYFN_SOFT_AES == CYFN_SOFT_AES_BITSLICE
+#define CYFN_BENCH_SOFT_NAME "bitslice"
+#else
+#define CYFN_BENCH_SOFT_NAME "bytewise"
+#endif
+
+#define CYFN_BENCH_MIN_SIZE ((size_t)64)
+#define CYFN_BENCH_MAX_SIZE ((size_t)256 * 1024 * 1024)
+
+struct cyfn_bench_config {
+    size_t max_size;
+    double min_seconds;
+    double ghz;
+    int csv;
+    int backend;            // -1: all available backends
+};
+
+struct cyfn_bench_state {
+    struct cyfn_ctx ctx;
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    struct cyfn_gcm_ctx gcm;
+#endif
+    uint8_t key[CYFN_AES_KEYLEN];
+    uint8_t iv[CYFN_AES_BLOCKLEN];
+    uint8_t* buf;
+};
+
+/**
+ * @brief One measured operation.
+ *
+ * `run` processes `length` bytes of `state->buf` (key expansion ignores it).
+ * `parallel` marks the multi-core variants, which are reported as their own
+ * "parallel" backend row on top of the fastest single-core backend.
+ */
+struct cyfn_bench_op {
+    const char* name;
+    void (*run)(struct cyfn_bench_state* state, size_t length);
+    int per_key;
+    int parallel;
+};
+
+static uint64_t cyfn_bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t cyfn_bench_cycles(void) {
+#if CYFN_BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void cyfn_bench_keyexp(struct cyfn_bench_state* state, size_t length) {
+    (void)length;
+    cyfn_init_ctx(&state->ctx, state->key);
+}
+
+#if defined(CYFN_ECB) && (CYFN_ECB == 1)
+static void cyfn_bench_ecb(struct cyfn_bench_state* state, size_t length) {
+    size_t i;
+    for (i = 0; i < length; i += CYFN_AES_BLOCKLEN) {
+        cyfn_ecb_encrypt(&state->ctx, state->buf + i);
+    }
+}
+#endif
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+static void cyfn_bench_cbc_encrypt(struct cyfn_bench_state* state, size_t length) {
+    cyfn_cbc_encrypt_buffer(&state->ctx, state->buf, length);
+}
+
+static void cyfn_bench_cbc_decrypt(struct cyfn_bench_state* state, size_t length) {
+    cyfn_cbc_decrypt_buffer(&state->ctx, state->buf, length);
+}
+#endif
+
+#if defined(CYFN_CTR) && (CYFN_CTR == 1)
+static void cyfn_bench_ctr(struct cyfn_bench_state* state, size_t length) {
+    cyfn_ctr_xcrypt_buffer(&state->ctx, state->buf, length);
+}
+#endif
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+static void cyfn_bench_gcm(struct cyfn_bench_state* state, size_t length) {
+    uint8_t tag[CYFN_GCM_TAGLEN];
+    
+    cyfn_gcm_ctx_set_iv(&state->gcm, state->iv, CYFN_GCM_IVLEN);
+    cyfn_gcm_encrypt_update(&state->gcm, state->buf, length);
+    cyfn_gcm_finish(&state->gcm, tag, sizeof(tag));
+}
+#endif
+
+#if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1)
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+static void cyfn_bench_cbc_decrypt_parallel(struct cyfn_bench_state* state, size_t length) {
+    cyfn_cbc_decrypt_buffer_parallel(&state->ctx, state->buf, length);
+}
+#endif
+
+#if defined(CYFN_CTR) && (CYFN_CTR == 1)
+static void cyfn_bench_ctr_parallel(struct cyfn_bench_state* state, size_t length) {
+    cyfn_ctr_xcrypt_buffer_parallel(&state->ctx, state->buf, length);
+}
+#endif
+#endif
+
+static const struct cyfn_bench_op cyfn_bench_ops[] = {
+    { "keyexp",      cyfn_bench_keyexp,      1, 0 },
+#if defined(CYFN_ECB) && (CYFN_ECB == 1)
+    { "ecb-enc",     cyfn_bench_ecb,         0, 0 },
+#endif
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+    { "cbc-enc",     cyfn_bench_cbc_encrypt, 0, 0 },
+    { "cbc-dec",     cyfn_bench_cbc_decrypt, 0, 0 },
+#endif
+#if defined(CYFN_CTR) && (CYFN_CTR == 1)
+    { "ctr",         cyfn_bench_ctr,         0, 0 },
+#endif
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    { "gcm-enc",     cyfn_bench_gcm,         0, 0 },
+#endif
+#if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1)
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+    { "cbc-dec",     cyfn_bench_cbc_decrypt_parallel, 0, 1 },
+#endif
+#if defined(CYFN_CTR) && (CYFN_CTR == 1)
+    { "ctr",         cyfn_bench_ctr_parallel,         0, 1 },
+#endif
+#endif
+};
+
+#define CYFN_BENCH_OP_COUNT (sizeof(cyfn_bench_ops) / sizeof(cyfn_bench_ops[0]))
+
+/**
+ * @brief Runs `op` until `min_seconds` have passed (at least twice, the first
+ *        run being a warm-up) and prints one result line.
+ */
+static void cyfn_bench_measure(const struct cyfn_bench_config* config, struct cyfn_bench_state* state,
+                               const char* backend, const struct cyfn_bench_op* op, size_t length) {
+    uint64_t min_ns = (uint64_t)(config->min_seconds * 1e9);
+    uint64_t iterations = 0;
+    uint64_t start_ns, elapsed_ns, start_cycles, cycles;
+    double units, mbps, per_unit;
+    
+    op->run(state, length);
+    
+    start_ns = cyfn_bench_now_ns();
+    start_cycles = cyfn_bench_cycles();
+    do {
+        op->run(state, length);
+        ++iterations;
+        elapsed_ns = cyfn_bench_now_ns() - start_ns;
+    } while (elapsed_ns < min_ns);
+    cycles = cyfn_bench_cycles() - start_cycles;
+    
+    if (!CYFN_BENCH_HAVE_TSC) {
+        cycles = (uint64_t)((double)elapsed_ns * config->ghz);
+    }
+    
+    units = op->per_key ? (double)iterations : (double)iterations * (double)length;
+    mbps = op->per_key ? 0.0 : (units / ((double)elapsed_ns / 1e9)) / 1e6;
+    per_unit = (double)cycles / units;
+    
+    if (config->csv) {
+        printf("%s,%s,%s,%zu,%.2f,%.2f\n", CYFN_BENCH_SOFT_NAME, backend, op->name,
+               op->per_key ? (size_t)0 : length, mbps, cycles ? per_unit : 0.0);
+    } else if (op->per_key) {
+        printf("%-10s %-9s %10s %12s %12.1f cycles/key\n", backend, op->name, "-", "-", per_unit);
+    } else if (cycles) {
+        printf("%-10s %-9s %10zu %10.1f MB/s %8.2f cycles/byte\n", backend, op->name, length, mbps, per_unit);
+    } else {
+        printf("%-10s %-9s %10zu %10.1f MB/s %8s cycles/byte\n", backend, op->name, length, mbps, "-");
+    }
+    fflush(stdout);
+}
+
+static void cyfn_bench_backend(const struct cyfn_bench_config* config, struct cyfn_bench_state* state,
+                               const char* backend, int parallel) {
+    size_t i, length;
+    
+    for (i = 0; i < CYFN_BENCH_OP_COUNT; ++i) {
+        const struct cyfn_bench_op* op = &cyfn_bench_ops[i];
+        
+        if (op->parallel != parallel) {
+            continue;
+        }
+        
+        cyfn_init_ctx_iv(&state->ctx, state->key, state->iv);
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+        cyfn_gcm_init_ctx(&state->gcm, state->key, state->iv, CYFN_GCM_IVLEN);
+#endif
+        
+        if (op->per_key) {
+            cyfn_bench_measure(config, state, backend, op, 0);
+            continue;
+        }
+        for (length = CYFN_BENCH_MIN_SIZE; length <= config->max_size; length *= 4) {
+            cyfn_bench_measure(config, state, backend, op, length);
+        }
+    }
+}
+
+static int cyfn_bench_parse_backend(const char* name) {
+    int backend;
+    
+    if (strcmp(name, "parallel") == 0) {
+        return CYFN_BACKEND_MAX;
+    }
+    for (backend = CYFN_BACKEND_PORTABLE; backend < CYFN_BACKEND_MAX; ++backend) {
+        if (strcmp(name, cyfn_backend_name((cyfn_backend_t)backend)) == 0) {
+            return backend;
+        }
+    }
+    return -2;
+}
+
+static void cyfn_bench_usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [-b portable|aesni|armv8|parallel] [-m max-bytes] [-t min-seconds] [-g ghz] [-c]\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    struct cyfn_bench_config config = { CYFN_BENCH_MAX_SIZE, 0.2, 0.0, 0, -1 };
+    struct cyfn_bench_state state;
+    size_t i;
+    int opt, backend;
+    
+    while ((opt = getopt(argc, argv, "b:m:t:g:c")) != -1) {
+        switch (opt) {
+            case 'b':
+                config.backend = cyfn_bench_parse_backend(optarg);
+                if (config.backend == -2) {
+                    cyfn_bench_usage(argv[0]);
+                    return 2;
+                }
+                break;
+            case 'm':
+                config.max_size = (size_t)strtoull(optarg, NULL, 0);
+                break;
+            case 't':
+                config.min_seconds = strtod(optarg, NULL);
+                break;
+            case 'g':
+                config.ghz = strtod(optarg, NULL);
+                break;
+            case 'c':
+                config.csv = 1;
+                break;
+            default:
+                cyfn_bench_usage(argv[0]);
+                return 2;
+        }
+    }
+    
+    if (config.max_size < CYFN_BENCH_MIN_SIZE) {
+        config.max_size = CYFN_BENCH_MIN_SIZE;
+    }
+    
+    memset(&state, 0, sizeof(state));
+    for (i = 0; i < sizeof(state.key); ++i) {
+        state.key[i] = (uint8_t)(i * 7 + 1);
+    }
+    for (i = 0; i < sizeof(state.iv); ++i) {
+        state.iv[i] = (uint8_t)(i * 13 + 5);
+    }
+    state.buf = malloc(config.max_size);
+    if (state.buf == NULL) {
+        fprintf(stderr, "cyfn_bench: cannot allocate %zu bytes\n", config.max_size);
+        return 1;
+    }
+    for (i = 0; i < config.max_size; ++i) {
+        state.buf[i] = (uint8_t)i;
+    }
+    
+    if (config.csv) {
+        printf("soft,backend,op,bytes,mb_per_s,cycles_per_unit\n");
+    } else {
+        printf("cyfn benchmark (software rounds: %s, min %.2fs per point)\n", CYFN_BENCH_SOFT_NAME, config.min_seconds);
+    }
+    
+    for (backend = CYFN_BACKEND_PORTABLE; backend < CYFN_BACKEND_MAX; ++backend) {
+        if ((config.backend >= 0 && config.backend != backend) ||
+            !cyfn_backend_is_available((cyfn_backend_t)backend)) {
+            continue;
+        }
+        cyfn_set_backend((cyfn_backend_t)backend);
+        cyfn_bench_backend(&config, &state, cyfn_backend_name((cyfn_backend_t)backend), 0);
+    }
+    
+    // Multi-core variants on the fastest backend.
+    if (config.backend < 0 || config.backend == CYFN_BACKEND_MAX) {
+        cyfn_set_backend(CYFN_BACKEND_AUTO);
+        cyfn_bench_backend(&config, &state, "parallel", 1);
+    }
+    
+    free(state.buf);
+    return 0;
+}
@@ -0,0 +1,161 @@
+//
+//  chunkTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/chunk.h>
+#import "fsTestSupport.h"
+
+/*
+ Content-defined chunking and chunk ids.
+
+ Chunk ids name stored backup chunks, interned diff lines and Merkle nodes, so
+ two different inputs of one length must not share an id just because their
+ stripes were moved around.
+ */
+
+static const size_t chunkStripe = 32;
+
+static void chunkFill(uint8_t *bytes, size_t length, uint64_t seed) {
+    for (size_t i = 0; i < length; ++i) {
+        bytes[i] = (uint8_t)fsTestRandomNext(&seed);
+    }
+}
+
+static void chunkSwapStripes(uint8_t *bytes, size_t a, size_t b) {
+    uint8_t stripe[32];
+    memcpy(stripe, bytes + a * chunkStripe, chunkStripe);
+    memcpy(bytes + a * chunkStripe, bytes + b * chunkStripe, chunkStripe);
+    memcpy(bytes + b * chunkStripe, stripe, chunkStripe);
+}
+
+@interface chunkTests : XCTestCase
+
+@end
+
+@implementation chunkTests
+
+- (void)testPermutedStripesChangeTheID {
+    const size_t length = 40 * 1024;
+    uint8_t *original = malloc(length);
+    uint8_t *permuted = malloc(length);
+    chunkFill(original, length, 0x9e3779b97f4a7c15ull);
+    
+    // 256 bytes apart inside one 1 KiB block, and across blocks.
+    memcpy(permuted, original, length);
+    chunkSwapStripes(permuted, 3, 11);
+    chunkSwapStripes(permuted, 40, 56);
+    XCTAssertFalse(fs_chunk_id_equal(fs_chunk_hash(original, length), fs_chunk_hash(permuted, length)));
+    
+    for (size_t a = 0; a < 96; ++a) {
+        for (size_t b = a + 1; b < 96; ++b) {
+            memcpy(permuted, original, length);
+            chunkSwapStripes(permuted, a, b);
+            XCTAssertFalse(fs_chunk_id_equal(fs_chunk_hash(original, length), fs_chunk_hash(permuted, length)),
+                           @"stripes %zu and %zu", a, b);
+        }
+    }
+    free(original);
+    free(permuted);
+}
+
+- (void)testEveryLengthAndBitChangesTheID {
+    uint8_t bytes[300];
+    chunkFill(bytes, sizeof(bytes), 7);
+    
+    for (size_t length = 1; length <= sizeof(bytes); ++length) {
+        fs_chunk_id_t id = fs_chunk_hash(bytes, length);
+        XCTAssertFalse(fs_chunk_id_equal(id, fs_chunk_hash(bytes, length - 1)), @"length %zu", length);
+        for (size_t bit = 0; bit < length * 8; bit += 7) {
+            bytes[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            XCTAssertFalse(fs_chunk_id_equal(id, fs_chunk_hash(bytes, length)), @"length %zu bit %zu", length, bit);
+            bytes[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        }
+    }
+    XCTAssertTrue(fs_chunk_id_equal(fs_chunk_hash(bytes, 100), fs_chunk_hash(bytes, 100)));
+}
+
+- (void)testHexIsHighHalfFirst {
+    char hex[FS_CHUNK_ID_HEX_LEN + 1];
+    fs_chunk_id_hex((fs_chunk_id_t){ .lo = 0x0123456789abcdefull, .hi = 0xfedcba9876543210ull }, hex);
+    XCTAssertEqualObjects(@(hex), @"fedcba98765432100123456789abcdef");
+}
+
+- (void)testSplitCoversInputWithinBounds {
+    const size_t length = 4 * 1024 * 1024;
+    uint8_t *bytes = malloc(length);
+    size_t *ends = NULL;
+    size_t count = 0, start = 0;
+    chunkFill(bytes, length, 42);
+    
+    XCTAssertEqual(fs_chunk_split(bytes, length, NULL, &ends, &count), FS_ERROR_NONE);
+    XCTAssertGreaterThan(count, (size_t)1);
+    for (size_t i = 0; i < count; ++i) {
+        size_t size = ends[i] - start;
+        XCTAssertLessThanOrEqual(size, (size_t)FS_CHUNK_MAX_SIZE);
+        if (i + 1 < count) {
+            XCTAssertGreaterThanOrEqual(size, (size_t)FS_CHUNK_MIN_SIZE);
+        }
+        XCTAssertEqual(fs_chunk_next(bytes + start, length - start, NULL), size);
+        start = ends[i];
+    }
+    XCTAssertEqual(start, length);
+    free(ends);
+    free(bytes);
+}
+
+- (void)testInsertionOnlyMovesNearbyBoundaries {
+    const size_t length = 2 * 1024 * 1024;
+    uint8_t *bytes = malloc(length + 1);
+    size_t *before = NULL, *after = NULL;
+    size_t beforeCount = 0, afterCount = 0, shared = 0;
+    chunkFill(bytes + 1, length, 99);
+    
+    XCTAssertEqual(fs_chunk_split(bytes + 1, length, NULL, &before, &beforeCount), FS_ERROR_NONE);
+    bytes[0] = 'x';
+    XCTAssertEqual(fs_chunk_split(bytes, length + 1, NULL, &after, &afterCount), FS_ERROR_NONE);
+    
+    // Every boundary past the first chunk should survive, shifted by the inserted byte.
+    for (size_t i = 0, j = 0; i < beforeCount && j < afterCount;) {
+        if (before[i] + 1 == after[j]) {
+            ++shared, ++i, ++j;
+        } else if (before[i] + 1 < after[j]) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    XCTAssertGreaterThanOrEqual(shared + 2, beforeCount);
+    free(before);
+    free(after);
+    free(bytes);
+}
+
+@end
@@ -0,0 +1,314 @@
+//
+//  crdtTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+
+/*
+ Run-length RGA sequence CRDT.
+
+ Each replica mirrors its visible characters in a flat buffer, edited at the
+ positions the CRDT reports. Operations travel per link in order but links are
+ drained in random interleavings; once everything is delivered, every buffer
+ must hold the same text.
+ */
+
+#define CRDT_REPLICAS 3
+#define CRDT_MAX_RUN 32
+#define CRDT_QUEUE 4096
+
+typedef struct {
+    fs_crdt_op_t op;
+    char bytes[CRDT_MAX_RUN];
+} crdtMessage;
+
+typedef struct {
+    fs_crdt_t *crdt;
+    fsTestText text;
+    // queues[from]: operations of replica `from` not yet applied here.
+    crdtMessage *queues[CRDT_REPLICAS];
+    size_t heads[CRDT_REPLICAS], tails[CRDT_REPLICAS];
+} crdtReplica;
+
+typedef struct {
+    crdtReplica replicas[CRDT_REPLICAS];
+    int sender;
+    uint64_t random;
+} crdtNetwork;
+
+static size_t crdtRandom(crdtNetwork *net, size_t bound) {
+    return fsTestRandom(&net->random, bound);
+}
+
+static void crdtBroadcast(crdtNetwork *net, const fs_crdt_op_t *op, const char *bytes) {
+    for (int to = 0; to < CRDT_REPLICAS; ++to) {
+        crdtReplica *replica = &net->replicas[to];
+        if (to == net->sender) {
+            continue;
+        }
+        crdtMessage *message = &replica->queues[net->sender][replica->tails[net->sender]++ % CRDT_QUEUE];
+        message->op = *op;
+        if (bytes) {
+            memcpy(message->bytes, bytes, op->length);
+        }
+    }
+}
+
+static void crdtOnDelete(void *context, const fs_crdt_op_t *op) {
+    crdtBroadcast(context, op, NULL);
+}
+
+static void crdtSetUp(crdtNetwork *net, uint64_t seed) {
+    memset(net, 0, sizeof(*net));
+    net->random = seed;
+    for (int i = 0; i < CRDT_REPLICAS; ++i) {
+        fs_crdt_create((uint32_t)i + 1, &net->replicas[i].crdt);
+        net->replicas[i].text.bytes = malloc(1 << 20);
+        for (int from = 0; from < CRDT_REPLICAS; ++from) {
+            net->replicas[i].queues[from] = calloc(CRDT_QUEUE, sizeof(crdtMessage));
+        }
+    }
+}
+
+static void crdtTearDown(crdtNetwork *net) {
+    for (int i = 0; i < CRDT_REPLICAS; ++i) {
+        fs_crdt_destroy(net->replicas[i].crdt);
+        free(net->replicas[i].text.bytes);
+        for (int from = 0; from < CRDT_REPLICAS; ++from) {
+            free(net->replicas[i].queues[from]);
+        }
+    }
+}
+
+static fs_error_t crdtInsert(crdtNetwork *net, int index, size_t position, const char *bytes, uint32_t length) {
+    crdtReplica *replica = &net->replicas[index];
+    fs_crdt_op_t op;
+    fs_error_t error = fs_crdt_insert(replica->crdt, position, length, &op);
+    if (error == FS_ERROR_NONE) {
+        net->sender = index;
+        fsTestTextInsert(&replica->text, position, bytes, length);
+        crdtBroadcast(net, &op, bytes);
+    }
+    return error;
+}
+
+static void crdtLocalEdit(crdtNetwork *net, int index) {
+    crdtReplica *replica = &net->replicas[index];
+    net->sender = index;
+    if (replica->text.length == 0 || crdtRandom(net, 3) != 0) {
+        char bytes[CRDT_MAX_RUN];
+        uint32_t length = 1 + (uint32_t)crdtRandom(net, CRDT_MAX_RUN);
+        // Typing at the end most of the time, so runs get extended.
+        size_t position = crdtRandom(net, 2) ? replica->text.length : crdtRandom(net, replica->text.length + 1);
+        for (uint32_t i = 0; i < length; ++i) {
+            bytes[i] = (char)('a' + crdtRandom(net, 26));
+        }
+        crdtInsert(net, index, position, bytes, length);
+    } else {
+        size_t position = crdtRandom(net, replica->text.length);
+        size_t length = 1 + crdtRandom(net, replica->text.length - position < 40 ? replica->text.length - position : 40);
+        if (fs_crdt_delete(replica->crdt, position, length, crdtOnDelete, net) == FS_ERROR_NONE) {
+            fsTestTextDelete(&replica->text, position, length);
+        }
+    }
+}
+
+// Applies the next operation from `from` at `to`; returns NO if there is none or it must wait.
+static BOOL crdtDeliver(crdtNetwork *net, int from, int to) {
+    crdtReplica *replica = &net->replicas[to];
+    if (from == to || replica->heads[from] == replica->tails[from]) {
+        return NO;
+    }
+    const crdtMessage *message = &replica->queues[from][replica->heads[from] % CRDT_QUEUE];
+    fsTestMirror mirror = { &replica->text, NULL, (const uint8_t *)message->bytes, message->op.kind != FS_CRDT_INSERT };
+    if (fs_crdt_apply(replica->crdt, &message->op, fsTestMirrorRange, &mirror) != FS_ERROR_NONE) {
+        return NO;
+    }
+    replica->heads[from]++;
+    return YES;
+}
+
+static void crdtDrain(crdtNetwork *net) {
+    BOOL progress = YES;
+    while (progress) {
+        progress = NO;
+        for (int from = 0; from < CRDT_REPLICAS; ++from) {
+            for (int to = 0; to < CRDT_REPLICAS; ++to) {
+                while (crdtDeliver(net, from, to)) {
+                    progress = YES;
+                }
+            }
+        }
+    }
+}
+
+static BOOL crdtConverged(const crdtNetwork *net) {
+    for (int i = 1; i < CRDT_REPLICAS; ++i) {
+        const crdtReplica *a = &net->replicas[0], *b = &net->replicas[i];
+        if (a->text.length != b->text.length || memcmp(a->text.bytes, b->text.bytes, a->text.length) != 0 ||
+            fs_crdt_length(b->crdt) != b->text.length) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+@interface crdtTests : XCTestCase
+
+@end
+
+@implementation crdtTests
+
+- (void)testRandomConcurrentEditsConverge {
+    crdtNetwork net;
+    crdtSetUp(&net, 0x9e3779b97f4a7c15ull);
+    
+    for (int round = 0; round < 40; ++round) {
+        for (int step = 0; step < 60; ++step) {
+            int index = (int)crdtRandom(&net, CRDT_REPLICAS);
+            if (crdtRandom(&net, 3) == 0) {
+                // Partial, out-of-step delivery between edits.
+                crdtDeliver(&net, (int)crdtRandom(&net, CRDT_REPLICAS), index);
+            } else {
+                crdtLocalEdit(&net, index);
+            }
+        }
+        crdtDrain(&net);
+        XCTAssertTrue(crdtConverged(&net), @"round %d", round);
+    }
+    crdtTearDown(&net);
+}
+
+- (void)testCollectKeepsTheTextAndShrinksTheRuns {
+    crdtNetwork net;
+    crdtSetUp(&net, 12345);
+    for (int step = 0; step < 2000; ++step) {
+        crdtLocalEdit(&net, (int)crdtRandom(&net, CRDT_REPLICAS));
+    }
+    crdtDrain(&net);
+    XCTAssertTrue(crdtConverged(&net));
+    
+    fs_crdt_id_t stable[CRDT_REPLICAS];
+    for (int i = 0; i < CRDT_REPLICAS; ++i) {
+        stable[i] = (fs_crdt_id_t){ (uint32_t)i + 1, fs_crdt_version(net.replicas[0].crdt, (uint32_t)i + 1) };
+    }
+    for (int i = 0; i < CRDT_REPLICAS; ++i) {
+        size_t runs = fs_crdt_run_count(net.replicas[i].crdt);
+        XCTAssertEqual(fs_crdt_collect(net.replicas[i].crdt, stable, CRDT_REPLICAS), FS_ERROR_NONE);
+        XCTAssertLessThan(fs_crdt_run_count(net.replicas[i].crdt), runs);
+        XCTAssertEqual(fs_crdt_length(net.replicas[i].crdt), net.replicas[i].text.length);
+    }
+    
+    // Editing goes on as before.
+    for (int step = 0; step < 500; ++step) {
+        crdtLocalEdit(&net, (int)crdtRandom(&net, CRDT_REPLICAS));
+    }
+    crdtDrain(&net);
+    XCTAssertTrue(crdtConverged(&net));
+    crdtTearDown(&net);
+}
+
+- (void)testEncodeDecodeRoundTrip {
+    crdtNetwork net;
+    crdtSetUp(&net, 777);
+    for (int step = 0; step < 1500; ++step) {
+        crdtLocalEdit(&net, (int)crdtRandom(&net, CRDT_REPLICAS));
+    }
+    crdtDrain(&net);
+    
+    // Replace replica 2 by a decoded copy of its own state and keep editing.
+    uint8_t *bytes = NULL;
+    size_t length = 0;
+    fs_crdt_t *decoded = NULL;
+    XCTAssertEqual(fs_crdt_encode(net.replicas[2].crdt, &bytes, &length), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_decode(3, bytes, length, &decoded), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_length(decoded), fs_crdt_length(net.replicas[2].crdt));
+    for (uint32_t client = 1; client <= CRDT_REPLICAS; ++client) {
+        XCTAssertEqual(fs_crdt_version(decoded, client), fs_crdt_version(net.replicas[2].crdt, client));
+    }
+    fs_crdt_t *truncated = NULL;
+    XCTAssertEqual(fs_crdt_decode(3, bytes, length - 1, &truncated), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertTrue(truncated == NULL);
+    free(bytes);
+    fs_crdt_destroy(net.replicas[2].crdt);
+    net.replicas[2].crdt = decoded;
+    
+    for (int step = 0; step < 1500; ++step) {
+        crdtLocalEdit(&net, (int)crdtRandom(&net, CRDT_REPLICAS));
+    }
+    crdtDrain(&net);
+    XCTAssertTrue(crdtConverged(&net));
+    crdtTearDown(&net);
+}
+
+- (void)testConcurrentInsertsAtOnePlaceAgree {
+    crdtNetwork net;
+    crdtSetUp(&net, 1);
+    XCTAssertEqual(crdtInsert(&net, 0, 0, "one", 3), FS_ERROR_NONE);
+    crdtDrain(&net);
+    
+    // All three type after "o" at once; every replica orders the runs the same way.
+    XCTAssertEqual(crdtInsert(&net, 0, 1, "AA", 2), FS_ERROR_NONE);
+    XCTAssertEqual(crdtInsert(&net, 1, 1, "BBB", 3), FS_ERROR_NONE);
+    XCTAssertEqual(crdtInsert(&net, 2, 1, "C", 1), FS_ERROR_NONE);
+    for (int to = CRDT_REPLICAS - 1; to >= 0; --to) {
+        for (int from = 0; from < CRDT_REPLICAS; ++from) {
+            crdtDeliver(&net, from, to);
+        }
+    }
+    XCTAssertTrue(crdtConverged(&net));
+    XCTAssertEqual(net.replicas[0].text.length, (size_t)9);
+    XCTAssertEqual(net.replicas[0].text.bytes[0], 'o');
+    XCTAssertEqual(memcmp(net.replicas[0].text.bytes + 7, "ne", 2), 0);
+    crdtTearDown(&net);
+}
+
+- (void)testEarlyOperationsWaitAndRepeatsAreIgnored {
+    fs_crdt_t *a = NULL, *b = NULL;
+    fs_crdt_op_t first, second;
+    XCTAssertEqual(fs_crdt_create(1, &a), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_create(2, &b), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_insert(a, 0, 4, &first), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_insert(a, 2, 2, &second), FS_ERROR_NONE);
+    
+    XCTAssertEqual(fs_crdt_apply(b, &second, NULL, NULL), FS_ERROR_NOT_FOUND);
+    XCTAssertEqual(fs_crdt_length(b), (size_t)0);
+    XCTAssertEqual(fs_crdt_apply(b, &first, NULL, NULL), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_apply(b, &second, NULL, NULL), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_apply(b, &first, NULL, NULL), FS_ERROR_NONE);
+    XCTAssertEqual(fs_crdt_length(b), (size_t)6);
+    XCTAssertEqual(fs_crdt_version(b, 1), fs_crdt_version(a, 1));
+    fs_crdt_destroy(a);
+    fs_crdt_destroy(b);
+}
+
+@end
@@ -0,0 +1,232 @@
+//
+//  cyfnPerformanceTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/cyfn.h>
+
+#include <libproc.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ Throughput of the cyfn backends as seen by the framework build.
+
+ Each case runs under -measureBlock: (so Xcode tracks baselines and flags
+ regressions) and additionally logs MB/s and cycles/byte. Cycles are the
+ process' CPU cycle count from proc_pid_rusage(). The full size sweep and the
+ CBC/ECB modes that the framework does not enable by default are covered by
+ the cyfn_benchmark CMake target (fs/fsBenchmarks).
+ */
+
+static const size_t cyfnLargeBuffer = 1024 * 1024;
+static const size_t cyfnSmallBuffer = 64;
+static const int cyfnKeysPerRun = 1000;
+
+static uint64_t cyfnCycles(void) {
+    struct rusage_info_v4 info;
+    if (proc_pid_rusage(getpid(), RUSAGE_INFO_V4, (rusage_info_t *)&info) != 0) {
+        return 0;
+    }
+    return info.ri_cycles;
+}
+
+static cyfn_backend_t cyfnHardwareBackend(void) {
+    if (cyfn_backend_is_available(CYFN_BACKEND_AESNI)) {
+        return CYFN_BACKEND_AESNI;
+    }
+    return CYFN_BACKEND_ARMV8;
+}
+
+@interface cyfnPerformanceTests : XCTestCase
+
+@end
+
+@implementation cyfnPerformanceTests {
+    uint8_t *_buffer;
+    uint8_t _key[CYFN_AES_KEYLEN];
+    uint8_t _iv[CYFN_AES_BLOCKLEN];
+    struct cyfn_ctx _ctx;
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    struct cyfn_gcm_ctx _gcm;
+#endif
+}
+
+- (void)setUp {
+    _buffer = malloc(cyfnLargeBuffer);
+    for (size_t i = 0; i < cyfnLargeBuffer; ++i) {
+        _buffer[i] = (uint8_t)i;
+    }
+    for (size_t i = 0; i < sizeof(_key); ++i) {
+        _key[i] = (uint8_t)(i * 7 + 1);
+    }
+    for (size_t i = 0; i < sizeof(_iv); ++i) {
+        _iv[i] = (uint8_t)(i * 13 + 5);
+    }
+}
+
+- (void)tearDown {
+    free(_buffer);
+    _buffer = NULL;
+    cyfn_set_backend(CYFN_BACKEND_AUTO);
+}
+
+/// Measures `block` on `backend`; `units` is the number of bytes (or keys) one run processes.
+- (void)measure:(NSString *)name backend:(cyfn_backend_t)backend units:(size_t)units perKey:(BOOL)perKey block:(void (^)(void))block {
+    __block uint64_t totalNs = 0;
+    __block uint64_t totalCycles = 0;
+    __block uint64_t runs = 0;
+    
+    XCTAssertEqual(cyfn_set_backend(backend), 0);
+    cyfn_init_ctx_iv(&_ctx, _key, _iv);
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+    cyfn_gcm_init_ctx(&_gcm, _key, _iv, CYFN_GCM_IVLEN);
+#endif
+    
+    [self measureBlock:^{
+        uint64_t ns = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        uint64_t cycles = cyfnCycles();
+        block();
+        totalCycles += cyfnCycles() - cycles;
+        totalNs += clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - ns;
+        ++runs;
+    }];
+    
+    double total = (double)units * (double)runs;
+    if (perKey) {
+        NSLog(@"cyfn %@ [%s]: %.1f cycles/key", name, cyfn_backend_name(backend), (double)totalCycles / total);
+    } else {
+        NSLog(@"cyfn %@ [%s] %zu B: %.1f MB/s, %.2f cycles/byte", name, cyfn_backend_name(backend), units,
+              (total / ((double)totalNs / 1e9)) / 1e6, (double)totalCycles / total);
+    }
+}
+
+- (void)measureCTR:(cyfn_backend_t)backend length:(size_t)length {
+    XCTSkipUnless(cyfn_backend_is_available(backend), @"backend not supported on this CPU");
+    [self measure:@"ctr" backend:backend units:length perKey:NO block:^{
+        cyfn_ctr_xcrypt_buffer(&self->_ctx, self->_buffer, length);
+    }];
+}
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+- (void)measureGCM:(cyfn_backend_t)backend {
+    XCTSkipUnless(cyfn_backend_is_available(backend), @"backend not supported on this CPU");
+    [self measure:@"gcm-enc" backend:backend units:cyfnLargeBuffer perKey:NO block:^{
+        uint8_t tag[CYFN_GCM_TAGLEN];
+        cyfn_gcm_ctx_set_iv(&self->_gcm, self->_iv, CYFN_GCM_IVLEN);
+        cyfn_gcm_encrypt_update(&self->_gcm, self->_buffer, cyfnLargeBuffer);
+        cyfn_gcm_finish(&self->_gcm, tag, sizeof(tag));
+    }];
+}
+#endif
+
+- (void)measureKeyExpansion:(cyfn_backend_t)backend {
+    XCTSkipUnless(cyfn_backend_is_available(backend), @"backend not supported on this CPU");
+    [self measure:@"keyexp" backend:backend units:cyfnKeysPerRun perKey:YES block:^{
+        for (int i = 0; i < cyfnKeysPerRun; ++i) {
+            cyfn_init_ctx(&self->_ctx, self->_key);
+        }
+    }];
+}
+
+#pragma mark - Key expansion
+
+- (void)testKeyExpansionPortable {
+    [self measureKeyExpansion:CYFN_BACKEND_PORTABLE];
+}
+
+#pragma mark - CTR
+
+- (void)testCTRPortable {
+    [self measureCTR:CYFN_BACKEND_PORTABLE length:cyfnLargeBuffer];
+}
+
+- (void)testCTRHardware {
+    [self measureCTR:cyfnHardwareBackend() length:cyfnLargeBuffer];
+}
+
+- (void)testCTRHardwareSmallBuffer {
+    [self measureCTR:cyfnHardwareBackend() length:cyfnSmallBuffer];
+}
+
+#if defined(CYFN_PARALLEL) && (CYFN_PARALLEL == 1)
+- (void)testCTRParallel {
+    [self measure:@"ctr-parallel" backend:CYFN_BACKEND_AUTO units:cyfnLargeBuffer perKey:NO block:^{
+        cyfn_ctr_xcrypt_buffer_parallel(&self->_ctx, self->_buffer, cyfnLargeBuffer);
+    }];
+}
+#endif
+
+#pragma mark - GCM
+
+#if defined(CYFN_GCM) && (CYFN_GCM == 1)
+- (void)testGCMPortable {
+    [self measureGCM:CYFN_BACKEND_PORTABLE];
+}
+
+- (void)testGCMHardware {
+    [self measureGCM:cyfnHardwareBackend()];
+}
+#endif
+
+#pragma mark - CBC / ECB
+
+#if defined(CYFN_CBC) && (CYFN_CBC == 1)
+- (void)testCBCEncryptHardware {
+    cyfn_backend_t backend = cyfnHardwareBackend();
+    XCTSkipUnless(cyfn_backend_is_available(backend), @"backend not supported on this CPU");
+    [self measure:@"cbc-enc" backend:backend units:cyfnLargeBuffer perKey:NO block:^{
+        cyfn_cbc_encrypt_buffer(&self->_ctx, self->_buffer, cyfnLargeBuffer);
+    }];
+}
+
+- (void)testCBCDecryptHardware {
+    cyfn_backend_t backend = cyfnHardwareBackend();
+    XCTSkipUnless(cyfn_backend_is_available(backend), @"backend not supported on this CPU");
+    [self measure:@"cbc-dec" backend:backend units:cyfnLargeBuffer perKey:NO block:^{
+        cyfn_cbc_decrypt_buffer(&self->_ctx, self->_buffer, cyfnLargeBuffer);
+    }];
+}
+#endif
+
+#if defined(CYFN_ECB) && (CYFN_ECB == 1)
+- (void)testECBEncryptHardware {
+    cyfn_backend_t backend = cyfnHardwareBackend();
+    XCTSkipUnless(cyfn_backend_is_available(backend), @"backend not supported on this CPU");
+    [self measure:@"ecb-enc" backend:backend units:cyfnLargeBuffer perKey:NO block:^{
+        for (size_t i = 0; i < cyfnLargeBuffer; i += CYFN_AES_BLOCKLEN) {
+            cyfn_ecb_encrypt(&self->_ctx, self->_buffer + i);
+        }
+    }];
+}
+#endif
+
+@end
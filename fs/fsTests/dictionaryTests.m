@@ -0,0 +1,227 @@
+//
+//  dictionaryTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/dictionary.h>
+#import "fsTestSupport.h"
+
+/*
+ Hash-indexed fs_dictionary_t.
+
+ Random sets, removals and clears are mirrored in a model that holds the
+ entries in the order the dictionary documents: insertion order with
+ FS_DICT_ORDERED, last-entry-into-the-hole otherwise. The dense arrays, every
+ lookup and every position must match the model after each step.
+ */
+
+#define DICTIONARY_KEYS 700
+#define DICTIONARY_KEY_MAX 40
+
+typedef struct {
+    char bytes[DICTIONARY_KEY_MAX];
+    size_t length;
+} dictionaryKey;
+
+typedef struct {
+    size_t keys[DICTIONARY_KEYS];
+    uintptr_t values[DICTIONARY_KEYS];
+    size_t count;
+} dictionaryModel;
+
+static uint64_t dictionaryRandomState = 0x9b05688c2b3e6c1full;
+static dictionaryKey dictionaryVocabulary[DICTIONARY_KEYS];
+
+static size_t dictionaryRandom(size_t bound) {
+    return fsTestRandom(&dictionaryRandomState, bound);
+}
+
+// Keys of all lengths, including the empty key, embedded NULs and shared prefixes.
+static void dictionaryMakeVocabulary(void) {
+    for (size_t k = 0; k < DICTIONARY_KEYS; ++k) {
+        dictionaryKey *key = &dictionaryVocabulary[k];
+        if (k >= 2 && dictionaryRandom(4) == 0) {
+            *key = dictionaryVocabulary[dictionaryRandom(k)];
+            key->length = key->length < DICTIONARY_KEY_MAX ? key->length + 1 : key->length - 1;
+            key->bytes[key->length - 1] = (char)(k % 251);
+        } else {
+            key->length = k == 0 ? 0 : 1 + dictionaryRandom(DICTIONARY_KEY_MAX);
+            for (size_t i = 0; i < key->length; ++i) {
+                key->bytes[i] = (char)dictionaryRandom(256);
+            }
+        }
+        // Redraw duplicates so every key in the vocabulary is distinct.
+        for (size_t j = 0; j < k; ++j) {
+            if (dictionaryVocabulary[j].length == key->length && memcmp(dictionaryVocabulary[j].bytes, key->bytes, key->length) == 0) {
+                key->length = 1 + dictionaryRandom(DICTIONARY_KEY_MAX);
+                for (size_t i = 0; i < key->length; ++i) {
+                    key->bytes[i] = (char)dictionaryRandom(256);
+                }
+                j = (size_t)-1;
+            }
+        }
+    }
+}
+
+static size_t dictionaryModelFind(const dictionaryModel *model, size_t key) {
+    for (size_t i = 0; i < model->count; ++i) {
+        if (model->keys[i] == key) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+static void dictionaryModelRemove(dictionaryModel *model, size_t position, BOOL ordered) {
+    size_t last = model->count - 1;
+    if (ordered) {
+        memmove(model->keys + position, model->keys + position + 1, (last - position) * sizeof(size_t));
+        memmove(model->values + position, model->values + position + 1, (last - position) * sizeof(uintptr_t));
+    } else {
+        model->keys[position] = model->keys[last];
+        model->values[position] = model->values[last];
+    }
+    model->count--;
+}
+
+// Compares the dense arrays, lookups and positions with the model.
+static BOOL dictionaryMatches(const fs_dictionary_t *dict, const dictionaryModel *model) {
+    if (dict->count != model->count) {
+        return NO;
+    }
+    for (size_t i = 0; i < model->count; ++i) {
+        const dictionaryKey *key = &dictionaryVocabulary[model->keys[i]];
+        const fs_string_t *stored = fs_dict_key_at(dict, i);
+        void *value = NULL;
+        if (stored->len != key->length || memcmp(stored->utf8_ptr, key->bytes, key->length) != 0 ||
+            (uintptr_t)fs_dict_value_at(dict, i) != model->values[i] ||
+            fs_dict_position(dict, key->bytes, key->length) != i || !fs_dict_find(dict, key->bytes, key->length, &value) ||
+            (uintptr_t)value != model->values[i]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static BOOL dictionaryRun(uint32_t options, size_t capacity, int steps) {
+    dictionaryModel *model = calloc(1, sizeof(dictionaryModel));
+    BOOL ordered = (options & FS_DICT_ORDERED) != 0, ok = YES;
+    fs_dictionary_t dict;
+    uintptr_t next = 1;
+    ok = fs_dict_init(&dict, capacity, options) == FS_ERROR_NONE;
+    
+    for (int step = 0; step < steps && ok; ++step) {
+        // A working set that drifts through the vocabulary, so removals leave tombstones behind.
+        size_t window = 64 + (size_t)step / 40 % (DICTIONARY_KEYS - 64);
+        size_t k = dictionaryRandom(window), op = dictionaryRandom(100);
+        const dictionaryKey *key = &dictionaryVocabulary[k];
+        size_t position = dictionaryModelFind(model, k);
+        if (op < 55) {
+            ok = fs_dict_set(&dict, key->bytes, key->length, (void *)next) == FS_ERROR_NONE;
+            if (position == SIZE_MAX) {
+                position = model->count++;
+                model->keys[position] = k;
+            }
+            model->values[position] = next++;
+        } else if (op < 95) {
+            void *value = NULL;
+            BOOL removed = fs_dict_remove(&dict, key->bytes, key->length, &value);
+            ok = removed == (position != SIZE_MAX);
+            if (ok && removed) {
+                ok = (uintptr_t)value == model->values[position];
+                dictionaryModelRemove(model, position, ordered);
+            }
+        } else if (op < 99) {
+            ok = fs_dict_find(&dict, key->bytes, key->length, NULL) == (position != SIZE_MAX);
+        } else if (dictionaryRandom(10) == 0) {
+            fs_dict_clear(&dict);
+            model->count = 0;
+        } else {
+            ok = fs_dict_reserve(&dict, model->count + dictionaryRandom(200)) == FS_ERROR_NONE;
+        }
+        ok = ok && (step % 7 != 0 || dictionaryMatches(&dict, model));
+    }
+    ok = ok && dictionaryMatches(&dict, model);
+    
+    fs_dict_free(&dict);
+    free(model);
+    return ok;
+}
+
+@interface dictionaryTests : XCTestCase
+
+@end
+
+@implementation dictionaryTests
+
+- (void)setUp {
+    dictionaryMakeVocabulary();
+}
+
+- (void)testUnorderedDictionaryMatchesModel {
+    XCTAssertTrue(dictionaryRun(0, 0, 60000));
+    XCTAssertTrue(dictionaryRun(0, 1000, 20000));
+}
+
+- (void)testOrderedDictionaryMatchesModel {
+    // Ordered removal renumbers every slot after the removed entry.
+    XCTAssertTrue(dictionaryRun(FS_DICT_ORDERED, 0, 60000));
+    XCTAssertTrue(dictionaryRun(FS_DICT_ORDERED, 16, 20000));
+}
+
+- (void)testBorrowedKeysMatchModel {
+    // The vocabulary outlives every dictionary, as borrowed keys must.
+    XCTAssertTrue(dictionaryRun(FS_DICT_BORROW_KEYS, 0, 30000));
+    XCTAssertTrue(dictionaryRun(FS_DICT_ORDERED | FS_DICT_BORROW_KEYS, 0, 30000));
+}
+
+- (void)testZeroedDictionaryIndexesOnFirstSet {
+    fs_dictionary_t dict;
+    memset(&dict, 0, sizeof(dict));
+    XCTAssertFalse(fs_dict_find(&dict, "a", 1, NULL));
+    XCTAssertFalse(fs_dict_remove(&dict, "a", 1, NULL));
+    XCTAssertEqual(fs_dict_position(&dict, "a", 1), (size_t)SIZE_MAX);
+    
+    XCTAssertEqual(fs_dict_set(&dict, "a", 1, (void *)1), FS_ERROR_NONE);
+    XCTAssertEqual(fs_dict_set(&dict, "", 0, (void *)2), FS_ERROR_NONE);
+    XCTAssertEqual(fs_dict_set(&dict, "a", 1, (void *)3), FS_ERROR_NONE);
+    void *value = NULL;
+    XCTAssertEqual(dict.count, (size_t)2);
+    XCTAssertTrue(fs_dict_find(&dict, "a", 1, &value));
+    XCTAssertEqual((uintptr_t)value, (uintptr_t)3);
+    XCTAssertTrue(fs_dict_find(&dict, NULL, 0, &value));
+    XCTAssertEqual((uintptr_t)value, (uintptr_t)2);
+    
+    XCTAssertEqual(fs_dict_set(&dict, NULL, 1, NULL), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_dict_init(NULL, 0, 0), FS_ERROR_INVALID_ARGUMENT);
+    fs_dict_free(&dict);
+}
+
+@end
@@ -0,0 +1,224 @@
+//
+//  diffMergeTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+
+/*
+ Line diff and three-way merge on ropes.
+
+ The randomized cases apply the hunks of every diff to the old text and
+ expect the new one, and check the merge identities: merging a change with
+ no change, or with itself, gives the change.
+ */
+
+static uint64_t diffRandomState = 0x2545f4914f6cdd1dull;
+
+static uint32_t diffRandom(uint32_t bound) {
+    return (uint32_t)fsTestRandom(&diffRandomState, bound);
+}
+
+static fs_rope_t *diffRope(NSString *text) {
+    fs_rope_t *rope = NULL;
+    NSData *data = [text dataUsingEncoding:NSUTF8StringEncoding];
+    fs_rope_create(data.bytes, data.length, &rope);
+    return rope;
+}
+
+static NSString *diffText(const fs_rope_t *rope) {
+    char *bytes = fsTestRopeString(rope);
+    NSString *text = @(bytes);
+    free(bytes);
+    return text;
+}
+
+/// Splits into lines that keep their '\n'; the last one may be empty.
+static NSArray<NSString *> *diffLines(NSString *text) {
+    NSMutableArray<NSString *> *lines = [NSMutableArray array];
+    NSUInteger start = 0;
+    for (NSUInteger i = 0; i < text.length; ++i) {
+        if ([text characterAtIndex:i] == '\n') {
+            [lines addObject:[text substringWithRange:NSMakeRange(start, i + 1 - start)]];
+            start = i + 1;
+        }
+    }
+    [lines addObject:[text substringFromIndex:start]];
+    return lines;
+}
+
+static NSString *diffRandomText(NSUInteger lines, uint32_t vocabulary) {
+    NSMutableString *text = [NSMutableString string];
+    for (NSUInteger i = 0; i < lines; ++i) {
+        [text appendFormat:@"line %u\n", diffRandom(vocabulary)];
+    }
+    return text;
+}
+
+static NSString *diffRandomEdit(NSString *text, uint32_t vocabulary) {
+    NSMutableString *edited = [NSMutableString string];
+    for (NSString *line in diffLines(text)) {
+        uint32_t roll = diffRandom(10);
+        if (roll < 6) {
+            [edited appendString:line];
+        } else if (roll < 8) {
+            [edited appendFormat:@"new %u\n", diffRandom(vocabulary)];
+            [edited appendString:line];
+        }
+    }
+    return edited;
+}
+
+@interface diffMergeTests : XCTestCase
+
+@end
+
+@implementation diffMergeTests
+
+- (NSString *)apply:(NSString *)old to:(NSString *)changed {
+    fs_rope_t *a = diffRope(old), *b = diffRope(changed);
+    fs_diff_hunk_t *hunks = NULL;
+    size_t count = 0, next = 0;
+    NSArray<NSString *> *oldLines = diffLines(old), *newLines = diffLines(changed);
+    NSMutableString *result = [NSMutableString string];
+    
+    XCTAssertEqual(fs_diff_lines(a, b, NULL, &hunks, &count), FS_ERROR_NONE);
+    for (size_t i = 0; i < count; ++i) {
+        XCTAssertGreaterThanOrEqual(hunks[i].a_start, next);
+        for (size_t line = next; line < hunks[i].a_start; ++line) {
+            [result appendString:oldLines[line]];
+        }
+        for (size_t line = hunks[i].b_start; line < hunks[i].b_start + hunks[i].b_count; ++line) {
+            [result appendString:newLines[line]];
+        }
+        next = hunks[i].a_start + hunks[i].a_count;
+    }
+    for (size_t line = next; line < oldLines.count; ++line) {
+        [result appendString:oldLines[line]];
+    }
+    free(hunks);
+    fs_rope_destroy(a);
+    fs_rope_destroy(b);
+    return result;
+}
+
+- (NSString *)merge:(NSString *)base ours:(NSString *)ours theirs:(NSString *)theirs conflicts:(size_t *)conflicts {
+    fs_rope_t *b = diffRope(base), *o = diffRope(ours), *t = diffRope(theirs), *merged = NULL;
+    XCTAssertEqual(fs_merge3(b, o, t, NULL, FS_MERGE_KEEP_BOTH, &merged, conflicts), FS_ERROR_NONE);
+    NSString *text = diffText(merged);
+    fs_rope_destroy(merged);
+    fs_rope_destroy(b);
+    fs_rope_destroy(o);
+    fs_rope_destroy(t);
+    return text;
+}
+
+- (void)testLinesWithPermutedStripesDiffer {
+    // A long line and the same line with two 32-byte stripes swapped: same length, same bytes.
+    NSMutableString *line = [NSMutableString string];
+    for (int i = 0; i < 1100; ++i) {
+        [line appendFormat:@"%c", 'a' + diffRandom(26)];
+    }
+    NSMutableString *swapped = [line mutableCopy];
+    NSString *stripe = [line substringWithRange:NSMakeRange(3 * 32, 32)];
+    [swapped replaceCharactersInRange:NSMakeRange(3 * 32, 32) withString:[line substringWithRange:NSMakeRange(11 * 32, 32)]];
+    [swapped replaceCharactersInRange:NSMakeRange(11 * 32, 32) withString:stripe];
+    
+    NSString *base = [NSString stringWithFormat:@"head\n%@\ntail\n", line];
+    NSString *theirs = [NSString stringWithFormat:@"head\n%@\ntail\n", swapped];
+    fs_rope_t *a = diffRope(base), *b = diffRope(theirs);
+    fs_diff_hunk_t *hunks = NULL;
+    size_t count = 0, conflicts = 1;
+    
+    XCTAssertEqual(fs_diff_lines(a, b, NULL, &hunks, &count), FS_ERROR_NONE);
+    XCTAssertEqual(count, (size_t)1);
+    if (count == 1) {
+        XCTAssertEqual(hunks[0].a_start, (size_t)1);
+        XCTAssertEqual(hunks[0].a_count, (size_t)1);
+        XCTAssertEqual(hunks[0].b_count, (size_t)1);
+    }
+    free(hunks);
+    fs_rope_destroy(a);
+    fs_rope_destroy(b);
+    
+    XCTAssertEqualObjects([self merge:base ours:base theirs:theirs conflicts:&conflicts], theirs);
+    XCTAssertEqual(conflicts, (size_t)0);
+}
+
+- (void)testEqualTextsHaveNoHunks {
+    fs_rope_t *a = diffRope(@"one\ntwo\n"), *b = diffRope(@"one\ntwo\n");
+    fs_diff_hunk_t *hunks = NULL;
+    size_t count = 1;
+    XCTAssertEqual(fs_diff_lines(a, b, NULL, &hunks, &count), FS_ERROR_NONE);
+    XCTAssertEqual(count, (size_t)0);
+    XCTAssertTrue(hunks == NULL);
+    fs_rope_destroy(a);
+    fs_rope_destroy(b);
+}
+
+- (void)testRandomDiffsApply {
+    for (int round = 0; round < 500; ++round) {
+        uint32_t vocabulary = 1 + diffRandom(20);
+        NSString *old = diffRandomText(1 + diffRandom(80), vocabulary);
+        NSString *changed = diffRandom(8) ? diffRandomEdit(old, vocabulary) : diffRandomText(diffRandom(80), vocabulary);
+        XCTAssertEqualObjects([self apply:old to:changed], changed, @"round %d", round);
+    }
+}
+
+- (void)testRandomMergeIdentities {
+    for (int round = 0; round < 300; ++round) {
+        uint32_t vocabulary = 1 + diffRandom(20);
+        NSString *base = diffRandomText(1 + diffRandom(60), vocabulary);
+        NSString *edit = diffRandomEdit(base, vocabulary);
+        size_t conflicts = 1;
+        
+        XCTAssertEqualObjects([self merge:base ours:edit theirs:base conflicts:&conflicts], edit);
+        XCTAssertEqual(conflicts, (size_t)0);
+        XCTAssertEqualObjects([self merge:base ours:base theirs:edit conflicts:&conflicts], edit);
+        XCTAssertEqual(conflicts, (size_t)0);
+        XCTAssertEqualObjects([self merge:base ours:edit theirs:edit conflicts:&conflicts], edit);
+        XCTAssertEqual(conflicts, (size_t)0);
+    }
+}
+
+- (void)testDisjointEditsMergeCleanly {
+    NSString *base = @"a\nb\nc\nd\ne\nf\n";
+    size_t conflicts = 1;
+    NSString *merged = [self merge:base ours:@"A\nb\nc\nd\ne\nf\n" theirs:@"a\nb\nc\nd\ne\nF\n" conflicts:&conflicts];
+    XCTAssertEqualObjects(merged, @"A\nb\nc\nd\ne\nF\n");
+    XCTAssertEqual(conflicts, (size_t)0);
+    
+    merged = [self merge:base ours:@"a\nb\nX\nd\ne\nf\n" theirs:@"a\nb\nY\nd\ne\nf\n" conflicts:&conflicts];
+    XCTAssertEqualObjects(merged, @"a\nb\nX\nY\nd\ne\nf\n");
+    XCTAssertEqual(conflicts, (size_t)1);
+}
+
+@end
@@ -0,0 +1,145 @@
+//
+//  fsTestSupport.h
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef FS_TEST_SUPPORT_H
+#define FS_TEST_SUPPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fs/rtc.h>
+
+/*
+ Helpers shared by the model-based test cases.
+
+ Each case seeds its own generator state, so a failing run replays the same
+ way whatever the other cases do.
+ */
+
+/* Advances a xorshift64 generator and returns its new state. */
+static inline uint64_t fsTestRandomNext(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* A value in [0, bound), or 0 when `bound` is 0. */
+static inline size_t fsTestRandom(uint64_t *state, size_t bound) {
+    uint64_t value = fsTestRandomNext(state);
+    return bound ? (size_t)((value >> 11) % bound) : 0;
+}
+
+/* A flat copy of a document, edited alongside the structure under test. */
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+} fsTestText;
+
+static inline void fsTestTextInsert(fsTestText *text, size_t position, const void *bytes, size_t length) {
+    memmove(text->bytes + position + length, text->bytes + position, text->length - position);
+    memcpy(text->bytes + position, bytes, length);
+    text->length += length;
+}
+
+static inline void fsTestTextDelete(fsTestText *text, size_t position, size_t length) {
+    memmove(text->bytes + position, text->bytes + position + length, text->length - position - length);
+    text->length -= length;
+}
+
+/* Whether `rope` holds exactly `length` bytes equal to `bytes`. */
+static inline bool fsTestRopeMatches(const fs_rope_t *rope, const void *bytes, size_t length) {
+    if (fs_rope_length(rope) != length) {
+        return false;
+    }
+    
+    fs_rope_iter_t iter;
+    const unsigned char *run;
+    size_t runLength, at = 0;
+    fs_rope_iter_init(&iter, rope, 0, length);
+    while (fs_rope_iter_next(&iter, &run, &runLength)) {
+        if (at + runLength > length || memcmp(run, (const uint8_t *)bytes + at, runLength) != 0) {
+            return false;
+        }
+        at += runLength;
+    }
+    return at == length;
+}
+
+/* The contents of `rope` as a NUL-terminated string; free() it. */
+static inline char *fsTestRopeString(const fs_rope_t *rope) {
+    size_t length = fs_rope_length(rope);
+    char *string = malloc(length + 1);
+    fs_rope_copy(rope, 0, string, length);
+    string[length] = 0;
+    return string;
+}
+
+/*
+ Where fsTestMirrorRange() replays the ranges a remote operation changed:
+ into `text`, into `rope`, or both. Inserted ranges consume `insert` in order.
+ */
+typedef struct {
+    fsTestText *text;
+    fs_rope_t *rope;
+    const uint8_t *insert;
+    bool delete;
+    fs_error_t error;
+} fsTestMirror;
+
+/* An fs_crdt_range_handler_t for fs_crdt_apply(); the context is an fsTestMirror. */
+static inline void fsTestMirrorRange(void *context, size_t position, size_t length) {
+    fsTestMirror *mirror = context;
+    fs_error_t error = FS_ERROR_NONE;
+    if (mirror->delete) {
+        if (mirror->text) {
+            fsTestTextDelete(mirror->text, position, length);
+        }
+        if (mirror->rope) {
+            error = fs_rope_delete(mirror->rope, position, length);
+        }
+    } else {
+        if (mirror->text) {
+            fsTestTextInsert(mirror->text, position, mirror->insert, length);
+        }
+        if (mirror->rope) {
+            error = fs_rope_insert(mirror->rope, position, mirror->insert, length);
+        }
+        mirror->insert += length;
+    }
+    if (error != FS_ERROR_NONE) {
+        mirror->error = error;
+    }
+}
+
+#endif /* FS_TEST_SUPPORT_H */
@@ -0,0 +1,170 @@
+//
+//  fslogTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/fslog.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ Per-thread log rings.
+
+ A test sink records what the drain hands it. Threads log numbered messages
+ concurrently; every message must arrive once, in order per thread, unless
+ it was counted as dropped.
+ */
+
+#define FSLOG_THREADS 8
+#define FSLOG_MESSAGES 5000
+
+typedef struct {
+    uint64_t received;
+    uint64_t outOfOrder;
+    unsigned next[FSLOG_THREADS];
+    fs_log_record_t last;
+    char lastMessage[FS_LOG_MESSAGE_MAX + 1];
+} fslogSeen;
+
+static fslogSeen fslogSink;
+
+static void fslogRecord(void *context, const fs_log_record_t *record) {
+    fslogSeen *seen = context;
+    unsigned thread, index;
+    if (strcmp(record->category, "fslogTests") != 0) {
+        return;
+    }
+    seen->received++;
+    seen->last = *record;
+    memcpy(seen->lastMessage, record->message, record->length + 1);
+    seen->last.message = seen->lastMessage;
+    if (sscanf(record->message, "thread %u message %u", &thread, &index) == 2 && thread < FSLOG_THREADS) {
+        if (index < seen->next[thread]) {
+            seen->outOfOrder++;
+        }
+        seen->next[thread] = index + 1;
+    }
+}
+
+static void *fslogWorker(void *argument) {
+    unsigned thread = (unsigned)(uintptr_t)argument;
+    for (unsigned i = 0; i < FSLOG_MESSAGES; ++i) {
+        fs_log(FS_LOG_INFO_LEVEL, "fslogTests", "thread %u message %u of %s", thread, i, "the benchmark document");
+    }
+    return NULL;
+}
+
+@interface fslogTests : XCTestCase
+
+@end
+
+@implementation fslogTests
+
+- (void)setUp {
+    memset(&fslogSink, 0, sizeof(fslogSink));
+    fs_log_set_level(FS_LOG_DEBUG_LEVEL);
+    fs_log_set_sink(fslogRecord, &fslogSink);
+}
+
+- (void)tearDown {
+    fs_log_flush();
+    fs_log_set_sink(NULL, NULL);
+    fs_log_set_level(FS_LOG_DEBUG_LEVEL);
+}
+
+- (void)testMessagesArriveOnceInOrderPerThread {
+    uint64_t dropped = fs_log_dropped();
+    for (int round = 0; round < 3; ++round) {
+        // Rings of finished threads are taken over by new ones.
+        pthread_t threads[FSLOG_THREADS];
+        memset(fslogSink.next, 0, sizeof(fslogSink.next));
+        for (uintptr_t t = 0; t < FSLOG_THREADS; ++t) {
+            pthread_create(&threads[t], NULL, fslogWorker, (void *)t);
+        }
+        for (int t = 0; t < FSLOG_THREADS; ++t) {
+            pthread_join(threads[t], NULL);
+        }
+        fs_log_flush();
+    }
+    XCTAssertEqual(fslogSink.received + (fs_log_dropped() - dropped), (uint64_t)(3 * FSLOG_THREADS * FSLOG_MESSAGES));
+    XCTAssertEqual(fslogSink.outOfOrder, (uint64_t)0);
+}
+
+- (void)testFlushDeliversRecordFields {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t before = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    fs_log(FS_LOG_ERROR_LEVEL, "fslogTests", "parsed %d elements of %s", 42, "config.xml");
+    fs_log_flush();
+    
+    XCTAssertEqual(fslogSink.received, (uint64_t)1);
+    XCTAssertEqual(fslogSink.last.level, FS_LOG_ERROR_LEVEL);
+    XCTAssertEqualObjects(@(fslogSink.last.message), @"parsed 42 elements of config.xml");
+    XCTAssertEqual(fslogSink.last.length, strlen("parsed 42 elements of config.xml"));
+    XCTAssertGreaterThanOrEqual(fslogSink.last.time_ns + 1000000, before);
+}
+
+- (void)testLongMessagesAreTruncated {
+    char message[1000];
+    memset(message, 'a', sizeof(message) - 1);
+    message[sizeof(message) - 1] = 0;
+    fs_log_message(FS_LOG_INFO_LEVEL, "fslogTests", message);
+    fs_log_flush();
+    XCTAssertEqual(fslogSink.received, (uint64_t)1);
+    XCTAssertEqual(fslogSink.last.length, (size_t)FS_LOG_MESSAGE_MAX);
+    XCTAssertEqual(strlen(fslogSink.last.message), (size_t)FS_LOG_MESSAGE_MAX);
+}
+
+- (void)testRuntimeLevel {
+    fs_log_set_level(FS_LOG_ERROR_LEVEL);
+    XCTAssertFalse(fs_log_enabled(FS_LOG_INFO_LEVEL));
+    XCTAssertTrue(fs_log_enabled(FS_LOG_ERROR_LEVEL));
+    fs_log(FS_LOG_INFO_LEVEL, "fslogTests", "ignored");
+    fs_log(FS_LOG_ERROR_LEVEL, "fslogTests", "kept");
+    fs_log_flush();
+    XCTAssertEqual(fslogSink.received, (uint64_t)1);
+    XCTAssertEqualObjects(@(fslogSink.last.message), @"kept");
+    
+    fs_log_set_level(FS_LOG_OFF_LEVEL);
+    XCTAssertFalse(fs_log_enabled(FS_LOG_ERROR_LEVEL));
+    FS_LOG_ERROR("fslogTests", "off");
+    fs_log_flush();
+    XCTAssertEqual(fslogSink.received, (uint64_t)1);
+}
+
+- (void)testSignpostsPairUp {
+    fs_signpost_id_t outer = fs_signpost_begin(FS_SIGNPOST_SYNC);
+    fs_signpost_id_t inner = fs_signpost_begin(FS_SIGNPOST_SYNC);
+    XCTAssertTrue(outer == 0 || outer != inner);
+    fs_signpost_end(FS_SIGNPOST_SYNC, inner);
+    fs_signpost_end(FS_SIGNPOST_SYNC, outer);
+}
+
+@end
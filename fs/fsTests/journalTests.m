@@ -0,0 +1,298 @@
+//
+//  journalTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/journal.h>
+#import "fsTestSupport.h"
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ Append-only record journals.
+
+ Records of random sizes are appended in groups and read back. Crashes are
+ played by cutting the file inside its last record and by flipping bytes;
+ readers must stop at the last intact record, and the next append must
+ continue from there.
+ */
+
+#define JOURNAL_FORMAT 0x54534554u /* "TEST" */
+#define JOURNAL_RECORDS 64
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    uint32_t type;
+} journalRecord;
+
+static uint64_t journalRandomState = 0x1f83d9abfb41bd6bull;
+
+static size_t journalRandom(size_t bound) {
+    return fsTestRandom(&journalRandomState, bound);
+}
+
+static journalRecord journalMakeRecord(size_t maxLength) {
+    journalRecord record = { NULL, journalRandom(maxLength + 1), 1 + (uint32_t)journalRandom(8) };
+    record.bytes = malloc(record.length + 1);
+    for (size_t i = 0; i < record.length; ++i) {
+        record.bytes[i] = (uint8_t)journalRandom(256);
+    }
+    return record;
+}
+
+// Encodes `records` after an optional file header; the caller frees the result.
+static uint8_t *journalEncode(const journalRecord *records, size_t count, BOOL header, size_t *length) {
+    size_t total = header ? FS_JOURNAL_HEADER_SIZE : 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += fs_journal_record_size(records[i].length);
+    }
+    uint8_t *bytes = malloc(total + 1), *at = bytes;
+    if (header) {
+        fs_journal_write_header(at, JOURNAL_FORMAT, 0x0123456789abcdefull);
+        at += FS_JOURNAL_HEADER_SIZE;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        // Records are split into two parts; the payload is their concatenation.
+        size_t split = journalRandom(records[i].length + 1);
+        fs_buffer_t parts[2] = { { records[i].bytes, split }, { records[i].bytes + split, records[i].length - split } };
+        at += fs_journal_write_record(at, records[i].type, parts, 2);
+    }
+    *length = total;
+    return bytes;
+}
+
+static uint8_t *journalReadFile(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *bytes = malloc(*length + 1);
+    if (fread(bytes, 1, *length, file) != *length) {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(file);
+    return bytes;
+}
+
+// Reads `journal` and returns how many leading entries of `records` it holds; `end` receives where they end.
+static size_t journalReplay(const uint8_t *bytes, size_t length, const journalRecord *records, size_t count, size_t *end) {
+    fs_buffer_t journal = { (void *)bytes, length };
+    fs_journal_record_t record;
+    size_t offset, matched = 0;
+    if (fs_journal_begin(journal, JOURNAL_FORMAT, NULL, &offset) != FS_ERROR_NONE) {
+        return SIZE_MAX;
+    }
+    while (fs_journal_next(journal, &offset, &record)) {
+        if (matched == count || record.type != records[matched].type || record.len != records[matched].length ||
+            memcmp(record.payload, records[matched].bytes, record.len) != 0) {
+            return SIZE_MAX;
+        }
+        matched++;
+    }
+    *end = offset;
+    return matched;
+}
+
+@interface journalTests : XCTestCase
+
+@end
+
+@implementation journalTests {
+    char _directory[512];
+    char _path[600];
+    journalRecord _records[JOURNAL_RECORDS];
+    size_t _count;
+}
+
+- (void)setUp {
+    const char *temp = getenv("TMPDIR");
+    snprintf(_directory, sizeof(_directory), "%s/journalTests.XXXXXX", temp && *temp ? temp : "/tmp");
+    XCTAssertTrue(mkdtemp(_directory) != NULL);
+    snprintf(_path, sizeof(_path), "%s/doc.journal", _directory);
+    _count = 0;
+}
+
+- (void)tearDown {
+    for (size_t i = 0; i < _count; ++i) {
+        free(_records[i].bytes);
+    }
+    unlink(_path);
+    rmdir(_directory);
+}
+
+- (void)testGroupsAppendAndReadBack {
+    size_t length, end = 0;
+    uint8_t *bytes = journalEncode(NULL, 0, YES, &length);
+    XCTAssertEqual(fs_journal_rewrite(_path, bytes, length), FS_ERROR_NONE);
+    free(bytes);
+    end = length;
+    
+    while (_count < JOURNAL_RECORDS) {
+        size_t group = 1 + journalRandom(5);
+        group = _count + group > JOURNAL_RECORDS ? JOURNAL_RECORDS - _count : group;
+        for (size_t i = 0; i < group; ++i) {
+            _records[_count + i] = journalMakeRecord(journalRandom(4) ? 100 : 20000);
+        }
+        bytes = journalEncode(_records + _count, group, NO, &length);
+        XCTAssertEqual(fs_journal_append(_path, end, bytes, length), FS_ERROR_NONE);
+        free(bytes);
+        _count += group;
+        
+        uint8_t *file = journalReadFile(_path, &length);
+        XCTAssertEqual(journalReplay(file, length, _records, _count, &end), _count);
+        XCTAssertEqual(end, length);
+        free(file);
+    }
+    
+    uint64_t user = 0;
+    size_t offset;
+    uint8_t *file = journalReadFile(_path, &length);
+    XCTAssertEqual(fs_journal_begin((fs_buffer_t){ file, length }, JOURNAL_FORMAT, &user, &offset), FS_ERROR_NONE);
+    XCTAssertEqual(user, 0x0123456789abcdefull);
+    XCTAssertEqual(offset, (size_t)FS_JOURNAL_HEADER_SIZE);
+    free(file);
+}
+
+- (void)testTornTailIsCutOnNextAppend {
+    size_t length, end;
+    for (_count = 0; _count < 6; ++_count) {
+        _records[_count] = journalMakeRecord(300);
+    }
+    uint8_t *whole = journalEncode(_records, _count, YES, &length);
+    size_t lastStart = length - fs_journal_record_size(_records[_count - 1].length);
+    
+    // Every cut inside the last record leaves the first five readable.
+    for (size_t cut = lastStart; cut < length; ++cut) {
+        XCTAssertEqual(journalReplay(whole, cut, _records, _count, &end), _count - 1, @"cut at %zu", cut);
+        XCTAssertEqual(end, lastStart);
+    }
+    
+    // Cut the file short, then append: the torn bytes are replaced.
+    size_t cut = lastStart + 1 + journalRandom(length - lastStart - 1);
+    XCTAssertEqual(fs_journal_rewrite(_path, whole, cut), FS_ERROR_NONE);
+    uint8_t *file = journalReadFile(_path, &length);
+    XCTAssertEqual(journalReplay(file, length, _records, _count, &end), _count - 1);
+    free(file);
+    
+    free(_records[_count - 1].bytes);
+    _records[_count - 1] = journalMakeRecord(50);
+    uint8_t *bytes = journalEncode(_records + _count - 1, 1, NO, &length);
+    XCTAssertEqual(fs_journal_append(_path, end, bytes, length), FS_ERROR_NONE);
+    free(bytes);
+    
+    file = journalReadFile(_path, &length);
+    XCTAssertEqual(journalReplay(file, length, _records, _count, &end), _count);
+    XCTAssertEqual(end, length);
+    free(file);
+    free(whole);
+}
+
+- (void)testFlippedBytesStopTheReader {
+    size_t length, end;
+    for (_count = 0; _count < 4; ++_count) {
+        _records[_count] = journalMakeRecord(64);
+    }
+    uint8_t *bytes = journalEncode(_records, _count, YES, &length);
+    size_t start = FS_JOURNAL_HEADER_SIZE;
+    for (size_t i = 0; i < _count; ++i) {
+        size_t size = fs_journal_record_size(_records[i].length);
+        // Any single flipped bit in a record, header or payload, ends the journal before it.
+        for (size_t at = start; at < start + size; ++at) {
+            uint8_t bit = (uint8_t)(1u << journalRandom(8));
+            bytes[at] ^= bit;
+            XCTAssertEqual(journalReplay(bytes, length, _records, _count, &end), i, @"byte %zu", at);
+            XCTAssertEqual(end, start);
+            bytes[at] ^= bit;
+        }
+        start += size;
+    }
+    free(bytes);
+}
+
+- (void)testRewriteReplacesTheFile {
+    size_t length, end;
+    for (_count = 0; _count < 8; ++_count) {
+        _records[_count] = journalMakeRecord(500);
+    }
+    uint8_t *bytes = journalEncode(_records, _count, YES, &length);
+    XCTAssertEqual(fs_journal_rewrite(_path, bytes, length), FS_ERROR_NONE);
+    size_t longLength = length;
+    free(bytes);
+    
+    // Compaction to the first two records goes through a temporary file and rename.
+    bytes = journalEncode(_records, 2, YES, &length);
+    XCTAssertEqual(fs_journal_rewrite(_path, bytes, length), FS_ERROR_NONE);
+    free(bytes);
+    uint8_t *file = journalReadFile(_path, &length);
+    XCTAssertEqual(journalReplay(file, length, _records, _count, &end), (size_t)2);
+    XCTAssertEqual(end, length);
+    free(file);
+    
+    DIR *directory = opendir(_directory);
+    struct dirent *entry;
+    size_t files = 0;
+    while ((entry = readdir(directory)) != NULL) {
+        files += entry->d_name[0] != '.';
+    }
+    closedir(directory);
+    XCTAssertEqual(files, (size_t)1);
+    
+    // An append that expects the old, longer file is refused rather than writing past the new end.
+    uint8_t record[64];
+    XCTAssertEqual(fs_journal_append(_path, longLength, record, sizeof(record)), FS_ERROR_INVALID_ARGUMENT);
+    
+    char missing[700];
+    snprintf(missing, sizeof(missing), "%s/missing.journal", _directory);
+    XCTAssertEqual(fs_journal_append(missing, FS_JOURNAL_HEADER_SIZE, record, 0), FS_ERROR_NOT_FOUND);
+    XCTAssertEqual(fs_journal_append(_path, 4, record, 0), FS_ERROR_INVALID_ARGUMENT);
+}
+
+- (void)testForeignHeadersAreNotSupported {
+    uint8_t header[FS_JOURNAL_HEADER_SIZE];
+    size_t offset;
+    fs_journal_write_header(header, JOURNAL_FORMAT, 0);
+    XCTAssertEqual(fs_journal_begin((fs_buffer_t){ header, sizeof(header) }, JOURNAL_FORMAT + 1, NULL, &offset),
+                   FS_ERROR_NOT_SUPPORTED);
+    XCTAssertEqual(fs_journal_begin((fs_buffer_t){ header, sizeof(header) - 1 }, JOURNAL_FORMAT, NULL, &offset),
+                   FS_ERROR_NOT_SUPPORTED);
+    header[0] ^= 1;
+    XCTAssertEqual(fs_journal_begin((fs_buffer_t){ header, sizeof(header) }, JOURNAL_FORMAT, NULL, &offset),
+                   FS_ERROR_NOT_SUPPORTED);
+    XCTAssertEqual(fs_journal_begin((fs_buffer_t){ NULL, 0 }, JOURNAL_FORMAT, NULL, &offset), FS_ERROR_NOT_SUPPORTED);
+}
+
+@end
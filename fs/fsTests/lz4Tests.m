@@ -0,0 +1,179 @@
+//
+//  lz4Tests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/compress.h>
+#import "fsTestSupport.h"
+
+/*
+ LZ4 block compression.
+
+ Round trips over short, repetitive, random and uniform inputs, blocks
+ written by hand in the LZ4 format, and damaged blocks, which must be
+ rejected without touching memory outside the buffers.
+ */
+
+static uint64_t lz4RandomState = 0xbb67ae8584caa73bull;
+
+static uint64_t lz4Random(void) {
+    return fsTestRandomNext(&lz4RandomState);
+}
+
+// Words of an SVG-like drawing, repeated in random order.
+static uint8_t *lz4Drawing(size_t length) {
+    static const char *words[] = { "the ", "stroke ", "canvas ", "layer ", "<path d=\"M10 20\"/>", "0.5,", "1.25," };
+    uint8_t *bytes = malloc(length + 1);
+    for (size_t i = 0; i < length;) {
+        const char *word = words[lz4Random() % 7];
+        size_t n = strlen(word) < length - i ? strlen(word) : length - i;
+        memcpy(bytes + i, word, n);
+        i += n;
+    }
+    return bytes;
+}
+
+// Compresses and decompresses `bytes`; returns the compressed length, or 0 if the round trip failed.
+static size_t lz4RoundTrip(const uint8_t *bytes, size_t length) {
+    size_t capacity = fs_compress_bound(length), compressedLength, decompressedLength, tooSmall;
+    uint8_t *compressed = malloc(capacity), *decompressed = malloc(length + 1);
+    BOOL ok = fs_compress(bytes, length, compressed, capacity, &compressedLength) == FS_ERROR_NONE &&
+              compressedLength <= capacity &&
+              fs_decompress(compressed, compressedLength, decompressed, length, &decompressedLength) == FS_ERROR_NONE &&
+              decompressedLength == length && (!length || memcmp(decompressed, bytes, length) == 0);
+    
+    // One byte short of room is refused, on both sides.
+    if (ok && compressedLength > 1) {
+        ok = fs_compress(bytes, length, compressed, compressedLength - 1, &tooSmall) == FS_ERROR_INVALID_ARGUMENT;
+    }
+    if (ok && length) {
+        ok = fs_decompress(compressed, compressedLength, decompressed, length - 1, &tooSmall) == FS_ERROR_INVALID_ARGUMENT;
+    }
+    free(compressed);
+    free(decompressed);
+    return ok ? compressedLength : 0;
+}
+
+@interface lz4Tests : XCTestCase
+
+@end
+
+@implementation lz4Tests
+
+- (void)testShortInputsRoundTrip {
+    uint8_t bytes[300];
+    for (size_t length = 0; length < sizeof(bytes); ++length) {
+        for (size_t i = 0; i < length; ++i) {
+            bytes[i] = lz4Random() % 4 ? (uint8_t)('a' + lz4Random() % 3) : (uint8_t)lz4Random();
+        }
+        XCTAssertNotEqual(lz4RoundTrip(bytes, length), (size_t)0, @"length %zu", length);
+    }
+}
+
+- (void)testLargeInputsRoundTrip {
+    size_t length = 8 << 20;
+    uint8_t *drawing = lz4Drawing(length);
+    for (int i = 0; i < 40; ++i) {
+        size_t offset = lz4Random() % (length - 300000), n = lz4Random() % 300000;
+        XCTAssertNotEqual(lz4RoundTrip(drawing + offset, n), (size_t)0, @"offset %zu length %zu", offset, n);
+    }
+    // Repetitive text compresses well.
+    size_t compressed = lz4RoundTrip(drawing, length);
+    XCTAssertNotEqual(compressed, (size_t)0);
+    XCTAssertLessThan(compressed * 2, length);
+    free(drawing);
+    
+    uint8_t *noise = malloc(1 << 20);
+    for (size_t i = 0; i < (1 << 20); ++i) {
+        noise[i] = (uint8_t)(lz4Random() >> 56);
+    }
+    // Incompressible bytes stay within the bound; zeros shrink to almost nothing.
+    XCTAssertNotEqual(lz4RoundTrip(noise, 1 << 20), (size_t)0);
+    memset(noise, 0, 1 << 20);
+    compressed = lz4RoundTrip(noise, 1 << 20);
+    XCTAssertNotEqual(compressed, (size_t)0);
+    XCTAssertLessThan(compressed, (size_t)(8 << 10));
+    free(noise);
+}
+
+- (void)testHandWrittenBlocks {
+    uint8_t out[64];
+    size_t length;
+    
+    // "abc", then a match of 9 at offset 3 that overlaps itself, then 5 literals.
+    const uint8_t overlap[] = { 0x35, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'x', 'y', 'z', 'z', 'y' };
+    XCTAssertEqual(fs_decompress(overlap, sizeof(overlap), out, sizeof(out), &length), FS_ERROR_NONE);
+    XCTAssertEqual(length, (size_t)17);
+    XCTAssertEqual(memcmp(out, "abcabcabcabcxyzzy", 17), 0);
+    
+    // 15 literals take an extra length byte: 15 + 5.
+    const uint8_t longLiterals[] = { 0xf0, 0x05, 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J',
+                                     'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T' };
+    XCTAssertEqual(fs_decompress(longLiterals, sizeof(longLiterals), out, sizeof(out), &length), FS_ERROR_NONE);
+    XCTAssertEqual(length, (size_t)20);
+    XCTAssertEqual(memcmp(out, "ABCDEFGHIJKLMNOPQRST", 20), 0);
+    
+    // An empty block.
+    const uint8_t empty[] = { 0x00 };
+    XCTAssertEqual(fs_decompress(empty, sizeof(empty), out, sizeof(out), &length), FS_ERROR_NONE);
+    XCTAssertEqual(length, (size_t)0);
+}
+
+- (void)testMalformedBlocksAreRejected {
+    uint8_t out[64];
+    size_t length;
+    // Offset 0, an offset before the start, literals past the end of the block, and a match past `capacity`.
+    const uint8_t zeroOffset[] = { 0x14, 'a', 0x00, 0x00, 0x50, 'x', 'y', 'z', 'z', 'y' };
+    const uint8_t farOffset[] = { 0x14, 'a', 0x05, 0x00, 0x50, 'x', 'y', 'z', 'z', 'y' };
+    const uint8_t shortLiterals[] = { 0x70, 'a', 'b' };
+    const uint8_t longMatch[] = { 0x1f, 'a', 0x01, 0x00, 0xff, 0x10, 0x50, 'x', 'y', 'z', 'z', 'y' };
+    XCTAssertEqual(fs_decompress(zeroOffset, sizeof(zeroOffset), out, sizeof(out), &length), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_decompress(farOffset, sizeof(farOffset), out, sizeof(out), &length), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_decompress(shortLiterals, sizeof(shortLiterals), out, sizeof(out), &length), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_decompress(longMatch, sizeof(longMatch), out, sizeof(out), &length), FS_ERROR_INVALID_ARGUMENT);
+    
+    // Damaged and truncated blocks are handled within bounds, whatever they decode to.
+    uint8_t *drawing = lz4Drawing(100000);
+    size_t capacity = fs_compress_bound(100000), compressedLength;
+    uint8_t *compressed = malloc(capacity), *damaged = malloc(capacity), *decompressed = malloc(100000);
+    XCTAssertEqual(fs_compress(drawing, 100000, compressed, capacity, &compressedLength), FS_ERROR_NONE);
+    for (int i = 0; i < 2000; ++i) {
+        memcpy(damaged, compressed, compressedLength);
+        damaged[lz4Random() % compressedLength] ^= (uint8_t)(1 << (lz4Random() % 8));
+        fs_decompress(damaged, compressedLength, decompressed, 100000, &length);
+        fs_decompress(damaged, 1 + lz4Random() % compressedLength, decompressed, 100000, &length);
+    }
+    free(drawing);
+    free(compressed);
+    free(damaged);
+    free(decompressed);
+}
+
+@end
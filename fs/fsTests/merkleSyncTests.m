@@ -0,0 +1,305 @@
+//
+//  merkleSyncTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+
+/*
+ Merkle-tree delta sync.
+
+ The two sides of a sync are two trees in memory. Requests are answered in
+ random order, some are given back or answered with the wrong bytes first,
+ and a finished pull must rebuild the other side's document exactly.
+ */
+
+#define SYNC_IN_FLIGHT 4096
+
+typedef struct {
+    size_t requests;
+    size_t bytes;
+    size_t uploads;
+} syncStats;
+
+static uint64_t syncRandomState = 0x3c6ef372fe94f82bull;
+
+static uint64_t syncRandom(void) {
+    return fsTestRandomNext(&syncRandomState);
+}
+
+static uint8_t *syncDocument(size_t length) {
+    uint8_t *bytes = malloc(length + 1);
+    for (size_t i = 0; i < length; ++i) {
+        bytes[i] = (uint8_t)(syncRandom() >> 56);
+    }
+    return bytes;
+}
+
+// Pulls `remote` onto `local`; returns NO as soon as the sync misbehaves.
+static BOOL syncPull(const fs_sync_tree_t *local, const fs_sync_tree_t *remote, BOOL faulty,
+                     const uint8_t *expected, size_t expectedLength, syncStats *stats) {
+    fs_sync_t *sync;
+    fs_sync_request_t *flight = malloc(SYNC_IN_FLIGHT * sizeof(*flight));
+    size_t count = 0;
+    BOOL ok = fs_sync_pull_create(local, fs_sync_tree_root(remote), &sync) == FS_ERROR_NONE;
+    memset(stats, 0, sizeof(*stats));
+    
+    while (ok) {
+        size_t got;
+        fs_sync_next(sync, flight + count, SYNC_IN_FLIGHT - count, &got);
+        count += got;
+        stats->requests += got;
+        if (!count) {
+            break;
+        }
+        size_t pick = syncRandom() % count;
+        fs_sync_request_t request = flight[pick];
+        flight[pick] = flight[--count];
+        
+        if (faulty && syncRandom() % 7 == 0) {
+            const uint8_t junk[3] = { 1, 2, 3 };
+            ok = fs_sync_deliver(sync, &request, junk, sizeof(junk)) == FS_ERROR_INVALID_ARGUMENT;
+            continue;
+        }
+        if (faulty && syncRandom() % 11 == 0) {
+            ok = fs_sync_retry(sync, &request) == FS_ERROR_NONE;
+            continue;
+        }
+        if (request.op == FS_SYNC_EXPAND) {
+            uint8_t node[FS_SYNC_NODE_MAX];
+            size_t length;
+            ok = fs_sync_tree_node(remote, request.id, node, &length) == FS_ERROR_NONE &&
+                 fs_sync_deliver(sync, &request, node, length) == FS_ERROR_NONE &&
+                 fs_sync_deliver(sync, &request, node, length) == FS_ERROR_INVALID_ARGUMENT;
+            stats->bytes += length;
+        } else {
+            const uint8_t *chunk;
+            size_t length;
+            ok = request.op == FS_SYNC_FETCH && request.chunk &&
+                 fs_sync_tree_chunk(remote, request.id, &chunk, &length) == FS_ERROR_NONE &&
+                 length == request.length && fs_sync_deliver(sync, &request, chunk, length) == FS_ERROR_NONE;
+            stats->bytes += length;
+        }
+    }
+    
+    uint8_t *data = NULL;
+    size_t length = 0;
+    fs_sync_tree_t *tree = NULL;
+    ok = ok && fs_sync_done(sync) && fs_sync_finish(sync, &data, &length, &tree) == FS_ERROR_NONE &&
+         length == expectedLength && (!length || memcmp(data, expected, length) == 0) &&
+         fs_chunk_id_equal(fs_sync_tree_root(tree), fs_sync_tree_root(remote));
+    fs_sync_tree_destroy(tree);
+    free(data);
+    fs_sync_destroy(sync);
+    free(flight);
+    return ok;
+}
+
+// Pushes `local` to a side holding `remote`, or nothing.
+static BOOL syncPush(const fs_sync_tree_t *local, const fs_sync_tree_t *remote, syncStats *stats) {
+    fs_sync_t *sync;
+    fs_sync_request_t *flight = malloc(SYNC_IN_FLIGHT * sizeof(*flight));
+    size_t count = 0;
+    BOOL ok = fs_sync_push_create(local, &sync) == FS_ERROR_NONE;
+    memset(stats, 0, sizeof(*stats));
+    
+    while (ok) {
+        size_t got;
+        fs_sync_next(sync, flight + count, SYNC_IN_FLIGHT - count, &got);
+        count += got;
+        stats->requests += got;
+        if (!count) {
+            break;
+        }
+        size_t pick = syncRandom() % count;
+        fs_sync_request_t request = flight[pick];
+        flight[pick] = flight[--count];
+        
+        if (syncRandom() % 11 == 0) {
+            ok = fs_sync_retry(sync, &request) == FS_ERROR_NONE;
+        } else if (request.op == FS_SYNC_QUERY) {
+            BOOL present = remote && fs_sync_tree_contains(remote, request.id, request.chunk);
+            ok = fs_sync_answer(sync, &request, present) == FS_ERROR_NONE;
+        } else if (request.chunk) {
+            const uint8_t *chunk;
+            size_t length;
+            ok = request.op == FS_SYNC_UPLOAD && fs_sync_tree_chunk(local, request.id, &chunk, &length) == FS_ERROR_NONE &&
+                 fs_sync_sent(sync, &request) == FS_ERROR_NONE;
+            stats->bytes += length;
+            stats->uploads++;
+        } else {
+            uint8_t node[FS_SYNC_NODE_MAX];
+            size_t length;
+            ok = request.op == FS_SYNC_UPLOAD && fs_sync_tree_node(local, request.id, node, &length) == FS_ERROR_NONE &&
+                 fs_sync_sent(sync, &request) == FS_ERROR_NONE;
+            stats->bytes += length;
+            stats->uploads++;
+        }
+    }
+    ok = ok && fs_sync_done(sync);
+    fs_sync_destroy(sync);
+    free(flight);
+    return ok;
+}
+
+@interface merkleSyncTests : XCTestCase
+
+@end
+
+@implementation merkleSyncTests
+
+- (void)testUpdatedTreesMatchRebuiltOnes {
+    for (int iteration = 0; iteration < 120; ++iteration) {
+        size_t length = syncRandom() % (iteration < 40 ? 3000 : 1 << 20);
+        uint8_t *before = syncDocument(length);
+        size_t offset = syncRandom() % (length + 1);
+        size_t removed = syncRandom() % (length - offset + 1) % 70000;
+        size_t inserted = syncRandom() % 70000;
+        if (iteration % 3 == 0) {
+            removed = 0;
+        } else if (iteration % 3 == 1) {
+            inserted = 0;
+        }
+        size_t afterLength = length - removed + inserted;
+        uint8_t *after = malloc(afterLength + 1);
+        memcpy(after, before, offset);
+        for (size_t i = 0; i < inserted; ++i) {
+            after[offset + i] = (uint8_t)syncRandom();
+        }
+        memcpy(after + offset + inserted, before + offset + removed, length - offset - removed);
+        
+        fs_sync_tree_t *base, *updated, *rebuilt;
+        XCTAssertEqual(fs_sync_tree_create(before, length, &base), FS_ERROR_NONE);
+        XCTAssertEqual(fs_sync_tree_update(base, after, afterLength, offset, removed, inserted, &updated), FS_ERROR_NONE);
+        XCTAssertEqual(fs_sync_tree_create(after, afterLength, &rebuilt), FS_ERROR_NONE);
+        XCTAssertTrue(fs_chunk_id_equal(fs_sync_tree_root(updated), fs_sync_tree_root(rebuilt)), @"iteration %d", iteration);
+        
+        // Either version can be pulled onto the other.
+        syncStats stats;
+        XCTAssertTrue(syncPull(base, updated, iteration & 1, after, afterLength, &stats), @"iteration %d", iteration);
+        XCTAssertTrue(syncPull(updated, base, NO, before, length, &stats), @"iteration %d", iteration);
+        XCTAssertTrue(syncPush(updated, base, &stats));
+        
+        fs_sync_tree_destroy(base);
+        fs_sync_tree_destroy(updated);
+        fs_sync_tree_destroy(rebuilt);
+        free(before);
+        free(after);
+    }
+}
+
+- (void)testSmallEditsTransferLittle {
+    size_t length = 8 << 20, offset = length / 2 + 12345;
+    uint8_t *before = syncDocument(length);
+    uint8_t *after = malloc(length + 100);
+    memcpy(after, before, offset);
+    memcpy(after + offset, "an insertion in the middle of a large document", 47);
+    memcpy(after + offset + 47, before + offset, length - offset);
+    
+    fs_sync_tree_t *base, *updated;
+    XCTAssertEqual(fs_sync_tree_create(before, length, &base), FS_ERROR_NONE);
+    XCTAssertEqual(fs_sync_tree_update(base, after, length + 47, offset, 0, 47, &updated), FS_ERROR_NONE);
+    
+    // Pulling and pushing the edit cost a few chunks and the nodes above them.
+    syncStats stats;
+    XCTAssertTrue(syncPull(base, updated, NO, after, length + 47, &stats));
+    XCTAssertLessThan(stats.bytes, (size_t)(4 * FS_CHUNK_MAX_SIZE));
+    XCTAssertTrue(syncPush(updated, base, &stats));
+    XCTAssertLessThan(stats.bytes, (size_t)(4 * FS_CHUNK_MAX_SIZE));
+    
+    // Everything, when the other side has nothing.
+    XCTAssertTrue(syncPull(NULL, updated, YES, after, length + 47, &stats));
+    XCTAssertGreaterThan(stats.bytes, length);
+    XCTAssertTrue(syncPush(updated, NULL, &stats));
+    XCTAssertGreaterThan(stats.bytes, length);
+    
+    // Nothing, when both hold the same version; a push still asks for the root.
+    XCTAssertTrue(syncPull(updated, updated, NO, after, length + 47, &stats));
+    XCTAssertEqual(stats.requests, (size_t)0);
+    XCTAssertTrue(syncPush(updated, updated, &stats));
+    XCTAssertEqual(stats.requests, (size_t)1);
+    XCTAssertEqual(stats.uploads, (size_t)0);
+    
+    fs_sync_tree_destroy(base);
+    fs_sync_tree_destroy(updated);
+    free(before);
+    free(after);
+}
+
+- (void)testEmptyDocuments {
+    uint8_t *bytes = syncDocument(10);
+    fs_sync_tree_t *empty, *full;
+    syncStats stats;
+    XCTAssertEqual(fs_sync_tree_create(NULL, 0, &empty), FS_ERROR_NONE);
+    XCTAssertTrue(syncPull(NULL, empty, NO, NULL, 0, &stats));
+    XCTAssertTrue(syncPush(empty, NULL, &stats));
+    XCTAssertEqual(fs_sync_tree_update(empty, bytes, 10, 0, 0, 10, &full), FS_ERROR_NONE);
+    XCTAssertTrue(syncPull(empty, full, NO, bytes, 10, &stats));
+    XCTAssertTrue(syncPull(full, empty, NO, NULL, 0, &stats));
+    fs_sync_tree_destroy(full);
+    fs_sync_tree_destroy(empty);
+    free(bytes);
+}
+
+- (void)testInvalidArguments {
+    uint8_t *bytes = syncDocument(1000);
+    fs_sync_tree_t *tree, *updated = NULL;
+    fs_sync_t *sync;
+    XCTAssertEqual(fs_sync_tree_create(bytes, 1000, &tree), FS_ERROR_NONE);
+    
+    // The edit lengths do not add up to the new length.
+    XCTAssertEqual(fs_sync_tree_update(tree, bytes, 1000, 10, 0, 9, &updated), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertTrue(updated == NULL);
+    
+    // A request that is not in flight, and finishing a pull that is not done.
+    fs_sync_request_t stray = { .op = FS_SYNC_FETCH, .id = fs_sync_tree_root(tree), .chunk = true, .length = 1 };
+    uint8_t *data;
+    size_t length;
+    fs_sync_tree_t *result;
+    XCTAssertEqual(fs_sync_pull_create(NULL, fs_sync_tree_root(tree), &sync), FS_ERROR_NONE);
+    XCTAssertEqual(fs_sync_deliver(sync, &stray, bytes, 1), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_sync_retry(sync, &stray), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertFalse(fs_sync_done(sync));
+    XCTAssertEqual(fs_sync_finish(sync, &data, &length, &result), FS_ERROR_INVALID_ARGUMENT);
+    fs_sync_destroy(sync);
+    
+    // A push has nothing to finish.
+    syncStats stats;
+    XCTAssertEqual(fs_sync_push_create(tree, &sync), FS_ERROR_NONE);
+    XCTAssertEqual(fs_sync_finish(sync, &data, &length, &result), FS_ERROR_INVALID_ARGUMENT);
+    fs_sync_destroy(sync);
+    XCTAssertTrue(syncPush(tree, NULL, &stats));
+    
+    fs_sync_tree_destroy(tree);
+    free(bytes);
+}
+
+@end
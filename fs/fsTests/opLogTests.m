@@ -0,0 +1,325 @@
+//
+//  opLogTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ Operation log and snapshots.
+
+ A document takes random local edits and edits of a second replica, and is
+ closed and reopened between rounds; the reopened text and versions must be
+ those before closing. Crashes are played by cutting the log short and by
+ putting an old log back next to a newer snapshot.
+ */
+
+typedef struct {
+    fs_oplog_t *log;
+    fs_crdt_t *crdt;
+    fs_rope_t *rope;
+} opLogDocument;
+
+typedef struct {
+    fs_crdt_op_t ops[64];
+    size_t count;
+} opLogOps;
+
+static uint64_t opLogRandomState = 0x510e527fade682d1ull;
+static uint64_t opLogNow = 1000;
+
+static size_t opLogRandom(size_t bound) {
+    return fsTestRandom(&opLogRandomState, bound);
+}
+
+static void opLogCollect(void *context, const fs_crdt_op_t *op) {
+    opLogOps *ops = context;
+    ops->ops[ops->count++] = *op;
+}
+
+// One random edit of `crdt` and `rope`; the operations and inserted text are returned.
+static fs_error_t opLogRandomEdit(fs_crdt_t *crdt, fs_rope_t *rope, opLogOps *ops, uint8_t *text) {
+    size_t length = fs_crdt_length(crdt);
+    fs_error_t error;
+    ops->count = 0;
+    if (length && opLogRandom(3) == 0) {
+        size_t position = opLogRandom(length);
+        size_t count = 1 + opLogRandom(length - position < 20 ? length - position : 20);
+        error = fs_crdt_delete(crdt, position, count, opLogCollect, ops);
+        return error != FS_ERROR_NONE ? error : fs_rope_delete(rope, position, count);
+    }
+    uint32_t count = 1 + (uint32_t)opLogRandom(30);
+    size_t position = opLogRandom(length + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        text[i] = (uint8_t)('a' + opLogRandom(26));
+    }
+    error = fs_crdt_insert(crdt, position, count, &ops->ops[0]);
+    ops->count = 1;
+    return error != FS_ERROR_NONE ? error : fs_rope_insert(rope, position, text, count);
+}
+
+static fs_error_t opLogLocalEdit(opLogDocument *doc) {
+    opLogOps ops;
+    uint8_t text[32];
+    fs_error_t error = opLogRandomEdit(doc->crdt, doc->rope, &ops, text);
+    for (size_t i = 0; i < ops.count && error == FS_ERROR_NONE; ++i) {
+        error = fs_oplog_append(doc->log, &ops.ops[i], ops.ops[i].kind == FS_CRDT_INSERT ? text : NULL, opLogNow);
+    }
+    return error;
+}
+
+// An edit of the replica `crdt`, applied to `doc` and logged there.
+static fs_error_t opLogRemoteEdit(opLogDocument *doc, fs_crdt_t *crdt, fs_rope_t *rope) {
+    opLogOps ops;
+    uint8_t text[32];
+    fs_error_t error = opLogRandomEdit(crdt, rope, &ops, text);
+    for (size_t i = 0; i < ops.count && error == FS_ERROR_NONE; ++i) {
+        BOOL insert = ops.ops[i].kind == FS_CRDT_INSERT;
+        fsTestMirror mirror = { NULL, doc->rope, text, !insert, FS_ERROR_NONE };
+        error = fs_crdt_apply(doc->crdt, &ops.ops[i], fsTestMirrorRange, &mirror);
+        if (error == FS_ERROR_NONE) {
+            error = mirror.error;
+        }
+        if (error == FS_ERROR_NONE) {
+            error = fs_oplog_append(doc->log, &ops.ops[i], insert ? text : NULL, opLogNow);
+        }
+    }
+    return error;
+}
+
+static void opLogClose(opLogDocument *doc) {
+    fs_oplog_close(doc->log);
+    fs_crdt_destroy(doc->crdt);
+    fs_rope_destroy(doc->rope);
+    memset(doc, 0, sizeof(*doc));
+}
+
+static size_t opLogFileSize(const char *path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+static BOOL opLogCopyFile(const char *from, const char *to) {
+    int in = open(from, O_RDONLY), out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    char bytes[65536];
+    ssize_t n = 0;
+    while (in >= 0 && out >= 0 && (n = read(in, bytes, sizeof(bytes))) > 0 && write(out, bytes, (size_t)n) == n) {
+    }
+    BOOL ok = in >= 0 && out >= 0 && n == 0;
+    close(in);
+    close(out);
+    return ok;
+}
+
+// Commits, closes and reopens `doc`; returns whether the text and versions came back.
+static BOOL opLogReopen(const char *path, const fs_oplog_config_t *config, opLogDocument *doc) {
+    char *before = fsTestRopeString(doc->rope);
+    uint32_t local = fs_crdt_version(doc->crdt, 1), remote = fs_crdt_version(doc->crdt, 2);
+    BOOL ok = fs_oplog_commit(doc->log) == FS_ERROR_NONE;
+    opLogClose(doc);
+    ok = fs_oplog_open(path, 1, config, &doc->log, &doc->crdt, &doc->rope) == FS_ERROR_NONE && ok;
+    if (ok) {
+        char *after = fsTestRopeString(doc->rope);
+        ok = strcmp(after, before) == 0 && fs_crdt_length(doc->crdt) == strlen(after) &&
+             fs_crdt_version(doc->crdt, 1) == local && fs_crdt_version(doc->crdt, 2) == remote;
+        free(after);
+    }
+    free(before);
+    return ok;
+}
+
+@interface opLogTests : XCTestCase
+
+@end
+
+@implementation opLogTests {
+    char _directory[512];
+    char _path[600];
+    char _snapshot[640];
+    fs_oplog_config_t _config;
+}
+
+- (void)setUp {
+    const char *temp = getenv("TMPDIR");
+    snprintf(_directory, sizeof(_directory), "%s/opLogTests.XXXXXX", temp && *temp ? temp : "/tmp");
+    XCTAssertTrue(mkdtemp(_directory) != NULL);
+    snprintf(_path, sizeof(_path), "%s/doc.log", _directory);
+    snprintf(_snapshot, sizeof(_snapshot), "%s.snapshot", _path);
+    _config = (fs_oplog_config_t){ .commit_ms = 30, .commit_bytes = 2048, .snapshot_bytes = 32 * 1024 };
+}
+
+- (void)tearDown {
+    char other[640];
+    snprintf(other, sizeof(other), "%s/foreign.log", _directory);
+    unlink(other);
+    unlink(_path);
+    unlink(_snapshot);
+    rmdir(_directory);
+}
+
+- (void)testReopenRestoresTheDocument {
+    opLogDocument doc;
+    fs_crdt_t *other;
+    fs_rope_t *otherRope;
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    XCTAssertEqual(fs_rope_length(doc.rope), (size_t)0);
+    XCTAssertEqual(fs_crdt_create(2, &other), FS_ERROR_NONE);
+    XCTAssertEqual(fs_rope_create(NULL, 0, &otherRope), FS_ERROR_NONE);
+    
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 400; ++i) {
+            fs_error_t error = opLogRandom(4) ? opLogLocalEdit(&doc) : opLogRemoteEdit(&doc, other, otherRope);
+            XCTAssertEqual(error, FS_ERROR_NONE, @"round %d edit %d", round, i);
+            if (opLogRandom(8) == 0) {
+                uint64_t deadline;
+                opLogNow += opLogRandom(20);
+                XCTAssertEqual(fs_oplog_poll(doc.log, opLogNow, &deadline), FS_ERROR_NONE);
+                XCTAssertTrue(fs_oplog_idle(doc.log) ? deadline == UINT64_MAX : deadline > opLogNow);
+            }
+        }
+        XCTAssertTrue(opLogReopen(_path, &_config, &doc), @"round %d", round);
+    }
+    // The log outgrew the limit, so snapshots were written and the log kept short.
+    XCTAssertGreaterThan(opLogFileSize(_snapshot), (size_t)0);
+    XCTAssertLessThan(opLogFileSize(_path), (size_t)(2 * 32 * 1024 + 4096));
+    
+    opLogClose(&doc);
+    fs_crdt_destroy(other);
+    fs_rope_destroy(otherRope);
+}
+
+- (void)testGroupsCommitWhenDue {
+    opLogDocument doc;
+    uint64_t deadline;
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    XCTAssertTrue(fs_oplog_idle(doc.log));
+    XCTAssertEqual(fs_oplog_poll(doc.log, opLogNow, &deadline), FS_ERROR_NONE);
+    XCTAssertEqual(deadline, UINT64_MAX);
+    
+    size_t empty = opLogFileSize(_path);
+    XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    XCTAssertFalse(fs_oplog_idle(doc.log));
+    XCTAssertEqual(fs_oplog_poll(doc.log, opLogNow + 29, &deadline), FS_ERROR_NONE);
+    XCTAssertEqual(deadline, opLogNow + 30);
+    XCTAssertEqual(opLogFileSize(_path), empty);
+    XCTAssertEqual(fs_oplog_poll(doc.log, opLogNow + 30, &deadline), FS_ERROR_NONE);
+    XCTAssertTrue(fs_oplog_idle(doc.log));
+    XCTAssertGreaterThan(opLogFileSize(_path), empty);
+    opLogClose(&doc);
+}
+
+- (void)testTornGroupIsDropped {
+    opLogDocument doc;
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    for (int i = 0; i < 200; ++i) {
+        XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    }
+    XCTAssertEqual(fs_oplog_commit(doc.log), FS_ERROR_NONE);
+    char *committed = fsTestRopeString(doc.rope);
+    for (int i = 0; i < 50; ++i) {
+        XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    }
+    XCTAssertEqual(fs_oplog_commit(doc.log), FS_ERROR_NONE);
+    opLogClose(&doc);
+    
+    // The last group loses its final bytes, as if the write was cut short.
+    XCTAssertEqual(truncate(_path, (off_t)(opLogFileSize(_path) - 7)), 0);
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    char *reopened = fsTestRopeString(doc.rope);
+    XCTAssertEqualObjects(@(reopened), @(committed));
+    
+    // Edits go on after the torn group, which the next commit overwrites.
+    for (int i = 0; i < 100; ++i) {
+        XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    }
+    XCTAssertTrue(opLogReopen(_path, &_config, &doc));
+    opLogClose(&doc);
+    free(committed);
+    free(reopened);
+}
+
+- (void)testOldLogNextToANewerSnapshot {
+    opLogDocument doc;
+    char old[640];
+    snprintf(old, sizeof(old), "%s/foreign.log", _directory);
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    for (int i = 0; i < 100; ++i) {
+        XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    }
+    XCTAssertEqual(fs_oplog_commit(doc.log), FS_ERROR_NONE);
+    
+    // A crash after the snapshot was renamed into place, before the log was emptied.
+    XCTAssertTrue(opLogCopyFile(_path, old));
+    XCTAssertEqual(fs_oplog_snapshot(doc.log), FS_ERROR_NONE);
+    char *text = fsTestRopeString(doc.rope);
+    opLogClose(&doc);
+    XCTAssertTrue(opLogCopyFile(old, _path));
+    
+    // The operations the snapshot already holds are skipped.
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    char *reopened = fsTestRopeString(doc.rope);
+    XCTAssertEqualObjects(@(reopened), @(text));
+    for (int i = 0; i < 100; ++i) {
+        XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    }
+    XCTAssertTrue(opLogReopen(_path, &_config, &doc));
+    opLogClose(&doc);
+    free(text);
+    free(reopened);
+}
+
+- (void)testMissingSnapshotsAndForeignFiles {
+    opLogDocument doc;
+    char foreign[640];
+    snprintf(foreign, sizeof(foreign), "%s/foreign.log", _directory);
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NONE);
+    for (int i = 0; i < 10; ++i) {
+        XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    }
+    XCTAssertEqual(fs_oplog_snapshot(doc.log), FS_ERROR_NONE);
+    XCTAssertEqual(opLogLocalEdit(&doc), FS_ERROR_NONE);
+    XCTAssertEqual(fs_oplog_commit(doc.log), FS_ERROR_NONE);
+    opLogClose(&doc);
+    
+    XCTAssertEqual(unlink(_snapshot), 0);
+    XCTAssertEqual(fs_oplog_open(_path, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NOT_FOUND);
+    
+    int fd = open(foreign, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    XCTAssertEqual(write(fd, "garbage", 7), (ssize_t)7);
+    close(fd);
+    XCTAssertEqual(fs_oplog_open(foreign, 1, &_config, &doc.log, &doc.crdt, &doc.rope), FS_ERROR_NOT_SUPPORTED);
+}
+
+@end
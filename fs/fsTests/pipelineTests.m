@@ -0,0 +1,234 @@
+//
+//  pipelineTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/pipeline.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+/*
+ Multi-stage pipeline.
+
+ Three stages copy each input into the item's buffer, increment its bytes
+ and add them up; the total must match a serial computation whatever the
+ number of workers and the order items come out in.
+ */
+
+typedef struct {
+    int failAt;
+    unsigned sleepMicroseconds;
+    _Atomic long sum;
+    _Atomic long seen;
+    _Atomic int busy, maxBusy;
+    _Atomic long dirty;
+    _Atomic long done;
+    _Atomic long submitted;
+    _Atomic long maxInFlight;
+} pipelineState;
+
+// Stages running at once, across all states.
+static _Atomic int pipelineRunning, pipelineMaxRunning;
+
+static void pipelineRaise(_Atomic int *max, int value) {
+    int seen = atomic_load(max);
+    while (value > seen && !atomic_compare_exchange_weak(max, &seen, value)) {
+    }
+}
+
+static void pipelineEnter(pipelineState *state) {
+    pipelineRaise(&state->maxBusy, atomic_fetch_add(&state->busy, 1) + 1);
+    pipelineRaise(&pipelineMaxRunning, atomic_fetch_add(&pipelineRunning, 1) + 1);
+    if (state->sleepMicroseconds) {
+        usleep(state->sleepMicroseconds);
+    }
+}
+
+static void pipelineLeave(pipelineState *state) {
+    atomic_fetch_sub(&pipelineRunning, 1);
+    atomic_fetch_sub(&state->busy, 1);
+}
+
+static fs_error_t pipelineCopy(void *context, fs_pipeline_item_t *item) {
+    pipelineState *state = context;
+    pipelineEnter(state);
+    if (item->len != 0) {
+        atomic_fetch_add(&state->dirty, 1);
+    }
+    memcpy(item->buffer, item->input, item->input_len);
+    item->len = item->input_len;
+    pipelineLeave(state);
+    return state->failAt >= 0 && item->tag == (uint64_t)state->failAt ? FS_ERROR_IO : FS_ERROR_NONE;
+}
+
+static fs_error_t pipelineIncrement(void *context, fs_pipeline_item_t *item) {
+    pipelineState *state = context;
+    pipelineEnter(state);
+    for (size_t i = 0; i < item->len; ++i) {
+        item->buffer[i]++;
+    }
+    pipelineLeave(state);
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t pipelineSum(void *context, fs_pipeline_item_t *item) {
+    pipelineState *state = context;
+    pipelineEnter(state);
+    long sum = 0, inFlight = atomic_load(&state->submitted) - atomic_load(&state->done);
+    long seen = atomic_load(&state->maxInFlight);
+    while (inFlight > seen && !atomic_compare_exchange_weak(&state->maxInFlight, &seen, inFlight)) {
+    }
+    for (size_t i = 0; i < item->len; ++i) {
+        sum += item->buffer[i];
+    }
+    atomic_fetch_add(&state->sum, sum + (long)item->tag);
+    atomic_fetch_add(&state->seen, 1);
+    atomic_fetch_add(&state->done, 1);
+    pipelineLeave(state);
+    return FS_ERROR_NONE;
+}
+
+// Submits `count` items, item i holding `i % modulo` bytes; returns the expected sum, or -1 if a submit failed.
+static long pipelineFeed(fs_pipeline_t *pipeline, const unsigned char *data, long count, size_t modulo,
+                         pipelineState *last) {
+    long expected = 0;
+    for (long i = 0; i < count; ++i) {
+        size_t length = (size_t)i % modulo;
+        if (fs_pipeline_submit(pipeline, data, length, (uint64_t)i, NULL) != FS_ERROR_NONE) {
+            return -1;
+        }
+        if (last) {
+            atomic_fetch_add(&last->submitted, 1);
+        }
+        for (size_t k = 0; k < length; ++k) {
+            expected += data[k] + 1;
+        }
+        expected += i;
+    }
+    return expected;
+}
+
+@interface pipelineTests : XCTestCase
+
+@end
+
+@implementation pipelineTests {
+    unsigned char _data[1000];
+    pipelineState _states[3];
+}
+
+- (void)setUp {
+    for (int i = 0; i < 1000; ++i) {
+        _data[i] = (unsigned char)(i % 200);
+    }
+    memset(_states, 0, sizeof(_states));
+    for (int i = 0; i < 3; ++i) {
+        _states[i].failAt = -1;
+    }
+    atomic_store(&pipelineMaxRunning, 0);
+}
+
+- (void)testEveryItemPassesEveryStage {
+    fs_pipeline_stage_t stages[3] = {
+        { pipelineCopy, &_states[0], 3 }, { pipelineIncrement, &_states[1], 2 }, { pipelineSum, &_states[2], 4 },
+    };
+    fs_pipeline_config_t config = { 2, 1000 };
+    fs_pipeline_t *pipeline;
+    XCTAssertEqual(fs_pipeline_create(stages, 3, &config, &pipeline), FS_ERROR_NONE);
+    for (int round = 0; round < 2; ++round) {
+        atomic_store(&_states[2].sum, 0);
+        atomic_store(&_states[2].seen, 0);
+        long expected = pipelineFeed(pipeline, _data, 50000, 50, NULL);
+        XCTAssertEqual(fs_pipeline_finish(pipeline), FS_ERROR_NONE);
+        XCTAssertEqual(atomic_load(&_states[2].seen), 50000L);
+        XCTAssertEqual(atomic_load(&_states[2].sum), expected);
+    }
+    // Pooled buffers come back to the first stage empty.
+    XCTAssertEqual(atomic_load(&_states[0].dirty), 0L);
+    fs_pipeline_destroy(pipeline);
+}
+
+- (void)testStagesOverlapAndBackpressureBoundsMemory {
+    _states[0].sleepMicroseconds = 1000;
+    _states[1].sleepMicroseconds = 1000;
+    _states[2].sleepMicroseconds = 3000;
+    fs_pipeline_stage_t stages[3] = {
+        { pipelineCopy, &_states[0], 1 }, { pipelineIncrement, &_states[1], 1 }, { pipelineSum, &_states[2], 1 },
+    };
+    fs_pipeline_config_t config = { 0, 1000 };
+    fs_pipeline_t *pipeline;
+    XCTAssertEqual(fs_pipeline_create(stages, 3, &config, &pipeline), FS_ERROR_NONE);
+    long expected = pipelineFeed(pipeline, _data, 100, 1000, &_states[2]);
+    XCTAssertEqual(fs_pipeline_finish(pipeline), FS_ERROR_NONE);
+    XCTAssertEqual(atomic_load(&_states[2].sum), expected);
+    
+    // The first stages ran while the slow last one was busy, and the pool held the others back.
+    XCTAssertEqual(atomic_load(&_states[2].maxBusy), 1);
+    XCTAssertGreaterThan(atomic_load(&pipelineMaxRunning), 1);
+    XCTAssertLessThanOrEqual(atomic_load(&_states[2].maxInFlight), (long)(3 * FS_PIPELINE_QUEUE_DEPTH + 3));
+    fs_pipeline_destroy(pipeline);
+}
+
+- (void)testErrorStopsThePipelineUntilFinished {
+    fs_pipeline_stage_t stages[3] = {
+        { pipelineCopy, &_states[0], 1 }, { pipelineIncrement, &_states[1], 1 }, { pipelineSum, &_states[2], 1 },
+    };
+    fs_pipeline_config_t config = { 0, 1000 };
+    fs_pipeline_t *pipeline;
+    XCTAssertEqual(fs_pipeline_create(stages, 3, &config, &pipeline), FS_ERROR_NONE);
+    _states[0].failAt = 50;
+    fs_error_t submitted = FS_ERROR_NONE;
+    for (long i = 0; i < 1000 && submitted == FS_ERROR_NONE; ++i) {
+        submitted = fs_pipeline_submit(pipeline, _data, 10, (uint64_t)i, NULL);
+    }
+    fs_error_t finished = fs_pipeline_finish(pipeline);
+    XCTAssertTrue(submitted == FS_ERROR_IO || finished == FS_ERROR_IO);
+    XCTAssertLessThan(atomic_load(&_states[2].seen), 1000L);
+    
+    // The error was cleared by finishing.
+    _states[0].failAt = -1;
+    atomic_store(&_states[2].seen, 0);
+    XCTAssertEqual(fs_pipeline_submit(pipeline, _data, 10, 0, NULL), FS_ERROR_NONE);
+    XCTAssertEqual(fs_pipeline_finish(pipeline), FS_ERROR_NONE);
+    XCTAssertEqual(atomic_load(&_states[2].seen), 1L);
+    fs_pipeline_destroy(pipeline);
+}
+
+- (void)testInvalidConfigurations {
+    fs_pipeline_stage_t stage = { pipelineCopy, &_states[0], 1 };
+    fs_pipeline_config_t noBuffer = { 0, 0 }, config = { 0, 16 };
+    fs_pipeline_t *pipeline = NULL;
+    XCTAssertEqual(fs_pipeline_create(&stage, 1, &noBuffer, &pipeline), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_pipeline_create(&stage, 0, &config, &pipeline), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertTrue(pipeline == NULL);
+    fs_pipeline_destroy(NULL);
+}
+
+@end
@@ -0,0 +1,373 @@
+//
+//  presenceTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+
+/*
+ Presence hub and clients.
+
+ A room of clients and one hub exchange messages through queues delivered
+ in order. Participants move their pointers and selections, leave, join
+ and reconnect, and once things settle every client must see everyone
+ else's latest state.
+ */
+
+#define PRESENCE_USERS 64
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+} presenceMessage;
+
+typedef struct {
+    presenceMessage *messages;
+    size_t count, capacity;
+} presenceQueue;
+
+typedef struct presenceRoom presenceRoom;
+
+typedef struct {
+    presenceRoom *room;
+    uint32_t user;
+} presenceLink;
+
+struct presenceRoom {
+    fs_presence_hub_t *hub;
+    fs_presence_config_t config;
+    fs_presence_client_t *clients[PRESENCE_USERS + 1];
+    fs_presence_t truth[PRESENCE_USERS + 1];
+    BOOL online[PRESENCE_USERS + 1];
+    presenceLink links[PRESENCE_USERS + 1];
+    presenceQueue toClient[PRESENCE_USERS + 1];
+    presenceQueue toHub[PRESENCE_USERS + 1];
+    size_t fanouts, upMessages, lastUpLength, updates, leaves;
+    fs_error_t error;
+    uint64_t random;
+};
+
+static uint32_t presenceRandom(presenceRoom *room, uint32_t bound) {
+    return (uint32_t)fsTestRandom(&room->random, bound);
+}
+
+static void presencePush(presenceQueue *queue, const uint8_t *bytes, size_t length) {
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 16;
+        queue->messages = realloc(queue->messages, queue->capacity * sizeof(presenceMessage));
+    }
+    queue->messages[queue->count].bytes = malloc(length);
+    memcpy(queue->messages[queue->count].bytes, bytes, length);
+    queue->messages[queue->count++].length = length;
+}
+
+static void presenceDrop(presenceQueue *queue) {
+    for (size_t i = 0; i < queue->count; ++i) {
+        free(queue->messages[i].bytes);
+    }
+    queue->count = 0;
+}
+
+static void presenceFanout(void *context, const uint32_t *users, size_t count, const uint8_t *bytes, size_t length) {
+    presenceRoom *room = context;
+    room->fanouts++;
+    for (size_t i = 0; i < count; ++i) {
+        presencePush(&room->toClient[users[i]], bytes, length);
+    }
+}
+
+static void presenceSend(void *context, const uint8_t *bytes, size_t length) {
+    presenceLink *link = context;
+    link->room->upMessages++;
+    link->room->lastUpLength = length;
+    presencePush(&link->room->toHub[link->user], bytes, length);
+}
+
+static void presenceOnChange(void *context, uint32_t user, const fs_presence_t *state, uint32_t changed) {
+    presenceRoom *room = context;
+    room->updates++;
+    room->leaves += state == NULL;
+}
+
+static void presenceSetUp(presenceRoom *room, const fs_presence_config_t *config, uint64_t seed) {
+    memset(room, 0, sizeof(*room));
+    room->random = seed;
+    if (config) {
+        room->config = *config;
+    }
+    fs_presence_hub_create(config, presenceFanout, room, &room->hub);
+    for (uint32_t user = 0; user <= PRESENCE_USERS; ++user) {
+        room->links[user] = (presenceLink){ room, user };
+    }
+}
+
+static void presenceTearDown(presenceRoom *room) {
+    for (uint32_t user = 0; user <= PRESENCE_USERS; ++user) {
+        fs_presence_client_destroy(room->clients[user]);
+        presenceDrop(&room->toClient[user]);
+        presenceDrop(&room->toHub[user]);
+        free(room->toClient[user].messages);
+        free(room->toHub[user].messages);
+    }
+    fs_presence_hub_destroy(room->hub);
+}
+
+// Joins `user`, or reconnects it, dropping what was in flight either way.
+static fs_error_t presenceJoin(presenceRoom *room, uint32_t user) {
+    presenceDrop(&room->toClient[user]);
+    presenceDrop(&room->toHub[user]);
+    if (!room->clients[user]) {
+        fs_error_t error = fs_presence_client_create(user, &room->config, presenceSend, &room->links[user],
+                                                     &room->clients[user]);
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    } else {
+        fs_presence_client_reset(room->clients[user]);
+    }
+    room->online[user] = YES;
+    return fs_presence_hub_join(room->hub, user);
+}
+
+static fs_error_t presenceLeave(presenceRoom *room, uint32_t user) {
+    room->online[user] = NO;
+    fs_presence_client_destroy(room->clients[user]);
+    room->clients[user] = NULL;
+    memset(&room->truth[user], 0, sizeof(fs_presence_t));
+    presenceDrop(&room->toClient[user]);
+    presenceDrop(&room->toHub[user]);
+    return fs_presence_hub_leave(room->hub, user);
+}
+
+static void presenceDeliver(presenceRoom *room) {
+    for (uint32_t user = 1; user <= PRESENCE_USERS; ++user) {
+        for (size_t i = 0; i < room->toHub[user].count; ++i) {
+            presenceMessage *message = &room->toHub[user].messages[i];
+            fs_error_t error = fs_presence_hub_receive(room->hub, user, message->bytes, message->length);
+            room->error = room->error ? room->error : error;
+        }
+        presenceDrop(&room->toHub[user]);
+        for (size_t i = 0; i < room->toClient[user].count; ++i) {
+            presenceMessage *message = &room->toClient[user].messages[i];
+            fs_error_t error = fs_presence_client_receive(room->clients[user], message->bytes, message->length,
+                                                          presenceOnChange, room);
+            room->error = room->error ? room->error : error;
+        }
+        presenceDrop(&room->toClient[user]);
+    }
+}
+
+static void presenceMove(presenceRoom *room, uint32_t user) {
+    fs_presence_t *state = &room->truth[user];
+    state->x += (int32_t)presenceRandom(room, 21) - 10;
+    state->y += (int32_t)presenceRandom(room, 21) - 10;
+    if (presenceRandom(room, 50) == 0) {
+        state->buttons ^= 1;
+    }
+    if (presenceRandom(room, 20) == 0) {
+        state->cursor = presenceRandom(room, 100000);
+        state->anchor = state->cursor + (presenceRandom(room, 3) ? 0 : presenceRandom(room, 50));
+    }
+    if (presenceRandom(room, 500) == 0) {
+        state->status = (uint8_t)presenceRandom(room, 256);
+    }
+    if (presenceRandom(room, 1000) == 0) {
+        state->x = (int32_t)presenceRandom(room, UINT32_MAX);
+        state->cursor = presenceRandom(room, UINT32_MAX);
+    }
+    fs_presence_client_set(room->clients[user], state);
+}
+
+// Advances the room by 5 ms from `now`, with everybody online moving half the time.
+static void presenceStep(presenceRoom *room, uint32_t users, uint64_t now, BOOL move) {
+    for (uint32_t user = 1; user <= users; ++user) {
+        if (room->online[user]) {
+            if (move && presenceRandom(room, 2)) {
+                presenceMove(room, user);
+            }
+            fs_presence_client_poll(room->clients[user], now, NULL);
+        }
+    }
+    presenceDeliver(room);
+    fs_presence_hub_poll(room->hub, now, NULL);
+    presenceDeliver(room);
+}
+
+static BOOL presenceConverged(presenceRoom *room) {
+    for (uint32_t user = 1; user <= PRESENCE_USERS; ++user) {
+        size_t others = 0;
+        if (!room->online[user]) {
+            continue;
+        }
+        for (uint32_t other = 1; other <= PRESENCE_USERS; ++other) {
+            fs_presence_t state;
+            fs_error_t error = fs_presence_client_get(room->clients[user], other, &state);
+            if (other == user || !room->online[other]) {
+                if (error != FS_ERROR_NOT_FOUND) {
+                    return NO;
+                }
+                continue;
+            }
+            const fs_presence_t *truth = &room->truth[other];
+            if (error != FS_ERROR_NONE || state.x != truth->x || state.y != truth->y || state.cursor != truth->cursor ||
+                state.anchor != truth->anchor || state.buttons != truth->buttons || state.status != truth->status) {
+                return NO;
+            }
+            others++;
+        }
+        if (fs_presence_client_count(room->clients[user]) != others) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+@interface presenceTests : XCTestCase
+
+@end
+
+@implementation presenceTests
+
+- (void)testRoomConverges {
+    presenceRoom *room = malloc(sizeof(presenceRoom));
+    presenceSetUp(room, NULL, 0x9b05688c2b3e6c1full);
+    for (uint32_t user = 1; user <= 40; ++user) {
+        XCTAssertEqual(presenceJoin(room, user), FS_ERROR_NONE);
+    }
+    uint64_t now = 0;
+    for (; now < 3000; now += 5) {
+        presenceStep(room, 40, now, YES);
+    }
+    size_t ticks = 3000 / FS_PRESENCE_TICK_MS;
+    for (; now < 4000; now += 5) {
+        presenceStep(room, 40, now, NO);
+    }
+    XCTAssertEqual(room->error, FS_ERROR_NONE);
+    XCTAssertTrue(presenceConverged(room));
+    XCTAssertEqual(fs_presence_hub_count(room->hub), (size_t)40);
+    
+    // One fanout per tick while everybody moves, and a few snapshots at the start; not one per move.
+    XCTAssertLessThan(room->fanouts, ticks + 1000 / FS_PRESENCE_TICK_MS + 2 * 40);
+    XCTAssertLessThan(room->upMessages, (size_t)(40 * (4000 / FS_PRESENCE_TICK_MS + 1)));
+    presenceTearDown(room);
+    free(room);
+}
+
+- (void)testChurnAndSmallMessagesConverge {
+    fs_presence_config_t configs[2] = { { 0 }, { .tick_ms = 30, .max_message = 64 } };
+    for (int c = 0; c < 2; ++c) {
+        presenceRoom *room = malloc(sizeof(presenceRoom));
+        presenceSetUp(room, &configs[c], 0x1f83d9abfb41bd6bull + (uint64_t)c);
+        for (uint32_t user = 1; user <= PRESENCE_USERS; ++user) {
+            XCTAssertEqual(presenceJoin(room, user), FS_ERROR_NONE);
+        }
+        uint64_t now = 0;
+        for (; now < 4000; now += 5) {
+            if (presenceRandom(room, 20) == 0) {
+                uint32_t user = 1 + presenceRandom(room, PRESENCE_USERS);
+                fs_error_t error = room->online[user] && presenceRandom(room, 2) ? presenceLeave(room, user)
+                                                                                 : presenceJoin(room, user);
+                XCTAssertEqual(error, FS_ERROR_NONE);
+            }
+            presenceStep(room, PRESENCE_USERS, now, YES);
+        }
+        for (; now < 9000; now += 5) {
+            presenceStep(room, PRESENCE_USERS, now, NO);
+        }
+        XCTAssertEqual(room->error, FS_ERROR_NONE, @"config %d", c);
+        XCTAssertTrue(presenceConverged(room), @"config %d", c);
+        XCTAssertGreaterThan(room->leaves, (size_t)0);
+        presenceTearDown(room);
+        free(room);
+    }
+}
+
+- (void)testSmallMovesTakeAFewBytes {
+    presenceRoom *room = malloc(sizeof(presenceRoom));
+    presenceSetUp(room, NULL, 1);
+    XCTAssertEqual(presenceJoin(room, 1), FS_ERROR_NONE);
+    XCTAssertEqual(presenceJoin(room, 2), FS_ERROR_NONE);
+    room->truth[1] = (fs_presence_t){ .x = 5000, .y = -3000, .cursor = 12345, .anchor = 12345 };
+    fs_presence_client_set(room->clients[1], &room->truth[1]);
+    presenceStep(room, 2, 0, NO);
+    
+    room->truth[1].x += 3;
+    room->truth[1].y -= 2;
+    fs_presence_client_set(room->clients[1], &room->truth[1]);
+    size_t sent = room->upMessages;
+    presenceStep(room, 2, FS_PRESENCE_TICK_MS, NO);
+    XCTAssertEqual(room->upMessages, sent + 1);
+    XCTAssertLessThanOrEqual(room->lastUpLength, (size_t)6);
+    
+    // Nothing goes out when the state is set to what was sent.
+    fs_presence_client_set(room->clients[1], &room->truth[1]);
+    presenceStep(room, 2, 2 * FS_PRESENCE_TICK_MS, NO);
+    XCTAssertEqual(room->upMessages, sent + 1);
+    XCTAssertTrue(presenceConverged(room));
+    presenceTearDown(room);
+    free(room);
+}
+
+- (void)testMalformedMessagesApplyNothing {
+    presenceRoom *room = malloc(sizeof(presenceRoom));
+    presenceSetUp(room, NULL, 0x428a2f98d728ae22ull);
+    XCTAssertEqual(presenceJoin(room, 7), FS_ERROR_NONE);
+    XCTAssertEqual(presenceJoin(room, 9), FS_ERROR_NONE);
+    presenceStep(room, 9, 0, NO);
+    size_t updates = room->updates;
+    
+    uint8_t junk[32];
+    for (int i = 0; i < 100000; ++i) {
+        size_t length = 1 + presenceRandom(room, 20);
+        for (size_t k = 0; k < length; ++k) {
+            junk[k] = (uint8_t)presenceRandom(room, 256);
+        }
+        if (presenceRandom(room, 2)) {
+            junk[0] = 0;
+        }
+        fs_presence_hub_receive(room->hub, 7, junk, length);
+        fs_presence_client_receive(room->clients[9], junk, length, NULL, NULL);
+    }
+    
+    // An entry whose user varint never ends is rejected before anything is applied.
+    const uint8_t truncated[] = { 0, 0x87, 0x80, 0x80 };
+    XCTAssertEqual(fs_presence_client_receive(room->clients[9], truncated, sizeof(truncated), presenceOnChange, room),
+                   FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(room->updates, updates);
+    XCTAssertEqual(fs_presence_hub_receive(room->hub, 8, junk, 1), FS_ERROR_NOT_FOUND);
+    XCTAssertEqual(fs_presence_hub_leave(room->hub, 7), FS_ERROR_NONE);
+    XCTAssertEqual(fs_presence_hub_leave(room->hub, 7), FS_ERROR_NOT_FOUND);
+    room->online[7] = NO;
+    presenceTearDown(room);
+    free(room);
+}
+
+@end
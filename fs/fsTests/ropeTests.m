@@ -0,0 +1,172 @@
+//
+//  ropeTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+
+/*
+ B-tree rope document buffer.
+
+ Random edits are mirrored on a flat buffer, which every lookup is checked
+ against; sizes are chosen so leaves split and merge and the tree gains
+ and loses levels.
+ */
+
+static uint64_t ropeRandomState = 0x853c49e6748fea9bull;
+
+static size_t ropeRandom(size_t bound) {
+    return fsTestRandom(&ropeRandomState, bound);
+}
+
+static void ropeFillText(unsigned char *bytes, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        bytes[i] = ropeRandom(24) == 0 ? '\n' : (unsigned char)('a' + ropeRandom(26));
+    }
+}
+
+static size_t ropeLines(const unsigned char *flat, size_t length) {
+    size_t lines = 1;
+    for (size_t i = 0; i < length; ++i) {
+        lines += flat[i] == '\n';
+    }
+    return lines;
+}
+
+@interface ropeTests : XCTestCase
+
+@end
+
+@implementation ropeTests
+
+- (void)testRandomEditsMatchAFlatBuffer {
+    const size_t capacity = 512 * 1024;
+    fsTestText flat = { malloc(capacity), 0 };
+    unsigned char insert[3000];
+    fs_rope_t *rope = NULL;
+    XCTAssertEqual(fs_rope_create(NULL, 0, &rope), FS_ERROR_NONE);
+    
+    for (int step = 0; step < 4000; ++step) {
+        // Grow to a few hundred KiB, then shrink back, so the tree gains and loses levels.
+        bool grow = step < 2000 ? ropeRandom(4) != 0 : ropeRandom(4) == 0;
+        if (grow && flat.length + sizeof(insert) <= capacity) {
+            size_t at = ropeRandom(flat.length + 1), count = 1 + ropeRandom(sizeof(insert));
+            ropeFillText(insert, count);
+            XCTAssertEqual(fs_rope_insert(rope, at, insert, count), FS_ERROR_NONE);
+            fsTestTextInsert(&flat, at, insert, count);
+        } else if (flat.length) {
+            size_t at = ropeRandom(flat.length), count = 1 + ropeRandom(flat.length - at < 4000 ? flat.length - at : 4000);
+            XCTAssertEqual(fs_rope_delete(rope, at, count), FS_ERROR_NONE);
+            fsTestTextDelete(&flat, at, count);
+        }
+        if (step % 97 == 0) {
+            XCTAssertTrue(fsTestRopeMatches(rope, flat.bytes, flat.length), @"step %d", step);
+            XCTAssertEqual(fs_rope_line_count(rope), ropeLines(flat.bytes, flat.length));
+        }
+    }
+    XCTAssertTrue(fsTestRopeMatches(rope, flat.bytes, flat.length));
+    fs_rope_destroy(rope);
+    free(flat.bytes);
+}
+
+- (void)testLookupsAgreeWithTheBytes {
+    const size_t length = 300 * 1024;
+    unsigned char *flat = malloc(length);
+    unsigned char copy[5000];
+    fs_rope_t *rope = NULL;
+    ropeFillText(flat, length);
+    XCTAssertEqual(fs_rope_create(flat, length, &rope), FS_ERROR_NONE);
+    
+    size_t line = 0, lineStart = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (i % 331 == 0) {
+            XCTAssertEqual(fs_rope_byte_at(rope, i), flat[i]);
+            XCTAssertEqual(fs_rope_line_at(rope, i), line, @"offset %zu", i);
+            size_t start = SIZE_MAX;
+            XCTAssertEqual(fs_rope_line_start(rope, line, &start), FS_ERROR_NONE);
+            XCTAssertEqual(start, lineStart);
+        }
+        if (flat[i] == '\n') {
+            ++line;
+            lineStart = i + 1;
+        }
+    }
+    size_t start;
+    XCTAssertEqual(fs_rope_line_start(rope, fs_rope_line_count(rope), &start), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_rope_line_at(rope, length + 10), fs_rope_line_count(rope) - 1);
+    
+    for (int i = 0; i < 200; ++i) {
+        size_t at = ropeRandom(length + 100), count = ropeRandom(sizeof(copy));
+        size_t expected = at >= length ? 0 : (length - at < count ? length - at : count);
+        XCTAssertEqual(fs_rope_copy(rope, at, copy, count), expected);
+        XCTAssertEqual(memcmp(copy, flat + (at < length ? at : 0), expected), 0);
+    }
+    fs_rope_destroy(rope);
+    free(flat);
+}
+
+- (void)testSnapshotsKeepTheirContents {
+    const size_t length = 100 * 1024;
+    unsigned char *flat = malloc(length);
+    fs_rope_t *rope = NULL, *snapshot = NULL;
+    ropeFillText(flat, length);
+    XCTAssertEqual(fs_rope_create(flat, length, &rope), FS_ERROR_NONE);
+    XCTAssertEqual(fs_rope_snapshot(rope, &snapshot), FS_ERROR_NONE);
+    XCTAssertTrue(fs_rope_shares_contents(rope, snapshot));
+    
+    XCTAssertEqual(fs_rope_insert(rope, 5000, "edit", 4), FS_ERROR_NONE);
+    XCTAssertEqual(fs_rope_delete(rope, 70000, 20000), FS_ERROR_NONE);
+    XCTAssertFalse(fs_rope_shares_contents(rope, snapshot));
+    XCTAssertTrue(fsTestRopeMatches(snapshot, flat, length));
+    XCTAssertEqual(fs_rope_length(rope), length + 4 - 20000);
+    
+    // Editing the snapshot leaves the rope alone as well.
+    XCTAssertEqual(fs_rope_delete(snapshot, 0, length), FS_ERROR_NONE);
+    XCTAssertEqual(fs_rope_length(snapshot), (size_t)0);
+    XCTAssertEqual(fs_rope_line_count(snapshot), (size_t)1);
+    XCTAssertEqual(fs_rope_length(rope), length + 4 - 20000);
+    fs_rope_destroy(snapshot);
+    fs_rope_destroy(rope);
+    free(flat);
+}
+
+- (void)testOutOfBoundsEditsLeaveTheRopeUnchanged {
+    fs_rope_t *rope = NULL;
+    XCTAssertEqual(fs_rope_create("one\ntwo\n", 8, &rope), FS_ERROR_NONE);
+    XCTAssertEqual(fs_rope_insert(rope, 9, "x", 1), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_rope_delete(rope, 4, 5), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_rope_insert(rope, 8, NULL, 0), FS_ERROR_NONE);
+    XCTAssertTrue(fsTestRopeMatches(rope, (const unsigned char *)"one\ntwo\n", 8));
+    XCTAssertEqual(fs_rope_line_count(rope), (size_t)3);
+    fs_rope_destroy(rope);
+}
+
+@end
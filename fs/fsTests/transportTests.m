@@ -0,0 +1,287 @@
+//
+//  transportTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/rtc.h>
+#import "fsTestSupport.h"
+
+/*
+ Batching, coalescing operation transport.
+
+ Two endpoints, each a replica with its text, are joined by a link whose
+ messages can be held back or dropped; every test ends with both sides idle
+ and holding the same text.
+ */
+
+#define TRANSPORT_WIRE 1024
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+} transportMessage;
+
+typedef struct {
+    fs_crdt_t *crdt;
+    fs_transport_t *transport;
+    fsTestText text;
+    transportMessage outbox[TRANSPORT_WIRE];
+    size_t head, tail;
+    size_t sent, delivered;
+} transportEndpoint;
+
+static uint64_t transportRandomState = 0xda942042e4dd58b5ull;
+
+static size_t transportRandom(size_t bound) {
+    return fsTestRandom(&transportRandomState, bound);
+}
+
+static void transportSend(void *context, const uint8_t *bytes, size_t length) {
+    transportEndpoint *endpoint = context;
+    transportMessage *message = &endpoint->outbox[endpoint->tail++ % TRANSPORT_WIRE];
+    message->bytes = malloc(length);
+    memcpy(message->bytes, bytes, length);
+    message->length = length;
+    endpoint->sent++;
+}
+
+static void transportSetUp(transportEndpoint *endpoint, uint32_t client, const fs_transport_config_t *config) {
+    memset(endpoint, 0, sizeof(*endpoint));
+    fs_crdt_create(client, &endpoint->crdt);
+    fs_transport_create(config, transportSend, endpoint, &endpoint->transport);
+    endpoint->text.bytes = malloc(1 << 20);
+}
+
+static void transportDrop(transportEndpoint *endpoint) {
+    while (endpoint->head != endpoint->tail) {
+        free(endpoint->outbox[endpoint->head++ % TRANSPORT_WIRE].bytes);
+    }
+}
+
+static void transportTearDown(transportEndpoint *endpoint) {
+    transportDrop(endpoint);
+    fs_transport_destroy(endpoint->transport);
+    fs_crdt_destroy(endpoint->crdt);
+    free(endpoint->text.bytes);
+}
+
+static void transportOnOp(void *context, const fs_crdt_op_t *op, const uint8_t *text) {
+    transportEndpoint *endpoint = context;
+    fsTestMirror mirror = { &endpoint->text, NULL, text, op->kind != FS_CRDT_INSERT };
+    endpoint->delivered++;
+    fs_crdt_apply(endpoint->crdt, op, fsTestMirrorRange, &mirror);
+}
+
+static void transportOnLocalDelete(void *context, const fs_crdt_op_t *op) {
+    fs_transport_queue(((transportEndpoint *)context)->transport, op, NULL, 0);
+}
+
+// Hands `to` everything `from` has sent so far.
+static BOOL transportDeliver(transportEndpoint *from, transportEndpoint *to, uint64_t now) {
+    BOOL ok = YES;
+    while (from->head != from->tail) {
+        transportMessage *message = &from->outbox[from->head++ % TRANSPORT_WIRE];
+        ok &= fs_transport_receive(to->transport, message->bytes, message->length, transportOnOp, to, now) ==
+              FS_ERROR_NONE;
+        free(message->bytes);
+    }
+    return ok;
+}
+
+static void transportType(transportEndpoint *endpoint, size_t position, const char *text, uint64_t now) {
+    for (size_t i = 0; text[i]; ++i) {
+        fs_crdt_op_t op;
+        fs_crdt_insert(endpoint->crdt, position + i, 1, &op);
+        fsTestTextInsert(&endpoint->text, position + i, text + i, 1);
+        fs_transport_queue(endpoint->transport, &op, (const uint8_t *)text + i, now);
+    }
+}
+
+static BOOL transportSettle(transportEndpoint *a, transportEndpoint *b, uint64_t *now) {
+    for (int round = 0; round < 1000; ++round) {
+        *now += 5;
+        transportDeliver(a, b, *now);
+        transportDeliver(b, a, *now);
+        fs_transport_poll(a->transport, *now, NULL);
+        fs_transport_poll(b->transport, *now, NULL);
+        if (fs_transport_idle(a->transport) && fs_transport_idle(b->transport) && a->head == a->tail &&
+            b->head == b->tail) {
+            return a->text.length == b->text.length && memcmp(a->text.bytes, b->text.bytes, a->text.length) == 0;
+        }
+    }
+    return NO;
+}
+
+@interface transportTests : XCTestCase
+
+@end
+
+@implementation transportTests
+
+- (void)testTypingFoldsIntoOneMessage {
+    transportEndpoint a, b;
+    uint64_t now = 0, deadline = 0;
+    const char *typed = "the quick brown fox jumps over the lazy dog";
+    transportSetUp(&a, 1, NULL);
+    transportSetUp(&b, 2, NULL);
+    
+    transportType(&a, 0, typed, now);
+    fs_transport_poll(a.transport, FS_TRANSPORT_WINDOW_MS - 1, &deadline);
+    XCTAssertEqual(a.sent, (size_t)0);
+    XCTAssertEqual(deadline, (uint64_t)FS_TRANSPORT_WINDOW_MS);
+    fs_transport_poll(a.transport, FS_TRANSPORT_WINDOW_MS, NULL);
+    XCTAssertEqual(a.sent, (size_t)1);
+    XCTAssertLessThanOrEqual(a.outbox[0].length, strlen(typed) + 12);
+    
+    now = FS_TRANSPORT_WINDOW_MS;
+    XCTAssertTrue(transportDeliver(&a, &b, now));
+    XCTAssertEqual(b.delivered, (size_t)1);
+    XCTAssertTrue(transportSettle(&a, &b, &now));
+    transportTearDown(&a);
+    transportTearDown(&b);
+}
+
+- (void)testBackspacesCancelOutBeforeSending {
+    transportEndpoint a, b;
+    uint64_t now = 0;
+    transportSetUp(&a, 1, NULL);
+    transportSetUp(&b, 2, NULL);
+    
+    transportType(&a, 0, "hello world", now);
+    for (int i = 0; i < 5; ++i) {
+        XCTAssertEqual(fs_crdt_delete(a.crdt, a.text.length - 1, 1, transportOnLocalDelete, &a), FS_ERROR_NONE);
+        a.text.length--;
+    }
+    fs_transport_flush(a.transport, now);
+    XCTAssertEqual(a.sent, (size_t)1);
+    transportDeliver(&a, &b, now);
+    XCTAssertLessThanOrEqual(b.delivered, (size_t)2);
+    XCTAssertTrue(transportSettle(&a, &b, &now));
+    XCTAssertEqual(b.text.length, (size_t)6);
+    XCTAssertEqual(memcmp(b.text.bytes, "hello ", 6), 0);
+    transportTearDown(&a);
+    transportTearDown(&b);
+}
+
+- (void)testInFlightLimitHoldsMessagesUntilAcknowledged {
+    fs_transport_config_t config = { .window_ms = 10, .max_in_flight = 1 };
+    transportEndpoint a, b;
+    uint64_t now = 0;
+    transportSetUp(&a, 1, &config);
+    transportSetUp(&b, 2, &config);
+    
+    transportType(&a, 0, "abc", now);
+    fs_transport_flush(a.transport, now);
+    transportType(&a, 0, "xyz", now);
+    fs_transport_flush(a.transport, now);
+    XCTAssertEqual(a.sent, (size_t)1);
+    
+    transportDeliver(&a, &b, now);
+    fs_transport_flush(b.transport, now);
+    transportDeliver(&b, &a, now);
+    fs_transport_flush(a.transport, now);
+    XCTAssertEqual(a.sent, (size_t)2);
+    XCTAssertTrue(transportSettle(&a, &b, &now));
+    transportTearDown(&a);
+    transportTearDown(&b);
+}
+
+- (void)testResendAfterLostMessagesConverges {
+    fs_transport_config_t config = { .window_ms = 5, .max_message = 128, .max_in_flight = 3 };
+    transportEndpoint endpoints[2];
+    uint64_t now = 0;
+    transportSetUp(&endpoints[0], 1, &config);
+    transportSetUp(&endpoints[1], 2, &config);
+    
+    for (int step = 0; step < 3000; ++step) {
+        transportEndpoint *endpoint = &endpoints[transportRandom(2)];
+        now += transportRandom(4);
+        if (endpoint->text.length && transportRandom(3) == 0) {
+            size_t position = transportRandom(endpoint->text.length);
+            size_t length = 1 + transportRandom(endpoint->text.length - position < 4 ? endpoint->text.length - position : 4);
+            fs_crdt_delete(endpoint->crdt, position, length, transportOnLocalDelete, endpoint);
+            fsTestTextDelete(&endpoint->text, position, length);
+        } else {
+            transportType(endpoint, transportRandom(endpoint->text.length + 1), transportRandom(8) ? "k" : "several", now);
+        }
+        if (transportRandom(200) == 0) {
+            // A reconnect: whatever was on the wire is gone.
+            transportDrop(&endpoints[0]);
+            transportDrop(&endpoints[1]);
+            fs_transport_resend(endpoints[0].transport);
+            fs_transport_resend(endpoints[1].transport);
+        } else if (transportRandom(3) == 0) {
+            XCTAssertTrue(transportDeliver(&endpoints[0], &endpoints[1], now));
+            XCTAssertTrue(transportDeliver(&endpoints[1], &endpoints[0], now));
+        }
+        fs_transport_poll(endpoints[0].transport, now, NULL);
+        fs_transport_poll(endpoints[1].transport, now, NULL);
+    }
+    XCTAssertTrue(transportSettle(&endpoints[0], &endpoints[1], &now));
+    XCTAssertGreaterThan(endpoints[0].text.length, (size_t)0);
+    transportTearDown(&endpoints[0]);
+    transportTearDown(&endpoints[1]);
+}
+
+- (void)testMalformedMessagesDeliverNothing {
+    transportEndpoint a, b;
+    transportSetUp(&a, 1, NULL);
+    transportSetUp(&b, 2, NULL);
+    transportType(&a, 0, "payload", 0);
+    fs_transport_flush(a.transport, 0);
+    XCTAssertEqual(a.sent, (size_t)1);
+    
+    // Cut anywhere but right after the sequence number and acknowledgement
+    // (a byte each here), which leaves a valid message without operations.
+    const transportMessage *message = &a.outbox[0];
+    for (size_t length = 1; length < message->length; ++length) {
+        if (length != 2) {
+            XCTAssertEqual(fs_transport_receive(b.transport, message->bytes, length, transportOnOp, &b, 0),
+                           FS_ERROR_INVALID_ARGUMENT, @"length %zu", length);
+        }
+    }
+    XCTAssertEqual(b.delivered, (size_t)0);
+    XCTAssertEqual(fs_transport_receive(b.transport, message->bytes, message->length, transportOnOp, &b, 0),
+                   FS_ERROR_NONE);
+    XCTAssertEqual(b.delivered, (size_t)1);
+    XCTAssertEqual(b.text.length, (size_t)7);
+    for (int i = 0; i < 5000; ++i) {
+        uint8_t junk[48];
+        size_t length = transportRandom(sizeof(junk));
+        for (size_t j = 0; j < length; ++j) {
+            junk[j] = (uint8_t)transportRandom(256);
+        }
+        fs_transport_receive(b.transport, junk, length, transportOnOp, &b, 0);
+    }
+    transportTearDown(&a);
+    transportTearDown(&b);
+}
+
+@end
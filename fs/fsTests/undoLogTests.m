@@ -0,0 +1,284 @@
+//
+//  undoLogTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/undo.h>
+#import "fsTestSupport.h"
+
+/*
+ Delta-encoded undo history.
+
+ Random pushes, pops and limit changes are mirrored in a model that keeps
+ every entry in full; whatever the checkpoint interval, each entry must
+ rebuild to the model's bytes.
+ */
+
+#define UNDO_MODEL_MAX 256
+#define UNDO_DOCUMENT_MAX 4096
+
+typedef struct {
+    char *command, *before, *after;
+    size_t commandLength, beforeLength, afterLength;
+} undoEntry;
+
+typedef struct {
+    undoEntry entries[UNDO_MODEL_MAX];
+    size_t count, limit;
+    char document[UNDO_DOCUMENT_MAX + 16];
+    size_t length;
+} undoModel;
+
+static uint64_t undoRandomState = 0xa54ff53a5f1d36f1ull;
+
+static size_t undoRandom(size_t bound) {
+    return fsTestRandom(&undoRandomState, bound);
+}
+
+static char *undoCopy(const void *bytes, size_t length) {
+    char *copy = malloc(length ? length : 1);
+    if (length) {
+        memcpy(copy, bytes, length);
+    }
+    return copy;
+}
+
+static void undoEntryFree(undoEntry *entry) {
+    free(entry->command);
+    free(entry->before);
+    free(entry->after);
+}
+
+static void undoModelEvictOldest(undoModel *model) {
+    undoEntryFree(&model->entries[0]);
+    memmove(model->entries, model->entries + 1, (model->count - 1) * sizeof(undoEntry));
+    model->count--;
+}
+
+// A small edit, like typing, deleting or replacing a character.
+static void undoMutate(undoModel *model) {
+    size_t position = undoRandom(model->length);
+    switch (undoRandom(3)) {
+        case 0:
+            if (model->length < UNDO_DOCUMENT_MAX - 10) {
+                size_t n = 1 + undoRandom(10);
+                memmove(model->document + position + n, model->document + position, model->length - position);
+                for (size_t i = 0; i < n; ++i) {
+                    model->document[position + i] = (char)('a' + undoRandom(26));
+                }
+                model->length += n;
+            }
+            break;
+        case 1:
+            if (model->length) {
+                size_t n = 1 + undoRandom(5);
+                n = position + n > model->length ? model->length - position : n;
+                memmove(model->document + position, model->document + position + n, model->length - position - n);
+                model->length -= n;
+            }
+            break;
+        default:
+            if (model->length) {
+                model->document[position] = (char)('A' + undoRandom(26));
+            }
+            break;
+    }
+}
+
+static BOOL undoMatches(fs_data_t data, const char *bytes, size_t length) {
+    return data.len == length && (!length || memcmp(data.bytes, bytes, length) == 0);
+}
+
+// Rebuilds a few random entries and compares them with the model.
+static BOOL undoCheck(const fs_undo_log_t *log, const undoModel *model) {
+    if (fs_undo_log_count(log) != model->count) {
+        return NO;
+    }
+    for (int t = 0; t < 5 && model->count; ++t) {
+        size_t index = undoRandom(model->count);
+        const undoEntry *entry = &model->entries[index];
+        fs_data_t command, before, after;
+        if (fs_undo_log_get(log, index, &command, &before, &after) != FS_ERROR_NONE) {
+            return NO;
+        }
+        BOOL ok = undoMatches(command, entry->command, entry->commandLength) &&
+                  undoMatches(before, entry->before, entry->beforeLength) &&
+                  undoMatches(after, entry->after, entry->afterLength);
+        free(command.bytes);
+        free(before.bytes);
+        free(after.bytes);
+        if (!ok) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+@interface undoLogTests : XCTestCase
+
+@end
+
+@implementation undoLogTests
+
+- (void)testHistoryMatchesModel {
+    undoModel *model = calloc(1, sizeof(undoModel));
+    const size_t intervals[] = { 1, 2, 7, FS_UNDO_CHECKPOINT_INTERVAL };
+    for (size_t k = 0; k < 4; ++k) {
+        fs_undo_log_t *log;
+        model->limit = k == 0 ? 0 : 50 + intervals[k];
+        XCTAssertEqual(fs_undo_log_create(model->limit, intervals[k], &log), FS_ERROR_NONE);
+        
+        for (int step = 0; step < 10000; ++step) {
+            size_t op = undoRandom(100);
+            if (op < 70 && (model->limit || model->count < UNDO_MODEL_MAX)) {
+                // An edit; now and then the document is replaced by an unrelated one.
+                char before[UNDO_DOCUMENT_MAX + 16], command[32];
+                if (undoRandom(10) == 0) {
+                    model->length = undoRandom(50);
+                    for (size_t i = 0; i < model->length; ++i) {
+                        model->document[i] = (char)('0' + undoRandom(10));
+                    }
+                }
+                size_t beforeLength = model->length;
+                memcpy(before, model->document, beforeLength);
+                undoMutate(model);
+                size_t commandLength = undoRandom(50) ? (size_t)snprintf(command, sizeof(command), "{\"edit\":%d}", step) : 0;
+                fs_data_t c = { command, commandLength, false }, b = { before, beforeLength, false };
+                fs_data_t a = { model->document, model->length, false };
+                XCTAssertEqual(fs_undo_log_push(log, c, b, a), FS_ERROR_NONE);
+                if (model->limit && model->count == model->limit) {
+                    undoModelEvictOldest(model);
+                }
+                model->entries[model->count++] = (undoEntry){
+                    undoCopy(command, commandLength), undoCopy(before, beforeLength), undoCopy(model->document, model->length),
+                    commandLength, beforeLength, model->length,
+                };
+            } else if (op < 90) {
+                // An undo: the newest entry comes off and editing resumes from its "before".
+                fs_data_t command, before, after;
+                fs_error_t error = fs_undo_log_pop(log, &command, &before, &after);
+                if (!model->count) {
+                    XCTAssertEqual(error, FS_ERROR_NOT_FOUND);
+                    continue;
+                }
+                undoEntry *entry = &model->entries[model->count - 1];
+                XCTAssertEqual(error, FS_ERROR_NONE);
+                XCTAssertTrue(undoMatches(command, entry->command, entry->commandLength));
+                XCTAssertTrue(undoMatches(before, entry->before, entry->beforeLength));
+                XCTAssertTrue(undoMatches(after, entry->after, entry->afterLength));
+                memcpy(model->document, before.bytes, before.len);
+                model->length = before.len;
+                free(command.bytes);
+                free(before.bytes);
+                free(after.bytes);
+                undoEntryFree(entry);
+                model->count--;
+            } else if (op < 92 && model->limit) {
+                size_t limit = 1 + undoRandom(80);
+                XCTAssertEqual(fs_undo_log_set_limit(log, limit), FS_ERROR_NONE);
+                while (model->count > limit) {
+                    undoModelEvictOldest(model);
+                }
+                model->limit = limit;
+            } else if (op < 93) {
+                fs_undo_log_clear(log);
+                while (model->count) {
+                    undoEntryFree(&model->entries[--model->count]);
+                }
+            }
+            XCTAssertTrue(undoCheck(log, model), @"interval %zu step %d", intervals[k], step);
+        }
+        
+        XCTAssertEqual(fs_undo_log_get(log, model->count, NULL, NULL, NULL), FS_ERROR_NOT_FOUND);
+        fs_undo_log_destroy(log);
+        while (model->count) {
+            undoEntryFree(&model->entries[--model->count]);
+        }
+    }
+    free(model);
+}
+
+- (void)testSmallEditsOfALargeDocumentStaySmall {
+    size_t length = 1 << 20;
+    char *document = malloc(length + 256);
+    for (size_t i = 0; i < length; ++i) {
+        document[i] = (char)('a' + undoRandom(26));
+    }
+    fs_undo_log_t *log;
+    XCTAssertEqual(fs_undo_log_create(0, 0, &log), FS_ERROR_NONE);
+    char *before = malloc(length + 256);
+    for (int edit = 0; edit < 200; ++edit) {
+        memcpy(before, document, length);
+        size_t position = undoRandom(length);
+        memmove(document + position + 1, document + position, length - position);
+        document[position] = '!';
+        fs_data_t c = { "type", 4, false }, b = { before, length, false }, a = { document, length + 1, false };
+        XCTAssertEqual(fs_undo_log_push(log, c, b, a), FS_ERROR_NONE);
+        length++;
+    }
+    
+    // Each edit stores two states. Checkpoints and the newest state are whole;
+    // the others are a few bytes each.
+    size_t checkpoints = 2 * 200 / FS_UNDO_CHECKPOINT_INTERVAL + 2;
+    XCTAssertLessThan(fs_undo_log_footprint(log), (checkpoints + 1) * length + 200 * 64);
+    fs_data_t oldest;
+    XCTAssertEqual(fs_undo_log_get(log, 0, NULL, &oldest, NULL), FS_ERROR_NONE);
+    XCTAssertEqual(oldest.len, (size_t)(1 << 20));
+    free(oldest.bytes);
+    
+    fs_undo_log_destroy(log);
+    free(document);
+    free(before);
+}
+
+- (void)testDeltasRoundTrip {
+    const char *pairs[][2] = {
+        { "", "" }, { "", "abc" }, { "abc", "" }, { "abc", "abc" }, { "hello world", "hello brave world" },
+        { "aaaa", "aaaaaa" }, { "abcdef", "xyz" }, { "{\"x\":1}", "{\"x\":12}" },
+    };
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+        fs_data_t prev = { (void *)pairs[i][0], strlen(pairs[i][0]), false };
+        fs_data_t next = { (void *)pairs[i][1], strlen(pairs[i][1]), false };
+        fs_undo_delta_t delta = fs_undo_delta_encode(prev, next);
+        XCTAssertLessThanOrEqual(delta.prefix + delta.suffix, prev.len < next.len ? prev.len : next.len);
+        
+        fs_data_t middle = { (char *)next.bytes + delta.prefix, next.len - delta.prefix - delta.suffix, false };
+        fs_data_t rebuilt;
+        XCTAssertEqual(fs_undo_delta_apply(prev, delta, middle, &rebuilt), FS_ERROR_NONE);
+        XCTAssertTrue(undoMatches(rebuilt, next.bytes, next.len), @"pair %zu", i);
+        free(rebuilt.bytes);
+    }
+    
+    // A delta that shares more than the previous state holds is refused.
+    fs_data_t prev = { "ab", 2, false }, middle = { "x", 1, false }, out;
+    XCTAssertEqual(fs_undo_delta_apply(prev, (fs_undo_delta_t){ 2, 1 }, middle, &out), FS_ERROR_INVALID_ARGUMENT);
+}
+
+@end
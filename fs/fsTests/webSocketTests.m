@@ -0,0 +1,313 @@
+//
+//  webSocketTests.m
+//  fsTests
+//
+//  Copyright (c) 2025 ScribbleLab. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are met:
+//
+//  1. Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//  2. Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//  3. Neither the name of the copyright holder nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#import <XCTest/XCTest.h>
+#import <fs/netw.h>
+#import "fsTestSupport.h"
+
+/*
+ WebSocket framing over a receive ring.
+
+ Both ends of a connection write into byte buffers; the bytes are fed to
+ the other end's ring in uneven pieces, so frames are parsed split at every
+ kind of boundary, in place and gathered.
+ */
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length, capacity, read;
+} wsWire;
+
+typedef struct {
+    fs_ws_opcode_t opcodes[64];
+    uint8_t *messages[64];
+    size_t lengths[64];
+    size_t count;
+} wsInbox;
+
+static uint64_t wsRandomState = 0x6a09e667f3bcc909ull;
+
+static size_t wsRandom(size_t bound) {
+    return fsTestRandom(&wsRandomState, bound);
+}
+
+static fs_error_t wsWritev(void *context, const struct iovec *iov, int count) {
+    wsWire *wire = context;
+    for (int i = 0; i < count; ++i) {
+        if (wire->length + iov[i].iov_len > wire->capacity) {
+            wire->capacity = (wire->length + iov[i].iov_len) * 2;
+            wire->bytes = realloc(wire->bytes, wire->capacity);
+        }
+        memcpy(wire->bytes + wire->length, iov[i].iov_base, iov[i].iov_len);
+        wire->length += iov[i].iov_len;
+    }
+    return FS_ERROR_NONE;
+}
+
+static void wsOnMessage(void *context, fs_ws_opcode_t opcode, const uint8_t *data, size_t length) {
+    wsInbox *inbox = context;
+    if (inbox->count < 64) {
+        inbox->opcodes[inbox->count] = opcode;
+        inbox->messages[inbox->count] = malloc(length ? length : 1);
+        if (length) {
+            memcpy(inbox->messages[inbox->count], data, length);
+        }
+        inbox->lengths[inbox->count++] = length;
+    }
+}
+
+static void wsInboxClear(wsInbox *inbox) {
+    for (size_t i = 0; i < inbox->count; ++i) {
+        free(inbox->messages[i]);
+    }
+    inbox->count = 0;
+}
+
+// Feeds what was written to `wire` since the last call into `ring`, a random piece at a time.
+static fs_error_t wsFeed(fs_ws_t *ws, fs_net_ring_t *ring, wsWire *wire, wsInbox *inbox) {
+    while (wire->read < wire->length) {
+        uint8_t *span;
+        size_t room = fs_net_ring_write_span(ring, &span);
+        size_t piece = 1 + wsRandom(wsRandom(4) ? 200 : 70000);
+        piece = piece < room ? piece : room;
+        piece = piece < wire->length - wire->read ? piece : wire->length - wire->read;
+        memcpy(span, wire->bytes + wire->read, piece);
+        fs_net_ring_produce(ring, piece);
+        wire->read += piece;
+        fs_error_t error = fs_ws_receive(ws, ring, wsOnMessage, inbox);
+        if (error != FS_ERROR_NONE) {
+            return error;
+        }
+    }
+    return FS_ERROR_NONE;
+}
+
+static fs_error_t wsFeedBytes(fs_ws_t *ws, fs_net_ring_t *ring, const uint8_t *bytes, size_t length, wsInbox *inbox) {
+    wsWire wire = { (uint8_t *)bytes, length, length, 0 };
+    return wsFeed(ws, ring, &wire, inbox);
+}
+
+@interface webSocketTests : XCTestCase
+
+@end
+
+@implementation webSocketTests
+
+- (void)testRFC6455Examples {
+    wsWire out = { 0 };
+    wsInbox inbox = { 0 };
+    fs_net_ring_t *ring = NULL;
+    fs_ws_t *ws = NULL;
+    fs_ws_config_t config = { .role = FS_WS_SERVER, .writev = wsWritev, .context = &out };
+    XCTAssertEqual(fs_net_ring_create(4096, &ring), FS_ERROR_NONE);
+    XCTAssertEqual(fs_ws_create(&config, &ws), FS_ERROR_NONE);
+    
+    // A masked "Hello" (RFC 6455 5.7), then "Hel" + "lo" with a ping between the fragments.
+    const uint8_t frames[] = {
+        0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58,
+        0x01, 0x83, 0, 0, 0, 0, 'H', 'e', 'l',
+        0x89, 0x80, 1, 2, 3, 4,
+        0x80, 0x82, 0, 0, 0, 0, 'l', 'o',
+    };
+    XCTAssertEqual(wsFeedBytes(ws, ring, frames, sizeof(frames), &inbox), FS_ERROR_NONE);
+    XCTAssertEqual(inbox.count, (size_t)2);
+    for (size_t i = 0; i < inbox.count; ++i) {
+        XCTAssertEqual(inbox.opcodes[i], FS_WS_TEXT);
+        XCTAssertEqual(inbox.lengths[i], (size_t)5);
+        XCTAssertEqual(memcmp(inbox.messages[i], "Hello", 5), 0);
+    }
+    // The ping was answered with an empty, unmasked pong.
+    XCTAssertEqual(out.length, (size_t)2);
+    XCTAssertEqual(out.bytes[0], 0x8a);
+    XCTAssertEqual(out.bytes[1], 0x00);
+    
+    wsInboxClear(&inbox);
+    fs_ws_destroy(ws);
+    fs_net_ring_destroy(ring);
+    free(out.bytes);
+}
+
+- (void)testEmptyFragmentsAndMessages {
+    wsWire out = { 0 };
+    wsInbox inbox = { 0 };
+    fs_net_ring_t *ring = NULL;
+    fs_ws_t *ws = NULL;
+    fs_ws_config_t config = { .role = FS_WS_SERVER, .writev = wsWritev, .context = &out };
+    XCTAssertEqual(fs_net_ring_create(4096, &ring), FS_ERROR_NONE);
+    XCTAssertEqual(fs_ws_create(&config, &ws), FS_ERROR_NONE);
+    
+    // Empty first and last fragments are gathered without a payload buffer.
+    const uint8_t frames[] = {
+        0x02, 0x80, 0, 0, 0, 0,
+        0x00, 0x83, 0, 0, 0, 0, 'a', 'b', 'c',
+        0x80, 0x80, 0, 0, 0, 0,
+        0x81, 0x80, 9, 9, 9, 9,
+        0x01, 0x80, 0, 0, 0, 0,
+        0x80, 0x80, 0, 0, 0, 0,
+    };
+    XCTAssertEqual(wsFeedBytes(ws, ring, frames, sizeof(frames), &inbox), FS_ERROR_NONE);
+    XCTAssertEqual(inbox.count, (size_t)3);
+    XCTAssertEqual(inbox.opcodes[0], FS_WS_BINARY);
+    XCTAssertEqual(inbox.lengths[0], (size_t)3);
+    XCTAssertEqual(memcmp(inbox.messages[0], "abc", 3), 0);
+    XCTAssertEqual(inbox.lengths[1], (size_t)0);
+    XCTAssertEqual(inbox.lengths[2], (size_t)0);
+    
+    wsInboxClear(&inbox);
+    fs_ws_destroy(ws);
+    fs_net_ring_destroy(ring);
+    free(out.bytes);
+}
+
+- (void)testRoundTripsInEveryMode {
+    static uint8_t payload[200000];
+    for (int mode = 0; mode < 3; ++mode) {
+        wsWire wires[2] = { { 0 }, { 0 } };
+        wsInbox inbox = { 0 };
+        fs_net_ring_t *rings[2];
+        fs_ws_t *ends[2];
+        for (int i = 0; i < 2; ++i) {
+            fs_ws_config_t config = {
+                .role = i ? FS_WS_SERVER : FS_WS_CLIENT,
+                .deflate = mode > 0,
+                .no_context_takeover = mode == 2,
+                .writev = wsWritev,
+                .context = &wires[i],
+            };
+            XCTAssertEqual(fs_net_ring_create(65536, &rings[i]), FS_ERROR_NONE);
+            XCTAssertEqual(fs_ws_create(&config, &ends[i]), FS_ERROR_NONE);
+        }
+        
+        for (int step = 0; step < 300; ++step) {
+            int from = (int)wsRandom(2);
+            size_t length = wsRandom(8) ? wsRandom(400) : wsRandom(sizeof(payload));
+            BOOL text = wsRandom(2);
+            for (size_t i = 0; i < length; ++i) {
+                payload[i] = text ? (uint8_t)(wsRandom(4) ? 'a' + wsRandom(26) : ' ') : (uint8_t)wsRandom(256);
+            }
+            // Up to three slices, possibly empty.
+            struct iovec slices[3];
+            size_t at = 0;
+            for (int s = 0; s < 3; ++s) {
+                size_t piece = s == 2 ? length - at : wsRandom(length - at + 1);
+                slices[s] = (struct iovec){ payload + at, piece };
+                at += piece;
+            }
+            XCTAssertEqual(fs_ws_send(ends[from], text ? FS_WS_TEXT : FS_WS_BINARY, slices, 3), FS_ERROR_NONE);
+            XCTAssertEqual(wsFeed(ends[1 - from], rings[1 - from], &wires[from], &inbox), FS_ERROR_NONE);
+            XCTAssertEqual(inbox.count, (size_t)1, @"mode %d step %d", mode, step);
+            if (inbox.count == 1) {
+                XCTAssertEqual(inbox.opcodes[0], text ? FS_WS_TEXT : FS_WS_BINARY);
+                XCTAssertEqual(inbox.lengths[0], length);
+                XCTAssertEqual(memcmp(inbox.messages[0], payload, length), 0);
+            }
+            wsInboxClear(&inbox);
+        }
+        if (mode > 0) {
+            // Repetitive text shrinks on the wire.
+            size_t before = wires[1].length;
+            memset(payload, 'x', 4096);
+            struct iovec slice = { payload, 4096 };
+            XCTAssertEqual(fs_ws_send(ends[1], FS_WS_TEXT, &slice, 1), FS_ERROR_NONE);
+            XCTAssertLessThan(wires[1].length - before, (size_t)1024);
+            XCTAssertEqual(wsFeed(ends[0], rings[0], &wires[1], &inbox), FS_ERROR_NONE);
+            XCTAssertEqual(inbox.lengths[0], (size_t)4096);
+            wsInboxClear(&inbox);
+        }
+        for (int i = 0; i < 2; ++i) {
+            fs_ws_destroy(ends[i]);
+            fs_net_ring_destroy(rings[i]);
+            free(wires[i].bytes);
+        }
+    }
+}
+
+- (void)testProtocolErrorsAskForTheirCloseCodes {
+    struct {
+        uint8_t bytes[16];
+        size_t length;
+        fs_error_t error;
+        uint16_t code;
+    } cases[] = {
+        // Invalid UTF-8 in a text message.
+        { { 0x81, 0x82, 0, 0, 0, 0, 0xc0, 0xaf }, 8, FS_ERROR_INVALID_ARGUMENT, FS_WS_CLOSE_INVALID_DATA },
+        // A client frame without a mask.
+        { { 0x82, 0x01, 0x00 }, 3, FS_ERROR_INVALID_ARGUMENT, FS_WS_CLOSE_PROTOCOL },
+        // A continuation with no message to continue.
+        { { 0x80, 0x80, 0, 0, 0, 0 }, 6, FS_ERROR_INVALID_ARGUMENT, FS_WS_CLOSE_PROTOCOL },
+        // A fragmented ping.
+        { { 0x09, 0x80, 0, 0, 0, 0 }, 6, FS_ERROR_INVALID_ARGUMENT, FS_WS_CLOSE_PROTOCOL },
+        // 64 bytes against a limit of 32.
+        { { 0x82, 0xc0, 0, 0, 0, 0 }, 6, FS_ERROR_NOT_SUPPORTED, FS_WS_CLOSE_TOO_BIG },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        wsWire out = { 0 };
+        wsInbox inbox = { 0 };
+        fs_net_ring_t *ring = NULL;
+        fs_ws_t *ws = NULL;
+        fs_ws_config_t config = { .role = FS_WS_SERVER, .max_message = 32, .writev = wsWritev, .context = &out };
+        XCTAssertEqual(fs_net_ring_create(4096, &ring), FS_ERROR_NONE);
+        XCTAssertEqual(fs_ws_create(&config, &ws), FS_ERROR_NONE);
+        XCTAssertEqual(fs_ws_close_code(ws), FS_WS_CLOSE_NORMAL);
+        
+        uint8_t *span;
+        fs_net_ring_write_span(ring, &span);
+        memcpy(span, cases[i].bytes, cases[i].length);
+        fs_net_ring_produce(ring, cases[i].length);
+        XCTAssertEqual(fs_ws_receive(ws, ring, wsOnMessage, &inbox), cases[i].error, @"case %zu", i);
+        XCTAssertEqual(fs_ws_close_code(ws), cases[i].code, @"case %zu", i);
+        XCTAssertEqual(inbox.count, (size_t)0);
+        
+        fs_ws_destroy(ws);
+        fs_net_ring_destroy(ring);
+        free(out.bytes);
+    }
+}
+
+- (void)testNothingIsSentAfterClose {
+    wsWire out = { 0 };
+    fs_ws_t *ws = NULL;
+    fs_ws_config_t config = { .role = FS_WS_SERVER, .writev = wsWritev, .context = &out };
+    XCTAssertEqual(fs_ws_create(&config, &ws), FS_ERROR_NONE);
+    
+    struct iovec big = { NULL, 0 };
+    uint8_t control[126] = { 0 };
+    big = (struct iovec){ control, sizeof(control) };
+    XCTAssertEqual(fs_ws_send(ws, FS_WS_PING, &big, 1), FS_ERROR_INVALID_ARGUMENT);
+    XCTAssertEqual(fs_ws_close(ws, FS_WS_CLOSE_NORMAL, "bye"), FS_ERROR_NONE);
+    XCTAssertEqual(out.length, (size_t)7);
+    XCTAssertEqual(out.bytes[0], 0x88);
+    XCTAssertEqual(fs_ws_send(ws, FS_WS_TEXT, NULL, 0), FS_ERROR_CANCELLED);
+    fs_ws_destroy(ws);
+    free(out.bytes);
+}
+
+@end